@@ -73,6 +73,7 @@ namespace fs
 			switch ( status )
 			{
 				case fs::FileNotExpired:
+					++m_stats.m_hitCount;
 					return itFound->second.m_crc32Checksum;		// cache hit
 				case fs::ExpiredFileModified:
 					m_cachedChecksums.erase( itFound );			// file modified in the meantime: refresh CRC
@@ -85,7 +86,10 @@ namespace fs
 
 		if ( UINT crc32Checksum = crc32::ComputeFileChecksum( filePath ) )
 		{
-			m_cachedChecksums[ filePath ] = CStamp( crc32Checksum, fs::GetFileSize( filePath.GetPtr() ), fs::ReadLastModifyTime( filePath ) );
+			const CStamp& stamp = m_cachedChecksums[ filePath ] = CStamp( crc32Checksum, fs::GetFileSize( filePath.GetPtr() ), fs::ReadLastModifyTime( filePath ) );
+
+			++m_stats.m_computedCount;
+			m_stats.m_computedByteCount += stamp.m_fileSize;
 			return crc32Checksum;
 		}
 
@@ -110,6 +110,18 @@ namespace fs
 		void Clear( void ) { m_cachedChecksums.clear(); }
 
 		UINT AcquireCrc32( const fs::CPath& filePath );
+
+		// cumulative counters, for instrumentation: callers measure the difference between snapshots
+		struct CStats
+		{
+			CStats( void ) : m_hitCount( 0 ), m_computedCount( 0 ), m_computedByteCount( 0 ) {}
+		public:
+			size_t m_hitCount;				// checksums of unmodified files, returned from the cache
+			size_t m_computedCount;			// checksums computed by reading the entire file
+			UINT64 m_computedByteCount;
+		};
+
+		const CStats& GetStats( void ) const { return m_stats; }
 	private:
 		static fs::FileExpireStatus CheckExpireStatus( const fs::CPath& filePath, UINT64 fileSize, const CTime& modifyTime );
 
@@ -124,6 +136,7 @@ namespace fs
 
 	private:
 		std::unordered_map<fs::CPath, CStamp> m_cachedChecksums;
+		CStats m_stats;
 	};
 }
 
@@ -6,8 +6,13 @@
 #include "Crc32.h"
 #include "ComparePredicates.h"
 #include "FileSystem.h"
+#include "EnumTags.h"
 #include "IProgressService.h"
+#include "ParallelFor.h"
+#include "Path.h"
 #include "StringUtilities.h"
+#include "Timer.h"
+#include <unordered_set>
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -68,6 +73,34 @@ void CDuplicateFilesGroup::AddItem( CDuplicateFileItem* pDupItem )
 	pDupItem->SetParentGroup( this );
 }
 
+void CDuplicateFilesGroup::MergeFoundGroup( CDuplicateFilesGroup* pFoundGroup )
+{
+	ASSERT_PTR( pFoundGroup );
+	REQUIRE( pFoundGroup != this && m_contentKey == pFoundGroup->GetContentKey() );
+
+	std::vector<CDuplicateFileItem*> items;
+	items.reserve( pFoundGroup->m_items.size() );
+
+	for ( std::vector<CDuplicateFileItem*>::const_iterator itItem = m_items.begin(); itItem != m_items.end(); ++itItem )
+		if ( const CDuplicateFileItem* pFoundItem = pFoundGroup->FindItem( ( *itItem )->GetFilePath() ) )
+		{
+			( *itItem )->RefState() = pFoundItem->GetState();		// refresh the file state, keep the item (and its position)
+			items.push_back( *itItem );
+		}
+		else
+			delete *itItem;				// vanished file
+
+	m_items.swap( items );
+
+	for ( std::vector<CDuplicateFileItem*>::iterator itFoundItem = pFoundGroup->m_items.begin(); itFoundItem != pFoundGroup->m_items.end(); ++itFoundItem )
+		if ( !ContainsItem( ( *itFoundItem )->GetFilePath() ) )
+			AddItem( utl::ReleaseOwnership( *itFoundItem ) );		// new duplicate: take ownership
+
+	utl::ClearOwningContainer( pFoundGroup->m_items );		// delete the found items that were merged
+	StoreDigest( pFoundGroup->GetDigest() );				// as verified by this search
+	SortDuplicates();
+}
+
 bool CDuplicateFilesGroup::MakeOriginalItem( CDuplicateFileItem* pItem )
 {
 	ASSERT_PTR( pItem );
@@ -98,7 +131,8 @@ bool CDuplicateFilesGroup::MakeDuplicateItem( CDuplicateFileItem* pItem )
 	return true;
 }
 
-void CDuplicateFilesGroup::ExtractChecksumDuplicates( std::vector<CDuplicateFilesGroup*>& rDuplicateGroups, size_t& rIgnoredCount, utl::IProgressService* pProgressSvc ) throws_( CUserAbortedException )
+void CDuplicateFilesGroup::ExtractChecksumDuplicates( std::vector<CDuplicateFilesGroup*>& rDuplicateGroups, size_t& rIgnoredCount, utl::IProgressService* pProgressSvc,
+													  CContentIoStats* pIoStats /*= nullptr*/ ) throws_( CUserAbortedException )
 {
 	REQUIRE( HasDuplicates() );
 	REQUIRE( 0 == m_contentKey.m_crc32 );			// CRC32 is yet to be computed
@@ -110,13 +144,21 @@ void CDuplicateFilesGroup::ExtractChecksumDuplicates( std::vector<CDuplicateFile
 	TKeyItemContainer scopedKeyItems;
 	scopedKeyItems.reserve( m_items.size() );
 
+	const fs::CCrc32FileCache::CStats& cacheStats = fs::CCrc32FileCache::Instance().GetStats();
+
 	for ( std::vector<CDuplicateFileItem*>::iterator itItem = m_items.begin(); itItem != m_items.end(); ++itItem )
 	{
 		pProgressSvc->AdvanceItem( ( *itItem )->GetFilePath().Get() );
 
 		TKeyItemPair newItem( m_contentKey, *itItem );
+		UINT64 prevReadByteCount = cacheStats.m_computedByteCount;
+		CTimer timer;
 
 		newItem.first.StoreCrc32( newItem.second->GetState(), true );		// lazy evaluate CRC32 with caching
+
+		if ( pIoStats != nullptr && cacheStats.m_computedByteCount != prevReadByteCount )		// file read (not cached)?
+			pIoStats->AddFileRead( newItem.second->GetFilePath(), m_contentKey.m_fileSize, cacheStats.m_computedByteCount - prevReadByteCount, timer.ElapsedSeconds() );
+
 		if ( newItem.first.HasCrc32() )
 		{
 			pProgressSvc->AdvanceStage( newItem.first.Format() );
@@ -161,12 +203,241 @@ void CDuplicateFilesGroup::ExtractChecksumDuplicates( std::vector<CDuplicateFile
 	}
 }
 
+void CDuplicateFilesGroup::ExtractPartitions( std::vector<CDuplicateFilesGroup*>& rSubGroups, const std::vector<size_t>& itemPartitions, size_t partitionCount,
+											  const std::vector<fs::CFileDigest>* pPartitionDigests /*= nullptr*/ )
+{
+	REQUIRE( itemPartitions.size() == m_items.size() );
+	REQUIRE( nullptr == pPartitionDigests || pPartitionDigests->size() == partitionCount );
+
+	utl::COwningContainer< std::vector<CDuplicateFileItem*> > scopedItems;
+	scopedItems.swap( m_items );				// take scoped ownership: items not passed to sub-groups are deleted when going out of scope
+
+	std::vector<size_t> partitionCounts( partitionCount, 0 );
+
+	for ( std::vector<size_t>::const_iterator itPartition = itemPartitions.begin(); itPartition != itemPartitions.end(); ++itPartition )
+		if ( *itPartition != utl::npos )
+			++partitionCounts[ *itPartition ];
+
+	std::vector<CDuplicateFilesGroup*> partitionGroups( partitionCount, nullptr );
+
+	for ( size_t pos = 0; pos != scopedItems.size(); ++pos )
+	{
+		size_t partition = itemPartitions[ pos ];
+
+		if ( partition != utl::npos && partitionCounts[ partition ] > 1 )		// has multiple duplicates?
+		{
+			CDuplicateFilesGroup*& rpGroup = partitionGroups[ partition ];
+
+			if ( nullptr == rpGroup )
+			{
+				rpGroup = new CDuplicateFilesGroup( m_contentKey );
+				rpGroup->StoreDigest( pPartitionDigests != nullptr ? &( *pPartitionDigests )[ partition ] : GetDigest() );
+				rSubGroups.push_back( rpGroup );
+			}
+
+			rpGroup->AddItem( utl::ReleaseOwnership( scopedItems[ pos ] ) );
+		}
+	}
+}
+
+size_t CDuplicateFilesGroup::DiscardHardLinks( const std::vector<fs::CFileIdentity>& itemIdentities )
+{
+	REQUIRE( itemIdentities.size() == m_items.size() );
+
+	std::vector<CDuplicateFileItem*> keptItems;
+	std::vector<fs::CFileIdentity> keptIdentities;
+	size_t discardedCount = 0;
+
+	for ( size_t pos = 0; pos != m_items.size(); ++pos )
+		if ( itemIdentities[ pos ].HasHardLinks() && utl::Contains( keptIdentities, itemIdentities[ pos ] ) )
+		{
+			delete m_items[ pos ];
+			++discardedCount;
+		}
+		else
+		{
+			keptItems.push_back( m_items[ pos ] );
+			keptIdentities.push_back( itemIdentities[ pos ] );
+		}
+
+	m_items.swap( keptItems );
+	return discardedCount;
+}
+
+
+// CContentIoStats implementation
+
+CContentIoStats::SizeBucket CContentIoStats::FindSizeBucket( UINT64 fileSize )
+{
+	if ( fileSize <= 64 * KiloByte )
+		return Upto64KB;
+	else if ( fileSize <= MegaByte )
+		return Upto1MB;
+	else if ( fileSize <= 16 * MegaByte )
+		return Upto16MB;
+	else if ( fileSize <= 256 * MegaByte )
+		return Upto256MB;
+
+	return Over256MB;
+}
+
+const CEnumTags& CContentIoStats::GetTags_SizeBucket( void )
+{
+	static const CEnumTags s_tags( _T("Up to 64 KB|Up to 1 MB|Up to 16 MB|Up to 256 MB|Over 256 MB"), _T("upto64KB|upto1MB|upto16MB|upto256MB|over256MB") );
+	return s_tags;
+}
+
+void CContentIoStats::AddFileRead( const fs::CPath& filePath, UINT64 fileSize, UINT64 readCount, double elapsedSeconds )
+{
+	fs::CHashThroughput* pStages[] = { &m_sizeBuckets[ FindSizeBucket( fileSize ) ], &m_volumes[ path::GetRootPath( filePath.GetPtr() ) ] };
+
+	for ( size_t i = 0; i != COUNT_OF( pStages ); ++i )
+	{
+		++pStages[ i ]->m_fileCount;
+		pStages[ i ]->m_byteCount += readCount;
+		pStages[ i ]->m_elapsedSeconds += elapsedSeconds;
+	}
+}
+
+
+namespace impl
+{
+	enum { VerifyBatchSize = 64 };			// files verified concurrently between progress updates (which may abort)
+
+
+	// queries the file identity in a worker thread: writes only to its own slot, and never throws
+	//
+	struct QueryIdentityFunc
+	{
+		QueryIdentityFunc( std::vector<fs::CFileIdentity>& rIdentities, const std::vector<const CDuplicateFileItem*>& items ) : m_rIdentities( rIdentities ), m_items( items ) {}
+
+		void operator()( size_t index ) const
+		{
+			fs::QueryFileIdentity( m_rIdentities[ index ], m_items[ index ]->GetFilePath() );		// empty identity on error
+		}
+	private:
+		std::vector<fs::CFileIdentity>& m_rIdentities;
+		const std::vector<const CDuplicateFileItem*>& m_items;
+	};
+
+
+	struct CDigestTask
+	{
+		CDigestTask( const CDuplicateFileItem* pItem ) : m_pItem( pItem ), m_succeeded( false ), m_elapsedSeconds( 0.0 ) {}
+	public:
+		const CDuplicateFileItem* m_pItem;
+		fs::CFileDigest m_digest;
+		bool m_succeeded;
+		double m_elapsedSeconds;
+	};
+
+
+	// computes the digest of a file in a worker thread: writes only to its own task, and never throws
+	//
+	struct ComputeDigestFunc
+	{
+		ComputeDigestFunc( std::vector<CDigestTask>& rTasks, size_t firstPos, fs::HashAlgorithm hashAlgorithm )
+			: m_rTasks( rTasks ), m_firstPos( firstPos ), m_hashAlgorithm( hashAlgorithm ) {}
+
+		void operator()( size_t index ) const
+		{
+			CDigestTask& rTask = m_rTasks[ m_firstPos + index ];
+			CTimer timer;
+
+			rTask.m_succeeded = fs::ComputeFileDigest( rTask.m_digest, rTask.m_pItem->GetFilePath(), rTask.m_pItem->GetState().m_fileSize, m_hashAlgorithm );
+			rTask.m_elapsedSeconds = timer.ElapsedSeconds();
+		}
+	private:
+		std::vector<CDigestTask>& m_rTasks;
+		size_t m_firstPos;
+		fs::HashAlgorithm m_hashAlgorithm;
+	};
+
+
+	struct CCompareTask
+	{
+		CCompareTask( const CDuplicateFilesGroup* pGroup ) : m_pGroup( pGroup ), m_partitionCount( 0 ), m_readCount( 0 ) {}
+	public:
+		const CDuplicateFilesGroup* m_pGroup;
+		std::vector<size_t> m_itemPartitions;		// items with identical contents share the partition
+		size_t m_partitionCount;
+		UINT64 m_readCount;
+
+		// reads of each item's comparisons (both files), attributed to the compared item
+		std::vector<UINT64> m_itemReadCounts;
+		std::vector<double> m_itemSeconds;
+	};
+
+
+	// compares the contents of a group's items in a worker thread: writes only to its own task, and never throws
+	//
+	struct CompareContentsFunc
+	{
+		CompareContentsFunc( std::vector<CCompareTask>& rTasks, size_t firstPos ) : m_rTasks( rTasks ), m_firstPos( firstPos ) {}
+
+		void operator()( size_t index ) const
+		{
+			CCompareTask& rTask = m_rTasks[ m_firstPos + index ];
+			const std::vector<CDuplicateFileItem*>& items = rTask.m_pGroup->GetItems();
+			std::vector<size_t> partitionFirstItems;		// each item is compared with the first item of each partition, until matched
+
+			rTask.m_itemReadCounts.assign( items.size(), 0 );
+			rTask.m_itemSeconds.assign( items.size(), 0.0 );
+
+			for ( size_t pos = 0; pos != items.size(); ++pos )
+			{
+				size_t partition = 0;
+				CTimer timer;
+
+				for ( ; partition != partitionFirstItems.size(); ++partition )
+				{
+					UINT64 readCount;
+					bool sameContents = fs::HaveSameContents( items[ partitionFirstItems[ partition ] ]->GetFilePath(), items[ pos ]->GetFilePath(), &readCount );
+
+					rTask.m_itemReadCounts[ pos ] += readCount;
+					if ( sameContents )
+						break;
+				}
+
+				rTask.m_readCount += rTask.m_itemReadCounts[ pos ];
+				rTask.m_itemSeconds[ pos ] = timer.ElapsedSeconds();
+
+				if ( partition == partitionFirstItems.size() )
+				{	// new partition (CRC32 collision, or read error)
+					partitionFirstItems.push_back( pos );
+					++rTask.m_partitionCount;
+				}
+
+				rTask.m_itemPartitions.push_back( partition );
+			}
+		}
+	private:
+		std::vector<CCompareTask>& m_rTasks;
+		size_t m_firstPos;
+	};
+}
+
 
 // CDuplicateGroupStore implementation
 
+CDuplicateGroupStore::CDuplicateGroupStore( fs::HashAlgorithm hashAlgorithm /*= fs::Crc32Only*/, bool byteCompare /*= false*/ )
+	: m_hashAlgorithm( hashAlgorithm )
+	, m_byteCompare( byteCompare )
+	, m_hardLinkCount( 0 )
+	, m_spillRunCount( 0 )
+	, m_spillLostCount( 0 )
+	, m_repeatedCount( 0 )
+	, m_batchItemCount( 0 )
+	, m_pBatchProgressSvc( nullptr )
+	, m_pendingItemCount( 0 )
+	, m_batchIgnoredCount( 0 )
+{
+}
+
 CDuplicateGroupStore::~CDuplicateGroupStore( void )
 {
 	utl::ClearOwningContainer( m_groups );
+	utl::ClearOwningContainer( m_crc32Groups );
 }
 
 size_t CDuplicateGroupStore::GetDuplicateItemCount( const std::vector<CDuplicateFilesGroup*>& groups )
@@ -197,13 +468,120 @@ CDuplicateFilesGroup* CDuplicateGroupStore::RegisterItem( CDuplicateFileItem* pD
 	return rpGroup;
 }
 
+void CDuplicateGroupStore::SetSpillThreshold( size_t maxMemoryFileCount )
+{
+	m_sizeSorter.SetMaxMemoryCount( maxMemoryFileCount );
+	m_batchItemCount = maxMemoryFileCount;			// the candidate items are bounded by the same count
+}
+
+void CDuplicateGroupStore::GroupBySize( utl::IProgressService* pBatchProgressSvc /*= nullptr*/ ) throws_( CUserAbortedException )
+{
+	m_spillRunCount = m_sizeSorter.GetRunCount();
+	m_pBatchProgressSvc = m_batchItemCount != 0 ? pBatchProgressSvc : nullptr;
+	m_spillLostCount += static_cast<size_t>( m_sizeSorter.StreamSizeGroups( this ) );		// calls back OnSizeGroup() for each size with multiple files
+	m_pBatchProgressSvc = nullptr;
+}
+
+void CDuplicateGroupStore::OnSizeGroup( const std::vector<fs::CFileState>& fileStates )
+{
+	std::unordered_set<fs::CPath> groupPaths;		// a file is found multiple times by overlapping search paths, when the enumerator doesn't keep the unique paths
+
+	for ( std::vector<fs::CFileState>::const_iterator itFileState = fileStates.begin(); itFileState != fileStates.end(); ++itFileState )
+	{
+		if ( m_batchItemCount != 0 && !groupPaths.insert( itFileState->m_fullPath ).second )
+		{
+			++m_repeatedCount;
+			continue;
+		}
+
+		UINT crc32 = itFileState->GetCrc32( fs::CFileState::AsIs );		// known from a previous search?
+		CDuplicateFileItem* pDupItem = new CDuplicateFileItem( *itFileState );
+
+		pDupItem->RefState().ResetCrc32();
+		RegisterItem( pDupItem );					// group by file size
+
+		if ( crc32 != 0 )
+			pDupItem->RefState().StoreCrc32( crc32 );	// reuse the previous checksum (after grouping by file size)
+
+		++m_pendingItemCount;
+	}
+
+	// a size group is always complete, so a batch never splits the candidates of the same size
+	if ( m_pBatchProgressSvc != nullptr && m_pendingItemCount >= m_batchItemCount )
+		ExtractCrc32Batch();
+}
+
+void CDuplicateGroupStore::ExtractCrc32Batch( void ) throws_( CUserAbortedException )
+{
+	ASSERT_PTR( m_pBatchProgressSvc );
+
+	DiscardHardLinks();
+	m_pBatchProgressSvc->SetBoundedProgressCount( GetDuplicateItemCount() );		// progress of the current batch
+
+	ExtractCrc32Groups( m_crc32Groups, m_batchIgnoredCount, m_pBatchProgressSvc );
+	m_pendingItemCount = 0;
+}
+
+size_t CDuplicateGroupStore::DiscardHardLinks( void )
+{
+	std::vector<const CDuplicateFileItem*> candidateItems;
+	candidateItems.reserve( GetDuplicateItemCount() );
+
+	for ( std::vector<CDuplicateFilesGroup*>::const_iterator itGroup = m_groups.begin(); itGroup != m_groups.end(); ++itGroup )
+		if ( ( *itGroup )->HasDuplicates() )
+			candidateItems.insert( candidateItems.end(), ( *itGroup )->GetItems().begin(), ( *itGroup )->GetItems().end() );
+
+	std::vector<fs::CFileIdentity> identities( candidateItems.size() );
+	mt::ParallelFor( candidateItems.size(), impl::QueryIdentityFunc( identities, candidateItems ) );
+
+	size_t discardedCount = 0;
+	std::vector<fs::CFileIdentity>::const_iterator itIdentity = identities.begin();
+
+	for ( std::vector<CDuplicateFilesGroup*>::const_iterator itGroup = m_groups.begin(); itGroup != m_groups.end(); ++itGroup )
+		if ( ( *itGroup )->HasDuplicates() )
+		{
+			std::vector<fs::CFileIdentity>::const_iterator itEndIdentity = itIdentity + ( *itGroup )->GetItems().size();
+
+			discardedCount += ( *itGroup )->DiscardHardLinks( std::vector<fs::CFileIdentity>( itIdentity, itEndIdentity ) );
+			itIdentity = itEndIdentity;
+		}
+
+	ENSURE( itIdentity == identities.end() );
+	m_hardLinkCount += discardedCount;
+	return discardedCount;
+}
+
 void CDuplicateGroupStore::ExtractDuplicateGroups( std::vector<CDuplicateFilesGroup*>& rDuplicateGroups, size_t& rIgnoredCount, utl::IProgressService* pProgressSvc ) throws_( CUserAbortedException )
 {
 	ASSERT_PTR( pProgressSvc );
 
+	// pass ownership of the CRC32 duplicates extracted by the batches (if any)
+	rDuplicateGroups.insert( rDuplicateGroups.end(), m_crc32Groups.begin(), m_crc32Groups.end() );
+	m_crc32Groups.clear();
+	rIgnoredCount += m_batchIgnoredCount;
+	m_batchIgnoredCount = 0;
+
+	ExtractCrc32Groups( rDuplicateGroups, rIgnoredCount, pProgressSvc );		// the remaining candidates
+
+	if ( m_hashAlgorithm != fs::Crc32Only )
+		VerifyByDigest( rDuplicateGroups, rIgnoredCount, pProgressSvc );
+
+	if ( UseByteCompare() )
+		VerifyByContent( rDuplicateGroups, pProgressSvc );
+
+	utl::for_each( rDuplicateGroups, func::SortGroupDuplicates() );		// sort each group's duplicate items by path
+}
+
+void CDuplicateGroupStore::ExtractCrc32Groups( std::vector<CDuplicateFilesGroup*>& rCrc32Groups, size_t& rIgnoredCount, utl::IProgressService* pProgressSvc ) throws_( CUserAbortedException )
+{
+	ASSERT_PTR( pProgressSvc );
+
 	utl::COwningContainer< std::vector<CDuplicateFilesGroup*> > scopedGroups;
 	scopedGroups.swap( m_groups );			// take scoped ownership for exception safety
 
+	CTimer crc32Timer;
+	const fs::CCrc32FileCache::CStats prevCacheStats = fs::CCrc32FileCache::Instance().GetStats();
+
 	for ( size_t i = 0; i != scopedGroups.size(); ++i )
 	{
 		CDuplicateFilesGroup* pGroup = scopedGroups[ i ];
@@ -214,20 +592,183 @@ void CDuplicateGroupStore::ExtractDuplicateGroups( std::vector<CDuplicateFilesGr
 			{
 				pProgressSvc->AdvanceStage( pGroup->GetContentKey().Format() );
 
-				rDuplicateGroups.push_back( pGroup );
+				rCrc32Groups.push_back( pGroup );
 				scopedGroups[ i ] = nullptr;						// mark detached group as NULL to prevent being deleted when unwiding the stack
 			}
 			else
 			{
 				std::vector<CDuplicateFilesGroup*> subGroups;		// grouped by file-size *and* CRC32
 
-				pGroup->ExtractChecksumDuplicates( subGroups, rIgnoredCount, pProgressSvc );
-				rDuplicateGroups.insert( rDuplicateGroups.end(), subGroups.begin(), subGroups.end() );
+				m_stats.m_crc32.m_fileCount += pGroup->GetItems().size();
+				m_stats.m_crc32.m_byteCount += pGroup->GetContentKey().m_fileSize * pGroup->GetItems().size();
+
+				pGroup->ExtractChecksumDuplicates( subGroups, rIgnoredCount, pProgressSvc, &m_stats.m_io );
+				rCrc32Groups.insert( rCrc32Groups.end(), subGroups.begin(), subGroups.end() );
 			}
 		}
 	}
 
+	m_stats.m_crc32.m_elapsedSeconds += crc32Timer.ElapsedSeconds();
+
+	const fs::CCrc32FileCache::CStats& cacheStats = fs::CCrc32FileCache::Instance().GetStats();
+
+	m_stats.m_crc32CacheHitCount += cacheStats.m_hitCount - prevCacheStats.m_hitCount;
+	m_stats.m_crc32ReadCount += cacheStats.m_computedCount - prevCacheStats.m_computedCount;
+	m_stats.m_crc32ReadByteCount += cacheStats.m_computedByteCount - prevCacheStats.m_computedByteCount;
 	m_groupsMap.clear();		// cleanup the empty store
+}
 
-	utl::for_each( rDuplicateGroups, func::SortGroupDuplicates() );		// sort each group's duplicate items by path
+void CDuplicateGroupStore::VerifyByDigest( std::vector<CDuplicateFilesGroup*>& rDuplicateGroups, size_t& rIgnoredCount, utl::IProgressService* pProgressSvc ) throws_( CUserAbortedException )
+{
+	std::vector<impl::CDigestTask> tasks;
+	tasks.reserve( GetDuplicateItemCount( rDuplicateGroups ) );
+
+	for ( std::vector<CDuplicateFilesGroup*>::const_iterator itGroup = rDuplicateGroups.begin(); itGroup != rDuplicateGroups.end(); ++itGroup )
+		if ( ( *itGroup )->GetContentKey().m_fileSize != 0 )		// empty files are identical
+			for ( std::vector<CDuplicateFileItem*>::const_iterator itItem = ( *itGroup )->GetItems().begin(); itItem != ( *itGroup )->GetItems().end(); ++itItem )
+			{
+				tasks.push_back( impl::CDigestTask( *itItem ) );
+				m_stats.m_digest.m_byteCount += ( *itItem )->GetState().m_fileSize;
+			}
+
+	ProgSection_Verify( pProgressSvc, _T("Verify Duplicates by ") + fs::GetTags_HashAlgorithm().FormatUi( m_hashAlgorithm ), tasks.size() );
+
+	CTimer timer;
+
+	for ( size_t batchPos = 0; batchPos < tasks.size(); batchPos += impl::VerifyBatchSize )
+	{
+		size_t batchCount = std::min<size_t>( impl::VerifyBatchSize, tasks.size() - batchPos );
+
+		mt::ParallelFor( batchCount, impl::ComputeDigestFunc( tasks, batchPos, m_hashAlgorithm ) );
+
+		for ( size_t pos = batchPos; pos != batchPos + batchCount; ++pos )
+		{
+			const impl::CDigestTask& task = tasks[ pos ];
+
+			pProgressSvc->AdvanceItem( task.m_pItem->GetFilePath().Get() );		// on the calling thread
+
+			if ( task.m_succeeded )
+				m_stats.m_io.AddFileRead( task.m_pItem->GetFilePath(), task.m_pItem->GetState().m_fileSize, task.m_pItem->GetState().m_fileSize, task.m_elapsedSeconds );
+		}
+	}
+
+	m_stats.m_digest.m_fileCount += tasks.size();
+	m_stats.m_digest.m_elapsedSeconds += timer.ElapsedSeconds();
+
+	// regroup by file-size, CRC32 *and* digest
+	utl::COwningContainer< std::vector<CDuplicateFilesGroup*> > scopedGroups;
+	scopedGroups.swap( rDuplicateGroups );
+
+	std::vector<impl::CDigestTask>::const_iterator itTask = tasks.begin();
+
+	for ( size_t i = 0; i != scopedGroups.size(); ++i )
+	{
+		CDuplicateFilesGroup* pGroup = scopedGroups[ i ];
+
+		if ( 0 == pGroup->GetContentKey().m_fileSize )
+		{
+			rDuplicateGroups.push_back( utl::ReleaseOwnership( scopedGroups[ i ] ) );
+			continue;
+		}
+
+		std::vector<size_t> itemPartitions;
+		std::vector<fs::CFileDigest> partitionDigests;
+
+		for ( size_t itemCount = pGroup->GetItems().size(); itemCount-- != 0; ++itTask )
+		{
+			ASSERT( itTask->m_pItem == pGroup->GetItems()[ itemPartitions.size() ] );
+
+			if ( itTask->m_succeeded )
+			{
+				size_t partition = std::distance( partitionDigests.begin(), std::find( partitionDigests.begin(), partitionDigests.end(), itTask->m_digest ) );
+
+				if ( partition == partitionDigests.size() )
+					partitionDigests.push_back( itTask->m_digest );
+
+				itemPartitions.push_back( partition );
+			}
+			else
+			{
+				itemPartitions.push_back( utl::npos );
+				++rIgnoredCount;				// file not readable, or modified in the meantime
+			}
+		}
+
+		pGroup->ExtractPartitions( rDuplicateGroups, itemPartitions, partitionDigests.size(), &partitionDigests );		// the empty group is deleted when going out of scope
+	}
+
+	ENSURE( itTask == tasks.end() );
+}
+
+void CDuplicateGroupStore::VerifyByContent( std::vector<CDuplicateFilesGroup*>& rDuplicateGroups, utl::IProgressService* pProgressSvc ) throws_( CUserAbortedException )
+{
+	std::vector<impl::CCompareTask> tasks;
+	tasks.reserve( rDuplicateGroups.size() );
+
+	for ( std::vector<CDuplicateFilesGroup*>::const_iterator itGroup = rDuplicateGroups.begin(); itGroup != rDuplicateGroups.end(); ++itGroup )
+		if ( ( *itGroup )->GetContentKey().m_fileSize != 0 )
+			tasks.push_back( impl::CCompareTask( *itGroup ) );
+
+	ProgSection_Verify( pProgressSvc, _T("Compare Duplicates Byte by Byte"), GetDuplicateItemCount( rDuplicateGroups ) );
+
+	CTimer timer;
+
+	for ( size_t batchPos = 0; batchPos < tasks.size(); batchPos += impl::VerifyBatchSize )
+	{
+		size_t batchCount = std::min<size_t>( impl::VerifyBatchSize, tasks.size() - batchPos );
+
+		mt::ParallelFor( batchCount, impl::CompareContentsFunc( tasks, batchPos ) );
+
+		for ( size_t pos = batchPos; pos != batchPos + batchCount; ++pos )
+		{
+			const impl::CCompareTask& task = tasks[ pos ];
+			const std::vector<CDuplicateFileItem*>& items = task.m_pGroup->GetItems();
+
+			for ( size_t itemPos = 0; itemPos != items.size(); ++itemPos )
+			{
+				pProgressSvc->AdvanceItem( items[ itemPos ]->GetFilePath().Get() );		// on the calling thread
+
+				if ( task.m_itemReadCounts[ itemPos ] != 0 )
+					m_stats.m_io.AddFileRead( items[ itemPos ]->GetFilePath(), task.m_pGroup->GetContentKey().m_fileSize, task.m_itemReadCounts[ itemPos ], task.m_itemSeconds[ itemPos ] );
+			}
+
+			m_stats.m_byteCompare.m_fileCount += items.size();
+			m_stats.m_byteCompare.m_byteCount += task.m_readCount;
+		}
+	}
+
+	m_stats.m_byteCompare.m_elapsedSeconds += timer.ElapsedSeconds();
+
+	// regroup by identical contents
+	utl::COwningContainer< std::vector<CDuplicateFilesGroup*> > scopedGroups;
+	scopedGroups.swap( rDuplicateGroups );
+
+	std::vector<impl::CCompareTask>::const_iterator itTask = tasks.begin();
+
+	for ( size_t i = 0; i != scopedGroups.size(); ++i )
+		if ( 0 == scopedGroups[ i ]->GetContentKey().m_fileSize )
+			rDuplicateGroups.push_back( utl::ReleaseOwnership( scopedGroups[ i ] ) );
+		else
+		{
+			ASSERT( itTask->m_pGroup == scopedGroups[ i ] );
+			scopedGroups[ i ]->ExtractPartitions( rDuplicateGroups, itTask->m_itemPartitions, itTask->m_partitionCount );		// keep the digest, if any
+			++itTask;
+		}
+
+	ENSURE( itTask == tasks.end() );
+}
+
+void CDuplicateGroupStore::ProgSection_Verify( utl::IProgressService* pProgressSvc, const std::tstring& operationLabel, size_t itemCount )
+{
+	ASSERT_PTR( pProgressSvc );
+
+	if ( utl::IProgressHeader* pProgHeader = pProgressSvc->GetHeader() )
+	{
+		pProgHeader->SetOperationLabel( operationLabel );
+		pProgHeader->ShowStage( false );
+		pProgHeader->SetItemLabel( _T("Verify file") );
+	}
+
+	pProgressSvc->SetBoundedProgressCount( itemCount );
+	pProgressSvc->SetProgressStep( 1 );
 }
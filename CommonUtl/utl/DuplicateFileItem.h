@@ -3,12 +3,17 @@
 #pragma once
 
 #include "FileContent.h"
+#include "FileDigest.h"
+#include "FileLinks.h"
+#include "FileSizeSorter.h"
 #include "FileStateItem.h"
+#include <map>
 #include <unordered_map>
 
 
 namespace utl { interface IProgressService; }
 class CDuplicateFilesGroup;
+struct CContentIoStats;
 
 
 class CDuplicateFileItem : public CFileStateItem
@@ -40,6 +45,10 @@ public:
 
 	fs::CFileContentKey GetContentKey( void ) const { return m_contentKey; }
 
+	// strong hash of the content, only for the groups verified by digest
+	const fs::CFileDigest* GetDigest( void ) const { return m_pDigest.get(); }
+	void StoreDigest( const fs::CFileDigest* pDigest ) { m_pDigest.reset( pDigest != nullptr ? new fs::CFileDigest( *pDigest ) : nullptr ); }
+
 	bool HasDuplicates( void ) const { return m_items.size() > 1; }
 	bool HasCrc32( void ) const { return m_contentKey.HasCrc32(); }
 
@@ -53,8 +62,20 @@ public:
 	void AddItem( CDuplicateFileItem* pDupItem );
 	void SortDuplicates( void );		//  keep original first, sort duplicate items by path
 
-	// lazy CRC32 evaluation and regrouping
-	void ExtractChecksumDuplicates( std::vector<CDuplicateFilesGroup*>& rDuplicateGroups, size_t& rIgnoredCount, utl::IProgressService* pProgressSvc ) throws_( CUserAbortedException );
+	// incremental search: keep the existing items still found in pFoundGroup (and the original item), drop the vanished ones, take over the new ones
+	void MergeFoundGroup( CDuplicateFilesGroup* pFoundGroup );
+
+	// lazy CRC32 evaluation and regrouping; pIoStats: records the files actually read (not cached)
+	void ExtractChecksumDuplicates( std::vector<CDuplicateFilesGroup*>& rDuplicateGroups, size_t& rIgnoredCount, utl::IProgressService* pProgressSvc,
+									CContentIoStats* pIoStats = nullptr ) throws_( CUserAbortedException );
+
+	// regrouping by content verification: each partition with multiple items makes a new group; items in utl::npos partition failed verification.
+	// The new groups get the partition digests if specified, otherwise this group's digest. Leaves this group empty.
+	void ExtractPartitions( std::vector<CDuplicateFilesGroup*>& rSubGroups, const std::vector<size_t>& itemPartitions, size_t partitionCount,
+							const std::vector<fs::CFileDigest>* pPartitionDigests = nullptr );
+
+	// deletes the items that are hard links of a previous item (same file identity): they share the storage, so they are not real duplicates
+	size_t DiscardHardLinks( const std::vector<fs::CFileIdentity>& itemIdentities );
 
 	bool MakeOriginalItem( CDuplicateFileItem* pItem );
 	bool MakeDuplicateItem( CDuplicateFileItem* pItem );
@@ -66,24 +87,111 @@ public:
 	}
 private:
 	fs::CFileContentKey m_contentKey;
+	std::auto_ptr<fs::CFileDigest> m_pDigest;		// allocated only for the groups that reach the digest stage
 	std::vector<CDuplicateFileItem*> m_items;
 };
 
 
-class CDuplicateGroupStore
+// file reads of all content stages, broken down by file size (throughput histogram) and by volume.
+// Elapsed time is measured per file, so the throughput is per reading thread.
+//
+struct CContentIoStats
+{
+	enum SizeBucket { Upto64KB, Upto1MB, Upto16MB, Upto256MB, Over256MB, _SizeBucketCount };
+
+	static SizeBucket FindSizeBucket( UINT64 fileSize );
+	static const CEnumTags& GetTags_SizeBucket( void );
+
+	void AddFileRead( const fs::CPath& filePath, UINT64 fileSize, UINT64 readCount, double elapsedSeconds );
+public:
+	fs::CHashThroughput m_sizeBuckets[ _SizeBucketCount ];
+	std::map<std::tstring, fs::CHashThroughput> m_volumes;		// keyed by root path, e.g. "C:\" or "\\server\share\"
+};
+
+
+// throughput of the content verification stages
+//
+struct CContentVerifyStats
+{
+	CContentVerifyStats( void ) : m_crc32CacheHitCount( 0 ), m_crc32ReadCount( 0 ), m_crc32ReadByteCount( 0 ) {}
+
+	size_t GetHashedFileCount( void ) const { return m_crc32ReadCount + m_digest.m_fileCount; }
+	UINT64 GetReadByteCount( void ) const { return m_crc32ReadByteCount + m_digest.m_byteCount + m_byteCompare.m_byteCount; }
+public:
+	fs::CHashThroughput m_crc32;			// including the cached checksums
+	fs::CHashThroughput m_digest;
+	fs::CHashThroughput m_byteCompare;
+
+	// CRC32 stage: files actually read, vs. found in fs::CCrc32FileCache
+	size_t m_crc32CacheHitCount;
+	size_t m_crc32ReadCount;
+	UINT64 m_crc32ReadByteCount;
+
+	CContentIoStats m_io;
+};
+
+
+class CDuplicateGroupStore : private fs::ISizeGroupSink
 {
 public:
-	CDuplicateGroupStore( void ) {}
+	CDuplicateGroupStore( fs::HashAlgorithm hashAlgorithm = fs::Crc32Only, bool byteCompare = false );
 	~CDuplicateGroupStore( void );
 
 	size_t GetDuplicateItemCount( void ) const { return GetDuplicateItemCount( m_groups ); }
 	static size_t GetDuplicateItemCount( const std::vector<CDuplicateFilesGroup*>& groups );
 
+	fs::HashAlgorithm GetHashAlgorithm( void ) const { return m_hashAlgorithm; }
+	bool UseByteCompare( void ) const { return m_byteCompare && !fs::IsCryptographicHash( m_hashAlgorithm ); }		// only if still ambiguous after hashing
+	const CContentVerifyStats& GetStats( void ) const { return m_stats; }
+	size_t GetHardLinkCount( void ) const { return m_hardLinkCount; }
+
+	// before grouping: skips hashing the hard links of the same file, by querying the file identity of the duplicate candidates on multiple threads
+	size_t DiscardHardLinks( void );
+
 	CDuplicateFilesGroup* RegisterItem( CDuplicateFileItem* pDupItem );
 
+	// found files are kept in a compact table, and only the files of the same size are grouped as items (external sort for enormous scans)
+	void RegisterFile( const fs::CFileState& fileState ) { m_sizeSorter.Add( fileState ); }
+	void SetSpillThreshold( size_t maxMemoryFileCount );
+
+	// with a spill threshold and pBatchProgressSvc: the CRC32 duplicates are extracted in batches of candidates while grouping, so that only the CRC32 duplicates pile up
+	void GroupBySize( utl::IProgressService* pBatchProgressSvc = nullptr ) throws_( CUserAbortedException );
+	size_t GetSpillRunCount( void ) const { return m_spillRunCount; }		// runs merged by the last GroupBySize()
+	size_t GetSpillLostCount( void ) const { return m_spillLostCount; }		// files lost by failing to read back the spilled runs
+	size_t GetRepeatedFileCount( void ) const { return m_repeatedCount; }	// files registered more than once (overlapping search paths), discarded when grouping
+
 	// extract groups with more than 1 item
 	void ExtractDuplicateGroups( std::vector<CDuplicateFilesGroup*>& rDuplicateGroups, size_t& rIgnoredCount, utl::IProgressService* pProgressSvc ) throws_( CUserAbortedException );
 private:
+	// content verification of the CRC32 duplicates, hashing or comparing files on multiple threads
+	void ExtractCrc32Groups( std::vector<CDuplicateFilesGroup*>& rCrc32Groups, size_t& rIgnoredCount, utl::IProgressService* pProgressSvc ) throws_( CUserAbortedException );
+	void ExtractCrc32Batch( void ) throws_( CUserAbortedException );
+
+	void VerifyByDigest( std::vector<CDuplicateFilesGroup*>& rDuplicateGroups, size_t& rIgnoredCount, utl::IProgressService* pProgressSvc ) throws_( CUserAbortedException );
+	void VerifyByContent( std::vector<CDuplicateFilesGroup*>& rDuplicateGroups, utl::IProgressService* pProgressSvc ) throws_( CUserAbortedException );
+
+	static void ProgSection_Verify( utl::IProgressService* pProgressSvc, const std::tstring& operationLabel, size_t itemCount );
+
+	// fs::ISizeGroupSink interface
+	virtual void OnSizeGroup( const std::vector<fs::CFileState>& fileStates );
+private:
+	fs::HashAlgorithm m_hashAlgorithm;		// strong hash used after CRC32
+	bool m_byteCompare;						// final byte-by-byte comparison of the groups not verified by a cryptographic hash
+	CContentVerifyStats m_stats;
+	size_t m_hardLinkCount;									// discarded candidates that are hard links of other candidates
+
+	fs::CFileSizeSorter m_sizeSorter;						// found files, before grouping by size
+	size_t m_spillRunCount;
+	size_t m_spillLostCount;
+	size_t m_repeatedCount;
+
+	// bounded candidates for enormous scans
+	size_t m_batchItemCount;								// 0 for no batches
+	utl::IProgressService* m_pBatchProgressSvc;				// transient during GroupBySize()
+	size_t m_pendingItemCount;								// candidate items registered since the last batch
+	size_t m_batchIgnoredCount;
+	std::vector<CDuplicateFilesGroup*> m_crc32Groups;		// with ownership: CRC32 duplicates extracted by the batches
+
 	std::unordered_map<fs::CFileContentKey, CDuplicateFilesGroup*> m_groupsMap;
 	std::vector<CDuplicateFilesGroup*> m_groups;				// with ownership, in the order they were registered
 };
@@ -148,7 +256,7 @@ namespace func
 
 	inline void SortDuplicateGroupItems( std::vector<CDuplicateFilesGroup*>& rDupGroupItems, bool ascending = true )
 	{
-		func::SortPathItems<pred::TCompareOriginalItemPath>( rDupGroupItems, ascending );		// sort groups by original item path
+		func::SortPathItemsByKey( rDupGroupItems, func::AsOriginalItemPath(), ascending );		// sort groups by original item path
 	}
 }
 
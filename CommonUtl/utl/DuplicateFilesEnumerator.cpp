@@ -2,20 +2,96 @@
 #include "pch.h"
 #include "DuplicateFilesEnumerator.h"
 #include "ContainerOwnership.h"
+#include "EnumTags.h"
 #include "Guards.h"
 #include "IProgressService.h"
+#include "StringUtilities.h"
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
 #endif
 
 
+namespace impl
+{
+	void AppendMetric( std::tstring& rText, const std::tstring& key, UINT64 value )
+	{
+		rText += str::Format( _T("%s=%I64u\n"), key.c_str(), value );
+	}
+
+	void AppendMetric( std::tstring& rText, const std::tstring& key, double value )
+	{
+		rText += str::Format( _T("%s=%.3f\n"), key.c_str(), value );
+	}
+
+	void AppendMetric( std::tstring& rText, const std::tstring& key, const std::tstring& value )
+	{
+		rText += key + _T("=") + value + _T("\n");
+	}
+
+	void AppendThroughput( std::tstring& rText, const std::tstring& keyPrefix, const fs::CHashThroughput& throughput )
+	{
+		AppendMetric( rText, keyPrefix + _T(".files"), static_cast<UINT64>( throughput.m_fileCount ) );
+		AppendMetric( rText, keyPrefix + _T(".bytes"), throughput.m_byteCount );
+		AppendMetric( rText, keyPrefix + _T(".seconds"), throughput.m_elapsedSeconds );
+		AppendMetric( rText, keyPrefix + _T(".bytesPerSecond"), static_cast<UINT64>( throughput.GetBytesPerSecond() ) );
+	}
+}
+
+
+// CDupsOutcome implementation
+
+std::tstring CDupsOutcome::FormatMetrics( void ) const
+{
+	std::tstring text;
+
+	impl::AppendMetric( text, _T("search.foundFiles"), static_cast<UINT64>( m_foundFileCount ) );
+	impl::AppendMetric( text, _T("search.foundSubDirs"), static_cast<UINT64>( m_foundSubDirCount ) );
+	impl::AppendMetric( text, _T("search.ignored"), static_cast<UINT64>( m_ignoredCount ) );
+	impl::AppendMetric( text, _T("search.hardLinks"), static_cast<UINT64>( m_hardLinkCount ) );
+	impl::AppendMetric( text, _T("search.unchangedFiles"), static_cast<UINT64>( m_unchangedFileCount ) );
+	impl::AppendMetric( text, _T("search.changedFiles"), static_cast<UINT64>( m_changedFileCount ) );
+	impl::AppendMetric( text, _T("search.spillRuns"), static_cast<UINT64>( m_spillRunCount ) );
+	impl::AppendMetric( text, _T("search.spillLostFiles"), static_cast<UINT64>( m_spillLostCount ) );
+	impl::AppendMetric( text, _T("search.seconds"), m_timer.ElapsedSeconds() );
+
+	impl::AppendMetric( text, _T("stage.enumerate.seconds"), m_enumSeconds );
+	impl::AppendMetric( text, _T("stage.groupBySize.seconds"), m_groupBySizeSeconds );
+	impl::AppendMetric( text, _T("stage.hardLinks.seconds"), m_hardLinkSeconds );
+	impl::AppendThroughput( text, _T("stage.crc32"), m_verifyStats.m_crc32 );
+	impl::AppendMetric( text, _T("stage.digest.algorithm"), fs::GetTags_HashAlgorithm().FormatKey( m_hashAlgorithm ) );
+	impl::AppendThroughput( text, _T("stage.digest"), m_verifyStats.m_digest );
+	impl::AppendThroughput( text, _T("stage.byteCompare"), m_verifyStats.m_byteCompare );
+
+	impl::AppendMetric( text, _T("crc32.cacheHits"), static_cast<UINT64>( m_verifyStats.m_crc32CacheHitCount ) );
+	impl::AppendMetric( text, _T("crc32.readFiles"), static_cast<UINT64>( m_verifyStats.m_crc32ReadCount ) );
+	impl::AppendMetric( text, _T("crc32.readBytes"), m_verifyStats.m_crc32ReadByteCount );
+
+	impl::AppendMetric( text, _T("io.hashedFiles"), static_cast<UINT64>( m_verifyStats.GetHashedFileCount() ) );
+	impl::AppendMetric( text, _T("io.readBytes"), m_verifyStats.GetReadByteCount() );
+
+	const CContentIoStats& ioStats = m_verifyStats.m_io;
+
+	for ( int bucket = 0; bucket != CContentIoStats::_SizeBucketCount; ++bucket )
+		impl::AppendThroughput( text, _T("io.size.") + CContentIoStats::GetTags_SizeBucket().FormatKey( bucket ), ioStats.m_sizeBuckets[ bucket ] );
+
+	for ( std::map<std::tstring, fs::CHashThroughput>::const_iterator itVolume = ioStats.m_volumes.begin(); itVolume != ioStats.m_volumes.end(); ++itVolume )
+		impl::AppendThroughput( text, _T("io.volume[") + itVolume->first + _T("]"), itVolume->second );
+
+	return text;
+}
+
+
 // CDuplicateFilesEnumerator implementation
 
 CDuplicateFilesEnumerator::CDuplicateFilesEnumerator( fs::TEnumFlags enumFlags, IEnumerator* pChainEnum /*= nullptr*/,
 													  utl::IProgressService* pProgressSvc /*= svc::CNoProgressService::Instance()*/ )
 	: fs::CBaseEnumerator( enumFlags, pChainEnum )
 	, m_pProgressSvc( pProgressSvc )
+	, m_pSession( nullptr )
+	, m_hashAlgorithm( fs::Crc32Only )
+	, m_byteCompare( false )
+	, m_spillThreshold( 0 )
 	, m_pGroupStore( nullptr )
 {
 	ASSERT_PTR( m_pProgressSvc );
@@ -33,14 +109,21 @@ void CDuplicateFilesEnumerator::SearchDuplicates( const std::vector<fs::TPattern
 {
 	Clear();
 
-	CDuplicateGroupStore m_groupStore;
+	CDuplicateGroupStore m_groupStore( m_hashAlgorithm, m_byteCompare );
+	m_groupStore.SetSpillThreshold( m_spillThreshold );
 	m_pGroupStore = &m_groupStore;
 
+	if ( m_pSession != nullptr )
+		m_pSession->BeginSearch();
+
 	{
 		utl::CSectionGuard section( _T("# SearchDuplicates") );
+		CTimer enumTimer;
 
 		for ( std::vector<fs::TPatternPath>::const_iterator itSearchPath = searchPaths.begin(); itSearchPath != searchPaths.end(); ++itSearchPath )
 			fs::SearchEnumFiles( this, *itSearchPath );
+
+		m_outcome.m_enumSeconds = enumTimer.ElapsedSeconds();
 	}
 
 	m_outcome.m_foundSubDirCount = m_subDirPaths.size();
@@ -49,8 +132,15 @@ void CDuplicateFilesEnumerator::SearchDuplicates( const std::vector<fs::TPattern
 	// lazy evaluate CRC32 checksums - real duplicates are within size-based duplicate groups
 	GroupByCrc32();
 
+	m_outcome.m_hashAlgorithm = m_groupStore.GetHashAlgorithm();
+	m_outcome.m_byteCompare = m_groupStore.UseByteCompare();
+	m_outcome.m_verifyStats = m_groupStore.GetStats();
+
 	func::SortDuplicateGroupItems( m_dupGroupItems );		// sort groups by original item path
 	m_pGroupStore = nullptr;
+
+	if ( m_pSession != nullptr )
+		m_pSession->CommitSearch( m_dupGroupItems );		// patch the session groups; passes ownership of the found groups
 }
 
 void CDuplicateFilesEnumerator::OnAddFileInfo( const fs::CFileState& fileState )
@@ -59,8 +149,29 @@ void CDuplicateFilesEnumerator::OnAddFileInfo( const fs::CFileState& fileState )
 
 	++m_outcome.m_foundFileCount;
 
-	// first stage: CRC32 is not yet computed, group found items by file size
-	m_pGroupStore->RegisterItem( new CDuplicateFileItem( fileState ) );	// generated groups are stored in the groups store
+	// first stage: CRC32 is not yet computed; found files are kept compact, and grouped by file size after enumeration
+	UINT crc32 = 0;
+
+	if ( m_pSession != nullptr )
+	{
+		if ( m_pSession->RegisterFoundFile( fileState, crc32 ) )
+			++m_outcome.m_unchangedFileCount;
+		else
+		{
+			crc32 = 0;
+			if ( m_pSession->GetIndexedFileCount() != 0 )
+				++m_outcome.m_changedFileCount;
+		}
+	}
+
+	if ( crc32 != 0 )
+	{
+		fs::CFileState knownState = fileState;
+		knownState.StoreCrc32( crc32 );				// reuse the previous checksum (stored after grouping by file size)
+		m_pGroupStore->RegisterFile( knownState );
+	}
+	else
+		m_pGroupStore->RegisterFile( fileState );
 
 	__super::OnAddFileInfo( fileState );
 }
@@ -70,8 +181,36 @@ void CDuplicateFilesEnumerator::AddFoundFile( const fs::CPath& filePath )
 	__super::AddFoundFile( filePath );		// base method is pure but implemented
 }
 
+bool CDuplicateFilesEnumerator::CanIncludeNode( const fs::CFileState& nodeState ) const
+{
+	if ( m_spillThreshold != 0 && !nodeState.IsDirectory() )
+		return PassFileFilter( nodeState );			// enormous scans: don't keep all file paths in memory, repeated files are discarded when grouping by size
+
+	return __super::CanIncludeNode( nodeState );
+}
+
 void CDuplicateFilesEnumerator::GroupByCrc32( void )
 {
+	CTimer stageTimer;
+	utl::IProgressService* pBatchProgressSvc = nullptr;
+
+	if ( m_spillThreshold != 0 )
+	{	// enormous scans: bounded candidates, by extracting the CRC32 duplicates in batches while grouping by size
+		ProgSection_GroupByCrc32();
+		pBatchProgressSvc = m_pProgressSvc;
+	}
+
+	m_pGroupStore->GroupBySize( pBatchProgressSvc );		// materialize the items of the duplicate candidates only
+	m_outcome.m_spillRunCount = m_pGroupStore->GetSpillRunCount();
+	m_outcome.m_spillLostCount = m_pGroupStore->GetSpillLostCount();
+	m_outcome.m_foundFileCount -= m_pGroupStore->GetRepeatedFileCount();
+	m_outcome.m_groupBySizeSeconds = stageTimer.ElapsedSeconds();		// including the CRC32 batches, if any
+
+	stageTimer.Restart();
+	m_pGroupStore->DiscardHardLinks();					// before sizing the progress
+	m_outcome.m_hardLinkCount = m_pGroupStore->GetHardLinkCount();		// including the CRC32 batches
+	m_outcome.m_hardLinkSeconds = stageTimer.ElapsedSeconds();
+
 	ProgSection_GroupByCrc32();
 
 	utl::CSectionGuard section( _T("# ExtractDuplicateGroups (CRC32)") );
@@ -98,3 +237,76 @@ void CDuplicateFilesEnumerator::ProgSection_GroupByCrc32( void ) const
 	m_pProgressSvc->SetProgressStep( 1 );						// fine granularity: advance progress on each step since individual computations are slow
 	m_pProgressSvc->SetProgressState( PBST_PAUSED );			// yellow bar
 }
+
+
+// CDuplicateFilesSession implementation
+
+void CDuplicateFilesSession::Reset( void )
+{
+	utl::ClearOwningContainer( m_dupGroups );
+	m_fileIndex.clear();
+	m_foundIndex.clear();
+}
+
+bool CDuplicateFilesSession::RegisterFoundFile( const fs::CFileState& fileState, OUT UINT& rCrc32 )
+{
+	CFileStamp& rFoundStamp = m_foundIndex[ fileState.m_fullPath ] = CFileStamp( fileState );
+	TFileIndex::const_iterator itIndexed = m_fileIndex.find( fileState.m_fullPath );
+
+	if ( itIndexed == m_fileIndex.end() || !itIndexed->second.IsUnchanged( fileState ) )
+	{
+		rCrc32 = 0;
+		return false;					// new or modified file
+	}
+
+	rFoundStamp.m_crc32 = rCrc32 = itIndexed->second.m_crc32;
+	return true;
+}
+
+void CDuplicateFilesSession::CommitSearch( std::vector<CDuplicateFilesGroup*>& rFoundGroups )
+{
+	utl::COwningContainer< std::vector<CDuplicateFilesGroup*> > foundGroups, prevGroups;
+	foundGroups.swap( rFoundGroups );		// take ownership
+	prevGroups.swap( m_dupGroups );
+
+	std::unordered_map<fs::CFileContentKey, size_t> prevGroupsMap;		// content key -> prevGroups index
+
+	for ( size_t pos = 0; pos != prevGroups.size(); ++pos )
+		prevGroupsMap[ prevGroups[ pos ]->GetContentKey() ] = pos;
+
+	std::vector<CDuplicateFilesGroup*> dupGroups;
+	dupGroups.reserve( foundGroups.size() );
+
+	for ( std::vector<CDuplicateFilesGroup*>::iterator itFoundGroup = foundGroups.begin(); itFoundGroup != foundGroups.end(); ++itFoundGroup )
+	{
+		std::unordered_map<fs::CFileContentKey, size_t>::const_iterator itPrev = prevGroupsMap.find( ( *itFoundGroup )->GetContentKey() );
+
+		if ( itPrev != prevGroupsMap.end() )
+		{	// patch the existing group, so that it keeps its original item
+			CDuplicateFilesGroup* pPrevGroup = utl::ReleaseOwnership( prevGroups[ itPrev->second ] );
+			prevGroupsMap.erase( itPrev );		// content verification may split a group into multiple groups with the same key
+
+			pPrevGroup->MergeFoundGroup( *itFoundGroup );
+			dupGroups.push_back( pPrevGroup );
+		}
+		else
+			dupGroups.push_back( utl::ReleaseOwnership( *itFoundGroup ) );		// new group
+	}
+	// remaining previous groups (no longer duplicates) and merged found groups are deleted when going out of scope
+
+	func::SortDuplicateGroupItems( dupGroups );
+	m_dupGroups.swap( dupGroups );
+
+	// store the checksums of the duplicates: the CRC32 of unique candidates is still cached by fs::CCrc32FileCache
+	for ( std::vector<CDuplicateFilesGroup*>::const_iterator itGroup = m_dupGroups.begin(); itGroup != m_dupGroups.end(); ++itGroup )
+		for ( std::vector<CDuplicateFileItem*>::const_iterator itItem = ( *itGroup )->GetItems().begin(); itItem != ( *itGroup )->GetItems().end(); ++itItem )
+		{
+			TFileIndex::iterator itFound = m_foundIndex.find( ( *itItem )->GetFilePath() );
+
+			if ( itFound != m_foundIndex.end() )
+				itFound->second.m_crc32 = ( *itGroup )->GetContentKey().m_crc32;
+		}
+
+	m_fileIndex.swap( m_foundIndex );		// files not found anymore are dropped from the index
+	m_foundIndex.clear();
+}
@@ -8,14 +8,41 @@
 #include "Timer.h"
 
 
+class CDuplicateFilesSession;
+
+
 struct CDupsOutcome
 {
-	CDupsOutcome( void ) : m_foundSubDirCount( 0 ), m_foundFileCount( 0 ), m_ignoredCount( 0 ) {}
+	CDupsOutcome( void ) : m_foundSubDirCount( 0 ), m_foundFileCount( 0 ), m_ignoredCount( 0 ), m_hardLinkCount( 0 ), m_unchangedFileCount( 0 ), m_changedFileCount( 0 ), m_hashAlgorithm( fs::Crc32Only ), m_byteCompare( false ), m_spillRunCount( 0 ), m_spillLostCount( 0 )
+		, m_enumSeconds( 0.0 ), m_groupBySizeSeconds( 0.0 ), m_hardLinkSeconds( 0.0 ) {}
+
+	bool IsIncremental( void ) const { return m_unchangedFileCount != 0 || m_changedFileCount != 0; }
+
+	// machine-readable report for benchmarking runs: a "key=value" line for each metric
+	std::tstring FormatMetrics( void ) const;
 public:
 	CTimer m_timer;
 	size_t m_foundSubDirCount;
 	size_t m_foundFileCount;
 	size_t m_ignoredCount;
+	size_t m_hardLinkCount;				// hard links of other found files: not hashed, not reported as duplicates
+
+	// incremental search (with a session that has previous results)
+	size_t m_unchangedFileCount;		// same size and modify time as in the previous search: the previous CRC32 is reused
+	size_t m_changedFileCount;			// new or modified since the previous search
+
+	// content verification
+	fs::HashAlgorithm m_hashAlgorithm;
+	bool m_byteCompare;
+	CContentVerifyStats m_verifyStats;
+
+	size_t m_spillRunCount;				// count of size-sorted runs spilled to temporary files when grouping by size
+	size_t m_spillLostCount;			// files not searched for duplicates: failed to read back their spilled run
+
+	// elapsed time of the stages before content verification (the content stages are timed in m_verifyStats)
+	double m_enumSeconds;
+	double m_groupBySizeSeconds;
+	double m_hardLinkSeconds;
 };
 
 
@@ -30,6 +57,17 @@ public:
 
 	const CDupsOutcome& GetOutcome( void ) const { return m_outcome; }
 
+	CDuplicateFilesSession* GetSession( void ) const { return m_pSession; }
+	void SetSession( CDuplicateFilesSession* pSession ) { REQUIRE( IsEmpty() ); m_pSession = pSession; }
+
+	// verify the CRC32 duplicates by a strong hash, and/or byte-by-byte (skipped for cryptographic hashes)
+	void SetVerification( fs::HashAlgorithm hashAlgorithm, bool byteCompare ) { m_hashAlgorithm = hashAlgorithm; m_byteCompare = byteCompare; }
+
+	// enormous scans: above this count of found files, spill size-sorted runs to temporary files (0 for no spilling);
+	// also bounds the candidates hashed in a batch, and the found file paths are no longer kept unique (repeated files are discarded when grouping).
+	// Note: a session still indexes every found file path, by design of the incremental search.
+	void SetSpillThreshold( size_t maxMemoryFileCount ) { m_spillThreshold = maxMemoryFileCount; }
+
 	// base overrides
 	virtual void Clear( void );
 	virtual size_t GetFileCount( void ) const { return m_outcome.m_foundFileCount; }
@@ -37,18 +75,68 @@ protected:
 	// IEnumerator interface overrides
 	virtual void OnAddFileInfo( const fs::CFileState& fileState );
 	virtual void AddFoundFile( const fs::CPath& filePath );
+	virtual bool CanIncludeNode( const fs::CFileState& nodeState ) const;
 private:
 	void GroupByCrc32( void );
 
 	void ProgSection_GroupByCrc32( void ) const;
 private:
 	utl::IProgressService* m_pProgressSvc;
+	CDuplicateFilesSession* m_pSession;		// optional: incremental search
+	fs::HashAlgorithm m_hashAlgorithm;
+	bool m_byteCompare;
+	size_t m_spillThreshold;
 	CDupsOutcome m_outcome;
 
 	// transient during search
 	CDuplicateGroupStore* m_pGroupStore;
 public:
-	std::vector<CDuplicateFilesGroup*> m_dupGroupItems;		// results: groups sorted by path, each group's duplicate items sorted by path
+	std::vector<CDuplicateFilesGroup*> m_dupGroupItems;		// results: groups sorted by path, each group's duplicate items sorted by path (empty when using a session)
+};
+
+
+// Keeps the results of the previous search and the file-state index of the found files, so that a re-search is incremental:
+//	- files with the same size and modify time reuse the previous CRC32 checksum; only new or modified files are re-hashed;
+//	- the existing duplicate groups are patched in place: vanished items are dropped, new items are added, the original item is kept.
+// Since the groups are patched against the found files, it is not tied to the search criteria.
+//
+class CDuplicateFilesSession : private utl::noncopyable
+{
+public:
+	CDuplicateFilesSession( void ) {}
+	~CDuplicateFilesSession() { Reset(); }
+
+	bool IsEmpty( void ) const { return m_dupGroups.empty() && m_fileIndex.empty(); }
+	void Reset( void );					// discard the previous results
+	void ClearFileIndex( void ) { m_fileIndex.clear(); }		// force re-hashing of all files on the next search
+
+	const std::vector<CDuplicateFilesGroup*>& GetDuplicateGroups( void ) const { return m_dupGroups; }
+	size_t GetIndexedFileCount( void ) const { return m_fileIndex.size(); }
+private:
+	// called by CDuplicateFilesEnumerator
+	friend class CDuplicateFilesEnumerator;
+
+	void BeginSearch( void ) { m_foundIndex.clear(); }
+	bool RegisterFoundFile( const fs::CFileState& fileState, OUT UINT& rCrc32 );	// returns true if indexed with the same size and modify time
+	void CommitSearch( std::vector<CDuplicateFilesGroup*>& rFoundGroups );			// takes ownership of the found groups
+private:
+	struct CFileStamp
+	{
+		CFileStamp( void ) : m_fileSize( 0 ), m_crc32( 0 ) {}
+		CFileStamp( const fs::CFileState& fileState ) : m_fileSize( fileState.m_fileSize ), m_modifTime( fileState.m_modifTime ), m_crc32( 0 ) {}
+
+		bool IsUnchanged( const fs::CFileState& fileState ) const { return m_fileSize == fileState.m_fileSize && m_modifTime == fileState.m_modifTime; }
+	public:
+		UINT64 m_fileSize;
+		CTime m_modifTime;
+		UINT m_crc32;				// 0 if not evaluated
+	};
+
+	typedef std::unordered_map<fs::CPath, CFileStamp> TFileIndex;
+
+	TFileIndex m_fileIndex;							// files found by the previous search
+	TFileIndex m_foundIndex;						// transient during search: files found so far
+	std::vector<CDuplicateFilesGroup*> m_dupGroups;	// results with ownership: groups sorted by path, each group's duplicate items sorted by path
 };
 
 
@@ -38,6 +38,7 @@ namespace io
 	// Intended to be used directly via the io template functions (not via a stream, unformatted).
 	// CharT has to match the byte count of the encoding, to ensure no UTF character conversion is involved (or necessary) during input/output.
 	// The file content is handled as is (eventually byte swapped for BigEndian encodings).
+	// Reading and writing go through chunks decoded/encoded by the codec in bulk, rather than a codec call per character.
 	//
 	template< typename CharT >
 	class CEncodedFileBuffer
@@ -48,12 +49,13 @@ namespace io
 		typedef typename TBaseFileBuf::traits_type TTraits;
 		typedef typename TBaseFileBuf::off_type off_type;
 
-		enum { BinaryBufferSize = 512 };
+		enum { BinaryBufferSize = 4096, ChunkSize = 4096 };
 
 		using TBaseFileBuf::open;		// hidden
 	public:
 		CEncodedFileBuffer( fs::Encoding encoding )
 			: CBaseEncodedBuffer( encoding )
+			, m_inPos( 0 )
 			, m_lastCh( 0 )
 		{
 			// Design assumption: the file buffer CharT has to match the byte count of the encoding.
@@ -101,13 +103,12 @@ namespace io
 			m_filePath.Clear();
 			m_openMode = 0;
 			m_lastCh = 0;
-			m_itChar = std::istreambuf_iterator<CharT>();
+			ResetInChunk();
 		}
 
 		virtual void Rewind( void ) throws_( CRuntimeException )
 		{
-			SeekInput( m_bom.GetScaledSize<CharT>() );					// skip the BOM - equivalent to std::advance( m_itChar, m_bom.GetScaledSize<CharT>() )
-			m_itChar = std::istreambuf_iterator<CharT>( this );		// use iterator only for reading
+			SeekInput( m_bom.GetScaledSize<CharT>() );					// skip the BOM
 		}
 
 		TCharSize SeekInput( TCharSize charOffset ) throws_( CRuntimeException )
@@ -119,6 +120,7 @@ namespace io
 				throw CRuntimeException( str::Format( _T("Error seeking read position to byte offset %d in text file %s"), byteOffset, m_filePath.GetPtr() ) );
 
 			ENSURE( (size_t)byteOffset == charOffset * sizeof(CharT) );
+			ResetInChunk();												// discard the decoded read-ahead
 			return static_cast<TCharSize>( byteOffset ) / sizeof(CharT);		// convert back to character offset
 		}
 
@@ -138,11 +140,23 @@ namespace io
 		}
 
 		void Append( const CharT* pText, size_t count = utl::npos ) throws_( CRuntimeException )
-		{	// append a sequence of characters
+		{	// append a sequence of characters, up to the EOS; encodes in bulk the spans between line-ends
 			ASSERT_PTR( pText );
 
-			while ( *pText != 0 && count-- != 0 )
-				Put( *pText++ );
+			const CharT* pEnd = utl::npos == count ? ( pText + str::GetLength( pText ) ) : std::find( pText, pText + count, CharT( 0 ) );
+
+			while ( pText != pEnd )
+			{
+				const CharT* pLineEnd = IsBinary() ? std::find( pText, pEnd, CharT( '\n' ) ) : pEnd;		// only binary mode needs line-end translation
+
+				PutSpan( pText, pLineEnd );
+
+				if ( pLineEnd == pEnd )
+					break;
+
+				Put( *pLineEnd );
+				pText = pLineEnd + 1;
+			}
 		}
 
 		void AppendString( const std::basic_string<CharT>& text ) { Append( text.c_str(), text.length() ); }
@@ -156,8 +170,8 @@ namespace io
 
 			CharT chr = 0;
 
-			if ( m_itChar != m_itEnd )
-				chr = m_pCodec->Decode( *m_itChar++ );
+			if ( HasInput() )
+				chr = m_inChunk[ m_inPos++ ];
 			else
 				ASSERT( false );		// at end?
 
@@ -171,7 +185,7 @@ namespace io
 
 			for ( ;; )
 			{
-				if ( m_itChar == m_itEnd )
+				if ( !HasInput() )
 				{	// reached EOF
 					if ( !rText.empty() )
 						return true;			// read at least a character
@@ -181,12 +195,24 @@ namespace io
 					return false;				// EOF, no content
 				}
 
-				CharT chr = GetNext();
+				// scan the decoded chunk for the delimiter, and append the span before it
+				const CharT* pStart = &m_inChunk[ m_inPos ];
+				const CharT* pEnd = pStart + ( m_inChunk.size() - m_inPos );
+				const CharT* pDelim = std::find( pStart, pEnd, delim );
 
-				if ( chr == delim )
+				// ignore '\r' to simulate text-mode behavior: translate output "\r\n" sequence -> "\n"
+				std::remove_copy( pStart, pDelim, std::back_inserter( rText ), CharT( '\r' ) );
+
+				if ( pDelim != pEnd )
+				{
+					m_inPos += std::distance( pStart, pDelim ) + 1;
+					m_lastCh = delim;
 					return true;				// cut before the delimiter; current position after it
-				else if ( chr != '\r' )			// ignore '\r' to simulate text-mode behavior: translate output "\r\n" sequence -> "\n"
-					rText.push_back( chr );
+				}
+
+				m_inPos = m_inChunk.size();
+				if ( pDelim != pStart )
+					m_lastCh = pDelim[ -1 ];
 			}
 		}
 
@@ -212,10 +238,60 @@ namespace io
 			if ( TTraits::eq_int_type( TTraits::eof(), __super::sputc( m_pCodec->Encode( chr ) ) ) )
 				throw CRuntimeException( str::Format( _T("Error writing character '%c' to text file %s"), chr, m_filePath.GetPtr() ) );
 		}
+
+		void PutSpan( const CharT* pText, const CharT* pEnd ) throws_( CRuntimeException )
+		{	// put a span with no line-ends to translate: encoded in chunks
+			ASSERT( IsOutput() );
+
+			while ( pText != pEnd )
+			{
+				std::streamsize count = std::min<std::streamsize>( std::distance( pText, pEnd ), ChunkSize );
+				const CharT* pRawChunk = pText;
+
+				if ( !m_pCodec->IsIdentity() )
+				{
+					m_outChunk.resize( ChunkSize );
+					m_pCodec->EncodeSpan( &m_outChunk.front(), pText, static_cast<size_t>( count ) );
+					pRawChunk = &m_outChunk.front();
+				}
+
+				if ( __super::sputn( pRawChunk, count ) != count )
+					throw CRuntimeException( str::Format( _T("Error writing %d characters to text file %s"), static_cast<int>( count ), m_filePath.GetPtr() ) );
+
+				pText += count;
+				m_lastCh = pText[ -1 ];
+			}
+		}
+
+		bool HasInput( void )
+		{	// decode the next chunk if the current one is consumed; returns false at EOF
+			ASSERT( IsInput() );
+
+			if ( m_inPos == m_inChunk.size() )
+			{
+				m_inChunk.resize( ChunkSize );
+				std::streamsize count = this->sgetn( &m_inChunk.front(), ChunkSize );
+
+				m_inChunk.resize( static_cast<size_t>( std::max<std::streamsize>( count, 0 ) ) );
+				m_inPos = 0;
+
+				if ( !m_inChunk.empty() )
+					m_pCodec->DecodeSpan( &m_inChunk.front(), &m_inChunk.front(), m_inChunk.size() );
+			}
+			return m_inPos != m_inChunk.size();
+		}
+
+		void ResetInChunk( void )
+		{
+			m_inChunk.clear();
+			m_inPos = 0;
+		}
 	private:
 		std::vector<CharT> m_buffer;							// set to override the locale-specific conversion in the base
 
-		std::istreambuf_iterator<CharT> m_itChar, m_itEnd;	// read-mode iterators
+		std::vector<CharT> m_inChunk;							// decoded read-ahead chunk
+		size_t m_inPos;											// read position in m_inChunk
+		std::vector<CharT> m_outChunk;							// encoded write chunk (for non-identity codecs)
 		CharT m_lastCh;
 	};
 
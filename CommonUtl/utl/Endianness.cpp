@@ -0,0 +1,131 @@
+
+#include "pch.h"
+#include "Endianness.h"
+
+#if defined( _M_IX86 ) || defined( _M_X64 )
+	#define USE_SWAP_SIMD
+	#include <intrin.h>
+	#include <emmintrin.h>
+#endif
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+
+namespace endian
+{
+	namespace impl
+	{
+		bool DetectSimdSwapBytes( void )
+		{
+		#if defined( _M_X64 )
+			return true;								// SSE2 is part of the x64 baseline
+		#elif defined( USE_SWAP_SIMD )
+			enum { Sse2Bit = 1 << 26 };
+			int cpuInfo[ 4 ];		// EAX, EBX, ECX, EDX
+
+			__cpuid( cpuInfo, 1 );
+			return HasFlag( cpuInfo[ 3 ], Sse2Bit );
+		#else
+			return false;
+		#endif
+		}
+
+		bool& RefUseSimd( void )
+		{
+			static bool s_useSimd = HasSimdSwapBytes();
+			return s_useSimd;
+		}
+
+
+		template< typename CodeUnitT >
+		inline void SwapBytesScalar( CodeUnitT* pDest, const CodeUnitT* pSrc, size_t count )
+		{
+			for ( size_t i = 0; i != count; ++i )
+				pDest[ i ] = ToBytesSwapped<sizeof( CodeUnitT )>()( pSrc[ i ] );
+		}
+
+
+	#ifdef USE_SWAP_SIMD
+		enum { VecSize = sizeof( __m128i ) };
+
+		inline __m128i SwapBytes16( __m128i units )
+		{	// swap the bytes of each 16-bit unit
+			return _mm_or_si128( _mm_slli_epi16( units, 8 ), _mm_srli_epi16( units, 8 ) );
+		}
+
+		inline __m128i SwapBytes32( __m128i units )
+		{	// swap the bytes of each 16-bit half, then swap the halves of each 32-bit unit
+			units = SwapBytes16( units );
+			return _mm_shufflehi_epi16( _mm_shufflelo_epi16( units, _MM_SHUFFLE( 2, 3, 0, 1 ) ), _MM_SHUFFLE( 2, 3, 0, 1 ) );
+		}
+
+		template< typename CodeUnitT, __m128i (*SwapVec)( __m128i ) >
+		size_t SwapBytesVectors( CodeUnitT* pDest, const CodeUnitT* pSrc, size_t count )
+		{	// returns the count of swapped units; the caller swaps the tail
+			enum { UnitsPerVec = VecSize / sizeof( CodeUnitT ) };
+
+			size_t pos = 0;
+
+			for ( ; pos + 2 * UnitsPerVec <= count; pos += 2 * UnitsPerVec )
+			{	// 2 vectors per iteration: loads are issued before stores, which is safe in-place
+				__m128i first = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pSrc + pos ) );
+				__m128i second = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pSrc + pos + UnitsPerVec ) );
+
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + pos ), SwapVec( first ) );
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + pos + UnitsPerVec ), SwapVec( second ) );
+			}
+
+			for ( ; pos + UnitsPerVec <= count; pos += UnitsPerVec )
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + pos ), SwapVec( _mm_loadu_si128( reinterpret_cast<const __m128i*>( pSrc + pos ) ) ) );
+
+			return pos;
+		}
+	#endif
+
+		template< typename CodeUnitT >
+		inline bool IsValidSpan( const CodeUnitT* pDest, const CodeUnitT* pSrc, size_t count )
+		{
+			return pDest == pSrc || pDest + count <= pSrc || pSrc + count <= pDest;		// in-place or not overlapping
+		}
+	}
+
+
+	bool HasSimdSwapBytes( void )
+	{
+		static const bool s_hasSimd = impl::DetectSimdSwapBytes();
+		return s_hasSimd;
+	}
+
+	bool EnableSimdSwapBytes( bool enable )
+	{
+		bool oldEnabled = impl::RefUseSimd();
+		impl::RefUseSimd() = enable && HasSimdSwapBytes();
+		return oldEnabled;
+	}
+
+	void SwapBytesSpan( wchar_t* pDest, const wchar_t* pSrc, size_t count )
+	{
+		ASSERT( impl::IsValidSpan( pDest, pSrc, count ) );
+		size_t vecCount = 0;
+
+	#ifdef USE_SWAP_SIMD
+		if ( impl::RefUseSimd() )
+			vecCount = impl::SwapBytesVectors<wchar_t, impl::SwapBytes16>( pDest, pSrc, count );
+	#endif
+		impl::SwapBytesScalar( pDest + vecCount, pSrc + vecCount, count - vecCount );
+	}
+
+	void SwapBytesSpan( char32_t* pDest, const char32_t* pSrc, size_t count )
+	{
+		ASSERT( impl::IsValidSpan( pDest, pSrc, count ) );
+		size_t vecCount = 0;
+
+	#ifdef USE_SWAP_SIMD
+		if ( impl::RefUseSimd() )
+			vecCount = impl::SwapBytesVectors<char32_t, impl::SwapBytes32>( pDest, pSrc, count );
+	#endif
+		impl::SwapBytesScalar( pDest + vecCount, pSrc + vecCount, count - vecCount );
+	}
+}
@@ -149,6 +149,16 @@ namespace endian
 		std::for_each( rText.begin(), rText.end(), func::SwapBytes<from, to>() );
 	}
 
+
+	// bulk byte-swapping of UTF16/UTF32 code units: vectorized with SSE2 when available, scalar for the tail.
+	// pDest may be the same as pSrc (in-place swapping); the buffers need no particular alignment.
+
+	void SwapBytesSpan( wchar_t* pDest, const wchar_t* pSrc, size_t count );
+	void SwapBytesSpan( char32_t* pDest, const char32_t* pSrc, size_t count );
+
+	bool HasSimdSwapBytes( void );				// SSE2 supported by the CPU, detected once at runtime
+	bool EnableSimdSwapBytes( bool enable );	// returns the old state (for testing and benchmarks)
+
 } //namespace endian
 
 
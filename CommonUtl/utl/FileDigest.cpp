@@ -0,0 +1,451 @@
+
+#include "pch.h"
+#include "FileDigest.h"
+#include "AppTools.h"
+#include "EnumTags.h"
+#include "IoBin.h"
+#include "StdHashValue.h"
+#include "StringUtilities.h"
+#include "Timer.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+
+namespace utl
+{
+	namespace impl
+	{
+		inline UINT64 RotateLeft64( UINT64 value, int bits ) { return ( value << bits ) | ( value >> ( 64 - bits ) ); }
+		inline UINT RotateRight32( UINT value, int bits ) { return ( value >> bits ) | ( value << ( 32 - bits ) ); }
+
+		inline UINT64 ReadLittleEndian64( const BYTE* pBytes )
+		{
+			UINT64 value = 0;
+			for ( int i = 8; i-- != 0; )
+				value = ( value << 8 ) | pBytes[ i ];
+			return value;
+		}
+
+		inline UINT ReadLittleEndian32( const BYTE* pBytes )
+		{
+			return pBytes[ 0 ] | ( pBytes[ 1 ] << 8 ) | ( pBytes[ 2 ] << 16 ) | ( static_cast<UINT>( pBytes[ 3 ] ) << 24 );
+		}
+
+		inline UINT ReadBigEndian32( const BYTE* pBytes )
+		{
+			return ( static_cast<UINT>( pBytes[ 0 ] ) << 24 ) | ( pBytes[ 1 ] << 16 ) | ( pBytes[ 2 ] << 8 ) | pBytes[ 3 ];
+		}
+
+
+		// XXH64 constants and rounds
+
+		const UINT64 s_xxPrime1 = 0x9E3779B185EBCA87ull;
+		const UINT64 s_xxPrime2 = 0xC2B2AE3D27D4EB4Full;
+		const UINT64 s_xxPrime3 = 0x165667B19E3779F9ull;
+		const UINT64 s_xxPrime4 = 0x85EBCA77C2B2AE63ull;
+		const UINT64 s_xxPrime5 = 0x27D4EB2F165667C5ull;
+
+		inline UINT64 XxRound( UINT64 acc, UINT64 input )
+		{
+			acc += input * s_xxPrime2;
+			return RotateLeft64( acc, 31 ) * s_xxPrime1;
+		}
+
+		inline UINT64 XxMergeRound( UINT64 acc, UINT64 value )
+		{
+			acc ^= XxRound( 0, value );
+			return acc * s_xxPrime1 + s_xxPrime4;
+		}
+	}
+
+
+	// CXxHash64 implementation
+
+	CXxHash64::CXxHash64( UINT64 seed /*= 0*/ )
+		: m_seed( seed )
+		, m_totalLength( 0 )
+		, m_pendingCount( 0 )
+	{
+		m_acc[ 0 ] = seed + impl::s_xxPrime1 + impl::s_xxPrime2;
+		m_acc[ 1 ] = seed + impl::s_xxPrime2;
+		m_acc[ 2 ] = seed;
+		m_acc[ 3 ] = seed - impl::s_xxPrime1;
+	}
+
+	void CXxHash64::ProcessStripe( const BYTE* pStripe )
+	{
+		for ( int lane = 0; lane != 4; ++lane )
+			m_acc[ lane ] = impl::XxRound( m_acc[ lane ], impl::ReadLittleEndian64( pStripe + lane * 8 ) );
+	}
+
+	void CXxHash64::ProcessBytes( const void* pBuffer, size_t count )
+	{
+		ASSERT( 0 == count || pBuffer != nullptr );
+
+		const BYTE* pBytes = static_cast<const BYTE*>( pBuffer );
+		m_totalLength += count;
+
+		if ( m_pendingCount != 0 )
+		{	// complete the pending stripe
+			size_t fillCount = std::min<size_t>( StripeSize - m_pendingCount, count );
+
+			memcpy( m_pending + m_pendingCount, pBytes, fillCount );
+			m_pendingCount += fillCount;
+			pBytes += fillCount;
+			count -= fillCount;
+
+			if ( m_pendingCount != StripeSize )
+				return;
+
+			ProcessStripe( m_pending );
+			m_pendingCount = 0;
+		}
+
+		for ( ; count >= StripeSize; pBytes += StripeSize, count -= StripeSize )
+			ProcessStripe( pBytes );
+
+		memcpy( m_pending, pBytes, count );
+		m_pendingCount = count;
+	}
+
+	UINT64 CXxHash64::GetResult( void ) const
+	{
+		UINT64 hash;
+
+		if ( m_totalLength >= StripeSize )
+		{
+			hash = impl::RotateLeft64( m_acc[ 0 ], 1 ) + impl::RotateLeft64( m_acc[ 1 ], 7 ) + impl::RotateLeft64( m_acc[ 2 ], 12 ) + impl::RotateLeft64( m_acc[ 3 ], 18 );
+
+			for ( int lane = 0; lane != 4; ++lane )
+				hash = impl::XxMergeRound( hash, m_acc[ lane ] );
+		}
+		else
+			hash = m_seed + impl::s_xxPrime5;
+
+		hash += m_totalLength;
+
+		const BYTE* pBytes = m_pending;
+		size_t count = m_pendingCount;
+
+		for ( ; count >= 8; pBytes += 8, count -= 8 )
+		{
+			hash ^= impl::XxRound( 0, impl::ReadLittleEndian64( pBytes ) );
+			hash = impl::RotateLeft64( hash, 27 ) * impl::s_xxPrime1 + impl::s_xxPrime4;
+		}
+
+		if ( count >= 4 )
+		{
+			hash ^= impl::ReadLittleEndian32( pBytes ) * impl::s_xxPrime1;
+			hash = impl::RotateLeft64( hash, 23 ) * impl::s_xxPrime2 + impl::s_xxPrime3;
+			pBytes += 4;
+			count -= 4;
+		}
+
+		for ( ; count != 0; ++pBytes, --count )
+		{
+			hash ^= *pBytes * impl::s_xxPrime5;
+			hash = impl::RotateLeft64( hash, 11 ) * impl::s_xxPrime1;
+		}
+
+		// final avalanche
+		hash ^= hash >> 33;
+		hash *= impl::s_xxPrime2;
+		hash ^= hash >> 29;
+		hash *= impl::s_xxPrime3;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
+
+	// CSha256 implementation
+
+	namespace impl
+	{
+		const UINT s_sha256RoundConstants[ 64 ] =
+		{
+			0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+			0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+			0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+			0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+			0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+			0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+			0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+			0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+		};
+	}
+
+	CSha256::CSha256( void )
+		: m_totalLength( 0 )
+		, m_pendingCount( 0 )
+	{
+		static const UINT s_initialState[ 8 ] = { 0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19 };
+		memcpy( m_state, s_initialState, sizeof( m_state ) );
+	}
+
+	void CSha256::ProcessBlock( const BYTE* pBlock )
+	{
+		UINT w[ 64 ];
+
+		for ( int i = 0; i != 16; ++i )
+			w[ i ] = impl::ReadBigEndian32( pBlock + i * 4 );
+
+		for ( int i = 16; i != 64; ++i )
+		{
+			UINT s0 = impl::RotateRight32( w[ i - 15 ], 7 ) ^ impl::RotateRight32( w[ i - 15 ], 18 ) ^ ( w[ i - 15 ] >> 3 );
+			UINT s1 = impl::RotateRight32( w[ i - 2 ], 17 ) ^ impl::RotateRight32( w[ i - 2 ], 19 ) ^ ( w[ i - 2 ] >> 10 );
+			w[ i ] = w[ i - 16 ] + s0 + w[ i - 7 ] + s1;
+		}
+
+		UINT a = m_state[ 0 ], b = m_state[ 1 ], c = m_state[ 2 ], d = m_state[ 3 ], e = m_state[ 4 ], f = m_state[ 5 ], g = m_state[ 6 ], h = m_state[ 7 ];
+
+		for ( int i = 0; i != 64; ++i )
+		{
+			UINT s1 = impl::RotateRight32( e, 6 ) ^ impl::RotateRight32( e, 11 ) ^ impl::RotateRight32( e, 25 );
+			UINT choose = ( e & f ) ^ ( ~e & g );
+			UINT temp1 = h + s1 + choose + impl::s_sha256RoundConstants[ i ] + w[ i ];
+			UINT s0 = impl::RotateRight32( a, 2 ) ^ impl::RotateRight32( a, 13 ) ^ impl::RotateRight32( a, 22 );
+			UINT majority = ( a & b ) ^ ( a & c ) ^ ( b & c );
+			UINT temp2 = s0 + majority;
+
+			h = g;
+			g = f;
+			f = e;
+			e = d + temp1;
+			d = c;
+			c = b;
+			b = a;
+			a = temp1 + temp2;
+		}
+
+		m_state[ 0 ] += a;
+		m_state[ 1 ] += b;
+		m_state[ 2 ] += c;
+		m_state[ 3 ] += d;
+		m_state[ 4 ] += e;
+		m_state[ 5 ] += f;
+		m_state[ 6 ] += g;
+		m_state[ 7 ] += h;
+	}
+
+	void CSha256::ProcessBytes( const void* pBuffer, size_t count )
+	{
+		ASSERT( 0 == count || pBuffer != nullptr );
+
+		const BYTE* pBytes = static_cast<const BYTE*>( pBuffer );
+		m_totalLength += count;
+
+		if ( m_pendingCount != 0 )
+		{	// complete the pending block
+			size_t fillCount = std::min<size_t>( BlockSize - m_pendingCount, count );
+
+			memcpy( m_pending + m_pendingCount, pBytes, fillCount );
+			m_pendingCount += fillCount;
+			pBytes += fillCount;
+			count -= fillCount;
+
+			if ( m_pendingCount != BlockSize )
+				return;
+
+			ProcessBlock( m_pending );
+			m_pendingCount = 0;
+		}
+
+		for ( ; count >= BlockSize; pBytes += BlockSize, count -= BlockSize )
+			ProcessBlock( pBytes );
+
+		memcpy( m_pending, pBytes, count );
+		m_pendingCount = count;
+	}
+
+	void CSha256::GetResult( OUT BYTE digest[ DigestSize ] ) const
+	{
+		CSha256 finalHash( *this );				// padding is applied to a copy, so that the hashing can continue
+		UINT64 bitLength = m_totalLength * 8;
+		BYTE padding[ BlockSize + 8 ] = { 0x80 };
+		size_t paddingCount = ( m_pendingCount < BlockSize - 8 ? BlockSize - 8 : 2 * BlockSize - 8 ) - m_pendingCount;
+
+		for ( int i = 0; i != 8; ++i )
+			padding[ paddingCount + i ] = static_cast<BYTE>( bitLength >> ( 56 - i * 8 ) );
+
+		finalHash.ProcessBytes( padding, paddingCount + 8 );
+		ASSERT( 0 == finalHash.m_pendingCount );
+
+		for ( int i = 0; i != 8; ++i )
+			for ( int byte = 0; byte != 4; ++byte )
+				digest[ i * 4 + byte ] = static_cast<BYTE>( finalHash.m_state[ i ] >> ( 24 - byte * 8 ) );
+	}
+}
+
+
+namespace fs
+{
+	const CEnumTags& GetTags_HashAlgorithm( void )
+	{
+		static const CEnumTags s_tags( _T("CRC32|xxHash64|SHA-256"), _T("CRC32|XXH64|SHA256") );
+		return s_tags;
+	}
+
+
+	// CFileDigest implementation
+
+	std::tstring CFileDigest::Format( void ) const
+	{
+		std::tstring text = GetTags_HashAlgorithm().FormatUi( m_algorithm ) + _T("=");
+
+		for ( BYTE i = 0; i != m_size; ++i )
+			text += str::Format( _T("%02x"), m_bytes[ i ] );
+
+		return text;
+	}
+
+	bool CFileDigest::operator==( const CFileDigest& right ) const
+	{
+		return m_algorithm == right.m_algorithm && m_size == right.m_size && 0 == memcmp( m_bytes, right.m_bytes, m_size );
+	}
+
+	bool CFileDigest::operator<( const CFileDigest& right ) const
+	{
+		if ( m_algorithm != right.m_algorithm )
+			return m_algorithm < right.m_algorithm;
+
+		if ( m_size != right.m_size )
+			return m_size < right.m_size;
+
+		return memcmp( m_bytes, right.m_bytes, m_size ) < 0;
+	}
+
+	size_t CFileDigest::GetHashValue( void ) const
+	{
+		size_t hashValue = 0;
+
+		for ( BYTE i = 0; i != m_size; ++i )
+			utl::HashCombine( &hashValue, m_bytes[ i ] );
+
+		return hashValue;
+	}
+
+
+	namespace impl
+	{
+		// block functors for io::bin::ReadFile_NoThrow(): count the read bytes, to detect read errors
+
+		template< typename HashT >
+		struct ComputeHash
+		{
+			ComputeHash( void ) : m_byteCount( 0 ) {}
+
+			void operator()( const void* pBuffer, size_t count )
+			{
+				m_hash.ProcessBytes( pBuffer, count );
+				m_byteCount += count;
+			}
+		public:
+			HashT m_hash;
+			UINT64 m_byteCount;
+		};
+	}
+
+
+	bool ComputeFileDigest( OUT CFileDigest& rDigest, const fs::CPath& filePath, UINT64 expectedFileSize, HashAlgorithm hashAlgorithm )
+	{
+		rDigest = CFileDigest();
+
+		try
+		{
+			switch ( hashAlgorithm )
+			{
+				case XxHash64:
+				{
+					impl::ComputeHash<utl::CXxHash64> hashFunc = io::bin::ReadFile_NoThrow( filePath, impl::ComputeHash<utl::CXxHash64>(), io::ReadCFile );
+					if ( hashFunc.m_byteCount != expectedFileSize )
+						return false;
+
+					UINT64 hash = hashFunc.m_hash.GetResult();
+
+					rDigest.m_size = sizeof( hash );
+					for ( BYTE i = 0; i != rDigest.m_size; ++i )
+						rDigest.m_bytes[ i ] = static_cast<BYTE>( hash >> ( 56 - i * 8 ) );		// canonical big-endian representation
+					break;
+				}
+				case Sha256:
+				{
+					impl::ComputeHash<utl::CSha256> hashFunc = io::bin::ReadFile_NoThrow( filePath, impl::ComputeHash<utl::CSha256>(), io::ReadCFile );
+					if ( hashFunc.m_byteCount != expectedFileSize )
+						return false;
+
+					hashFunc.m_hash.GetResult( rDigest.m_bytes );
+					rDigest.m_size = utl::CSha256::DigestSize;
+					break;
+				}
+				default:
+					ASSERT( false );
+					return false;
+			}
+		}
+		catch ( CFileException* pExc )		// read error
+		{
+			app::TraceException( pExc );
+			pExc->Delete();
+			return false;
+		}
+
+		rDigest.m_algorithm = hashAlgorithm;
+		return true;
+	}
+
+	bool HaveSameContents( const fs::CPath& leftFilePath, const fs::CPath& rightFilePath, UINT64* pReadCount /*= nullptr*/ )
+	{
+		UINT64 readCount = 0;
+		bool sameContents = false;
+		CFile leftFile, rightFile;
+
+		if ( leftFile.Open( leftFilePath.GetPtr(), CFile::modeRead | CFile::typeBinary | CFile::shareDenyWrite ) &&
+			 rightFile.Open( rightFilePath.GetPtr(), CFile::modeRead | CFile::typeBinary | CFile::shareDenyWrite ) )
+		{
+			std::vector<char> leftBuffer( io::FileBlockSize ), rightBuffer( io::FileBlockSize );
+
+			try
+			{
+				for ( ;; )
+				{
+					UINT leftCount = leftFile.Read( utl::Data( leftBuffer ), io::FileBlockSize );
+					UINT rightCount = rightFile.Read( utl::Data( rightBuffer ), io::FileBlockSize );
+
+					readCount += leftCount + rightCount;
+
+					if ( leftCount != rightCount || memcmp( utl::Data( leftBuffer ), utl::Data( rightBuffer ), leftCount ) != 0 )
+						break;
+
+					if ( 0 == leftCount )
+					{
+						sameContents = true;		// both at EOF
+						break;
+					}
+				}
+			}
+			catch ( CFileException* pExc )		// read error
+			{
+				app::TraceException( pExc );
+				pExc->Delete();
+			}
+		}
+
+		utl::AssignPtr( pReadCount, readCount );
+		return sameContents;
+	}
+
+
+	// CHashThroughput implementation
+
+	std::tstring CHashThroughput::Format( const std::tstring& stageTag ) const
+	{
+		return str::Format( _T("%s: %d files, %s in %s (%s/s)"),
+			stageTag.c_str(),
+			m_fileCount,
+			num::FormatFileSize( m_byteCount ).c_str(),
+			CTimer::FormatSeconds( m_elapsedSeconds ).c_str(),
+			num::FormatFileSize( static_cast<UINT64>( GetBytesPerSecond() ) ).c_str() );
+	}
+}
@@ -0,0 +1,124 @@
+#ifndef FileDigest_h
+#define FileDigest_h
+#pragma once
+
+#include "FileSystem_fwd.h"
+
+
+class CEnumTags;
+
+
+namespace utl
+{
+	// XXH64: fast non-cryptographic 64-bit hash, as specified by xxHash (https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md).
+	// Streaming: ProcessBytes() can be called for consecutive blocks of any size.
+	//
+	class CXxHash64
+	{
+	public:
+		CXxHash64( UINT64 seed = 0 );
+
+		void ProcessBytes( const void* pBuffer, size_t count );
+		UINT64 GetResult( void ) const;
+	private:
+		void ProcessStripe( const BYTE* pStripe );
+	private:
+		enum { StripeSize = 32 };
+
+		UINT64 m_seed;
+		UINT64 m_acc[ 4 ];
+		UINT64 m_totalLength;
+		BYTE m_pending[ StripeSize ];		// tail of the input, shorter than a stripe
+		size_t m_pendingCount;
+	};
+
+
+	// SHA-256 cryptographic hash (FIPS 180-4). Streaming: ProcessBytes() can be called for consecutive blocks of any size.
+	//
+	class CSha256
+	{
+	public:
+		enum { DigestSize = 32 };
+
+		CSha256( void );
+
+		void ProcessBytes( const void* pBuffer, size_t count );
+		void GetResult( OUT BYTE digest[ DigestSize ] ) const;
+	private:
+		void ProcessBlock( const BYTE* pBlock );
+	private:
+		enum { BlockSize = 64 };
+
+		UINT m_state[ 8 ];
+		UINT64 m_totalLength;
+		BYTE m_pending[ BlockSize ];
+		size_t m_pendingCount;
+	};
+}
+
+
+namespace fs
+{
+	// content hash used for verifying duplicate files, in addition to the CRC32 checksum
+	enum HashAlgorithm
+	{
+		Crc32Only,				// no additional hashing
+		XxHash64,				// fast, non-cryptographic: very low collision risk
+		Sha256,					// cryptographic: collisions are not a practical concern
+			_HashAlgorithmCount
+	};
+
+	const CEnumTags& GetTags_HashAlgorithm( void );
+
+	inline bool IsCryptographicHash( HashAlgorithm hashAlgorithm ) { return Sha256 == hashAlgorithm; }
+
+
+	// strong digest of the file content, computed by a given algorithm
+	//
+	struct CFileDigest
+	{
+		enum { MaxSize = utl::CSha256::DigestSize };
+
+		CFileDigest( void ) : m_algorithm( Crc32Only ), m_size( 0 ) {}
+
+		bool IsEmpty( void ) const { return 0 == m_size; }
+		std::tstring Format( void ) const;				// "SHA-256=hex_digits"
+
+		bool operator==( const CFileDigest& right ) const;
+		bool operator!=( const CFileDigest& right ) const { return !operator==( right ); }
+		bool operator<( const CFileDigest& right ) const;
+
+		size_t GetHashValue( void ) const;
+	public:
+		HashAlgorithm m_algorithm;
+		BYTE m_size;					// digest size in bytes
+		BYTE m_bytes[ MaxSize ];
+	};
+
+
+	// streaming read of the entire file: returns false on read error, or if the file size is not the expected one (file modified in the meantime)
+	bool ComputeFileDigest( OUT CFileDigest& rDigest, const fs::CPath& filePath, UINT64 expectedFileSize, HashAlgorithm hashAlgorithm );
+
+	// byte-by-byte comparison of the contents, reading both files block by block; returns false if different or on read error
+	bool HaveSameContents( const fs::CPath& leftFilePath, const fs::CPath& rightFilePath, UINT64* pReadCount = nullptr );		// pReadCount: bytes read from both files
+
+
+	// statistics of a content verification stage (hashing or comparing)
+	//
+	struct CHashThroughput
+	{
+		CHashThroughput( void ) : m_fileCount( 0 ), m_byteCount( 0 ), m_elapsedSeconds( 0.0 ) {}
+
+		bool IsEmpty( void ) const { return 0 == m_fileCount; }
+		double GetBytesPerSecond( void ) const { return m_elapsedSeconds > 0.0 ? static_cast<double>( m_byteCount ) / m_elapsedSeconds : 0.0; }
+
+		std::tstring Format( const std::tstring& stageTag ) const;		// "SHA-256: 120 files, 1.2 GB in 3.1 seconds (390 MB/s)"
+	public:
+		size_t m_fileCount;
+		UINT64 m_byteCount;
+		double m_elapsedSeconds;
+	};
+}
+
+
+#endif // FileDigest_h
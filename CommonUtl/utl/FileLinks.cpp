@@ -0,0 +1,194 @@
+
+#include "pch.h"
+#include "FileLinks.h"
+#include "FileDigest.h"
+#include "FileSystem.h"
+#include "ParallelFor.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+
+namespace fs
+{
+	namespace impl
+	{
+		fs::CPath MakeTempSiblingPath( const fs::CPath& filePath, const TCHAR suffix[] )
+		{	// in the same directory, so that the final rename is on the same volume
+			return fs::CPath( filePath.Get() + suffix );
+		}
+
+
+		// worker thread functors: write only to their own result slot, and never throw
+
+		struct ReplaceWithHardLinkFunc
+		{
+			ReplaceWithHardLinkFunc( std::vector<BYTE>& rResults, const std::vector<fs::CPath>& dupFilePaths, const std::vector<fs::CPath>& originalFilePaths, bool verifyContents )
+				: m_rResults( rResults ), m_dupFilePaths( dupFilePaths ), m_originalFilePaths( originalFilePaths ), m_verifyContents( verifyContents ) {}
+
+			void operator()( size_t index ) const
+			{
+				m_rResults[ index ] = static_cast<BYTE>( fs::ReplaceWithHardLink( m_dupFilePaths[ index ], m_originalFilePaths[ index ], m_verifyContents ) );
+			}
+		private:
+			std::vector<BYTE>& m_rResults;					// HardLinkResult values; not std::vector<bool>: its bits can't be written concurrently
+			const std::vector<fs::CPath>& m_dupFilePaths;
+			const std::vector<fs::CPath>& m_originalFilePaths;
+			bool m_verifyContents;
+		};
+
+		struct BreakHardLinkFunc
+		{
+			BreakHardLinkFunc( std::vector<BYTE>& rSucceeded, const std::vector<fs::CPath>& filePaths ) : m_rSucceeded( rSucceeded ), m_filePaths( filePaths ) {}
+
+			void operator()( size_t index ) const
+			{
+				m_rSucceeded[ index ] = fs::BreakHardLink( m_filePaths[ index ] );
+			}
+		private:
+			std::vector<BYTE>& m_rSucceeded;
+			const std::vector<fs::CPath>& m_filePaths;
+		};
+
+
+		size_t QueryFailedPaths( OUT std::vector<fs::CPath>& rFailedPaths, const std::vector<fs::CPath>& filePaths, const std::vector<BYTE>& succeeded )
+		{
+			size_t succeededCount = 0;
+
+			rFailedPaths.clear();
+			for ( size_t i = 0; i != filePaths.size(); ++i )
+				if ( succeeded[ i ] )
+					++succeededCount;
+				else
+					rFailedPaths.push_back( filePaths[ i ] );
+
+			return succeededCount;
+		}
+
+		enum { LinkCriticalAttributes = FILE_ATTRIBUTE_READONLY | FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM };
+
+		bool HaveSameLinkAttributes( const fs::CPath& leftFilePath, const fs::CPath& rightFilePath )
+		{	// the duplicate would silently take the original's attributes: refuse to change them
+			DWORD leftAttr = ::GetFileAttributes( leftFilePath.GetPtr() ), rightAttr = ::GetFileAttributes( rightFilePath.GetPtr() );
+
+			return
+				leftAttr != INVALID_FILE_ATTRIBUTES && rightAttr != INVALID_FILE_ATTRIBUTES &&
+				( leftAttr & LinkCriticalAttributes ) == ( rightAttr & LinkCriticalAttributes );
+		}
+	}
+
+
+	bool QueryFileIdentity( OUT CFileIdentity& rIdentity, const fs::CPath& filePath )
+	{
+		rIdentity = CFileIdentity();
+
+		fs::CHandle file( ::CreateFile( filePath.GetPtr(), 0 /* query attributes only */, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr ) );
+
+		BY_HANDLE_FILE_INFORMATION fileInfo;
+
+		if ( !file.IsValid() || !::GetFileInformationByHandle( file.Get(), &fileInfo ) )
+			return false;
+
+		rIdentity.m_volumeSerial = fileInfo.dwVolumeSerialNumber;
+		rIdentity.m_fileIndex = static_cast<UINT64>( fileInfo.nFileIndexHigh ) << 32 | fileInfo.nFileIndexLow;
+		rIdentity.m_linkCount = fileInfo.nNumberOfLinks;
+		return true;
+	}
+
+	bool AreHardLinked( const fs::CPath& leftFilePath, const fs::CPath& rightFilePath )
+	{
+		CFileIdentity leftIdentity, rightIdentity;
+
+		return
+			QueryFileIdentity( leftIdentity, leftFilePath ) && leftIdentity.HasHardLinks() &&
+			QueryFileIdentity( rightIdentity, rightFilePath ) &&
+			leftIdentity == rightIdentity;
+	}
+
+	HardLinkResult ReplaceWithHardLink( const fs::CPath& dupFilePath, const fs::CPath& originalFilePath, bool verifyContents /*= true*/ )
+	{
+		CFileIdentity dupIdentity, originalIdentity;
+
+		if ( !QueryFileIdentity( dupIdentity, dupFilePath ) || !QueryFileIdentity( originalIdentity, originalFilePath ) )
+			return HardLinkFailed;
+
+		if ( dupIdentity == originalIdentity )
+			return HardLinkExisting;	// already linked: nothing to reclaim
+
+		if ( dupIdentity.m_volumeSerial != originalIdentity.m_volumeSerial )
+			return HardLinkFailed;		// hard links can't cross volumes
+
+		if ( !impl::HaveSameLinkAttributes( dupFilePath, originalFilePath ) )
+			return HardLinkFailed;		// e.g. a writable duplicate of a read-only original
+
+		if ( fs::GetFileSize( dupFilePath.GetPtr() ) != fs::GetFileSize( originalFilePath.GetPtr() ) )
+			return HardLinkFailed;
+
+		if ( verifyContents && !fs::HaveSameContents( originalFilePath, dupFilePath ) )
+			return HardLinkFailed;		// modified since the duplicates search
+
+		const fs::CPath tempLinkPath = impl::MakeTempSiblingPath( dupFilePath, _T("~hardlink") );
+
+		if ( !::CreateHardLink( tempLinkPath.GetPtr(), originalFilePath.GetPtr(), nullptr ) )
+			return HardLinkFailed;
+
+		if ( !::MoveFileEx( tempLinkPath.GetPtr(), dupFilePath.GetPtr(), MOVEFILE_REPLACE_EXISTING ) )
+		{
+			::DeleteFile( tempLinkPath.GetPtr() );		// e.g. locked duplicate: leave it as it was
+			return HardLinkFailed;
+		}
+
+		return HardLinkCreated;
+	}
+
+	bool BreakHardLink( const fs::CPath& filePath )
+	{
+		CFileIdentity identity;
+
+		if ( !QueryFileIdentity( identity, filePath ) )
+			return false;
+
+		if ( !identity.HasHardLinks() )
+			return true;				// already an independent file
+
+		const fs::CPath tempCopyPath = impl::MakeTempSiblingPath( filePath, _T("~copy") );
+
+		if ( !::CopyFile( filePath.GetPtr(), tempCopyPath.GetPtr(), TRUE ) )		// copies the attributes and the modify time
+			return false;
+
+		if ( !::MoveFileEx( tempCopyPath.GetPtr(), filePath.GetPtr(), MOVEFILE_REPLACE_EXISTING ) )
+		{
+			::DeleteFile( tempCopyPath.GetPtr() );
+			return false;
+		}
+
+		return true;
+	}
+
+	size_t ReplaceWithHardLinks( OUT std::vector<fs::CPath>& rLinkedPaths, OUT std::vector<fs::CPath>& rFailedPaths,
+								 const std::vector<fs::CPath>& dupFilePaths, const std::vector<fs::CPath>& originalFilePaths, bool verifyContents /*= true*/ )
+	{
+		REQUIRE( dupFilePaths.size() == originalFilePaths.size() );
+
+		std::vector<BYTE> results( dupFilePaths.size(), HardLinkFailed );
+
+		mt::ParallelFor( dupFilePaths.size(), impl::ReplaceWithHardLinkFunc( results, dupFilePaths, originalFilePaths, verifyContents ) );
+
+		rLinkedPaths.clear();
+		for ( size_t i = 0; i != dupFilePaths.size(); ++i )
+			if ( HardLinkCreated == results[ i ] )
+				rLinkedPaths.push_back( dupFilePaths[ i ] );
+
+		return impl::QueryFailedPaths( rFailedPaths, dupFilePaths, results );		// any non-zero result succeeded
+	}
+
+	size_t BreakHardLinks( OUT std::vector<fs::CPath>& rFailedPaths, const std::vector<fs::CPath>& filePaths )
+	{
+		std::vector<BYTE> succeeded( filePaths.size(), false );
+
+		mt::ParallelFor( filePaths.size(), impl::BreakHardLinkFunc( succeeded, filePaths ) );
+		return impl::QueryFailedPaths( rFailedPaths, filePaths, succeeded );
+	}
+}
@@ -0,0 +1,54 @@
+#ifndef FileLinks_h
+#define FileLinks_h
+#pragma once
+
+#include "FileSystem_fwd.h"
+
+
+namespace fs
+{
+	// Identity of a file on its volume (NTFS file ID): all hard links of a file share the same identity.
+	//
+	struct CFileIdentity
+	{
+		CFileIdentity( void ) : m_volumeSerial( 0 ), m_fileIndex( 0 ), m_linkCount( 0 ) {}
+
+		bool IsEmpty( void ) const { return 0 == m_linkCount; }
+		bool HasHardLinks( void ) const { return m_linkCount > 1; }
+
+		bool operator==( const CFileIdentity& right ) const { return m_volumeSerial == right.m_volumeSerial && m_fileIndex == right.m_fileIndex && !IsEmpty(); }
+		bool operator!=( const CFileIdentity& right ) const { return !operator==( right ); }
+	public:
+		DWORD m_volumeSerial;
+		UINT64 m_fileIndex;
+		DWORD m_linkCount;				// count of hard links to the file (1 for a regular file)
+	};
+
+
+	bool QueryFileIdentity( OUT CFileIdentity& rIdentity, const fs::CPath& filePath );		// requires opening the file (no read access)
+
+	bool AreHardLinked( const fs::CPath& leftFilePath, const fs::CPath& rightFilePath );		// same identity?
+
+
+	enum HardLinkResult { HardLinkFailed, HardLinkCreated, HardLinkExisting };		// HardLinkExisting: the files were already linked
+
+
+	// Replaces the duplicate file with a hard link to the original file, reclaiming its storage without deleting any path:
+	//	- the files must be on the same volume, have the same contents (verified byte-by-byte if verifyContents), and the same read-only/hidden/system attributes;
+	//	- the link is created under a temporary name, then renamed over the duplicate, so that the duplicate path is never missing;
+	//	- a hard link shares the file record: the duplicate takes the original's attributes, timestamps and security descriptor (ACL).
+	HardLinkResult ReplaceWithHardLink( const fs::CPath& dupFilePath, const fs::CPath& originalFilePath, bool verifyContents = true );
+
+	// Makes the file an independent copy with the same contents and attributes, detaching it from its other hard links (undo of ReplaceWithHardLink).
+	bool BreakHardLink( const fs::CPath& filePath );
+
+
+	// batch operations, executed on multiple threads; return the count of succeeded files, and the failed file paths in rFailedPaths
+
+	size_t ReplaceWithHardLinks( OUT std::vector<fs::CPath>& rLinkedPaths, OUT std::vector<fs::CPath>& rFailedPaths,		// rLinkedPaths: newly linked only, excluding the ones already linked
+								 const std::vector<fs::CPath>& dupFilePaths, const std::vector<fs::CPath>& originalFilePaths, bool verifyContents = true );
+	size_t BreakHardLinks( OUT std::vector<fs::CPath>& rFailedPaths, const std::vector<fs::CPath>& filePaths );
+}
+
+
+#endif // FileLinks_h
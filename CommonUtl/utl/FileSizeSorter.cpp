@@ -0,0 +1,317 @@
+
+#include "pch.h"
+#include "FileSizeSorter.h"
+#include "AppTools.h"
+#include "ContainerOwnership.h"
+#include "FileState.h"
+#include "FileSystem.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+
+namespace fs
+{
+	namespace impl
+	{
+		struct LessFileSizeAt
+		{
+			LessFileSizeAt( const CFileStateTable& table ) : m_table( table ) {}
+
+			bool operator()( size_t leftIndex, size_t rightIndex ) const { return m_table.GetFileSize( leftIndex ) < m_table.GetFileSize( rightIndex ); }
+		private:
+			const CFileStateTable& m_table;
+		};
+
+
+		// sequential reader of a spilled run file: [record count] + records of [file size, file state]
+		//
+		class CRunReader : private utl::noncopyable
+		{
+		public:
+			CRunReader( const fs::CPath& runFilePath ) throws_( CFileException* )
+				: m_file( runFilePath.GetPtr(), CFile::modeRead | CFile::shareDenyWrite | CFile::typeBinary )
+				, m_archive( &m_file, CArchive::load, 64 * KiloByte )
+				, m_recordCount( 0 )
+				, m_readCount( 0 )
+				, m_hasCurrent( false )
+				, m_lostCount( 0 )
+			{
+				m_archive >> m_recordCount;
+				ReadNext();
+			}
+
+			bool HasCurrent( void ) const { return m_hasCurrent; }
+			UINT64 GetLostCount( void ) const { return m_lostCount; }		// records not read due to a read error
+			const fs::CFileState& GetCurrent( void ) const { ASSERT( m_hasCurrent ); return m_current; }
+
+			void ReadNext( void )
+			{
+				m_hasCurrent = false;
+
+				if ( m_readCount != m_recordCount )
+					try
+					{
+						UINT64 fileSize;
+
+						m_archive >> fileSize >> m_current;
+						m_current.m_fileSize = fileSize;		// not streamed by CFileState
+						++m_readCount;
+						m_hasCurrent = true;
+					}
+					catch ( CException* pExc )
+					{
+						app::TraceException( pExc );			// end the run: its remaining files are lost
+						pExc->Delete();
+						m_lostCount = m_recordCount - m_readCount;
+					}
+			}
+		private:
+			CFile m_file;
+			CArchive m_archive;
+			UINT64 m_recordCount;
+			UINT64 m_readCount;
+			fs::CFileState m_current;
+			bool m_hasCurrent;
+			UINT64 m_lostCount;
+		};
+	}
+
+
+	// CFileStateTable implementation
+
+	void CFileStateTable::Clear( void )
+	{	// swap with empty vectors to release the memory
+		std::vector<TCHAR>().swap( m_pathArena );
+		std::vector<UINT64>().swap( m_pathOffsets );
+		std::vector<UINT64>().swap( m_fileSizes );
+		std::vector<__time64_t>().swap( m_creationTimes );
+		std::vector<__time64_t>().swap( m_modifTimes );
+		std::vector<__time64_t>().swap( m_accessTimes );
+		std::vector<UINT>().swap( m_crc32s );
+		std::vector<BYTE>().swap( m_attributes );
+	}
+
+	void CFileStateTable::Add( const fs::CFileState& fileState )
+	{
+		const std::tstring& filePath = fileState.m_fullPath.Get();
+
+		m_pathOffsets.push_back( m_pathArena.size() );
+		m_pathArena.insert( m_pathArena.end(), filePath.begin(), filePath.end() );
+		m_pathArena.push_back( _T('\0') );
+
+		m_fileSizes.push_back( fileState.m_fileSize );
+		m_creationTimes.push_back( fileState.m_creationTime.GetTime() );
+		m_modifTimes.push_back( fileState.m_modifTime.GetTime() );
+		m_accessTimes.push_back( fileState.m_accessTime.GetTime() );
+		m_crc32s.push_back( fileState.GetCrc32( fs::CFileState::AsIs ) );
+		m_attributes.push_back( fileState.m_attributes );
+	}
+
+	fs::CFileState CFileStateTable::MakeFileState( size_t index ) const
+	{
+		fs::CFileState fileState;
+
+		fileState.m_fullPath.Set( GetPathPtr( index ) );
+		fileState.m_fileSize = m_fileSizes[ index ];
+		fileState.m_attributes = m_attributes[ index ];
+		fileState.m_creationTime = CTime( m_creationTimes[ index ] );
+		fileState.m_modifTime = CTime( m_modifTimes[ index ] );
+		fileState.m_accessTime = CTime( m_accessTimes[ index ] );
+		fileState.StoreCrc32( m_crc32s[ index ] );
+		return fileState;
+	}
+
+	void CFileStateTable::QuerySizeOrder( OUT std::vector<size_t>& rIndexes ) const
+	{
+		rIndexes.resize( GetCount() );
+
+		for ( size_t i = 0; i != rIndexes.size(); ++i )
+			rIndexes[ i ] = i;
+
+		std::stable_sort( rIndexes.begin(), rIndexes.end(), impl::LessFileSizeAt( *this ) );
+	}
+
+
+	// CFileSizeSorter implementation
+
+	CFileSizeSorter::CFileSizeSorter( size_t maxMemoryCount /*= 0*/ )
+		: m_maxMemoryCount( maxMemoryCount )
+		, m_spilledCount( 0 )
+	{
+	}
+
+	CFileSizeSorter::~CFileSizeSorter()
+	{
+		Clear();
+	}
+
+	void CFileSizeSorter::Clear( void )
+	{
+		for ( std::vector<fs::CPath>::const_iterator itRunFilePath = m_runFilePaths.begin(); itRunFilePath != m_runFilePaths.end(); ++itRunFilePath )
+			::DeleteFile( itRunFilePath->GetPtr() );
+
+		m_runFilePaths.clear();
+		m_runCounts.clear();
+		m_table.Clear();
+		m_spilledCount = 0;
+	}
+
+	void CFileSizeSorter::Add( const fs::CFileState& fileState )
+	{
+		m_table.Add( fileState );
+
+		if ( m_maxMemoryCount != 0 && m_table.GetCount() >= m_maxMemoryCount )
+			if ( !SpillRun() )
+				m_maxMemoryCount = 0;				// can't write to the temp directory: keep on in memory
+	}
+
+	bool CFileSizeSorter::SpillRun( void )
+	{
+		TCHAR runFilePath[ MAX_PATH ];
+
+		if ( !::GetTempFileName( fs::GetTempDirPath().GetPtr(), _T("dup"), 0, runFilePath ) )		// creates an empty unique file
+			return false;
+
+		try
+		{
+			std::vector<size_t> sizeOrder;
+			m_table.QuerySizeOrder( sizeOrder );
+
+			CFile runFile( runFilePath, CFile::modeCreate | CFile::modeWrite | CFile::shareExclusive | CFile::typeBinary );
+			CArchive archive( &runFile, CArchive::store, 64 * KiloByte );
+
+			archive << static_cast<UINT64>( sizeOrder.size() );
+
+			for ( std::vector<size_t>::const_iterator itIndex = sizeOrder.begin(); itIndex != sizeOrder.end(); ++itIndex )
+				archive << m_table.GetFileSize( *itIndex ) << m_table.MakeFileState( *itIndex );
+
+			archive.Close();
+			runFile.Close();
+		}
+		catch ( CException* pExc )
+		{
+			app::TraceException( pExc );
+			pExc->Delete();
+
+			::DeleteFile( runFilePath );
+			return false;
+		}
+
+		m_runFilePaths.push_back( fs::CPath( runFilePath ) );
+		m_runCounts.push_back( m_table.GetCount() );
+		m_spilledCount += m_table.GetCount();
+		m_table.Clear();
+		return true;
+	}
+
+	UINT64 CFileSizeSorter::StreamSizeGroups( ISizeGroupSink* pSink )
+	{
+		ASSERT_PTR( pSink );
+
+		UINT64 lostCount = 0;
+
+		if ( m_runFilePaths.empty() )
+			StreamMemoryGroups( pSink );			// everything fits in memory
+		else
+			lostCount = MergeRuns( pSink );			// the last run is merged from memory
+
+		Clear();
+		return lostCount;
+	}
+
+	void CFileSizeSorter::StreamMemoryGroups( ISizeGroupSink* pSink )
+	{
+		std::vector<size_t> sizeOrder;
+		m_table.QuerySizeOrder( sizeOrder );
+
+		std::vector<fs::CFileState> sizeGroup;
+
+		for ( size_t pos = 0; pos != sizeOrder.size(); )
+		{
+			const UINT64 fileSize = m_table.GetFileSize( sizeOrder[ pos ] );
+			size_t endPos = pos + 1;
+
+			while ( endPos != sizeOrder.size() && m_table.GetFileSize( sizeOrder[ endPos ] ) == fileSize )
+				++endPos;
+
+			if ( endPos - pos > 1 )					// materialize only the duplicate candidates
+			{
+				sizeGroup.clear();
+				for ( ; pos != endPos; ++pos )
+					sizeGroup.push_back( m_table.MakeFileState( sizeOrder[ pos ] ) );
+
+				pSink->OnSizeGroup( sizeGroup );
+			}
+
+			pos = endPos;
+		}
+	}
+
+	UINT64 CFileSizeSorter::MergeRuns( ISizeGroupSink* pSink )
+	{
+		utl::COwningContainer< std::vector<impl::CRunReader*> > runReaders;
+		UINT64 lostCount = 0;
+
+		for ( size_t i = 0; i != m_runFilePaths.size(); ++i )
+			try
+			{
+				runReaders.push_back( new impl::CRunReader( m_runFilePaths[ i ] ) );
+			}
+			catch ( CException* pExc )
+			{
+				app::TraceException( pExc );
+				pExc->Delete();
+				lostCount += m_runCounts[ i ];		// the entire run is lost
+			}
+
+		std::vector<size_t> memoryOrder;			// the last run, not spilled
+		m_table.QuerySizeOrder( memoryOrder );
+
+		std::vector<fs::CFileState> sizeGroup;
+
+		for ( size_t memoryPos = 0; ; )
+		{	// k-way merge: a few runs, so a linear search for the smallest current file is fine
+			impl::CRunReader* pMinReader = nullptr;
+
+			for ( std::vector<impl::CRunReader*>::const_iterator itReader = runReaders.begin(); itReader != runReaders.end(); ++itReader )
+				if ( ( *itReader )->HasCurrent() )
+					if ( nullptr == pMinReader || ( *itReader )->GetCurrent().m_fileSize < pMinReader->GetCurrent().m_fileSize )
+						pMinReader = *itReader;
+
+			bool fromMemory = memoryPos != memoryOrder.size() &&
+				( nullptr == pMinReader || m_table.GetFileSize( memoryOrder[ memoryPos ] ) < pMinReader->GetCurrent().m_fileSize );
+
+			bool atEnd = !fromMemory && nullptr == pMinReader;
+			UINT64 fileSize = 0;
+
+			if ( !atEnd )
+				fileSize = fromMemory ? m_table.GetFileSize( memoryOrder[ memoryPos ] ) : pMinReader->GetCurrent().m_fileSize;
+
+			if ( !sizeGroup.empty() && ( atEnd || fileSize != sizeGroup.front().m_fileSize ) )
+			{	// end of the size group
+				if ( sizeGroup.size() > 1 )
+					pSink->OnSizeGroup( sizeGroup );
+
+				sizeGroup.clear();
+			}
+
+			if ( atEnd )
+				break;
+
+			if ( fromMemory )
+				sizeGroup.push_back( m_table.MakeFileState( memoryOrder[ memoryPos++ ] ) );
+			else
+			{
+				sizeGroup.push_back( pMinReader->GetCurrent() );
+				pMinReader->ReadNext();
+			}
+		}
+
+		for ( std::vector<impl::CRunReader*>::const_iterator itReader = runReaders.begin(); itReader != runReaders.end(); ++itReader )
+			lostCount += ( *itReader )->GetLostCount();
+
+		return lostCount;
+	}
+}
@@ -0,0 +1,88 @@
+#ifndef FileSizeSorter_h
+#define FileSizeSorter_h
+#pragma once
+
+#include "FileSystem_fwd.h"
+
+
+namespace fs
+{
+	struct CFileState;
+
+
+	// Compact columnar table of file states: the paths are stored in a single character arena, the other fields in parallel columns.
+	// Takes about 45 bytes per file plus the path characters, instead of a heap-allocated object (and path string) per file.
+	// Sizes and arena offsets are 64-bit, so that it scales beyond 4 GB of paths.
+	//
+	class CFileStateTable
+	{
+	public:
+		CFileStateTable( void ) {}
+
+		bool IsEmpty( void ) const { return m_fileSizes.empty(); }
+		size_t GetCount( void ) const { return m_fileSizes.size(); }
+		void Clear( void );
+
+		void Add( const fs::CFileState& fileState );
+
+		UINT64 GetFileSize( size_t index ) const { return m_fileSizes[ index ]; }
+		const TCHAR* GetPathPtr( size_t index ) const { return &m_pathArena[ static_cast<size_t>( m_pathOffsets[ index ] ) ]; }
+		fs::CFileState MakeFileState( size_t index ) const;
+
+		void QuerySizeOrder( OUT std::vector<size_t>& rIndexes ) const;		// indexes in ascending file size order (stable)
+	private:
+		std::vector<TCHAR> m_pathArena;					// NUL-terminated paths
+		std::vector<UINT64> m_pathOffsets;
+		std::vector<UINT64> m_fileSizes;
+		std::vector<__time64_t> m_creationTimes;
+		std::vector<__time64_t> m_modifTimes;
+		std::vector<__time64_t> m_accessTimes;
+		std::vector<UINT> m_crc32s;						// 0 if not evaluated
+		std::vector<BYTE> m_attributes;
+	};
+
+
+	interface ISizeGroupSink
+	{
+		virtual void OnSizeGroup( const std::vector<fs::CFileState>& fileStates ) = 0;		// multiple files with the same size
+	};
+
+
+	// Groups the found files by size with bounded memory (external sort): when the in-memory table reaches maxMemoryCount files,
+	// it is sorted by size and spilled as a run to a temporary file. The runs are merged when streaming the size groups,
+	// so that only the groups with multiple files (the duplicate candidates) are ever materialized.
+	//
+	class CFileSizeSorter : private utl::noncopyable
+	{
+	public:
+		CFileSizeSorter( size_t maxMemoryCount = 0 );	// 0: no spilling
+		~CFileSizeSorter();								// deletes the spilled run files
+
+		void Clear( void );
+
+		size_t GetMaxMemoryCount( void ) const { return m_maxMemoryCount; }
+		void SetMaxMemoryCount( size_t maxMemoryCount ) { m_maxMemoryCount = maxMemoryCount; }
+
+		UINT64 GetTotalCount( void ) const { return m_spilledCount + m_table.GetCount(); }
+		size_t GetRunCount( void ) const { return m_runFilePaths.size(); }
+
+		void Add( const fs::CFileState& fileState );
+
+		// streams the groups of files with the same size (only with multiple files), in ascending size order; leaves the sorter empty.
+		// Returns the count of files lost by failing to read back the spilled runs (0 on success).
+		UINT64 StreamSizeGroups( ISizeGroupSink* pSink );
+	private:
+		bool SpillRun( void );
+		void StreamMemoryGroups( ISizeGroupSink* pSink );
+		UINT64 MergeRuns( ISizeGroupSink* pSink );
+	private:
+		size_t m_maxMemoryCount;
+		CFileStateTable m_table;						// current run
+		std::vector<fs::CPath> m_runFilePaths;			// spilled runs, each sorted by size
+		std::vector<UINT64> m_runCounts;				// count of files in each spilled run
+		UINT64 m_spilledCount;
+	};
+}
+
+
+#endif // FileSizeSorter_h
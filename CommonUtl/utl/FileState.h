@@ -47,6 +47,7 @@ namespace fs
 		UINT GetCrc32( ChecksumEvaluation evaluation = Compute ) const;
 		UINT ComputeCrc32( ChecksumEvaluation evaluation ) const;
 		void ResetCrc32( void ) { m_crc32 = 0; }
+		void StoreCrc32( UINT crc32 ) { m_crc32 = crc32; }		// checksum known from a previous evaluation
 
 		// serialization
 		void Stream( CArchive& archive );
@@ -5,6 +5,7 @@
 #include "Code_fwd.h"
 #include "StringParsing.h"
 #include "Range.h"
+#include <bitset>
 #include <vector>
 
 
@@ -30,6 +31,13 @@ namespace code
 	class CEscaper;
 
 	const CEscaper& GetEscaperC( void );
+
+
+	namespace impl
+	{
+		inline size_t ToCharClass( char chr ) { return static_cast<unsigned char>( chr ); }
+		inline size_t ToCharClass( wchar_t chr ) { return chr; }
+	}
 }
 
 
@@ -128,6 +136,7 @@ namespace code
 			, m_skipArgLists( false )						// by default disabled, so the client code has to skip them if needed
 		{
 			GetSeparatorsPair().EnableLineComments();		// by default assume the last separator pair refers to single-line comments
+			CompileOpenLeads();
 		}
 
 		const str::CEnclosedParser<CharT>& GetParser( void ) const { return m_parser; }
@@ -143,12 +152,11 @@ namespace code
 		IteratorT FindNextSequenceT( IteratorT itCode, IteratorT itLast, const SeqStringT& sequence ) const
 		{	// note: sequence can be of a different string type - for parsing TCHAR code with char language elements (operators, etc)
 			str::IterationDir iterDir = str::GetIterationDir( itCode );
-			const TSeparatorsPair& sepsPair = m_parser.GetSeparators();
 
-			for ( TSepMatchPos sepMatchPos = TString::npos; itCode != itLast; )
+			while ( itCode != itLast )
 			{
-				if ( sepsPair.MatchesAnyOpenSepAt( &sepMatchPos, itCode, itLast ) )	// matches a quoted string, comment, etc?
-					sepsPair.SkipMatchingSpec( &itCode, itLast, sepMatchPos );	// skip the entire spec
+				if ( SkipSpecAt( &itCode, itLast ) )			// skipped a quoted string, comment, etc?
+					continue;
 				else if ( str::EqualsSeq( itCode, itLast, sequence ) )
 				{
 					if ( str::ReverseIter == iterDir )
@@ -180,12 +188,10 @@ namespace code
 		template< typename IteratorT, typename IsCharPred >
 		IteratorT FindNextCharThat( IteratorT itCode, IteratorT itLast, IsCharPred isCharPred ) const
 		{
-			const TSeparatorsPair& sepsPair = m_parser.GetSeparators();
-
-			for ( TSepMatchPos sepMatchPos = TString::npos; itCode != itLast; )
+			while ( itCode != itLast )
 			{
-				if ( sepsPair.MatchesAnyOpenSepAt( &sepMatchPos, itCode, itLast ) )		// matches a quoted string, comment, etc?
-					sepsPair.SkipMatchingSpec( &itCode, itLast, sepMatchPos );			// skip the entire spec
+				if ( SkipSpecAt( &itCode, itLast ) )			// skipped a quoted string, comment, etc?
+					continue;
 				else if ( isCharPred( *itCode ) )
 					return itCode;				// found the next match
 				else if ( m_skipArgLists && IsBracket( *itCode ) )
@@ -267,6 +273,59 @@ namespace code
 		{
 			return FindNextCharThat( itCode, itLast, &code::IsBracket );
 		}
+
+
+		// lexing
+
+		template< typename IteratorT >
+		bool SkipSpecAt( IN OUT IteratorT* pItCode, IteratorT itLast ) const
+		{	// skips the quoted string, comment, etc opened at the current position; an unterminated spec extends to itLast
+			ASSERT_PTR( pItCode );
+			REQUIRE( *pItCode != itLast );
+
+			str::IterationDir iterDir = str::GetIterationDir( *pItCode );
+			TSepMatchPos sepMatchPos;
+
+			if ( !IsOpenSepLead( **pItCode, iterDir ) )		// quick rejection by the character class table
+				return false;
+
+			const TSeparatorsPair& sepsPair = m_parser.GetSeparators();
+
+			if ( !sepsPair.MatchesAnyOpenSepAt( &sepMatchPos, *pItCode, itLast ) )
+				return false;
+
+			if ( !sepsPair.SkipMatchingSpec( pItCode, itLast, sepMatchPos ) )
+				*pItCode = itLast;
+
+			return true;
+		}
+
+		template< typename ChT >
+		bool IsOpenSepLead( ChT chr, str::IterationDir iterDir ) const
+		{	// could chr be the leading character of an OPEN separator?  START separators for forward iteration, END separators for reverse
+			size_t charClass = impl::ToCharClass( chr );
+			return charClass < CharClassCount && m_openLeads[ iterDir ].test( charClass );
+		}
+	private:
+		void CompileOpenLeads( void )
+		{
+			const std::pair<TSepVector, TSepVector>& sepsPair = GetSeparatorsPair().GetSepsPair();
+
+			for ( size_t i = 0; i != sepsPair.first.size(); ++i )
+			{
+				m_openLeads[ str::ForwardIter ].set( ToLeadCharClass( sepsPair.first[ i ][ 0 ] ) );
+				m_openLeads[ str::ReverseIter ].set( ToLeadCharClass( sepsPair.second[ i ][ sepsPair.second[ i ].length() - 1 ] ) );		// reverse matching starts with the last character
+			}
+		}
+
+		static size_t ToLeadCharClass( CharT leadChr )
+		{
+			size_t charClass = impl::ToCharClass( leadChr );
+
+			ENSURE( charClass < CharClassCount );			// separators are defined with narrow strings
+			ENSURE( !IsBracket( leadChr ) );				// brackets are parsed separately, they can't open a separator
+			return charClass;
+		}
 	public:
 		class CScopedSkipArgLists
 		{
@@ -290,6 +349,46 @@ namespace code
 		const str::CEnclosedParser<CharT> m_parser;		// contains pairs of START/END separators of specific language constructs (for skipping)
 		const CEscaper* m_pEscaper;
 		mutable bool m_skipArgLists;					// if true: when searching for sequences or characters, parses and skips the embedded bracket-delimited arg-lists
+
+		enum { CharClassCount = 256 };
+		std::bitset<CharClassCount> m_openLeads[ 2 ];	// character class table indexed by str::IterationDir: leading characters of the OPEN separators
+	};
+
+
+	// Skip map of a code text: the ranges of quoted strings, comments, etc, lexed once in a forward pass.
+	// Repeated forward searches in the same code jump directly between the code regions, matching no separators.
+	// Note: the code text must outlive the map, and must not be modified in ways that change the skipped ranges.
+	//
+	template< typename CharT >
+	class CCodeSkipMap : private utl::noncopyable
+	{
+	public:
+		typedef std::basic_string<CharT> TString;
+
+		CCodeSkipMap( const CLanguage<CharT>& lang, const TString& codeText );
+
+		const CLanguage<CharT>& GetLanguage( void ) const { return m_lang; }
+		const std::vector< Range<size_t> >& GetSkipRanges( void ) const { return m_skipRanges; }
+
+		bool IsCodeAt( size_t pos ) const;				// not inside a quoted string, comment, etc
+
+		// forward search to the end of text: return the found position, or the text length if not found
+		template< typename SeqStringT >
+		size_t FindNextSequence( size_t pos, const SeqStringT& sequence ) const;
+
+		template< typename IsCharPred >
+		size_t FindNextCharThat( size_t pos, IsCharPred isCharPred ) const;
+
+		size_t FindMatchingBracket( size_t bracketPos, OUT size_t* pBracketMismatchPos = nullptr ) const throws_cond( code::TSyntaxError );
+		bool SkipPastMatchingBracket( IN OUT size_t* pBracketPos, OUT size_t* pBracketMismatchPos = nullptr ) const throws_cond( code::TSyntaxError );
+	private:
+		typedef std::vector< Range<size_t> >::const_iterator TRangeIterator;
+
+		TRangeIterator FindSkipRangeFrom( size_t pos ) const;		// first range starting at or after pos
+	private:
+		const CLanguage<CharT>& m_lang;
+		const TString& m_codeText;
+		std::vector< Range<size_t> > m_skipRanges;		// sorted, not overlapping
 	};
 }
 
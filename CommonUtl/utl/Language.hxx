@@ -25,9 +25,8 @@ namespace code
 		IteratorT it = itBracket + 1;		// skip the opening bracket
 
 		CharT topMatchingBracket = ToMatchingBracket( bracketStack.back().first );
-		const TSeparatorsPair& sepsPair = m_parser.GetSeparators();
 
-		for ( TSepMatchPos sepMatchPos = TString::npos; it != itLast; )
+		while ( it != itLast )
 			if ( IsBracket( *it ) )
 			{
 				if ( topMatchingBracket == *it )
@@ -43,9 +42,7 @@ namespace code
 				topMatchingBracket = ToMatchingBracket( bracketStack.back().first );
 				++it;
 			}
-			else if ( sepsPair.MatchesAnyOpenSepAt( &sepMatchPos, it, itLast ) )	// matches a quoted string, comment, etc?
-				sepsPair.SkipMatchingSpec( &it, itLast, sepMatchPos );				// skip the entire spec
-			else
+			else if ( !SkipSpecAt( &it, itLast ) )		// not a quoted string, comment, etc?
 				++it;
 
 		// matching bracket not found
@@ -72,6 +69,177 @@ namespace code
 		++*pItBracket;		// advance past the found matching bracket (for range computation)
 		return true;
 	}
+
+
+	// CCodeSkipMap template code
+
+	template< typename CharT >
+	CCodeSkipMap<CharT>::CCodeSkipMap( const CLanguage<CharT>& lang, const TString& codeText )
+		: m_lang( lang )
+		, m_codeText( codeText )
+	{
+		typename TString::const_iterator itBegin = m_codeText.begin(), itEnd = m_codeText.end();
+
+		for ( typename TString::const_iterator it = itBegin; it != itEnd; )
+		{
+			typename TString::const_iterator itSpec = it;
+
+			if ( m_lang.SkipSpecAt( &it, itEnd ) )
+				m_skipRanges.push_back( Range<size_t>( std::distance( itBegin, itSpec ), std::distance( itBegin, it ) ) );
+			else
+				++it;
+		}
+	}
+
+	template< typename CharT >
+	typename CCodeSkipMap<CharT>::TRangeIterator CCodeSkipMap<CharT>::FindSkipRangeFrom( size_t pos ) const
+	{
+		TRangeIterator itRange = m_skipRanges.begin();
+		size_t count = m_skipRanges.size();
+
+		while ( count != 0 )		// binary search: lower bound by the range start
+		{
+			size_t half = count / 2;
+
+			if ( itRange[ half ].m_start < pos )
+			{
+				itRange += half + 1;
+				count -= half + 1;
+			}
+			else
+				count = half;
+		}
+		return itRange;
+	}
+
+	template< typename CharT >
+	bool CCodeSkipMap<CharT>::IsCodeAt( size_t pos ) const
+	{
+		TRangeIterator itRange = FindSkipRangeFrom( pos + 1 );		// past the range that may contain pos
+
+		return itRange == m_skipRanges.begin() || ( itRange - 1 )->m_end <= pos;
+	}
+
+	template< typename CharT >
+	template< typename SeqStringT >
+	size_t CCodeSkipMap<CharT>::FindNextSequence( size_t pos, const SeqStringT& sequence ) const
+	{
+		REQUIRE( pos <= m_codeText.length() && !sequence.empty() );
+
+		if ( !IsCodeAt( pos ) )		// lexing from inside a skipped range has different results
+			return std::distance( m_codeText.begin(), m_lang.FindNextSequenceT( m_codeText.begin() + pos, m_codeText.end(), sequence ) );
+
+		TRangeIterator itSkip = FindSkipRangeFrom( pos );
+
+		while ( pos != m_codeText.length() )
+			if ( itSkip != m_skipRanges.end() && pos == itSkip->m_start )
+				pos = ( itSkip++ )->m_end;		// jump over the quoted string, comment, etc
+			else if ( str::EqualsSeq( m_codeText.begin() + pos, m_codeText.end(), sequence ) )
+				return pos;
+			else if ( m_lang.RefSkipArgLists() && IsBracket( m_codeText[ pos ] ) )
+			{
+				SkipPastMatchingBracket( &pos );
+				itSkip = FindSkipRangeFrom( pos );
+			}
+			else
+				++pos;
+
+		return pos;
+	}
+
+	template< typename CharT >
+	template< typename IsCharPred >
+	size_t CCodeSkipMap<CharT>::FindNextCharThat( size_t pos, IsCharPred isCharPred ) const
+	{
+		REQUIRE( pos <= m_codeText.length() );
+
+		if ( !IsCodeAt( pos ) )
+			return std::distance( m_codeText.begin(), m_lang.FindNextCharThat( m_codeText.begin() + pos, m_codeText.end(), isCharPred ) );
+
+		TRangeIterator itSkip = FindSkipRangeFrom( pos );
+
+		while ( pos != m_codeText.length() )
+			if ( itSkip != m_skipRanges.end() && pos == itSkip->m_start )
+				pos = ( itSkip++ )->m_end;
+			else if ( isCharPred( m_codeText[ pos ] ) )
+				return pos;
+			else if ( m_lang.RefSkipArgLists() && IsBracket( m_codeText[ pos ] ) )
+			{
+				SkipPastMatchingBracket( &pos );
+				itSkip = FindSkipRangeFrom( pos );
+			}
+			else
+				++pos;
+
+		return pos;
+	}
+
+	template< typename CharT >
+	size_t CCodeSkipMap<CharT>::FindMatchingBracket( size_t bracketPos, OUT size_t* pBracketMismatchPos /*= nullptr*/ ) const throws_cond( code::TSyntaxError )
+	{
+		REQUIRE( bracketPos < m_codeText.length() && IsBracket( m_codeText[ bracketPos ] ) );
+
+		if ( !IsCodeAt( bracketPos ) )
+		{
+			typename TString::const_iterator itBracketMismatch = m_codeText.end();
+			size_t matchingPos = std::distance( m_codeText.begin(), m_lang.FindMatchingBracket( m_codeText.begin() + bracketPos, m_codeText.end(), pBracketMismatchPos != nullptr ? &itBracketMismatch : nullptr ) );
+
+			utl::AssignPtr( pBracketMismatchPos, static_cast<size_t>( std::distance( m_codeText.begin(), itBracketMismatch ) ) );
+			return matchingPos;
+		}
+
+		utl::AssignPtr( pBracketMismatchPos, m_codeText.length() );		// i.e. no mismatch syntax error
+
+		std::vector<size_t> bracketStack;			// positions of the open brackets
+		bracketStack.push_back( bracketPos );
+
+		CharT topMatchingBracket = ToMatchingBracket( m_codeText[ bracketPos ] );
+		TRangeIterator itSkip = FindSkipRangeFrom( bracketPos + 1 );
+
+		for ( size_t pos = bracketPos + 1; pos != m_codeText.length(); )
+			if ( itSkip != m_skipRanges.end() && pos == itSkip->m_start )
+				pos = ( itSkip++ )->m_end;			// brackets never open a separator, so skipping first is equivalent
+			else if ( IsBracket( m_codeText[ pos ] ) )
+			{
+				if ( topMatchingBracket == m_codeText[ pos ] )
+				{
+					bracketStack.pop_back();		// exit one bracket nesting level
+
+					if ( bracketStack.empty() )
+						return pos;					// on the matching bracket of the originating bracket
+				}
+				else
+					bracketStack.push_back( pos );	// go deeper with the nested bracket
+
+				topMatchingBracket = ToMatchingBracket( m_codeText[ bracketStack.back() ] );
+				++pos;
+			}
+			else
+				++pos;
+
+		// matching bracket not found
+		ENSURE( !bracketStack.empty() );
+		if ( pBracketMismatchPos != nullptr )
+			*pBracketMismatchPos = bracketStack.front();		// the originating bracket mismatch (the cause of syntax error)
+		else
+			throw code::TSyntaxError( str::Format( "Syntax error: no matching bracket found for the origin bracket at:\n\tcode: '%s'",
+												   str::ValueToString<std::string>( m_codeText.c_str() + bracketStack.front() ).c_str() ),
+									  UTL_FILE_LINE );
+
+		return m_codeText.length();
+	}
+
+	template< typename CharT >
+	bool CCodeSkipMap<CharT>::SkipPastMatchingBracket( IN OUT size_t* pBracketPos, OUT size_t* pBracketMismatchPos /*= nullptr*/ ) const throws_cond( code::TSyntaxError )
+	{
+		ASSERT_PTR( pBracketPos );
+		*pBracketPos = FindMatchingBracket( *pBracketPos, pBracketMismatchPos );
+		if ( *pBracketPos == m_codeText.length() )
+			return false;
+
+		++*pBracketPos;		// advance past the found matching bracket
+		return true;
+	}
 }
 
 
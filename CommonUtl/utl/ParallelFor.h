@@ -0,0 +1,107 @@
+#ifndef ParallelFor_h
+#define ParallelFor_h
+#pragma once
+
+#include "StdThread.h"
+
+#ifdef IS_CPP_11
+	#include <atomic>
+#endif
+
+
+namespace mt
+{
+	inline size_t GetHardwareThreadCount( void )
+	{
+	#ifdef IS_CPP_11
+		size_t threadCount = std::thread::hardware_concurrency();
+		return threadCount != 0 ? threadCount : 1;
+	#else
+		return 1;
+	#endif
+	}
+
+
+	// Executes indexFunc( index ) for each index in [0, count) on a transient pool of worker threads, with dynamic load balancing.
+	// The calling thread participates as a worker, and returns after all items were processed.
+	// Requirements: indexFunc must be thread safe for distinct indexes, and must not throw.
+	//
+	template< typename IndexFuncT >
+	void ParallelFor( size_t count, IndexFuncT indexFunc, size_t threadCount = 0 )
+	{
+		if ( 0 == threadCount )
+			threadCount = GetHardwareThreadCount();
+
+		threadCount = std::min( threadCount, count );
+
+	#ifdef IS_CPP_11
+		if ( threadCount > 1 )
+		{
+			std::atomic<size_t> nextIndex( 0 );
+
+			auto workLoop = [&]( void )
+			{
+				for ( size_t index; ( index = nextIndex++ ) < count; )
+					indexFunc( index );
+			};
+
+			std::vector<std::thread> workers;
+			workers.reserve( threadCount - 1 );
+
+			for ( size_t i = 1; i != threadCount; ++i )
+				workers.push_back( std::thread( workLoop ) );
+
+			workLoop();				// calling thread works too
+
+			for ( std::vector<std::thread>::iterator itWorker = workers.begin(); itWorker != workers.end(); ++itWorker )
+				itWorker->join();
+			return;
+		}
+	#endif
+
+		for ( size_t index = 0; index != count; ++index )
+			indexFunc( index );		// serial execution
+	}
+
+
+	namespace impl
+	{
+		template< typename RangeFuncT >
+		struct SliceFunc
+		{
+			SliceFunc( RangeFuncT& rRangeFunc, size_t count, size_t sliceSize ) : m_rRangeFunc( rRangeFunc ), m_count( count ), m_sliceSize( sliceSize ) {}
+
+			void operator()( size_t sliceIndex ) const
+			{
+				size_t itemFirst = sliceIndex * m_sliceSize;
+				size_t itemLast = std::min( itemFirst + m_sliceSize, m_count );
+
+				if ( itemFirst < itemLast )
+					m_rRangeFunc( itemFirst, itemLast );
+			}
+		private:
+			RangeFuncT& m_rRangeFunc;
+			size_t m_count;
+			size_t m_sliceSize;
+		};
+	}
+
+
+	// Executes rangeFunc( itemFirst, itemLast ) on contiguous slices of [0, count), one slice per worker thread.
+	// Use it for kernels that benefit from processing adjacent items (e.g. image rows), where the per-item dispatch would dominate.
+	//
+	template< typename RangeFuncT >
+	void ParallelForSlices( size_t count, RangeFuncT rangeFunc, size_t minSliceSize = 1, size_t threadCount = 0 )
+	{
+		if ( 0 == threadCount )
+			threadCount = GetHardwareThreadCount();
+
+		size_t sliceCount = std::max<size_t>( 1, std::min( threadCount, count / std::max<size_t>( minSliceSize, 1 ) ) );
+		size_t sliceSize = ( count + sliceCount - 1 ) / sliceCount;
+
+		ParallelFor( sliceCount, impl::SliceFunc<RangeFuncT>( rangeFunc, count, sliceSize ), sliceCount );
+	}
+}
+
+
+#endif // ParallelFor_h
@@ -51,6 +51,17 @@ namespace path
 		return pred::MakeIntuitiveComparator( func::ToNaturalPathCharValue() ).Compare( pLeft, pRight );
 	}
 
+	bool MakeNaturalSortKey( std::string& rSortKey, const TCHAR* pPath )
+	{
+		// no case tie-break: pred::CompareNaturalPath evaluates equivalent paths as equal
+		return pred::IntuitiveSortKeyEncoder<func::ToNaturalPathCharValue>().Encode( rSortKey, pPath, false );
+	}
+
+	bool MakeNaturalSortKey( std::string& rSortKey, const fs::CFileState& fileState )
+	{
+		return MakeNaturalSortKey( rSortKey, fileState.m_fullPath.GetPtr() );
+	}
+
 
 	size_t GetHashValuePtr( const char* pPath, size_t count /*= utl::npos*/ )
 	{
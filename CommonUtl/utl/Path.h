@@ -82,6 +82,10 @@ namespace path
 
 	pred::CompareResult CompareIntuitive( const TCHAR* pLeft, const TCHAR* pRight );
 
+	// natural path sort keys: the memcmp order of the keys is the pred::CompareNaturalPath order (no case tie-break: equivalent paths have equal keys);
+	// returns false for non-ASCII digits (not encodable)
+	bool MakeNaturalSortKey( std::string& rSortKey, const TCHAR* pPath );
+
 
 	typedef str::EvalMatch<func::ToWinPathChar, func::ToEquivalentPathChar> TGetMatch;
 }
@@ -522,6 +526,32 @@ namespace pred
 #include <set>
 
 
+namespace path
+{
+	inline bool MakeNaturalSortKey( std::string& rSortKey, const std::tstring& path ) { return MakeNaturalSortKey( rSortKey, path.c_str() ); }
+	inline bool MakeNaturalSortKey( std::string& rSortKey, const fs::CPath& path ) { return MakeNaturalSortKey( rSortKey, path.GetPtr() ); }
+	bool MakeNaturalSortKey( std::string& rSortKey, const fs::CFileState& fileState );
+}
+
+
+namespace func
+{
+	template< typename ToPathFunc = func::ToSelf >
+	struct ToNaturalSortKey		// for sorting by keys elements that contain a path
+	{
+		ToNaturalSortKey( ToPathFunc toPathFunc = ToPathFunc() ) : m_toPathFunc( toPathFunc ) {}
+
+		template< typename ValueT >
+		bool operator()( std::string& rSortKey, const ValueT& value ) const
+		{
+			return path::MakeNaturalSortKey( rSortKey, m_toPathFunc( value ) );
+		}
+	private:
+		ToPathFunc m_toPathFunc;
+	};
+}
+
+
 namespace fs
 {
 	// forward declarations
@@ -536,12 +566,13 @@ namespace fs
 	typedef std::set<fs::CPath, pred::TLess_NaturalPath> TPathSet;
 
 
-	// path sort for std::tstring, fs::CPath, fs::CFlexPath
+	// path sort for std::tstring, fs::CPath, fs::CFlexPath, fs::CFileState: by natural sort keys, each path is evaluated only once
 
 	template< typename IteratorT >
 	inline void SortPaths( IteratorT itFirst, IteratorT itLast, bool ascending = true )
 	{
-		std::sort( itFirst, itLast, pred::OrderByValue<pred::CompareNaturalPath>( ascending ) );
+		if ( !str::impl::SortBySortKeys( itFirst, itLast, func::ToNaturalSortKey<>(), ascending ) )
+			std::sort( itFirst, itLast, pred::OrderByValue<pred::CompareNaturalPath>( ascending ) );		// fall back to comparator sorting
 	}
 
 	template< typename ContainerT >
@@ -110,10 +110,17 @@ namespace func
 		std::sort( rPathItems.begin(), rPathItems.end(), pred::OrderByValue<CompareItemT>( ascending ) );
 	}
 
+	template< typename ContainerT, typename ToPathFunc >
+	inline void SortPathItemsByKey( ContainerT& rPathItems, ToPathFunc toPathFunc, bool ascending = true )
+	{	// equivalent with sorting by pred::CompareAdapter<pred::CompareNaturalPath, ToPathFunc>, but each item path is evaluated only once
+		if ( !str::impl::SortBySortKeys( rPathItems.begin(), rPathItems.end(), func::ToNaturalSortKey<ToPathFunc>( toPathFunc ), ascending ) )
+			SortPathItems< pred::CompareAdapter<pred::CompareNaturalPath, ToPathFunc> >( rPathItems, ascending );
+	}
+
 	template< typename ContainerT >
 	inline void SortPathItems( ContainerT& rPathItems, bool ascending = true )
 	{
-		SortPathItems<pred::TComparePathItem>( rPathItems, ascending );
+		SortPathItemsByKey( rPathItems, CPathItemBase::ToFilePath(), ascending );
 	}
 
 
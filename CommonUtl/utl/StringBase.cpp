@@ -1,6 +1,7 @@
 
 #include "pch.h"
 #include "StringBase.h"
+#include "Utf8Transcoder.h"
 #include <comdef.h>			// _com_error
 #include <math.h>			// fabs()
 
@@ -128,15 +129,25 @@ namespace str
 	}
 
 	std::string ToUtf8( const wchar_t* pWide, size_t charCount /*= std::wstring::npos*/ )
-	{
-		std::string narrow;
-		return hlp::ToNarrow( narrow, CP_UTF8, pWide, charCount );
+	{	// single pass by the in-house transcoder, rather than sizing and converting with WideCharToMultiByte()
+		std::string utf8;
+
+		str::SettleLength( charCount, pWide );
+		if ( !str::IsEmpty( pWide ) )
+			utf8::FromWide( utf8, pWide, charCount );
+
+		return utf8;
 	}
 
 	std::wstring FromUtf8( const char* pUtf8, size_t charCount /*= std::string::npos*/ )
 	{
 		std::wstring wide;
-		return hlp::ToWide( wide, CP_UTF8, pUtf8, charCount );
+
+		str::SettleLength( charCount, pUtf8 );
+		if ( !str::IsEmpty( pUtf8 ) )
+			utf8::ToWide( wide, pUtf8, charCount );
+
+		return wide;
 	}
 
 
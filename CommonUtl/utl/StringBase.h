@@ -787,24 +787,70 @@ namespace str
 
 namespace str
 {
+	namespace impl
+	{
+		// Builds the replaced text in a single pass: appends the unchanged spans and the replacements to a separate output.
+		// Replacing in place would shift the tail of the text on each match when the replacement length differs: O(n*k) rather than O(n).
+		//
+		template< typename StringT >
+		class CReplaceBuilder : private utl::noncopyable
+		{
+			typedef typename StringT::value_type TChar;
+		public:
+			CReplaceBuilder( const StringT& text ) : m_text( text ), m_copiedPos( 0 ), m_count( 0 ) {}
+
+			size_t GetCount( void ) const { return m_count; }
+
+			void ReplaceAt( size_t pos, size_t matchLen, const TChar* pReplace, size_t replaceLen )
+			{	// matches must be passed in increasing order, not overlapping
+				REQUIRE( pos >= m_copiedPos && pos + matchLen <= m_text.length() );
+
+				if ( 0 == m_count++ )
+					m_output.reserve( m_text.length() + replaceLen );		// allocate only if there is something to replace
+
+				m_output.append( m_text, m_copiedPos, pos - m_copiedPos );
+				if ( replaceLen != 0 )
+					m_output.append( pReplace, replaceLen );
+
+				m_copiedPos = pos + matchLen;
+			}
+
+			size_t Commit( OUT StringT& rText )
+			{	// stores the output into rText (usually the source text); returns the replaced count
+				if ( m_count != 0 )
+				{
+					m_output.append( m_text, m_copiedPos, StringT::npos );
+					rText.swap( m_output );
+				}
+				return m_count;
+			}
+		private:
+			const StringT& m_text;
+			size_t m_copiedPos;					// source text is copied to output up to this position
+			size_t m_count;
+			StringT m_output;
+		};
+	}
+
+
 	template< typename CharT >
 	size_t Replace( IN OUT std::basic_string<CharT>& rText, const CharT* pSearch, const CharT* pReplace, size_t maxCount = utl::npos )
 	{
 		ASSERT_PTR( pSearch );
 		ASSERT_PTR( pReplace );
-		size_t count = 0;
 
-		if ( !str::IsEmpty( pSearch ) )
-		{
-			const size_t searchLen = str::GetLength( pSearch ), replaceLen = str::GetLength( pReplace );
+		if ( str::IsEmpty( pSearch ) )
+			return 0;
 
-			for ( size_t pos = 0;
-				  count != maxCount && ( pos = rText.find( pSearch, pos ) ) != std::string::npos;
-				  ++count, pos += replaceLen )
-				rText.replace( pos, searchLen, pReplace );
-		}
+		const size_t searchLen = str::GetLength( pSearch ), replaceLen = str::GetLength( pReplace );
+		impl::CReplaceBuilder< std::basic_string<CharT> > builder( rText );
+
+		for ( size_t pos = 0;
+			  builder.GetCount() != maxCount && ( pos = rText.find( pSearch, pos, searchLen ) ) != std::string::npos;
+			  pos += searchLen )
+			builder.ReplaceAt( pos, searchLen, pReplace, replaceLen );
 
-		return count;
+		return builder.Commit( rText );
 	}
 
 	// defined in utl/StringCompare.h
@@ -817,19 +863,54 @@ namespace str
 	{
 		ASSERT_PTR( pDelims );
 		ASSERT_PTR( pReplace );
-		size_t count = 0;
 
-		if ( !str::IsEmpty( pDelims ) )
+		if ( str::IsEmpty( pDelims ) )
+			return 0;
+
+		const size_t replaceLen = str::GetLength( pReplace );
+		impl::CReplaceBuilder< std::basic_string<CharT> > builder( rText );
+
+		for ( size_t pos = 0;
+			  builder.GetCount() != maxCount && ( pos = rText.find_first_of( pDelims, pos ) ) != std::string::npos;
+			  ++pos )
+			builder.ReplaceAt( pos, 1, pReplace, replaceLen );
+
+		return builder.Commit( rText );
+	}
+
+
+	template< typename CharT, typename PairContainerT >
+	size_t ReplaceMultiple( IN OUT std::basic_string<CharT>& rText, const PairContainerT& searchReplacePairs, size_t maxCount = utl::npos )
+	{	// replaces all search strings in a single pass: at each position the first matching pair wins; the replacements are not searched again
+		typedef std::basic_string<CharT> TString;
+		TString firstChars;					// candidate match positions are found by the leading characters of the search strings
+
+		for ( typename PairContainerT::const_iterator itPair = searchReplacePairs.begin(); itPair != searchReplacePairs.end(); ++itPair )
+			if ( !itPair->first.empty() && TString::npos == firstChars.find( itPair->first[ 0 ] ) )
+				firstChars.push_back( itPair->first[ 0 ] );
+
+		if ( firstChars.empty() )
+			return 0;
+
+		impl::CReplaceBuilder<TString> builder( rText );
+
+		for ( size_t pos = 0; builder.GetCount() != maxCount && ( pos = rText.find_first_of( firstChars, pos ) ) != TString::npos; )
 		{
-			const size_t replaceLen = str::GetLength( pReplace );
+			typename PairContainerT::const_iterator itPair = searchReplacePairs.begin();
+
+			while ( itPair != searchReplacePairs.end() && ( itPair->first.empty() || rText.compare( pos, itPair->first.length(), itPair->first ) != 0 ) )
+				++itPair;
 
-			for ( size_t pos = 0;
-				  count != maxCount && ( pos = rText.find_first_of( pDelims, pos ) ) != std::string::npos;
-				  ++count, pos += replaceLen )
-				rText.replace( pos, 1, pReplace );
+			if ( itPair != searchReplacePairs.end() )
+			{
+				builder.ReplaceAt( pos, itPair->first.length(), itPair->second.c_str(), itPair->second.length() );
+				pos += itPair->first.length();
+			}
+			else
+				++pos;
 		}
 
-		return count;
+		return builder.Commit( rText );
 	}
 
 
@@ -22,4 +22,15 @@ namespace str
 		return pred::MakeIntuitiveComparator( func::ToChar() ).Compare( pLeft, pRight );
 	}
 
+
+	bool MakeIntuitiveSortKey( std::string& rSortKey, const char* pText )
+	{
+		return pred::IntuitiveSortKeyEncoder<func::ToChar>().Encode( rSortKey, pText );
+	}
+
+	bool MakeIntuitiveSortKey( std::string& rSortKey, const wchar_t* pText )
+	{
+		return pred::IntuitiveSortKeyEncoder<func::ToChar>().Encode( rSortKey, pText );
+	}
+
 } // namespace str
@@ -456,6 +456,10 @@ namespace str
 
 	pred::CompareResult IntuitiveCompare( const char* pLeft, const char* pRight );
 	pred::CompareResult IntuitiveCompare( const wchar_t* pLeft, const wchar_t* pRight );
+
+	// binary sort keys: the memcmp order of the keys is the IntuitiveCompare() order; return false for non-ASCII digits (not encodable)
+	bool MakeIntuitiveSortKey( std::string& rSortKey, const char* pText );
+	bool MakeIntuitiveSortKey( std::string& rSortKey, const wchar_t* pText );
 }
 
 
@@ -490,6 +494,70 @@ namespace pred
 }
 
 
+namespace str
+{
+	namespace impl
+	{
+		typedef std::pair<std::string, size_t> TSortKeyPos;		// <sort_key, original_pos>
+
+		struct GreaterSortKey
+		{
+			bool operator()( const TSortKeyPos& left, const TSortKeyPos& right ) const
+			{
+				int result = left.first.compare( right.first );
+				return result > 0 || ( 0 == result && left.second < right.second );		// stable
+			}
+		};
+
+
+		template< typename IteratorT, typename MakeSortKeyFunc >
+		bool SortBySortKeys( IteratorT itFirst, IteratorT itLast, MakeSortKeyFunc makeSortKey, bool ascending )
+		{	// makes the sort keys, sorts them, then moves the elements to their sorted positions; returns false if an element is not encodable
+			typedef typename std::iterator_traits<IteratorT>::value_type TValue;
+
+			std::vector<TSortKeyPos> sortKeys( std::distance( itFirst, itLast ) );
+			size_t pos = 0;
+
+			for ( IteratorT it = itFirst; it != itLast; ++it, ++pos )
+				if ( makeSortKey( sortKeys[ pos ].first, *it ) )
+					sortKeys[ pos ].second = pos;
+				else
+					return false;
+
+			if ( ascending )
+				std::sort( sortKeys.begin(), sortKeys.end() );		// stable: equal keys are ordered by original position
+			else
+				std::sort( sortKeys.begin(), sortKeys.end(), GreaterSortKey() );
+
+			std::vector<TValue> values( sortKeys.size() );
+			std::swap_ranges( values.begin(), values.end(), itFirst );
+
+			for ( std::vector<TSortKeyPos>::const_iterator itSortKey = sortKeys.begin(); itSortKey != sortKeys.end(); ++itSortKey, ++itFirst )
+				std::swap( *itFirst, values[ itSortKey->second ] );
+
+			return true;
+		}
+
+
+		struct ToIntuitiveSortKey
+		{
+			template< typename StringT >
+			bool operator()( std::string& rSortKey, const StringT& text ) const { return str::MakeIntuitiveSortKey( rSortKey, str::traits::GetCharPtr( text ) ); }
+		};
+	}
+
+
+	// sorts string-like elements by intuitive sort keys, each element is evaluated only once; equivalent with sorting by pred::TLess_StringyIntuitive
+	//
+	template< typename IteratorT >
+	void SortIntuitive( IteratorT itFirst, IteratorT itLast, bool ascending = true )
+	{
+		if ( !impl::SortBySortKeys( itFirst, itLast, impl::ToIntuitiveSortKey(), ascending ) )
+			std::sort( itFirst, itLast, pred::OrderByValue<pred::TStringyCompareIntuitive>( ascending ) );		// fall back to comparator sorting
+	}
+}
+
+
 namespace str
 {
 	// comparison with character translation (low-level)
@@ -798,21 +866,22 @@ namespace str
 	size_t Replace( IN OUT StringT* pString, const SeqCharT* pSearch, const SeqCharT* pReplace, size_t maxCount = utl::npos )
 	{
 		ASSERT( pString != nullptr && pSearch != nullptr && pReplace != nullptr );
-		size_t count = 0;
 
-		if ( !str::IsEmpty( pSearch ) )
+		if ( str::IsEmpty( pSearch ) )
 		{
-			const size_t searchLen = str::GetLength( pSearch ), replaceLen = str::GetLength( pReplace );
-
-			for ( size_t pos = 0;
-				  count != maxCount && ( pos = str::Find<caseType>( pString->c_str(), pSearch, searchLen, pos ) ) != std::string::npos;
-				  ++count, pos += replaceLen )
-				pString->replace( pString->begin() + pos, pString->begin() + pos + searchLen, pReplace, pReplace + replaceLen );
-		}
-		else
 			ASSERT( !str::IsEmpty( pSearch ) );		// warning assertion
+			return 0;
+		}
 
-		return count;
+		const size_t searchLen = str::GetLength( pSearch ), replaceLen = str::GetLength( pReplace );
+		str::impl::CReplaceBuilder<StringT> builder( *pString );		// single pass: linear time
+
+		for ( size_t pos = 0;
+			  builder.GetCount() != maxCount && ( pos = str::Find<caseType>( pString->c_str(), pSearch, searchLen, pos ) ) != std::string::npos;
+			  pos += searchLen )
+			builder.ReplaceAt( pos, searchLen, pReplace, replaceLen );
+
+		return builder.Commit( *pString );
 	}
 
 	template< str::CaseType caseType, typename CharT, typename SeqCharT >
@@ -3,6 +3,7 @@
 #pragma once
 
 #include "StringCompare.h"
+#include <limits>
 
 
 namespace pred
@@ -121,10 +122,119 @@ namespace pred
 	inline IntuitiveComparator<TranslateFunc> MakeIntuitiveComparator( TranslateFunc translateFunc ) { return IntuitiveComparator<TranslateFunc>( translateFunc ); }
 
 
+	// Encodes a string into a binary sort key: the memcmp order of the keys (std::string::compare) is the IntuitiveComparator order.
+	// Sorting by keys evaluates each string only once, rather than re-parsing digit sequences and case-folding on every comparison.
+	//	key: primary tokens, then the terminator, then the case tie-break (optional).
+	//	- character token: the evaluated character unit (lower-case, translated);
+	//	- number token: '0' class unit, the count of significant digits, the significant digits, then:
+	//		if the value is not zero: 0xFFFFFFFF - leadingZeroCount (more leading zeros go first);
+	//		if the value is zero: the leading zeros as '0' units (compared against the next character, as the comparator does).
+	// Each unit is fixed-width big-endian, with the sign bit flipped for signed characters.
+	//
+	template< typename TranslateFunc >
+	struct IntuitiveSortKeyEncoder
+	{
+		IntuitiveSortKeyEncoder( TranslateFunc translateFunc = TranslateFunc() )
+			: m_translateChar( translateFunc )
+			, m_evalChar( translateFunc )
+		{
+		}
+
+		template< typename CharT >
+		bool Encode( std::string& rSortKey, const CharT* pText, bool caseTieBreak = true ) const
+		{	// returns false for text that cannot be encoded (non-ASCII digits): sort by comparator instead
+			REQUIRE( pText != nullptr );
+			rSortKey.clear();
+
+			for ( const CharT* pChar = pText; *pChar != '\0'; )
+				if ( IsAsciiDigit( *pChar ) )
+				{
+					if ( !EncodeNumber( rSortKey, pChar ) )
+						return false;
+				}
+				else if ( s_isDigit( *pChar ) )
+					return false;						// non-ASCII digit: its numeric value is not encodable
+				else
+				{
+					CharT evalChar = m_evalChar( *pChar++ );
+					if ( IsAsciiDigit( evalChar ) )
+						return false;					// would collide with the number class unit
+					AppendUnit( rSortKey, evalChar );
+				}
+
+			AppendUnit( rSortKey, m_evalChar( CharT( '\0' ) ) );		// terminator: a prefix goes first
+
+			if ( caseTieBreak )						// equal primary keys have the same length, so the tie-break units are aligned
+				for ( const CharT* pChar = pText; *pChar != '\0'; ++pChar )
+					AppendUnit( rSortKey, m_translateChar( *pChar ) );
+
+			return true;
+		}
+	private:
+		template< typename CharT >
+		static bool IsAsciiDigit( CharT chr ) { return chr >= '0' && chr <= '9'; }
+
+		template< typename CharT >
+		static bool EncodeNumber( std::string& rSortKey, const CharT*& rpChar )
+		{
+			size_t zeroCount = 0;
+			for ( ; '0' == *rpChar; ++rpChar )
+				++zeroCount;
+
+			const CharT* pDigits = rpChar;
+			while ( IsAsciiDigit( *rpChar ) )
+				++rpChar;
+
+			if ( s_isDigit( *rpChar ) )
+				return false;							// sequence continued by a non-ASCII digit
+
+			size_t digitCount = std::distance( pDigits, rpChar );
+
+			AppendUnit( rSortKey, CharT( '0' ) );		// class unit: orders numbers against any other character
+			AppendBigEndian( rSortKey, digitCount, sizeof( UINT ) );		// longer number -> greater value
+			for ( const CharT* pDigit = pDigits; pDigit != rpChar; ++pDigit )
+				AppendUnit( rSortKey, *pDigit );
+
+			if ( digitCount != 0 )
+				AppendBigEndian( rSortKey, UINT_MAX - zeroCount, sizeof( UINT ) );
+			else
+				for ( ; zeroCount != 0; --zeroCount )
+					AppendUnit( rSortKey, CharT( '0' ) );
+			return true;
+		}
+
+		template< typename CharT >
+		static void AppendUnit( std::string& rSortKey, CharT chr )
+		{
+			UINT64 value = static_cast<UINT64>( chr );
+
+			if ( std::numeric_limits<CharT>::is_signed )
+				value ^= UINT64( 1 ) << ( sizeof( CharT ) * 8 - 1 );		// signed order -> unsigned order
+
+			AppendBigEndian( rSortKey, value, sizeof( CharT ) );
+		}
+
+		static void AppendBigEndian( std::string& rSortKey, UINT64 value, size_t byteCount )
+		{
+			while ( byteCount-- != 0 )
+				rSortKey.push_back( static_cast<char>( ( value >> ( byteCount * 8 ) ) & 0xFF ) );
+		}
+	private:
+		typedef func::ToCharAs<func::C::ToLower, TranslateFunc> TLowerTranslatedFunc;
+
+		TranslateFunc m_translateChar;
+		TLowerTranslatedFunc m_evalChar;
+		static const pred::IsDigit s_isDigit;
+	};
+
+
 	// define template static data-members
 
 	template< typename TranslateFunc >
 	const pred::IsDigit pred::IntuitiveComparator<TranslateFunc>::s_isDigit;
+
+	template< typename TranslateFunc >
+	const pred::IsDigit pred::IntuitiveSortKeyEncoder<TranslateFunc>::s_isDigit;
 }
 
 
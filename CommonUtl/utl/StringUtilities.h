@@ -94,16 +94,14 @@ namespace str
 	inline size_t StripDelimiters( IN OUT StringT& rText, const typename StringT::value_type delimiters[] )
 	{
 		ASSERT( !str::IsEmpty( delimiters ) );
-		size_t count = 0;
+		str::impl::CReplaceBuilder<StringT> builder( rText );		// single pass: linear time
 
 		for ( size_t pos = 0;
 			  ( pos = rText.find_first_of( delimiters, pos ) ) != std::string::npos;
-			  ++count )
-		{
-			rText.erase( pos, 1 );
-		}
+			  ++pos )
+			builder.ReplaceAt( pos, 1, nullptr, 0 );
 
-		return count;
+		return builder.Commit( rText );
 	}
 
 
@@ -114,10 +112,9 @@ namespace str
 	{
 		ASSERT( !str::IsEmpty( delimiters ) );
 		size_t count = 0, replaceLen = str::GetLength( pNewDelimiters );
+		str::impl::CReplaceBuilder<StringT> builder( rText );		// single pass: linear time
 
-		for ( size_t pos = 0;
-			  ( pos = rText.find_first_of( delimiters, pos ) ) != std::string::npos;
-			  pos += replaceLen )
+		for ( size_t pos = 0; ( pos = rText.find_first_of( delimiters, pos ) ) != std::string::npos; )
 		{
 			size_t delimEndPos = rText.find_first_not_of( delimiters, pos );
 			if ( StringT::npos == delimEndPos )
@@ -125,10 +122,12 @@ namespace str
 
 			size_t delimCount = delimEndPos - pos;
 
-			rText.replace( pos, delimCount, pNewDelimiters );
+			builder.ReplaceAt( pos, delimCount, pNewDelimiters, replaceLen );		// the whole sequence of delimiters
 			count += delimCount;
+			pos = delimEndPos;
 		}
 
+		builder.Commit( rText );
 		return count;
 	}
 
@@ -210,8 +210,8 @@ namespace io
 			if ( 0 == charCount )
 				return 0;
 
-			m_buffer.assign( pText, pText + charCount );
-			std::for_each( m_buffer.begin(), m_buffer.end(), func::SwapBytes<endian::Little, endian::Big>() );
+			m_buffer.resize( charCount );
+			endian::SwapBytesSpan( &m_buffer.front(), pText, charCount );
 			return __super::WriteEncoded( &m_buffer.front(), charCount ) * sizeof( wchar_t );
 		}
 	private:
@@ -293,6 +293,38 @@ namespace io
 		{
 			return ch;
 		}
+
+		virtual bool IsIdentity( void ) const
+		{
+			return true;
+		}
+
+		virtual void DecodeSpan( char* pDest, const char* pRawSrc, size_t count ) const
+		{
+			CopySpan( pDest, pRawSrc, count );
+		}
+
+		virtual void DecodeSpan( wchar_t* pDest, const wchar_t* pRawSrc, size_t count ) const
+		{
+			CopySpan( pDest, pRawSrc, count );
+		}
+
+		virtual void EncodeSpan( char* pRawDest, const char* pSrc, size_t count ) const
+		{
+			CopySpan( pRawDest, pSrc, count );
+		}
+
+		virtual void EncodeSpan( wchar_t* pRawDest, const wchar_t* pSrc, size_t count ) const
+		{
+			CopySpan( pRawDest, pSrc, count );
+		}
+	protected:
+		template< typename CharT >
+		static void CopySpan( CharT* pDest, const CharT* pSrc, size_t count )
+		{
+			if ( pDest != pSrc && count != 0 )
+				std::memcpy( pDest, pSrc, count * sizeof( CharT ) );
+		}
 	private:
 		fs::Encoding m_encoding;
 	};
@@ -316,6 +348,21 @@ namespace io
 		{
 			return endian::GetBytesSwapped<endian::Little, endian::Big>()( ch );		// just a formality: encoding and decoding are isomorphic (byte swapping is reversible)
 		}
+
+		virtual bool IsIdentity( void ) const
+		{
+			return false;
+		}
+
+		virtual void DecodeSpan( wchar_t* pDest, const wchar_t* pRawSrc, size_t count ) const
+		{
+			endian::SwapBytesSpan( pDest, pRawSrc, count );
+		}
+
+		virtual void EncodeSpan( wchar_t* pRawDest, const wchar_t* pSrc, size_t count ) const
+		{
+			endian::SwapBytesSpan( pRawDest, pSrc, count );
+		}
 	};
 
 
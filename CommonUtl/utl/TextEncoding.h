@@ -121,6 +121,7 @@ namespace io
 	interface ICharCodec : public utl::IMemoryManaged
 	{
 		virtual fs::Encoding GetEncoding( void ) const = 0;
+		virtual bool IsIdentity( void ) const = 0;			// raw characters are used as is? (no byte-swapping)
 
 		virtual char Decode( const char& rawCh ) const = 0;
 		virtual wchar_t Decode( const wchar_t& rawCh ) const = 0;
@@ -128,6 +129,13 @@ namespace io
 		virtual char Encode( const char& ch ) const = 0;
 		virtual wchar_t Encode( const wchar_t& ch ) const = 0;
 
+		// span versions: one virtual call per buffer rather than per character; pDest may be the same as pSrc (in-place)
+		virtual void DecodeSpan( char* pDest, const char* pRawSrc, size_t count ) const = 0;
+		virtual void DecodeSpan( wchar_t* pDest, const wchar_t* pRawSrc, size_t count ) const = 0;
+
+		virtual void EncodeSpan( char* pRawDest, const char* pSrc, size_t count ) const = 0;
+		virtual void EncodeSpan( wchar_t* pRawDest, const wchar_t* pSrc, size_t count ) const = 0;
+
 		template< typename TraitsT >
 		typename TraitsT::int_type DecodeMeta( const typename TraitsT::int_type& metaRawCh ) const
 		{
@@ -160,10 +160,64 @@ bool CDibPixels::PreMultiplyAlpha( bool autoCheckPMA /*= false*/ )
 		if ( !NeedsPreMultiplyAlpha() )
 			return false;
 
-	typedef CPixelBGRA* iterator;
-	for ( iterator pPixel = Begin<CPixelBGRA>(), pPixelEnd = End<CPixelBGRA>(); pPixel != pPixelEnd; ++pPixel )
-		pPixel->PreMultiplyAlpha();
+	pixel::kernel::PreMultiplyAlpha( GetBufferBGRA() );
+	return true;
+}
+
+bool CDibPixels::ApplyGrayScale( COLORREF transpColor24 /*= CLR_NONE*/ )
+{
+	if ( !UseKernels() )
+		return ForEach( func::ToGrayScale( transpColor24 ) );
+
+	pixel::kernel::ToGrayScale( GetBufferBGRA() );
+	return true;
+}
+
+bool CDibPixels::ApplyAlphaBlend( BYTE alpha, COLORREF blendColor24 /*= color::AzureBlue*/ )
+{
+	if ( !UseKernels() )
+		return ForEach( func::AlphaBlend( alpha, blendColor24 ) );
+
+	pixel::kernel::MultiplyAlpha( GetBufferBGRA(), alpha, alpha / 255.0 );		// same as func::AlphaBlend on CPixelBGRA
+	return true;
+}
+
+bool CDibPixels::ApplyBlendColor( COLORREF toColor24, BYTE toAlpha )
+{
+	if ( !UseKernels() )
+		return ForEach( func::BlendColor( toColor24, toAlpha ) );
+
+	pixel::kernel::BlendColor( GetBufferBGRA(), CPixelBGRA( toColor24, toAlpha ) );
+	return true;
+}
+
+bool CDibPixels::ApplyDisableFadeGray( BYTE fadeAlpha /*= gdi::AlphaFadeMore*/, bool preMultiplyAlpha /*= true*/, COLORREF transpColor /*= CLR_NONE*/ )
+{
+	if ( !UseKernels() )
+		return ForEach( func::DisableFadeGray( fadeAlpha, preMultiplyAlpha, transpColor ) );
+
+	pixel::kernel::DisableFadeGray( GetBufferBGRA(), fadeAlpha, preMultiplyAlpha );		// transpColor doesn't apply to BGRA pixels
+	return true;
+}
+
+bool CDibPixels::ApplyDisabledGrayOut( COLORREF toColor24, BYTE toAlpha /*= 64*/ )
+{
+	if ( !UseKernels() )
+		return ForEach( func::DisabledGrayOut( toColor24, toAlpha ) );
+
+	pixel::kernel::DisabledGrayOut( GetBufferBGRA(), CPixelBGRA( toColor24, toAlpha ) );
+	return true;
+}
+
+bool CDibPixels::ApplyDisabledGrayEffect_( COLORREF toColor24, BYTE toAlpha /*= 64*/ )
+{
+	if ( !UseKernels() )
+		return ForEach( func::_DisabledGrayEffect( toColor24, toAlpha ) );
+
+	pixel::CBufferBGRA buffer = GetBufferBGRA();
 
+	pixel::kernel::ToGrayScale( buffer );
+	pixel::kernel::MultiplyAlpha( buffer, toAlpha, toAlpha / 255.0 );
 	return true;
 }
 
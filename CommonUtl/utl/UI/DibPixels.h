@@ -5,6 +5,7 @@
 #include "ScopedBitmapMemDC.h"
 #include "Image_fwd.h"
 #include "Pixel.h"
+#include "PixelKernels.h"
 
 
 class CDibSection;
@@ -87,20 +88,18 @@ public:
 	void SetOpaque( void ) { SetAlpha( 255 ); }
 	void Fill( COLORREF color, BYTE alpha = 255 ) { ForEach( func::SetColor( color, alpha ) ); }
 
-	// conversion effects
-	bool ApplyGrayScale( COLORREF transpColor24 = CLR_NONE ) { return ForEach( func::ToGrayScale( transpColor24 ) ); }
-	bool ApplyAlphaBlend( BYTE alpha, COLORREF blendColor24 = color::AzureBlue ) { return ForEach( func::AlphaBlend( alpha, blendColor24 ) ); }
-	bool ApplyBlendColor( COLORREF toColor24, BYTE toAlpha ) { return ForEach( func::BlendColor( toColor24, toAlpha ) ); }
-
-	bool ApplyDisableFadeGray( BYTE fadeAlpha = gdi::AlphaFadeMore, bool preMultiplyAlpha = true, COLORREF transpColor = CLR_NONE )		// best looking!
-	{
-		return ForEach( func::DisableFadeGray( fadeAlpha, preMultiplyAlpha, transpColor ) );
-	}
-
-	bool ApplyDisabledGrayOut( COLORREF toColor24, BYTE toAlpha = 64 ) { return ForEach( func::DisabledGrayOut( toColor24, toAlpha ) ); }
-	bool ApplyDisabledEffect( COLORREF toColor24, BYTE toAlpha = 64 ) { return ForEach( func::DisabledEffect( toColor24, toAlpha ) ); }
-	bool ApplyDisabledGrayEffect_( COLORREF toColor24, BYTE toAlpha = 64 ) { return ForEach( func::_DisabledGrayEffect( toColor24, toAlpha ) ); }
+	// conversion effects: 32bpp bitmaps use the vectorized pixel kernels
+	bool ApplyGrayScale( COLORREF transpColor24 = CLR_NONE );
+	bool ApplyAlphaBlend( BYTE alpha, COLORREF blendColor24 = color::AzureBlue );
+	bool ApplyBlendColor( COLORREF toColor24, BYTE toAlpha );
+	bool ApplyDisableFadeGray( BYTE fadeAlpha = gdi::AlphaFadeMore, bool preMultiplyAlpha = true, COLORREF transpColor = CLR_NONE );		// best looking!
+	bool ApplyDisabledGrayOut( COLORREF toColor24, BYTE toAlpha = 64 );
+	bool ApplyDisabledEffect( COLORREF toColor24, BYTE toAlpha = 64 ) { return ApplyAlphaBlend( toAlpha, toColor24 ); }		// same as func::DisabledEffect
+	bool ApplyDisabledGrayEffect_( COLORREF toColor24, BYTE toAlpha = 64 );
 private:
+	bool UseKernels( void ) const { return IsValid() && HasAlpha(); }
+	pixel::CBufferBGRA GetBufferBGRA( void ) { ASSERT( UseKernels() ); return pixel::CBufferBGRA( m_pPixels, m_width, m_height, m_stride ); }
+
 	static CDibSection* MakeLocalDibSection( HBITMAP hDib );
 	void Reset( void );
 	COLORREF* GetTranspColorPtr( void );
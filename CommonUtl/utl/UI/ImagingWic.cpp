@@ -2,6 +2,7 @@
 #include "pch.h"
 #include "ImagingWic.h"
 #include "Imaging.h"
+#include "PixelResampler.h"
 #include "ResourceData.h"
 #include "StreamStdTypes.h"
 #include "StructuredStorage.h"
@@ -855,6 +856,52 @@ namespace wic
 		return ScaleBitmap( pWicBitmap, ui::StretchToFit( boundsSize, GetBitmapSize( pWicBitmap ) ), interpolationMode  );
 	}
 
+	CComPtr<IWICBitmapSource> ResampleBitmap( IWICBitmapSource* pWicBitmap, const CSize& newSize, pixel::ResampleFilter filter )
+	{
+		ASSERT_PTR( pWicBitmap );
+
+		CComPtr<IWICBitmapSource> pSrcBitmap;
+		if ( !HR_OK( ::WICConvertBitmapSource( GUID_WICPixelFormat32bppPBGRA, pWicBitmap, &pSrcBitmap ) ) )		// resample pre-multiplied alpha pixels
+			return nullptr;
+
+		const CSize srcSize = GetBitmapSize( pSrcBitmap );
+		if ( 0 == srcSize.cx || 0 == srcSize.cy || newSize.cx <= 0 || newSize.cy <= 0 )
+			return nullptr;
+
+		UINT srcStride = srcSize.cx * sizeof( CPixelBGRA );
+		std::vector<BYTE> srcPixels( srcStride * srcSize.cy );
+
+		if ( !HR_OK( pSrcBitmap->CopyPixels( nullptr, srcStride, static_cast<UINT>( srcPixels.size() ), &srcPixels.front() ) ) )
+			return nullptr;
+
+		CComPtr<IWICBitmap> pDestBitmap;
+		if ( HR_OK( CImagingFactory::Factory()->CreateBitmap( newSize.cx, newSize.cy, GUID_WICPixelFormat32bppPBGRA, WICBitmapCacheOnLoad, &pDestBitmap ) ) )
+		{
+			WICRect lockRect = { 0, 0, newSize.cx, newSize.cy };
+			CComPtr<IWICBitmapLock> pDestLock;
+
+			if ( HR_OK( pDestBitmap->Lock( &lockRect, WICBitmapLockWrite, &pDestLock ) ) )
+			{
+				UINT destStride = 0, destBufferSize = 0;
+				BYTE* pDestPixels = nullptr;
+
+				if ( HR_OK( pDestLock->GetStride( &destStride ) ) && HR_OK( pDestLock->GetDataPointer( &destBufferSize, &pDestPixels ) ) )
+				{
+					pixel::Resample( pixel::CBufferBGRA( pDestPixels, newSize.cx, newSize.cy, destStride ),
+									 pixel::CBufferBGRA( &srcPixels.front(), srcSize.cx, srcSize.cy, srcStride ), filter );
+
+					return &*pDestBitmap;		// up-cast; the lock is released on return
+				}
+			}
+		}
+		return nullptr;
+	}
+
+	CComPtr<IWICBitmapSource> ResampleBitmapToBounds( IWICBitmapSource* pWicBitmap, const CSize& boundsSize, pixel::ResampleFilter filter )
+	{
+		return ResampleBitmap( pWicBitmap, ui::StretchToFit( boundsSize, GetBitmapSize( pWicBitmap ) ), filter );
+	}
+
 
 
 	namespace cvt
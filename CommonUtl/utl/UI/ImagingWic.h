@@ -6,6 +6,7 @@
 #include "Image_fwd.h"
 #include "ErrorHandler.h"
 #include "ImagingWic_fwd.h"
+#include "PixelResampler.h"
 
 
 class CEnumTags;
@@ -175,6 +176,10 @@ namespace wic
 	CComPtr<IWICBitmapScaler> ScaleBitmap( IWICBitmapSource* pWicBitmap, const CSize& newSize, WICBitmapInterpolationMode interpolationMode = WICBitmapInterpolationModeFant );
 	CComPtr<IWICBitmapScaler> ScaleBitmapToBounds( IWICBitmapSource* pWicBitmap, const CSize& boundsSize, WICBitmapInterpolationMode interpolationMode = WICBitmapInterpolationModeFant );
 
+	// in-house parallel resampling to a 32bpp PBGRA bitmap: faster than the WIC scaler on large downscaling ratios (thumbnails)
+	CComPtr<IWICBitmapSource> ResampleBitmap( IWICBitmapSource* pWicBitmap, const CSize& newSize, pixel::ResampleFilter filter );
+	CComPtr<IWICBitmapSource> ResampleBitmapToBounds( IWICBitmapSource* pWicBitmap, const CSize& boundsSize, pixel::ResampleFilter filter );
+
 
 	namespace cvt
 	{
@@ -0,0 +1,487 @@
+
+#include "pch.h"
+#include "PixelKernels.h"
+
+#if defined( _M_IX86 ) || defined( _M_X64 )
+	#define USE_PIXEL_SIMD
+	#include <intrin.h>
+	#include <emmintrin.h>
+
+	#if _MSC_VER >= 1700			// AVX2 intrinsics available since VS 2012
+		#define USE_PIXEL_AVX2
+		#include <immintrin.h>
+	#endif
+#endif
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+
+namespace pixel
+{
+	namespace impl
+	{
+		InstructionSet DetectInstructionSet( void )
+		{
+		#ifdef USE_PIXEL_SIMD
+			enum { Sse2Bit = 1 << 26, OsXSaveBit = 1 << 27, AvxBit = 1 << 28, Avx2Bit = 1 << 5 };
+			int cpuInfo[ 4 ];		// EAX, EBX, ECX, EDX
+
+			__cpuid( cpuInfo, 0 );
+			int maxLeaf = cpuInfo[ 0 ];
+
+			__cpuid( cpuInfo, 1 );
+			bool hasSse2 = HasFlag( cpuInfo[ 3 ], Sse2Bit );
+
+		#ifdef USE_PIXEL_AVX2
+			if ( maxLeaf >= 7 && HasFlag( cpuInfo[ 2 ], OsXSaveBit ) && HasFlag( cpuInfo[ 2 ], AvxBit ) )
+				if ( 0x6 == ( _xgetbv( 0 ) & 0x6 ) )			// the OS saves the XMM and YMM registers state on context switch?
+				{
+					__cpuidex( cpuInfo, 7, 0 );
+					if ( HasFlag( cpuInfo[ 1 ], Avx2Bit ) )
+						return Avx2Set;
+				}
+		#else
+			maxLeaf;
+		#endif
+
+			if ( hasSse2 )
+				return Sse2Set;
+		#endif
+			return ScalarSet;
+		}
+
+		InstructionSet& RefInstructionSet( void )
+		{
+			static InstructionSet s_instructionSet = GetMaxInstructionSet();
+			return s_instructionSet;
+		}
+
+		inline InstructionSet ClampInstructionSet( InstructionSet instructionSet )
+		{
+			return std::min( instructionSet, GetMaxInstructionSet() );
+		}
+	}
+
+
+	InstructionSet GetMaxInstructionSet( void )
+	{
+		static const InstructionSet s_maxInstructionSet = impl::DetectInstructionSet();
+		return s_maxInstructionSet;
+	}
+
+	InstructionSet GetInstructionSet( void )
+	{
+		return impl::RefInstructionSet();
+	}
+
+	InstructionSet SetInstructionSet( InstructionSet instructionSet )
+	{
+		InstructionSet oldInstructionSet = impl::RefInstructionSet();
+		impl::RefInstructionSet() = impl::ClampInstructionSet( instructionSet );
+		return oldInstructionSet;
+	}
+
+	const TCHAR* GetInstructionSetName( InstructionSet instructionSet )
+	{
+		static const TCHAR* s_names[] = { _T("Scalar"), _T("SSE2"), _T("AVX2") };
+		ASSERT( instructionSet < COUNT_OF( s_names ) );
+		return s_names[ instructionSet ];
+	}
+}
+
+
+namespace pixel
+{
+	namespace impl
+	{
+		template< typename PixelFunc >
+		void ForEachPixel( const CBufferBGRA& buffer, const PixelFunc& func )
+		{
+			for ( UINT y = 0; y != buffer.m_height; ++y )
+				for ( CPixelBGRA* pPixel = buffer.GetRow( y ), *pPixelEnd = pPixel + buffer.m_width; pPixel != pPixelEnd; ++pPixel )
+					func( *pPixel );
+		}
+
+
+		struct CPreMultiplyAlpha
+		{
+			void operator()( CPixelBGRA& rPixel ) const { rPixel.PreMultiplyAlpha(); }
+		};
+
+
+		struct CLookupChannels
+		{
+			CLookupChannels( const BYTE colorTable[ 256 ], const BYTE alphaTable[ 256 ] ) : m_pColorTable( colorTable ), m_pAlphaTable( alphaTable ) {}
+
+			void operator()( CPixelBGRA& rPixel ) const
+			{
+				rPixel.m_blue = m_pColorTable[ rPixel.m_blue ];
+				rPixel.m_green = m_pColorTable[ rPixel.m_green ];
+				rPixel.m_red = m_pColorTable[ rPixel.m_red ];
+				rPixel.m_alpha = m_pAlphaTable[ rPixel.m_alpha ];
+			}
+		private:
+			const BYTE* m_pColorTable;
+			const BYTE* m_pAlphaTable;
+		};
+	}
+}
+
+
+#ifdef USE_PIXEL_SIMD
+
+namespace pixel
+{
+	namespace impl
+	{
+		// Vector operations on pixels widened to 16-bit channels: each pixel takes 4 lanes (B, G, R, A).
+		// Both instruction sets unpack and pack within 128-bit lanes, so the pixel order is preserved on the round trip.
+
+		struct CSse2Ops
+		{
+			typedef __m128i TVec;
+			enum { PixelCount = sizeof( TVec ) / sizeof( CPixelBGRA ) };
+
+			static TVec Load( const CPixelBGRA* pPixels ) { return _mm_loadu_si128( reinterpret_cast<const TVec*>( pPixels ) ); }
+			static void Store( CPixelBGRA* pPixels, TVec pixels ) { _mm_storeu_si128( reinterpret_cast<TVec*>( pPixels ), pixels ); }
+
+			static TVec WidenLo( TVec pixels ) { return _mm_unpacklo_epi8( pixels, _mm_setzero_si128() ); }
+			static TVec WidenHi( TVec pixels ) { return _mm_unpackhi_epi8( pixels, _mm_setzero_si128() ); }
+			static TVec Narrow( TVec lo, TVec hi ) { return _mm_packus_epi16( lo, hi ); }
+
+			static TVec Zero( void ) { return _mm_setzero_si128(); }
+			static TVec SetChannels( short blue, short green, short red, short alpha ) { return _mm_set_epi16( alpha, red, green, blue, alpha, red, green, blue ); }
+
+			static TVec And( TVec left, TVec right ) { return _mm_and_si128( left, right ); }
+			static TVec AndNot( TVec mask, TVec value ) { return _mm_andnot_si128( mask, value ); }
+			static TVec Or( TVec left, TVec right ) { return _mm_or_si128( left, right ); }
+			static TVec Equal( TVec left, TVec right ) { return _mm_cmpeq_epi16( left, right ); }
+			static TVec Add( TVec left, TVec right ) { return _mm_add_epi16( left, right ); }
+			static TVec Multiply( TVec left, TVec right ) { return _mm_mullo_epi16( left, right ); }
+
+			static TVec Div255( TVec value )		// exact floor( value / 255 ) for value in [0, 255*255]
+			{
+				return _mm_srli_epi16( _mm_add_epi16( _mm_add_epi16( value, _mm_set1_epi16( 1 ) ), _mm_srli_epi16( value, 8 ) ), 8 );
+			}
+
+			static TVec Div100( TVec value )		// exact floor( value / 100 ) for value in [0, 100*255]: ( value * 41944 ) >> 22
+			{
+				return _mm_srli_epi16( _mm_mulhi_epu16( value, _mm_set1_epi16( (short)41944 ) ), 6 );
+			}
+
+			static TVec BroadcastAlpha( TVec pixels ) { return _mm_shufflehi_epi16( _mm_shufflelo_epi16( pixels, _MM_SHUFFLE( 3, 3, 3, 3 ) ), _MM_SHUFFLE( 3, 3, 3, 3 ) ); }
+			static TVec BroadcastBlue( TVec pixels ) { return _mm_shufflehi_epi16( _mm_shufflelo_epi16( pixels, _MM_SHUFFLE( 0, 0, 0, 0 ) ), _MM_SHUFFLE( 0, 0, 0, 0 ) ); }
+
+			static TVec WeightedSum( TVec pixels, TVec weights )		// sum of weighted channels into the blue lane of each pixel
+			{
+				TVec pairSums = _mm_madd_epi16( pixels, weights );		// ( B*wB + G*wG, R*wR + A*wA ) as 32-bit per pixel
+				return _mm_add_epi32( pairSums, _mm_shuffle_epi32( pairSums, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+			}
+		};
+
+
+	#ifdef USE_PIXEL_AVX2
+		struct CAvx2Ops
+		{
+			typedef __m256i TVec;
+			enum { PixelCount = sizeof( TVec ) / sizeof( CPixelBGRA ) };
+
+			static TVec Load( const CPixelBGRA* pPixels ) { return _mm256_loadu_si256( reinterpret_cast<const TVec*>( pPixels ) ); }
+			static void Store( CPixelBGRA* pPixels, TVec pixels ) { _mm256_storeu_si256( reinterpret_cast<TVec*>( pPixels ), pixels ); }
+
+			static TVec WidenLo( TVec pixels ) { return _mm256_unpacklo_epi8( pixels, _mm256_setzero_si256() ); }
+			static TVec WidenHi( TVec pixels ) { return _mm256_unpackhi_epi8( pixels, _mm256_setzero_si256() ); }
+			static TVec Narrow( TVec lo, TVec hi ) { return _mm256_packus_epi16( lo, hi ); }
+
+			static TVec Zero( void ) { return _mm256_setzero_si256(); }
+
+			static TVec SetChannels( short blue, short green, short red, short alpha )
+			{
+				return _mm256_set_epi16( alpha, red, green, blue, alpha, red, green, blue, alpha, red, green, blue, alpha, red, green, blue );
+			}
+
+			static TVec And( TVec left, TVec right ) { return _mm256_and_si256( left, right ); }
+			static TVec AndNot( TVec mask, TVec value ) { return _mm256_andnot_si256( mask, value ); }
+			static TVec Or( TVec left, TVec right ) { return _mm256_or_si256( left, right ); }
+			static TVec Equal( TVec left, TVec right ) { return _mm256_cmpeq_epi16( left, right ); }
+			static TVec Add( TVec left, TVec right ) { return _mm256_add_epi16( left, right ); }
+			static TVec Multiply( TVec left, TVec right ) { return _mm256_mullo_epi16( left, right ); }
+
+			static TVec Div255( TVec value )
+			{
+				return _mm256_srli_epi16( _mm256_add_epi16( _mm256_add_epi16( value, _mm256_set1_epi16( 1 ) ), _mm256_srli_epi16( value, 8 ) ), 8 );
+			}
+
+			static TVec Div100( TVec value )
+			{
+				return _mm256_srli_epi16( _mm256_mulhi_epu16( value, _mm256_set1_epi16( (short)41944 ) ), 6 );
+			}
+
+			static TVec BroadcastAlpha( TVec pixels ) { return _mm256_shufflehi_epi16( _mm256_shufflelo_epi16( pixels, _MM_SHUFFLE( 3, 3, 3, 3 ) ), _MM_SHUFFLE( 3, 3, 3, 3 ) ); }
+			static TVec BroadcastBlue( TVec pixels ) { return _mm256_shufflehi_epi16( _mm256_shufflelo_epi16( pixels, _MM_SHUFFLE( 0, 0, 0, 0 ) ), _MM_SHUFFLE( 0, 0, 0, 0 ) ); }
+
+			static TVec WeightedSum( TVec pixels, TVec weights )
+			{
+				TVec pairSums = _mm256_madd_epi16( pixels, weights );
+				return _mm256_add_epi32( pairSums, _mm256_shuffle_epi32( pairSums, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+			}
+		};
+	#endif //USE_PIXEL_AVX2
+
+
+		// Applies the vector kernel on pixel blocks, and the kernel's scalar functor on the remaining pixels of each row.
+		//
+		template< typename Ops, typename KernelT >
+		void ForEachVector( const CBufferBGRA& buffer, const KernelT& kernel )
+		{
+			typedef typename Ops::TVec TVec;
+
+			for ( UINT y = 0; y != buffer.m_height; ++y )
+			{
+				CPixelBGRA* pPixel = buffer.GetRow( y );
+				CPixelBGRA* pPixelEnd = pPixel + buffer.m_width;
+
+				for ( ; pPixelEnd - pPixel >= Ops::PixelCount; pPixel += Ops::PixelCount )
+				{
+					TVec pixels = Ops::Load( pPixel );
+					Ops::Store( pPixel, Ops::Narrow( kernel( Ops::WidenLo( pixels ) ), kernel( Ops::WidenHi( pixels ) ) ) );
+				}
+
+				for ( ; pPixel != pPixelEnd; ++pPixel )
+					kernel( *pPixel );
+			}
+		}
+
+
+		template< typename Ops >
+		abstract class CBaseKernel
+		{
+		protected:
+			typedef typename Ops::TVec TVec;
+
+			CBaseKernel( void )
+				: m_colorMask( Ops::SetChannels( -1, -1, -1, 0 ) )
+				, m_alphaMask( Ops::SetChannels( 0, 0, 0, -1 ) )
+				, m_alphaIdentity( Ops::SetChannels( 0, 0, 0, 255 ) )
+				, m_lumaWeights( Ops::SetChannels( 11, 59, 30, 0 ) )
+			{
+			}
+
+			TVec PreMultiplyAlpha( TVec pixels ) const
+			{	// multiply the colors by alpha, and alpha by 255 (unchanged)
+				TVec factors = Ops::Or( Ops::And( Ops::BroadcastAlpha( pixels ), m_colorMask ), m_alphaIdentity );
+				return Ops::Div255( Ops::Multiply( pixels, factors ) );
+			}
+
+			TVec ToGrayScale( TVec pixels ) const
+			{	// ( R*30 + G*59 + B*11 ) / 100, which also preserves the grays
+				TVec gray = Ops::Div100( Ops::BroadcastBlue( Ops::WeightedSum( pixels, m_lumaWeights ) ) );
+				return Ops::Or( Ops::And( gray, m_colorMask ), Ops::And( pixels, m_alphaMask ) );
+			}
+
+			TVec SelectTransparent( TVec pixels, TVec newPixels ) const		// keep the pixels with alpha=0 unchanged
+			{
+				TVec transparentMask = Ops::Equal( Ops::BroadcastAlpha( pixels ), Ops::Zero() );
+				return Ops::Or( Ops::And( transparentMask, pixels ), Ops::AndNot( transparentMask, newPixels ) );
+			}
+		protected:
+			TVec m_colorMask;
+			TVec m_alphaMask;
+			TVec m_alphaIdentity;
+			TVec m_lumaWeights;
+		};
+
+
+		template< typename Ops >
+		class CPreMultiplyAlphaKernel : public CBaseKernel<Ops>
+		{
+		public:
+			typedef typename Ops::TVec TVec;
+
+			void operator()( CPixelBGRA& rPixel ) const { rPixel.PreMultiplyAlpha(); }
+			TVec operator()( TVec pixels ) const { return this->PreMultiplyAlpha( pixels ); }
+		};
+
+
+		template< typename Ops >
+		class CGrayScaleKernel : public CBaseKernel<Ops>
+		{
+		public:
+			typedef typename Ops::TVec TVec;
+
+			void operator()( CPixelBGRA& rPixel ) const { pixel::ToGrayScale( rPixel ); }
+			TVec operator()( TVec pixels ) const { return this->ToGrayScale( pixels ); }
+		};
+
+
+		template< typename Ops >
+		class CBlendColorKernel : public CBaseKernel<Ops>
+		{
+		public:
+			typedef typename Ops::TVec TVec;
+
+			CBlendColorKernel( const CPixelBGRA& toPixel )
+				: m_toPixel( toPixel )
+				, m_fromFactors( Ops::SetChannels( 255 - toPixel.m_alpha, 255 - toPixel.m_alpha, 255 - toPixel.m_alpha, 255 ) )
+				, m_toTerms( Ops::SetChannels( GetMultiplyChannel( toPixel.m_blue, toPixel.m_alpha ), GetMultiplyChannel( toPixel.m_green, toPixel.m_alpha ), GetMultiplyChannel( toPixel.m_red, toPixel.m_alpha ), 0 ) )
+			{
+			}
+
+			void operator()( CPixelBGRA& rPixel ) const { pixel::BlendColor( rPixel, m_toPixel ); }
+			TVec operator()( TVec pixels ) const { return this->SelectTransparent( pixels, this->PreMultiplyAlpha( Blend( pixels ) ) ); }
+		protected:
+			TVec Blend( TVec pixels ) const
+			{	// BlendChannel(): c * ( 255 - toAlpha ) / 255 + toC * toAlpha / 255; alpha unchanged
+				return Ops::Add( Ops::Div255( Ops::Multiply( pixels, m_fromFactors ) ), m_toTerms );
+			}
+		private:
+			CPixelBGRA m_toPixel;
+			TVec m_fromFactors;
+			TVec m_toTerms;
+		};
+
+
+		template< typename Ops >
+		class CDisabledGrayOutKernel : public CBlendColorKernel<Ops>
+		{
+		public:
+			typedef typename Ops::TVec TVec;
+
+			CDisabledGrayOutKernel( const CPixelBGRA& toPixel ) : CBlendColorKernel<Ops>( toPixel ) {}
+
+			void operator()( CPixelBGRA& rPixel ) const
+			{
+				CBlendColorKernel<Ops>::operator()( rPixel );
+				pixel::ToGrayScale( rPixel );
+			}
+
+			TVec operator()( TVec pixels ) const { return this->ToGrayScale( CBlendColorKernel<Ops>::operator()( pixels ) ); }
+		};
+
+
+		template< typename Ops >
+		class CDisableFadeGrayKernel : public CBaseKernel<Ops>
+		{
+		public:
+			typedef typename Ops::TVec TVec;
+
+			CDisableFadeGrayKernel( BYTE fadeAlpha, bool preMultiplyAlpha )
+				: m_scalarFunc( fadeAlpha, preMultiplyAlpha )
+				, m_preMultiplyAlpha( preMultiplyAlpha )
+				, m_fadeFactors( Ops::SetChannels( 255, 255, 255, fadeAlpha ) )
+			{
+			}
+
+			void operator()( CPixelBGRA& rPixel ) const { m_scalarFunc( rPixel ); }
+
+			TVec operator()( TVec pixels ) const
+			{
+				pixels = this->ToGrayScale( Ops::Div255( Ops::Multiply( pixels, m_fadeFactors ) ) );		// fade alpha, colors unchanged
+				return m_preMultiplyAlpha ? this->PreMultiplyAlpha( pixels ) : pixels;
+			}
+		private:
+			func::DisableFadeGray m_scalarFunc;
+			bool m_preMultiplyAlpha;
+			TVec m_fadeFactors;
+		};
+	}
+}
+
+#endif //USE_PIXEL_SIMD
+
+
+namespace pixel
+{
+	namespace kernel
+	{
+		using namespace impl;
+
+		void PreMultiplyAlpha( const CBufferBGRA& buffer, InstructionSet instructionSet /*= GetInstructionSet()*/ )
+		{
+			switch ( ClampInstructionSet( instructionSet ) )
+			{
+			#ifdef USE_PIXEL_AVX2
+				case Avx2Set: ForEachVector<CAvx2Ops>( buffer, CPreMultiplyAlphaKernel<CAvx2Ops>() ); break;
+			#endif
+			#ifdef USE_PIXEL_SIMD
+				case Sse2Set: ForEachVector<CSse2Ops>( buffer, CPreMultiplyAlphaKernel<CSse2Ops>() ); break;
+			#endif
+				default: ForEachPixel( buffer, CPreMultiplyAlpha() );
+			}
+		}
+
+		void ToGrayScale( const CBufferBGRA& buffer, InstructionSet instructionSet /*= GetInstructionSet()*/ )
+		{
+			switch ( ClampInstructionSet( instructionSet ) )
+			{
+			#ifdef USE_PIXEL_AVX2
+				case Avx2Set: ForEachVector<CAvx2Ops>( buffer, CGrayScaleKernel<CAvx2Ops>() ); break;
+			#endif
+			#ifdef USE_PIXEL_SIMD
+				case Sse2Set: ForEachVector<CSse2Ops>( buffer, CGrayScaleKernel<CSse2Ops>() ); break;
+			#endif
+				default: ForEachPixel( buffer, func::ToGrayScale() );
+			}
+		}
+
+		void BlendColor( const CBufferBGRA& buffer, const CPixelBGRA& toPixel, InstructionSet instructionSet /*= GetInstructionSet()*/ )
+		{
+			switch ( ClampInstructionSet( instructionSet ) )
+			{
+			#ifdef USE_PIXEL_AVX2
+				case Avx2Set: ForEachVector<CAvx2Ops>( buffer, CBlendColorKernel<CAvx2Ops>( toPixel ) ); break;
+			#endif
+			#ifdef USE_PIXEL_SIMD
+				case Sse2Set: ForEachVector<CSse2Ops>( buffer, CBlendColorKernel<CSse2Ops>( toPixel ) ); break;
+			#endif
+				default: ForEachPixel( buffer, func::BlendColor( toPixel.GetColor(), toPixel.m_alpha ) );
+			}
+		}
+
+		void DisableFadeGray( const CBufferBGRA& buffer, BYTE fadeAlpha, bool preMultiplyAlpha, InstructionSet instructionSet /*= GetInstructionSet()*/ )
+		{
+			switch ( ClampInstructionSet( instructionSet ) )
+			{
+			#ifdef USE_PIXEL_AVX2
+				case Avx2Set: ForEachVector<CAvx2Ops>( buffer, CDisableFadeGrayKernel<CAvx2Ops>( fadeAlpha, preMultiplyAlpha ) ); break;
+			#endif
+			#ifdef USE_PIXEL_SIMD
+				case Sse2Set: ForEachVector<CSse2Ops>( buffer, CDisableFadeGrayKernel<CSse2Ops>( fadeAlpha, preMultiplyAlpha ) ); break;
+			#endif
+				default: ForEachPixel( buffer, func::DisableFadeGray( fadeAlpha, preMultiplyAlpha ) );
+			}
+		}
+
+		void DisabledGrayOut( const CBufferBGRA& buffer, const CPixelBGRA& toPixel, InstructionSet instructionSet /*= GetInstructionSet()*/ )
+		{
+			switch ( ClampInstructionSet( instructionSet ) )
+			{
+			#ifdef USE_PIXEL_AVX2
+				case Avx2Set: ForEachVector<CAvx2Ops>( buffer, CDisabledGrayOutKernel<CAvx2Ops>( toPixel ) ); break;
+			#endif
+			#ifdef USE_PIXEL_SIMD
+				case Sse2Set: ForEachVector<CSse2Ops>( buffer, CDisabledGrayOutKernel<CSse2Ops>( toPixel ) ); break;
+			#endif
+				default: ForEachPixel( buffer, func::DisabledGrayOut( toPixel.GetColor(), toPixel.m_alpha ) );
+			}
+		}
+
+		void MultiplyAlpha( const CBufferBGRA& buffer, BYTE alpha, double alphaFactor )
+		{	// the truncation of the double factor multiplication can't be matched exactly in fixed point, so it's evaluated once per channel value
+			BYTE colorTable[ 256 ], alphaTable[ 256 ];
+
+			for ( UINT channel = 0; channel != 256; ++channel )
+			{
+				CPixelBGRA pixel( (BYTE)channel, (BYTE)channel, (BYTE)channel, (BYTE)channel );
+
+				pixel::MultiplyAlpha( pixel, alpha, alphaFactor );
+				colorTable[ channel ] = pixel.m_red;
+				alphaTable[ channel ] = pixel.m_alpha;
+			}
+
+			ForEachPixel( buffer, CLookupChannels( colorTable, alphaTable ) );
+		}
+	}
+}
@@ -0,0 +1,53 @@
+#ifndef PixelKernels_h
+#define PixelKernels_h
+#pragma once
+
+#include "Pixel.h"
+
+
+namespace pixel
+{
+	// instruction set levels of the pixel kernels, in increasing order of capability
+
+	enum InstructionSet { ScalarSet, Sse2Set, Avx2Set };
+
+	InstructionSet GetMaxInstructionSet( void );								// supported by both CPU and OS, detected once at runtime
+	InstructionSet GetInstructionSet( void );									// used by default by the kernels
+	InstructionSet SetInstructionSet( InstructionSet instructionSet );			// clamped to the max supported; returns the old one (for testing and benchmarks)
+	const TCHAR* GetInstructionSetName( InstructionSet instructionSet );
+
+
+	// Plain view over 32bpp BGRA pixels, independent of the bitmap that owns the buffer.
+	//
+	struct CBufferBGRA
+	{
+		CBufferBGRA( void* pPixels, UINT width, UINT height, int stride ) : m_pPixels( static_cast<BYTE*>( pPixels ) ), m_width( width ), m_height( height ), m_stride( stride ) {}
+
+		CPixelBGRA* GetRow( UINT y ) const { ASSERT( y < m_height ); return reinterpret_cast<CPixelBGRA*>( m_pPixels + (int)y * m_stride ); }
+	public:
+		BYTE* m_pPixels;
+		UINT m_width;
+		UINT m_height;
+		int m_stride;						// bytes per row (negative for reversed row order)
+	};
+
+
+	// Vectorized 32bpp effects: the results are bit-exact with the equivalent func:: functors applied on each CPixelBGRA.
+	// The SIMD paths process 4 (SSE2) or 8 (AVX2) pixels at once, the row tails are processed by the scalar functors.
+	// Not platform-neutral: they share CPixelBGRA and the func:: functors with CDibPixels (Windows types), and detect the CPU with MSVC intrinsics.
+	// They are verified by CPixelKernelsTests (UTL_UI unit tests) against the functors, for each instruction set supported by the CPU.
+	//
+	namespace kernel
+	{
+		void PreMultiplyAlpha( const CBufferBGRA& buffer, InstructionSet instructionSet = GetInstructionSet() );		// CPixelBGRA::PreMultiplyAlpha()
+		void ToGrayScale( const CBufferBGRA& buffer, InstructionSet instructionSet = GetInstructionSet() );			// func::ToGrayScale
+		void BlendColor( const CBufferBGRA& buffer, const CPixelBGRA& toPixel, InstructionSet instructionSet = GetInstructionSet() );			// func::BlendColor
+		void DisableFadeGray( const CBufferBGRA& buffer, BYTE fadeAlpha, bool preMultiplyAlpha, InstructionSet instructionSet = GetInstructionSet() );	// func::DisableFadeGray
+		void DisabledGrayOut( const CBufferBGRA& buffer, const CPixelBGRA& toPixel, InstructionSet instructionSet = GetInstructionSet() );		// func::DisabledGrayOut
+
+		void MultiplyAlpha( const CBufferBGRA& buffer, BYTE alpha, double alphaFactor );								// func::AlphaBlend, func::FadeColor (table lookup)
+	}
+}
+
+
+#endif // PixelKernels_h
@@ -0,0 +1,334 @@
+
+#include "pch.h"
+#include "PixelResampler.h"
+#include "ParallelFor.h"
+#include <math.h>
+
+#if defined( _M_IX86 ) || defined( _M_X64 )
+	#define USE_PIXEL_SIMD
+	#include <emmintrin.h>
+#endif
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+
+namespace pixel
+{
+	const TCHAR* GetResampleFilterName( ResampleFilter filter )
+	{
+		static const TCHAR* s_names[] = { _T("Box"), _T("Lanczos") };
+		ASSERT( filter < COUNT_OF( s_names ) );
+		return s_names[ filter ];
+	}
+}
+
+
+namespace pixel
+{
+	namespace impl
+	{
+		enum { WeightBits = 14, RoundingTerm = 1 << ( WeightBits - 1 ), MinBandRows = 16 };
+		enum { MinParallelPixels = 512 * 512 };		// below this many pixels per pass, starting the worker threads costs more than it saves
+
+		inline size_t GetPassThreadCount( size_t passPixelCount, size_t threadCount )
+		{
+			if ( 0 == threadCount && passPixelCount < MinParallelPixels )
+				return 1;			// small images (e.g. most thumbnails) run on the calling thread
+
+			return threadCount;
+		}
+
+		inline BYTE ClampChannel( int acc )
+		{
+			acc >>= WeightBits;
+			return static_cast<BYTE>( acc < 0 ? 0 : ( acc > 255 ? 255 : acc ) );
+		}
+
+
+		// filter kernels on the normalized distance to the sample center
+
+		double BoxKernel( double x )
+		{
+			return x >= -0.5 && x < 0.5 ? 1.0 : 0.0;
+		}
+
+		double Sinc( double x )
+		{
+			static const double s_pi = 3.14159265358979323846;
+
+			if ( 0.0 == x )
+				return 1.0;
+
+			x *= s_pi;
+			return sin( x ) / x;
+		}
+
+		double Lanczos3Kernel( double x )
+		{
+			return x > -3.0 && x < 3.0 ? Sinc( x ) * Sinc( x / 3.0 ) : 0.0;
+		}
+
+
+		// The contributions of source pixels to each destination pixel along one axis: a padded table of fixed point weights.
+		//
+		class CAxisWeights
+		{
+		public:
+			CAxisWeights( UINT srcSize, UINT destSize, ResampleFilter filter )
+			{
+				ASSERT( srcSize != 0 && destSize != 0 );
+
+				double (*pKernel)( double ) = LanczosFilter == filter ? &Lanczos3Kernel : &BoxKernel;
+				double scale = double( srcSize ) / destSize;
+				double filterScale = std::max( scale, 1.0 );
+				double support = ( LanczosFilter == filter ? 3.0 : 0.5 ) * filterScale;
+
+				m_stride = ( static_cast<UINT>( ceil( support ) ) * 2 + 2 ) & ~1u;		// even, for pairs of taps
+				m_firsts.resize( destSize );
+				m_counts.resize( destSize );
+				m_weights.resize( destSize * m_stride );
+
+				std::vector<double> weights( m_stride );
+
+				for ( UINT destPos = 0; destPos != destSize; ++destPos )
+				{
+					double center = ( destPos + 0.5 ) * scale;
+					int first = std::max( static_cast<int>( center - support + 0.5 ), 0 );
+					int last = std::min( static_cast<int>( center + support + 0.5 ), static_cast<int>( srcSize ) );
+					UINT count = std::min<UINT>( std::max( last - first, 1 ), m_stride );
+					double sum = 0.0;
+
+					first = std::min( first, static_cast<int>( srcSize - count ) );
+
+					for ( UINT i = 0; i != count; ++i )
+						sum += weights[ i ] = pKernel( ( first + i - center + 0.5 ) / filterScale );
+
+					short* pWeights = &m_weights[ destPos * m_stride ];
+					for ( UINT i = 0; i != count; ++i )
+					{
+						double weight = sum != 0.0 ? ( weights[ i ] / sum ) : ( 1.0 / count );
+						pWeights[ i ] = static_cast<short>( floor( weight * ( 1 << WeightBits ) + 0.5 ) );
+					}
+
+					m_firsts[ destPos ] = static_cast<UINT>( first );
+					m_counts[ destPos ] = count;
+				}
+			}
+
+			UINT GetFirst( UINT destPos ) const { return m_firsts[ destPos ]; }
+			UINT GetCount( UINT destPos ) const { return m_counts[ destPos ]; }
+			const short* GetWeights( UINT destPos ) const { return &m_weights[ destPos * m_stride ]; }
+		private:
+			UINT m_stride;							// max tap count per destination pixel
+			std::vector<UINT> m_firsts;				// first source pixel
+			std::vector<UINT> m_counts;				// count of source pixels (taps)
+			std::vector<short> m_weights;			// fixed point, zero padded
+		};
+
+
+		// scalar passes
+
+		void ResampleRow( CPixelBGRA* pDestRow, UINT destWidth, const CPixelBGRA* pSrcRow, const CAxisWeights& weights )
+		{
+			for ( UINT x = 0; x != destWidth; ++x )
+			{
+				const CPixelBGRA* pSrc = pSrcRow + weights.GetFirst( x );
+				const short* pWeights = weights.GetWeights( x );
+				int blue = RoundingTerm, green = RoundingTerm, red = RoundingTerm, alpha = RoundingTerm;
+
+				for ( UINT i = 0, count = weights.GetCount( x ); i != count; ++i )
+				{
+					blue += pSrc[ i ].m_blue * pWeights[ i ];
+					green += pSrc[ i ].m_green * pWeights[ i ];
+					red += pSrc[ i ].m_red * pWeights[ i ];
+					alpha += pSrc[ i ].m_alpha * pWeights[ i ];
+				}
+
+				pDestRow[ x ] = CPixelBGRA( ClampChannel( red ), ClampChannel( green ), ClampChannel( blue ), ClampChannel( alpha ) );
+			}
+		}
+
+		void ResampleColumns( CPixelBGRA* pDestRow, const CBufferBGRA& srcBuffer, UINT destY, const CAxisWeights& weights )
+		{
+			const short* pWeights = weights.GetWeights( destY );
+			UINT first = weights.GetFirst( destY ), count = weights.GetCount( destY );
+
+			for ( UINT x = 0; x != srcBuffer.m_width; ++x )
+			{
+				int blue = RoundingTerm, green = RoundingTerm, red = RoundingTerm, alpha = RoundingTerm;
+
+				for ( UINT i = 0; i != count; ++i )
+				{
+					const CPixelBGRA& srcPixel = srcBuffer.GetRow( first + i )[ x ];
+
+					blue += srcPixel.m_blue * pWeights[ i ];
+					green += srcPixel.m_green * pWeights[ i ];
+					red += srcPixel.m_red * pWeights[ i ];
+					alpha += srcPixel.m_alpha * pWeights[ i ];
+				}
+
+				pDestRow[ x ] = CPixelBGRA( ClampChannel( red ), ClampChannel( green ), ClampChannel( blue ), ClampChannel( alpha ) );
+			}
+		}
+
+
+	#ifdef USE_PIXEL_SIMD
+
+		// SSE2 passes: _mm_madd_epi16 multiplies pairs of taps with pairs of weights, accumulating the 4 channels as 32-bit integers.
+
+		inline __m128i MakeWeightPair( short weight0, short weight1 )
+		{
+			return _mm_set1_epi32( static_cast<int>( ( static_cast<UINT>( static_cast<USHORT>( weight1 ) ) << 16 ) | static_cast<USHORT>( weight0 ) ) );
+		}
+
+		inline int PackPixel( __m128i acc )
+		{
+			__m128i channels = _mm_packs_epi32( _mm_srai_epi32( acc, WeightBits ), _mm_setzero_si128() );
+			return _mm_cvtsi128_si32( _mm_packus_epi16( channels, channels ) );
+		}
+
+		void ResampleRow_Sse2( CPixelBGRA* pDestRow, UINT destWidth, const CPixelBGRA* pSrcRow, const CAxisWeights& weights )
+		{
+			const __m128i zero = _mm_setzero_si128();
+
+			for ( UINT x = 0; x != destWidth; ++x )
+			{
+				const CPixelBGRA* pSrc = pSrcRow + weights.GetFirst( x );
+				const short* pWeights = weights.GetWeights( x );
+				UINT count = weights.GetCount( x ), i = 0;
+				__m128i acc = _mm_set1_epi32( RoundingTerm );
+
+				for ( ; i + 1 < count; i += 2 )
+				{	// [b0 g0 r0 a0 b1 g1 r1 a1] -> [b0 b1 g0 g1 r0 r1 a0 a1]
+					__m128i pixels = _mm_unpacklo_epi8( _mm_loadl_epi64( reinterpret_cast<const __m128i*>( pSrc + i ) ), zero );
+					pixels = _mm_unpacklo_epi16( pixels, _mm_srli_si128( pixels, 8 ) );
+					acc = _mm_add_epi32( acc, _mm_madd_epi16( pixels, MakeWeightPair( pWeights[ i ], pWeights[ i + 1 ] ) ) );
+				}
+
+				if ( i != count )
+				{	// odd tap: [b0 0 g0 0 r0 0 a0 0]
+					__m128i pixel = _mm_unpacklo_epi8( _mm_cvtsi32_si128( *reinterpret_cast<const int*>( pSrc + i ) ), zero );
+					pixel = _mm_unpacklo_epi16( pixel, zero );
+					acc = _mm_add_epi32( acc, _mm_madd_epi16( pixel, MakeWeightPair( pWeights[ i ], 0 ) ) );
+				}
+
+				*reinterpret_cast<int*>( pDestRow + x ) = PackPixel( acc );
+			}
+		}
+
+		void ResampleColumns_Sse2( CPixelBGRA* pDestRow, const CBufferBGRA& srcBuffer, UINT destY, const CAxisWeights& weights )
+		{
+			const __m128i zero = _mm_setzero_si128();
+			const short* pWeights = weights.GetWeights( destY );
+			UINT first = weights.GetFirst( destY ), count = weights.GetCount( destY );
+			UINT x = 0;
+
+			for ( ; x + 4 <= srcBuffer.m_width; x += 4 )
+			{	// 4 pixels at once, accumulated per pixel
+				__m128i acc[ 4 ] = { _mm_set1_epi32( RoundingTerm ), _mm_set1_epi32( RoundingTerm ), _mm_set1_epi32( RoundingTerm ), _mm_set1_epi32( RoundingTerm ) };
+
+				for ( UINT i = 0; i < count; i += 2 )
+				{
+					__m128i pixels0 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( srcBuffer.GetRow( first + i ) + x ) );
+					__m128i pixels1 = i + 1 < count ? _mm_loadu_si128( reinterpret_cast<const __m128i*>( srcBuffer.GetRow( first + i + 1 ) + x ) ) : zero;
+					__m128i weightPair = MakeWeightPair( pWeights[ i ], i + 1 < count ? pWeights[ i + 1 ] : 0 );
+
+					// interleave the channels of the two rows: [c0_row0 c0_row1 ...]
+					__m128i lo = _mm_unpacklo_epi8( pixels0, pixels1 ), hi = _mm_unpackhi_epi8( pixels0, pixels1 );
+
+					acc[ 0 ] = _mm_add_epi32( acc[ 0 ], _mm_madd_epi16( _mm_unpacklo_epi8( lo, zero ), weightPair ) );
+					acc[ 1 ] = _mm_add_epi32( acc[ 1 ], _mm_madd_epi16( _mm_unpackhi_epi8( lo, zero ), weightPair ) );
+					acc[ 2 ] = _mm_add_epi32( acc[ 2 ], _mm_madd_epi16( _mm_unpacklo_epi8( hi, zero ), weightPair ) );
+					acc[ 3 ] = _mm_add_epi32( acc[ 3 ], _mm_madd_epi16( _mm_unpackhi_epi8( hi, zero ), weightPair ) );
+				}
+
+				__m128i pixels01 = _mm_packs_epi32( _mm_srai_epi32( acc[ 0 ], WeightBits ), _mm_srai_epi32( acc[ 1 ], WeightBits ) );
+				__m128i pixels23 = _mm_packs_epi32( _mm_srai_epi32( acc[ 2 ], WeightBits ), _mm_srai_epi32( acc[ 3 ], WeightBits ) );
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( pDestRow + x ), _mm_packus_epi16( pixels01, pixels23 ) );
+			}
+
+			if ( x != srcBuffer.m_width )
+			{	// scalar tail
+				CBufferBGRA tailBuffer( srcBuffer.m_pPixels + x * sizeof( CPixelBGRA ), srcBuffer.m_width - x, srcBuffer.m_height, srcBuffer.m_stride );
+				ResampleColumns( pDestRow + x, tailBuffer, destY, weights );
+			}
+		}
+
+	#endif //USE_PIXEL_SIMD
+
+
+		// parallel band processing of each pass
+
+		struct CHorizontalPass
+		{
+			CHorizontalPass( const CBufferBGRA& destBuffer, const CBufferBGRA& srcBuffer, const CAxisWeights& weights, bool useSimd )
+				: m_destBuffer( destBuffer ), m_srcBuffer( srcBuffer ), m_weights( weights ), m_useSimd( useSimd ) {}
+
+			void operator()( size_t rowFirst, size_t rowLast ) const
+			{
+				for ( UINT y = static_cast<UINT>( rowFirst ); y != rowLast; ++y )
+				#ifdef USE_PIXEL_SIMD
+					if ( m_useSimd )
+						ResampleRow_Sse2( m_destBuffer.GetRow( y ), m_destBuffer.m_width, m_srcBuffer.GetRow( y ), m_weights );
+					else
+				#endif
+						ResampleRow( m_destBuffer.GetRow( y ), m_destBuffer.m_width, m_srcBuffer.GetRow( y ), m_weights );
+			}
+		private:
+			const CBufferBGRA& m_destBuffer;
+			const CBufferBGRA& m_srcBuffer;
+			const CAxisWeights& m_weights;
+			bool m_useSimd;
+		};
+
+
+		struct CVerticalPass
+		{
+			CVerticalPass( const CBufferBGRA& destBuffer, const CBufferBGRA& srcBuffer, const CAxisWeights& weights, bool useSimd )
+				: m_destBuffer( destBuffer ), m_srcBuffer( srcBuffer ), m_weights( weights ), m_useSimd( useSimd ) {}
+
+			void operator()( size_t rowFirst, size_t rowLast ) const
+			{
+				for ( UINT y = static_cast<UINT>( rowFirst ); y != rowLast; ++y )
+				#ifdef USE_PIXEL_SIMD
+					if ( m_useSimd )
+						ResampleColumns_Sse2( m_destBuffer.GetRow( y ), m_srcBuffer, y, m_weights );
+					else
+				#endif
+						ResampleColumns( m_destBuffer.GetRow( y ), m_srcBuffer, y, m_weights );
+			}
+		private:
+			const CBufferBGRA& m_destBuffer;
+			const CBufferBGRA& m_srcBuffer;
+			const CAxisWeights& m_weights;
+			bool m_useSimd;
+		};
+	}
+
+
+	void Resample( const CBufferBGRA& destBuffer, const CBufferBGRA& srcBuffer, ResampleFilter filter /*= BoxFilter*/,
+				   InstructionSet instructionSet /*= GetInstructionSet()*/, size_t threadCount /*= 0*/ )
+	{
+		ASSERT( destBuffer.m_pPixels != srcBuffer.m_pPixels );
+
+		if ( 0 == destBuffer.m_width || 0 == destBuffer.m_height || 0 == srcBuffer.m_width || 0 == srcBuffer.m_height )
+			return;
+
+		bool useSimd = std::min( instructionSet, GetMaxInstructionSet() ) >= Sse2Set;
+
+		// horizontal pass: srcBuffer -> (dest width, src height)
+		std::vector<CPixelBGRA> tempPixels( destBuffer.m_width * srcBuffer.m_height, CPixelBGRA( 0, 0, 0, 0 ) );
+		CBufferBGRA tempBuffer( &tempPixels.front(), destBuffer.m_width, srcBuffer.m_height, destBuffer.m_width * sizeof( CPixelBGRA ) );
+
+		impl::CAxisWeights horizWeights( srcBuffer.m_width, destBuffer.m_width, filter );
+		mt::ParallelForSlices( srcBuffer.m_height, impl::CHorizontalPass( tempBuffer, srcBuffer, horizWeights, useSimd ), impl::MinBandRows,
+							   impl::GetPassThreadCount( srcBuffer.m_width * srcBuffer.m_height, threadCount ) );		// each source pixel is read
+
+		// vertical pass: (dest width, src height) -> destBuffer
+		impl::CAxisWeights vertWeights( srcBuffer.m_height, destBuffer.m_height, filter );
+		mt::ParallelForSlices( destBuffer.m_height, impl::CVerticalPass( destBuffer, tempBuffer, vertWeights, useSimd ), impl::MinBandRows,
+							   impl::GetPassThreadCount( tempBuffer.m_width * tempBuffer.m_height, threadCount ) );
+	}
+}
@@ -0,0 +1,28 @@
+#ifndef PixelResampler_h
+#define PixelResampler_h
+#pragma once
+
+#include "PixelKernels.h"
+
+
+namespace pixel
+{
+	enum ResampleFilter { BoxFilter, LanczosFilter };
+
+	const TCHAR* GetResampleFilterName( ResampleFilter filter );
+
+
+	// High quality separable resampling of 32bpp BGRA pixels (usually with pre-multiplied alpha), using fixed point filter weights.
+	// Scales horizontally into an intermediate buffer, then vertically into destBuffer; each pass is split in parallel bands of rows.
+	// Designed for downscaling (e.g. thumbnails): the filter support stretches with the scale factor, so that all source pixels contribute.
+	//	BoxFilter: averages the source area covered by each destination pixel - fastest;
+	//	LanczosFilter: Lanczos3 windowed sinc - sharpest.
+	// The SIMD path (SSE2 and up) is bit-exact with the scalar path.
+	// With threadCount 0 (auto), passes over small images run single-threaded on the calling thread.
+	//
+	void Resample( const CBufferBGRA& destBuffer, const CBufferBGRA& srcBuffer, ResampleFilter filter = BoxFilter,
+				   InstructionSet instructionSet = GetInstructionSet(), size_t threadCount = 0 );
+}
+
+
+#endif // PixelResampler_h
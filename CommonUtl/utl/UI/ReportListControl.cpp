@@ -2,6 +2,7 @@
 #include "pch.h"
 #include "ReportListControl.h"
 #include "ReportListCustomDraw.h"
+#include "ReportListModel.h"
 #include "CustomDrawImager.h"
 #include "CmdUpdate.h"
 #include "Color.h"
@@ -126,6 +127,7 @@ CReportListControl::CReportListControl( UINT columnLayoutId /*= 0*/, DWORD listS
 	, m_pImageList( nullptr )
 	, m_pLargeImageList( nullptr )
 	, m_pCheckStatePolicy( nullptr )
+	, m_pListModel( nullptr )
 	, m_pFrameEditor( nullptr )
 	, m_pDataSourceFactory( ole::GetStdDataSourceFactory() )
 	, m_painting( false )
@@ -571,19 +573,25 @@ void CReportListControl::SortList( void )
 
 	ui::CNmHdr nmHdr( this, lv::LVN_CustomSortList );
 
-	if ( 0L == nmHdr.NotifyParent() )			// give parent a chance to custom sort the list (or sort its groups); still sort items by default?
-		if ( -1 == m_sortByColumn && !m_initialItemsOrder.empty() )				// default sorting and we have an initial order?
-		{
-			SortItems( (PFNLVCOMPARE)&InitialOrderCompareProc, (LPARAM)this );	// restore initial item order; passes item LPARAMs (i.e. TRowKey) as left/right
+	if ( nmHdr.NotifyParent() != 0L )			// give parent a chance to custom sort the list (or sort its groups)
+	{
+		if ( m_pListModel != nullptr )
+			SyncListModelRows();												// owner-data: parent has custom sorted the model rows
+	}
+	else if ( m_pListModel != nullptr )
+		SortListModel();														// owner-data: sort the model rows, no list items to sort
+	else if ( -1 == m_sortByColumn && !m_initialItemsOrder.empty() )			// default sorting and we have an initial order?
+	{
+		SortItems( (PFNLVCOMPARE)&InitialOrderCompareProc, (LPARAM)this );		// restore initial item order; passes item LPARAMs (i.e. TRowKey) as left/right
 
-			if ( IsGroupViewEnabled() )
-				SortGroups( (PFNLVGROUPCOMPARE)&InitialGroupOrderCompareProc, this );
-		}
-		else if ( GetSortInternally() )											// otherwise was sorted externally, just update sort header
-			if ( m_pComparePtrFunc != nullptr )
-				SortItems( m_pComparePtrFunc, (LPARAM)this );					// passes item LPARAMs as left/right
-			else
-				SortItemsEx( (PFNLVCOMPARE)&TextCompareProc, (LPARAM)this );	// passes item indexes as left/right LPARAMs
+		if ( IsGroupViewEnabled() )
+			SortGroups( (PFNLVGROUPCOMPARE)&InitialGroupOrderCompareProc, this );
+	}
+	else if ( GetSortInternally() )												// otherwise was sorted externally, just update sort header
+		if ( m_pComparePtrFunc != nullptr )
+			SortItems( m_pComparePtrFunc, (LPARAM)this );						// passes item LPARAMs as left/right
+		else
+			SortItemsEx( (PFNLVCOMPARE)&TextCompareProc, (LPARAM)this );		// passes item indexes as left/right LPARAMs
 
 	nmHdr.code = lv::LVN_ListSorted;
 	nmHdr.NotifyParent();
@@ -597,14 +605,18 @@ void CReportListControl::InitialSortList( void )
 {
 	REQUIRE( IsSortingEnabled() );
 
-	// store initial items order so that we can restore it when list will be switched to unsorted
-	const unsigned int itemCount = GetItemCount();
+	if ( nullptr == m_pListModel )		// owner-data model keeps its objects in initial order
+	{	// store initial items order so that we can restore it when list will be switched to unsorted
+		const unsigned int itemCount = GetItemCount();
 
-	m_initialItemsOrder.clear();
-	m_initialItemsOrder.reserve( itemCount );
+		std::vector< std::pair<TRowKey, int> > initialItemsOrder;
+		initialItemsOrder.reserve( itemCount );
 
-	for ( unsigned int index = 0; index != itemCount; ++index )
-		m_initialItemsOrder[ MakeRowKeyAt( index ) ] = index;
+		for ( unsigned int index = 0; index != itemCount; ++index )
+			initialItemsOrder.push_back( std::make_pair( MakeRowKeyAt( index ), static_cast<int>( index ) ) );
+
+		m_initialItemsOrder.AssignUnsorted( initialItemsOrder );	// sort once, instead of an insert per item
+	}
 
 	if ( m_sortByColumn != -1 )			// has a previously saved column sort order?
 		SortList();
@@ -738,6 +750,9 @@ int CReportListControl::FindItemIndex( LPARAM lParam ) const
 {
 	ASSERT( lParam != 0 );
 
+	if ( m_pListModel != nullptr )
+		return m_pListModel->FindRow( AsPtr<utl::ISubject>( lParam ) );		// hash lookup, rather than a linear LVN_ODFINDITEM search
+
 	LVFINDINFO findInfo;
 	findInfo.flags = LVFI_PARAM | LVFI_WRAP;
 	findInfo.lParam = lParam;
@@ -1223,7 +1238,7 @@ void CReportListControl::SaveToRegistry( void )
 
 utl::ISubject* CReportListControl::GetSubjectAt( int index ) const
 {
-	if ( utl::ISubject* pObject = ToSubject( GetItemData( index ) ) )
+	if ( utl::ISubject* pObject = ToSubject( GetItemParam( index ) ) )
 		if ( !m_subjectBased )
 			return nullptr;
 		else
@@ -1263,6 +1278,145 @@ int CReportListControl::InsertObjectItem( int index, const utl::ISubject* pObjec
 	return insertIndex;
 }
 
+void CReportListControl::SetListModel( CReportListModel* pListModel )
+{
+	ASSERT( nullptr == m_hWnd || HasFlag( GetStyle(), LVS_OWNERDATA ) );
+
+	ClearData();
+	m_pListModel = pListModel;
+
+	if ( m_pListModel != nullptr )
+	{
+		m_subjectBased = true;			// model objects are utl::ISubject
+
+		if ( m_hWnd != nullptr )
+			UpdateListModelRows();
+	}
+}
+
+void CReportListControl::UpdateListModelRows( void )
+{
+	REQUIRE( IsOwnerDataList() && m_hWnd != nullptr );
+
+	if ( HasFlag( GetExtendedStyle(), LVS_EX_CHECKBOXES ) )
+		SetCallbackMask( GetCallbackMask() | LVIS_STATEIMAGEMASK );		// check-states are stored in the model
+
+	SetItemCountEx( m_pListModel->GetRowCount(), LVSICF_NOINVALIDATEALL | LVSICF_NOSCROLL );		// visible rows are requested via LVN_GETDISPINFO
+	SortList();							// parent may custom sort the model rows
+}
+
+void CReportListControl::SortListModel( void )
+{
+	ASSERT_PTR( m_pListModel );
+
+	m_pListModel->SortRows( m_sortByColumn, m_sortAscending, m_sortByColumn != -1 ? FindCompare( m_sortByColumn ) : nullptr, FindCompare( EntireRecord ) );
+	SyncListModelRows();
+}
+
+void CReportListControl::SyncListModelRows( void )
+{
+	ASSERT_PTR( m_pListModel );
+
+	if ( m_hWnd != nullptr )
+	{
+		SyncListModelSelection();		// selected rows have moved
+		Invalidate();
+	}
+}
+
+void CReportListControl::SyncListModelSelection( void )
+{
+	ASSERT_PTR( m_pListModel );
+	CScopedInternalChange change( this );
+
+	// note: the list selection changes are mirrored back into the model, which ends up with the same selected rows
+	std::vector<int> selRows;
+	m_pListModel->QuerySelectedRows( selRows );
+
+	if ( !selRows.empty() && selRows.size() == static_cast<size_t>( m_pListModel->GetRowCount() ) )
+		SetItemState( -1, LVIS_SELECTED, LVIS_SELECTED );
+	else
+	{
+		SetItemState( -1, 0, LVIS_SELECTED );
+
+		for ( std::vector<int>::const_iterator itSelRow = selRows.begin(); itSelRow != selRows.end(); ++itSelRow )
+			SetItemState( *itSelRow, LVIS_SELECTED, LVIS_SELECTED );
+	}
+}
+
+void CReportListControl::ToggleModelCheckState( int index )
+{
+	ASSERT_PTR( m_pListModel );
+	ASSERT_NULL( m_pNmToggling.get() );
+
+	// owner-data lists don't toggle check-states: the state images are owned by the model
+	int oldCheckState = GetCheckState( index );
+	int checkState = m_pCheckStatePolicy != nullptr
+		? m_pCheckStatePolicy->Toggle( oldCheckState )
+		: ( BST_CHECKED == oldCheckState ? BST_UNCHECKED : BST_CHECKED );
+
+	if ( checkState == oldCheckState )
+		return;							// read-only check-state (disabled by the policy)
+
+	m_pNmToggling.reset( new lv::CNmCheckStatesChanged( this ) );
+	m_pNmToggling->m_itemIndexes.push_back( index );		// first index is the toggled reference
+
+	if ( m_pCheckStatePolicy != nullptr )
+		SetItemCheckState( index, checkState );
+	else
+		SetCheckState( index, checkState );
+
+	if ( GetToggleCheckSelItems() )
+		ApplyCheckStateToSelectedItems( index, checkState );
+
+	NotifyCheckStatesChanged();
+}
+
+int CReportListControl::FindModelRow( const NMLVFINDITEM* pFindItem ) const
+{
+	ASSERT_PTR( m_pListModel );
+
+	const LVFINDINFO& findInfo = pFindItem->lvfi;
+	int rowCount = m_pListModel->GetRowCount();
+
+	if ( HasFlag( findInfo.flags, LVFI_PARAM ) )
+		return m_pListModel->FindRow( AsPtr<utl::ISubject>( findInfo.lParam ) );
+
+	if ( !HasFlag( findInfo.flags, LVFI_STRING | LVFI_PARTIAL ) || nullptr == findInfo.psz || 0 == rowCount )
+		return -1;
+
+	// linear search by the code column text, invoked only for keyboard incremental search
+	size_t findLength = _tcslen( findInfo.psz );
+	int startRow = pFindItem->iStart >= 0 && pFindItem->iStart < rowCount ? pFindItem->iStart : 0;
+
+	for ( int count = 0, row = startRow; count != rowCount; ++count )
+	{
+		std::tstring text = m_pListModel->FormatCellText( row, Code );
+		bool found = HasFlag( findInfo.flags, LVFI_PARTIAL )
+			? 0 == _tcsnicmp( text.c_str(), findInfo.psz, findLength )
+			: 0 == _tcsicmp( text.c_str(), findInfo.psz );
+
+		if ( found )
+			return row;
+
+		if ( ++row == rowCount )
+			if ( HasFlag( findInfo.flags, LVFI_WRAP ) )
+				row = 0;
+			else
+				break;
+	}
+
+	return -1;
+}
+
+LPARAM CReportListControl::GetItemParam( int index ) const
+{
+	if ( m_pListModel != nullptr )
+		return reinterpret_cast<LPARAM>( m_pListModel->GetRowObject( index ) );
+
+	return GetItemData( index );
+}
+
 void CReportListControl::SetSubItemTextPtr( int index, int subItem, const TCHAR* pText /*= LPSTR_TEXTCALLBACK*/, int imageIndex /*= ui::No_Image*/ )
 {
 	ASSERT( subItem > 0 );
@@ -1469,6 +1623,25 @@ bool CReportListControl::ModifyCheckState( int index, int checkState )
 	return true;
 }
 
+ui::TRawCheckState CReportListControl::GetRawCheckState( int index ) const
+{
+	if ( m_pListModel != nullptr )
+		return ui::CheckStateToRaw( m_pListModel->GetRowCheckState( index ) );
+
+	return GetItemState( index, LVIS_STATEIMAGEMASK );
+}
+
+bool CReportListControl::SetRawCheckState( int index, ui::TRawCheckState rawCheckState )
+{
+	if ( m_pListModel != nullptr )
+	{
+		m_pListModel->SetRowCheckState( index, ui::CheckStateFromRaw( rawCheckState ) );
+		return RedrawItems( index, index ) != FALSE;
+	}
+
+	return SetItemState( index, rawCheckState, LVIS_STATEIMAGEMASK ) != FALSE;
+}
+
 int CReportListControl::GetObjectCheckState( const utl::ISubject* pObject ) const
 {
 	int index = FindItemIndex( pObject );
@@ -2336,6 +2509,9 @@ BEGIN_MESSAGE_MAP( CReportListControl, CBaseTrackMenuWnd<CListCtrl> )
 	ON_WM_PAINT()
 	ON_NOTIFY_REFLECT_EX( LVN_ITEMCHANGING, OnLvnItemChanging_Reflect )
 	ON_NOTIFY_REFLECT_EX( LVN_ITEMCHANGED, OnLvnItemChanged_Reflect )
+	ON_NOTIFY_REFLECT_EX( LVN_ODSTATECHANGED, OnLvnOdStateChanged_Reflect )
+	ON_NOTIFY_REFLECT_EX( LVN_ODFINDITEM, OnLvnOdFindItem_Reflect )
+	ON_NOTIFY_REFLECT_EX( NM_CLICK, OnNmClick_Reflect )
 	ON_NOTIFY_REFLECT_EX( HDN_ITEMCHANGING, OnHdnItemChanging_Reflect )
 	ON_NOTIFY_REFLECT_EX( HDN_ITEMCHANGED, OnHdnItemChanged_Reflect )
 	ON_NOTIFY_REFLECT_EX( LVN_COLUMNCLICK, OnLvnColumnClick_Reflect )
@@ -2400,6 +2576,14 @@ void CReportListControl::OnWindowPosChanged( WINDOWPOS* pWndPos )
 
 void CReportListControl::OnKeyDown( UINT chr, UINT repCnt, UINT vkFlags )
 {
+	if ( VK_SPACE == chr && m_pListModel != nullptr && HasFlag( GetExtendedStyle(), LVS_EX_CHECKBOXES ) )
+	{
+		int caretIndex = GetCaretIndex();
+		if ( caretIndex != -1 )
+			ToggleModelCheckState( caretIndex );
+		return;
+	}
+
 	std::auto_ptr<CSelFlowSequence> pSelFlow = CSelFlowSequence::MakeFlow( this );
 
 	if ( nullptr == pSelFlow.get() || pSelFlow->HandleKeyDown( chr ) )
@@ -2476,7 +2660,15 @@ BOOL CReportListControl::OnLvnItemChanged_Reflect( NMHDR* pNmHdr, LRESULT* pResu
 	NMLISTVIEW* pListView = (NMLISTVIEW*)pNmHdr;
 	*pResult = 0L;
 
-	if ( GetToggleCheckSelItems() )											// apply toggle to multi-selection?
+	if ( m_pListModel != nullptr )
+	{
+		if ( IsStateChangeNotify( pListView, LVIS_SELECTED ) )				// mirror the list selection into the model
+			if ( -1 == pListView->iItem )
+				m_pListModel->SelectAllRows( HasFlag( pListView->uNewState, LVIS_SELECTED ) );
+			else
+				m_pListModel->SelectRows( pListView->iItem, pListView->iItem, HasFlag( pListView->uNewState, LVIS_SELECTED ) );
+	}
+	else if ( GetToggleCheckSelItems() )											// apply toggle to multi-selection?
 		if ( !IsInternalChange() || m_pNmToggling.get() != nullptr )		// user has toggled the check-state (directly or indirectly)?
 			if ( IsCheckStateChangeNotify( pListView ) )					// user has toggled the check-state?
 				ApplyCheckStateToSelectedItems( pListView->iItem, ui::CheckStateFromRaw( pListView->uNewState ) );		// apply check-state to selected items if toggled an item that is part of the multi-selection
@@ -2484,6 +2676,45 @@ BOOL CReportListControl::OnLvnItemChanged_Reflect( NMHDR* pNmHdr, LRESULT* pResu
 	return IsInternalChange();		// don't raise the notification to list's parent during an internal change
 }
 
+BOOL CReportListControl::OnLvnOdStateChanged_Reflect( NMHDR* pNmHdr, LRESULT* pResult )
+{
+	NMLVODSTATECHANGE* pStateChange = (NMLVODSTATECHANGE*)pNmHdr;
+	*pResult = 0L;
+
+	if ( m_pListModel != nullptr )
+		if ( ( pStateChange->uOldState ^ pStateChange->uNewState ) & LVIS_SELECTED )	// range selection (shift+click)
+			m_pListModel->SelectRows( pStateChange->iFrom, pStateChange->iTo, HasFlag( pStateChange->uNewState, LVIS_SELECTED ) );
+
+	return IsInternalChange();		// don't raise the notification to list's parent during an internal change
+}
+
+BOOL CReportListControl::OnLvnOdFindItem_Reflect( NMHDR* pNmHdr, LRESULT* pResult )
+{
+	NMLVFINDITEM* pFindItem = (NMLVFINDITEM*)pNmHdr;
+
+	if ( nullptr == m_pListModel )
+		return FALSE;				// let parent handle its own owner-data
+
+	*pResult = FindModelRow( pFindItem );
+	return TRUE;
+}
+
+BOOL CReportListControl::OnNmClick_Reflect( NMHDR* pNmHdr, LRESULT* pResult )
+{
+	NMITEMACTIVATE* pItemActivate = (NMITEMACTIVATE*)pNmHdr;
+	*pResult = 0L;
+
+	if ( m_pListModel != nullptr && pItemActivate->iItem != -1 )
+		if ( HasFlag( GetExtendedStyle(), LVS_EX_CHECKBOXES ) )
+		{
+			UINT hitFlags = 0;
+			if ( pItemActivate->iItem == HitTest( pItemActivate->ptAction, &hitFlags ) && HasFlag( hitFlags, LVHT_ONITEMSTATEICON ) )
+				ToggleModelCheckState( pItemActivate->iItem );		// owner-data lists don't toggle the state image
+		}
+
+	return FALSE;					// raise the notification to parent
+}
+
 BOOL CReportListControl::OnHdnItemChanging_Reflect( NMHDR* pNmHdr, LRESULT* pResult )
 {
 	NMHEADER* pHeaderInfo = (NMHEADER*)pNmHdr;
@@ -2579,6 +2810,21 @@ BOOL CReportListControl::OnLvnGetDispInfo_Reflect( NMHDR* pNmHdr, LRESULT* pResu
 {
 	NMLVDISPINFO* pDispInfo = (NMLVDISPINFO*)pNmHdr;
 
+	if ( m_pListModel != nullptr && m_pListModel->IsValidRow( pDispInfo->item.iItem ) )
+	{	// owner-data: format only the requested visible cells
+		if ( HasFlag( pDispInfo->item.mask, LVIF_TEXT ) )
+			StoreDispInfoItemText( pDispInfo, m_pListModel->FormatCellText( pDispInfo->item.iItem, pDispInfo->item.iSubItem ) );
+
+		if ( HasFlag( pDispInfo->item.mask, LVIF_IMAGE ) )
+			pDispInfo->item.iImage = m_pListModel->GetCellImageIndex( pDispInfo->item.iItem, pDispInfo->item.iSubItem );
+
+		if ( HasFlag( pDispInfo->item.mask, LVIF_STATE ) && HasFlag( pDispInfo->item.stateMask, LVIS_STATEIMAGEMASK ) )
+		{
+			pDispInfo->item.state &= ~LVIS_STATEIMAGEMASK;
+			pDispInfo->item.state |= GetRawCheckState( pDispInfo->item.iItem );
+		}
+	}
+
 	if ( HasFlag( pDispInfo->item.mask, LVIF_TEXT ) )
 		if ( !m_painting )					// supress sub-item draw by the list (default list painting)
 			if ( const CDiffColumnPair* pDiffPair = FindDiffColumnPair( pDispInfo->item.iSubItem ) )
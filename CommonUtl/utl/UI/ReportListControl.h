@@ -29,6 +29,7 @@
 class CFlagTags;
 class CListSelectionData;
 class CReportListCustomDraw;
+class CReportListModel;
 namespace ole { class CDataSource; }
 namespace ui { interface ICheckStatePolicy; }
 
@@ -296,7 +297,7 @@ public:
 public:
 	TRowKey MakeRowKeyAt( int index ) const			// favour item data (LPARAM), or fall back to index (int)
 	{
-		TRowKey rowKey = static_cast<TRowKey>( GetItemData( index ) );
+		TRowKey rowKey = static_cast<TRowKey>( GetItemParam( index ) );
 		return rowKey != 0 ? rowKey : static_cast<TRowKey>( index );
 	}
 
@@ -425,7 +426,7 @@ public:
 
 	// items and sub-items
 	template< typename Type >
-	Type* GetPtrAt( int index ) const { ASSERT( IsValidIndex( index ) ); return AsPtr<Type>( GetItemData( index ) ); }
+	Type* GetPtrAt( int index ) const { ASSERT( IsValidIndex( index ) ); return AsPtr<Type>( GetItemParam( index ) ); }
 
 	template< typename Type >
 	Type* GetSafePtrAt( int index ) const { return index != -1 ? GetPtrAt<Type>( index ) : nullptr; }
@@ -445,6 +446,14 @@ public:
 
 	virtual int InsertObjectItem( int index, const utl::ISubject* pObject, int imageIndex = ui::No_Image, const TCHAR* pText = nullptr );		// pText could be LPSTR_TEXTCALLBACK
 
+	// owner-data mode (LVS_OWNERDATA): the model owns the rows, the list only asks for the visible ones
+	//	Not supported: groups, extended check-state policies, item data (LPARAM) storage.
+	//
+	bool IsOwnerDataList( void ) const { return m_pListModel != nullptr; }
+	CReportListModel* GetListModel( void ) const { return m_pListModel; }
+	void SetListModel( CReportListModel* pListModel );		// not owned; requires LVS_OWNERDATA style
+	void UpdateListModelRows( void );						// after the model objects or filter changed: sort the model rows, then refresh the list
+
 	void SetSubItemTextPtr( int index, int subItem, const TCHAR* pText = LPSTR_TEXTCALLBACK, int imageIndex = ui::No_Image );
 	void SetSubItemText( int index, int subItem, const std::tstring& text, int imageIndex = ui::No_Image ) { SetSubItemTextPtr( index, subItem, text.c_str(), imageIndex ); }
 	void SetSubItemImage( int index, int subItem, int imageIndex );
@@ -531,8 +540,8 @@ public:
 	template< typename ObjectT >
 	void SetObjectsCheckedState( const std::vector<ObjectT*>* pObjects, int checkState = BST_CHECKED, bool uncheckOthers = true );
 private:
-	ui::TRawCheckState GetRawCheckState( int index ) const { return GetItemState( index, LVIS_STATEIMAGEMASK ); }
-	bool SetRawCheckState( int index, ui::TRawCheckState rawCheckState ) { return SetItemState( index, rawCheckState, LVIS_STATEIMAGEMASK ) != FALSE; }
+	ui::TRawCheckState GetRawCheckState( int index ) const;
+	bool SetRawCheckState( int index, ui::TRawCheckState rawCheckState );
 
 	static bool HasRawCheckState( ui::TRawCheckState state ) { return HasFlag( state, LVIS_STATEIMAGEMASK ); }
 
@@ -540,6 +549,13 @@ private:
 	void SetItemCheckState( int index, int checkState );
 	void NotifyCheckStatesChanged( void );
 	size_t ApplyCheckStateToSelectedItems( int toggledIndex, int checkState );
+
+	LPARAM GetItemParam( int index ) const;					// item data, or the model object in owner-data mode
+	void SortListModel( void );
+	void SyncListModelRows( void );								// after the model rows were sorted
+	void SyncListModelSelection( void );
+	void ToggleModelCheckState( int index );
+	int FindModelRow( const NMLVFINDITEM* pFindItem ) const;
 public:
 	enum ShowTopIndexMode { Vanilla, ScrollTwice, ScrollOnce, ScrollOffset };
 
@@ -729,6 +745,7 @@ private:
 	CImageList* m_pImageList;
 	CImageList* m_pLargeImageList;
 	const ui::ICheckStatePolicy* m_pCheckStatePolicy;		// for extended check states
+	CReportListModel* m_pListModel;							// owner-data mode: rows, selection and check-states are stored in the model
 
 	typedef std::pair<TRowKey, TColumn> TCellPair;			// invariant to sorting: favour LPARAMs instead of indexes
 	typedef std::unordered_map<TCellPair, ui::CTextEffect, utl::CPairHasher> TCellTextEffectMap;
@@ -772,6 +789,9 @@ protected:
 	afx_msg void OnPaint( void );
 	afx_msg BOOL OnLvnItemChanging_Reflect( NMHDR* pNmHdr, LRESULT* pResult );
 	afx_msg BOOL OnLvnItemChanged_Reflect( NMHDR* pNmHdr, LRESULT* pResult );
+	afx_msg BOOL OnLvnOdStateChanged_Reflect( NMHDR* pNmHdr, LRESULT* pResult );
+	afx_msg BOOL OnLvnOdFindItem_Reflect( NMHDR* pNmHdr, LRESULT* pResult );
+	afx_msg BOOL OnNmClick_Reflect( NMHDR* pNmHdr, LRESULT* pResult );
 	afx_msg BOOL OnHdnItemChanging_Reflect( NMHDR* pNmHdr, LRESULT* pResult );
 	afx_msg BOOL OnHdnItemChanged_Reflect( NMHDR* pNmHdr, LRESULT* pResult );
 	afx_msg BOOL OnLvnColumnClick_Reflect( NMHDR* pNmHdr, LRESULT* pResult );
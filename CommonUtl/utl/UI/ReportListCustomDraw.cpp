@@ -1,6 +1,7 @@
 
 #include "pch.h"
 #include "ReportListCustomDraw.h"
+#include "ReportListModel.h"
 #include "Color.h"
 #include "GpUtilities.h"
 #include "WndUtils.h"
@@ -30,14 +31,25 @@ CReportListCustomDraw::CReportListCustomDraw( NMLVCUSTOMDRAW* pDraw, CReportList
 	: CListLikeCustomDrawBase( &pDraw->nmcd )
 	, m_pDraw( pDraw )
 	, m_pList( safe_ptr( pList ) )
+	, m_itemParam( GetItemParam( m_pDraw, m_pList ) )
 	, m_index( static_cast<int>( m_pDraw->nmcd.dwItemSpec ) )
 	, m_subItem( m_pDraw->iSubItem )
-	, m_rowKey( m_pDraw->nmcd.lItemlParam != 0 ? m_pDraw->nmcd.lItemlParam : m_index )
-	, m_pObject( CReportListControl::ToSubject( m_pDraw->nmcd.lItemlParam ) )
+	, m_rowKey( m_itemParam != 0 ? m_itemParam : m_index )
+	, m_pObject( CReportListControl::ToSubject( m_itemParam ) )
 	, m_isReportMode( LV_VIEW_DETAILS == m_pList->GetView() )
 {
 }
 
+LPARAM CReportListCustomDraw::GetItemParam( const NMLVCUSTOMDRAW* pDraw, const CReportListControl* pList )
+{
+	int index = static_cast<int>( pDraw->nmcd.dwItemSpec );
+
+	if ( pList->IsOwnerDataList() && pList->GetListModel()->IsValidRow( index ) )
+		return pList->GetItemParam( index );			// owner-data lists don't store the item data
+
+	return pDraw->nmcd.lItemlParam;
+}
+
 bool CReportListCustomDraw::ApplyCellTextEffect( void )
 {
 	if ( s_useDefaultDraw )
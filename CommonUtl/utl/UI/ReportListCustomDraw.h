@@ -33,9 +33,11 @@ private:
 	void DrawTextFrame( const CRect& textRect, const ui::CFrameFillTraits& frameFillTraits );
 
 	bool IsSelItemContrast( void ) const;							// item is blue backgound with white text?
+	static LPARAM GetItemParam( const NMLVCUSTOMDRAW* pDraw, const CReportListControl* pList );
 private:
 	NMLVCUSTOMDRAW* m_pDraw;
 	CReportListControl* m_pList;
+	const LPARAM m_itemParam;										// item data, or the model object in owner-data mode
 public:
 	const int m_index;
 	const TColumn m_subItem;
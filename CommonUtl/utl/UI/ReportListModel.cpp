@@ -0,0 +1,256 @@
+
+#include "pch.h"
+#include "ReportListModel.h"
+#include "SubjectPredicates.h"
+#include "StringCompare.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+
+namespace lv
+{
+	namespace impl
+	{
+		// compares rows by object comparator, then by the record comparator, then by initial order
+		//
+		struct CompareRowObjects
+		{
+			CompareRowObjects( const std::vector<utl::ISubject*>& objects, const pred::IComparator* pComparator, bool ascending, const pred::IComparator* pRecordComparator )
+				: m_objects( objects ), m_pComparator( pComparator ), m_ascending( ascending ), m_pRecordComparator( pRecordComparator ) {}
+
+			bool operator()( size_t leftPos, size_t rightPos ) const
+			{
+				const utl::ISubject* pLeft = m_objects[ leftPos ];
+				const utl::ISubject* pRight = m_objects[ rightPos ];
+
+				pred::CompareResult result = pred::GetResultInOrder( m_pComparator->CompareObjects( pLeft, pRight ), m_ascending );
+
+				if ( pred::Equal == result && m_pRecordComparator != nullptr )
+					result = m_pRecordComparator->CompareObjects( pLeft, pRight );		// never use DESC order for default comparison
+
+				if ( pred::Equal == result )
+					return leftPos < rightPos;
+
+				return pred::Less == result;
+			}
+		private:
+			const std::vector<utl::ISubject*>& m_objects;
+			const pred::IComparator* m_pComparator;
+			bool m_ascending;
+			const pred::IComparator* m_pRecordComparator;
+		};
+
+
+		// row sort item: cell text is evaluated only once per row, rather than on every comparison
+		//
+		struct CRowSortItem
+		{
+			CRowSortItem( size_t pos ) : m_pos( pos ) {}
+		public:
+			size_t m_pos;
+			std::string m_key;				// intuitive sort key of the sorted column
+			std::string m_codeKey;			// intuitive sort key of the code column (first), for ties
+			std::tstring m_text;			// fallback when not encodable as sort keys
+			std::tstring m_codeText;
+		};
+
+
+		struct CompareRowSortItems
+		{
+			CompareRowSortItems( bool ascending, bool useKeys ) : m_ascending( ascending ), m_useKeys( useKeys ) {}
+
+			bool operator()( const CRowSortItem& left, const CRowSortItem& right ) const
+			{
+				pred::CompareResult result = pred::GetResultInOrder( CompareText( left.m_key, right.m_key, left.m_text, right.m_text ), m_ascending );
+
+				if ( pred::Equal == result )
+					result = CompareText( left.m_codeKey, right.m_codeKey, left.m_codeText, right.m_codeText );		// never use DESC order for default comparison
+
+				if ( pred::Equal == result )
+					return left.m_pos < right.m_pos;
+
+				return pred::Less == result;
+			}
+		private:
+			pred::CompareResult CompareText( const std::string& leftKey, const std::string& rightKey, const std::tstring& leftText, const std::tstring& rightText ) const
+			{
+				if ( m_useKeys )
+					return pred::ToCompareResult( leftKey.compare( rightKey ) );
+
+				return str::IntuitiveCompare( leftText.c_str(), rightText.c_str() );
+			}
+		private:
+			bool m_ascending;
+			bool m_useKeys;
+		};
+	}
+}
+
+
+// CReportListModel implementation
+
+CReportListModel::CReportListModel( lv::ICellSource* pCellSource )
+	: m_pCellSource( pCellSource )
+{
+	ASSERT_PTR( m_pCellSource );
+}
+
+CReportListModel::~CReportListModel()
+{
+}
+
+void CReportListModel::Clear( void )
+{
+	std::vector<utl::ISubject*> noObjects;
+	AssignObjects( noObjects );
+}
+
+void CReportListModel::AssignObjects( std::vector<utl::ISubject*>& rObjects )
+{
+	m_objects.swap( rObjects );
+
+	m_objectToPos.clear();
+	m_objectToPos.reserve( m_objects.size() );
+
+	for ( size_t pos = 0; pos != m_objects.size(); ++pos )
+		m_objectToPos[ m_objects[ pos ] ] = pos;
+
+	ASSERT( m_objectToPos.size() == m_objects.size() );		// objects must be unique
+
+	m_selected.assign( m_objects.size(), false );
+	m_checkStates.assign( m_objects.size(), BST_UNCHECKED );
+	ResetRows();
+}
+
+size_t CReportListModel::FindObjectPos( const utl::ISubject* pObject ) const
+{
+	std::unordered_map<const utl::ISubject*, size_t>::const_iterator itFound = m_objectToPos.find( pObject );
+	return itFound != m_objectToPos.end() ? itFound->second : utl::npos;
+}
+
+int CReportListModel::FindRow( const utl::ISubject* pObject ) const
+{
+	size_t pos = FindObjectPos( pObject );
+	return pos != utl::npos ? m_posToRow[ pos ] : -1;
+}
+
+void CReportListModel::ResetRows( void )
+{
+	m_rows.resize( m_objects.size() );
+
+	for ( size_t pos = 0; pos != m_objects.size(); ++pos )
+		m_rows[ pos ] = pos;
+
+	UpdatePosToRow();
+}
+
+void CReportListModel::UpdatePosToRow( void )
+{
+	m_posToRow.assign( m_objects.size(), -1 );
+
+	for ( size_t row = 0; row != m_rows.size(); ++row )
+		m_posToRow[ m_rows[ row ] ] = static_cast<int>( row );
+}
+
+void CReportListModel::SortRows( int byColumn, bool ascending /*= true*/, const pred::IComparator* pComparator /*= nullptr*/, const pred::IComparator* pRecordComparator /*= nullptr*/ )
+{
+	if ( -1 == byColumn )
+		std::sort( m_rows.begin(), m_rows.end() );			// restore initial order of the visible rows
+	else if ( pComparator != nullptr )
+		std::sort( m_rows.begin(), m_rows.end(), lv::impl::CompareRowObjects( m_objects, pComparator, ascending, pRecordComparator ) );	// total order: ties broken by position
+	else
+		SortRowsByText( byColumn, ascending );
+
+	UpdatePosToRow();
+}
+
+void CReportListModel::SortRowsByText( int byColumn, bool ascending )
+{
+	enum { CodeColumn = 0 };				// first column, the one with the icon
+
+	std::vector<lv::impl::CRowSortItem> sortItems;
+	sortItems.reserve( m_rows.size() );
+
+	bool useKeys = true;
+
+	for ( std::vector<size_t>::const_iterator itPos = m_rows.begin(); itPos != m_rows.end(); ++itPos )
+	{
+		sortItems.push_back( lv::impl::CRowSortItem( *itPos ) );
+
+		lv::impl::CRowSortItem& rItem = sortItems.back();
+		const utl::ISubject* pObject = m_objects[ *itPos ];
+
+		rItem.m_text = m_pCellSource->FormatCellText( pObject, byColumn );
+		if ( byColumn != CodeColumn )
+			rItem.m_codeText = m_pCellSource->FormatCellText( pObject, CodeColumn );
+
+		if ( useKeys )
+			useKeys = str::MakeIntuitiveSortKey( rItem.m_key, rItem.m_text.c_str() ) && str::MakeIntuitiveSortKey( rItem.m_codeKey, rItem.m_codeText.c_str() );
+	}
+
+	if ( useKeys )
+		for ( std::vector<lv::impl::CRowSortItem>::iterator itItem = sortItems.begin(); itItem != sortItems.end(); ++itItem )
+		{	// release the text, compare only by keys
+			std::tstring().swap( itItem->m_text );
+			std::tstring().swap( itItem->m_codeText );
+		}
+
+	std::sort( sortItems.begin(), sortItems.end(), lv::impl::CompareRowSortItems( ascending, useKeys ) );
+
+	for ( size_t row = 0; row != sortItems.size(); ++row )
+		m_rows[ row ] = sortItems[ row ].m_pos;
+}
+
+void CReportListModel::SelectRows( int firstRow, int lastRow, bool select /*= true*/ )
+{
+	ASSERT( IsValidRow( firstRow ) && IsValidRow( lastRow ) && firstRow <= lastRow );
+
+	for ( int row = firstRow; row <= lastRow; ++row )
+		m_selected[ m_rows[ row ] ] = select;
+}
+
+void CReportListModel::SelectAllRows( bool select /*= true*/ )
+{
+	if ( m_rows.size() == m_objects.size() )
+		m_selected.assign( m_objects.size(), select );
+	else
+		for ( std::vector<size_t>::const_iterator itPos = m_rows.begin(); itPos != m_rows.end(); ++itPos )
+			m_selected[ *itPos ] = select;
+}
+
+size_t CReportListModel::GetSelectedCount( void ) const
+{
+	size_t selCount = 0;
+
+	for ( std::vector<size_t>::const_iterator itPos = m_rows.begin(); itPos != m_rows.end(); ++itPos )
+		if ( m_selected[ *itPos ] )
+			++selCount;
+
+	return selCount;
+}
+
+void CReportListModel::QuerySelectedRows( std::vector<int>& rSelRows ) const
+{
+	for ( size_t row = 0; row != m_rows.size(); ++row )
+		if ( m_selected[ m_rows[ row ] ] )
+			rSelRows.push_back( static_cast<int>( row ) );
+}
+
+void CReportListModel::SetCheckedAll( bool check /*= true*/ )
+{
+	for ( std::vector<size_t>::const_iterator itPos = m_rows.begin(); itPos != m_rows.end(); ++itPos )
+		m_checkStates[ *itPos ] = check ? BST_CHECKED : BST_UNCHECKED;
+}
+
+size_t CReportListModel::GetCheckedCount( void ) const
+{
+	size_t checkedCount = 0;
+
+	for ( std::vector<size_t>::const_iterator itPos = m_rows.begin(); itPos != m_rows.end(); ++itPos )
+		if ( BST_CHECKED == m_checkStates[ *itPos ] )
+			++checkedCount;
+
+	return checkedCount;
+}
@@ -0,0 +1,169 @@
+#ifndef ReportListModel_h
+#define ReportListModel_h
+#pragma once
+
+#include <unordered_map>
+
+
+namespace utl { interface ISubject; }
+namespace pred { interface IComparator; }
+
+
+namespace lv
+{
+	// supplies the cells content of an owner-data list: called only for the visible rows
+	//
+	interface ICellSource
+	{
+		virtual std::tstring FormatCellText( const utl::ISubject* pObject, int column ) const = 0;
+		virtual int GetCellImageIndex( const utl::ISubject* pObject, int column ) const = 0;		// ui::No_Image for none
+	};
+
+
+	namespace impl
+	{
+		template< typename LessPred >
+		struct CompareRowsBy
+		{
+			CompareRowsBy( const std::vector<utl::ISubject*>& objects, LessPred isLess ) : m_objects( objects ), m_isLess( isLess ) {}
+
+			bool operator()( size_t leftPos, size_t rightPos ) const { return m_isLess( m_objects[ leftPos ], m_objects[ rightPos ] ); }
+		private:
+			const std::vector<utl::ISubject*>& m_objects;
+			LessPred m_isLess;
+		};
+	}
+}
+
+
+// Data model of a CReportListControl in owner-data mode (LVS_OWNERDATA): the list-ctrl stores no items, it only asks for the visible rows.
+// Rows are an index vector into the objects: sorting and filtering permute the indexes, without touching the list-ctrl.
+// Selection and check-states are stored by object position, invariant to sorting and filtering; the counts and queries apply to the visible rows.
+//
+class CReportListModel : private utl::noncopyable
+{
+public:
+	CReportListModel( lv::ICellSource* pCellSource );
+	~CReportListModel();
+
+	lv::ICellSource* GetCellSource( void ) const { return m_pCellSource; }
+
+	void Clear( void );
+
+	template< typename ObjectT >
+	void SetObjects( const std::vector<ObjectT*>& objects );			// objects in initial order; resets the rows, selection and check-states
+
+	size_t GetObjectCount( void ) const { return m_objects.size(); }
+	utl::ISubject* GetObjectAt( size_t pos ) const { ASSERT( pos < m_objects.size() ); return m_objects[ pos ]; }
+	size_t FindObjectPos( const utl::ISubject* pObject ) const;			// utl::npos if missing
+
+	// rows: object positions in display order
+	int GetRowCount( void ) const { return static_cast<int>( m_rows.size() ); }
+	bool IsValidRow( int row ) const { return row >= 0 && row < GetRowCount(); }
+	size_t GetRowPos( int row ) const { ASSERT( IsValidRow( row ) ); return m_rows[ row ]; }
+	utl::ISubject* GetRowObject( int row ) const { return m_objects[ GetRowPos( row ) ]; }
+
+	int FindRow( const utl::ISubject* pObject ) const;					// -1 if missing or filtered out
+	int FindRowOfPos( size_t pos ) const { ASSERT( pos < m_posToRow.size() ); return m_posToRow[ pos ]; }
+
+	std::tstring FormatCellText( int row, int column ) const { return m_pCellSource->FormatCellText( GetRowObject( row ), column ); }
+	int GetCellImageIndex( int row, int column ) const { return m_pCellSource->GetCellImageIndex( GetRowObject( row ), column ); }
+
+	void ResetRows( void );												// all objects, in initial order
+
+	template< typename UnaryPred >
+	size_t FilterRows( UnaryPred isVisible );							// objects matching isVisible( const utl::ISubject* ), in initial order; returns the row count
+
+	void SortRows( int byColumn, bool ascending = true, const pred::IComparator* pComparator = nullptr, const pred::IComparator* pRecordComparator = nullptr );	// -1 for initial order
+
+	template< typename LessPred >
+	void SortRowsBy( LessPred isLess );									// custom order by isLess( const utl::ISubject*, const utl::ISubject* ); stable for equivalent rows
+
+	// selection
+	bool IsSelectedRow( int row ) const { return m_selected[ GetRowPos( row ) ]; }
+	void SelectRows( int firstRow, int lastRow, bool select = true );	// inclusive range
+	void SelectAllRows( bool select = true );
+	size_t GetSelectedCount( void ) const;								// visible rows only
+	void QuerySelectedRows( std::vector<int>& rSelRows ) const;			// in display order
+
+	template< typename ObjectT >
+	void QuerySelectedObjects( std::vector<ObjectT*>& rSelObjects ) const;
+
+	// check-states: BST_UNCHECKED/BST_CHECKED, or custom states of a ui::ICheckStatePolicy
+	int GetRowCheckState( int row ) const { return m_checkStates[ GetRowPos( row ) ]; }
+	void SetRowCheckState( int row, int checkState ) { ASSERT( checkState >= 0 && checkState <= UCHAR_MAX ); m_checkStates[ GetRowPos( row ) ] = static_cast<BYTE>( checkState ); }
+
+	bool IsCheckedRow( int row ) const { return BST_CHECKED == GetRowCheckState( row ); }
+	void SetCheckedRow( int row, bool check = true ) { SetRowCheckState( row, check ? BST_CHECKED : BST_UNCHECKED ); }
+	void SetCheckedAll( bool check = true );							// visible rows only
+	size_t GetCheckedCount( void ) const;								// visible rows only
+
+	template< typename ObjectT >
+	void QueryCheckedObjects( std::vector<ObjectT*>& rCheckedObjects ) const;
+private:
+	void AssignObjects( std::vector<utl::ISubject*>& rObjects );		// swaps in the objects
+	void UpdatePosToRow( void );
+	void SortRowsByText( int byColumn, bool ascending );
+private:
+	lv::ICellSource* m_pCellSource;
+	std::vector<utl::ISubject*> m_objects;								// in initial order
+	std::unordered_map<const utl::ISubject*, size_t> m_objectToPos;
+	std::vector<size_t> m_rows;											// display row -> object position
+	std::vector<int> m_posToRow;										// object position -> display row (-1 if filtered out)
+	std::vector<bool> m_selected;										// bitset by object position
+	std::vector<BYTE> m_checkStates;									// by object position
+};
+
+
+// CReportListModel template code
+
+template< typename ObjectT >
+void CReportListModel::SetObjects( const std::vector<ObjectT*>& objects )
+{
+	std::vector<utl::ISubject*> subjects;
+	subjects.reserve( objects.size() );
+
+	for ( typename std::vector<ObjectT*>::const_iterator itObject = objects.begin(); itObject != objects.end(); ++itObject )
+		subjects.push_back( *itObject );
+
+	AssignObjects( subjects );
+}
+
+template< typename UnaryPred >
+size_t CReportListModel::FilterRows( UnaryPred isVisible )
+{
+	m_rows.clear();
+
+	for ( size_t pos = 0; pos != m_objects.size(); ++pos )
+		if ( isVisible( const_cast<const utl::ISubject*>( m_objects[ pos ] ) ) )
+			m_rows.push_back( pos );
+
+	UpdatePosToRow();
+	return m_rows.size();
+}
+
+template< typename LessPred >
+void CReportListModel::SortRowsBy( LessPred isLess )
+{
+	std::stable_sort( m_rows.begin(), m_rows.end(), lv::impl::CompareRowsBy<LessPred>( m_objects, isLess ) );
+	UpdatePosToRow();
+}
+
+template< typename ObjectT >
+void CReportListModel::QuerySelectedObjects( std::vector<ObjectT*>& rSelObjects ) const
+{
+	for ( std::vector<size_t>::const_iterator itPos = m_rows.begin(); itPos != m_rows.end(); ++itPos )
+		if ( m_selected[ *itPos ] )
+			rSelObjects.push_back( checked_static_cast<ObjectT*>( m_objects[ *itPos ] ) );
+}
+
+template< typename ObjectT >
+void CReportListModel::QueryCheckedObjects( std::vector<ObjectT*>& rCheckedObjects ) const
+{
+	for ( std::vector<size_t>::const_iterator itPos = m_rows.begin(); itPos != m_rows.end(); ++itPos )
+		if ( BST_CHECKED == m_checkStates[ *itPos ] )
+			rCheckedObjects.push_back( checked_static_cast<ObjectT*>( m_objects[ *itPos ] ) );
+}
+
+
+#endif // ReportListModel_h
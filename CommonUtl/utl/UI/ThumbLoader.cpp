@@ -0,0 +1,267 @@
+
+#include "pch.h"
+#include "ThumbLoader.h"
+#include "ContainerOwnership.h"
+#include "ImagingWic.h"
+#include "MultiThreading.h"
+#include "StructuredStorage.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+
+namespace thumb
+{
+	// CPrefetchRange implementation
+
+	bool CPrefetchRange::Update( int topIndex, int pageCount, DWORD tickCount /*= ::GetTickCount()*/ )
+	{
+		if ( topIndex == m_topIndex && pageCount == m_pageCount )
+			return false;
+
+		DWORD elapsedMs = tickCount - m_lastTick;
+
+		if ( -1 == m_topIndex || 0 == m_lastTick || elapsedMs > IdleMs )
+			m_velocity = 0.0;					// start scrolling from idle
+		else
+		{
+			double currVelocity = ( topIndex - m_topIndex ) * 1000.0 / std::max( elapsedMs, 1ul );
+			m_velocity = ( m_velocity + currVelocity ) / 2;			// smooth out jerky scroll steps
+		}
+
+		m_topIndex = topIndex;
+		m_pageCount = std::max( pageCount, 1 );
+		m_lastTick = tickCount;
+		return true;
+	}
+
+	int CPrefetchRange::GetAheadCount( void ) const
+	{
+		enum { LookAheadMs = 500 };
+
+		// when scrolling fast, prefetch the items that will be visible in the next LookAheadMs
+		double lookAheadPages = std::abs( m_velocity ) * LookAheadMs / 1000 / m_pageCount;
+		return static_cast<int>( m_pageCount * ( 1 + std::min( lookAheadPages, double( MaxAheadPages - 1 ) ) ) );
+	}
+
+	int CPrefetchRange::GetBehindCount( void ) const
+	{
+		return 0.0 == m_velocity ? m_pageCount : std::max( m_pageCount / 2, 1 );		// less behind while scrolling
+	}
+
+	void CPrefetchRange::QueryIndexes( std::vector<int>& rIndexes, int itemCount ) const
+	{
+		rIndexes.clear();
+		if ( m_topIndex < 0 || itemCount <= 0 )
+			return;
+
+		int first = std::min( m_topIndex, itemCount ), last = std::min( m_topIndex + m_pageCount, itemCount );
+		int aheadCount = GetAheadCount(), behindCount = GetBehindCount();
+
+		for ( int index = first; index != last; ++index )
+			rIndexes.push_back( index );							// visible items
+
+		if ( m_velocity >= 0.0 )
+		{	// scrolling forward (or idle)
+			for ( int index = last, endIndex = std::min( last + aheadCount, itemCount ); index < endIndex; ++index )
+				rIndexes.push_back( index );
+			for ( int index = first - 1, endIndex = std::max( first - behindCount, 0 ); index >= endIndex; --index )
+				rIndexes.push_back( index );
+		}
+		else
+		{	// scrolling backwards
+			for ( int index = first - 1, endIndex = std::max( first - aheadCount, 0 ); index >= endIndex; --index )
+				rIndexes.push_back( index );
+			for ( int index = last, endIndex = std::min( last + behindCount, itemCount ); index < endIndex; ++index )
+				rIndexes.push_back( index );
+		}
+	}
+}
+
+
+// CThumbLoader implementation
+
+CThumbLoader::CThumbLoader( const CThumbnailer* pSrcThumbnailer, CThumbPack* pThumbPack /*= nullptr*/ )
+	: m_boundsSize( pSrcThumbnailer->GetBoundsSize() )
+	, m_scalingMethod( pSrcThumbnailer->GetScalingMethod() )
+	, m_thumbnailerFlags( pSrcThumbnailer->m_flags )
+	, m_pThumbPack( pThumbPack )
+	, m_wantExit( false )
+	, m_producing( false )
+	, m_thread( std::bind( &CThumbLoader::ProduceLoop, this ) )
+{
+}
+
+CThumbLoader::~CThumbLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_wantExit = true;
+		m_pendingQueue.clear();
+		m_queuePending.notify_one();
+	}
+	m_thread.join();			// wait for the current thumb production to finish
+
+	utl::ClearOwningContainer( m_producedThumbs );		// delete the thumbs not fetched
+}
+
+void CThumbLoader::SyncSettings( const CThumbnailer* pSrcThumbnailer )
+{
+	ASSERT_PTR( pSrcThumbnailer );
+	REQUIRE( pSrcThumbnailer->GetBoundsSize() == m_boundsSize );		// bounds changes require a new loader (and thumb pack)
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+	m_scalingMethod = pSrcThumbnailer->GetScalingMethod();
+	m_thumbnailerFlags = pSrcThumbnailer->m_flags;
+}
+
+void CThumbLoader::Request( const std::vector<fs::CFlexPath>& srcImagePaths )
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+
+	m_pendingQueue.assign( srcImagePaths.begin(), srcImagePaths.end() );		// cancel the requests no longer wanted
+	if ( !m_pendingQueue.empty() )
+		m_queuePending.notify_one();
+}
+
+void CThumbLoader::CancelAll( void )
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+	m_pendingQueue.clear();
+}
+
+bool CThumbLoader::IsBusy( void ) const
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+	return m_producing || !m_pendingQueue.empty() || !m_producedThumbs.empty();
+}
+
+bool CThumbLoader::IsFailed( const fs::CFlexPath& srcImagePath ) const
+{
+	CTime failedModifTime;
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+
+		std::unordered_map<fs::CFlexPath, CTime>::const_iterator itFailed = m_failedPaths.find( srcImagePath );
+		if ( itFailed == m_failedPaths.end() )
+			return false;
+
+		failedModifTime = itFailed->second;
+	}
+
+	return fs::flex::ReadLastModifyTime( srcImagePath ) == failedModifTime;		// a modified image gets another chance
+}
+
+size_t CThumbLoader::FetchProduced( std::vector<CCachedThumbBitmap*>& rProducedThumbs )
+{
+	utl::COwningContainer< std::vector<CProducedThumb*> > producedThumbs;
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		producedThumbs.swap( m_producedThumbs );
+	}
+
+	size_t count = 0;
+
+	for ( std::vector<CProducedThumb*>::const_iterator itProduced = producedThumbs.begin(); itProduced != producedThumbs.end(); ++itProduced )
+		if ( CCachedThumbBitmap* pThumb = MakeThumb( *itProduced ) )		// WIC bitmap created in the owner's apartment
+		{
+			rProducedThumbs.push_back( pThumb );
+			++count;
+		}
+
+	return count;
+}
+
+CThumbLoader::CProducedThumb* CThumbLoader::DetachThumb( const CCachedThumbBitmap* pThumb )
+{
+	ASSERT_PTR( pThumb );
+
+	CComPtr<IWICBitmapSource> pSrcBitmap;
+	if ( !HR_OK( ::WICConvertBitmapSource( GUID_WICPixelFormat32bppPBGRA, pThumb->GetWicBitmap(), &pSrcBitmap ) ) )
+		return nullptr;
+
+	std::auto_ptr<CProducedThumb> pProduced( new CProducedThumb() );
+
+	pProduced->m_srcImagePath = pThumb->GetSrcImagePath();
+	pProduced->m_lastModifTime = pThumb->m_lastModifTime;
+	pProduced->m_unscaledBmpSize = pThumb->GetUnscaledBmpSize();
+	pProduced->m_thumbSize = wic::GetBitmapSize( pSrcBitmap );
+
+	UINT stride = pProduced->m_thumbSize.cx * 4;
+	pProduced->m_pixels.resize( stride * pProduced->m_thumbSize.cy );
+
+	if ( pProduced->m_pixels.empty() || !HR_OK( pSrcBitmap->CopyPixels( nullptr, stride, static_cast<UINT>( pProduced->m_pixels.size() ), &pProduced->m_pixels.front() ) ) )
+		return nullptr;
+
+	return pProduced.release();
+}
+
+CCachedThumbBitmap* CThumbLoader::MakeThumb( const CProducedThumb* pProduced )
+{
+	ASSERT_PTR( pProduced );
+
+	UINT stride = pProduced->m_thumbSize.cx * 4;
+	CComPtr<IWICBitmap> pThumbBitmap;
+
+	if ( !HR_OK( wic::CImagingFactory::Factory()->CreateBitmapFromMemory( pProduced->m_thumbSize.cx, pProduced->m_thumbSize.cy, GUID_WICPixelFormat32bppPBGRA,
+																		   stride, static_cast<UINT>( pProduced->m_pixels.size() ), const_cast<BYTE*>( &pProduced->m_pixels.front() ), &pThumbBitmap ) ) )
+		return nullptr;
+
+	return new CCachedThumbBitmap( pThumbBitmap, pProduced->m_srcImagePath, pProduced->m_lastModifTime, pProduced->m_unscaledBmpSize );
+}
+
+void CThumbLoader::ProduceLoop( void )
+{
+	mt::CScopedInitializeCom scopedCom;
+	CThumbnailer thumbnailer( 1 );			// no caching: produced thumbs are passed to the owner
+
+	thumbnailer.SetBoundsSize( m_boundsSize );
+	thumbnailer.SetThumbPack( m_pThumbPack );
+
+	for ( ;; )
+	{
+		fs::CFlexPath srcImagePath;
+		{
+			std::unique_lock<std::mutex> lock( m_mutex );
+			m_producing = false;
+			m_queuePending.wait( lock, std::bind( &CThumbLoader::WaitPred, this ) );
+
+			if ( m_wantExit )
+				return;
+
+			srcImagePath = m_pendingQueue.front();
+			m_pendingQueue.pop_front();
+			m_producing = true;
+
+			thumbnailer.SetScalingMethod( m_scalingMethod );		// the owner may have changed the settings
+			thumbnailer.m_flags = m_thumbnailerFlags;
+		}
+
+		CProducedThumb* pProduced = nullptr;
+		try
+		{
+			std::auto_ptr<CCachedThumbBitmap> pThumb( thumbnailer.ProduceThumbnail( srcImagePath ) );
+
+			if ( pThumb.get() != nullptr )
+				pProduced = DetachThumb( pThumb.get() );			// the WIC objects are released in this apartment
+		}
+		catch ( CException* pExc )
+		{
+			pExc->Delete();
+		}
+
+		CTime failedModifTime;
+		if ( nullptr == pProduced )
+			failedModifTime = fs::flex::ReadLastModifyTime( srcImagePath );		// outside the lock: may hit the disk
+
+		std::lock_guard<std::mutex> lock( m_mutex );
+		if ( pProduced != nullptr )
+		{
+			m_producedThumbs.push_back( pProduced );
+			m_failedPaths.erase( srcImagePath );
+		}
+		else
+			m_failedPaths[ srcImagePath ] = failedModifTime;		// don't decode it again on each repaint
+	}
+}
@@ -0,0 +1,100 @@
+#ifndef ThumbLoader_h
+#define ThumbLoader_h
+#pragma once
+
+#include "FlexPath.h"
+#include "StdThread.h"
+#include "Thumbnailer.h"
+#include <unordered_map>
+
+
+class CThumbPack;
+
+
+namespace thumb
+{
+	// Tracks the visible range of a thumbs list and its scroll velocity, to order the items to prefetch:
+	// the visible items first, then ahead of the scroll direction, then behind it.
+	//
+	class CPrefetchRange
+	{
+	public:
+		CPrefetchRange( void ) : m_topIndex( -1 ), m_pageCount( 0 ), m_velocity( 0.0 ), m_lastTick( 0 ) {}
+
+		void Reset( void ) { *this = CPrefetchRange(); }
+
+		int GetTopIndex( void ) const { return m_topIndex; }
+		int GetPageCount( void ) const { return m_pageCount; }
+		double GetVelocity( void ) const { return m_velocity; }		// items per second: negative when scrolling backwards
+
+		bool Update( int topIndex, int pageCount, DWORD tickCount = ::GetTickCount() );		// returns true if the visible range has changed
+		void QueryIndexes( std::vector<int>& rIndexes, int itemCount ) const;
+
+		int GetAheadCount( void ) const;
+		int GetBehindCount( void ) const;
+	private:
+		int m_topIndex;
+		int m_pageCount;
+		double m_velocity;				// smoothed
+		DWORD m_lastTick;
+	public:
+		enum { MaxAheadPages = 4, IdleMs = 500 };
+	};
+}
+
+
+// Produces thumbnails in a background thread, using a CThumbnailer of its own (COM is not shared between threads).
+// The owner requests the paths in priority order; the pending requests missing from a new request list are cancelled.
+// The produced thumbs are kept as plain pixels until fetched by the owner (UI thread), which makes the WIC bitmaps in its own apartment.
+// The images that failed to produce a thumb (e.g. corrupt files) are recorded with their modify time, so that the owner doesn't request them again until modified.
+// The thumb pack must outlive the loader: destroy the loader (joins the thread) before closing the pack.
+//
+class CThumbLoader : private utl::noncopyable
+{
+public:
+	CThumbLoader( const CThumbnailer* pSrcThumbnailer, CThumbPack* pThumbPack = nullptr );		// copies the thumb bounds, scaling and flags
+	~CThumbLoader();
+
+	void SyncSettings( const CThumbnailer* pSrcThumbnailer );	// copies the scaling and flags, used by the next thumbs produced
+
+	void Request( const std::vector<fs::CFlexPath>& srcImagePaths );		// replaces the pending requests
+	void CancelAll( void );
+
+	bool IsBusy( void ) const;									// any pending, in production, or not fetched
+	bool IsFailed( const fs::CFlexPath& srcImagePath ) const;	// failed to produce, and not modified since
+	size_t FetchProduced( std::vector<CCachedThumbBitmap*>& rProducedThumbs );		// transfers ownership to the caller; call on the owner thread
+private:
+	// a thumb detached from the worker's COM apartment
+	struct CProducedThumb
+	{
+		fs::CFlexPath m_srcImagePath;
+		CTime m_lastModifTime;
+		CSize m_unscaledBmpSize;
+		CSize m_thumbSize;
+		std::vector<BYTE> m_pixels;								// 32bppPBGRA
+	};
+
+	static CProducedThumb* DetachThumb( const CCachedThumbBitmap* pThumb );		// in the worker thread
+	static CCachedThumbBitmap* MakeThumb( const CProducedThumb* pProduced );	// in the owner thread
+
+	void ProduceLoop( void );
+	bool WaitPred( void ) const { return m_wantExit || !m_pendingQueue.empty(); }
+private:
+	// thumbnailer settings
+	const CSize m_boundsSize;
+	thumb::ScalingMethod m_scalingMethod;						// guarded by m_mutex
+	int m_thumbnailerFlags;										// guarded by m_mutex
+	CThumbPack* m_pThumbPack;
+
+	bool m_wantExit;
+	bool m_producing;
+	std::deque<fs::CFlexPath> m_pendingQueue;					// in order of priority
+	std::vector<CProducedThumb*> m_producedThumbs;				// owned until fetched
+	std::unordered_map<fs::CFlexPath, CTime> m_failedPaths;		// image path -> modify time when it failed
+	mutable std::mutex m_mutex;
+	std::condition_variable m_queuePending;
+	std::thread m_thread;										// must be the last data member: starts after all members are initialized
+};
+
+
+#endif // ThumbLoader_h
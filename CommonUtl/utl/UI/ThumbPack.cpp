@@ -0,0 +1,575 @@
+
+#include "pch.h"
+#include "ThumbPack.h"
+#include "ImagingWic.h"
+#include "FileEnumerator.h"
+#include "FileSystem.h"
+#include "MultiThreading.h"
+#include "StringUtilities.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+
+namespace thumb
+{
+	std::tstring CPackStats::Format( void ) const
+	{
+		return str::Format( _T("hits=%d (%.1f%%)  misses=%d  stale=%d  stored=%d  evicted=%d"),
+			m_hitCount, GetHitRatio() * 100.0, m_missCount, m_staleCount, m_storeCount, m_evictCount );
+	}
+}
+
+
+// CThumbPack file layout: a page-sized header followed by slotCount fixed-size slots
+
+struct CThumbPack::CPackHeader
+{
+	enum { Magic = 0x4B505454 /* 'TTPK' */, Version = 1, Size = 4096 };
+
+	static DWORD GetLayoutTag( void ) { return MAKELONG( sizeof( TCHAR ), sizeof( size_t ) ); }		// path chars and path hash width
+
+	static UINT GetSlotSize( const CSize& boundsSize );
+public:
+	DWORD m_magic;
+	DWORD m_version;
+	DWORD m_layoutTag;
+	CSize m_boundsSize;
+	UINT m_slotCount;
+	UINT m_slotSize;				// slot header and pixels
+	UINT m_usedCount;
+	UINT64 m_accessClock;			// incremented on each load/store, for LRU eviction
+};
+
+
+struct CThumbPack::CSlot
+{
+	bool IsEmpty( void ) const { return 0 == m_width; }
+	BYTE* GetPixels( void ) { return reinterpret_cast<BYTE*>( this ) + HeaderSize; }
+	UINT GetStride( void ) const { return m_width * 4; }
+
+	bool HasPath( const fs::CFlexPath& srcImagePath, size_t pathHash ) const
+	{
+		return !IsEmpty() && m_pathHash == pathHash && path::Equivalent( m_path, srcImagePath.GetPtr() );
+	}
+
+	void Clear( void ) { m_width = m_height = 0; m_pathHash = 0; m_path[ 0 ] = _T('\0'); }
+
+	bool IsValid( const CSize& boundsSize ) const;
+public:
+	enum { HeaderSize = 1024 };		// pixels start aligned; must hold the fields below
+
+	UINT64 m_pathHash;
+	__time64_t m_lastModifTime;		// of the source image
+	UINT64 m_accessStamp;
+	GUID m_pixelFormat;				// a 32bpp format
+	UINT m_width, m_height;			// 0 width for empty slots
+	CSize m_unscaledBmpSize;
+	TCHAR m_path[ MAX_PATH ];
+};
+
+
+UINT CThumbPack::CPackHeader::GetSlotSize( const CSize& boundsSize )
+{
+	C_ASSERT( sizeof( CPackHeader ) <= CPackHeader::Size && sizeof( CSlot ) <= CSlot::HeaderSize );
+
+	return CSlot::HeaderSize + boundsSize.cx * boundsSize.cy * 4;
+}
+
+
+// CThumbPack implementation
+
+namespace hlp
+{
+	inline bool IsPackablePixelFormat( const WICPixelFormatGUID& pixelFormat )
+	{	// 32bpp formats stored as is, so that thumbs without alpha channel are not drawn as transparent
+		return
+			GUID_WICPixelFormat32bppPBGRA == pixelFormat ||
+			GUID_WICPixelFormat32bppBGRA == pixelFormat ||
+			GUID_WICPixelFormat32bppBGR == pixelFormat;
+	}
+
+	struct CPackFile
+	{
+		CPackFile( const fs::CPath& filePath ) : m_filePath( filePath ), m_modifyTime( fs::ReadLastModifyTime( filePath ) ) {}
+
+		bool operator<( const CPackFile& right ) const { return m_modifyTime > right.m_modifyTime; }		// most recently used first
+	public:
+		fs::CPath m_filePath;
+		CTime m_modifyTime;
+	};
+}
+
+
+bool CThumbPack::CSlot::IsValid( const CSize& boundsSize ) const
+{	// the pixels of a used slot must fit in the slot, since the thumb bitmap is created straight from the mapped view
+	if ( IsEmpty() )
+		return true;
+
+	return
+		m_width <= static_cast<UINT>( boundsSize.cx ) &&
+		m_height != 0 && m_height <= static_cast<UINT>( boundsSize.cy ) &&
+		hlp::IsPackablePixelFormat( m_pixelFormat ) &&
+		std::find( m_path, m_path + COUNT_OF( m_path ), _T('\0') ) != m_path + COUNT_OF( m_path );		// null-terminated path
+}
+
+
+#ifdef _WIN64
+	const UINT64 CThumbPack::MaxPackFileSize = 2ull * 1024 * 1024 * 1024;
+#else
+	const UINT64 CThumbPack::MaxPackFileSize = 256 * 1024 * 1024;
+#endif
+
+CThumbPack::CThumbPack( void )
+	: m_pHeader( nullptr )
+{
+}
+
+UINT CThumbPack::GetSlotCountFor( size_t imageCount )
+{
+	return static_cast<UINT>( std::max<size_t>( MinSlotCount, imageCount + imageCount / 3 ) );
+}
+
+UINT CThumbPack::GetMaxSlotCount( const CSize& boundsSize )
+{
+	return static_cast<UINT>( std::max<UINT64>( 1, ( MaxPackFileSize - CPackHeader::Size ) / CPackHeader::GetSlotSize( boundsSize ) ) );
+}
+
+UINT64 CThumbPack::GetPackFileSize( UINT slotCount, UINT slotSize )
+{
+	return CPackHeader::Size + static_cast<UINT64>( slotCount ) * slotSize;
+}
+
+fs::TDirPath CThumbPack::GetPackDirPath( void )
+{
+	return fs::GetTempDirPath() / _T("ThumbPacks");
+}
+
+fs::CPath CThumbPack::MakePackFilePath( const fs::CPath& ownerPath, const CSize& boundsSize )
+{
+	std::tstring fname = str::Format( _T("%s_%08X_%dx%d.tpk"), ownerPath.GetFname().c_str(), static_cast<UINT>( ownerPath.GetHashValue() ), boundsSize.cx, boundsSize.cy );
+
+	return GetPackDirPath() / fname.c_str();
+}
+
+size_t CThumbPack::PruneStalePacks( const CTimeSpan& maxAge, UINT64 maxTotalSize )
+{
+	std::vector<fs::CPath> filePaths;
+	fs::EnumFilePaths( filePaths, GetPackDirPath(), _T("*.tpk") );
+
+	std::vector<hlp::CPackFile> packFiles( filePaths.begin(), filePaths.end() );
+	std::sort( packFiles.begin(), packFiles.end() );
+
+	const CTime oldestTime = CTime::GetCurrentTime() - maxAge;
+	UINT64 totalSize = 0;
+	size_t deletedCount = 0;
+
+	for ( std::vector<hlp::CPackFile>::const_iterator itPackFile = packFiles.begin(); itPackFile != packFiles.end(); ++itPackFile )
+	{
+		UINT64 fileSize = fs::GetFileSize( itPackFile->m_filePath.GetPtr() );
+
+		if ( itPackFile->m_modifyTime < oldestTime || totalSize + fileSize > maxTotalSize )
+			if ( fs::DeleteFile( itPackFile->m_filePath.GetPtr() ) )		// fails for packs open by an instance
+			{
+				TRACE( _T(" CThumbPack::PruneStalePacks(): deleted stale pack '%s'\n"), itPackFile->m_filePath.GetPtr() );
+				++deletedCount;
+				continue;
+			}
+
+		totalSize += fileSize;
+	}
+	return deletedCount;
+}
+
+bool CThumbPack::Open( const fs::CPath& packFilePath, const CSize& boundsSize, UINT slotCount /*= DefaultSlotCount*/ )
+{
+	REQUIRE( boundsSize.cx > 0 && boundsSize.cy > 0 && slotCount != 0 );
+	mt::CAutoLock lock( &m_cs );
+
+	Close();
+
+	if ( !fs::CreateDirPath( packFilePath.GetParentPath().GetPtr() ) )
+		return false;
+
+	m_file.Reset( ::CreateFile( packFilePath.GetPtr(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr ) );
+	if ( !m_file.IsValid() )
+	{
+		TRACE( _T(" * CThumbPack::Open(): cannot open pack file '%s' (probably in use by another instance)\n"), packFilePath.GetPtr() );
+		return false;
+	}
+
+	m_packFilePath = packFilePath;
+
+	LARGE_INTEGER fileSize;
+	if ( ::GetFileSizeEx( m_file.Get(), &fileSize ) && fileSize.QuadPart != 0 )
+		if ( MapFile( fileSize.QuadPart ) )
+			if ( IsValidLayout( boundsSize, fileSize.QuadPart ) && ValidateSlots() )
+			{	// reuse the existing pack
+				TouchFile();						// recently used: not pruned
+
+				if ( m_pHeader->m_slotCount < slotCount )
+					Grow( slotCount );				// more images in the album
+				return IsOpen();
+			}
+			else
+				UnmapFile();
+
+	// create a new pack, limiting the file size (slots are large for big bounds)
+	if ( !ResizeFile( 0 ) )					// truncate any old pack
+	{
+		Close();
+		return false;
+	}
+
+	slotCount = std::min( slotCount, GetMaxSlotCount( boundsSize ) );
+
+	if ( MapFile( GetPackFileSize( slotCount, CPackHeader::GetSlotSize( boundsSize ) ) ) )		// extends the file
+	{
+		InitLayout( boundsSize, slotCount );
+		return true;
+	}
+
+	Close();
+	return false;
+}
+
+void CThumbPack::Close( void )
+{
+	mt::CAutoLock lock( &m_cs );
+
+	if ( IsOpen() )
+		TRACE( _T(" CThumbPack::Close(): '%s'  used=%d/%d  %s\n"), m_packFilePath.GetPtr(), GetUsedCount(), GetSlotCount(), m_stats.Format().c_str() );
+
+	UnmapFile();
+	m_file.Close();
+	m_packFilePath.Clear();
+	ResetStats();
+}
+
+bool CThumbPack::MapFile( UINT64 fileSize )
+{
+	ASSERT( nullptr == m_pHeader );
+
+	HANDLE hMapping = ::CreateFileMapping( m_file.Get(), nullptr, PAGE_READWRITE, static_cast<DWORD>( fileSize >> 32 ), static_cast<DWORD>( fileSize ), nullptr );
+	if ( nullptr == hMapping )
+		return false;
+
+	m_mapping.Reset( hMapping );
+
+	m_pHeader = static_cast<CPackHeader*>( ::MapViewOfFile( m_mapping.Get(), FILE_MAP_ALL_ACCESS, 0, 0, static_cast<SIZE_T>( fileSize ) ) );
+	if ( nullptr == m_pHeader )
+	{
+		m_mapping.Close();
+		return false;
+	}
+	return true;
+}
+
+void CThumbPack::UnmapFile( void )
+{
+	if ( m_pHeader != nullptr )
+	{
+		::FlushViewOfFile( m_pHeader, 0 );		// initiates the asynchronous write of dirty pages
+		::UnmapViewOfFile( m_pHeader );
+		m_pHeader = nullptr;
+	}
+	m_mapping.Close();
+}
+
+bool CThumbPack::ResizeFile( UINT64 fileSize )
+{
+	ASSERT( nullptr == m_pHeader );
+
+	LARGE_INTEGER filePos;
+	filePos.QuadPart = static_cast<LONGLONG>( fileSize );
+	return ::SetFilePointerEx( m_file.Get(), filePos, nullptr, FILE_BEGIN ) && ::SetEndOfFile( m_file.Get() );
+}
+
+void CThumbPack::TouchFile( void )
+{	// loading thumbs doesn't modify the file: keep the modify time of used packs recent, for pruning
+	FILETIME nowTime;
+	::GetSystemTimeAsFileTime( &nowTime );
+	::SetFileTime( m_file.Get(), nullptr, nullptr, &nowTime );
+}
+
+bool CThumbPack::IsValidLayout( const CSize& boundsSize, UINT64 fileSize ) const
+{
+	ASSERT_PTR( m_pHeader );
+
+	return
+		fileSize >= CPackHeader::Size &&
+		CPackHeader::Magic == m_pHeader->m_magic &&
+		CPackHeader::Version == m_pHeader->m_version &&
+		CPackHeader::GetLayoutTag() == m_pHeader->m_layoutTag &&
+		boundsSize == m_pHeader->m_boundsSize &&
+		CPackHeader::GetSlotSize( boundsSize ) == m_pHeader->m_slotSize &&
+		m_pHeader->m_slotCount != 0 &&
+		fileSize == GetPackFileSize( m_pHeader->m_slotCount, m_pHeader->m_slotSize );
+}
+
+bool CThumbPack::ValidateSlots( void )
+{	// reject the pack if any slot is out of the bounds, which would read pixels past the slot; also recounts the used slots
+	ASSERT_PTR( m_pHeader );
+
+	UINT usedCount = 0;
+
+	for ( UINT slotPos = 0; slotPos != m_pHeader->m_slotCount; ++slotPos )
+	{
+		const CSlot* pSlot = GetSlotAt( slotPos );
+
+		if ( !pSlot->IsValid( m_pHeader->m_boundsSize ) )
+		{
+			TRACE( _T(" * CThumbPack::ValidateSlots(): slot %d is out of the bounds %dx%d - recreating the pack\n"), slotPos, m_pHeader->m_boundsSize.cx, m_pHeader->m_boundsSize.cy );
+			return false;
+		}
+
+		if ( !pSlot->IsEmpty() )
+			++usedCount;
+	}
+
+	m_pHeader->m_usedCount = usedCount;
+	return true;
+}
+
+void CThumbPack::InitLayout( const CSize& boundsSize, UINT slotCount )
+{
+	ASSERT_PTR( m_pHeader );
+
+	m_pHeader->m_magic = CPackHeader::Magic;
+	m_pHeader->m_version = CPackHeader::Version;
+	m_pHeader->m_layoutTag = CPackHeader::GetLayoutTag();
+	m_pHeader->m_boundsSize = boundsSize;
+	m_pHeader->m_slotCount = slotCount;
+	m_pHeader->m_slotSize = CPackHeader::GetSlotSize( boundsSize );
+	m_pHeader->m_usedCount = 0;
+	m_pHeader->m_accessClock = 0;			// all slots are empty, since the extended file is zero-filled
+}
+
+bool CThumbPack::Grow( UINT slotCount )
+{
+	ASSERT( IsOpen() );
+
+	const UINT oldSlotCount = m_pHeader->m_slotCount, slotSize = m_pHeader->m_slotSize;
+
+	slotCount = std::min( slotCount, GetMaxSlotCount( m_pHeader->m_boundsSize ) );
+	if ( slotCount <= oldSlotCount )
+		return false;						// reached MaxPackFileSize
+
+	UnmapFile();
+
+	if ( !MapFile( GetPackFileSize( slotCount, slotSize ) ) )		// extends the file with zero-filled (empty) slots
+	{	// keep the current pack
+		if ( !ResizeFile( GetPackFileSize( oldSlotCount, slotSize ) ) || !MapFile( GetPackFileSize( oldSlotCount, slotSize ) ) )
+			Close();
+		return false;
+	}
+
+	m_pHeader->m_slotCount = slotCount;
+	RehashSlots( oldSlotCount );
+
+	TRACE( _T(" CThumbPack::Grow(): '%s'  slots %d -> %d  used=%d\n"), m_packFilePath.GetPtr(), oldSlotCount, slotCount, m_pHeader->m_usedCount );
+	return true;
+}
+
+void CThumbPack::RehashSlots( UINT oldSlotCount )
+{	// move each thumb into the probe window of its path hash for the new slot count; a thumb with no empty slot left is dropped
+	for ( UINT slotPos = 0; slotPos != oldSlotCount; ++slotPos )
+	{
+		CSlot* pSlot = GetSlotAt( slotPos );
+		if ( pSlot->IsEmpty() )
+			continue;
+
+		size_t pathHash = static_cast<size_t>( pSlot->m_pathHash );
+		bool inProbeWindow = false;
+
+		for ( UINT i = 0, probeCount = std::min<UINT>( MaxProbe, m_pHeader->m_slotCount ); i != probeCount && !inProbeWindow; ++i )
+			inProbeWindow = GetProbePos( pathHash, i ) == slotPos;
+
+		if ( inProbeWindow )
+			continue;						// already in place (also a thumb moved ahead of the scan)
+
+		if ( CSlot* pNewSlot = FindEmptySlot( pathHash ) )
+			memcpy( pNewSlot, pSlot, CSlot::HeaderSize + pSlot->GetStride() * pSlot->m_height );
+		else
+			--m_pHeader->m_usedCount;
+
+		pSlot->Clear();
+	}
+}
+
+CSize CThumbPack::GetBoundsSize( void ) const
+{
+	return IsOpen() ? m_pHeader->m_boundsSize : CSize( 0, 0 );
+}
+
+UINT CThumbPack::GetSlotCount( void ) const
+{
+	return IsOpen() ? m_pHeader->m_slotCount : 0;
+}
+
+UINT CThumbPack::GetUsedCount( void ) const
+{
+	return IsOpen() ? m_pHeader->m_usedCount : 0;
+}
+
+CThumbPack::CSlot* CThumbPack::GetSlotAt( UINT slotPos ) const
+{
+	ASSERT( IsOpen() && slotPos < m_pHeader->m_slotCount );
+	return reinterpret_cast<CSlot*>( reinterpret_cast<BYTE*>( m_pHeader ) + CPackHeader::Size + static_cast<size_t>( slotPos ) * m_pHeader->m_slotSize );
+}
+
+UINT CThumbPack::GetProbePos( size_t pathHash, UINT probeIndex ) const
+{
+	return static_cast<UINT>( ( pathHash + probeIndex ) % m_pHeader->m_slotCount );
+}
+
+CThumbPack::CSlot* CThumbPack::FindSlot( const fs::CFlexPath& srcImagePath, size_t pathHash ) const
+{
+	for ( UINT i = 0, probeCount = std::min<UINT>( MaxProbe, m_pHeader->m_slotCount ); i != probeCount; ++i )
+	{
+		CSlot* pSlot = GetSlotAt( GetProbePos( pathHash, i ) );
+		if ( pSlot->HasPath( srcImagePath, pathHash ) )
+			return pSlot;
+	}
+	return nullptr;
+}
+
+CThumbPack::CSlot* CThumbPack::FindEmptySlot( size_t pathHash ) const
+{
+	for ( UINT i = 0, probeCount = std::min<UINT>( MaxProbe, m_pHeader->m_slotCount ); i != probeCount; ++i )
+	{
+		CSlot* pSlot = GetSlotAt( GetProbePos( pathHash, i ) );
+		if ( pSlot->IsEmpty() )
+			return pSlot;
+	}
+	return nullptr;
+}
+
+CThumbPack::CSlot* CThumbPack::AcquireStoreSlot( const fs::CFlexPath& srcImagePath, size_t pathHash )
+{
+	if ( CSlot* pFoundSlot = FindSlot( srcImagePath, pathHash ) )
+		return pFoundSlot;					// overwrite the stale thumb
+
+	if ( m_pHeader->m_usedCount >= m_pHeader->m_slotCount - m_pHeader->m_slotCount / 4 )
+		if ( !Grow( m_pHeader->m_slotCount * 2 ) && !IsOpen() )	// over 3/4 load: grow before the probe windows fill up (past MaxPackFileSize evict instead)
+			return nullptr;					// failed to restore the mapping
+
+	CSlot* pOldestSlot = nullptr;
+
+	for ( UINT i = 0, probeCount = std::min<UINT>( MaxProbe, m_pHeader->m_slotCount ); i != probeCount; ++i )
+	{
+		CSlot* pSlot = GetSlotAt( GetProbePos( pathHash, i ) );
+		if ( pSlot->IsEmpty() )
+		{
+			++m_pHeader->m_usedCount;
+			return pSlot;
+		}
+
+		if ( nullptr == pOldestSlot || pSlot->m_accessStamp < pOldestSlot->m_accessStamp )
+			pOldestSlot = pSlot;
+	}
+
+	++m_stats.m_evictCount;
+	return pOldestSlot;						// evict the least recently used in the probe window
+}
+
+CComPtr<IWICBitmapSource> CThumbPack::Load( const fs::CFlexPath& srcImagePath, const CTime& lastModifTime, CSize* pUnscaledBmpSize /*= nullptr*/ )
+{
+	mt::CAutoLock lock( &m_cs );
+	if ( !IsOpen() )
+		return nullptr;
+
+	CSlot* pSlot = FindSlot( srcImagePath, srcImagePath.GetHashValue() );
+	if ( nullptr == pSlot )
+	{
+		++m_stats.m_missCount;
+		return nullptr;
+	}
+	if ( pSlot->m_lastModifTime != lastModifTime.GetTime() )
+	{
+		++m_stats.m_staleCount;				// will be overwritten by the regenerated thumb
+		return nullptr;
+	}
+
+	ASSERT( pSlot->IsValid( m_pHeader->m_boundsSize ) );		// slots were validated on Open()
+
+	// the WIC bitmap is initialized straight from the mapped slot pixels: no decoding, no intermediate buffer
+	CComPtr<IWICBitmap> pThumbBitmap;
+	if ( !HR_OK( wic::CImagingFactory::Factory()->CreateBitmapFromMemory( pSlot->m_width, pSlot->m_height, pSlot->m_pixelFormat,
+																			pSlot->GetStride(), pSlot->GetStride() * pSlot->m_height, pSlot->GetPixels(), &pThumbBitmap ) ) )
+		return nullptr;
+
+	pSlot->m_accessStamp = ++m_pHeader->m_accessClock;
+	++m_stats.m_hitCount;
+
+	if ( pUnscaledBmpSize != nullptr )
+		*pUnscaledBmpSize = pSlot->m_unscaledBmpSize;
+
+	return &*pThumbBitmap;					// up-cast
+}
+
+bool CThumbPack::Store( const fs::CFlexPath& srcImagePath, const CTime& lastModifTime, const CSize& unscaledBmpSize, IWICBitmapSource* pThumbBitmap )
+{
+	ASSERT_PTR( pThumbBitmap );
+
+	mt::CAutoLock lock( &m_cs );
+	if ( !IsOpen() || srcImagePath.Get().length() >= MAX_PATH )
+		return false;
+
+	CSize thumbSize = wic::GetBitmapSize( pThumbBitmap );
+	if ( 0 == thumbSize.cx || 0 == thumbSize.cy || thumbSize.cx > m_pHeader->m_boundsSize.cx || thumbSize.cy > m_pHeader->m_boundsSize.cy )
+		return false;						// thumb not scaled to pack bounds
+
+	CComPtr<IWICBitmapSource> pSrcBitmap = pThumbBitmap;
+	WICPixelFormatGUID pixelFormat;
+	if ( !HR_OK( pThumbBitmap->GetPixelFormat( &pixelFormat ) ) )
+		return false;
+
+	if ( !hlp::IsPackablePixelFormat( pixelFormat ) )
+	{
+		pSrcBitmap = nullptr;
+		pixelFormat = GUID_WICPixelFormat32bppPBGRA;
+		if ( !HR_OK( ::WICConvertBitmapSource( pixelFormat, pThumbBitmap, &pSrcBitmap ) ) )
+			return false;
+	}
+
+	size_t pathHash = srcImagePath.GetHashValue();
+	CSlot* pSlot = AcquireStoreSlot( srcImagePath, pathHash );
+	if ( nullptr == pSlot )
+		return false;
+
+	pSlot->Clear();							// invalid while copying pixels
+	if ( !HR_OK( pSrcBitmap->CopyPixels( nullptr, thumbSize.cx * 4, thumbSize.cx * 4 * thumbSize.cy, pSlot->GetPixels() ) ) )
+	{
+		--m_pHeader->m_usedCount;
+		return false;
+	}
+
+	pSlot->m_pathHash = pathHash;
+	pSlot->m_lastModifTime = lastModifTime.GetTime();
+	pSlot->m_accessStamp = ++m_pHeader->m_accessClock;
+	pSlot->m_pixelFormat = pixelFormat;
+	pSlot->m_height = thumbSize.cy;
+	pSlot->m_unscaledBmpSize = unscaledBmpSize;
+	_tcscpy_s( pSlot->m_path, COUNT_OF( pSlot->m_path ), srcImagePath.GetPtr() );
+	pSlot->m_width = thumbSize.cx;			// last: marks the slot as used
+
+	++m_stats.m_storeCount;
+	return true;
+}
+
+bool CThumbPack::Discard( const fs::CFlexPath& srcImagePath )
+{
+	mt::CAutoLock lock( &m_cs );
+	if ( !IsOpen() )
+		return false;
+
+	CSlot* pSlot = FindSlot( srcImagePath, srcImagePath.GetHashValue() );
+	if ( nullptr == pSlot )
+		return false;
+
+	pSlot->Clear();
+	--m_pHeader->m_usedCount;
+	return true;
+}
@@ -0,0 +1,106 @@
+#ifndef ThumbPack_h
+#define ThumbPack_h
+#pragma once
+
+#include "FileSystem_fwd.h"
+#include "FlexPath.h"
+#include <afxmt.h>
+
+
+namespace thumb
+{
+	struct CPackStats
+	{
+		CPackStats( void ) : m_hitCount( 0 ), m_missCount( 0 ), m_staleCount( 0 ), m_storeCount( 0 ), m_evictCount( 0 ) {}
+
+		size_t GetLookupCount( void ) const { return m_hitCount + m_missCount + m_staleCount; }
+		double GetHitRatio( void ) const { return GetLookupCount() != 0 ? (double)m_hitCount / GetLookupCount() : 0.0; }
+
+		std::tstring Format( void ) const;
+	public:
+		size_t m_hitCount;			// loaded from the pack
+		size_t m_missCount;			// not found in the pack
+		size_t m_staleCount;		// found, but the source image has been modified since
+		size_t m_storeCount;		// thumbs written to the pack
+		size_t m_evictCount;		// older thumbs overwritten by a store
+	};
+}
+
+
+// Persistent thumbnail store backed by a memory-mapped pack file, typically one per album.
+// The pack is an array of fixed-size slots, each holding one 32bpp thumbnail scaled to the pack bounds size, keyed by source image path and modify time.
+// Slots are located by path hash with a short linear probe; a store into a full probe window evicts its least recently used slot.
+// The pack grows (remapped and rehashed) when 3/4 of its slots are used, up to MaxPackFileSize; past that stores evict.
+// Stored thumbs are written straight into the mapped view, and flushed to disk lazily by the system (in background).
+// Packs not used for a while, or over the total size budget, are deleted by PruneStalePacks().
+//
+class CThumbPack : private utl::noncopyable
+{
+public:
+	CThumbPack( void );
+	~CThumbPack() { Close(); }
+
+	enum { MinSlotCount = 64 };
+	static const UINT64 MaxPackFileSize;				// 2 GB on x64, 256 MB on Win32 (the whole file is mapped in a single view)
+
+	static UINT GetSlotCountFor( size_t imageCount );		// initial slot count for an album: the images fit at 3/4 load
+
+	// opens an existing pack file (growing it to slotCount), or (re)creates it on layout mismatch (bounds size, version) or on corrupted slots
+	bool Open( const fs::CPath& packFilePath, const CSize& boundsSize, UINT slotCount = MinSlotCount );
+	void Close( void );
+
+	bool IsOpen( void ) const { return m_pHeader != nullptr; }
+	const fs::CPath& GetFilePath( void ) const { return m_packFilePath; }
+	CSize GetBoundsSize( void ) const;
+	UINT GetSlotCount( void ) const;
+	UINT GetUsedCount( void ) const;
+
+	// returns the thumb stored for the source image only if it has the same modify time
+	CComPtr<IWICBitmapSource> Load( const fs::CFlexPath& srcImagePath, const CTime& lastModifTime, CSize* pUnscaledBmpSize = nullptr );
+	bool Store( const fs::CFlexPath& srcImagePath, const CTime& lastModifTime, const CSize& unscaledBmpSize, IWICBitmapSource* pThumbBitmap );
+	bool Discard( const fs::CFlexPath& srcImagePath );
+
+	const thumb::CPackStats& GetStats( void ) const { return m_stats; }
+	void ResetStats( void ) { m_stats = thumb::CPackStats(); }
+
+	// pack file in the temp directory, unique for the owner (album) path and bounds size
+	static fs::TDirPath GetPackDirPath( void );
+	static fs::CPath MakePackFilePath( const fs::CPath& ownerPath, const CSize& boundsSize );
+
+	// deletes the packs not used for maxAge, then the least recently used ones over maxTotalSize; packs open by any instance are kept
+	static size_t PruneStalePacks( const CTimeSpan& maxAge, UINT64 maxTotalSize );
+private:
+	struct CPackHeader;
+	struct CSlot;
+
+	enum { MaxProbe = 8 };
+
+	static UINT GetMaxSlotCount( const CSize& boundsSize );
+	static UINT64 GetPackFileSize( UINT slotCount, UINT slotSize );
+
+	bool MapFile( UINT64 fileSize );
+	void UnmapFile( void );
+	bool ResizeFile( UINT64 fileSize );
+	void TouchFile( void );
+	bool IsValidLayout( const CSize& boundsSize, UINT64 fileSize ) const;
+	bool ValidateSlots( void );
+	void InitLayout( const CSize& boundsSize, UINT slotCount );
+	bool Grow( UINT slotCount );					// remaps the file with more slots, and rehashes the thumbs
+	void RehashSlots( UINT oldSlotCount );
+
+	CSlot* GetSlotAt( UINT slotPos ) const;
+	UINT GetProbePos( size_t pathHash, UINT probeIndex ) const;
+	CSlot* FindEmptySlot( size_t pathHash ) const;
+	CSlot* FindSlot( const fs::CFlexPath& srcImagePath, size_t pathHash ) const;
+	CSlot* AcquireStoreSlot( const fs::CFlexPath& srcImagePath, size_t pathHash );
+private:
+	fs::CPath m_packFilePath;
+	fs::CHandle m_file;
+	fs::CHandle m_mapping;
+	CPackHeader* m_pHeader;				// start of the mapped view
+	thumb::CPackStats m_stats;			// for the current session
+	mutable CCriticalSection m_cs;		// serializes slot access
+};
+
+
+#endif // ThumbPack_h
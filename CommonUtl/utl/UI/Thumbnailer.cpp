@@ -5,8 +5,10 @@
 #include "FlagTags.h"
 #include "FileSystem.h"
 #include "ImagingWic.h"
+#include "PixelResampler.h"
 #include "StreamStdTypes.h"
 #include "StructuredStorage.h"
+#include "ThumbPack.h"
 #include "GdiCoords.h"
 #include "TimeUtils.h"
 #include "BaseApp.h"
@@ -42,6 +44,7 @@ CShellThumbCache::CShellThumbCache( void )
 	: m_boundsSize( s_defaultBoundsSize )
 	, m_pThumbProducer( nullptr )
 	, m_thumbExtractFlags( SIIGBF_BIGGERSIZEOK )		// if an image has no thumbnail cached by Explorer
+	, m_scalingMethod( thumb::WicFantScaling )
 {
 	// (*) COM must be initialized by now
 	m_pShellThumbCache.CoCreateInstance( CLSID_LocalThumbnailCache, nullptr, CLSCTX_INPROC );
@@ -170,7 +173,19 @@ CComPtr<IWICBitmapSource> CShellThumbCache::ScaleToThumbBitmap( IWICBitmapSource
 		return pSrcBitmap;									// optimization: image smaller than the thumb size -> avoid scaling, since the thumb looks "smeared"
 
 	// convert to WIC bitmap and scale to m_boundsSize
-	CComPtr<IWICBitmapSource> pScaledThumbBitmap( wic::ScaleBitmapToBounds( pSrcBitmap, m_boundsSize, WICBitmapInterpolationModeFant ) );		// or WICBitmapInterpolationModeHighQualityCubic
+	CComPtr<IWICBitmapSource> pScaledThumbBitmap;
+
+	switch ( m_scalingMethod )
+	{
+		case thumb::BoxScaling:
+		case thumb::LanczosScaling:
+			pScaledThumbBitmap = wic::ResampleBitmapToBounds( pSrcBitmap, m_boundsSize, thumb::BoxScaling == m_scalingMethod ? pixel::BoxFilter : pixel::LanczosFilter );
+			if ( pScaledThumbBitmap != nullptr )
+				break;
+			// fall through: on resampling failure use the WIC scaler
+		default:
+			pScaledThumbBitmap = wic::ScaleBitmapToBounds( pSrcBitmap, m_boundsSize, WICBitmapInterpolationModeFant );		// or WICBitmapInterpolationModeHighQualityCubic
+	}
 	return pScaledThumbBitmap;
 }
 
@@ -180,6 +195,7 @@ CComPtr<IWICBitmapSource> CShellThumbCache::ScaleToThumbBitmap( IWICBitmapSource
 CThumbnailer::CThumbnailer( size_t cacheMaxSize /*= MaxSize*/ )
 	: CShellThumbCache()
 	, m_thumbsCache( cacheMaxSize )
+	, m_pThumbPack( nullptr )
 	, m_flags( 0 )
 {
 }
@@ -199,6 +215,9 @@ size_t CThumbnailer::GetCachedCount( void ) const
 
 bool CThumbnailer::DiscardThumbnail( const fs::CFlexPath& srcImagePath )
 {
+	if ( CThumbPack* pThumbPack = GetMatchingPack() )
+		pThumbPack->Discard( srcImagePath );
+
 	return m_thumbsCache.Remove( srcImagePath );
 }
 
@@ -221,7 +240,8 @@ const CFlagTags& CThumbnailer::GetTags_CacheStatusFlags( void )
 		{ CacheHit, _T("") },				// silent on cache hits (not the interesting case)
 		{ CacheRemoveExpired, _T("(-) remove expired") },
 		{ CacheExtract, _T("(+) extract from cache") },
-		{ Generate, _T("(++) generate") }
+		{ Generate, _T("(++) generate") },
+		{ PackHit, _T("(+) load from pack") }
 	};
 	static const CFlagTags tags( flagDefs, COUNT_OF( flagDefs ) );
 	return tags;
@@ -236,6 +256,35 @@ bool CThumbnailer::SetBoundsSize( const CSize& boundsSize )
 	return true;
 }
 
+CThumbPack* CThumbnailer::SetThumbPack( CThumbPack* pThumbPack )
+{
+	CThumbPack* pOldThumbPack = m_pThumbPack;
+	m_pThumbPack = pThumbPack;
+	return pOldThumbPack;
+}
+
+CThumbPack* CThumbnailer::GetMatchingPack( void ) const
+{
+	if ( m_pThumbPack != nullptr && m_pThumbPack->IsOpen() )
+		if ( m_pThumbPack->GetBoundsSize() == GetBoundsSize() )
+			return m_pThumbPack;
+
+	return nullptr;			// no pack, or a pack of thumbs scaled to different bounds
+}
+
+CCachedThumbBitmap* CThumbnailer::LoadPackedThumb( const fs::CFlexPath& srcImagePath )
+{
+	if ( CThumbPack* pThumbPack = GetMatchingPack() )
+	{
+		CTime lastModifTime = fs::ReadLastModifyTime( srcImagePath );
+		CSize unscaledBmpSize;
+
+		if ( CComPtr<IWICBitmapSource> pScaledBitmap = pThumbPack->Load( srcImagePath, lastModifTime, &unscaledBmpSize ) )
+			return new CCachedThumbBitmap( pScaledBitmap, srcImagePath, lastModifTime, unscaledBmpSize );
+	}
+	return nullptr;
+}
+
 CCachedThumbBitmap* CThumbnailer::AcquireThumbnail( const fs::CFlexPath& srcImagePath, int* pCacheStatusFlags /*= nullptr*/ )
 {
 	int cacheStatus = 0;
@@ -251,6 +300,38 @@ CCachedThumbBitmap* CThumbnailer::AcquireThumbnail( const fs::CFlexPath& srcImag
 			SetFlag( cacheStatus, CacheRemoveExpired );
 		}
 
+	if ( nullptr == pThumb )
+	{
+		int produceStatus = 0;
+
+		pThumb = ProduceThumbnail( srcImagePath, &produceStatus );
+		cacheStatus |= produceStatus;
+
+		if ( pThumb != nullptr )
+			m_thumbsCache.Add( pThumb->GetSrcImagePath(), pThumb );
+	}
+
+#ifdef _DEBUG
+	std::tstring flagsText = GetTags_CacheStatusFlags().FormatUi( cacheStatus, _T(",") );
+	if ( !flagsText.empty() )
+		TRACE_THUMBS( _T("<%d> Thumb '%s' for %s: %s\n"), thumb::s_traceCount++,
+			flagsText.c_str(),
+			srcImagePath.IsComplexPath() ? _T("EMBEDDED image") : _T("image"),
+			pThumb != nullptr ? pThumb->FormatDbg().c_str() : _T("NULL") );
+#endif
+
+	if ( pCacheStatusFlags != nullptr )
+		*pCacheStatusFlags = cacheStatus;
+	return pThumb;
+}
+
+CCachedThumbBitmap* CThumbnailer::ProduceThumbnail( const fs::CFlexPath& srcImagePath, int* pCacheStatusFlags /*= nullptr*/ )
+{
+	int cacheStatus = 0;
+
+	CCachedThumbBitmap* pThumb = LoadPackedThumb( srcImagePath );
+	SetFlag( cacheStatus, PackHit, pThumb != nullptr );
+
 	TShellItemPair imagePair( srcImagePath, nullptr );
 
 	if ( nullptr == pThumb )
@@ -277,23 +358,35 @@ CCachedThumbBitmap* CThumbnailer::AcquireThumbnail( const fs::CFlexPath& srcImag
 		SetFlag( cacheStatus, Generate, pThumb != nullptr );
 	}
 
-	if ( pThumb != nullptr && !HasFlag( cacheStatus, CacheHit ) )
-		m_thumbsCache.Add( pThumb->GetSrcImagePath(), pThumb );
-
-#ifdef _DEBUG
-	std::tstring flagsText = GetTags_CacheStatusFlags().FormatUi( cacheStatus, _T(",") );
-	if ( !flagsText.empty() )
-		TRACE_THUMBS( _T("<%d> Thumb '%s' for %s: %s\n"), thumb::s_traceCount++,
-			flagsText.c_str(),
-			srcImagePath.IsComplexPath() ? _T("EMBEDDED image") : _T("image"),
-			pThumb != nullptr ? pThumb->FormatDbg().c_str() : _T("NULL") );
-#endif
+	if ( pThumb != nullptr && HasFlag( cacheStatus, CacheExtract | Generate ) )
+		if ( CThumbPack* pThumbPack = GetMatchingPack() )		// refill the pack with the new thumb
+			pThumbPack->Store( pThumb->GetSrcImagePath(), pThumb->m_lastModifTime, pThumb->GetUnscaledBmpSize(), pThumb->GetWicBitmap() );
 
 	if ( pCacheStatusFlags != nullptr )
 		*pCacheStatusFlags = cacheStatus;
 	return pThumb;
 }
 
+bool CThumbnailer::ContainsThumbnail( const fs::CFlexPath& srcImagePath ) const
+{
+	return m_thumbsCache.Contains( srcImagePath );
+}
+
+CCachedThumbBitmap* CThumbnailer::FindThumbnail( const fs::CFlexPath& srcImagePath ) const
+{
+	CCachedThumbBitmap* pThumb = m_thumbsCache.Find( srcImagePath );
+	if ( pThumb != nullptr && CheckThumbExpired( pThumb ) != fs::FileNotExpired )
+		return nullptr;			// expired: let the producer replace it
+
+	return pThumb;
+}
+
+bool CThumbnailer::InsertThumbnail( CCachedThumbBitmap* pThumb )
+{
+	ASSERT_PTR( pThumb );
+	return m_thumbsCache.Add( pThumb->GetSrcImagePath(), pThumb );
+}
+
 CCachedThumbBitmap* CThumbnailer::AcquireThumbnailNoThrow( const fs::CFlexPath& srcImagePath ) throws_()
 {
 	try
@@ -381,6 +474,15 @@ CCachedThumbBitmap::CCachedThumbBitmap( IWICBitmapSource* pUnscaledBitmap, IWICB
 {
 }
 
+CCachedThumbBitmap::CCachedThumbBitmap( IWICBitmapSource* pScaledBitmap, const fs::CFlexPath& srcImagePath, const CTime& lastModifTime, const CSize& unscaledBmpSize )
+	: CWicDibSection( pScaledBitmap )
+	, m_srcImagePath( srcImagePath )
+	, m_key( m_nullKey )
+	, m_lastModifTime( lastModifTime )
+	, m_unscaledBmpSize( unscaledBmpSize )
+{
+}
+
 fs::FileExpireStatus CCachedThumbBitmap::CheckExpired( void ) const
 {
 	return fs::CheckExpireStatus( m_srcImagePath, m_lastModifTime );
@@ -11,6 +11,7 @@
 
 class CEnumTags;
 class CFlagTags;
+class CThumbPack;
 namespace fs { enum FileExpireStatus; }
 
 
@@ -21,6 +22,13 @@ namespace thumb
 {
 	enum { DefaultBoundsSize = 96, MinBoundsSize = 16, MaxBoundsSize = 1024 };
 	const CEnumTags& GetTags_StdBoundsSize( void );
+
+	enum ScalingMethod
+	{
+		WicFantScaling,				// WIC scaler: single-threaded per image
+		BoxScaling,					// in-house parallel resampler: box filter (fastest)
+		LanczosScaling				// in-house parallel resampler: Lanczos3 filter (sharpest)
+	};
 }
 
 
@@ -34,6 +42,9 @@ public:
 	const CSize& GetBoundsSize( void ) const { return m_boundsSize; }
 	bool SetBoundsSize( const CSize& boundsSize );
 
+	thumb::ScalingMethod GetScalingMethod( void ) const { return m_scalingMethod; }
+	void SetScalingMethod( thumb::ScalingMethod scalingMethod ) { m_scalingMethod = scalingMethod; }
+
 	void SetThumbExtractFlags( SIIGBF thumbExtractFlags ) { m_thumbExtractFlags = thumbExtractFlags; }
 	void SetOptimizeExtractIcons( bool optimizeExtractIcons = true ) { SetThumbExtractFlags( optimizeExtractIcons ? SIIGBF_ICONONLY : SIIGBF_BIGGERSIZEOK ); }
 
@@ -60,6 +71,7 @@ private:
 	fs::IThumbProducer* m_pThumbProducer;				// chains to external thumb producer
 	shell::CWinExplorer m_shellExplorer;
 	SIIGBF m_thumbExtractFlags;							// optimize for thumbnails or icons extraction (default for thumbnails)
+	thumb::ScalingMethod m_scalingMethod;				// scaling of the unscaled bitmaps to m_boundsSize
 public:
 	static const CSize s_defaultBoundsSize;
 };
@@ -83,9 +95,22 @@ public:
 	CCachedThumbBitmap* AcquireThumbnail( const fs::CFlexPath& srcImagePath, int* pCacheStatusFlags = nullptr );
 	CCachedThumbBitmap* AcquireThumbnailNoThrow( const fs::CFlexPath& srcImagePath ) throws_();
 
+	// non-blocking access, for thumbs produced in background
+	bool ContainsThumbnail( const fs::CFlexPath& srcImagePath ) const;						// cached, no expiration check (fast)
+	CCachedThumbBitmap* FindThumbnail( const fs::CFlexPath& srcImagePath ) const;				// cached and not expired
+	CCachedThumbBitmap* ProduceThumbnail( const fs::CFlexPath& srcImagePath, int* pCacheStatusFlags = nullptr );		// new thumb, not cached: caller owns it
+	bool InsertThumbnail( CCachedThumbBitmap* pThumb );										// takes ownership, replaces any cached thumb
+
 	bool DiscardThumbnail( const fs::CFlexPath& srcImagePath );			// force discard a cached thumbnail, should't really be used
 	size_t DiscardWithPrefix( const TCHAR* pDirPrefix );
+
+	// persistent thumbnail pack (not owned), used as a second level cache for thumbs scaled to the same bounds size
+	CThumbPack* GetThumbPack( void ) const { return m_pThumbPack; }
+	CThumbPack* SetThumbPack( CThumbPack* pThumbPack );			// returns the old pack
 private:
+	CThumbPack* GetMatchingPack( void ) const;
+	CCachedThumbBitmap* LoadPackedThumb( const fs::CFlexPath& srcImagePath );
+
 	// hidden base methods
 	using CShellThumbCache::ExtractThumb;
 public:
@@ -94,7 +119,8 @@ public:
 		CacheHit			= BIT_FLAG( 0 ),
 		CacheRemoveExpired	= BIT_FLAG( 1 ),
 		CacheExtract		= BIT_FLAG( 2 ),
-		Generate			= BIT_FLAG( 3 )
+		Generate			= BIT_FLAG( 3 ),
+		PackHit				= BIT_FLAG( 4 )
 	};
 
 	const CFlagTags& GetTags_CacheStatusFlags( void );
@@ -107,6 +133,7 @@ private:
 	enum { MaxSize = 500 };
 
 	fs::CFileObjectCache<fs::CFlexPath, CCachedThumbBitmap> m_thumbsCache;
+	CThumbPack* m_pThumbPack;
 public:
 	int m_flags;
 
@@ -137,8 +164,11 @@ public:
 class CCachedThumbBitmap : public CWicDibSection
 {
 	friend class CShellThumbCache;
+	friend class CThumbnailer;
+	friend class CThumbLoader;
 
 	CCachedThumbBitmap( IWICBitmapSource* pUnscaledBitmap, IWICBitmapSource* pScaledBitmap, const fs::CFlexPath& srcImagePath, const CThumbKey* pCachedKey = nullptr );
+	CCachedThumbBitmap( IWICBitmapSource* pScaledBitmap, const fs::CFlexPath& srcImagePath, const CTime& lastModifTime, const CSize& unscaledBmpSize );		// loaded from a thumb pack
 public:
 	const CThumbKey& GetKey( void ) const { return m_key; }
 	const fs::CFlexPath& GetSrcImagePath( void ) const { return m_srcImagePath; }
@@ -177,6 +207,22 @@ namespace thumb
 		CThumbnailer* m_pThumbnailer;
 		CSize m_oldBoundsSize;
 	};
+
+
+	class CPushThumbPack
+	{
+	public:
+		CPushThumbPack( CThumbnailer* pThumbnailer, CThumbPack* pThumbPack )
+			: m_pThumbnailer( pThumbnailer )
+			, m_pOldThumbPack( pThumbnailer->SetThumbPack( pThumbPack ) )
+		{
+		}
+
+		~CPushThumbPack() { m_pThumbnailer->SetThumbPack( m_pOldThumbPack ); }
+	private:
+		CThumbnailer* m_pThumbnailer;
+		CThumbPack* m_pOldThumbPack;
+	};
 }
 
 
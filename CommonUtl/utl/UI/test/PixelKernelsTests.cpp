@@ -0,0 +1,344 @@
+
+#include "pch.h"
+
+#ifdef USE_UT		// no UT code in release builds
+#include "test/PixelKernelsTests.h"
+#include "PixelKernels.h"
+#include "PixelResampler.h"
+#include "ImagingWic.h"
+#include "StringBase.h"
+#include "Timer.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+
+namespace ut
+{
+	// odd width and row padding: exercises the scalar row tails and the stride
+
+	struct CTestPixels
+	{
+		enum { Width = 37, Height = 11, Stride = Width * sizeof( CPixelBGRA ) + 12 };
+
+		CTestPixels( UINT seed = 1 )
+			: m_bytes( Stride * Height )
+		{
+			for ( size_t pos = 0; pos != m_bytes.size(); ++pos )
+			{
+				seed = seed * 1103515245 + 12345;			// deterministic pseudo-random channels, with frequent 0 and 255 edge values
+				switch ( ( seed >> 8 ) % 8 )
+				{
+					case 0:  m_bytes[ pos ] = 0; break;
+					case 1:  m_bytes[ pos ] = 255; break;
+					default: m_bytes[ pos ] = static_cast<BYTE>( seed >> 16 );
+				}
+			}
+		}
+
+		pixel::CBufferBGRA GetBuffer( void ) { return pixel::CBufferBGRA( &m_bytes.front(), Width, Height, Stride ); }
+
+		template< typename PixelFunc >
+		void ForEach( PixelFunc func )		// reference scalar effect
+		{
+			pixel::CBufferBGRA buffer = GetBuffer();
+
+			for ( UINT y = 0; y != buffer.m_height; ++y )
+				for ( CPixelBGRA* pPixel = buffer.GetRow( y ), *pPixelEnd = pPixel + buffer.m_width; pPixel != pPixelEnd; ++pPixel )
+					func( *pPixel );
+		}
+
+		bool operator==( const CTestPixels& right ) const { return m_bytes == right.m_bytes; }
+	public:
+		std::vector<BYTE> m_bytes;
+	};
+
+
+	struct PreMultiplyAlpha
+	{
+		void operator()( CPixelBGRA& rPixel ) const { rPixel.PreMultiplyAlpha(); }
+	};
+
+
+	// checks that the kernel produces identical pixels with the scalar functor, for each instruction set supported on this machine
+	//
+	template< typename KernelFunc, typename PixelFunc >
+	unsigned int CheckBitExact( KernelFunc kernelFunc, PixelFunc pixelFunc )
+	{
+		unsigned int mismatchCount = 0;
+
+		for ( UINT seed = 1; seed <= 16; ++seed )
+		{
+			CTestPixels expected( seed );
+			expected.ForEach( pixelFunc );
+
+			for ( int instructionSet = pixel::ScalarSet; instructionSet <= pixel::GetMaxInstructionSet(); ++instructionSet )
+			{
+				CTestPixels actual( seed );
+				kernelFunc( actual.GetBuffer(), static_cast<pixel::InstructionSet>( instructionSet ) );
+
+				if ( !( actual == expected ) )
+				{
+					UT_TRACE( str::Format( _T("(%s mismatch for seed=%u)  "), pixel::GetInstructionSetName( static_cast<pixel::InstructionSet>( instructionSet ) ), seed ).c_str() );
+					++mismatchCount;
+				}
+			}
+		}
+		return mismatchCount;
+	}
+
+
+	struct PreMultiplyAlphaKernel
+	{
+		void operator()( const pixel::CBufferBGRA& buffer, pixel::InstructionSet instructionSet ) const { pixel::kernel::PreMultiplyAlpha( buffer, instructionSet ); }
+	};
+
+	struct GrayScaleKernel
+	{
+		void operator()( const pixel::CBufferBGRA& buffer, pixel::InstructionSet instructionSet ) const { pixel::kernel::ToGrayScale( buffer, instructionSet ); }
+	};
+
+	struct BlendColorKernel
+	{
+		BlendColorKernel( const CPixelBGRA& toPixel ) : m_toPixel( toPixel ) {}
+
+		void operator()( const pixel::CBufferBGRA& buffer, pixel::InstructionSet instructionSet ) const { pixel::kernel::BlendColor( buffer, m_toPixel, instructionSet ); }
+	private:
+		CPixelBGRA m_toPixel;
+	};
+
+	struct DisabledGrayOutKernel
+	{
+		DisabledGrayOutKernel( const CPixelBGRA& toPixel ) : m_toPixel( toPixel ) {}
+
+		void operator()( const pixel::CBufferBGRA& buffer, pixel::InstructionSet instructionSet ) const { pixel::kernel::DisabledGrayOut( buffer, m_toPixel, instructionSet ); }
+	private:
+		CPixelBGRA m_toPixel;
+	};
+
+	struct DisableFadeGrayKernel
+	{
+		DisableFadeGrayKernel( BYTE fadeAlpha, bool preMultiplyAlpha ) : m_fadeAlpha( fadeAlpha ), m_preMultiplyAlpha( preMultiplyAlpha ) {}
+
+		void operator()( const pixel::CBufferBGRA& buffer, pixel::InstructionSet instructionSet ) const { pixel::kernel::DisableFadeGray( buffer, m_fadeAlpha, m_preMultiplyAlpha, instructionSet ); }
+	private:
+		BYTE m_fadeAlpha;
+		bool m_preMultiplyAlpha;
+	};
+
+	struct MultiplyAlphaKernel
+	{
+		MultiplyAlphaKernel( BYTE alpha ) : m_alpha( alpha ) {}
+
+		void operator()( const pixel::CBufferBGRA& buffer, pixel::InstructionSet instructionSet ) const { instructionSet; pixel::kernel::MultiplyAlpha( buffer, m_alpha, m_alpha / 255.0 ); }
+	private:
+		BYTE m_alpha;
+	};
+
+
+	static const BYTE s_alphas[] = { 0, 1, 64, 127, 128, 200, 254, 255 };
+}
+
+
+namespace pred
+{
+	struct NotEqualPixel
+	{
+		NotEqualPixel( const CPixelBGRA& pixel ) : m_pixel( pixel ) {}
+
+		bool operator()( const CPixelBGRA& pixel ) const { return 0 != memcmp( &pixel, &m_pixel, sizeof( CPixelBGRA ) ); }
+	private:
+		CPixelBGRA m_pixel;
+	};
+}
+
+
+CPixelKernelsTests::CPixelKernelsTests( void )
+{
+	ut::CTestSuite::Instance().RegisterTestCase( this );		// self-registration
+}
+
+CPixelKernelsTests& CPixelKernelsTests::Instance( void )
+{
+	static CPixelKernelsTests s_testCase;
+	return s_testCase;
+}
+
+void CPixelKernelsTests::TestPreMultiplyAlpha( void )
+{
+	ASSERT_EQUAL( 0, ut::CheckBitExact( ut::PreMultiplyAlphaKernel(), ut::PreMultiplyAlpha() ) );
+}
+
+void CPixelKernelsTests::TestGrayScale( void )
+{
+	ASSERT_EQUAL( 0, ut::CheckBitExact( ut::GrayScaleKernel(), func::ToGrayScale() ) );
+}
+
+void CPixelKernelsTests::TestBlendColor( void )
+{
+	for ( size_t i = 0; i != COUNT_OF( ut::s_alphas ); ++i )
+	{
+		CPixelBGRA toPixel( color::AzureBlue, ut::s_alphas[ i ] );
+		ASSERT_EQUAL( 0, ut::CheckBitExact( ut::BlendColorKernel( toPixel ), func::BlendColor( toPixel.GetColor(), toPixel.m_alpha ) ) );
+	}
+}
+
+void CPixelKernelsTests::TestDisableFadeGray( void )
+{
+	for ( size_t i = 0; i != COUNT_OF( ut::s_alphas ); ++i )
+	{
+		ASSERT_EQUAL( 0, ut::CheckBitExact( ut::DisableFadeGrayKernel( ut::s_alphas[ i ], true ), func::DisableFadeGray( ut::s_alphas[ i ], true ) ) );
+		ASSERT_EQUAL( 0, ut::CheckBitExact( ut::DisableFadeGrayKernel( ut::s_alphas[ i ], false ), func::DisableFadeGray( ut::s_alphas[ i ], false ) ) );
+	}
+}
+
+void CPixelKernelsTests::TestDisabledGrayOut( void )
+{
+	for ( size_t i = 0; i != COUNT_OF( ut::s_alphas ); ++i )
+	{
+		CPixelBGRA toPixel( RGB( 10, 200, 77 ), ut::s_alphas[ i ] );
+		ASSERT_EQUAL( 0, ut::CheckBitExact( ut::DisabledGrayOutKernel( toPixel ), func::DisabledGrayOut( toPixel.GetColor(), toPixel.m_alpha ) ) );
+	}
+}
+
+void CPixelKernelsTests::TestMultiplyAlpha( void )
+{
+	for ( size_t i = 0; i != COUNT_OF( ut::s_alphas ); ++i )
+		ASSERT_EQUAL( 0, ut::CheckBitExact( ut::MultiplyAlphaKernel( ut::s_alphas[ i ] ), func::AlphaBlend( ut::s_alphas[ i ] ) ) );
+}
+
+void CPixelKernelsTests::TestKernelsThroughput( void )
+{
+	// benchmark the most involved kernel on a full HD bitmap: traces the throughput in megapixels/second for each instruction set
+	enum { Width = 1920, Height = 1080, RepeatCount = 20 };
+
+	std::vector<CPixelBGRA> pixels( Width * Height, CPixelBGRA( RGB( 80, 160, 240 ), 200 ) );
+	pixel::CBufferBGRA buffer( &pixels.front(), Width, Height, Width * sizeof( CPixelBGRA ) );
+
+	for ( int instructionSet = pixel::ScalarSet; instructionSet <= pixel::GetMaxInstructionSet(); ++instructionSet )
+	{
+		CTimer timer;
+
+		for ( int i = 0; i != RepeatCount; ++i )
+			pixel::kernel::DisableFadeGray( buffer, gdi::AlphaFadeMore, true, static_cast<pixel::InstructionSet>( instructionSet ) );
+
+		double elapsedSeconds = std::max( timer.ElapsedSeconds(), 0.001 );
+		UT_TRACE( str::Format( _T("(%s: %.0f MP/s)  "), pixel::GetInstructionSetName( static_cast<pixel::InstructionSet>( instructionSet ) ), double( Width * Height ) * RepeatCount / elapsedSeconds / 1e6 ).c_str() );
+	}
+}
+
+
+void CPixelKernelsTests::TestResample( void )
+{
+	{	// constant colour is preserved by both filters
+		std::vector<CPixelBGRA> srcPixels( 64 * 48, CPixelBGRA( 10, 100, 200, 255 ) ), destPixels( 20 * 15, CPixelBGRA( 0, 0, 0, 0 ) );
+
+		for ( int filter = pixel::BoxFilter; filter <= pixel::LanczosFilter; ++filter )
+		{
+			pixel::Resample( pixel::CBufferBGRA( &destPixels.front(), 20, 15, 20 * sizeof( CPixelBGRA ) ), pixel::CBufferBGRA( &srcPixels.front(), 64, 48, 64 * sizeof( CPixelBGRA ) ), static_cast<pixel::ResampleFilter>( filter ) );
+			ASSERT( std::find_if( destPixels.begin(), destPixels.end(), pred::NotEqualPixel( srcPixels.front() ) ) == destPixels.end() );
+		}
+	}
+
+	{	// box filter 2:1 averages the pixels, with rounding
+		const BYTE srcBytes[] = { 0, 0, 0, 0,  10, 20, 30, 40,  2, 2, 2, 2,  100, 100, 100, 100 };
+		CPixelBGRA destPixel( 0, 0, 0, 0 );
+
+		pixel::Resample( pixel::CBufferBGRA( &destPixel, 1, 1, sizeof( CPixelBGRA ) ), pixel::CBufferBGRA( const_cast<BYTE*>( srcBytes ), 2, 2, 2 * sizeof( CPixelBGRA ) ), pixel::BoxFilter );
+		ASSERT_EQUAL( 28, destPixel.m_blue );
+		ASSERT_EQUAL( 31, destPixel.m_green );		// rounded up: 30.5
+		ASSERT_EQUAL( 33, destPixel.m_red );		// horizontal, then vertical: ( (0+30)/2 + (2+100)/2 ) / 2
+		ASSERT_EQUAL( 36, destPixel.m_alpha );
+	}
+
+	{	// identity for the box filter
+		ut::CTestPixels srcPixels( 3 ), destPixels( 4 );
+
+		pixel::Resample( destPixels.GetBuffer(), srcPixels.GetBuffer(), pixel::BoxFilter );
+
+		for ( UINT y = 0; y != ut::CTestPixels::Height; ++y )		// compare rows, excluding the stride padding
+			ASSERT( 0 == memcmp( srcPixels.GetBuffer().GetRow( y ), destPixels.GetBuffer().GetRow( y ), ut::CTestPixels::Width * sizeof( CPixelBGRA ) ) );
+	}
+
+	// the SIMD path and the multi-threaded banding are bit-exact with the single-threaded scalar path
+	static const CSize s_sizes[][ 2 ] =
+	{
+		{ CSize( 1200, 900 ), CSize( 96, 72 ) }, { CSize( 37, 23 ), CSize( 10, 7 ) }, { CSize( 100, 100 ), CSize( 33, 99 ) }, { CSize( 20, 30 ), CSize( 40, 50 ) }, { CSize( 1500, 17 ), CSize( 96, 3 ) }
+	};
+
+	for ( size_t i = 0; i != COUNT_OF( s_sizes ); ++i )
+	{
+		const CSize& srcSize = s_sizes[ i ][ 0 ];
+		const CSize& destSize = s_sizes[ i ][ 1 ];
+		std::vector<CPixelBGRA> srcPixels( srcSize.cx * srcSize.cy, CPixelBGRA( 0, 0, 0, 0 ) );
+
+		for ( size_t pos = 0; pos != srcPixels.size(); ++pos )
+			srcPixels[ pos ] = CPixelBGRA( static_cast<BYTE>( pos * 7 ), static_cast<BYTE>( pos * 13 ), static_cast<BYTE>( pos >> 3 ), static_cast<BYTE>( pos * 31 ) );
+
+		pixel::CBufferBGRA srcBuffer( &srcPixels.front(), srcSize.cx, srcSize.cy, srcSize.cx * sizeof( CPixelBGRA ) );
+
+		for ( int filter = pixel::BoxFilter; filter <= pixel::LanczosFilter; ++filter )
+		{
+			std::vector<CPixelBGRA> expected( destSize.cx * destSize.cy, CPixelBGRA( 0, 0, 0, 0 ) ), actual( expected );
+
+			pixel::Resample( pixel::CBufferBGRA( &expected.front(), destSize.cx, destSize.cy, destSize.cx * sizeof( CPixelBGRA ) ), srcBuffer, static_cast<pixel::ResampleFilter>( filter ), pixel::ScalarSet, 1 );
+			pixel::Resample( pixel::CBufferBGRA( &actual.front(), destSize.cx, destSize.cy, destSize.cx * sizeof( CPixelBGRA ) ), srcBuffer, static_cast<pixel::ResampleFilter>( filter ) );
+			ASSERT( 0 == memcmp( &expected.front(), &actual.front(), expected.size() * sizeof( CPixelBGRA ) ) );
+		}
+	}
+}
+
+void CPixelKernelsTests::TestResampleThroughput( void )
+{
+	// benchmark thumbnail scaling of a 12 MP bitmap: traces the source megapixels/second of the WIC scaler vs the in-house resampler
+	enum { Width = 4000, Height = 3000 };
+	const CSize boundsSize( 256, 256 );
+
+	std::vector<CPixelBGRA> pixels( Width * Height, CPixelBGRA( 0, 0, 0, 0 ) );
+
+	for ( size_t pos = 0; pos != pixels.size(); ++pos )
+		pixels[ pos ] = CPixelBGRA( static_cast<BYTE>( pos ), static_cast<BYTE>( pos / Width ), static_cast<BYTE>( pos * 3 ), 255 );
+
+	CComPtr<IWICBitmap> pSrcBitmap;
+	if ( !HR_OK( wic::CImagingFactory::Factory()->CreateBitmapFromMemory( Width, Height, GUID_WICPixelFormat32bppPBGRA, Width * sizeof( CPixelBGRA ),
+																		 static_cast<UINT>( pixels.size() * sizeof( CPixelBGRA ) ), reinterpret_cast<BYTE*>( &pixels.front() ), &pSrcBitmap ) ) )
+		return;
+
+	const double megaPixels = double( Width * Height ) / 1e6;
+
+	{
+		CTimer timer;
+		CComPtr<IWICBitmap> pScaledBitmap = wic::CreateBitmapFromSource( wic::ScaleBitmapToBounds( pSrcBitmap, boundsSize, WICBitmapInterpolationModeFant ), WICBitmapCacheOnLoad );		// force the lazy scaling
+
+		ASSERT_PTR( pScaledBitmap );
+		UT_TRACE( str::Format( _T("(WIC Fant: %.0f MP/s)  "), megaPixels / std::max( timer.ElapsedSeconds(), 0.001 ) ).c_str() );
+	}
+
+	for ( int filter = pixel::BoxFilter; filter <= pixel::LanczosFilter; ++filter )
+	{
+		CTimer timer;
+		CComPtr<IWICBitmapSource> pScaledBitmap = wic::ResampleBitmapToBounds( pSrcBitmap, boundsSize, static_cast<pixel::ResampleFilter>( filter ) );
+
+		ASSERT_PTR( pScaledBitmap );
+		ASSERT( CSize( 256, 192 ) == wic::GetBitmapSize( pScaledBitmap ) );
+		UT_TRACE( str::Format( _T("(%s: %.0f MP/s)  "), pixel::GetResampleFilterName( static_cast<pixel::ResampleFilter>( filter ) ), megaPixels / std::max( timer.ElapsedSeconds(), 0.001 ) ).c_str() );
+	}
+}
+
+
+void CPixelKernelsTests::Run( void )
+{
+	RUN_TEST( TestPreMultiplyAlpha );
+	RUN_TEST( TestGrayScale );
+	RUN_TEST( TestBlendColor );
+	RUN_TEST( TestDisableFadeGray );
+	RUN_TEST( TestDisabledGrayOut );
+	RUN_TEST( TestMultiplyAlpha );
+	RUN_TEST( TestKernelsThroughput );
+	RUN_TEST( TestResample );
+	RUN_TEST( TestResampleThroughput );
+}
+
+
+#endif //USE_UT
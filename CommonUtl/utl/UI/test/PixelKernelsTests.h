@@ -0,0 +1,35 @@
+#ifndef PixelKernelsTests_h
+#define PixelKernelsTests_h
+#pragma once
+
+
+#ifdef USE_UT		// no UT code in release builds
+
+#include "test/UnitTest.h"
+
+
+class CPixelKernelsTests : public ut::CConsoleTestCase
+{
+	CPixelKernelsTests( void );
+public:
+	static CPixelKernelsTests& Instance( void );
+
+	// ut::ITestCase interface
+	virtual void Run( void );
+private:
+	void TestPreMultiplyAlpha( void );
+	void TestGrayScale( void );
+	void TestBlendColor( void );
+	void TestDisableFadeGray( void );
+	void TestDisabledGrayOut( void );
+	void TestMultiplyAlpha( void );
+	void TestKernelsThroughput( void );
+	void TestResample( void );
+	void TestResampleThroughput( void );
+};
+
+
+#endif //USE_UT
+
+
+#endif // PixelKernelsTests_h
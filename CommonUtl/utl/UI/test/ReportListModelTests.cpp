@@ -0,0 +1,249 @@
+
+#include "pch.h"
+
+#ifdef USE_UT		// no UT code in release builds
+#include "test/ReportListModelTests.h"
+#include "ReportListModel.h"
+#include "ContainerOwnership.h"
+#include "PathItemBase.h"
+#include "StringUtilities.h"
+#include "Timer.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+
+namespace ut
+{
+	enum Column { FileName, Extension };
+
+
+	class CTestCellSource : public lv::ICellSource
+	{
+	public:
+		// lv::ICellSource interface
+		virtual std::tstring FormatCellText( const utl::ISubject* pObject, int column ) const
+		{
+			const fs::CPath& filePath = checked_static_cast<const CPathItem*>( pObject )->GetFilePath();
+			switch ( column )
+			{
+				case FileName:	return filePath.GetFilename();
+				case Extension:	return filePath.GetExt();
+			}
+			ASSERT( false );
+			return std::tstring();
+		}
+
+		virtual int GetCellImageIndex( const utl::ISubject* pObject, int column ) const { pObject, column; return ui::No_Image; }
+	};
+
+
+	struct CTestListModel
+	{
+		CTestListModel( const TCHAR* pFilenames )
+			: m_model( &m_cellSource )
+		{
+			std::vector<std::tstring> filenames;
+			str::Split( filenames, pFilenames, _T(",") );
+
+			for ( std::vector<std::tstring>::const_iterator itFilename = filenames.begin(); itFilename != filenames.end(); ++itFilename )
+				m_items.push_back( new CPathItem( fs::CPath( *itFilename ) ) );
+
+			m_model.SetObjects( m_items );
+		}
+
+		~CTestListModel()
+		{
+			utl::ClearOwningContainer( m_items );
+		}
+
+		std::tstring FormatRows( void ) const
+		{
+			std::tstring rowsText;
+			for ( int row = 0; row != m_model.GetRowCount(); ++row )
+				stream::Tag( rowsText, m_model.FormatCellText( row, FileName ), _T(",") );
+
+			return rowsText;
+		}
+	public:
+		CTestCellSource m_cellSource;
+		std::vector<CPathItem*> m_items;
+		CReportListModel m_model;
+	};
+
+
+	struct IsTextFile
+	{
+		bool operator()( const utl::ISubject* pObject ) const
+		{
+			return checked_static_cast<const CPathItem*>( pObject )->GetFilePath().ExtEquals( _T(".txt") );
+		}
+	};
+
+
+	struct TextFilesFirst
+	{
+		bool operator()( const utl::ISubject* pLeft, const utl::ISubject* pRight ) const
+		{
+			return IsTextFile()( pLeft ) && !IsTextFile()( pRight );
+		}
+	};
+}
+
+
+CReportListModelTests::CReportListModelTests( void )
+{
+	ut::CTestSuite::Instance().RegisterTestCase( this );		// self-registration
+}
+
+CReportListModelTests& CReportListModelTests::Instance( void )
+{
+	static CReportListModelTests s_testCase;
+	return s_testCase;
+}
+
+void CReportListModelTests::TestRows( void )
+{
+	ut::CTestListModel test( _T("b.txt,a.doc,c.txt") );
+	const CReportListModel& model = test.m_model;
+
+	ASSERT_EQUAL( 3, model.GetObjectCount() );
+	ASSERT_EQUAL( 3, model.GetRowCount() );
+	ASSERT_EQUAL( _T("b.txt,a.doc,c.txt"), test.FormatRows() );
+	ASSERT_EQUAL( _T(".doc"), model.FormatCellText( 1, ut::Extension ) );
+
+	ASSERT( test.m_items[ 2 ] == model.GetRowObject( 2 ) );
+	ASSERT_EQUAL( 2, model.FindRow( test.m_items[ 2 ] ) );
+	ASSERT_EQUAL( -1, model.FindRow( nullptr ) );
+	ASSERT_EQUAL( utl::npos, model.FindObjectPos( nullptr ) );
+
+	test.m_model.Clear();
+	ASSERT_EQUAL( 0, model.GetRowCount() );
+	ASSERT_EQUAL( -1, model.FindRow( test.m_items[ 0 ] ) );
+}
+
+void CReportListModelTests::TestSortRows( void )
+{
+	ut::CTestListModel test( _T("file10.txt,File1.doc,file2.txt,abc.txt") );
+	CReportListModel& rModel = test.m_model;
+
+	rModel.SortRows( ut::FileName );
+	ASSERT_EQUAL( _T("abc.txt,File1.doc,file2.txt,file10.txt"), test.FormatRows() );		// intuitive order
+	ASSERT_EQUAL( 3, rModel.FindRow( test.m_items[ 0 ] ) );
+
+	rModel.SortRows( ut::FileName, false );
+	ASSERT_EQUAL( _T("file10.txt,file2.txt,File1.doc,abc.txt"), test.FormatRows() );
+	ASSERT_EQUAL( 0, rModel.FindRow( test.m_items[ 0 ] ) );
+
+	rModel.SortRows( ut::Extension, false );
+	ASSERT_EQUAL( _T("abc.txt,file2.txt,file10.txt,File1.doc"), test.FormatRows() );		// ties ascending by the code column
+
+	rModel.SortRows( -1 );
+	ASSERT_EQUAL( _T("file10.txt,File1.doc,file2.txt,abc.txt"), test.FormatRows() );		// initial order
+
+	rModel.SortRowsBy( ut::TextFilesFirst() );
+	ASSERT_EQUAL( _T("file10.txt,file2.txt,abc.txt,File1.doc"), test.FormatRows() );		// stable for equivalent rows
+	ASSERT_EQUAL( 3, rModel.FindRow( test.m_items[ 1 ] ) );
+}
+
+void CReportListModelTests::TestFilterRows( void )
+{
+	ut::CTestListModel test( _T("file10.txt,File1.doc,file2.txt,abc.txt") );
+	CReportListModel& rModel = test.m_model;
+
+	ASSERT_EQUAL( 3, rModel.FilterRows( ut::IsTextFile() ) );
+	ASSERT_EQUAL( _T("file10.txt,file2.txt,abc.txt"), test.FormatRows() );
+	ASSERT_EQUAL( -1, rModel.FindRow( test.m_items[ 1 ] ) );			// filtered out
+
+	rModel.SortRows( ut::FileName );
+	ASSERT_EQUAL( _T("abc.txt,file2.txt,file10.txt"), test.FormatRows() );
+
+	rModel.ResetRows();
+	ASSERT_EQUAL( _T("file10.txt,File1.doc,file2.txt,abc.txt"), test.FormatRows() );
+	ASSERT_EQUAL( 1, rModel.FindRow( test.m_items[ 1 ] ) );
+
+	rModel.SelectAllRows();
+	rModel.SetCheckedAll();
+	rModel.FilterRows( ut::IsTextFile() );
+	ASSERT_EQUAL( 3, rModel.GetSelectedCount() );		// excludes "File1.doc", hidden by the filter
+	ASSERT_EQUAL( 3, rModel.GetCheckedCount() );
+
+	std::vector<CPathItem*> selItems;
+	rModel.QuerySelectedObjects( selItems );
+	ASSERT_EQUAL( 3, selItems.size() );
+}
+
+void CReportListModelTests::TestSelectionChecks( void )
+{
+	ut::CTestListModel test( _T("d.txt,c.txt,b.txt,a.txt") );
+	CReportListModel& rModel = test.m_model;
+
+	rModel.SelectRows( 0, 1 );			// "d.txt", "c.txt"
+	rModel.SetCheckedRow( 3 );			// "a.txt"
+	ASSERT_EQUAL( 2, rModel.GetSelectedCount() );
+	ASSERT_EQUAL( 1, rModel.GetCheckedCount() );
+
+	rModel.SortRows( ut::FileName );	// selection and check-states follow the objects
+	ASSERT_EQUAL( _T("a.txt,b.txt,c.txt,d.txt"), test.FormatRows() );
+
+	std::vector<int> selRows;
+	rModel.QuerySelectedRows( selRows );
+	ASSERT_EQUAL( _T("2,3"), str::FormatSet( selRows, _T(",") ) );
+	ASSERT( rModel.IsCheckedRow( 0 ) );
+
+	std::vector<CPathItem*> checkedItems;
+	rModel.QueryCheckedObjects( checkedItems );
+	ASSERT_EQUAL( 1, checkedItems.size() );
+	ASSERT( test.m_items[ 3 ] == checkedItems.front() );
+
+	rModel.SelectAllRows();
+	ASSERT_EQUAL( 4, rModel.GetSelectedCount() );
+
+	rModel.SelectRows( 1, 2, false );
+	std::vector<CPathItem*> selItems;
+	rModel.QuerySelectedObjects( selItems );
+	ASSERT_EQUAL( 2, selItems.size() );
+	ASSERT( test.m_items[ 3 ] == selItems[ 0 ] && test.m_items[ 0 ] == selItems[ 1 ] );		// "a.txt", "d.txt"
+
+	rModel.SetCheckedAll( false );
+	ASSERT_EQUAL( 0, rModel.GetCheckedCount() );
+
+	rModel.SetRowCheckState( 1, BST_INDETERMINATE );		// custom check-state
+	ASSERT_EQUAL( BST_INDETERMINATE, rModel.GetRowCheckState( 1 ) );
+	ASSERT( !rModel.IsCheckedRow( 1 ) );
+	ASSERT_EQUAL( 0, rModel.GetCheckedCount() );
+}
+
+void CReportListModelTests::TestSortThroughput( void )
+{
+	enum { RowCount = 200000 };
+
+	ut::CTestListModel test( _T("") );
+	for ( UINT i = 0, seed = 1; i != RowCount; ++i )
+	{
+		seed = seed * 1103515245 + 12345;			// deterministic pseudo-random names
+		test.m_items.push_back( new CPathItem( fs::CPath( str::Format( _T("Item %u_%u.txt"), ( seed >> 8 ) % 1000, i ) ) ) );
+	}
+	test.m_model.SetObjects( test.m_items );
+
+	CTimer timer;
+	test.m_model.SortRows( ut::FileName );
+	UT_TRACE( str::Format( _T("(sort %d rows: %.3f sec)  "), RowCount, timer.ElapsedSeconds() ).c_str() );
+
+	for ( int row = 1; row != test.m_model.GetRowCount(); ++row )
+		ASSERT( str::IntuitiveCompare( test.m_model.FormatCellText( row - 1, ut::FileName ).c_str(), test.m_model.FormatCellText( row, ut::FileName ).c_str() ) != pred::Greater );
+}
+
+
+void CReportListModelTests::Run( void )
+{
+	RUN_TEST( TestRows );
+	RUN_TEST( TestSortRows );
+	RUN_TEST( TestFilterRows );
+	RUN_TEST( TestSelectionChecks );
+	RUN_TEST( TestSortThroughput );
+}
+
+
+#endif //USE_UT
@@ -0,0 +1,31 @@
+#ifndef ReportListModelTests_h
+#define ReportListModelTests_h
+#pragma once
+
+
+#ifdef USE_UT		// no UT code in release builds
+
+#include "test/UnitTest.h"
+
+
+class CReportListModelTests : public ut::CConsoleTestCase
+{
+	CReportListModelTests( void );
+public:
+	static CReportListModelTests& Instance( void );
+
+	// ut::ITestCase interface
+	virtual void Run( void );
+private:
+	void TestRows( void );
+	void TestSortRows( void );
+	void TestFilterRows( void );
+	void TestSelectionChecks( void );
+	void TestSortThroughput( void );
+};
+
+
+#endif //USE_UT
+
+
+#endif // ReportListModelTests_h
@@ -4,6 +4,8 @@
 #ifdef USE_UT		// no UT code in release builds
 #include "UtlUserInterfaceTests.h"
 #include "ColorTests.h"
+#include "PixelKernelsTests.h"
+#include "ReportListModelTests.h"
 #include "ResourceTests.h"
 #include "SerializationTests.h"
 #include "ShellFileSystemTests.h"
@@ -19,6 +21,8 @@ namespace ut
 	{
 		// register UTL tests
 		CColorTests::Instance();
+		CPixelKernelsTests::Instance();
+		CReportListModelTests::Instance();
 		CResourceTests::Instance();
 		CSerializationTests::Instance();
 		CShellFileSystemTests::Instance();
@@ -0,0 +1,428 @@
+
+#include "Utf8Transcoder.h"		// no precompiled header: portable to non-Windows builds
+#include <iterator>
+
+#if defined( _M_IX86 ) || defined( _M_X64 )
+	#define USE_UTF8_SIMD
+	#include <intrin.h>
+	#include <emmintrin.h>
+#elif defined( __SSE2__ )
+	#define USE_UTF8_SIMD		// GCC/Clang: SSE2 enabled for the target
+	#include <emmintrin.h>
+#endif
+
+
+namespace utf8
+{
+	namespace impl
+	{
+		typedef unsigned char TByte;		// UTF8 code unit, unsigned for range checks
+
+
+		template< size_t charSize >
+		struct CWideUnit;
+
+		template<> struct CWideUnit<2> { typedef char16_t Type; };		// UTF16
+		template<> struct CWideUnit<4> { typedef char32_t Type; };		// UTF32
+
+		typedef CWideUnit<sizeof( wchar_t )>::Type TWideUnit;		// the code unit of wide strings
+
+
+		bool DetectSimd( void )
+		{
+		#if defined( _M_X64 ) || defined( __SSE2__ )
+			return true;								// SSE2 is part of the x64 baseline, or enabled for the target
+		#elif defined( USE_UTF8_SIMD )
+			enum { Sse2Bit = 1 << 26 };
+			int cpuInfo[ 4 ];		// EAX, EBX, ECX, EDX
+
+			__cpuid( cpuInfo, 1 );
+			return ( cpuInfo[ 3 ] & Sse2Bit ) != 0;
+		#else
+			return false;
+		#endif
+		}
+
+		bool& RefUseSimd( void )
+		{
+			static bool s_useSimd = HasSimd();
+			return s_useSimd;
+		}
+
+
+		const char32_t InvalidCodePoint = 0xFFFFFFFF;
+
+
+		// scalar codec: decoders advance past the decoded units, or past the maximal invalid subpart (returning InvalidCodePoint)
+
+		char32_t DecodeUnits( const TByte*& rpSrc, const TByte* pEnd )
+		{
+			TByte lead = *rpSrc++;
+
+			if ( lead < 0x80 )
+				return lead;
+
+			size_t trailCount;
+			TByte secondLo = 0x80, secondHi = 0xBF;		// valid range of the second byte: narrowed to exclude overlongs, surrogates and values above U+10FFFF
+			char32_t codePoint;
+
+			if ( lead < 0xC2 )							// a trail byte, or an overlong 2-byte lead
+				return InvalidCodePoint;
+			else if ( lead < 0xE0 )
+			{
+				trailCount = 1;
+				codePoint = lead & 0x1F;
+			}
+			else if ( lead < 0xF0 )
+			{
+				trailCount = 2;
+				codePoint = lead & 0x0F;
+
+				if ( 0xE0 == lead )
+					secondLo = 0xA0;
+				else if ( 0xED == lead )
+					secondHi = 0x9F;
+			}
+			else if ( lead < 0xF5 )
+			{
+				trailCount = 3;
+				codePoint = lead & 0x07;
+
+				if ( 0xF0 == lead )
+					secondLo = 0x90;
+				else if ( 0xF4 == lead )
+					secondHi = 0x8F;
+			}
+			else
+				return InvalidCodePoint;
+
+			for ( size_t i = 0; i != trailCount; ++i, ++rpSrc )
+			{
+				if ( rpSrc == pEnd )
+					return InvalidCodePoint;			// truncated sequence
+
+				TByte trail = *rpSrc;
+
+				if ( 0 == i ? ( trail < secondLo || trail > secondHi ) : ( trail < 0x80 || trail > 0xBF ) )
+					return InvalidCodePoint;			// the offending byte is not consumed: it may start the next sequence
+
+				codePoint = ( codePoint << 6 ) | ( trail & 0x3F );
+			}
+			return codePoint;
+		}
+
+		template< typename Char16T >
+		char32_t DecodeUnits( const Char16T*& rpSrc, const Char16T* pEnd )
+		{
+			char32_t unit = static_cast<char16_t>( *rpSrc++ );
+
+			if ( unit < 0xD800 || unit > 0xDFFF )
+				return unit;
+
+			if ( unit <= 0xDBFF && rpSrc != pEnd )		// a lead surrogate followed by a trail surrogate?
+			{
+				char32_t trail = static_cast<char16_t>( *rpSrc );
+
+				if ( trail >= 0xDC00 && trail <= 0xDFFF )
+				{
+					++rpSrc;
+					return 0x10000 + ( ( unit - 0xD800 ) << 10 ) + ( trail - 0xDC00 );
+				}
+			}
+			return InvalidCodePoint;					// unpaired surrogate
+		}
+
+		char32_t DecodeUnits( const char32_t*& rpSrc, const char32_t* pEnd )
+		{
+			pEnd;
+			char32_t codePoint = *rpSrc++;
+
+			if ( codePoint > MaxCodePoint || ( codePoint >= 0xD800 && codePoint <= 0xDFFF ) )
+				return InvalidCodePoint;
+
+			return codePoint;
+		}
+
+
+		inline void EncodeUnits( TByte*& rpDest, char32_t codePoint )
+		{
+			if ( codePoint < 0x80 )
+				*rpDest++ = static_cast<TByte>( codePoint );
+			else if ( codePoint < 0x800 )
+			{
+				*rpDest++ = static_cast<TByte>( 0xC0 | ( codePoint >> 6 ) );
+				*rpDest++ = static_cast<TByte>( 0x80 | ( codePoint & 0x3F ) );
+			}
+			else if ( codePoint < 0x10000 )
+			{
+				*rpDest++ = static_cast<TByte>( 0xE0 | ( codePoint >> 12 ) );
+				*rpDest++ = static_cast<TByte>( 0x80 | ( ( codePoint >> 6 ) & 0x3F ) );
+				*rpDest++ = static_cast<TByte>( 0x80 | ( codePoint & 0x3F ) );
+			}
+			else
+			{
+				*rpDest++ = static_cast<TByte>( 0xF0 | ( codePoint >> 18 ) );
+				*rpDest++ = static_cast<TByte>( 0x80 | ( ( codePoint >> 12 ) & 0x3F ) );
+				*rpDest++ = static_cast<TByte>( 0x80 | ( ( codePoint >> 6 ) & 0x3F ) );
+				*rpDest++ = static_cast<TByte>( 0x80 | ( codePoint & 0x3F ) );
+			}
+		}
+
+		template< typename Char16T >
+		inline void EncodeUnits( Char16T*& rpDest, char32_t codePoint )
+		{
+			if ( codePoint < 0x10000 )
+				*rpDest++ = static_cast<Char16T>( codePoint );
+			else
+			{
+				codePoint -= 0x10000;
+				*rpDest++ = static_cast<Char16T>( 0xD800 + ( codePoint >> 10 ) );
+				*rpDest++ = static_cast<Char16T>( 0xDC00 + ( codePoint & 0x3FF ) );
+			}
+		}
+
+		inline void EncodeUnits( char32_t*& rpDest, char32_t codePoint )
+		{
+			*rpDest++ = codePoint;
+		}
+
+
+	#ifdef USE_UTF8_SIMD
+		// SIMD kernels: convert the leading ASCII characters in blocks of 16, stopping at the first block with a non-ASCII character; return the converted count
+
+		enum { BlockSize = 16 };
+
+		template< typename Char16T >
+		size_t ConvertAsciiBlocks( Char16T* pDest, const TByte* pSrc, size_t count )
+		{
+			const __m128i zero = _mm_setzero_si128();
+			size_t pos = 0;
+
+			for ( ; pos + BlockSize <= count; pos += BlockSize )
+			{
+				__m128i bytes = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pSrc + pos ) );
+
+				if ( _mm_movemask_epi8( bytes ) != 0 )		// a byte with the high bit set?
+					break;
+
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + pos ), _mm_unpacklo_epi8( bytes, zero ) );
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + pos + 8 ), _mm_unpackhi_epi8( bytes, zero ) );
+			}
+			return pos;
+		}
+
+		size_t ConvertAsciiBlocks( char32_t* pDest, const TByte* pSrc, size_t count )
+		{
+			const __m128i zero = _mm_setzero_si128();
+			size_t pos = 0;
+
+			for ( ; pos + BlockSize <= count; pos += BlockSize )
+			{
+				__m128i bytes = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pSrc + pos ) );
+
+				if ( _mm_movemask_epi8( bytes ) != 0 )
+					break;
+
+				__m128i lo = _mm_unpacklo_epi8( bytes, zero ), hi = _mm_unpackhi_epi8( bytes, zero );
+
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + pos ), _mm_unpacklo_epi16( lo, zero ) );
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + pos + 4 ), _mm_unpackhi_epi16( lo, zero ) );
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + pos + 8 ), _mm_unpacklo_epi16( hi, zero ) );
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + pos + 12 ), _mm_unpackhi_epi16( hi, zero ) );
+			}
+			return pos;
+		}
+
+		template< typename Char16T >
+		size_t ConvertAsciiBlocks( TByte* pDest, const Char16T* pSrc, size_t count )
+		{
+			const __m128i zero = _mm_setzero_si128(), nonAsciiBits = _mm_set1_epi16( static_cast<short>( 0xFF80 ) );
+			size_t pos = 0;
+
+			for ( ; pos + BlockSize <= count; pos += BlockSize )
+			{
+				__m128i lo = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pSrc + pos ) );
+				__m128i hi = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pSrc + pos + 8 ) );
+
+				if ( _mm_movemask_epi8( _mm_cmpeq_epi16( _mm_and_si128( _mm_or_si128( lo, hi ), nonAsciiBits ), zero ) ) != 0xFFFF )
+					break;
+
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + pos ), _mm_packus_epi16( lo, hi ) );
+			}
+			return pos;
+		}
+
+		size_t ConvertAsciiBlocks( TByte* pDest, const char32_t* pSrc, size_t count )
+		{
+			const __m128i zero = _mm_setzero_si128(), nonAsciiBits = _mm_set1_epi32( static_cast<int>( 0xFFFFFF80 ) );
+			size_t pos = 0;
+
+			for ( ; pos + BlockSize <= count; pos += BlockSize )
+			{
+				const __m128i* pVecs = reinterpret_cast<const __m128i*>( pSrc + pos );
+				__m128i units0 = _mm_loadu_si128( pVecs ), units1 = _mm_loadu_si128( pVecs + 1 ), units2 = _mm_loadu_si128( pVecs + 2 ), units3 = _mm_loadu_si128( pVecs + 3 );
+				__m128i allUnits = _mm_or_si128( _mm_or_si128( units0, units1 ), _mm_or_si128( units2, units3 ) );
+
+				if ( _mm_movemask_epi8( _mm_cmpeq_epi32( _mm_and_si128( allUnits, nonAsciiBits ), zero ) ) != 0xFFFF )
+					break;
+
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + pos ), _mm_packus_epi16( _mm_packs_epi32( units0, units1 ), _mm_packs_epi32( units2, units3 ) ) );
+			}
+			return pos;
+		}
+
+		size_t SkipAsciiBlocks( const TByte* pSrc, size_t count )
+		{
+			size_t pos = 0;
+
+			for ( ; pos + BlockSize <= count; pos += BlockSize )
+				if ( _mm_movemask_epi8( _mm_loadu_si128( reinterpret_cast<const __m128i*>( pSrc + pos ) ) ) != 0 )
+					break;
+
+			return pos;
+		}
+	#endif //USE_UTF8_SIMD
+
+
+		template< typename UnitT >
+		inline bool IsAscii( UnitT unit ) { return unit < 0x80; }
+
+		template< typename DestT, typename SrcT >
+		size_t ConvertAsciiRun( DestT* pDest, const SrcT* pSrc, size_t count, bool useSimd )
+		{	// converts the leading ASCII characters; returns the converted count
+			size_t pos = 0;
+
+		#ifdef USE_UTF8_SIMD
+			if ( useSimd )
+				pos = ConvertAsciiBlocks( pDest, pSrc, count );
+		#else
+			useSimd;
+		#endif
+
+			for ( ; pos != count && IsAscii( pSrc[ pos ] ); ++pos )
+				pDest[ pos ] = static_cast<DestT>( pSrc[ pos ] );
+
+			return pos;
+		}
+
+
+		template< typename DestT, typename SrcT >
+		size_t Transcode( DestT* pDest, const SrcT* pSrc, size_t count, size_t* pInvalidCount )
+		{	// single pass: ASCII runs by the SIMD kernels, the other characters by the scalar codec
+			DestT* pDestStart = pDest;
+			const SrcT* pEnd = pSrc + count;
+			size_t invalidCount = 0;
+			bool useSimd = RefUseSimd();
+
+			while ( pSrc != pEnd )
+				if ( IsAscii( *pSrc ) )
+				{
+					size_t asciiCount = ConvertAsciiRun( pDest, pSrc, std::distance( pSrc, pEnd ), useSimd );
+					pSrc += asciiCount;
+					pDest += asciiCount;
+				}
+				else
+				{
+					char32_t codePoint = DecodeUnits( pSrc, pEnd );
+
+					if ( InvalidCodePoint == codePoint )
+					{
+						codePoint = ReplacementChar;
+						++invalidCount;
+					}
+					EncodeUnits( pDest, codePoint );
+				}
+
+			if ( pInvalidCount != nullptr )
+				*pInvalidCount = invalidCount;
+
+			return std::distance( pDestStart, pDest );
+		}
+	}
+
+
+	bool HasSimd( void )
+	{
+		static const bool s_hasSimd = impl::DetectSimd();
+		return s_hasSimd;
+	}
+
+	bool EnableSimd( bool enable )
+	{
+		bool oldEnabled = impl::RefUseSimd();
+		impl::RefUseSimd() = enable && HasSimd();
+		return oldEnabled;
+	}
+
+
+	size_t FromWide( char* pDestUtf8, const wchar_t* pWide, size_t wideCount, size_t* pInvalidCount /*= nullptr*/ )
+	{
+		return impl::Transcode( reinterpret_cast<impl::TByte*>( pDestUtf8 ), reinterpret_cast<const impl::TWideUnit*>( pWide ), wideCount, pInvalidCount );
+	}
+
+	size_t ToWide( wchar_t* pDestWide, const char* pUtf8, size_t utf8Count, size_t* pInvalidCount /*= nullptr*/ )
+	{
+		return impl::Transcode( reinterpret_cast<impl::TWideUnit*>( pDestWide ), reinterpret_cast<const impl::TByte*>( pUtf8 ), utf8Count, pInvalidCount );
+	}
+
+	size_t FromUtf32( char* pDestUtf8, const char32_t* pText32, size_t count32, size_t* pInvalidCount /*= nullptr*/ )
+	{
+		return impl::Transcode( reinterpret_cast<impl::TByte*>( pDestUtf8 ), pText32, count32, pInvalidCount );
+	}
+
+	size_t ToUtf32( char32_t* pDest32, const char* pUtf8, size_t utf8Count, size_t* pInvalidCount /*= nullptr*/ )
+	{
+		return impl::Transcode( pDest32, reinterpret_cast<const impl::TByte*>( pUtf8 ), utf8Count, pInvalidCount );
+	}
+
+	bool IsValid( const char* pUtf8, size_t utf8Count )
+	{
+		const impl::TByte* pSrc = reinterpret_cast<const impl::TByte*>( pUtf8 );
+		const impl::TByte* pEnd = pSrc + utf8Count;
+		bool useSimd = impl::RefUseSimd();
+
+		while ( pSrc != pEnd )
+			if ( impl::IsAscii( *pSrc ) )
+			{
+			#ifdef USE_UTF8_SIMD
+				if ( useSimd )
+					pSrc += impl::SkipAsciiBlocks( pSrc, std::distance( pSrc, pEnd ) );
+			#else
+				useSimd;
+			#endif
+				while ( pSrc != pEnd && impl::IsAscii( *pSrc ) )
+					++pSrc;
+			}
+			else if ( impl::InvalidCodePoint == impl::DecodeUnits( pSrc, pEnd ) )
+				return false;
+
+		return true;
+	}
+
+
+	std::string& FromWide( std::string& rUtf8, const wchar_t* pWide, size_t wideCount )
+	{
+		if ( wideCount != 0 )
+		{
+			rUtf8.resize( GetMaxUtf8Count( wideCount ) );
+			rUtf8.resize( FromWide( &rUtf8[ 0 ], pWide, wideCount ) );
+		}
+		else
+			rUtf8.clear();
+
+		return rUtf8;
+	}
+
+	std::wstring& ToWide( std::wstring& rWide, const char* pUtf8, size_t utf8Count )
+	{
+		if ( utf8Count != 0 )
+		{
+			rWide.resize( GetMaxWideCount( utf8Count ) );
+			rWide.resize( ToWide( &rWide[ 0 ], pUtf8, utf8Count ) );
+		}
+		else
+			rWide.clear();
+
+		return rWide;
+	}
+}
@@ -0,0 +1,52 @@
+#ifndef Utf8Transcoder_h
+#define Utf8Transcoder_h
+#pragma once
+
+#include <string>
+
+
+// Validating UTF8 <-> UTF16/UTF32 transcoder, independent of the Windows API and of utl types: converts in a single pass into a caller-provided buffer.
+// Runs of ASCII characters are converted 16 at a time with SSE2 (when available), the other characters by the scalar codec.
+// Wide strings are UTF16 with a 16-bit wchar_t (Windows), or UTF32 with a 32-bit wchar_t (Linux).
+//
+// Invalid input is replaced by U+FFFD, one replacement per maximal invalid subpart (Unicode recommended practice, also done by the Windows API):
+//	- UTF8: bytes that can't start a sequence, truncated sequences, overlong forms, encoded surrogates, code points above U+10FFFF;
+//	- UTF16: unpaired surrogates;
+//	- UTF32: surrogates, and values above U+10FFFF.
+//
+namespace utf8
+{
+	enum { ReplacementChar = 0xFFFD, MaxCodePoint = 0x10FFFF };
+
+
+	// upper bounds of the converted count, for sizing the caller-provided buffers
+
+	inline size_t GetMaxUtf8Count( size_t wideCount ) { return wideCount * ( 2 == sizeof( wchar_t ) ? 3 : 4 ); }		// UTF16: a BMP unit -> 3 bytes max, a surrogate pair -> 4 bytes
+	inline size_t GetMaxUtf8CountOf32( size_t count32 ) { return count32 * 4; }
+	inline size_t GetMaxWideCount( size_t utf8Count ) { return utf8Count; }			// never more units than bytes
+	inline size_t GetMaxUtf32Count( size_t utf8Count ) { return utf8Count; }
+
+
+	// conversions: return the count of units written; pInvalidCount receives the count of replaced invalid subparts
+
+	size_t FromWide( char* pDestUtf8, const wchar_t* pWide, size_t wideCount, size_t* pInvalidCount = nullptr );
+	size_t ToWide( wchar_t* pDestWide, const char* pUtf8, size_t utf8Count, size_t* pInvalidCount = nullptr );
+
+	size_t FromUtf32( char* pDestUtf8, const char32_t* pText32, size_t count32, size_t* pInvalidCount = nullptr );
+	size_t ToUtf32( char32_t* pDest32, const char* pUtf8, size_t utf8Count, size_t* pInvalidCount = nullptr );
+
+	bool IsValid( const char* pUtf8, size_t utf8Count );
+
+
+	// string versions
+
+	std::string& FromWide( std::string& rUtf8, const wchar_t* pWide, size_t wideCount );
+	std::wstring& ToWide( std::wstring& rWide, const char* pUtf8, size_t utf8Count );
+
+
+	bool HasSimd( void );						// SSE2 supported by the CPU, detected once at runtime
+	bool EnableSimd( bool enable );				// returns the old state (for testing and benchmarks)
+}
+
+
+#endif // Utf8Transcoder_h
@@ -8,9 +8,12 @@
 #include "FlexPath.h"
 #include "StringUtilities.h"
 #include "StdHashValue.h"
+#include "Timer.h"
 #include "Unique.h"
 #include "vector_map.h"
 #include <deque>
+#include <map>
+#include <unordered_map>
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -821,6 +824,128 @@ void CAlgorithmsTests::Test_vector_map( void )
 	ASSERT_EQUAL( _T("i5"), items.find( 5 )->second );
 }
 
+void CAlgorithmsTests::Test_vector_map_Bulk( void )
+{
+	typedef std::pair<int, std::tstring> TPair;
+	const TPair pairs[] = { TPair( 7, _T("i7") ), TPair( 3, _T("i3") ), TPair( 9, _T("i9") ), TPair( 3, _T("i3 B") ), TPair( 1, _T("i1") ), TPair( 7, _T("i7 B") ), TPair( 3, _T("i3 C") ) };
+
+	{	// bulk construction: last value wins, like Insert()
+		utl::vector_map<int, std::tstring> items( pairs, pairs + COUNT_OF( pairs ) );
+		ASSERT_EQUAL( "1 3 7 9", ut::FormatMapKeys( items, " " ) );
+		ASSERT_EQUAL( "i1,i3 C,i7 B,i9", ut::FormatMapValues( items, "," ) );
+
+		utl::vector_map<int, std::tstring> inserted;
+		for ( size_t i = 0; i != COUNT_OF( pairs ); ++i )
+			inserted.Insert( pairs[ i ].first, pairs[ i ].second );
+
+		ASSERT( inserted.GetContainer() == items.GetContainer() );
+	}
+	{	// adopt unsorted container
+		std::vector<TPair> unsorted( pairs, pairs + COUNT_OF( pairs ) );
+		utl::vector_map<int, std::tstring> items;
+
+		items.AssignUnsorted( unsorted );
+		ASSERT( unsorted.empty() );
+		ASSERT_EQUAL( "i1,i3 C,i7 B,i9", ut::FormatMapValues( items, "," ) );
+	}
+	{	// batch insert into existing items: the batch values replace the existing values
+		utl::vector_map<int, std::tstring> items;
+		items[ 2 ] = _T("i2");
+		items[ 3 ] = _T("i3 A");
+		items[ 10 ] = _T("i10");
+
+		items.InsertRange( pairs, pairs + COUNT_OF( pairs ) );
+		ASSERT_EQUAL( "1 2 3 7 9 10", ut::FormatMapKeys( items, " " ) );
+		ASSERT_EQUAL( "i1,i2,i3 C,i7 B,i9,i10", ut::FormatMapValues( items, "," ) );
+
+		items.InsertRange( pairs, pairs );			// empty batch
+		ASSERT_EQUAL( 6, items.size() );
+	}
+	{	// equivalent keys (case-insensitive): keeps the first key, like Insert()
+		utl::vector_map<std::tstring, int, pred::TLess_StringyNoCase> items;
+		const std::pair<std::tstring, int> namePairs[] = { std::make_pair( _T("Beta"), 1 ), std::make_pair( _T("alpha"), 2 ), std::make_pair( _T("BETA"), 3 ) };
+
+		items.Assign( namePairs, namePairs + COUNT_OF( namePairs ) );
+		ASSERT_EQUAL( 2, items.size() );
+		ASSERT_EQUAL( _T("Beta"), items.at( 1 ).first );
+		ASSERT_EQUAL( 3, items.at( 1 ).second );
+	}
+}
+
+void CAlgorithmsTests::Test_vector_map_Benchmark( void )
+{
+	// flat map vs node-based maps, for the typical map sizes in the code base: traces nanoseconds per item for construction from unsorted keys, and for lookups
+	const size_t mapSizes[] = { 16, 256, 4096 };
+
+	for ( size_t sizePos = 0; sizePos != COUNT_OF( mapSizes ); ++sizePos )
+	{
+		const size_t itemCount = mapSizes[ sizePos ], repeatCount = 65536 / itemCount;
+		std::vector< std::pair<int, int> > pairs;
+
+		for ( UINT seed = 12345; pairs.size() != itemCount; )
+		{
+			seed = seed * 1103515245 + 12345;			// deterministic pseudo-random keys
+			pairs.push_back( std::make_pair( static_cast<int>( seed >> 8 ), static_cast<int>( pairs.size() ) ) );
+		}
+
+		const double nanoFactor = 1e9 / double( itemCount * repeatCount );
+		double insertNs, bulkNs, mapNs, hashNs, findFlatNs, findMapNs, findHashNs;
+		size_t foundCount = 0;
+
+		utl::vector_map<int, int> flatMap;
+		std::map<int, int> treeMap;
+		std::unordered_map<int, int> hashMap;
+		CTimer timer;
+
+		for ( size_t i = 0; i != repeatCount; ++i )
+		{
+			flatMap.clear();
+			for ( std::vector< std::pair<int, int> >::const_iterator itPair = pairs.begin(); itPair != pairs.end(); ++itPair )
+				flatMap.Insert( itPair->first, itPair->second );
+		}
+		insertNs = timer.ElapsedSeconds() * nanoFactor;
+
+		timer.Restart();
+		for ( size_t i = 0; i != repeatCount; ++i )
+			flatMap.Assign( pairs.begin(), pairs.end() );
+		bulkNs = timer.ElapsedSeconds() * nanoFactor;
+
+		timer.Restart();
+		for ( size_t i = 0; i != repeatCount; ++i )
+			treeMap = std::map<int, int>( pairs.begin(), pairs.end() );
+		mapNs = timer.ElapsedSeconds() * nanoFactor;
+
+		timer.Restart();
+		for ( size_t i = 0; i != repeatCount; ++i )
+			hashMap = std::unordered_map<int, int>( pairs.begin(), pairs.end() );
+		hashNs = timer.ElapsedSeconds() * nanoFactor;
+
+		timer.Restart();
+		for ( size_t i = 0; i != repeatCount; ++i )
+			for ( std::vector< std::pair<int, int> >::const_iterator itPair = pairs.begin(); itPair != pairs.end(); ++itPair )
+				foundCount += flatMap.find( itPair->first ) != flatMap.end();
+		findFlatNs = timer.ElapsedSeconds() * nanoFactor;
+
+		timer.Restart();
+		for ( size_t i = 0; i != repeatCount; ++i )
+			for ( std::vector< std::pair<int, int> >::const_iterator itPair = pairs.begin(); itPair != pairs.end(); ++itPair )
+				foundCount += treeMap.find( itPair->first ) != treeMap.end();
+		findMapNs = timer.ElapsedSeconds() * nanoFactor;
+
+		timer.Restart();
+		for ( size_t i = 0; i != repeatCount; ++i )
+			for ( std::vector< std::pair<int, int> >::const_iterator itPair = pairs.begin(); itPair != pairs.end(); ++itPair )
+				foundCount += hashMap.find( itPair->first ) != hashMap.end();
+		findHashNs = timer.ElapsedSeconds() * nanoFactor;
+
+		ASSERT_EQUAL( flatMap.size(), treeMap.size() );
+		ASSERT_EQUAL( 3 * flatMap.size() * repeatCount, foundCount );
+
+		UT_TRACE( str::Format( _T("(N=%d build ns/item: vector_map Insert=%.1f Assign=%.1f, std::map=%.1f, unordered_map=%.1f; find ns/item: vector_map=%.1f, std::map=%.1f, unordered_map=%.1f)  "),
+							   static_cast<int>( itemCount ), insertNs, bulkNs, mapNs, hashNs, findFlatNs, findMapNs, findHashNs ).c_str() );
+	}
+}
+
 
 void CAlgorithmsTests::Run( void )
 {
@@ -846,6 +971,8 @@ void CAlgorithmsTests::Run( void )
 	RUN_TEST( TestAdvancePos );
 	RUN_TEST( TestOwningContainer );
 	RUN_TEST( Test_vector_map );
+	RUN_TEST( Test_vector_map_Bulk );
+	RUN_TEST( Test_vector_map_Benchmark );
 }
 
 
@@ -39,6 +39,8 @@ private:
 	void TestAdvancePos( void );
 	void TestOwningContainer( void );
 	void Test_vector_map( void );
+	void Test_vector_map_Bulk( void );
+	void Test_vector_map_Benchmark( void );
 private:
 	static const TCHAR s_sep[];		// ","
 };
@@ -4,6 +4,9 @@
 #ifdef USE_UT		// no UT code in release builds
 #include "DuplicateFilesTests.h"
 #include "DuplicateFilesEnumerator.h"
+#include "Crc32.h"
+#include "FileDigest.h"
+#include "FileLinks.h"
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -21,6 +24,32 @@ namespace ut
 
 		return str::Join( dupPaths, ut::CTempFilePool::m_sep );
 	}
+
+	std::tstring FormatXxHash64( const std::string& text, size_t chunkSize )
+	{	// hash in chunks, to exercise the streaming
+		utl::CXxHash64 hash;
+
+		for ( size_t pos = 0; pos < text.size(); pos += chunkSize )
+			hash.ProcessBytes( text.c_str() + pos, std::min( chunkSize, text.size() - pos ) );
+
+		return str::Format( _T("%016I64x"), hash.GetResult() );
+	}
+
+	std::tstring FormatSha256( const std::string& text, size_t chunkSize )
+	{
+		utl::CSha256 hash;
+
+		for ( size_t pos = 0; pos < text.size(); pos += chunkSize )
+			hash.ProcessBytes( text.c_str() + pos, std::min( chunkSize, text.size() - pos ) );
+
+		BYTE digest[ utl::CSha256::DigestSize ];
+		hash.GetResult( digest );
+
+		std::tstring hexText;
+		for ( size_t i = 0; i != utl::CSha256::DigestSize; ++i )
+			hexText += str::Format( _T("%02x"), digest[ i ] );
+		return hexText;
+	}
 }
 
 
@@ -57,10 +86,255 @@ void CDuplicateFilesTests::TestDuplicateFiles( void )
 	ASSERT_EQUAL( _T("b.txt|D1\\D2\\b.txt"), ut::JoinRelativeDupPaths( dupGroups[1], poolDirPath ) );		// excluding D1\\IGNORE\\b.txt
 }
 
+void CDuplicateFilesTests::TestIncrementalSession( void )
+{
+	ut::CTempFilePool pool( _T("a.txt|b.txt|file1.txt|D1\\a.txt|D1\\file2.txt|D1\\D2\\a.txt|D1\\D2\\b.txt|D1\\D2\\file3.txt|D1\\D2\\file4.txt") );
+	const fs::TDirPath& poolDirPath = pool.GetPoolDirPath();
+
+	CDuplicateFilesSession session;
+	CDuplicateFilesGroup* pGroupA = nullptr;
+
+	{
+		CDuplicateFilesEnumerator enumer( fs::EF_Recurse );
+		enumer.SetSession( &session );
+		enumer.SearchDuplicates( poolDirPath );
+
+		ASSERT( !enumer.GetOutcome().IsIncremental() );		// first search
+		ASSERT( enumer.m_dupGroupItems.empty() );				// results are stored in the session
+		ASSERT_EQUAL( 9, session.GetIndexedFileCount() );
+
+		const std::vector<CDuplicateFilesGroup*>& dupGroups = session.GetDuplicateGroups();
+
+		ASSERT_EQUAL( 2, dupGroups.size() );
+		ASSERT_EQUAL( _T("a.txt|D1\\a.txt|D1\\D2\\a.txt"), ut::JoinRelativeDupPaths( dupGroups[0], poolDirPath ) );
+		ASSERT_EQUAL( _T("b.txt|D1\\D2\\b.txt"), ut::JoinRelativeDupPaths( dupGroups[1], poolDirPath ) );
+
+		pGroupA = dupGroups[0];
+		ASSERT( pGroupA->GetItems().back()->MakeOriginalItem() );
+		ASSERT_EQUAL( _T("D1\\D2\\a.txt|a.txt|D1\\a.txt"), ut::JoinRelativeDupPaths( pGroupA, poolDirPath ) );
+	}
+
+	ASSERT( ut::ModifyFileText( pool.QualifyPath( _T("D1\\D2\\b.txt") ) ) );		// no longer a duplicate
+	ASSERT( pool.CreateFiles( _T("D1\\D2\\D3\\a.txt") ) );							// new duplicate
+
+	{
+		CDuplicateFilesEnumerator enumer( fs::EF_Recurse );
+		enumer.SetSession( &session );
+		enumer.SearchDuplicates( poolDirPath );
+
+		const CDupsOutcome& outcome = enumer.GetOutcome();
+		ASSERT_EQUAL( 3, outcome.m_foundSubDirCount );
+		ASSERT_EQUAL( 10, outcome.m_foundFileCount );
+		ASSERT_EQUAL( 8, outcome.m_unchangedFileCount );
+		ASSERT_EQUAL( 2, outcome.m_changedFileCount );		// modified D1/D2/b.txt, new D1/D2/D3/a.txt
+
+		const std::vector<CDuplicateFilesGroup*>& dupGroups = session.GetDuplicateGroups();
+
+		ASSERT_EQUAL( 1, dupGroups.size() );
+		ASSERT( pGroupA == dupGroups[0] );					// patched in place, keeping the original item
+		ASSERT_EQUAL( _T("D1\\D2\\a.txt|a.txt|D1\\a.txt|D1\\D2\\D3\\a.txt"), ut::JoinRelativeDupPaths( pGroupA, poolDirPath ) );
+	}
+
+	session.Reset();
+	ASSERT( session.IsEmpty() );
+}
+
+void CDuplicateFilesTests::TestHashAlgorithms( void )
+{
+	const std::string text100( 100, 'a' );
+
+	ASSERT_EQUAL( _T("ef46db3751d8e999"), ut::FormatXxHash64( std::string(), 1 ) );
+	ASSERT_EQUAL( _T("44bc2cf5ad770999"), ut::FormatXxHash64( "abc", 1 ) );
+	ASSERT_EQUAL( _T("375041e8b1decfb3"), ut::FormatXxHash64( text100, 100 ) );
+	ASSERT_EQUAL( _T("375041e8b1decfb3"), ut::FormatXxHash64( text100, 7 ) );
+
+	ASSERT_EQUAL( _T("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"), ut::FormatSha256( std::string(), 1 ) );
+	ASSERT_EQUAL( _T("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"), ut::FormatSha256( "abc", 1 ) );
+	ASSERT_EQUAL( _T("2816597888e4a0d3a36b82b83316ab32680eb8f00f8cd3b904d681246d285a0e"), ut::FormatSha256( text100, 100 ) );
+	ASSERT_EQUAL( _T("2816597888e4a0d3a36b82b83316ab32680eb8f00f8cd3b904d681246d285a0e"), ut::FormatSha256( text100, 7 ) );
+}
+
+void CDuplicateFilesTests::TestContentVerification( void )
+{
+	ut::CTempFilePool pool( _T("a.txt|b.txt|file1.txt|D1\\a.txt|D1\\file2.txt|D1\\D2\\a.txt|D1\\D2\\b.txt|D1\\D2\\file3.txt|D1\\D2\\file4.txt") );
+	const fs::TDirPath& poolDirPath = pool.GetPoolDirPath();
+
+	// file digests
+	{
+		fs::CFileDigest digest1, digest2;
+		fs::CPath filePath = pool.QualifyPath( _T("a.txt") );
+		UINT64 fileSize = fs::GetFileSize( filePath.GetPtr() );
+
+		ASSERT( fs::ComputeFileDigest( digest1, filePath, fileSize, fs::Sha256 ) );
+		ASSERT( fs::ComputeFileDigest( digest2, pool.QualifyPath( _T("D1\\a.txt") ), fileSize, fs::Sha256 ) );
+		ASSERT( digest1 == digest2 );
+		ASSERT( !fs::ComputeFileDigest( digest2, filePath, fileSize + 1, fs::Sha256 ) );		// size mismatch: modified in the meantime
+
+		ASSERT( fs::HaveSameContents( filePath, pool.QualifyPath( _T("D1\\D2\\a.txt") ) ) );
+		ASSERT( !fs::HaveSameContents( filePath, pool.QualifyPath( _T("b.txt") ) ) );
+	}
+
+	for ( int hashAlgorithm = fs::XxHash64; hashAlgorithm != fs::_HashAlgorithmCount; ++hashAlgorithm )
+	{
+		CDuplicateFilesEnumerator enumer( fs::EF_Recurse );
+		enumer.SetVerification( static_cast<fs::HashAlgorithm>( hashAlgorithm ), true );
+		enumer.SearchDuplicates( poolDirPath );
+
+		const CDupsOutcome& outcome = enumer.GetOutcome();
+		const std::vector<CDuplicateFilesGroup*>& dupGroups = enumer.m_dupGroupItems;
+
+		ASSERT_EQUAL( 2, dupGroups.size() );			// same groups as by CRC32 alone
+		ASSERT_EQUAL( _T("a.txt|D1\\a.txt|D1\\D2\\a.txt"), ut::JoinRelativeDupPaths( dupGroups[0], poolDirPath ) );
+		ASSERT_EQUAL( _T("b.txt|D1\\D2\\b.txt"), ut::JoinRelativeDupPaths( dupGroups[1], poolDirPath ) );
+
+		ASSERT( dupGroups[0]->GetDigest() != nullptr );
+		ASSERT_EQUAL( 5, outcome.m_verifyStats.m_digest.m_fileCount );
+
+		if ( fs::IsCryptographicHash( outcome.m_hashAlgorithm ) )
+			ASSERT( !outcome.m_byteCompare && outcome.m_verifyStats.m_byteCompare.IsEmpty() );		// no need for byte comparison
+		else
+			ASSERT_EQUAL( 5, outcome.m_verifyStats.m_byteCompare.m_fileCount );
+	}
+}
+
+void CDuplicateFilesTests::TestHardLinks( void )
+{
+	ut::CTempFilePool pool( _T("a.txt|b.txt|D1\\a.txt|D1\\D2\\a.txt") );
+	const fs::TDirPath& poolDirPath = pool.GetPoolDirPath();
+	const fs::CPath originalPath = pool.QualifyPath( _T("a.txt") ), linkPath = pool.QualifyPath( _T("D1\\a.txt") );
+
+	ASSERT( !fs::AreHardLinked( originalPath, linkPath ) );
+	ASSERT_EQUAL( fs::HardLinkFailed, fs::ReplaceWithHardLink( pool.QualifyPath( _T("b.txt") ), originalPath ) );		// different contents
+	ASSERT_EQUAL( fs::HardLinkCreated, fs::ReplaceWithHardLink( linkPath, originalPath ) );
+	ASSERT( fs::AreHardLinked( originalPath, linkPath ) );
+	ASSERT_EQUAL( fs::HardLinkExisting, fs::ReplaceWithHardLink( linkPath, originalPath ) );
+
+	{	// batch: only the newly linked duplicates are reported, so that undo doesn't break pre-existing links
+		const fs::CPath deepPath = pool.QualifyPath( _T("D1\\D2\\a.txt") );
+		std::vector<fs::CPath> dupPaths, originalPaths( 2, originalPath ), linkedPaths, failedPaths;
+
+		dupPaths.push_back( linkPath );
+		dupPaths.push_back( deepPath );
+
+		::SetFileAttributes( deepPath.GetPtr(), FILE_ATTRIBUTE_READONLY );
+		ASSERT_EQUAL( 1, fs::ReplaceWithHardLinks( linkedPaths, failedPaths, dupPaths, originalPaths ) );		// different attributes: refused
+		ASSERT( linkedPaths.empty() );
+		ASSERT_EQUAL( 1, failedPaths.size() );
+		::SetFileAttributes( deepPath.GetPtr(), FILE_ATTRIBUTE_NORMAL );
+
+		ASSERT_EQUAL( 2, fs::ReplaceWithHardLinks( linkedPaths, failedPaths, dupPaths, originalPaths ) );
+		ASSERT_EQUAL( 1, linkedPaths.size() );
+		ASSERT_EQUAL( deepPath.Get(), linkedPaths.front().Get() );
+		ASSERT( failedPaths.empty() );
+
+		ASSERT( fs::BreakHardLink( deepPath ) );
+	}
+
+	{
+		CDuplicateFilesEnumerator enumer( fs::EF_Recurse );
+		enumer.SearchDuplicates( poolDirPath );
+
+		ASSERT_EQUAL( 1, enumer.GetOutcome().m_hardLinkCount );		// D1/a.txt: not hashed, not a duplicate
+
+		const std::vector<CDuplicateFilesGroup*>& dupGroups = enumer.m_dupGroupItems;
+
+		ASSERT_EQUAL( 1, dupGroups.size() );
+		ASSERT_EQUAL( _T("a.txt|D1\\D2\\a.txt"), ut::JoinRelativeDupPaths( dupGroups[0], poolDirPath ) );
+	}
+
+	ASSERT( fs::BreakHardLink( linkPath ) );			// undo: independent copy with the same contents
+	ASSERT( !fs::AreHardLinked( originalPath, linkPath ) );
+	ASSERT( fs::HaveSameContents( originalPath, linkPath ) );
+}
+
+void CDuplicateFilesTests::TestExternalSort( void )
+{
+	ut::CTempFilePool pool( _T("a.txt|b.txt|file1.txt|D1\\a.txt|D1\\file2.txt|D1\\D2\\a.txt|D1\\D2\\b.txt|D1\\D2\\file3.txt|D1\\D2\\file4.txt") );
+	const fs::TDirPath& poolDirPath = pool.GetPoolDirPath();
+
+	CDuplicateFilesEnumerator enumer( fs::EF_Recurse );
+	enumer.SetSpillThreshold( 2 );					// spill a run to a temporary file every 2 found files
+
+	enumer.SearchDuplicates( poolDirPath );
+
+	const CDupsOutcome& outcome = enumer.GetOutcome();
+	ASSERT_EQUAL( 9, outcome.m_foundFileCount );
+	ASSERT_EQUAL( 4, outcome.m_spillRunCount );		// the last file is merged from memory
+
+	const std::vector<CDuplicateFilesGroup*>& dupGroups = enumer.m_dupGroupItems;
+
+	ASSERT_EQUAL( 2, dupGroups.size() );			// same as grouping in memory
+	ASSERT_EQUAL( _T("a.txt|D1\\a.txt|D1\\D2\\a.txt"), ut::JoinRelativeDupPaths( dupGroups[0], poolDirPath ) );
+	ASSERT_EQUAL( _T("b.txt|D1\\D2\\b.txt"), ut::JoinRelativeDupPaths( dupGroups[1], poolDirPath ) );
+
+	{	// overlapping search paths: the found file paths are not kept unique when spilling, the repeated files are discarded when grouping
+		std::vector<fs::TPatternPath> searchPaths;
+		searchPaths.push_back( poolDirPath );
+		searchPaths.push_back( poolDirPath / _T("D1") );
+
+		enumer.SearchDuplicates( searchPaths );
+		ASSERT_EQUAL( 9, enumer.GetOutcome().m_foundFileCount );
+		ASSERT_EQUAL( 2, enumer.m_dupGroupItems.size() );
+		ASSERT_EQUAL( _T("a.txt|D1\\a.txt|D1\\D2\\a.txt"), ut::JoinRelativeDupPaths( enumer.m_dupGroupItems[0], poolDirPath ) );
+	}
+}
+
+void CDuplicateFilesTests::TestScanMetrics( void )
+{
+	ut::CTempFilePool pool( _T("a.txt|b.txt|file1.txt|D1\\a.txt|D1\\file2.txt|D1\\D2\\a.txt|D1\\D2\\b.txt|D1\\D2\\file3.txt|D1\\D2\\file4.txt") );
+	const fs::TDirPath& poolDirPath = pool.GetPoolDirPath();
+
+	fs::CCrc32FileCache::Instance().Clear();		// all checksums are computed by the first search
+
+	for ( int searchNo = 0; searchNo != 2; ++searchNo )
+	{
+		CDuplicateFilesEnumerator enumer( fs::EF_Recurse );
+		enumer.SetVerification( fs::XxHash64, false );
+		enumer.SearchDuplicates( poolDirPath );
+
+		const CDupsOutcome& outcome = enumer.GetOutcome();
+		const CContentVerifyStats& stats = outcome.m_verifyStats;
+		const size_t crc32FileCount = stats.m_crc32.m_fileCount;
+
+		ASSERT_EQUAL( 2, enumer.m_dupGroupItems.size() );
+		ASSERT_EQUAL( 5, stats.m_digest.m_fileCount );
+
+		if ( 0 == searchNo )
+		{
+			ASSERT_EQUAL( 0, stats.m_crc32CacheHitCount );
+			ASSERT_EQUAL( crc32FileCount, stats.m_crc32ReadCount );
+		}
+		else
+		{
+			ASSERT_EQUAL( crc32FileCount, stats.m_crc32CacheHitCount );		// unmodified files: no CRC32 reads
+			ASSERT_EQUAL( 0, stats.m_crc32ReadCount );
+			ASSERT_EQUAL( 0, stats.m_crc32ReadByteCount );
+		}
+
+		// all small files on a single volume
+		ASSERT_EQUAL( stats.GetHashedFileCount(), stats.m_io.m_sizeBuckets[ CContentIoStats::Upto64KB ].m_fileCount );
+		ASSERT_EQUAL( stats.GetReadByteCount(), stats.m_io.m_sizeBuckets[ CContentIoStats::Upto64KB ].m_byteCount );
+		ASSERT_EQUAL( 1, stats.m_io.m_volumes.size() );
+		ASSERT_EQUAL( stats.GetHashedFileCount(), stats.m_io.m_volumes.begin()->second.m_fileCount );
+
+		std::tstring metrics = outcome.FormatMetrics();
+
+		ASSERT( metrics.find( _T("search.foundFiles=9\n") ) != std::tstring::npos );
+		ASSERT( metrics.find( _T("stage.digest.algorithm=XXH64\n") ) != std::tstring::npos );
+		ASSERT( metrics.find( str::Format( _T("crc32.cacheHits=%d\n"), stats.m_crc32CacheHitCount ) ) != std::tstring::npos );
+	}
+}
+
 
 void CDuplicateFilesTests::Run( void )
 {
 	RUN_TEST( TestDuplicateFiles );
+	RUN_TEST( TestIncrementalSession );
+	RUN_TEST( TestHashAlgorithms );
+	RUN_TEST( TestContentVerification );
+	RUN_TEST( TestHardLinks );
+	RUN_TEST( TestExternalSort );
+	RUN_TEST( TestScanMetrics );
 }
 
 
@@ -18,6 +18,12 @@ public:
 	virtual void Run( void );
 private:
 	void TestDuplicateFiles( void );
+	void TestIncrementalSession( void );
+	void TestHashAlgorithms( void );
+	void TestContentVerification( void );
+	void TestHardLinks( void );
+	void TestExternalSort( void );
+	void TestScanMetrics( void );
 };
 
 
@@ -166,6 +166,50 @@ void CEndiannessTests::TestSwapBytesSameEndianness( void )
 	ASSERT_EQUAL( value, swappedText );
 }
 
+void CEndiannessTests::TestSwapBytesSpan( void )
+{
+	using namespace endian;
+
+	// compare the bulk swapping with the scalar swapping, for all the vector tail lengths and misaligned buffers; both SIMD and scalar paths
+	std::vector<wchar_t> wideText;
+	std::vector<char32_t> text32;
+
+	for ( size_t i = 0; i != 80; ++i )
+	{
+		wideText.push_back( static_cast<wchar_t>( 0x0102 + i * 0x0303 ) );
+		text32.push_back( static_cast<char32_t>( 0x01020304 + i * 0x05060708 ) );
+	}
+
+	for ( int simd = 0; simd != 2; ++simd )
+	{
+		bool oldSimd = EnableSimdSwapBytes( simd != 0 );
+
+		for ( size_t offset = 0; offset != 3; ++offset )
+			for ( size_t count = 0; count + offset <= wideText.size(); count += 7 )
+			{
+				std::vector<wchar_t> expectedWide( wideText.begin() + offset, wideText.begin() + offset + count );
+				std::for_each( expectedWide.begin(), expectedWide.end(), func::SwapBytes<Little, Big>() );
+
+				std::vector<wchar_t> swappedWide( count );
+				SwapBytesSpan( utl::Data( swappedWide ), utl::Data( wideText ) + offset, count );		// copy-swap
+				ASSERT( expectedWide == swappedWide );
+
+				std::vector<wchar_t> inPlaceWide( wideText );
+				SwapBytesSpan( utl::Data( inPlaceWide ) + offset, utl::Data( inPlaceWide ) + offset, count );		// in-place
+				ASSERT( std::equal( expectedWide.begin(), expectedWide.end(), inPlaceWide.begin() + offset ) );
+
+				std::vector<char32_t> expected32( text32.begin() + offset, text32.begin() + offset + count );
+				std::for_each( expected32.begin(), expected32.end(), func::SwapBytes<Little, Big>() );
+
+				std::vector<char32_t> swapped32( count );
+				SwapBytesSpan( utl::Data( swapped32 ), utl::Data( text32 ) + offset, count );
+				ASSERT( expected32 == swapped32 );
+			}
+
+		EnableSimdSwapBytes( oldSimd );
+	}
+}
+
 
 void CEndiannessTests::Run( void )
 {
@@ -173,6 +217,7 @@ void CEndiannessTests::Run( void )
 	RUN_TEST( TestSwapBytesString );
 	RUN_TEST( TestSwapBytesContainer );
 	RUN_TEST( TestSwapBytesSameEndianness );
+	RUN_TEST( TestSwapBytesSpan );
 }
 
 
@@ -21,6 +21,7 @@ private:
 	void TestSwapBytesString( void );
 	void TestSwapBytesContainer( void );
 	void TestSwapBytesSameEndianness( void );
+	void TestSwapBytesSpan( void );
 };
 
 
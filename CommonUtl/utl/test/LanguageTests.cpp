@@ -529,6 +529,54 @@ void CLanguageTests::TestCodeDetails( void )
 	}
 }
 
+void CLanguageTests::TestCodeSkipMap( void )
+{
+	const code::CLanguage<char>& cppLang = code::GetLangCpp<char>();
+
+	const std::string text = "int Count( const char* pText = \"(a, b)\" ) /*= Count( 'x' )*/ { return '}' == *pText; // skip (\n }";
+	const code::CCodeSkipMap<char> skipMap( cppLang, text );
+	const std::vector< Range<size_t> >& skipRanges = skipMap.GetSkipRanges();
+
+	ASSERT_EQUAL( 4, skipRanges.size() );
+	ASSERT_EQUAL( "\"(a, b)\"", str::ExtractString( skipRanges[ 0 ], text ) );
+	ASSERT_EQUAL( "/*= Count( 'x' )*/", str::ExtractString( skipRanges[ 1 ], text ) );
+	ASSERT_EQUAL( "'}'", str::ExtractString( skipRanges[ 2 ], text ) );
+	ASSERT_EQUAL( "// skip (\n", str::ExtractString( skipRanges[ 3 ], text ) );
+
+	ASSERT( skipMap.IsCodeAt( 0 ) );
+	ASSERT( !skipMap.IsCodeAt( skipRanges[ 1 ].m_start + 1 ) );
+	ASSERT( skipMap.IsCodeAt( skipRanges[ 1 ].m_end ) );
+
+	const std::string count = "Count";
+	size_t openPos = skipMap.FindNextCharThat( 0, pred::IsChar<>( '{' ) );
+	ASSERT_HAS_PREFIX( "{ return", &text[ openPos ] );
+	ASSERT_EQUAL( text.length() - 1, skipMap.FindMatchingBracket( openPos ) );
+	ASSERT_EQUAL( text.length(), skipMap.FindNextSequence( skipMap.FindNextSequence( 0, count ) + 1, count ) );		// the 2nd "Count" is commented
+
+	// same results as the iterator searches, from any position
+	for ( size_t pos = 0; pos != text.length(); ++pos )
+	{
+		ASSERT_EQUAL( std::distance( text.begin(), cppLang.FindNextSequence( text.begin() + pos, text.end(), count ) ), skipMap.FindNextSequence( pos, count ) );
+		ASSERT_EQUAL( std::distance( text.begin(), cppLang.FindNextCharThat( text.begin() + pos, text.end(), pred::IsBracket() ) ), skipMap.FindNextCharThat( pos, pred::IsBracket() ) );
+		ASSERT_EQUAL( std::distance( text.begin(), cppLang.FindNextChar( text.begin() + pos, text.end(), ';' ) ), skipMap.FindNextCharThat( pos, pred::IsChar<>( ';' ) ) );
+	}
+
+	{	// skipping arg-lists
+		code::CLanguage<char>::CScopedSkipArgLists skipArgLists( &cppLang );
+		ASSERT_EQUAL( text.length(), skipMap.FindNextSequence( 0, std::string( "==" ) ) );			// inside the "{}" block
+		ASSERT_EQUAL( text.length(), skipMap.FindNextCharThat( 0, pred::IsChar<>( '=' ) ) );			// all '=' are inside brackets or comments
+		ASSERT_EQUAL( openPos, skipMap.FindNextSequence( 0, std::string( "{ return" ) ) );
+	}
+
+	const std::string mismatchText = "f( '(', /* ) */ g[ 1 )";
+	const code::CCodeSkipMap<char> mismatchMap( cppLang, mismatchText );
+	size_t mismatchPos = utl::npos;
+
+	ASSERT_EQUAL( mismatchText.length(), mismatchMap.FindMatchingBracket( 1, &mismatchPos ) );
+	ASSERT_EQUAL( 1, mismatchPos );
+	ASSERT_THROWS( code::TSyntaxError, mismatchMap.FindMatchingBracket( 1 ) );
+}
+
 void CLanguageTests::TestC_EscapeSequences( void )
 {
 	const code::CEscaper& escaper = code::GetEscaperC();
@@ -836,6 +884,7 @@ void CLanguageTests::Run( void )
 	RUN_TEST( TestBracketParity );
 	RUN_TEST( TestBracketMismatch );
 	RUN_TEST( TestCodeDetails );
+	RUN_TEST( TestCodeSkipMap );
 
 	RUN_TEST( TestC_EscapeSequences );
 	RUN_TEST( TestCpp_ParseNumericLiteral );
@@ -23,6 +23,7 @@ private:
 	void TestBracketParity( void );
 	void TestBracketMismatch( void );
 	void TestCodeDetails( void );
+	void TestCodeSkipMap( void );
 
 	void TestC_EscapeSequences( void );
 	void TestCpp_ParseNumericLiteral( void );
@@ -596,6 +596,40 @@ void CPathTests::TestPathNaturalSort( void )
 	*/
 }
 
+void CPathTests::TestPathNaturalSortKeys( void )
+{
+	const TCHAR s_srcFiles[] =
+		_T("|C:|c:\\|C:\\dir|C:\\DIR|C:\\dir\\file.txt|C:\\Dir\\FILE.txt|C:\\dir\\file.txt.bak|C:\\dir\\file-1.txt|C:\\dir\\file_1.txt|")
+		_T("C:\\dir\\file(1).txt|C:\\dir\\file[1].txt|C:\\dir\\file1.txt|C:\\dir\\file01.txt|C:\\dir\\file001.txt|C:\\dir\\file2.txt|C:\\dir\\file10.txt|")
+		_T("C:\\dir\\file0.txt|C:\\dir\\file00.txt|C:\\dir0\\file.txt|C:\\dir00\\file.txt|C:\\dir2\\a|C:\\dir10\\a|C:\\dir010\\a|C:\\dir 2\\a|")
+		_T("C:\\dir\\sub\\file.txt|C:\\dir\\sub2\\file.txt|C:\\dir\\Sub10\\file.txt|D:\\1254 Biertan{DUP}.jpg|D:\\1254 Biertan~DUP.jpg|D:\\1254 Biertan.jpg");
+
+	std::vector<fs::CPath> filePaths;
+	str::Split( filePaths, s_srcFiles, _T("|") );
+
+	std::vector<std::string> sortKeys( filePaths.size() );
+	for ( size_t i = 0; i != filePaths.size(); ++i )
+		ASSERT( path::MakeNaturalSortKey( sortKeys[ i ], filePaths[ i ] ) );
+
+	// the sort keys order is equivalent with pred::CompareNaturalPath for all pairs
+	pred::CompareNaturalPath compareNaturalPath;
+	for ( size_t i = 0; i != filePaths.size(); ++i )
+		for ( size_t j = 0; j != filePaths.size(); ++j )
+			ASSERT_EQUAL( compareNaturalPath( filePaths[ i ], filePaths[ j ] ), pred::ToCompareResult( sortKeys[ i ].compare( sortKeys[ j ] ) ) );
+
+	// sort by keys is equivalent with sort by comparator
+	std::random_shuffle( filePaths.begin(), filePaths.end() );
+	std::vector<fs::CPath> sortedPaths = filePaths;
+
+	std::stable_sort( sortedPaths.begin(), sortedPaths.end(), pred::TLess_NaturalPath() );
+	fs::SortPaths( filePaths );
+	ASSERT_EQUAL( str::Join( sortedPaths, _T("|") ), str::Join( filePaths, _T("|") ) );
+
+	std::stable_sort( sortedPaths.begin(), sortedPaths.end(), pred::OrderByValue<pred::CompareNaturalPath>( false ) );
+	fs::SortPaths( filePaths, false );
+	ASSERT_EQUAL( str::Join( sortedPaths, _T("|") ), str::Join( filePaths, _T("|") ) );
+}
+
 void CPathTests::TestPathCompareFind( void )
 {
 	{
@@ -1053,6 +1087,7 @@ void CPathTests::Run( void )
 	RUN_TEST( TestPathSort );
 	RUN_TEST( TestPathSortExisting );
 	RUN_TEST( TestPathNaturalSort );
+	RUN_TEST( TestPathNaturalSortKeys );
 	RUN_TEST( TestPathCompareFind );
 	RUN_TEST( TestPathWildcardMatch );
 	RUN_TEST( TestHasMultipleDirPaths );
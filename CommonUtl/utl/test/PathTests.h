@@ -25,6 +25,7 @@ private:
 	void TestPathSort( void );
 	void TestPathSortExisting( void );
 	void TestPathNaturalSort( void );
+	void TestPathNaturalSortKeys( void );
 	void TestPathCompareFind( void );
 	void TestPathWildcardMatch( void );
 	void TestHasMultipleDirPaths( void );
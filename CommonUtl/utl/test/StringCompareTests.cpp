@@ -742,6 +742,64 @@ void CStringCompareTests::TestIntuitiveSortPunctuation( void )
 	}
 }
 
+namespace ut
+{
+	template< typename CharT >
+	bool HasIntuitiveSortKeyOrder( const std::vector< std::basic_string<CharT> >& items )
+	{	// the sort keys order must be equivalent with str::IntuitiveCompare() for all pairs
+		std::vector<std::string> sortKeys( items.size() );
+
+		for ( size_t i = 0; i != items.size(); ++i )
+			if ( !str::MakeIntuitiveSortKey( sortKeys[ i ], items[ i ].c_str() ) )
+				return false;
+
+		for ( size_t i = 0; i != items.size(); ++i )
+			for ( size_t j = 0; j != items.size(); ++j )
+				if ( str::IntuitiveCompare( items[ i ].c_str(), items[ j ].c_str() ) != pred::ToCompareResult( sortKeys[ i ].compare( sortKeys[ j ] ) ) )
+					return false;
+
+		return true;
+	}
+}
+
+void CStringCompareTests::TestIntuitiveSortKeys( void )
+{
+	const char s_srcItems[] =
+		"|0|00|000a|0a|0.|a|A|a0|a00|a000|a01|a1|A1|a001|a10|a010|a9|a.b|a-b|a_b|A_B|a b|a~b|x100|x99|X0099|x099y|x99y|"
+		"file2.txt|File10.txt|file02.txt|file2a|file2A|file20|v1.2.10|v1.10.2|v1.02|v1.2|v01.2|1254 Biertan(DUP).jpg|1254 biertan_DUP.jpg|"
+		"st3Ring|2string|st2ring|STRING20|string2|3String|20STRING|st20RING|String3|9|09|009|10|010|100|0100|a0b|a00b|a0.b|a00.b";
+
+	std::vector<std::string> items;
+	str::Split( items, s_srcItems, "|" );
+	ASSERT( ut::HasIntuitiveSortKeyOrder( items ) );
+
+	std::vector<std::wstring> wItems;
+	str::Split( wItems, str::FromAnsi( s_srcItems ).c_str(), L"|" );
+	ASSERT( ut::HasIntuitiveSortKeyOrder( wItems ) );
+
+	// sort by keys is equivalent with sort by comparator
+	{
+		std::random_shuffle( items.begin(), items.end() );
+		std::vector<std::string> sortedItems = items;
+
+		std::sort( sortedItems.begin(), sortedItems.end(), pred::TLess_StringyIntuitive() );
+		str::SortIntuitive( items.begin(), items.end() );
+		ASSERT_EQUAL( str::Join( sortedItems, "|" ), str::Join( items, "|" ) );
+
+		std::sort( sortedItems.begin(), sortedItems.end(), pred::OrderByValue<pred::TStringyCompareIntuitive>( false ) );
+		str::SortIntuitive( items.begin(), items.end(), false );
+		ASSERT_EQUAL( str::Join( sortedItems, "|" ), str::Join( items, "|" ) );
+	}
+
+	{
+		std::vector<std::wstring> sortedItems = wItems;
+
+		std::sort( sortedItems.begin(), sortedItems.end(), pred::TLess_StringyIntuitive() );
+		str::SortIntuitive( wItems.begin(), wItems.end() );
+		ASSERT_EQUAL( str::Join( sortedItems, L"|" ), str::Join( wItems, L"|" ) );
+	}
+}
+
 
 void CStringCompareTests::Run( void )
 {
@@ -757,6 +815,7 @@ void CStringCompareTests::Run( void )
 	RUN_TEST( TestStringSorting );
 	RUN_TEST( TestIntuitiveSort );
 	RUN_TEST( TestIntuitiveSortPunctuation );
+	RUN_TEST( TestIntuitiveSortKeys );
 }
 
 
@@ -28,6 +28,7 @@ private:
 	void TestStringSorting( void );
 	void TestIntuitiveSort( void );
 	void TestIntuitiveSortPunctuation( void );
+	void TestIntuitiveSortKeys( void );
 };
 
 
@@ -9,6 +9,7 @@
 #include "StringUtilities.h"
 #include "StringParsing.h"
 #include "StdHashValue.h"
+#include "Timer.h"
 #include "TimeUtils.h"
 #include <unordered_set>
 
@@ -920,6 +921,73 @@ void CStringTests::TestReplaceEnclosedItems( void )
 }
 
 
+void CStringTests::TestReplaceMultiple( void )
+{
+	std::vector< std::pair<std::string, std::string> > pairs;
+	pairs.push_back( std::make_pair( std::string( "ab" ), std::string( "X" ) ) );
+	pairs.push_back( std::make_pair( std::string( "a" ), std::string( "Y" ) ) );
+	pairs.push_back( std::make_pair( std::string( "b" ), std::string( "ab" ) ) );		// replacements are not searched again
+
+	std::string text;
+	ASSERT_EQUAL( 0, str::ReplaceMultiple( text, pairs ) );
+	ASSERT_EQUAL( "", text );
+
+	text = "xyz";
+	ASSERT_EQUAL( 0, str::ReplaceMultiple( text, pairs ) );
+	ASSERT_EQUAL( "xyz", text );
+
+	text = "aabbab";
+	ASSERT_EQUAL( 4, str::ReplaceMultiple( text, pairs ) );
+	ASSERT_EQUAL( "YXabX", text );
+
+	text = "aabbab";
+	ASSERT_EQUAL( 2, str::ReplaceMultiple( text, pairs, 2 ) );
+	ASSERT_EQUAL( "YXbab", text );
+
+	{	// escape in one pass: no double escaping of the replaced "&"
+		std::vector< std::pair<std::wstring, std::wstring> > escapes;
+		escapes.push_back( std::make_pair( std::wstring( L"&" ), std::wstring( L"&amp;" ) ) );
+		escapes.push_back( std::make_pair( std::wstring( L"<" ), std::wstring( L"&lt;" ) ) );
+		escapes.push_back( std::make_pair( std::wstring( L">" ), std::wstring( L"&gt;" ) ) );
+
+		std::wstring markup = L"<a & b>";
+		ASSERT_EQUAL( 4, str::ReplaceMultiple( markup, escapes ) );
+		ASSERT_EQUAL( L"&lt;a &amp; b&gt;", markup );
+	}
+}
+
+void CStringTests::TestReplace_ManyMatches( void )
+{
+	// single pass replace: results identical to replacing in place; traces the timings for inputs with a match on every line
+	enum { LineCount = 200000 };
+
+	std::string unixText;
+	unixText.reserve( LineCount * 3 );
+	for ( size_t i = 0; i != LineCount; ++i )
+		unixText += "x;\n";
+
+	std::string text = unixText;
+	CTimer timer;
+
+	ASSERT_EQUAL( LineCount, str::Replace( text, "\n", "\r\n" ) );
+	double growSeconds = timer.ElapsedSeconds();
+	ASSERT_EQUAL( LineCount * 4, text.length() );
+
+	timer.Restart();
+	ASSERT_EQUAL( LineCount, str::Replace( text, "\r\n", "\n" ) );
+	double shrinkSeconds = timer.ElapsedSeconds();
+	ASSERT( unixText == text );
+
+	timer.Restart();
+	ASSERT_EQUAL( LineCount, str::ReplaceDelimiters( text, "\n", "\r\n" ) );
+	ASSERT_EQUAL( LineCount * 2, str::StripDelimiters( text, "\r\n" ) );
+	double delimsSeconds = timer.ElapsedSeconds();
+	ASSERT_EQUAL( LineCount * 2, text.length() );
+
+	UT_TRACE( str::Format( _T("(%d lines: grow %s, shrink %s, delimiters %s)  "), LineCount,
+						   CTimer::FormatSeconds( growSeconds ).c_str(), CTimer::FormatSeconds( shrinkSeconds ).c_str(), CTimer::FormatSeconds( delimsSeconds ).c_str() ).c_str() );
+}
+
 void CStringTests::TestArgUtilities( void )
 {
 	ASSERT( arg::Equals( _T("apple"), _T("apple") ) );
@@ -1236,6 +1304,8 @@ void CStringTests::Run( void )
 
 	RUN_TEST( TestSearchEnclosedItems );
 	RUN_TEST( TestReplaceEnclosedItems );
+	RUN_TEST( TestReplaceMultiple );
+	RUN_TEST( TestReplace_ManyMatches );
 	RUN_TEST( TestArgUtilities );
 	RUN_TEST( TestEnumTags );
 	RUN_TEST( TestFlagTags );
@@ -36,6 +36,8 @@ private:
 
 	void TestSearchEnclosedItems( void );
 	void TestReplaceEnclosedItems( void );
+	void TestReplaceMultiple( void );
+	void TestReplace_ManyMatches( void );
 
 	void TestArgUtilities( void );
 	void TestEnumTags( void );
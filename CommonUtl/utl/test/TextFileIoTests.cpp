@@ -14,6 +14,8 @@ template< typename StringT > std::wostream& operator<<( std::wostream& os, const
 #include "TextFileIo.h"
 #include "IoBin.h"
 #include "EnumTags.h"
+#include "FileSystem.h"
+#include "Timer.h"
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -676,6 +678,40 @@ void CTextFileIoTests::TestParseSaveVerbatimContent( void )
 	}
 
 
+void CTextFileIoTests::TestWriteReadLines_Throughput( void )
+{
+	// benchmark the line io through the encoded file buffer: traces the write/read throughput in MB/s for each encoding
+	enum { LineCount = 20000 };
+
+	std::vector<std::wstring> lines, inLines;
+	lines.reserve( LineCount );
+
+	for ( size_t i = 0; i != LineCount; ++i )
+		lines.push_back( str::Format( L"%05d: The quick brown fox jumps over the lazy dog - \x00E9t\x00E9 \x03A9 (line %d)", i, i ) );
+
+	static const fs::Encoding s_encodings[] = { fs::ANSI_UTF8, fs::UTF8_bom, fs::UTF16_LE_bom, fs::UTF16_be_bom };
+
+	for ( size_t i = 0; i != COUNT_OF( s_encodings ); ++i )
+	{
+		ut::CTempFilePool pool( ut::FormatTextFilename( s_encodings[ i ] ).c_str() );
+		const fs::CPath& textPath = pool.GetFilePaths().front();
+
+		CTimer timer;
+		io::WriteLinesToFile( textPath, lines, s_encodings[ i ] );
+		double writeSeconds = std::max( timer.ElapsedSeconds(), 0.001 );
+
+		timer.Restart();
+		ASSERT_EQUAL( s_encodings[ i ], io::ReadLinesFromFile( inLines, textPath ) );
+		double readSeconds = std::max( timer.ElapsedSeconds(), 0.001 );
+
+		ASSERT( lines == inLines );
+
+		double fileMegaBytes = double( fs::GetFileSize( textPath.GetPtr() ) ) / ( 1024 * 1024 );
+		UT_TRACE( str::Format( _T("(%s: write %.0f MB/s, read %.0f MB/s)  "), fs::GetTags_Encoding().FormatKey( s_encodings[ i ] ).c_str(), fileMegaBytes / writeSeconds, fileMegaBytes / readSeconds ).c_str() );
+	}
+}
+
+
 void CTextFileIoTests::Run( void )
 {
 	RUN_TEST( TestByteOrderMark );
@@ -685,6 +721,7 @@ void CTextFileIoTests::Run( void )
 	RUN_TEST( TestWriteReadLines_Rewind );
 	RUN_TEST( TestWriteParseLines );
 	RUN_TEST( TestParseSaveVerbatimContent );
+	RUN_TEST( TestWriteReadLines_Throughput );
 }
 
 
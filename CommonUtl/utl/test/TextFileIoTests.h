@@ -27,6 +27,7 @@ private:
 	void TestWriteReadLines_Rewind( void );			// rewind the file buffer and re-read
 	void TestWriteParseLines( void );
 	void TestParseSaveVerbatimContent( void );
+	void TestWriteReadLines_Throughput( void );		// benchmark
 };
 
 
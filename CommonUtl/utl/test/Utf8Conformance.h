@@ -0,0 +1,329 @@
+#ifndef Utf8Conformance_h
+#define Utf8Conformance_h
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Utf8Transcoder.h"
+
+
+// Portable conformance suite of the UTF8 transcoder: depends only on the C++ library, so that it runs off Windows (see test/Utf8ConformanceMain.cpp).
+// Checks the transcoder against a reference codec written from the Unicode tables (not from the transcoder's code):
+//	- known invalid sequences (Unicode Standard, table 3-8 and the maximal subpart examples);
+//	- random UTF8, UTF32 and wide inputs, mixing valid and invalid pieces; both with SIMD and scalar.
+// Reports each failure to the output stream, and returns the failure count.
+//
+namespace ut
+{
+	namespace utf8_conform
+	{
+		typedef std::basic_string<char32_t> TString32;
+
+
+		// reference codec
+
+		inline size_t GetWellFormedLength( const unsigned char* pSrc, size_t count, bool* pComplete )
+		{	// the length of the longest prefix of a well-formed sequence (Unicode Standard, table 3-7)
+			struct CRow { unsigned char m_ranges[ 4 ][ 2 ]; size_t m_length; };
+
+			static const CRow s_rows[] =
+			{
+				{ { { 0x00, 0x7F } }, 1 },
+				{ { { 0xC2, 0xDF }, { 0x80, 0xBF } }, 2 },
+				{ { { 0xE0, 0xE0 }, { 0xA0, 0xBF }, { 0x80, 0xBF } }, 3 },
+				{ { { 0xE1, 0xEC }, { 0x80, 0xBF }, { 0x80, 0xBF } }, 3 },
+				{ { { 0xED, 0xED }, { 0x80, 0x9F }, { 0x80, 0xBF } }, 3 },
+				{ { { 0xEE, 0xEF }, { 0x80, 0xBF }, { 0x80, 0xBF } }, 3 },
+				{ { { 0xF0, 0xF0 }, { 0x90, 0xBF }, { 0x80, 0xBF }, { 0x80, 0xBF } }, 4 },
+				{ { { 0xF1, 0xF3 }, { 0x80, 0xBF }, { 0x80, 0xBF }, { 0x80, 0xBF } }, 4 },
+				{ { { 0xF4, 0xF4 }, { 0x80, 0x8F }, { 0x80, 0xBF }, { 0x80, 0xBF } }, 4 }
+			};
+
+			for ( size_t row = 0; row != sizeof( s_rows ) / sizeof( s_rows[ 0 ] ); ++row )
+				if ( pSrc[ 0 ] >= s_rows[ row ].m_ranges[ 0 ][ 0 ] && pSrc[ 0 ] <= s_rows[ row ].m_ranges[ 0 ][ 1 ] )
+				{
+					size_t length = 1;
+
+					while ( length != s_rows[ row ].m_length && length != count &&
+							pSrc[ length ] >= s_rows[ row ].m_ranges[ length ][ 0 ] && pSrc[ length ] <= s_rows[ row ].m_ranges[ length ][ 1 ] )
+						++length;
+
+					*pComplete = length == s_rows[ row ].m_length;
+					return length;
+				}
+
+			*pComplete = false;
+			return 0;				// can't start a sequence
+		}
+
+		inline TString32 RefDecodeUtf8( const std::string& utf8, size_t* pInvalidCount )
+		{	// each maximal subpart of an ill-formed sequence is replaced by one U+FFFD
+			const unsigned char* pSrc = reinterpret_cast<const unsigned char*>( utf8.data() );
+			TString32 text32;
+
+			*pInvalidCount = 0;
+			for ( size_t pos = 0; pos != utf8.length(); )
+			{
+				bool complete;
+				size_t length = GetWellFormedLength( pSrc + pos, utf8.length() - pos, &complete );
+
+				if ( complete )
+				{
+					static const unsigned char s_leadMasks[] = { 0, 0x7F, 0x1F, 0x0F, 0x07 };
+					char32_t codePoint = pSrc[ pos ] & s_leadMasks[ length ];
+
+					for ( size_t i = 1; i != length; ++i )
+						codePoint = ( codePoint << 6 ) | ( pSrc[ pos + i ] & 0x3F );
+
+					text32 += codePoint;
+				}
+				else
+				{
+					text32 += static_cast<char32_t>( utf8::ReplacementChar );
+					++*pInvalidCount;
+				}
+				pos += length != 0 ? length : 1;
+			}
+			return text32;
+		}
+
+		inline bool IsScalarValue( char32_t codePoint ) { return codePoint <= utf8::MaxCodePoint && ( codePoint < 0xD800 || codePoint > 0xDFFF ); }
+
+		inline std::string RefEncodeUtf8( const TString32& text32, size_t* pInvalidCount )
+		{
+			std::string utf8;
+
+			*pInvalidCount = 0;
+			for ( size_t i = 0; i != text32.length(); ++i )
+			{
+				char32_t codePoint = text32[ i ];
+
+				if ( !IsScalarValue( codePoint ) )
+				{
+					codePoint = utf8::ReplacementChar;
+					++*pInvalidCount;
+				}
+
+				size_t length = codePoint < 0x80 ? 1 : ( codePoint < 0x800 ? 2 : ( codePoint < 0x10000 ? 3 : 4 ) );
+				static const unsigned char s_leadBits[] = { 0, 0x00, 0xC0, 0xE0, 0xF0 };
+
+				utf8 += static_cast<char>( s_leadBits[ length ] | ( codePoint >> ( 6 * ( length - 1 ) ) ) );
+				for ( size_t i = length - 1; i-- != 0; )
+					utf8 += static_cast<char>( 0x80 | ( ( codePoint >> ( 6 * i ) ) & 0x3F ) );
+			}
+			return utf8;
+		}
+
+		inline std::wstring RefToWide( const TString32& text32 )
+		{	// valid code points only: surrogate pairs with a 16-bit wchar_t
+			std::wstring wide;
+
+			for ( size_t i = 0; i != text32.length(); ++i )
+				if ( 2 == sizeof( wchar_t ) && text32[ i ] >= 0x10000 )
+				{
+					wide += static_cast<wchar_t>( 0xD800 + ( ( text32[ i ] - 0x10000 ) >> 10 ) );
+					wide += static_cast<wchar_t>( 0xDC00 + ( ( text32[ i ] - 0x10000 ) & 0x3FF ) );
+				}
+				else
+					wide += static_cast<wchar_t>( text32[ i ] );
+
+			return wide;
+		}
+
+
+		// the transcoder
+
+		inline TString32 ToUtf32( const std::string& utf8, size_t* pInvalidCount )
+		{
+			std::vector<char32_t> text32( utf8::GetMaxUtf32Count( utf8.length() ) + 1 );
+			text32.resize( utf8::ToUtf32( &text32[ 0 ], utf8.data(), utf8.length(), pInvalidCount ) );
+			return TString32( text32.begin(), text32.end() );
+		}
+
+		inline std::string FromUtf32( const TString32& text32, size_t* pInvalidCount )
+		{
+			std::vector<char> utf8( utf8::GetMaxUtf8CountOf32( text32.length() ) + 1 );
+			utf8.resize( utf8::FromUtf32( &utf8[ 0 ], text32.data(), text32.length(), pInvalidCount ) );
+			return std::string( utf8.begin(), utf8.end() );
+		}
+
+		inline std::wstring ToWide( const std::string& utf8, size_t* pInvalidCount )
+		{
+			std::vector<wchar_t> wide( utf8::GetMaxWideCount( utf8.length() ) + 1 );
+			wide.resize( utf8::ToWide( &wide[ 0 ], utf8.data(), utf8.length(), pInvalidCount ) );
+			return std::wstring( wide.begin(), wide.end() );
+		}
+
+		inline std::string FromWide( const std::wstring& wide, size_t* pInvalidCount )
+		{
+			std::vector<char> utf8( utf8::GetMaxUtf8Count( wide.length() ) + 1 );
+			utf8.resize( utf8::FromWide( &utf8[ 0 ], wide.data(), wide.length(), pInvalidCount ) );
+			return std::string( utf8.begin(), utf8.end() );
+		}
+
+
+		class CChecker
+		{
+		public:
+			CChecker( std::ostream& os ) : m_os( os ), m_checkCount( 0 ), m_failedCount( 0 ) {}
+
+			size_t GetCheckCount( void ) const { return m_checkCount; }
+			size_t GetFailedCount( void ) const { return m_failedCount; }
+
+			void CheckUtf8( const std::string& utf8 )
+			{	// decoding to UTF32 and to wide, and validation
+				size_t refInvalidCount, invalidCount, wideInvalidCount;
+				const TString32 refText32 = RefDecodeUtf8( utf8, &refInvalidCount );
+				const TString32 text32 = ToUtf32( utf8, &invalidCount );
+				const std::wstring wide = ToWide( utf8, &wideInvalidCount );
+
+				Check( text32 == refText32 && invalidCount == refInvalidCount, "ToUtf32", utf8 );
+				Check( wide == RefToWide( refText32 ) && wideInvalidCount == refInvalidCount, "ToWide", utf8 );
+				Check( utf8::IsValid( utf8.data(), utf8.length() ) == ( 0 == refInvalidCount ), "IsValid", utf8 );
+			}
+
+			void CheckUtf32( const TString32& text32 )
+			{	// encoding from UTF32, and from wide (valid code points only, since wchar_t can't hold all UTF32 values)
+				size_t refInvalidCount, invalidCount;
+				const std::string refUtf8 = RefEncodeUtf8( text32, &refInvalidCount );
+
+				Check( FromUtf32( text32, &invalidCount ) == refUtf8 && invalidCount == refInvalidCount, "FromUtf32", refUtf8 );
+
+				if ( 0 == refInvalidCount )
+					Check( FromWide( RefToWide( text32 ), &invalidCount ) == refUtf8 && 0 == invalidCount, "FromWide", refUtf8 );
+			}
+
+			void CheckUnpairedSurrogates( void )
+			{	// UTF16 only: a 32-bit wchar_t holds the surrogates as UTF32 values, covered by CheckUtf32()
+				static const wchar_t s_wide[] = { L'a', static_cast<wchar_t>( 0xD800 ), L'b', static_cast<wchar_t>( 0xDC00 ), static_cast<wchar_t>( 0xDE00 ), static_cast<wchar_t>( 0xD83D ), 0 };
+				size_t invalidCount;
+
+				Check( FromWide( s_wide, &invalidCount ) == "a\xEF\xBF\xBD" "b\xEF\xBF\xBD\xEF\xBF\xBD\xEF\xBF\xBD" && 4 == invalidCount, "FromWide surrogates", std::string() );
+			}
+		private:
+			void Check( bool succeeded, const char* pConversion, const std::string& utf8 )
+			{
+				++m_checkCount;
+				if ( succeeded )
+					return;
+
+				++m_failedCount;
+				m_os << "FAILED " << pConversion << ":";
+
+				static const char s_hexDigits[] = "0123456789ABCDEF";
+				for ( size_t i = 0; i != utf8.length(); ++i )
+					m_os << ' ' << s_hexDigits[ static_cast<unsigned char>( utf8[ i ] ) >> 4 ] << s_hexDigits[ utf8[ i ] & 0x0F ];
+
+				m_os << std::endl;
+			}
+		private:
+			std::ostream& m_os;
+			size_t m_checkCount;
+			size_t m_failedCount;
+		};
+
+
+		class CRandom		// xorshift32: the same sequence on every platform
+		{
+		public:
+			CRandom( unsigned int seed ) : m_state( seed != 0 ? seed : 1 ) {}
+
+			unsigned int Next( void ) { m_state ^= m_state << 13; m_state ^= m_state >> 17; m_state ^= m_state << 5; return m_state; }
+			unsigned int Next( unsigned int count ) { return Next() % count; }
+		private:
+			unsigned int m_state;
+		};
+
+
+		inline void CheckKnownSequences( CChecker& rChecker )
+		{
+			static const char* s_utf8[] =
+			{
+				"\x61\xF1\x80\x80\xE1\x80\xC2\x62\x80\x63\x80\xBF\x64",		// the maximal subpart example
+				"\xC0\xAF", "\xE0\x80\xAF", "\xF0\x80\x80\xAF",				// overlong '/'
+				"\xED\xA0\x80", "\xED\xBF\xBF", "\xED\x9F\xBF",					// surrogates, and the code point below
+				"\xF4\x90\x80\x80", "\xF4\x8F\xBF\xBF", "\xF0\x90\x80\x80",		// above U+10FFFF, the boundaries of the supplementary planes
+				"\xF5\x80", "\xFE\xFF", "\x80\xBF", "x\xE2\x82", "\xF0\x9F\x98!",
+				"Gr\xC3\xBC\xC3\x9F \xE4\xB8\x96\xE7\x95\x8C \xF0\x9F\x98\x80"	// 1, 2, 3 and 4 byte sequences
+			};
+
+			for ( size_t i = 0; i != sizeof( s_utf8 ) / sizeof( s_utf8[ 0 ] ); ++i )
+				rChecker.CheckUtf8( s_utf8[ i ] );
+
+			static const char32_t s_nonBmp[] = { 0x1F600, 0x10000, 0x10FFFF };		// truncated by a 16-bit conversion of a 32-bit wchar_t
+			rChecker.CheckUtf32( TString32( s_nonBmp, s_nonBmp + 3 ) );
+
+			if ( 2 == sizeof( wchar_t ) )
+				rChecker.CheckUnpairedSurrogates();
+		}
+
+		inline void CheckRandomInputs( CChecker& rChecker, unsigned int seed, size_t inputCount )
+		{
+			static const char* s_pieces[] =
+			{
+				"\x80", "\xBF", "\xC0\xAF", "\xC2", "\xC2\xA9", "\xE0\x80\x80", "\xE0\xA0\x80", "\xED\xA0\x80", "\xED\x9F\xBF",
+				"\xF0\x8F\xBF\xBF", "\xF0\x90\x80\x80", "\xF4\x8F\xBF\xBF", "\xF4\x90\x80\x80", "\xF5", "\xFF",
+				"\xE2\x82", "\xF0\x9F\x98", "\xF0\x9F\x98\x80", "\xC3\xA9", "\xE6\xBC\xA2\xE5\xAD\x97", "\xEF\xBF\xBD"
+			};
+			enum { PieceCount = sizeof( s_pieces ) / sizeof( s_pieces[ 0 ] ) };
+
+			CRandom random( seed );
+
+			for ( size_t input = 0; input != inputCount; ++input )
+				if ( input % 3 != 2 )
+				{	// UTF8: ASCII runs (some across the SIMD blocks), valid and invalid pieces, random bytes
+					std::string utf8;
+
+					for ( unsigned int count = random.Next( 30 ); count-- != 0; )
+						switch ( random.Next( 4 ) )
+						{
+							case 0:  utf8.append( 1 + random.Next( 40 ), static_cast<char>( 'a' + random.Next( 26 ) ) ); break;
+							case 1:  utf8 += static_cast<char>( random.Next( 256 ) ); break;
+							default: utf8 += s_pieces[ random.Next( PieceCount ) ];
+						}
+
+					rChecker.CheckUtf8( utf8 );
+				}
+				else
+				{	// UTF32: ASCII, BMP and supplementary code points, surrogates, values above U+10FFFF
+					TString32 text32;
+
+					for ( unsigned int count = random.Next( 60 ); count-- != 0; )
+						switch ( random.Next( 8 ) )
+						{
+							case 0:  text32 += static_cast<char32_t>( 0x80 + random.Next( 0xFF80 ) ); break;
+							case 1:  text32 += static_cast<char32_t>( random.Next( utf8::MaxCodePoint + 1 ) ); break;
+							case 2:  text32 += static_cast<char32_t>( 0xD800 + random.Next( 0x800 ) ); break;
+							case 3:  text32 += static_cast<char32_t>( utf8::MaxCodePoint + 1 + random.Next( 0xFFFF ) ); break;
+							default: text32 += static_cast<char32_t>( random.Next( 0x80 ) );
+						}
+
+					rChecker.CheckUtf32( text32 );
+				}
+		}
+
+
+		inline size_t Run( std::ostream& os, unsigned int seed, size_t randomCount )
+		{	// returns the failure count
+			CChecker checker( os );
+			bool oldSimd = utf8::EnableSimd( false );
+
+			for ( int simd = 0; simd != 2; ++simd )
+			{
+				utf8::EnableSimd( simd != 0 );		// no effect without SIMD support: the scalar codec runs twice
+
+				CheckKnownSequences( checker );
+				CheckRandomInputs( checker, seed, randomCount );
+			}
+
+			utf8::EnableSimd( oldSimd );
+
+			os << "UTF8 conformance: " << checker.GetCheckCount() << " checks, " << checker.GetFailedCount() << " failed" << std::endl;
+			return checker.GetFailedCount();
+		}
+	}
+}
+
+
+#endif // Utf8Conformance_h
@@ -0,0 +1,17 @@
+
+// Standalone driver of the UTF8 transcoder conformance suite, for non-Windows builds (not part of the UTL projects); from the utl directory:
+//	g++ -std=c++11 -O2 -msse2 -I. Utf8Transcoder.cpp test/Utf8ConformanceMain.cpp -o utf8_conformance && ./utf8_conformance [seed] [randomCount]
+// On Windows the same suite runs as CUtf8TranscoderTests::TestConformance.
+
+#include "test/Utf8Conformance.h"
+#include <cstdlib>
+#include <iostream>
+
+
+int main( int argc, char* argv[] )
+{
+	unsigned int seed = argc > 1 ? static_cast<unsigned int>( strtoul( argv[ 1 ], nullptr, 10 ) ) : 2024;
+	size_t randomCount = argc > 2 ? static_cast<size_t>( strtoul( argv[ 2 ], nullptr, 10 ) ) : 100000;
+
+	return ut::utf8_conform::Run( std::cout, seed, randomCount ) != 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,251 @@
+
+#include "pch.h"
+
+#ifdef USE_UT		// no UT code in release builds
+#include "test/Utf8TranscoderTests.h"
+#include "Utf8Transcoder.h"
+#include "test/Utf8Conformance.h"
+#include "Timer.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+
+namespace ut
+{
+	std::string ToUtf8( const std::wstring& wide, size_t* pInvalidCount = nullptr )
+	{
+		std::vector<char> utf8( utf8::GetMaxUtf8Count( wide.length() ) );
+		utf8.resize( utf8::FromWide( utl::Data( utf8 ), wide.c_str(), wide.length(), pInvalidCount ) );
+		return std::string( utf8.begin(), utf8.end() );
+	}
+
+	std::wstring FromUtf8( const std::string& utf8, size_t* pInvalidCount = nullptr )
+	{
+		std::vector<wchar_t> wide( utf8::GetMaxWideCount( utf8.length() ) );
+		wide.resize( utf8::ToWide( utl::Data( wide ), utf8.c_str(), utf8.length(), pInvalidCount ) );
+		return std::wstring( wide.begin(), wide.end() );
+	}
+
+	std::string ToUtf8( const str::wstring4& text32, size_t* pInvalidCount = nullptr )
+	{
+		std::vector<char> utf8( utf8::GetMaxUtf8CountOf32( text32.length() ) );
+		utf8.resize( utf8::FromUtf32( utl::Data( utf8 ), text32.c_str(), text32.length(), pInvalidCount ) );
+		return std::string( utf8.begin(), utf8.end() );
+	}
+
+	str::wstring4 ToUtf32( const std::string& utf8, size_t* pInvalidCount = nullptr )
+	{
+		std::vector<char32_t> text32( utf8::GetMaxUtf32Count( utf8.length() ) );
+		text32.resize( utf8::ToUtf32( utl::Data( text32 ), utf8.c_str(), utf8.length(), pInvalidCount ) );
+		return str::wstring4( text32.begin(), text32.end() );
+	}
+}
+
+
+CUtf8TranscoderTests::CUtf8TranscoderTests( void )
+{
+	ut::CTestSuite::Instance().RegisterTestCase( this );		// self-registration
+}
+
+CUtf8TranscoderTests& CUtf8TranscoderTests::Instance( void )
+{
+	static CUtf8TranscoderTests s_testCase;
+	return s_testCase;
+}
+
+void CUtf8TranscoderTests::TestRoundTrip( void )
+{
+	size_t invalidCount = utl::npos;
+
+	ASSERT_EQUAL( "", ut::ToUtf8( std::wstring(), &invalidCount ) );
+	ASSERT_EQUAL( 0, invalidCount );
+	ASSERT_EQUAL( L"", ut::FromUtf8( std::string() ) );
+
+	// 1, 2, 3 and 4 byte sequences (U+1F600 is a surrogate pair in UTF16)
+	const std::wstring wide = L"Gr\x00FC\x00DF Gott \x4E16\x754C \xD83D\xDE00 end";
+	const std::string utf8 = "Gr\xC3\xBC\xC3\x9F Gott \xE4\xB8\x96\xE7\x95\x8C \xF0\x9F\x98\x80 end";
+
+	ASSERT_EQUAL( utf8, ut::ToUtf8( wide, &invalidCount ) );
+	ASSERT_EQUAL( 0, invalidCount );
+	ASSERT_EQUAL( wide, ut::FromUtf8( utf8, &invalidCount ) );
+	ASSERT_EQUAL( 0, invalidCount );
+	ASSERT( utf8::IsValid( utf8.c_str(), utf8.length() ) );
+
+	// boundary code points
+	ASSERT_EQUAL( L"\xD7FF", ut::FromUtf8( "\xED\x9F\xBF" ) );
+	ASSERT_EQUAL( L"\xE000", ut::FromUtf8( "\xEE\x80\x80" ) );
+	ASSERT_EQUAL( L"\xFFFF", ut::FromUtf8( "\xEF\xBF\xBF" ) );
+	ASSERT_EQUAL( L"\xD800\xDC00", ut::FromUtf8( "\xF0\x90\x80\x80" ) );		// U+10000
+	ASSERT_EQUAL( L"\xDBFF\xDFFF", ut::FromUtf8( "\xF4\x8F\xBF\xBF" ) );		// U+10FFFF
+
+	// the string API
+	ASSERT_EQUAL( utf8, str::ToUtf8( wide.c_str() ) );
+	ASSERT_EQUAL( wide, str::FromUtf8( utf8.c_str() ) );
+	ASSERT_EQUAL( "Gr\xC3\xBC", str::ToUtf8( wide.c_str(), 3 ) );
+}
+
+void CUtf8TranscoderTests::TestInvalidUtf8( void )
+{
+	// each maximal invalid subpart is replaced by one U+FFFD (Unicode Standard, table 3-8); the UTF8 spans exclude the EOS
+	struct CInvalidCase { const char* m_pUtf8; size_t m_utf8Count; const wchar_t* m_pExpected; size_t m_invalidCount; };
+
+	static const CInvalidCase s_cases[] =
+	{
+		{ ARRAY_SPAN( "\x61\xF1\x80\x80\xE1\x80\xC2\x62\x80\x63\x80\xBF\x64" ) - 1, L"a\xFFFD\xFFFD\xFFFD" L"b\xFFFD" L"c\xFFFD\xFFFD" L"d", 6 },
+		{ ARRAY_SPAN( "\xC0\xAF" ) - 1, L"\xFFFD\xFFFD", 2 },					// overlong '/'
+		{ ARRAY_SPAN( "\xE0\x80\xAF" ) - 1, L"\xFFFD\xFFFD\xFFFD", 3 },			// overlong '/'
+		{ ARRAY_SPAN( "\xF0\x80\x80\xAF" ) - 1, L"\xFFFD\xFFFD\xFFFD\xFFFD", 4 },	// overlong '/'
+		{ ARRAY_SPAN( "\xED\xA0\x80" ) - 1, L"\xFFFD\xFFFD\xFFFD", 3 },			// encoded surrogate U+D800
+		{ ARRAY_SPAN( "\xF4\x90\x80\x80" ) - 1, L"\xFFFD\xFFFD\xFFFD\xFFFD", 4 },	// U+110000
+		{ ARRAY_SPAN( "\xF5\x80" ) - 1, L"\xFFFD\xFFFD", 2 },
+		{ ARRAY_SPAN( "\xFE\xFF" ) - 1, L"\xFFFD\xFFFD", 2 },
+		{ ARRAY_SPAN( "x\xE2\x82" ) - 1, L"x\xFFFD", 1 },						// truncated at end
+		{ ARRAY_SPAN( "\xF0\x9F\x98!" ) - 1, L"\xFFFD!", 1 },					// truncated by ASCII
+		{ ARRAY_SPAN( "\x80\xBF" ) - 1, L"\xFFFD\xFFFD", 2 }					// lone trail bytes
+	};
+
+	for ( size_t i = 0; i != COUNT_OF( s_cases ); ++i )
+	{
+		const std::string utf8( s_cases[ i ].m_pUtf8, s_cases[ i ].m_utf8Count );
+		size_t invalidCount = utl::npos;
+
+		ASSERT_EQUAL( s_cases[ i ].m_pExpected, ut::FromUtf8( utf8, &invalidCount ) );
+		ASSERT_EQUAL( s_cases[ i ].m_invalidCount, invalidCount );
+		ASSERT( !utf8::IsValid( utf8.c_str(), utf8.length() ) );
+	}
+}
+
+void CUtf8TranscoderTests::TestUnpairedSurrogates( void )
+{
+	size_t invalidCount = utl::npos;
+
+	ASSERT_EQUAL( "a\xEF\xBF\xBD" "b", ut::ToUtf8( L"a\xD800" L"b", &invalidCount ) );	// lone lead
+	ASSERT_EQUAL( 1, invalidCount );
+
+	ASSERT_EQUAL( "\xEF\xBF\xBDx", ut::ToUtf8( L"\xDC00x", &invalidCount ) );			// lone trail
+	ASSERT_EQUAL( 1, invalidCount );
+
+	ASSERT_EQUAL( "x\xEF\xBF\xBD", ut::ToUtf8( L"x\xD83D", &invalidCount ) );			// lead at end
+	ASSERT_EQUAL( 1, invalidCount );
+
+	ASSERT_EQUAL( "\xEF\xBF\xBD\xF0\x9F\x98\x80", ut::ToUtf8( L"\xD83D\xD83D\xDE00", &invalidCount ) );		// lead followed by a pair
+	ASSERT_EQUAL( 1, invalidCount );
+
+	ASSERT_EQUAL( "\xEF\xBF\xBD\xEF\xBF\xBD", ut::ToUtf8( L"\xDE00\xD83D", &invalidCount ) );				// reversed pair
+	ASSERT_EQUAL( 2, invalidCount );
+}
+
+void CUtf8TranscoderTests::TestUtf32( void )
+{
+	size_t invalidCount = utl::npos;
+
+	static const char32_t s_valid[] = { 0x41, 0x00E9, 0x4E16, 0x1F600, 0x10FFFF };
+	const str::wstring4 valid32( s_valid, END_OF( s_valid ) );
+	const std::string utf8 = "A\xC3\xA9\xE4\xB8\x96\xF0\x9F\x98\x80\xF4\x8F\xBF\xBF";
+
+	ASSERT_EQUAL( utf8, ut::ToUtf8( valid32, &invalidCount ) );
+	ASSERT_EQUAL( 0, invalidCount );
+	ASSERT( valid32 == ut::ToUtf32( utf8, &invalidCount ) );
+	ASSERT_EQUAL( 0, invalidCount );
+
+	static const char32_t s_invalid[] = { 0xD800, 0x110000, 0x42 };
+	ASSERT_EQUAL( "\xEF\xBF\xBD\xEF\xBF\xBD" "B", ut::ToUtf8( str::wstring4( s_invalid, END_OF( s_invalid ) ), &invalidCount ) );
+	ASSERT_EQUAL( 2, invalidCount );
+}
+
+void CUtf8TranscoderTests::TestSimdBlocks( void )
+{
+	// a non-ASCII character at every position of the 16-character blocks: the SIMD and scalar paths must agree, and round-trip
+	static const wchar_t* s_nonAscii[] = { L"\x00E9", L"\x4E16", L"\xD83D\xDE00" };
+
+	for ( size_t k = 0; k != COUNT_OF( s_nonAscii ); ++k )
+		for ( size_t pos = 0; pos != 40; ++pos )
+		{
+			std::wstring wide( 70, L'a' );
+			wide.insert( pos, s_nonAscii[ k ] );
+
+			str::wstring4 text32( 70, 'a' );
+			text32.insert( text32.begin() + pos, k != 2 ? static_cast<char32_t>( s_nonAscii[ k ][ 0 ] ) : 0x1F600 );
+
+			bool oldSimd = utf8::EnableSimd( false );
+			const std::string expectedUtf8 = ut::ToUtf8( wide );
+
+			utf8::EnableSimd( true );
+			ASSERT_EQUAL( expectedUtf8, ut::ToUtf8( wide ) );
+			ASSERT_EQUAL( wide, ut::FromUtf8( expectedUtf8 ) );
+			ASSERT_EQUAL( expectedUtf8, ut::ToUtf8( text32 ) );
+			ASSERT( text32 == ut::ToUtf32( expectedUtf8 ) );
+
+			utf8::EnableSimd( oldSimd );
+		}
+}
+
+void CUtf8TranscoderTests::TestConformance( void )
+{
+	std::ostringstream os;
+	size_t failedCount = ut::utf8_conform::Run( os, 2024, 20000 );
+
+	if ( failedCount != 0 )
+		TRACE( "%s", os.str().c_str() );
+
+	ASSERT_EQUAL( 0, failedCount );
+}
+
+void CUtf8TranscoderTests::TestThroughput( void )
+{
+	// benchmark: traces the UTF8 MB/s of each conversion, for ASCII and mixed text, with and without SIMD
+	enum { CharCount = 4 * 1024 * 1024 };
+
+	static const wchar_t s_ascii[] = L"The quick brown fox jumps over the lazy dog. ";
+	static const wchar_t s_mixed[] = L"Gr\x00FC\x00DF Gott, \x4E16\x754C, caf\x00E9. ";
+	static const wchar_t* s_corpusNames[] = { L"ASCII", L"mixed" };
+	const wchar_t* corpusTexts[] = { s_ascii, s_mixed };
+
+	for ( size_t corpus = 0; corpus != COUNT_OF( corpusTexts ); ++corpus )
+	{
+		std::wstring wide;
+		wide.reserve( CharCount );
+		while ( wide.length() < CharCount )
+			wide += corpusTexts[ corpus ];
+
+		std::string utf8;
+		std::wstring wideBack;
+
+		for ( int simd = 0; simd != 2; ++simd )
+		{
+			bool oldSimd = utf8::EnableSimd( simd != 0 );
+
+			CTimer timer;
+			utf8::FromWide( utf8, wide.c_str(), wide.length() );
+			double toUtf8Seconds = std::max( timer.ElapsedSeconds(), 0.001 );
+
+			timer.Restart();
+			utf8::ToWide( wideBack, utf8.c_str(), utf8.length() );
+			double fromUtf8Seconds = std::max( timer.ElapsedSeconds(), 0.001 );
+
+			utf8::EnableSimd( oldSimd );
+
+			ASSERT( wide == wideBack );
+
+			double megaBytes = double( utf8.length() ) / ( 1024 * 1024 );
+			UT_TRACE( str::Format( L"(%s %s: ToUtf8 %.0f MB/s, FromUtf8 %.0f MB/s)  ", s_corpusNames[ corpus ], simd != 0 ? L"SIMD" : L"scalar", megaBytes / toUtf8Seconds, megaBytes / fromUtf8Seconds ).c_str() );
+		}
+	}
+}
+
+
+void CUtf8TranscoderTests::Run( void )
+{
+	RUN_TEST( TestRoundTrip );
+	RUN_TEST( TestInvalidUtf8 );
+	RUN_TEST( TestUnpairedSurrogates );
+	RUN_TEST( TestUtf32 );
+	RUN_TEST( TestSimdBlocks );
+	RUN_TEST( TestConformance );
+	RUN_TEST( TestThroughput );
+}
+
+
+#endif //USE_UT
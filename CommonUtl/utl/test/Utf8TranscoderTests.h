@@ -0,0 +1,33 @@
+#ifndef Utf8TranscoderTests_h
+#define Utf8TranscoderTests_h
+#pragma once
+
+
+#ifdef USE_UT		// no UT code in release builds
+
+#include "UnitTest.h"
+
+
+class CUtf8TranscoderTests : public ut::CConsoleTestCase
+{
+	CUtf8TranscoderTests( void );
+public:
+	static CUtf8TranscoderTests& Instance( void );
+
+	// ut::ITestCase interface
+	virtual void Run( void );
+private:
+	void TestRoundTrip( void );
+	void TestInvalidUtf8( void );
+	void TestUnpairedSurrogates( void );
+	void TestUtf32( void );
+	void TestSimdBlocks( void );
+	void TestConformance( void );			// the portable suite of test/Utf8Conformance.h
+	void TestThroughput( void );			// benchmark
+};
+
+
+#endif //USE_UT
+
+
+#endif // Utf8TranscoderTests_h
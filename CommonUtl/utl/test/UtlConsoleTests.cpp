@@ -10,6 +10,7 @@
 #include "NumericTests.h"
 #include "LanguageTests.h"
 #include "EndiannessTests.h"
+#include "Utf8TranscoderTests.h"
 #include "EnvironmentTests.h"
 #include "LcsTests.h"
 #include "RegistryTests.h"
@@ -44,6 +45,7 @@ namespace ut
 		CNumericTests::Instance();
 		CLanguageTests::Instance();
 		CEndiannessTests::Instance();
+		CUtf8TranscoderTests::Instance();
 		CEnvironmentTests::Instance();
 		CLcsTests::Instance();
 		CRegistryTests::Instance();
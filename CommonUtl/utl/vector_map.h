@@ -3,6 +3,7 @@
 #pragma once
 
 #include <vector>
+#include <algorithm>
 #include <functional>
 
 
@@ -11,6 +12,7 @@ namespace utl
 	// Adapter for ordered container with an interface similar to std::map using a container with random access such as a std::vector, std::deque, etc.
 	// To be used as a replacement for std::map for containers of small number of items, i.e. for which map insertion/deletion/iteration overhead is not justified.
 	// It uses binary search assuming the container is ordered by KeyPred.
+	// Build large maps with Assign(), AssignUnsorted() or InsertRange(): these sort once, instead of O(N) element moves for each Insert().
 
 	template< typename Key, typename Value, typename KeyPred = std::less<Key>, typename Container = std::vector< std::pair<Key, Value> > >
 	class vector_map : public Container
@@ -45,11 +47,45 @@ namespace utl
 
 		template< typename Iterator >
 		void Assign( Iterator itFirst, Iterator itLast )
-		{
-			this->clear();
+		{	// bulk construction: sort and remove duplicates once, O(N*logN)
+			this->assign( itFirst, itLast );
+			SortUnique();
+		}
+
+		void AssignUnsorted( Container& rItems )
+		{	// bulk construction by taking over the items (swapped out of rItems)
+			this->swap( rItems );
+			rItems.clear();
+			SortUnique();
+		}
+
+		template< typename Iterator >
+		void InsertRange( Iterator itFirst, Iterator itLast )
+		{	// batch insert of unsorted pairs: same result as calling Insert() for each pair
+			vector_map batch( itFirst, itLast );
+			Merge( batch );
+		}
+
+		void Merge( const vector_map& batch )
+		{	// linear merge of a sorted batch: the batch values replace the values of existing keys
+			base_type merged;
+			const_iterator itThis = this->begin(), itBatch = batch.begin();
 
-			for ( ; itFirst != itLast; ++itFirst )
-				Insert( itFirst->first, itFirst->second );
+			while ( itThis != this->end() && itBatch != batch.end() )
+				if ( m_lessPred( itThis->first, itBatch->first ) )
+					merged.push_back( *itThis++ );
+				else if ( m_lessPred( itBatch->first, itThis->first ) )
+					merged.push_back( *itBatch++ );
+				else
+				{
+					merged.push_back( value_type( itThis->first, itBatch->second ) );		// keep the existing key, like Insert()
+					++itThis;
+					++itBatch;
+				}
+
+			merged.insert( merged.end(), itThis, const_iterator( this->end() ) );
+			merged.insert( merged.end(), itBatch, batch.end() );
+			this->swap( merged );
 		}
 
 		bool EraseKey( const Key& key )
@@ -125,6 +161,27 @@ namespace utl
 			return std::upper_bound( this->begin(), this->end(), value_type( key, Value() ), m_lessPred );
 		}
 	private:
+		void SortUnique( void )
+		{	// for equivalent keys keep the first key and the last value, like successive calls of Insert()
+			std::stable_sort( this->begin(), this->end(), m_lessPred );
+
+			iterator itOut = this->begin();
+			for ( iterator itRun = this->begin(); itRun != this->end(); ++itOut )
+			{
+				iterator itRunLast = itRun;
+				for ( iterator itNext = itRun + 1; itNext != this->end() && !m_lessPred( itRun->first, itNext->first ); ++itNext )
+					itRunLast = itNext;
+
+				if ( itOut != itRun )
+					itOut->first = itRun->first;
+				if ( itOut != itRunLast )
+					itOut->second = itRunLast->second;
+
+				itRun = itRunLast + 1;
+			}
+			this->erase( itOut, this->end() );
+		}
+
 		struct SafeKeyPred
 		{
 			bool operator()( const Key& left, const Key& right ) const
@@ -17,6 +17,7 @@
 #include "utl/test/StringTests.h"
 #include "utl/test/StringCompareTests.h"
 #include "test/CppCodeTests.h"
+#include "test/FormatterTests.h"
 #include "test/MethodPrototypeTests.h"
 
 #ifdef _DEBUG
@@ -39,6 +40,7 @@ namespace ut
 		ut::CTestSuite::Instance().RegisterTestCase( &CLanguageTests::Instance() );
 
 		CCppCodeTests::Instance();
+		CFormatterTests::Instance();
 		CMethodPrototypeTests::Instance();
 	#endif
 	}
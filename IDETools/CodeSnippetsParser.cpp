@@ -7,7 +7,9 @@
 #include "Application_fwd.h"
 #include "ModuleSession.h"
 #include "utl/FileSystem.h"
+#include "utl/MultiThreading.h"
 #include "utl/Path.h"
+#include "utl/StringCompare.h"
 #include "utl/TimeUtils.h"
 #include <fstream>
 
@@ -68,11 +70,32 @@ void CCodeSnippetsParser::Reset( void )
 	m_literals.push_back( std::make_pair( s_date, time_utl::FormatTimestamp( now, _T("%#d-%b-%Y") ) ) );
 
 	m_filePath.Clear();
-	m_sectionMap.clear();
+	m_snippets.Clear();
+}
+
+CCodeSnippetsParser::CCompiledCache& CCodeSnippetsParser::GetCompiledCache( void )
+{
+	static CCompiledCache s_compiledCache;
+	return s_compiledCache;
+}
+
+void CCodeSnippetsParser::ClearCompiledCache( void )
+{
+	GetCompiledCache().Clear();
 }
 
 void CCodeSnippetsParser::LoadFile( const fs::CPath& filePath ) throws_( CRuntimeException )
 {
+	CTime lastModifyTime = fs::ReadLastModifyTime( filePath );
+	UINT64 fileSize = fs::GetFileSize( filePath.GetPtr() );
+	CCompiledCache::TKey cacheKey( filePath, m_outLineEnd );		// the compiled content depends on the output line-end
+
+	if ( time_utl::IsValid( lastModifyTime ) && GetCompiledCache().Lookup( &m_snippets, cacheKey, lastModifyTime, fileSize ) )
+	{
+		m_filePath = filePath;
+		return;						// file not modified since compiled: skip parsing
+	}
+
 	m_pCtx.reset( new CParsingContext() );
 
 	std::ifstream input( filePath.GetPtr(), std::ios_base::in );	// | std::ios_base::binary
@@ -81,17 +104,24 @@ void CCodeSnippetsParser::LoadFile( const fs::CPath& filePath ) throws_( CRuntim
 
 	m_filePath = filePath;
 	ParseStream( input );
+
+	if ( time_utl::IsValid( lastModifyTime ) )
+		GetCompiledCache().Store( cacheKey, lastModifyTime, fileSize, m_snippets );
+	else
+		GetCompiledCache().Remove( cacheKey );
 }
 
 void CCodeSnippetsParser::ParseStream( std::istream& is ) throws_( CRuntimeException )
 {
-	m_sectionMap.clear();
+	m_snippets.Clear();
 
 	if ( nullptr == m_pCtx.get() )
 		m_pCtx.reset( new CParsingContext() );
 
 	for ( std::string line; std::getline( is, line ); ++m_pCtx->m_lineNo )
 		ParseLine( str::FromUtf8( line.c_str() ) );
+
+	CompileSections();
 }
 
 void CCodeSnippetsParser::ParseLine( const std::tstring& line )
@@ -151,9 +181,15 @@ void CCodeSnippetsParser::EnterSection( const std::tstring& sectionName ) throws
 											  m_pCtx->m_sectionName.c_str(), sectionName.c_str(), m_filePath.GetPtr(), m_pCtx->m_lineNo ) );
 
 	m_pCtx->m_sectionName = sectionName;
-	m_pCtx->m_pSectionContent = &m_sectionMap[ sectionName ];		// enter section content parsing mode
+	m_pCtx->m_sectionIndex = FindSectionIndex( sectionName );		// enter section content parsing mode
 
-	if ( !m_pCtx->m_pSectionContent->empty() )						// not a new entry? => section collision
+	if ( utl::npos == m_pCtx->m_sectionIndex )
+	{
+		m_pCtx->m_sectionIndex = m_snippets.m_sections.size();
+		m_snippets.m_sections.push_back( CSection( sectionName ) );
+		m_snippets.m_sectionIndexes[ sectionName ] = m_pCtx->m_sectionIndex;
+	}
+	else if ( !m_snippets.m_sections[ m_pCtx->m_sectionIndex ].m_content.empty() )	// not a new entry? => section collision
 		throw CRuntimeException( str::Format( _T("Syntax error: duplicate section '%s' found in compound text file '%s' at line %d"),
 											  sectionName.c_str(), m_filePath.GetPtr(), m_pCtx->m_lineNo ) );
 }
@@ -165,17 +201,19 @@ void CCodeSnippetsParser::ExitCurrentSection( void ) throws_( CRuntimeException
 											  m_filePath.GetPtr(), m_pCtx->m_lineNo ) );
 
 	m_pCtx->m_sectionName.clear();
-	m_pCtx->m_pSectionContent = nullptr;		// exit section content parsing mode
+	m_pCtx->m_sectionIndex = utl::npos;		// exit section content parsing mode
 }
 
 void CCodeSnippetsParser::AddTextContent( TConstIterator itFirst, TConstIterator itLast, bool fullLine )
 {
 	ASSERT( InSection() );
 
-	m_pCtx->m_pSectionContent->insert( m_pCtx->m_pSectionContent->end(), itFirst, itLast );		// append text content
+	std::tstring& rSectionContent = m_snippets.m_sections[ m_pCtx->m_sectionIndex ].m_content;
+
+	rSectionContent.insert( rSectionContent.end(), itFirst, itLast );		// append text content
 
 	if ( fullLine )
-		*m_pCtx->m_pSectionContent += m_outLineEnd;
+		rSectionContent += m_outLineEnd;
 }
 
 
@@ -221,9 +259,69 @@ void CCodeSnippetsParser::UpdateFilePathLiterals( void )
 	LookupLiteralValue( _T("%PCH%") ) = pchFilePath.GetFname();
 }
 
+size_t CCodeSnippetsParser::ExpandLiterals( IN OUT std::tstring* pOutput ) const
+{	// replace in registration order: a literal value may contain the keys of literals registered after it
+	ASSERT_PTR( pOutput );
+	size_t count = 0;
+
+	for ( std::vector<TLiteralPair>::const_iterator itLiteral = m_literals.begin(); itLiteral != m_literals.end(); ++itLiteral )
+		if ( !itLiteral->first.empty() )
+			count += str::Replace( *pOutput, itLiteral->first.c_str(), itLiteral->second.c_str() );
+
+	return count;
+}
+
+size_t CCodeSnippetsParser::FindSectionIndex( const std::tstring& sectionName ) const
+{
+	std::unordered_map<std::tstring, size_t>::const_iterator itFound = m_snippets.m_sectionIndexes.find( sectionName );
+	return itFound != m_snippets.m_sectionIndexes.end() ? itFound->second : utl::npos;
+}
+
 const std::tstring* CCodeSnippetsParser::FindSection( const std::tstring& sectionName ) const
 {
-	return utl::FindValuePtr( m_sectionMap, sectionName );
+	size_t sectionIndex = FindSectionIndex( sectionName );
+	return sectionIndex != utl::npos ? &m_snippets.m_sections[ sectionIndex ].m_content : nullptr;
+}
+
+
+// compile sections into token streams:
+
+void CCodeSnippetsParser::CompileSections( void )
+{
+	for ( std::vector<CSection>::iterator itSection = m_snippets.m_sections.begin(); itSection != m_snippets.m_sections.end(); ++itSection )
+		CompileSection( *itSection );
+}
+
+void CCodeSnippetsParser::CompileSection( CSection& rSection )
+{	// tokenize embedded sections such as "<<Section X>>" or "<<?Section X>>$", and the text between
+	const std::tstring& content = rSection.m_content;
+	TParser::TSepMatchPos sepMatchPos;
+	size_t textPos = 0;
+
+	rSection.m_tokens.clear();
+
+	for ( TParser::TSpecPair specBounds( 0, 0 );
+		  ( specBounds = m_crossRefParser.FindItemSpec( &sepMatchPos, content, specBounds.second ) ).first != std::tstring::npos; )
+	{	// found an embedded "<<Section>>" spec
+		if ( textPos != specBounds.first )
+			rSection.m_tokens.push_back( CToken( CToken::Text, textPos, specBounds.first - textPos ) );
+
+		Range<size_t> itemRange = m_crossRefParser.GetItemRange( sepMatchPos, specBounds );
+		bool conditional = s_conditionalPrompt == str::CharAt( content, itemRange.m_start );
+
+		if ( conditional )
+			++itemRange.m_start;		// strip the '?' prefix (conditional sections)
+
+		CToken refToken( CToken::SectionRef, itemRange.m_start, itemRange.GetSpan<size_t>(), FindSectionIndex( m_crossRefParser.MakeItem( itemRange, content ) ) );
+		refToken.m_conditional = conditional;
+		rSection.m_tokens.push_back( refToken );
+
+		CheckEatLineEnd( &specBounds.second, content.c_str() );		// do we have a '$' suffix, such as "<<Section>>$"?
+		textPos = specBounds.second;
+	}
+
+	if ( textPos != content.length() )
+		rSection.m_tokens.push_back( CToken( CToken::Text, textPos, content.length() - textPos ) );
 }
 
 
@@ -231,13 +329,18 @@ const std::tstring* CCodeSnippetsParser::FindSection( const std::tstring& sectio
 
 std::tstring CCodeSnippetsParser::ExpandSection( const std::tstring& sectionName ) throws_( CRuntimeException )
 {
-	if ( std::tstring* pTextContent = ExpandSectionRefs( sectionName ) )
-	{
-		ExpandLiterals( pTextContent );
-		return *pTextContent;
-	}
+	size_t sectionIndex = FindSectionIndex( sectionName );
+	if ( utl::npos == sectionIndex )
+		return str::GetEmpty();
+
+	std::tstring output;
+	output.reserve( EstimateExpandedLength( sectionIndex ) );
+
+	AppendSection( &output, sectionIndex, 0 );
 
-	return str::GetEmpty();
+	UpdateFilePathLiterals();
+	ExpandLiterals( &output );
+	return output;
 }
 
 bool CCodeSnippetsParser::ExpandSection( OUT std::tstring* pSectionContent, const std::tstring& sectionName ) throws_( CRuntimeException )
@@ -250,50 +353,47 @@ bool CCodeSnippetsParser::ExpandSection( OUT std::tstring* pSectionContent, cons
 	return true;
 }
 
-size_t CCodeSnippetsParser::ExpandLiterals( OUT std::tstring* pSectionContent )
-{
-	ASSERT_PTR( pSectionContent );
-	UpdateFilePathLiterals();
+size_t CCodeSnippetsParser::EstimateExpandedLength( size_t sectionIndex ) const
+{	// reserve for the section text and its directly referenced sections
+	const CSection& section = m_snippets.m_sections[ sectionIndex ];
+	size_t length = section.m_content.length();
 
-	size_t count = 0;
+	for ( std::vector<CToken>::const_iterator itToken = section.m_tokens.begin(); itToken != section.m_tokens.end(); ++itToken )
+		if ( CToken::SectionRef == itToken->m_kind && itToken->m_index != utl::npos )
+			length += m_snippets.m_sections[ itToken->m_index ].m_content.length();
 
-	for ( std::vector<TLiteralPair>::const_iterator itLiteral = m_literals.begin(); itLiteral != m_literals.end(); ++itLiteral )
-		count += str::Replace( *pSectionContent, itLiteral->first.c_str(), itLiteral->second.c_str() );
-
-	return count;
+	return length;
 }
 
-std::tstring* CCodeSnippetsParser::ExpandSectionRefs( const std::tstring& sectionName ) throws_( CRuntimeException )
-{	// expand embedded sections such as "<<Section X>>", returns the expanded section content
-	std::tstring* pTextContent = utl::FindValuePtr( m_sectionMap, sectionName );
-
-	if ( nullptr == pTextContent )
-		return nullptr;
-
-	TParser::TSepMatchPos sepMatchPos;
-
-	for ( TParser::TSpecPair specBounds( 0, 0 );
-		  ( specBounds = m_crossRefParser.FindItemSpec( &sepMatchPos, *pTextContent, specBounds.second ) ).first != std::tstring::npos;
-		  specBounds.first = specBounds.second )
-	{	// found an embedded "<<Section>>" spec
-		std::tstring refSectionName = m_crossRefParser.ExtractItem( sepMatchPos, specBounds, *pTextContent );
+void CCodeSnippetsParser::AppendSection( IN OUT std::tstring* pOutput, size_t sectionIndex, size_t depth ) const throws_( CRuntimeException )
+{
+	ASSERT_PTR( pOutput );
 
-		const std::tstring* pRefContent = PromptConditionalSectionRef( &refSectionName )		// it strips the '?' prefix if present (conditional sections)
-			? ExpandSectionRefs( refSectionName )
-			: &str::GetEmpty();
+	const CSection& section = m_snippets.m_sections[ sectionIndex ];
 
-		if ( nullptr == pRefContent )
-			throw CRuntimeException( str::Format( _T("Cross-referenced section '%s' in section '%s' not found in compound text file '%s'"),
-												  refSectionName.c_str(), sectionName.c_str(), m_filePath.GetPtr() ) );
+	if ( depth > s_maxRefDepth )
+		throw CRuntimeException( str::Format( _T("Circular cross-reference of section '%s' in compound text file '%s'"),
+											  section.m_name.c_str(), m_filePath.GetPtr() ) );
 
-		CheckEatLineEnd( &specBounds.second, pTextContent->c_str() );		// do we have a '$' suffix, such as "<<Section>>$"?
+	for ( std::vector<CToken>::const_iterator itToken = section.m_tokens.begin(); itToken != section.m_tokens.end(); ++itToken )
+		switch ( itToken->m_kind )
+		{
+			case CToken::Text:
+				pOutput->append( section.m_content, itToken->m_pos, itToken->m_length );
+				break;
+			case CToken::SectionRef:
+			{
+				std::tstring refSectionName = section.m_content.substr( itToken->m_pos, itToken->m_length );
 
-		// replace the entire spec "<<RefSection>>" with the embedded section content
-		pTextContent->replace( specBounds.first, specBounds.second - specBounds.first, *pRefContent );
+				if ( utl::npos == itToken->m_index )
+					throw CRuntimeException( str::Format( _T("Cross-referenced section '%s' in section '%s' not found in compound text file '%s'"),
+														  refSectionName.c_str(), section.m_name.c_str(), m_filePath.GetPtr() ) );
 
-		specBounds.second = specBounds.first + pRefContent->length();		// adjust span to the new expanded content
-	}
-	return pTextContent;
+				if ( !itToken->m_conditional || PromptConditionalSectionRef( refSectionName ) )
+					AppendSection( pOutput, itToken->m_index, depth + 1 );
+				break;
+			}
+		}
 }
 
 bool CCodeSnippetsParser::CheckEatLineEnd( IN OUT size_t* pLastPos, const TCHAR* pContent )
@@ -316,23 +416,64 @@ bool CCodeSnippetsParser::CheckEatLineEnd( IN OUT size_t* pLastPos, const TCHAR*
 	return true;
 }
 
-bool CCodeSnippetsParser::PromptConditionalSectionRef( IN OUT std::tstring* pRefSectionName ) const
+bool CCodeSnippetsParser::PromptConditionalSectionRef( const std::tstring& refSectionName ) const
+{	// conditional section such as "<<?Section>>": prompt on each expansion
+	std::tstring message = str::Format( _T("Do you want to include section '%s'?"), refSectionName.c_str() );
+	const std::tstring* pRefContent = FindSection( refSectionName );
+
+	ide::CScopedWindow scopedIDE;
+	CCodeMessageBox dlg( message, pRefContent != nullptr ? *pRefContent : str::GetEmpty(), MB_OKCANCEL | MB_ICONQUESTION, scopedIDE.GetMainWnd() );
+
+	return IDOK == dlg.DoModal();
+}
+
+
+// CCodeSnippetsParser::CCompiledCache implementation
+
+bool CCodeSnippetsParser::CCompiledCache::Lookup( OUT CSnippets* pSnippets, const TKey& key, const CTime& modifyTime, UINT64 fileSize )
 {
-	ASSERT_PTR( pRefSectionName );
+	ASSERT_PTR( pSnippets );
+	mt::CAutoLock lock( &m_cs );
 
-	if ( s_conditionalPrompt == str::CharAt( *pRefSectionName, 0 ) )
-	{
-		pRefSectionName->erase( pRefSectionName->begin() );		// strip the '?'
+	std::map<TKey, CEntry>::iterator itFound = m_entries.find( key );
+	if ( m_entries.end() == itFound || itFound->second.m_modifyTime != modifyTime || itFound->second.m_fileSize != fileSize )
+		return false;
 
-		std::tstring message = str::Format( _T("Do you want to include section '%s'?"), pRefSectionName->c_str() );
-		std::tstring refContent = utl::FindValue( m_sectionMap, *pRefSectionName );
+	itFound->second.m_useTick = ++m_useTick;
+	*pSnippets = itFound->second.m_snippets;
+	return true;
+}
 
-		ide::CScopedWindow scopedIDE;
-		CCodeMessageBox dlg( message, refContent, MB_OKCANCEL | MB_ICONQUESTION, scopedIDE.GetMainWnd() );
+void CCodeSnippetsParser::CCompiledCache::Store( const TKey& key, const CTime& modifyTime, UINT64 fileSize, const CSnippets& snippets )
+{
+	mt::CAutoLock lock( &m_cs );
+
+	if ( m_entries.size() >= s_maxEntries && m_entries.find( key ) == m_entries.end() )
+	{	// evict the least recently used entry
+		std::map<TKey, CEntry>::iterator itOldest = m_entries.begin();
+
+		for ( std::map<TKey, CEntry>::iterator itEntry = m_entries.begin(); itEntry != m_entries.end(); ++itEntry )
+			if ( itEntry->second.m_useTick < itOldest->second.m_useTick )
+				itOldest = itEntry;
 
-		if ( dlg.DoModal() != IDOK )
-			return false;
+		m_entries.erase( itOldest );
 	}
 
-	return true;
+	CEntry& rEntry = m_entries[ key ];
+	rEntry.m_modifyTime = modifyTime;
+	rEntry.m_fileSize = fileSize;
+	rEntry.m_useTick = ++m_useTick;
+	rEntry.m_snippets = snippets;
+}
+
+void CCodeSnippetsParser::CCompiledCache::Remove( const TKey& key )
+{
+	mt::CAutoLock lock( &m_cs );
+	m_entries.erase( key );
+}
+
+void CCodeSnippetsParser::CCompiledCache::Clear( void )
+{
+	mt::CAutoLock lock( &m_cs );
+	m_entries.clear();
 }
@@ -7,21 +7,27 @@
 #include "utl/StringParsing.h"
 #include "CodeUtils.h"
 #include <map>
+#include <unordered_map>
 
 
+// Parses a compound snippets file of "[[Section]]...[[EOS]]" entries.
+// Sections are compiled once into token streams of text and section-ref nodes with resolved indexes:
+// expansion is a linear concatenation into a reserved buffer, without re-scanning the section text; literals are then replaced in registration order.
+// The compiled form of a snippets file is cached by file path and output line-end, and reused while the file's size and last modify time are unchanged.
+//
 class CCodeSnippetsParser
 {
 public:
 	CCodeSnippetsParser( const TCHAR* pOutLineEnd = code::g_pLineEnd );
 	~CCodeSnippetsParser();
 
-	bool IsEmpty( void ) const { return m_sectionMap.empty(); }
+	bool IsEmpty( void ) const { return m_snippets.m_sections.empty(); }
 	void Reset( void );
 
 	void LoadFile( const fs::CPath& filePath ) throws_( CRuntimeException );
 	void ParseStream( std::istream& is ) throws_( CRuntimeException );
 
-	// literals: pairs of keys to values, e.g. "%FileName%" -> "StripBar"
+	// literals: pairs of keys to values, e.g. "%FileName%" -> "StripBar"; replaced in the expanded text in registration order
 	const std::tstring* FindLiteralValue( const std::tstring& literalKey ) const;	// e.g. "%FileName%"
 	std::tstring& LookupLiteralValue( const std::tstring& literalKey );				// for registration
 
@@ -33,6 +39,8 @@ public:
 	const std::tstring* FindSection( const std::tstring& sectionName ) const;
 	std::tstring ExpandSection( const std::tstring& sectionName ) throws_( CRuntimeException );
 	bool ExpandSection( OUT std::tstring* pSectionContent, const std::tstring& sectionName ) throws_( CRuntimeException );
+
+	static void ClearCompiledCache( void );
 private:
 	typedef std::tstring::const_iterator TConstIterator;
 
@@ -43,33 +51,102 @@ private:
 	};
 
 	void ParseLine( const std::tstring& line ) throws_( CRuntimeException );
-	bool InSection( void ) const { ASSERT_PTR( m_pCtx.get() ); return m_pCtx->m_pSectionContent != nullptr; }
+	bool InSection( void ) const { ASSERT_PTR( m_pCtx.get() ); return m_pCtx->m_sectionIndex != utl::npos; }
 	void EnterSection( const std::tstring& sectionName ) throws_( CRuntimeException );
 	void ExitCurrentSection( void ) throws_( CRuntimeException );
 	void AddTextContent( TConstIterator itFirst, TConstIterator itLast, bool fullLine );
 	void AddTextContentLine( const std::tstring& line ) { AddTextContent( line.begin(), line.end(), true ); }
 
-	size_t ExpandLiterals( OUT std::tstring* pSectionContent );
+	size_t FindSectionIndex( const std::tstring& sectionName ) const;
 	void UpdateFilePathLiterals( void );
+	size_t ExpandLiterals( IN OUT std::tstring* pOutput ) const;
 
-	std::tstring* ExpandSectionRefs( const std::tstring& sectionName ) throws_( CRuntimeException );
-	bool PromptConditionalSectionRef( IN OUT std::tstring* pRefSectionName ) const;
+	bool PromptConditionalSectionRef( const std::tstring& refSectionName ) const;
 
 	static bool CheckEatLineEnd( IN OUT size_t* pLastPos, const TCHAR* pContent );		// if '$' suffix => skip the following "\r\n" (or just "\n")
 
 
+	struct CToken
+	{
+		enum Kind { Text, SectionRef };
+
+		CToken( Kind kind, size_t pos, size_t length, size_t index = utl::npos ) : m_kind( kind ), m_pos( pos ), m_length( length ), m_index( index ), m_conditional( false ) {}
+	public:
+		Kind m_kind;
+		size_t m_pos;				// range in section content: text, or referenced section name
+		size_t m_length;
+		size_t m_index;				// SectionRef: referenced section index (utl::npos if missing)
+		bool m_conditional;			// SectionRef: "<<?Section>>"
+	};
+
+
+	struct CSection
+	{
+		CSection( const std::tstring& name ) : m_name( name ) {}
+	public:
+		std::tstring m_name;
+		std::tstring m_content;				// raw text, as parsed
+		std::vector<CToken> m_tokens;		// compiled content
+	};
+
+
+	// compiled form of a snippets file
+	struct CSnippets
+	{
+		void Clear( void ) { m_sections.clear(); m_sectionIndexes.clear(); }
+	public:
+		std::vector<CSection> m_sections;
+		std::unordered_map<std::tstring, size_t> m_sectionIndexes;		// section name -> index
+	};
+
+
+	// compiled snippets files, shared by all parsers; thread safe
+	class CCompiledCache : private utl::noncopyable
+	{
+	public:
+		typedef std::pair<fs::CPath, std::tstring> TKey;				// <file path, output line-end>
+
+		CCompiledCache( void ) : m_useTick( 0 ) {}
+
+		bool Lookup( OUT CSnippets* pSnippets, const TKey& key, const CTime& modifyTime, UINT64 fileSize );
+		void Store( const TKey& key, const CTime& modifyTime, UINT64 fileSize, const CSnippets& snippets );
+		void Remove( const TKey& key );
+		void Clear( void );
+	private:
+		struct CEntry
+		{
+			CTime m_modifyTime;
+			UINT64 m_fileSize;
+			UINT m_useTick;						// for evicting the least recently used entry
+			CSnippets m_snippets;
+		};
+	private:
+		CCriticalSection m_cs;
+		std::map<TKey, CEntry> m_entries;
+		UINT m_useTick;
+
+		static const size_t s_maxEntries = 16;
+	};
+
+	static CCompiledCache& GetCompiledCache( void );
+
+	void CompileSections( void );
+	void CompileSection( CSection& rSection );
+
+	size_t EstimateExpandedLength( size_t sectionIndex ) const;
+	void AppendSection( IN OUT std::tstring* pOutput, size_t sectionIndex, size_t depth ) const throws_( CRuntimeException );
+
 	struct CParsingContext
 	{
-		CParsingContext( void ) : m_lineNo( 1 ), m_pSectionContent( nullptr ) {}
+		CParsingContext( void ) : m_lineNo( 1 ), m_sectionIndex( utl::npos ) {}
 	public:
 		size_t m_lineNo;
 		std::tstring m_sectionName;				// current section being parsed
-		std::tstring* m_pSectionContent;		// content of the current section
+		size_t m_sectionIndex;					// index of the current section
 	};
 private:
 	typedef str::CEnclosedParser<TCHAR> TParser;
 	typedef std::pair<std::tstring, std::tstring> TLiteralPair;		// <name, value>
-	typedef std::map<std::tstring, std::tstring> TSectionMap;
 
 	std::tstring m_outLineEnd;				// for output formatting (may be different for testing)
 	const TParser m_sectionParser;			// for "[[section]]" tags
@@ -78,11 +155,13 @@ private:
 	std::auto_ptr<CParsingContext> m_pCtx;
 
 	fs::CPath m_filePath;
-	TSectionMap m_sectionMap;				// sections: name -> content
+	CSnippets m_snippets;					// compiled sections
 private:
 	static const std::tstring s_endOfSection;				// "EOS" => "[[EOS]]" tags in the compound text file
 	static const TCHAR s_conditionalPrompt = _T('?');		// e.g. "<<?Section>>"
 	static const TCHAR s_eatLineEnd = _T('$');				// e.g. "<<Section>>$\r\n" => eat next "\r\n"
+	static const TCHAR s_literalSep = _T('%');				// e.g. "%FileName%"
+	static const size_t s_maxRefDepth = 64;					// deeper nesting of section cross-references is a reference cycle
 
 	// predefined literals
 	static const std::tstring s_year;		// "%YEAR%"  -> "2023"
@@ -37,6 +37,7 @@ CCppParser::CCppParser( void )
 CCppCodeParser::CCppCodeParser( const std::tstring* pCodeText )
 	: CCppParser()
 	, m_codeText( *safe_ptr( pCodeText ) )
+	, m_skipMap( m_lang, m_codeText )
 	, m_length( static_cast<TPos>( m_codeText.length() ) )
 	, m_itBegin( m_codeText.begin() )
 	, m_itEnd( m_codeText.end() )
@@ -48,12 +49,11 @@ CCppCodeParser::TPos CCppCodeParser::FindPosNextSequence( TPos pos, const std::t
 	ASSERT( IsValidPos( pos ) );
 	ASSERT( !sequence.empty() );
 
-	TConstIterator itFound = m_lang.FindNextSequence( m_itBegin + pos, m_itEnd, sequence );
+	TPos foundPos = static_cast<TPos>( m_skipMap.FindNextSequence( pos, sequence ) );
 
-	if ( m_itEnd == itFound )
+	if ( m_length == foundPos )
 		return -1;
 
-	TPos foundPos = pvt::Distance( m_itBegin, itFound );
 	ENSURE( IsValidPos( foundPos ) );
 	return foundPos;
 }
@@ -74,12 +74,12 @@ bool CCppCodeParser::FindNextSequence( OUT TokenRange* pSeqRange, TPos pos, cons
 CCppCodeParser::TPos CCppCodeParser::FindPosMatchingBracket( TPos bracketPos ) const
 {
 	ASSERT( IsValidPos( bracketPos ) );
-	TConstIterator itCloseBracket = m_lang.FindMatchingBracket( m_itBegin + bracketPos, m_itEnd );
+	TPos closeBracketPos = static_cast<TPos>( m_skipMap.FindMatchingBracket( bracketPos ) );
 
-	if ( m_itEnd == itCloseBracket )
+	if ( m_length == closeBracketPos )
 		return -1;
 
-	return pvt::Distance( m_itBegin, itCloseBracket );
+	return closeBracketPos;
 }
 
 bool CCppCodeParser::SkipPosPastMatchingBracket( IN OUT TPos* pBracketPos ) const
@@ -87,12 +87,12 @@ bool CCppCodeParser::SkipPosPastMatchingBracket( IN OUT TPos* pBracketPos ) cons
 	ASSERT_PTR( pBracketPos );
 	ASSERT( IsValidPos( *pBracketPos ) );
 
-	TConstIterator it = m_itBegin + *pBracketPos;
+	size_t pos = *pBracketPos;
 
-	if ( !m_lang.SkipPastMatchingBracket( &it, m_itEnd ) )
+	if ( !m_skipMap.SkipPastMatchingBracket( &pos ) )
 		return false;
 
-	*pBracketPos = pvt::Distance( m_itBegin, it );
+	*pBracketPos = static_cast<TPos>( pos );
 	return true;
 }
 
@@ -101,19 +101,19 @@ bool CCppCodeParser::FindArgList( OUT TokenRange* pArgList, TPos pos, TCHAR open
 	ASSERT_PTR( pArgList );
 	ASSERT( IsValidPos( pos ) );
 
-	TConstIterator itOpenBracket = s_anyBracket == openBracket
-		? m_lang.FindNextCharThat( m_itBegin + pos, m_itEnd, pred::IsBracket() )
-		: m_lang.FindNextCharThat( m_itBegin + pos, m_itEnd, pred::IsChar<>( openBracket ) );
+	size_t openBracketPos = s_anyBracket == openBracket
+		? m_skipMap.FindNextCharThat( pos, pred::IsBracket() )
+		: m_skipMap.FindNextCharThat( pos, pred::IsChar<>( openBracket ) );
 
-	if ( itOpenBracket == m_itEnd )
+	if ( openBracketPos == m_codeText.length() )
 		return false;				// no opening bracket found
 
-	TConstIterator it = itOpenBracket;
+	size_t endPos = openBracketPos;
 
-	if ( !m_lang.SkipPastMatchingBracket( &it, m_itEnd ) )
+	if ( !m_skipMap.SkipPastMatchingBracket( &endPos ) )
 		return false;				// no matching closing bracket found
 
-	*pArgList = pvt::MakeTokenRange( Range<TConstIterator>( itOpenBracket, it ), m_itBegin );
+	pArgList->SetRange( static_cast<TPos>( openBracketPos ), static_cast<TPos>( endPos ) );
 	return true;
 }
 
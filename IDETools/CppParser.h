@@ -64,7 +64,7 @@ public:
 };
 
 
-class CCppCodeParser : public CCppParser		// parsing methods on a given code string (by reference)
+class CCppCodeParser : public CCppParser		// parsing methods on a given code string (by reference); comments and quoted strings are lexed once, in the constructor
 {
 public:
 	typedef int TPos;
@@ -89,6 +89,7 @@ public:
 	bool SkipMatchingToken( IN OUT TPos* pPos, const std::tstring& token );
 private:
 	const std::tstring& m_codeText;
+	const code::CCodeSkipMap<TCHAR> m_skipMap;		// repeated searches jump over comments and quoted strings
 public:
 	const TPos m_length;
 	TConstIterator m_itBegin;
@@ -78,16 +78,40 @@ namespace code
 	{
 		resetInternalState();
 
-		std::vector<CString> linesOfCode, lineEnds;
+		CString outCodeText;
 
-		// break the code into lines
-		splitMultipleLines( linesOfCode, lineEnds, pCodeText );
+		if ( str::IsEmpty( pCodeText ) )
+			return outCodeText;
 
-		// format each line
-		for ( std::vector<CString>::iterator itLineOfCode = linesOfCode.begin(); itLineOfCode != linesOfCode.end(); ++itLineOfCode )
-			*itLineOfCode = formatLineOfCode( *itLineOfCode, protectLeadingWhiteSpace, justAdjustWhiteSpace );
+		// single pass: scan the lines in place and append each formatted line with its line end to one output buffer (same line splitting as splitMultipleLines)
+		const int codeLength = str::Length( pCodeText );
+		const int lineEndLength = str::Length( code::g_pLineEnd );
 
-		return unsplitMultipleLines( linesOfCode, lineEnds );
+		outCodeText.Preallocate( codeLength + codeLength / 8 );		// headroom for the inserted spaces
+
+		for ( const TCHAR* pLineStart = pCodeText; ; )
+		{
+			const TCHAR* pLineEnd = _tcsstr( pLineStart, code::g_pLineEnd );
+
+			if ( nullptr == pLineEnd )
+			{	// last line, without line end
+				appendFormattedLineOfCode( outCodeText, pLineStart, str::Length( pLineStart ), protectLeadingWhiteSpace, justAdjustWhiteSpace );
+				break;
+			}
+
+			const TCHAR* pCodeEnd = pLineEnd;
+
+			if ( pLineEnd - pCodeText > 1 )
+				if ( code::isLineBreakEscapeChar( pLineEnd[ -1 ], m_docLanguage ) )
+					--pCodeEnd; // e.g. include "_\r\n" in BASIC line end
+
+			appendFormattedLineOfCode( outCodeText, pLineStart, static_cast<int>( pCodeEnd - pLineStart ), protectLeadingWhiteSpace, justAdjustWhiteSpace );
+
+			pLineStart = pLineEnd + lineEndLength;
+			outCodeText.Append( pCodeEnd, static_cast<int>( pLineStart - pCodeEnd ) );
+		}
+
+		return outCodeText;
 	}
 
 	// formats a line of code (no line-ends inside, please)
@@ -97,7 +121,20 @@ namespace code
 	{
 		ASSERT_PTR( lineOfCode );
 
-		TokenRange formatTargetRange( lineOfCode );
+		CString outCode;
+		appendFormattedLineOfCode( outCode, lineOfCode, str::Length( lineOfCode ), protectLeadingWhiteSpace, justAdjustWhiteSpace );
+		return outCode;
+	}
+
+	void CFormatter::appendFormattedLineOfCode( CString& rOutCodeText, const TCHAR* pLineStart, int lineLength, bool protectLeadingWhiteSpace /*= true*/,
+												bool justAdjustWhiteSpace /*= false*/ )
+	{
+		ASSERT_PTR( pLineStart );
+
+		m_lineBuffer.SetString( pLineStart, lineLength );		// reuses the buffer capacity
+
+		const TCHAR* lineOfCode = m_lineBuffer.GetString();
+		TokenRange formatTargetRange( 0, lineLength );
 
 		if ( m_options.m_deleteTrailingWhiteSpace )
 			while ( formatTargetRange.m_end > formatTargetRange.m_start && code::isWhitespaceChar( lineOfCode[ formatTargetRange.m_end - 1 ] ) )
@@ -108,11 +145,16 @@ namespace code
 				++formatTargetRange.m_start;
 
 		// Tabify leading whitespaces according to 'm_useTabs'
-		CString leadingWhiteSpace = makeLineIndentWhiteSpace( computeVisualEditorColumn( lineOfCode, formatTargetRange.m_start ) - 1 );
-		CString targetCode = formatTargetRange.getString( lineOfCode );
-		CString coreFormatedCode = justAdjustWhiteSpace ? doAdjustWhitespaceLineOfCode( targetCode ) : doFormatLineOfCode( targetCode );
+		appendLineIndentWhiteSpace( rOutCodeText, computeVisualEditorColumn( lineOfCode, formatTargetRange.m_start ) - 1 );
+
+		m_coreCodeBuffer.SetString( lineOfCode + formatTargetRange.m_start, formatTargetRange.getLength() );		// null-terminated input view of the line core
+
+		CLineStream stream( rOutCodeText, m_coreCodeBuffer.GetString() );		// formats straight into the output
 
-		return leadingWhiteSpace + coreFormatedCode;
+		if ( justAdjustWhiteSpace )
+			doAdjustWhitespace( stream );
+		else
+			doFormatLineOfCode( stream );
 	}
 
 	CString CFormatter::tabifyLineOfCode( const TCHAR* lineOfCode, bool doTabify /*= true*/ )
@@ -305,80 +347,83 @@ namespace code
 	*/
 	CString CFormatter::doFormatLineOfCode( const TCHAR lineOfCode[] )
 	{
-		CString outCode = lineOfCode;
+		CString outCode;
+		CLineStream stream( outCode, lineOfCode );
 
-		for ( int pos = 0; str::charAt( outCode, pos ) != '\0'; )
+		doFormatLineOfCode( stream );
+		return outCode;
+	}
+
+	/**
+		Single pass tokenizer: the input line is scanned once, each token being appended to the output with its resolved spacing.
+		The look-ahead rules match the pristine input after the cursor, the look-behind rules match the formatted output of this line.
+	*/
+	void CFormatter::doFormatLineOfCode( CLineStream& rStream )
+	{
+		const TCHAR* pCode = rStream.m_pCode;
+
+		for ( int pos = 0; pCode[ pos ] != '\0'; )
 		{
-			TCHAR chr = str::charAt( outCode, pos );
+			TCHAR chr = pCode[ pos ];
 			int statementEndPos;
 
 			if ( code::isWhitespaceChar( chr ) )
 			{
-				if ( !m_languageEngine.isProtectedLineTermination( statementEndPos, outCode, pos ) )
-					pos = replaceMultipleWhiteSpace( outCode, pos );
+				if ( !m_languageEngine.isProtectedLineTermination( statementEndPos, pCode, pos ) )
+					pos = replaceMultipleWhiteSpace( rStream, pos );
 				else
-					pos = str::safePos( statementEndPos, outCode ); // reached the protected line termination: [whitespaces] [comment] [whitespaces] [line-end]
+					pos = rStream.CopyCode( pos, str::safePos( statementEndPos, pCode ) ); // reached the protected line termination: [whitespaces] [comment] [whitespaces] [line-end]
 			}
-			else if ( IsBraceCharAt( outCode, pos ) )
+			else if ( IsBraceCharAt( pCode, pos ) )
 			{
 				if ( chr == _T('(') )
 					if ( m_multiWhitespacePolicy == UseSplitPrototypePolicy )
 						m_multiWhitespacePolicy = ReplaceMultipleWhiteSpace; // reset the whitespace protection for the prototype argument list, until the end
 
-				pos = formatBrace( outCode, pos );
+				pos = formatBrace( rStream, pos );
 			}
 			else if ( code::isQuoteChar( chr ) )
-			{	// skip quoted string
-				int matchingQuotePos = code::findMatchingQuotePos( outCode, pos );
+			{	// copy quoted string
+				int matchingQuotePos = code::findMatchingQuotePos( pCode, pos );
 
-				if ( matchingQuotePos != -1 )
-					pos = matchingQuotePos + 1;
-				else
-					pos = outCode.GetLength(); // fatal syntax error -> abort
+				pos = rStream.CopyCode( pos, matchingQuotePos != -1 ? matchingQuotePos + 1 : str::Length( pCode ) ); // no matching quote: fatal syntax error -> abort
 			}
-			else if ( m_languageEngine.isCommentStatement( statementEndPos, outCode, pos ) )
-				pos = str::safePos( statementEndPos, outCode );
-			else if ( m_docLanguage == DocLang_Cpp && m_languageEngine.isUnicodePortableStringConstant( statementEndPos, outCode, pos ) )
-				pos = formatUnicodePortableStringConstant( outCode, pos );
+			else if ( m_languageEngine.isCommentStatement( statementEndPos, pCode, pos ) )
+				pos = rStream.CopyCode( pos, str::safePos( statementEndPos, pCode ) );
+			else if ( m_docLanguage == DocLang_Cpp && m_languageEngine.isUnicodePortableStringConstant( statementEndPos, pCode, pos ) )
+				pos = formatUnicodePortableStringConstant( rStream, pos );
 			else
-				pos = formatDefault( outCode, pos );
+				pos = formatDefault( rStream, pos );
 		}
-
-		return outCode;
 	}
 
-	CString CFormatter::doAdjustWhitespaceLineOfCode( const TCHAR lineOfCode[] )
+	void CFormatter::doAdjustWhitespace( CLineStream& rStream )
 	{
-		CString outCode = lineOfCode;
+		const TCHAR* pCode = rStream.m_pCode;
 
-		for ( int pos = 0; str::charAt( outCode, pos ) != '\0'; )
+		for ( int pos = 0; pCode[ pos ] != '\0'; )
 		{
-			TCHAR chr = str::charAt( outCode, pos );
+			TCHAR chr = pCode[ pos ];
 			int statementEndPos;
 
 			if ( code::isWhitespaceChar( chr ) )
 			{
-				if ( !m_languageEngine.isProtectedLineTermination( statementEndPos, outCode, pos ) )
-					pos = replaceMultipleWhiteSpace( outCode, pos );
+				if ( !m_languageEngine.isProtectedLineTermination( statementEndPos, pCode, pos ) )
+					pos = replaceMultipleWhiteSpace( rStream, pos );
 				else
-					pos = str::safePos( statementEndPos, outCode ); // reached the protected line termination: [whitespaces] [comment] [whitespaces] [line-end]
+					pos = rStream.CopyCode( pos, str::safePos( statementEndPos, pCode ) ); // reached the protected line termination: [whitespaces] [comment] [whitespaces] [line-end]
 			}
 			else if ( code::isQuoteChar( chr ) )
-			{	// skip quoted string
-				int matchingQuotePos = code::findMatchingQuotePos( outCode, pos );
+			{	// copy quoted string
+				int matchingQuotePos = code::findMatchingQuotePos( pCode, pos );
 
-				if ( matchingQuotePos != -1 )
-					pos = matchingQuotePos + 1;
-				else
-					pos = outCode.GetLength(); // fatal syntax error -> abort
+				pos = rStream.CopyCode( pos, matchingQuotePos != -1 ? matchingQuotePos + 1 : str::Length( pCode ) ); // no matching quote: fatal syntax error -> abort
 			}
-			else if ( m_languageEngine.isCommentStatement( statementEndPos, outCode, pos ) )
-				pos = str::safePos( statementEndPos, outCode );
+			else if ( m_languageEngine.isCommentStatement( statementEndPos, pCode, pos ) )
+				pos = rStream.CopyCode( pos, str::safePos( statementEndPos, pCode ) );
 			else
-				++pos;
+				pos = rStream.CopyCode( pos, pos + 1 );
 		}
-
-		return outCode;
 	}
 
 	bool CFormatter::IsBraceCharAt( const TCHAR code[], int pos ) const
@@ -407,16 +452,8 @@ namespace code
 		return m_options.MustSpaceBrace( chrBrace );
 	}
 
-	/**
-		Replaces multiple whitespaces (space and tab) with one single space
-	*/
-	int CFormatter::replaceMultipleWhiteSpace( CString& targetString, int pos, const TCHAR* newWhitespace /*= _T(" ")*/ )
+	bool CFormatter::mustPreserveWhiteSpace( int whitespaceLength, const TCHAR* newWhitespace ) const
 	{
-		TokenRange whitespaces( pos );
-
-		if ( code::isWhitespaceChar( str::charAt( targetString, pos ) ) )
-			whitespaces.m_end = m_languageEngine.findIfNot( targetString, pos, code::isWhitespaceChar );
-
 		bool preserveMultipleWhiteSpace = m_options.m_preserveMultipleWhiteSpace;
 
 		switch ( m_multiWhitespacePolicy )
@@ -441,147 +478,184 @@ namespace code
 				break;
 		}
 
-		if ( preserveMultipleWhiteSpace &&
-			 ( whitespaces.getLength() > 1 && 1 == str::Length( newWhitespace ) ) )
-		{	// preserve multiple whitespaces, e.g. avoid replacing "    " with " "
-		}
+		// preserve multiple whitespaces, e.g. avoid replacing "    " with " "
+		return preserveMultipleWhiteSpace && whitespaceLength > 1 && 1 == str::Length( newWhitespace );
+	}
+
+	/**
+		Replaces multiple whitespaces (space and tab) at input pos with one single space
+	*/
+	int CFormatter::replaceMultipleWhiteSpace( CLineStream& rStream, int pos, const TCHAR* newWhitespace /*= _T(" ")*/ )
+	{
+		int whitespaceEnd = pos;
+
+		if ( code::isWhitespaceChar( rStream.m_pCode[ pos ] ) )
+			whitespaceEnd = m_languageEngine.findIfNot( rStream.m_pCode, pos, code::isWhitespaceChar );
+
+		if ( mustPreserveWhiteSpace( whitespaceEnd - pos, newWhitespace ) )
+			rStream.CopyCode( pos, whitespaceEnd );
 		else
-			whitespaces.smartReplaceWithToken( &targetString, newWhitespace );
+			rStream.m_rOutCode += newWhitespace;
 
-		return whitespaces.m_end;
+		return whitespaceEnd;
 	}
 
 	/**
-		Inserts/removes whitespace(s) AFTER pos according to 'mustSpaceIt'
+		Inserts/removes whitespace(s) AFTER the token just output, according to 'mustSpaceIt'
 	*/
-	int CFormatter::resolveSpaceAfterToken( CString& targetString, const TokenRange& tokenRange, bool mustSpaceIt )
+	int CFormatter::resolveSpaceAfterToken( CLineStream& rStream, int tokenEnd, bool mustSpaceIt )
 	{
-		ASSERT( !code::isWhitespaceChar( str::charAt( targetString, tokenRange.m_start ) ) );
+		ASSERT( !code::isWhitespaceChar( rStream.GetLastOutChar() ) );
 
 		int statementEndPos;
 
-		if ( m_languageEngine.isProtectedLineTermination( statementEndPos, targetString, tokenRange.m_end ) )
-			return str::safePos( statementEndPos, targetString ); // reached the protected line termination: [whitespaces] [comment] [whitespaces] [line-end]
+		if ( m_languageEngine.isProtectedLineTermination( statementEndPos, rStream.m_pCode, tokenEnd ) )
+			return rStream.CopyCode( tokenEnd, str::safePos( statementEndPos, rStream.m_pCode ) ); // reached the protected line termination: [whitespaces] [comment] [whitespaces] [line-end]
 
-		return replaceMultipleWhiteSpace( targetString, tokenRange.m_end, mustSpaceIt ? _T(" ") : _T("") );
+		return replaceMultipleWhiteSpace( rStream, tokenEnd, mustSpaceIt ? _T(" ") : _T("") );
 	}
 
 	/**
-		Inserts/removes whitespace(s) BEFORE pos according to 'mustSpaceIt'
+		Inserts/removes whitespace(s) BEFORE the token to be output, according to 'mustSpaceIt'
 	*/
-	int CFormatter::resolveSpaceBeforeToken( CString& targetString, const TokenRange& tokenRange, bool mustSpaceIt )
+	void CFormatter::resolveSpaceBeforeToken( CLineStream& rStream, bool mustSpaceIt )
 	{
-		ASSERT( !code::isWhitespaceChar( str::charAt( targetString, tokenRange.m_start ) ) );
+		if ( mustSpaceIt && 0 == rStream.GetOutputLength() )
+			return; // We don't space before when operator is at the beggining of the line
 
-		int beforePos = tokenRange.m_start;
+		// the whitespaces before the token were already output
+		int outLength = rStream.m_rOutCode.GetLength(), beforePos = outLength;
 
-		while ( beforePos > 0 && code::isWhitespaceChar( str::charAt( targetString, beforePos - 1 ) ) )
+		while ( beforePos > rStream.m_outStart && code::isWhitespaceChar( rStream.m_rOutCode[ beforePos - 1 ] ) )
 			--beforePos;
 
-		if ( mustSpaceIt && tokenRange.m_start == 0 )
-			return tokenRange.m_end; // We don't space before when operator is at the beggining of the line
+		const TCHAR* pNewWhitespace = mustSpaceIt ? _T(" ") : _T("");
 
-		// return the position corresponding to the end of the original token
-		return replaceMultipleWhiteSpace( targetString, beforePos, mustSpaceIt ? _T(" ") : _T("") ) + tokenRange.getLength();
+		if ( !mustPreserveWhiteSpace( outLength - beforePos, pNewWhitespace ) )
+		{
+			rStream.m_rOutCode.Truncate( beforePos );
+			rStream.m_rOutCode += pNewWhitespace;
+		}
 	}
 
-	int CFormatter::formatBrace( CString& targetString, int pos )
+	bool CFormatter::isCCastStatementAt( int& rStatementEndPos, const CLineStream& stream, int pos ) const
+	{	// the look-behind char is the last one output, the cast itself is matched on the input
+		TCHAR prevChar = stream.GetLastOutChar();
+
+		if ( !code::isWhitespaceChar( prevChar ) && _istalnum( prevChar ) )
+			return false; // not a cast for sure, e.g. func(...)
+
+		if ( !m_languageEngine.isCCastStatement( rStatementEndPos, stream.m_pCode + pos, 0 ) )
+			return false;
+
+		rStatementEndPos += pos;
+		return true;
+	}
+
+	int CFormatter::formatBrace( CLineStream& rStream, int pos )
 	{
-		ASSERT( pos != -1 && code::isBraceChar( str::charAt( targetString, pos ) ) );
+		const TCHAR* pCode = rStream.m_pCode;
+		TCHAR chrBrace = pCode[ pos ];
+
+		ASSERT( code::isBraceChar( chrBrace ) );
 
-		TCHAR chrBrace = str::charAt( targetString, pos );
 		Spacing mustSpaceIt = MustSpaceBrace( chrBrace );
 
 		if ( mustSpaceIt == RetainSpace )
-			return pos + 1; // skip to the next char
+			return rStream.CopyCode( pos, pos + 1 ); // skip to the next char
 
 		if ( isOpenBraceChar( chrBrace ) )
 		{
 			TCHAR closeBrace = code::getMatchingBrace( chrBrace );
 			int nextNonWhitespacePos = pos + 1;
 
-			while ( code::isWhitespaceChar( str::charAt( targetString, nextNonWhitespacePos ) ) )
+			while ( code::isWhitespaceChar( pCode[ nextNonWhitespacePos ] ) )
 				++nextNonWhitespacePos;
 
-			if ( str::charAt( targetString, nextNonWhitespacePos ) == closeBrace )
-			{
-				TCHAR emptyBraces[] = { chrBrace, closeBrace, '\0' };
-				TokenRange emptyBraceRange( pos, nextNonWhitespacePos + 1 );
-
-				return emptyBraceRange.smartReplaceWithToken( &targetString, emptyBraces ).m_end;
+			if ( pCode[ nextNonWhitespacePos ] == closeBrace )
+			{	// empty braces
+				rStream.AppendChar( chrBrace );
+				rStream.AppendChar( closeBrace );
+				return nextNonWhitespacePos + 1;
 			}
 
 			if ( chrBrace == _T('(') )
 			{
 				int statementEndPos;
 
-				if ( m_docLanguage == DocLang_Cpp && m_languageEngine.isCCastStatement( statementEndPos, targetString, pos ) )
+				if ( m_docLanguage == DocLang_Cpp && isCCastStatementAt( statementEndPos, rStream, pos ) )
 				{	// format the cast statement, which can be nested or cascaded.
 					++m_disableBracketSpacingCounter; // temporarily disable '()' brace spacing
 
-					TokenRange statementRange( pos, statementEndPos );
-					CString formattedCastStatement = doFormatLineOfCode( statementRange.getString( targetString ) );
+					CString castStatement( pCode + pos, statementEndPos - pos );		// the look-ahead stops at the end of the cast
+					CLineStream castStream( rStream.m_rOutCode, castStatement.GetString() );
 
-					--m_disableBracketSpacingCounter;
+					doFormatLineOfCode( castStream );
 
-					statementRange.smartReplaceWithToken( &targetString, formattedCastStatement );
-					return statementRange.m_end;
+					--m_disableBracketSpacingCounter;
+					return statementEndPos;
 				}
 			}
 
-			return resolveSpaceAfterToken( targetString, TokenRange( pos, pos + 1 ), mustSpaceIt != TrimSpace );
+			rStream.AppendChar( chrBrace );
+			return resolveSpaceAfterToken( rStream, pos + 1, mustSpaceIt != TrimSpace );
 		}
 		else
-			return resolveSpaceBeforeToken( targetString, TokenRange( pos, pos + 1 ), mustSpaceIt != TrimSpace ); // after closing brace
+		{	// closing brace
+			resolveSpaceBeforeToken( rStream, mustSpaceIt != TrimSpace );
+			rStream.AppendChar( chrBrace );
+			return pos + 1;
+		}
 	}
 
-	int CFormatter::formatUnicodePortableStringConstant( CString& targetString, int pos )
+	int CFormatter::formatUnicodePortableStringConstant( CLineStream& rStream, int pos )
 	{
-		++m_disableBracketSpacingCounter;
+		const TCHAR* pCode = rStream.m_pCode;
+		const TCHAR* pOpenBrace = _tcschr( pCode + pos, _T('(') );
 
-		int openBracePos = targetString.Find( _T('('), pos );
+		ASSERT_PTR( pOpenBrace );
 
-		ASSERT( openBracePos != -1 );
-		formatBrace( targetString, openBracePos );
-
-		int closeBracePos = code::BraceParityStatus().findMatchingBracePos( targetString, openBracePos, m_docLanguage );
+		int openBracePos = static_cast<int>( pOpenBrace - pCode );
+		int closeBracePos = code::BraceParityStatus().findMatchingBracePos( pCode, openBracePos, m_docLanguage );
 
 		ASSERT( closeBracePos != -1 );
-		pos = formatBrace( targetString, closeBracePos );
+
+		++m_disableBracketSpacingCounter;
+
+		rStream.CopyCode( pos, openBracePos );
+		pos = formatBrace( rStream, openBracePos );
+
+		if ( pos <= closeBracePos )			// the quoted string
+		{
+			rStream.CopyCode( pos, closeBracePos );
+			pos = formatBrace( rStream, closeBracePos );
+		}
 
 		--m_disableBracketSpacingCounter;
 		return pos;
 	}
 
-	int CFormatter::formatDefault( CString& targetString, int pos )
+	int CFormatter::formatDefault( CLineStream& rStream, int pos )
 	{
-		if ( _istpunct( str::charAt( targetString, pos ) ) )
-			if ( const CFormatterOptions::COperatorRule* pOpRule = m_options.FindOperatorRule( str::ptrAt( targetString, pos ) ) )
+		const TCHAR* pCode = rStream.m_pCode;
+
+		if ( _istpunct( pCode[ pos ] ) )
+			if ( const CFormatterOptions::COperatorRule* pOpRule = m_options.FindOperatorRule( pCode + pos ) )
 			{
-				int operatorLength = str::Length( pOpRule->m_pOperator );
+				int operatorEnd = pos + str::Length( pOpRule->m_pOperator );
 
-				if ( m_languageEngine.isTokenMatchBefore( targetString, pos, _T("operator") ) )
-					pos += operatorLength;
-				else
-				{
-					if ( pOpRule->m_spaceBefore != RetainSpace )
-					{
-						pos = resolveSpaceBeforeToken( targetString, TokenRange( pos, pos + operatorLength ),
-													   pOpRule->m_spaceBefore != TrimSpace );
-						pos -= operatorLength;
-					}
+				if ( m_languageEngine.isTokenMatchBefore( rStream.GetOutput(), rStream.GetOutputLength(), _T("operator") ) )
+					return rStream.CopyCode( pos, operatorEnd );	// operator overload, e.g. "operator=="
 
-					if ( pOpRule->m_spaceBefore != RetainSpace )
-						pos = resolveSpaceAfterToken( targetString, TokenRange( pos, pos + operatorLength ),
-													  pOpRule->m_spaceAfter != TrimSpace );
-					else
-						pos += operatorLength;
-				}
+				if ( RetainSpace == pOpRule->m_spaceBefore )
+					return rStream.CopyCode( pos, operatorEnd );	// retains the spacing after as well
 
-				return pos;
+				resolveSpaceBeforeToken( rStream, pOpRule->m_spaceBefore != TrimSpace );
+				rStream.CopyCode( pos, operatorEnd );
+				return resolveSpaceAfterToken( rStream, operatorEnd, pOpRule->m_spaceAfter != TrimSpace );
 			}
 
-		return ++pos;
+		return rStream.CopyCode( pos, pos + 1 );
 	}
 
 	int CFormatter::splitMultipleLines( std::vector<CString>& outLinesOfCode, std::vector<CString>& outLineEnds, const TCHAR* pCodeText )
@@ -978,6 +1052,20 @@ namespace code
 			return CString( _T(' '), editorColIndex );
 	}
 
+	void CFormatter::appendLineIndentWhiteSpace( CString& rOutCodeText, int editorColIndex ) const
+	{	// same as makeLineIndentWhiteSpace(), without the temporary strings
+		ASSERT( editorColIndex >= 0 );
+
+		int tabCount = m_useTabs ? editorColIndex / m_tabSize : 0;
+		int spaceCount = m_useTabs ? editorColIndex % m_tabSize : editorColIndex;
+
+		for ( ; tabCount != 0; --tabCount )
+			rOutCodeText.AppendChar( _T('\t') );
+
+		for ( ; spaceCount != 0; --spaceCount )
+			rOutCodeText.AppendChar( _T(' ') );
+	}
+
 	TokenRange CFormatter::getWhiteSpaceRange( const TCHAR* pCodeText, int pos /*= 0*/, bool includingComments /*= true*/ ) const
 	{
 		TokenRange whitespacesRange( pos );
@@ -39,6 +39,7 @@ namespace code
 
 		CString formatCode( const TCHAR* pCodeText, bool protectLeadingWhiteSpace = true, bool justAdjustWhiteSpace = false );
 		CString formatLineOfCode( const TCHAR* lineOfCode, bool protectLeadingWhiteSpace = true, bool justAdjustWhiteSpace = false );
+		void appendFormattedLineOfCode( CString& rOutCodeText, const TCHAR* pLineStart, int lineLength, bool protectLeadingWhiteSpace = true, bool justAdjustWhiteSpace = false );
 
 		CString tabifyLineOfCode( const TCHAR* lineOfCode, bool doTabify = true );
 
@@ -58,17 +59,37 @@ namespace code
 		CString unsplitMultipleLines( const std::vector<CString>& linesOfCode, const std::vector<CString>& lineEnds ) const;
 		CString getArgListCodeText( const std::vector<CString>& linesOfCode ) const;
 
+		// streams a line of code: the input is scanned once, and the formatted code is appended to the output
+		struct CLineStream
+		{
+			CLineStream( CString& rOutCode, const TCHAR* pCode ) : m_rOutCode( rOutCode ), m_outStart( rOutCode.GetLength() ), m_pCode( pCode ) { ASSERT_PTR( m_pCode ); }
+
+			const TCHAR* GetOutput( void ) const { return m_rOutCode.GetString() + m_outStart; }		// this line's output so far
+			int GetOutputLength( void ) const { return m_rOutCode.GetLength() - m_outStart; }
+			TCHAR GetLastOutChar( void ) const { return GetOutputLength() != 0 ? m_rOutCode[ m_rOutCode.GetLength() - 1 ] : _T('\0'); }
+
+			int CopyCode( int start, int end ) { m_rOutCode.Append( m_pCode + start, end - start ); return end; }		// copy input verbatim
+			void AppendChar( TCHAR chr ) { m_rOutCode.AppendChar( chr ); }
+		public:
+			CString& m_rOutCode;
+			const int m_outStart;		// look-behind limit: the output start of this line
+			const TCHAR* m_pCode;		// input line, null-terminated: the look-ahead limit
+		};
+
 		// formatting
 		CString doFormatLineOfCode( const TCHAR lineOfCode[] );
-		CString doAdjustWhitespaceLineOfCode( const TCHAR lineOfCode[] );
+		void doFormatLineOfCode( CLineStream& rStream );
+		void doAdjustWhitespace( CLineStream& rStream );
 		bool IsBraceCharAt( const TCHAR code[], int pos ) const;
+		bool isCCastStatementAt( int& rStatementEndPos, const CLineStream& stream, int pos ) const;
 
-		int replaceMultipleWhiteSpace( CString& targetString, int pos, const TCHAR* newWhitespace = _T(" ") );
-		int resolveSpaceAfterToken( CString& targetString, const TokenRange& tokenRange, bool mustSpaceIt );
-		int resolveSpaceBeforeToken( CString& targetString, const TokenRange& tokenRange, bool mustSpaceIt );
-		int formatBrace( CString& targetString, int pos );
-		int formatUnicodePortableStringConstant( CString& targetString, int pos );
-		int formatDefault( CString& targetString, int pos );
+		bool mustPreserveWhiteSpace( int whitespaceLength, const TCHAR* newWhitespace ) const;
+		int replaceMultipleWhiteSpace( CLineStream& rStream, int pos, const TCHAR* newWhitespace = _T(" ") );
+		int resolveSpaceAfterToken( CLineStream& rStream, int tokenEnd, bool mustSpaceIt );
+		void resolveSpaceBeforeToken( CLineStream& rStream, bool mustSpaceIt );
+		int formatBrace( CLineStream& rStream, int pos );
+		int formatUnicodePortableStringConstant( CLineStream& rStream, int pos );
+		int formatDefault( CLineStream& rStream, int pos );
 
 		// line splitter
 		enum HandleSingleLineComments { RemoveComment, ToMultiLineComment };
@@ -81,6 +102,7 @@ namespace code
 		int computeVisualEditorIndex( const TCHAR* pCodeText, int index ) const { return (int)computeVisualEditorColumn( pCodeText, index ) - 1; }
 		CString makeLineIndentWhiteSpace( int editorColIndex ) const;
 		CString makeLineIndentWhiteSpace( int editorColIndex, bool doUseTabs ) const;
+		void appendLineIndentWhiteSpace( CString& rOutCodeText, int editorColIndex ) const;
 
 		// C++ implementation
 		void cppFilterPrototypeForImplementation( CString& targetString ) const;
@@ -106,6 +128,8 @@ namespace code
 
 		// Internal state
 		int m_disableBracketSpacingCounter;
+		CString m_lineBuffer;				// working buffers reused across lines by formatCode(), to avoid per-line allocations
+		CString m_coreCodeBuffer;			// input view of the line being streamed
 	public:
 		static const std::tstring s_cancelTag;
 	};
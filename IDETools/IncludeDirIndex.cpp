@@ -0,0 +1,118 @@
+
+#include "pch.h"
+#include "IncludeDirIndex.h"
+#include "utl/ContainerOwnership.h"
+#include "utl/FileSystem.h"
+#include "utl/MultiThreading.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+
+namespace inc
+{
+	// CDirIndex implementation
+
+	CDirIndex& CDirIndex::Instance( void )
+	{
+		static CDirIndex s_dirIndex;
+		return s_dirIndex;
+	}
+
+	void CDirIndex::Invalidate( void )
+	{
+		mt::CAutoLock lock( &m_cs );
+		utl::ClearOwningMapValues( m_listings );
+	}
+
+	bool CDirIndex::FileExist( const fs::CPath& dirPath, const fs::CPath& relFilePath )
+	{
+		std::vector<std::tstring> components;
+		if ( !SplitRelativePath( components, relFilePath.Get() ) )
+			return ( dirPath / relFilePath ).FileExist();			// "..\Header.h", "./Header.h": probe the file system
+
+		mt::CAutoLock lock( &m_cs );
+		fs::CPath subDirPath = dirPath;
+
+		for ( size_t i = 0; i != components.size() - 1; ++i )
+		{
+			const CListing* pListing = AcquireListing( subDirPath );
+			if ( 0 == pListing->m_subDirNames.count( fs::CPath( components[ i ] ) ) )
+				return false;
+
+			subDirPath /= components[ i ].c_str();
+		}
+
+		return AcquireListing( subDirPath )->m_fileNames.count( fs::CPath( components.back() ) ) != 0;
+	}
+
+	const CDirIndex::CListing* CDirIndex::AcquireListing( const fs::CPath& dirPath )
+	{
+		CListing*& rpListing = m_listings[ dirPath ];
+		DWORD tickCount = ::GetTickCount();
+
+		if ( nullptr == rpListing )
+		{
+			rpListing = new CListing();
+			rpListing->Scan( dirPath );
+		}
+		else if ( tickCount - rpListing->m_checkTick > ValidateMs )
+		{
+			if ( fs::ReadLastModifyTime( dirPath ) != rpListing->m_modifyTime )		// files added, removed or renamed in this directory?
+				rpListing->Scan( dirPath );
+
+			rpListing->m_checkTick = tickCount;
+		}
+
+		return rpListing;
+	}
+
+	bool CDirIndex::SplitRelativePath( std::vector<std::tstring>& rComponents, const std::tstring& relFilePath )
+	{
+		static const TCHAR s_slashes[] = _T("\\/");
+
+		rComponents.clear();
+		for ( size_t pos = 0; pos < relFilePath.length(); )
+		{
+			size_t sepPos = relFilePath.find_first_of( s_slashes, pos );
+			if ( std::tstring::npos == sepPos )
+				sepPos = relFilePath.length();
+
+			std::tstring component = relFilePath.substr( pos, sepPos - pos );
+			if ( component.empty() || _T(".") == component || _T("..") == component || component.find( _T(':') ) != std::tstring::npos )
+				return false;					// not a plain relative path
+
+			rComponents.push_back( component );
+			pos = sepPos + 1;
+		}
+
+		return !rComponents.empty();
+	}
+
+
+	// CDirIndex::CListing implementation
+
+	void CDirIndex::CListing::Scan( const fs::CPath& dirPath )
+	{
+		m_fileNames.clear();
+		m_subDirNames.clear();
+		m_modifyTime = fs::ReadLastModifyTime( dirPath );
+		m_checkTick = ::GetTickCount();
+
+		CFileFind finder;
+		for ( BOOL found = finder.FindFile( ( dirPath / _T("*") ).GetPtr() ); found; )
+		{
+			found = finder.FindNextFile();
+			if ( finder.IsDots() )
+				continue;
+
+			fs::CPath name( finder.GetFileName().GetString() );
+
+			if ( finder.IsDirectory() )
+				m_subDirNames.insert( name );
+			else
+				m_fileNames.insert( name );
+		}
+	}
+}
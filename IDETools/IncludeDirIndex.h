@@ -0,0 +1,53 @@
+#ifndef IncludeDirIndex_h
+#define IncludeDirIndex_h
+#pragma once
+
+#include "utl/Path.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <afxmt.h>
+
+
+namespace inc
+{
+	// Lazily built index of the include directories contents: resolves a relative include path (e.g. "atl/string.h") with hash lookups in cached directory listings, instead of probing the file system.
+	// Each directory is listed (not recursively) on first use; sub-directories of a relative path are listed on demand.
+	// A listing is re-validated against its directory modify time at most every ValidateMs, and rescanned if the directory has changed.
+	//
+	class CDirIndex : private utl::noncopyable
+	{
+		CDirIndex( void ) {}
+		~CDirIndex() { Invalidate(); }
+	public:
+		static CDirIndex& Instance( void );
+
+		enum { ValidateMs = 2000 };
+
+		bool FileExist( const fs::CPath& dirPath, const fs::CPath& relFilePath );
+		void Invalidate( void );				// discard all listings, e.g. when the include directories have changed
+
+		size_t GetListingCount( void ) const { return m_listings.size(); }
+	private:
+		struct CListing
+		{
+			CListing( void ) : m_checkTick( 0 ) {}
+
+			void Scan( const fs::CPath& dirPath );
+		public:
+			std::unordered_set<fs::CPath> m_fileNames;		// case-insensitive
+			std::unordered_set<fs::CPath> m_subDirNames;
+			CTime m_modifyTime;								// of the directory when scanned
+			DWORD m_checkTick;
+		};
+
+		const CListing* AcquireListing( const fs::CPath& dirPath );
+
+		static bool SplitRelativePath( std::vector<std::tstring>& rComponents, const std::tstring& relFilePath );
+	private:
+		std::unordered_map<fs::CPath, CListing*> m_listings;		// dir path to listing (owning)
+		CCriticalSection m_cs;
+	};
+}
+
+
+#endif // IncludeDirIndex_h
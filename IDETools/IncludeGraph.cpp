@@ -0,0 +1,397 @@
+
+#include "pch.h"
+#include "IncludeGraph.h"
+#include "IncludeDirectories.h"
+#include "IncludeNode.h"
+#include "SourceFileParser.h"
+#include "utl/ContainerOwnership.h"
+#include "utl/FileEnumerator.h"
+#include "utl/FileSystem.h"
+#include "utl/ParallelFor.h"
+#include "utl/TextFileIo.h"
+#include <sstream>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+#include "utl/TextFileIo.hxx"
+
+
+namespace inc
+{
+	namespace json
+	{
+		std::string Quote( const std::tstring& text )
+		{
+			std::string utf8Text = str::ToUtf8( text.c_str() ), quoted;
+			quoted.reserve( utf8Text.length() + 2 );
+
+			quoted += '"';
+			for ( std::string::const_iterator itChar = utf8Text.begin(); itChar != utf8Text.end(); ++itChar )
+				switch ( *itChar )
+				{
+					case '"':	quoted += "\\\""; break;
+					case '\\':	quoted += "\\\\"; break;
+					case '\t':	quoted += "\\t"; break;
+					case '\r':	quoted += "\\r"; break;
+					case '\n':	quoted += "\\n"; break;
+					default:	quoted += *itChar;
+				}
+			quoted += '"';
+			return quoted;
+		}
+	}
+
+
+	namespace impl
+	{
+		struct ParseWaveFunc		// parses a wave of nodes in worker threads: each call writes only to its own slot
+		{
+			ParseWaveFunc( const std::vector<CGraphNode*>& nodes, size_t waveStart, std::vector< std::vector<fs::CPath> >& rIncludedPaths, std::vector<UINT64>& rFileSizes )
+				: m_nodes( nodes ), m_waveStart( waveStart ), m_rIncludedPaths( rIncludedPaths ), m_rFileSizes( rFileSizes ) {}
+
+			void operator()( size_t pos ) const
+			{
+				try
+				{
+					CIncludeGraph::ParseFile( m_rIncludedPaths[ pos ], m_rFileSizes[ pos ], m_nodes[ m_waveStart + pos ]->m_path );
+				}
+				catch ( CException* pExc )
+				{
+					pExc->Delete();
+				}
+			}
+		private:
+			const std::vector<CGraphNode*>& m_nodes;
+			size_t m_waveStart;
+			std::vector< std::vector<fs::CPath> >& m_rIncludedPaths;
+			std::vector<UINT64>& m_rFileSizes;
+		};
+
+
+		struct MoreBuildCost
+		{
+			bool operator()( const CGraphNode* pLeft, const CGraphNode* pRight ) const
+			{
+				return pLeft->GetBuildCost() > pRight->GetBuildCost();
+			}
+		};
+	}
+
+
+	// CGraphNode implementation
+
+	CGraphNode::CGraphNode( const fs::CPath& path, bool isTranslationUnit )
+		: m_path( path )
+		, m_isTranslationUnit( isTranslationUnit )
+		, m_fileSize( 0 )
+		, m_transitiveCount( 0 )
+		, m_transitiveBytes( 0 )
+		, m_unitRefCount( 0 )
+		, m_inCycle( false )
+	{
+	}
+
+
+	// CIncludeGraph implementation
+
+	const TCHAR CIncludeGraph::s_srcWildSpec[] = _T("*.cpp;*.c;*.cxx;*.cc;*.idl");
+
+	CIncludeGraph::CIncludeGraph( void )
+		: m_parsedCount( 0 )
+		, m_buildElapsedMs( 0 )
+	{
+	}
+
+	CIncludeGraph::~CIncludeGraph()
+	{
+		Clear();
+	}
+
+	void CIncludeGraph::Clear( void )
+	{
+		utl::ClearOwningContainer( m_nodes );
+		m_nodeIndexes.clear();
+		m_cycles.clear();
+		m_parsedCount = 0;
+		m_buildElapsedMs = 0;
+	}
+
+	size_t CIncludeGraph::AddSourceDirectory( const fs::TDirPath& dirPath, const TCHAR* pWildSpec /*= s_srcWildSpec*/ )
+	{
+		std::vector<fs::CPath> srcFilePaths;
+		fs::EnumFilePaths( srcFilePaths, dirPath, pWildSpec, fs::EF_Recurse );
+
+		size_t addedCount = 0;
+		for ( std::vector<fs::CPath>::const_iterator itSrcFilePath = srcFilePaths.begin(); itSrcFilePath != srcFilePaths.end(); ++itSrcFilePath )
+			if ( RegisterFile( *itSrcFilePath, true ).second )
+				++addedCount;
+
+		return addedCount;
+	}
+
+	std::pair<size_t, bool> CIncludeGraph::RegisterFile( const fs::CPath& filePath, bool isTranslationUnit /*= false*/ )
+	{
+		std::pair<std::unordered_map<fs::CPath, size_t>::iterator, bool> itPair = m_nodeIndexes.insert( std::make_pair( filePath, m_nodes.size() ) );
+
+		if ( itPair.second )
+			m_nodes.push_back( new CGraphNode( filePath, isTranslationUnit ) );
+		else if ( isTranslationUnit )
+			m_nodes[ itPair.first->second ]->m_isTranslationUnit = true;			// e.g. an included .cpp file
+
+		return std::make_pair( itPair.first->second, itPair.second );
+	}
+
+	void CIncludeGraph::AddInclude( size_t fromIndex, size_t toIndex )
+	{
+		ASSERT( fromIndex < m_nodes.size() && toIndex < m_nodes.size() );
+		m_nodes[ fromIndex ]->m_includes.push_back( toIndex );
+	}
+
+	size_t CIncludeGraph::FindNodeIndex( const fs::CPath& filePath ) const
+	{
+		std::unordered_map<fs::CPath, size_t>::const_iterator itFound = m_nodeIndexes.find( filePath );
+		return itFound != m_nodeIndexes.end() ? itFound->second : utl::npos;
+	}
+
+	size_t CIncludeGraph::GetTranslationUnitCount( void ) const
+	{
+		size_t unitCount = 0;
+		for ( std::vector<CGraphNode*>::const_iterator itNode = m_nodes.begin(); itNode != m_nodes.end(); ++itNode )
+			if ( ( *itNode )->m_isTranslationUnit )
+				++unitCount;
+
+		return unitCount;
+	}
+
+	bool CIncludeGraph::IsParsable( const fs::CPath& filePath )
+	{
+		switch ( ft::FindFileType( filePath.GetPtr() ) )
+		{
+			case ft::TLB:
+			case ft::RES:
+			case ft::DLL:
+			case ft::EXE:
+			case ft::LIB:
+				return false;					// binary files
+		}
+		return true;
+	}
+
+	void CIncludeGraph::ParseFile( std::vector<fs::CPath>& rIncludedPaths, UINT64& rFileSize, const fs::CPath& filePath )
+	{
+		rFileSize = fs::GetFileSize( filePath.GetPtr() );
+
+		if ( IsParsable( filePath ) )
+		{
+			CSourceFileParser parser( filePath );
+			parser.ParseRootFile( INT_MAX );					// the whole file: an #include can follow a long comment header
+
+			const std::vector<CIncludeNode*>& includeNodes = parser.GetIncludeNodes();
+
+			rIncludedPaths.reserve( includeNodes.size() );
+			for ( std::vector<CIncludeNode*>::const_iterator itNode = includeNodes.begin(); itNode != includeNodes.end(); ++itNode )
+				rIncludedPaths.push_back( path::MakeCanonical( ( *itNode )->m_path.GetPtr() ) );
+		}
+	}
+
+	void CIncludeGraph::Build( size_t threadCount /*= 0*/ )
+	{
+		DWORD startTick = ::GetTickCount();
+
+		CIncludeDirectories::Instance().GetSearchSpecs();		// initialize the shared search specs before parsing in worker threads
+
+		while ( m_parsedCount != m_nodes.size() )
+		{	// parse the wave of newly registered nodes in parallel
+			size_t waveStart = m_parsedCount, waveSize = m_nodes.size() - waveStart;
+			std::vector< std::vector<fs::CPath> > includedPaths( waveSize );
+			std::vector<UINT64> fileSizes( waveSize );
+
+			mt::ParallelFor( waveSize, impl::ParseWaveFunc( m_nodes, waveStart, includedPaths, fileSizes ), threadCount );
+
+			m_parsedCount = m_nodes.size();
+
+			// register the included files: the new ones make the next wave
+			for ( size_t pos = 0; pos != waveSize; ++pos )
+			{
+				size_t nodeIndex = waveStart + pos;
+
+				m_nodes[ nodeIndex ]->m_fileSize = fileSizes[ pos ];
+
+				for ( std::vector<fs::CPath>::const_iterator itIncludedPath = includedPaths[ pos ].begin(); itIncludedPath != includedPaths[ pos ].end(); ++itIncludedPath )
+					AddInclude( nodeIndex, RegisterFile( *itIncludedPath ).first );
+			}
+		}
+
+		ComputeMetrics();
+		m_buildElapsedMs = ::GetTickCount() - startTick;
+	}
+
+	void CIncludeGraph::ComputeMetrics( void )
+	{
+		DetectCycles();
+
+		// transitive closure of each node: a depth-first walk with visit stamps (no clearing between walks)
+		std::vector<size_t> visitStamps( m_nodes.size(), utl::npos );
+		std::vector<size_t> stack;
+
+		for ( std::vector<CGraphNode*>::const_iterator itNode = m_nodes.begin(); itNode != m_nodes.end(); ++itNode )
+			( *itNode )->m_unitRefCount = 0;
+
+		for ( size_t rootIndex = 0; rootIndex != m_nodes.size(); ++rootIndex )
+		{
+			CGraphNode* pRoot = m_nodes[ rootIndex ];
+
+			pRoot->m_transitiveCount = 0;
+			pRoot->m_transitiveBytes = pRoot->m_fileSize;
+
+			visitStamps[ rootIndex ] = rootIndex;
+			stack.assign( 1, rootIndex );
+
+			while ( !stack.empty() )
+			{
+				const CGraphNode* pNode = m_nodes[ stack.back() ];
+				stack.pop_back();
+
+				for ( std::vector<size_t>::const_iterator itInclude = pNode->m_includes.begin(); itInclude != pNode->m_includes.end(); ++itInclude )
+					if ( visitStamps[ *itInclude ] != rootIndex )
+					{
+						CGraphNode* pIncluded = m_nodes[ *itInclude ];
+
+						visitStamps[ *itInclude ] = rootIndex;
+						stack.push_back( *itInclude );
+
+						++pRoot->m_transitiveCount;
+						pRoot->m_transitiveBytes += pIncluded->m_fileSize;
+
+						if ( pRoot->m_isTranslationUnit )
+							++pIncluded->m_unitRefCount;
+					}
+			}
+		}
+	}
+
+	void CIncludeGraph::DetectCycles( void )
+	{
+		// Tarjan's strongly connected components: each component with more than one file (or a self-include) is an include cycle
+		std::vector<int> lowLinks( m_nodes.size(), -1 ), visitOrders( m_nodes.size(), -1 );
+		std::vector<size_t> stack;
+		std::vector<bool> onStack( m_nodes.size(), false );
+		int order = 0;
+
+		m_cycles.clear();
+		for ( std::vector<CGraphNode*>::const_iterator itNode = m_nodes.begin(); itNode != m_nodes.end(); ++itNode )
+			( *itNode )->m_inCycle = false;
+
+		for ( size_t nodeIndex = 0; nodeIndex != m_nodes.size(); ++nodeIndex )
+			if ( -1 == visitOrders[ nodeIndex ] )
+				VisitCycles( nodeIndex, lowLinks, visitOrders, stack, onStack, order );
+	}
+
+	void CIncludeGraph::VisitCycles( size_t nodeIndex, std::vector<int>& rLowLinks, std::vector<int>& rVisitOrders, std::vector<size_t>& rStack, std::vector<bool>& rOnStack, int& rOrder )
+	{
+		const CGraphNode* pNode = m_nodes[ nodeIndex ];
+
+		rVisitOrders[ nodeIndex ] = rLowLinks[ nodeIndex ] = rOrder++;
+		rStack.push_back( nodeIndex );
+		rOnStack[ nodeIndex ] = true;
+
+		for ( std::vector<size_t>::const_iterator itInclude = pNode->m_includes.begin(); itInclude != pNode->m_includes.end(); ++itInclude )
+			if ( -1 == rVisitOrders[ *itInclude ] )
+			{
+				VisitCycles( *itInclude, rLowLinks, rVisitOrders, rStack, rOnStack, rOrder );
+				rLowLinks[ nodeIndex ] = std::min( rLowLinks[ nodeIndex ], rLowLinks[ *itInclude ] );
+			}
+			else if ( rOnStack[ *itInclude ] )
+				rLowLinks[ nodeIndex ] = std::min( rLowLinks[ nodeIndex ], rVisitOrders[ *itInclude ] );
+
+		if ( rLowLinks[ nodeIndex ] == rVisitOrders[ nodeIndex ] )
+		{	// root of a component: pop it from the stack
+			std::vector<size_t> component;
+			size_t memberIndex;
+
+			do
+			{
+				memberIndex = rStack.back();
+				rStack.pop_back();
+				rOnStack[ memberIndex ] = false;
+				component.push_back( memberIndex );
+			}
+			while ( memberIndex != nodeIndex );
+
+			bool selfInclude = std::find( pNode->m_includes.begin(), pNode->m_includes.end(), nodeIndex ) != pNode->m_includes.end();
+
+			if ( component.size() > 1 || selfInclude )
+			{
+				std::reverse( component.begin(), component.end() );			// in visit order
+
+				for ( std::vector<size_t>::const_iterator itMember = component.begin(); itMember != component.end(); ++itMember )
+					m_nodes[ *itMember ]->m_inCycle = true;
+
+				m_cycles.push_back( component );
+			}
+		}
+	}
+
+	void CIncludeGraph::QueryHeaviestHeaders( std::vector<const CGraphNode*>& rHeaders, size_t maxCount /*= utl::npos*/ ) const
+	{
+		rHeaders.clear();
+		for ( std::vector<CGraphNode*>::const_iterator itNode = m_nodes.begin(); itNode != m_nodes.end(); ++itNode )
+			if ( ( *itNode )->IsHeader() )
+				rHeaders.push_back( *itNode );
+
+		std::stable_sort( rHeaders.begin(), rHeaders.end(), impl::MoreBuildCost() );
+
+		if ( rHeaders.size() > maxCount )
+			rHeaders.resize( maxCount );
+	}
+
+	std::string CIncludeGraph::FormatJsonReport( size_t maxHeaderCount /*= utl::npos*/ ) const
+	{
+		std::ostringstream os;
+
+		os << "{\n";
+		os << "\t\"translationUnits\": " << GetTranslationUnitCount() << ",\n";
+		os << "\t\"files\": " << m_nodes.size() << ",\n";
+		os << "\t\"buildMs\": " << m_buildElapsedMs << ",\n";
+
+		os << "\t\"cycles\": [";
+		for ( size_t cyclePos = 0; cyclePos != m_cycles.size(); ++cyclePos )
+		{
+			os << ( cyclePos != 0 ? ",\n\t\t[ " : "\n\t\t[ " );
+			for ( size_t memberPos = 0; memberPos != m_cycles[ cyclePos ].size(); ++memberPos )
+				os << ( memberPos != 0 ? ", " : "" ) << json::Quote( m_nodes[ m_cycles[ cyclePos ][ memberPos ] ]->m_path.Get() );
+			os << " ]";
+		}
+		os << ( m_cycles.empty() ? "],\n" : "\n\t],\n" );
+
+		std::vector<const CGraphNode*> headers;
+		QueryHeaviestHeaders( headers, maxHeaderCount );
+
+		os << "\t\"headers\": [";
+		for ( std::vector<const CGraphNode*>::const_iterator itHeader = headers.begin(); itHeader != headers.end(); ++itHeader )
+		{
+			const CGraphNode* pHeader = *itHeader;
+
+			os << ( itHeader != headers.begin() ? ",\n\t\t{ " : "\n\t\t{ " )
+				<< "\"path\": " << json::Quote( pHeader->m_path.Get() )
+				<< ", \"size\": " << pHeader->m_fileSize
+				<< ", \"directIncludes\": " << pHeader->m_includes.size()
+				<< ", \"transitiveIncludes\": " << pHeader->m_transitiveCount
+				<< ", \"transitiveBytes\": " << pHeader->m_transitiveBytes
+				<< ", \"includedByUnits\": " << pHeader->m_unitRefCount
+				<< ", \"buildCost\": " << pHeader->GetBuildCost()
+				<< ", \"inCycle\": " << ( pHeader->m_inCycle ? "true" : "false" )
+				<< " }";
+		}
+		os << ( headers.empty() ? "]\n" : "\n\t]\n" );
+		os << "}\n";
+		return os.str();
+	}
+
+	void CIncludeGraph::SaveJsonReport( const fs::CPath& reportFilePath, size_t maxHeaderCount /*= utl::npos*/ ) const throws_( CRuntimeException )
+	{
+		io::WriteStringToFile( reportFilePath, FormatJsonReport( maxHeaderCount ), fs::ANSI_UTF8 );
+	}
+}
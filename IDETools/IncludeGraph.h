@@ -0,0 +1,85 @@
+#ifndef IncludeGraph_h
+#define IncludeGraph_h
+#pragma once
+
+#include "utl/Path.h"
+#include <unordered_map>
+
+
+namespace inc
+{
+	struct CGraphNode
+	{
+		CGraphNode( const fs::CPath& path, bool isTranslationUnit );
+
+		bool IsHeader( void ) const { return !m_isTranslationUnit; }
+		UINT64 GetBuildCost( void ) const { return m_unitRefCount * m_transitiveBytes; }		// bytes compiled on account of this file, summed over all translation units
+	public:
+		const fs::CPath m_path;
+		bool m_isTranslationUnit;
+		UINT64 m_fileSize;
+		std::vector<size_t> m_includes;			// indexes of the directly included nodes
+
+		// metrics computed after build
+		size_t m_transitiveCount;				// unique files reachable through its includes
+		UINT64 m_transitiveBytes;				// own size + the size of all reachable files
+		size_t m_unitRefCount;					// translation units that include it, directly or indirectly
+		bool m_inCycle;
+	};
+
+
+	// Include dependency graph of a whole project: each translation unit and header is a node parsed only once.
+	// Build() parses the files in parallel waves (breadth-first): the files discovered by a wave are parsed by the next one.
+	// Computes the include cycles and per-file transitive metrics, to find the headers that dominate the build time.
+	//
+	class CIncludeGraph : private utl::noncopyable
+	{
+	public:
+		CIncludeGraph( void );
+		~CIncludeGraph();
+
+		void Clear( void );
+
+		size_t AddTranslationUnit( const fs::CPath& srcFilePath ) { return RegisterFile( srcFilePath, true ).first; }
+		size_t AddSourceDirectory( const fs::TDirPath& dirPath, const TCHAR* pWildSpec = s_srcWildSpec );	// recursively; returns the count of added units
+
+		void Build( size_t threadCount = 0 );			// 0 for hardware concurrency
+		void ComputeMetrics( void );
+
+		// graph construction: also used by Build()
+		std::pair<size_t, bool> RegisterFile( const fs::CPath& filePath, bool isTranslationUnit = false );		// returns <index, isNew>
+		void AddInclude( size_t fromIndex, size_t toIndex );
+
+		size_t GetNodeCount( void ) const { return m_nodes.size(); }
+		const CGraphNode* GetNodeAt( size_t index ) const { return m_nodes[ index ]; }
+		CGraphNode* RefNodeAt( size_t index ) { return m_nodes[ index ]; }
+		size_t FindNodeIndex( const fs::CPath& filePath ) const;
+
+		const std::vector< std::vector<size_t> >& GetCycles( void ) const { return m_cycles; }
+		DWORD GetBuildElapsedMs( void ) const { return m_buildElapsedMs; }
+		size_t GetTranslationUnitCount( void ) const;
+
+		void QueryHeaviestHeaders( std::vector<const CGraphNode*>& rHeaders, size_t maxCount = utl::npos ) const;	// sorted by build cost descending
+
+		std::string FormatJsonReport( size_t maxHeaderCount = utl::npos ) const;		// UTF8
+		void SaveJsonReport( const fs::CPath& reportFilePath, size_t maxHeaderCount = utl::npos ) const throws_( CRuntimeException );
+
+		static void ParseFile( std::vector<fs::CPath>& rIncludedPaths, UINT64& rFileSize, const fs::CPath& filePath );		// thread safe
+	private:
+		void DetectCycles( void );
+		void VisitCycles( size_t nodeIndex, std::vector<int>& rLowLinks, std::vector<int>& rVisitOrders, std::vector<size_t>& rStack, std::vector<bool>& rOnStack, int& rOrder );
+
+		static bool IsParsable( const fs::CPath& filePath );
+	private:
+		std::vector<CGraphNode*> m_nodes;							// owning
+		std::unordered_map<fs::CPath, size_t> m_nodeIndexes;		// path to node index (memoized files)
+		std::vector< std::vector<size_t> > m_cycles;				// strongly connected components (mutually including files)
+		size_t m_parsedCount;										// nodes parsed by Build()
+		DWORD m_buildElapsedMs;
+	public:
+		static const TCHAR s_srcWildSpec[];
+	};
+}
+
+
+#endif // IncludeGraph_h
@@ -2,6 +2,7 @@
 #include "pch.h"
 #include "OptionsSheet.h"
 #include "IncludeDirectories.h"
+#include "IncludeDirIndex.h"
 #include "ModuleSession.h"
 #include "Application.h"
 #include "resource.h"
@@ -656,6 +657,8 @@ void CDirectoriesPage::ApplyPageChanges( void ) throws_( CRuntimeException )
 	CIncludeDirectories& rDestDirSets = CIncludeDirectories::Instance();
 	rDestDirSets.Assign( *m_pDirSets );
 	rDestDirSets.Save();
+
+	inc::CDirIndex::Instance().Invalidate();		// discard the listings of directories no longer searched
 }
 
 void CDirectoriesPage::DoDataExchange( CDataExchange* pDX )
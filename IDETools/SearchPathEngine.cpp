@@ -2,6 +2,7 @@
 #include "pch.h"
 #include "SearchPathEngine.h"
 #include "IncludeDirectories.h"
+#include "IncludeDirIndex.h"
 #include "IncludeNode.h"
 #include "utl/StringUtilities.h"
 #include <set>
@@ -17,12 +18,21 @@ namespace inc
 
 	bool CFoundPaths::AddValidPath( const fs::CPath& fullPath, Location location )
 	{
-		if ( fullPath.FileExist() )
-			if ( m_uniquePaths.insert( fullPath ).second )		// unique?
-			{
-				m_foundFiles.push_back( TPathLocPair( fullPath.Get(), location ) );
-				return true;
-			}
+		return fullPath.FileExist() && AddUniquePath( fullPath, location );
+	}
+
+	bool CFoundPaths::AddIndexedPath( const fs::CPath& dirPath, const fs::CPath& relFilePath, Location location )
+	{
+		return CDirIndex::Instance().FileExist( dirPath, relFilePath ) && AddUniquePath( dirPath / relFilePath, location );
+	}
+
+	bool CFoundPaths::AddUniquePath( const fs::CPath& fullPath, Location location )
+	{
+		if ( m_uniquePaths.insert( fullPath ).second )		// unique?
+		{
+			m_foundFiles.push_back( TPathLocPair( fullPath.Get(), location ) );
+			return true;
+		}
 
 		return false;
 	}
@@ -75,9 +85,7 @@ namespace inc
 			if ( HasFlag( m_searchFlags, itSpec->second ) )			// location selected?
 				for ( std::vector<fs::CPath>::const_iterator itDirPath = itSpec->first->GetPaths().begin(); itDirPath != itSpec->first->GetPaths().end(); ++itDirPath )
 				{
-					fs::CPath fullPath = MakeDirPath( *itDirPath ) / includeTag.GetFilePath();
-
-					rResults.AddValidPath( fullPath, itSpec->first->GetLocation() );
+					rResults.AddIndexedPath( MakeDirPath( *itDirPath ), includeTag.GetFilePath(), itSpec->first->GetLocation() );
 					if ( rResults.IsFull() )
 						return;
 				}
@@ -22,6 +22,9 @@ namespace inc
 		void Swap( std::vector<TPathLocPair>& rFoundFiles ) { rFoundFiles.swap( m_foundFiles ); }
 
 		bool AddValidPath( const fs::CPath& fullPath, Location location );
+		bool AddIndexedPath( const fs::CPath& dirPath, const fs::CPath& relFilePath, Location location );		// lookup in CDirIndex, no file system probe
+	private:
+		bool AddUniquePath( const fs::CPath& fullPath, Location location );
 	private:
 		size_t m_maxCount;
 		std::vector<TPathLocPair> m_foundFiles;
@@ -4,6 +4,7 @@
 #include "IdeUtilities.h"
 #include "InputBoxDialog.h"
 #include "FileLocatorDialog.h"
+#include "IncludeGraph.h"
 #include "StringUtilitiesEx.h"
 #include "ModuleSession.h"
 #include "Application.h"
@@ -94,6 +95,7 @@ BEGIN_DISPATCH_MAP(UserInterface, CCmdTarget)
 	DISP_FUNCTION_ID(UserInterface, "SetEnvironmentVariable", dispidSetEnvironmentVariable, SetEnvironmentVariable, VT_BOOL, VTS_BSTR VTS_BSTR)
 	DISP_FUNCTION_ID(UserInterface, "ExpandEnvironmentVariables", dispidExpandEnvironmentVariables, ExpandEnvironmentVariables, VT_BSTR, VTS_BSTR)
 	DISP_FUNCTION_ID(UserInterface, "LocateFile", dispidLocateFile, LocateFile, VT_BSTR, VTS_BSTR)
+	DISP_FUNCTION_ID(UserInterface, "ReportIncludeGraph", dispidReportIncludeGraph, ReportIncludeGraph, VT_I4, VTS_BSTR VTS_BSTR VTS_I4)
 END_DISPATCH_MAP()
 
 // Note: we add support for IID_IUserInterface to support typesafe binding
@@ -303,3 +305,34 @@ BSTR UserInterface::LocateFile( LPCTSTR localDirPath )
 
 	return mfc::AllocSysString( includeFilePath );
 }
+
+
+// Builds the include graph of all source files in sourceDirPath (recursively), and saves the JSON report of the heaviest headers.
+// Returns the count of include cycles found, or -1 on error. Meant to run headless, e.g. in a CI build script via cscript.exe.
+long UserInterface::ReportIncludeGraph( LPCTSTR sourceDirPath, LPCTSTR reportFilePath, long maxHeaderCount )
+{
+	inc::CIncludeGraph graph;
+
+	if ( 0 == graph.AddSourceDirectory( fs::TDirPath( sourceDirPath ) ) )
+	{
+		std::clog << "No source files found in: " << str::ToUtf8( sourceDirPath ) << std::endl;
+		return -1;
+	}
+
+	graph.Build();
+
+	try
+	{
+		graph.SaveJsonReport( fs::CPath( reportFilePath ), maxHeaderCount > 0 ? static_cast<size_t>( maxHeaderCount ) : utl::npos );
+	}
+	catch ( CRuntimeException& exc )
+	{
+		std::clog << str::ToUtf8( exc.GetMessage().c_str() ) << std::endl;
+		return -1;
+	}
+
+	std::clog << "Include graph: " << graph.GetTranslationUnitCount() << " translation units, " << graph.GetNodeCount() << " files, "
+		<< graph.GetCycles().size() << " cycles (" << graph.GetBuildElapsedMs() << " ms)" << std::endl;
+
+	return static_cast<long>( graph.GetCycles().size() );
+}
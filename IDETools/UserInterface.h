@@ -44,7 +44,8 @@ protected:
 		dispidGetEnvironmentVariable = 16,
 		dispidSetEnvironmentVariable = 17,
 		dispidExpandEnvironmentVariables = 18,
-		dispidLocateFile = 19
+		dispidLocateFile = 19,
+		dispidReportIncludeGraph = 20
 	};
 
 	BSTR GetIDEToolsRegistryKey();
@@ -67,4 +68,5 @@ protected:
 	BOOL SetEnvironmentVariable(LPCTSTR varName, LPCTSTR varValue);
 	BSTR ExpandEnvironmentVariables(LPCTSTR sourceString);
 	BSTR LocateFile(LPCTSTR localDirPath);
+	long ReportIncludeGraph(LPCTSTR sourceDirPath, LPCTSTR reportFilePath, long maxHeaderCount);
 };
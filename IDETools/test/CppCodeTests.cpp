@@ -7,6 +7,9 @@
 #include "CodeSnippetsParser.h"
 #include "IterationSlices.h"
 #include "CppParser.h"
+#include "IncludeDirIndex.h"
+#include "IncludeGraph.h"
+#include <fstream>
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -174,6 +177,68 @@ Line1\n\
 Line1\n\
 ") );
 	}
+
+	{	// literals: unknown or malformed literals are output verbatim
+		parser.LookupLiteralValue( _T("%Name%") ) = _T("Bar");
+		parser.LookupLiteralValue( _T("$(Kind)") ) = _T("struct");		// not a "%Identifier%" key
+
+		ut::ParseString( &parser, "\
+[[S1]]\n\
+<<DECL>>$\n\
+// 100% %Name%, %Unknown% %%Name%%[[EOS]]\n\
+[[DECL]]\n\
+$(Kind) %Name% {};\n\
+[[EOS]]\
+");
+		ASSERT_EQUAL_SWAP( parser.ExpandSection( _T("S1") ),
+						   _T("\
+struct Bar {};\n\
+// 100% Bar, %Unknown% %Bar%\
+") );
+		ASSERT_EQUAL( _T("<<DECL>>$\n// 100% %Name%, %Unknown% %%Name%%"), *parser.FindSection( _T("S1") ) );		// raw content is not altered by expansion
+
+		parser.LookupLiteralValue( _T("%Name%") ) = _T("Foo");
+		ASSERT_EQUAL( _T("struct Foo {};\n"), parser.ExpandSection( _T("DECL") ) );		// literal values resolved on each expansion
+	}
+
+	{	// literals are replaced in registration order, rather than matched as "%Identifier%" tokens
+		parser.LookupLiteralValue( _T("%Outer%") ) = _T("<%Inner%>");		// the value contains the key of a literal registered later
+		parser.LookupLiteralValue( _T("%Inner%") ) = _T("in");
+
+		ut::ParseString( &parser, "[[S1]]%d%YEAR% %Outer%[[EOS]]" );
+		ASSERT_EQUAL( _T("%d") + *parser.FindLiteralValue( _T("%YEAR%") ) + _T(" <in>"), parser.ExpandSection( _T("S1") ) );
+	}
+
+	{	// cross-reference errors
+		ut::ParseString( &parser, "\
+[[S1]]<<Missing>>[[EOS]]\n\
+[[CYCLE]]x<<CYCLE>>[[EOS]]\
+");
+		ASSERT_THROWS( CRuntimeException, parser.ExpandSection( _T("S1") ) );
+		ASSERT_THROWS( CRuntimeException, parser.ExpandSection( _T("CYCLE") ) );
+	}
+
+	{	// compiled cache: keyed by file path and output line-end, invalidated by file size or modify time
+		ut::CTempFilePool pool;
+		const fs::CPath filePath = pool.QualifyPath( _T("snippets.txt") );
+		{
+			std::ofstream output( filePath.GetPtr(), std::ios_base::out | std::ios_base::binary );
+			output << "[[S1]]\nLine\n[[EOS]]\n";
+		}
+
+		CCodeSnippetsParser lfParser( _T("\n") ), crlfParser( _T("\r\n") );
+		lfParser.LoadFile( filePath );
+		crlfParser.LoadFile( filePath );
+		ASSERT_EQUAL( _T("Line\n"), lfParser.ExpandSection( _T("S1") ) );
+		ASSERT_EQUAL( _T("Line\r\n"), crlfParser.ExpandSection( _T("S1") ) );
+
+		{
+			std::ofstream output( filePath.GetPtr(), std::ios_base::out | std::ios_base::binary );
+			output << "[[S1]]\nLonger Line\n[[EOS]]\n";		// likely within the same modify time second
+		}
+		lfParser.LoadFile( filePath );
+		ASSERT_EQUAL( _T("Longer Line\n"), lfParser.ExpandSection( _T("S1") ) );
+	}
 }
 
 void CCppCodeTests::TestIterationSlices( void )
@@ -415,6 +480,112 @@ void CCppCodeTests::TestExtractTemplateInstance( void )
 	}
 }
 
+void CCppCodeTests::TestIncludeGraph( void )
+{
+	inc::CIncludeGraph graph;
+
+	// a.cpp -> x.h, y.h;  b.cpp -> y.h;  x.h -> z.h;  y.h <-> z.h (cycle)
+	size_t a = graph.AddTranslationUnit( fs::CPath( _T("C:\\Proj\\a.cpp") ) );
+	size_t b = graph.AddTranslationUnit( fs::CPath( _T("C:\\Proj\\b.cpp") ) );
+	size_t x = graph.RegisterFile( fs::CPath( _T("C:\\Proj\\x.h") ) ).first;
+	size_t y = graph.RegisterFile( fs::CPath( _T("C:\\Proj\\y.h") ) ).first;
+	size_t z = graph.RegisterFile( fs::CPath( _T("C:\\Proj\\z.h") ) ).first;
+
+	ASSERT( !graph.RegisterFile( fs::CPath( _T("C:\\PROJ\\X.h") ) ).second );		// memoized (case-insensitive)
+	ASSERT_EQUAL( 5, graph.GetNodeCount() );
+	ASSERT_EQUAL( 2, graph.GetTranslationUnitCount() );
+
+	graph.RefNodeAt( a )->m_fileSize = 100;
+	graph.RefNodeAt( b )->m_fileSize = 200;
+	graph.RefNodeAt( x )->m_fileSize = 10;
+	graph.RefNodeAt( y )->m_fileSize = 20;
+	graph.RefNodeAt( z )->m_fileSize = 5;
+
+	graph.AddInclude( a, x );
+	graph.AddInclude( a, y );
+	graph.AddInclude( b, y );
+	graph.AddInclude( x, z );
+	graph.AddInclude( y, z );
+	graph.AddInclude( z, y );
+	graph.ComputeMetrics();
+
+	ASSERT_EQUAL( 1, graph.GetCycles().size() );
+	ASSERT_EQUAL( 2, graph.GetCycles().front().size() );
+	ASSERT( graph.GetNodeAt( y )->m_inCycle && graph.GetNodeAt( z )->m_inCycle );
+	ASSERT( !graph.GetNodeAt( x )->m_inCycle );
+
+	ASSERT_EQUAL( 3, graph.GetNodeAt( a )->m_transitiveCount );
+	ASSERT_EQUAL( 135, graph.GetNodeAt( a )->m_transitiveBytes );
+	ASSERT_EQUAL( 2, graph.GetNodeAt( x )->m_transitiveCount );
+	ASSERT_EQUAL( 35, graph.GetNodeAt( x )->m_transitiveBytes );
+	ASSERT_EQUAL( 1, graph.GetNodeAt( y )->m_transitiveCount );
+	ASSERT_EQUAL( 25, graph.GetNodeAt( y )->m_transitiveBytes );
+
+	ASSERT_EQUAL( 1, graph.GetNodeAt( x )->m_unitRefCount );
+	ASSERT_EQUAL( 2, graph.GetNodeAt( y )->m_unitRefCount );
+	ASSERT_EQUAL( 2, graph.GetNodeAt( z )->m_unitRefCount );
+
+	std::vector<const inc::CGraphNode*> headers;
+	graph.QueryHeaviestHeaders( headers );
+	ASSERT_EQUAL( 3, headers.size() );
+	ASSERT( graph.GetNodeAt( y ) == headers[ 0 ] );			// 2 units x 25 bytes
+	ASSERT( graph.GetNodeAt( z ) == headers[ 1 ] );
+	ASSERT( graph.GetNodeAt( x ) == headers[ 2 ] );			// 1 unit x 35 bytes
+
+	graph.AddInclude( x, x );				// self-include
+	graph.ComputeMetrics();
+	ASSERT_EQUAL( 2, graph.GetCycles().size() );
+	ASSERT( graph.GetNodeAt( x )->m_inCycle );
+	ASSERT_EQUAL( 2, graph.GetNodeAt( x )->m_transitiveCount );
+
+	std::string report = graph.FormatJsonReport( 1 );
+	ASSERT( report.find( "\"translationUnits\": 2," ) != std::string::npos );
+	ASSERT( report.find( "\"path\": \"C:\\\\Proj\\\\y.h\", \"size\": 20, \"directIncludes\": 1, \"transitiveIncludes\": 1, \"transitiveBytes\": 25, \"includedByUnits\": 2, \"buildCost\": 50" ) != std::string::npos );
+	ASSERT( report.find( "x.h\", \"size" ) == std::string::npos );		// only the heaviest header
+}
+
+void CCppCodeTests::TestIncludeDirIndex( void )
+{
+	ut::CTempFilePool pool( _T("Header.h|sub\\Nested.h") );
+	ASSERT( pool.IsValidPool() );
+
+	const fs::TDirPath& dirPath = pool.GetPoolDirPath();
+	inc::CDirIndex& dirIndex = inc::CDirIndex::Instance();
+
+	dirIndex.Invalidate();
+	ASSERT_EQUAL( 0, dirIndex.GetListingCount() );
+
+	// hits (case-insensitive) and misses, listing the directories on demand
+	ASSERT( dirIndex.FileExist( dirPath, fs::CPath( _T("Header.h") ) ) );
+	ASSERT( dirIndex.FileExist( dirPath, fs::CPath( _T("HEADER.H") ) ) );
+	ASSERT( dirIndex.FileExist( dirPath, fs::CPath( _T("sub/Nested.h") ) ) );
+	ASSERT( dirIndex.FileExist( dirPath, fs::CPath( _T("sub\\Nested.h") ) ) );
+	ASSERT_EQUAL( 2, dirIndex.GetListingCount() );
+
+	ASSERT( !dirIndex.FileExist( dirPath, fs::CPath( _T("Missing.h") ) ) );
+	ASSERT( !dirIndex.FileExist( dirPath, fs::CPath( _T("Nested.h") ) ) );			// not in the parent directory
+	ASSERT( !dirIndex.FileExist( dirPath, fs::CPath( _T("missing/Nested.h") ) ) );
+	ASSERT( !dirIndex.FileExist( dirPath, fs::CPath( _T("Header.h/Nested.h") ) ) );	// a file is not a sub-directory
+	ASSERT( dirIndex.FileExist( dirPath / _T("sub"), fs::CPath( _T("..\\Header.h") ) ) );	// not a plain relative path: probes the file system
+	ASSERT_EQUAL( 2, dirIndex.GetListingCount() );
+
+	// a file added after the listing: found once the listing is revalidated (the directory modify time has changed)
+	::Sleep( inc::CDirIndex::ValidateMs + 1000 );			// also past the 1 second resolution of the modify time
+	ASSERT( pool.CreateFiles( _T("Added.h") ) );
+	ASSERT( dirIndex.FileExist( dirPath, fs::CPath( _T("Added.h") ) ) );
+
+	ASSERT( pool.CreateFiles( _T("Later.h") ) );
+	ASSERT( !dirIndex.FileExist( dirPath, fs::CPath( _T("Later.h") ) ) );			// listing just revalidated: stale for up to ValidateMs
+
+	// invalidated: rescanned on next use
+	dirIndex.Invalidate();
+	ASSERT_EQUAL( 0, dirIndex.GetListingCount() );
+	ASSERT( dirIndex.FileExist( dirPath, fs::CPath( _T("Later.h") ) ) );
+	ASSERT_EQUAL( 1, dirIndex.GetListingCount() );
+
+	dirIndex.Invalidate();			// don't keep the listings of the temporary directory
+}
+
 
 void CCppCodeTests::Run( void )
 {
@@ -422,6 +593,8 @@ void CCppCodeTests::Run( void )
 	RUN_TEST( TestIterationSlices );
 	RUN_TEST( TestResolveDefaultParams );
 	RUN_TEST( TestExtractTemplateInstance );
+	RUN_TEST( TestIncludeGraph );
+	RUN_TEST( TestIncludeDirIndex );
 }
 
 
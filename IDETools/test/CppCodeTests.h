@@ -21,6 +21,8 @@ private:
 	void TestIterationSlices( void );
 	void TestResolveDefaultParams( void );
 	void TestExtractTemplateInstance( void );
+	void TestIncludeGraph( void );
+	void TestIncludeDirIndex( void );
 };
 
 
@@ -0,0 +1,248 @@
+
+#include "pch.h"
+
+#ifdef USE_UT		// no UT code in release builds
+#include "utl/StringUtilities.h"
+#include "utl/Timer.h"
+#include "Formatter.h"
+#include "FormatterOptions.h"
+#include "test/FormatterTests.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+
+namespace ut
+{
+	// regression corpus: mixed indentation, operators, braces, casts, string constants, comments, and line ends
+	static const TCHAR s_corpusCode[] = _T("\
+#include \"pch.h\"\r\n\
+\r\n\
+namespace  code\r\n\
+{\r\n\
+\tint   Func( int a,int b )\r\n\
+\t{\r\n\
+\t    if(a<b&&b!=0)\r\n\
+\t\t\treturn(int)( a*b )  ;\t\t// multiply  them\r\n\
+\t\tfor(int i=0;i!=10;++i){ total+=i; }\r\n\
+        std::pair<int,int> range=std::make_pair( a ,b );\r\n\
+\t\tconst TCHAR* pText=_T(\"quoted   (  text  )\" );\r\n\
+\t\tdouble value = ( double )a/b ;    /*  block  comment  */\r\n\
+\t\tarray[ i ]=( ( a ) );   \t   \r\n\
+\t\tCallback( ( void* )this, [ ], {  } );\r\n\
+\t\tbool flag = !( a>=b )||( a<=b );\r\n\
+\t}\r\n\
+}\n\
+unix_line( a,b );\n\
+\r\n\
+  \t  \r\n\
+trailing_line_without_end( x )");
+
+	// golden output of the corpus, as formatted by the line-by-line formatter prior to the single-pass rewrite
+	static const TCHAR s_formattedSpacesCode[] = _T("\
+#include \"pch.h\"\r\n\
+\r\n\
+namespace code\r\n\
+{\r\n\
+    int Func( int a, int b )\r\n\
+    {\r\n\
+        if( a<b && b != 0 )\r\n\
+            return( int )( a*b );\t\t// multiply  them\r\n\
+        for( int i = 0; i != 10; ++i ){ total += i; }\r\n\
+        std::pair<int, int> range = std::make_pair( a, b );\r\n\
+        const TCHAR* pText = _T(\"quoted   (  text  )\");\r\n\
+        double value = (double)a/b;    /*  block  comment  */\r\n\
+        array[ i ] = ( ( a ) );\r\n\
+        Callback( (void*)this, [ ], { } );\r\n\
+        bool flag = !( a >= b ) || ( a <= b );\r\n\
+    }\r\n\
+}\n\
+unix_line( a, b );\n\
+\r\n\
+\r\n\
+trailing_line_without_end( x )");
+
+	static const TCHAR s_adjustedSpacesCode[] = _T("\
+#include \"pch.h\"\r\n\
+\r\n\
+namespace code\r\n\
+{\r\n\
+    int Func( int a,int b )\r\n\
+    {\r\n\
+        if(a<b&&b!=0)\r\n\
+            return(int)( a*b ) ;\t\t// multiply  them\r\n\
+        for(int i=0;i!=10;++i){ total+=i; }\r\n\
+        std::pair<int,int> range=std::make_pair( a ,b );\r\n\
+        const TCHAR* pText=_T(\"quoted   (  text  )\" );\r\n\
+        double value = ( double )a/b ;    /*  block  comment  */\r\n\
+        array[ i ]=( ( a ) );\r\n\
+        Callback( ( void* )this, [ ], { } );\r\n\
+        bool flag = !( a>=b )||( a<=b );\r\n\
+    }\r\n\
+}\n\
+unix_line( a,b );\n\
+\r\n\
+\r\n\
+trailing_line_without_end( x )");
+
+	static const TCHAR s_formattedTabsCode[] = _T("\
+#include \"pch.h\"\r\n\
+\r\n\
+namespace code\r\n\
+{\r\n\
+\tint Func( int a, int b )\r\n\
+\t{\r\n\
+\t\tif( a<b && b != 0 )\r\n\
+\t\t\treturn( int )( a*b );\t\t// multiply  them\r\n\
+\t\tfor( int i = 0; i != 10; ++i ){ total += i; }\r\n\
+\t\tstd::pair<int, int> range = std::make_pair( a, b );\r\n\
+\t\tconst TCHAR* pText = _T(\"quoted   (  text  )\");\r\n\
+\t\tdouble value = (double)a/b;    /*  block  comment  */\r\n\
+\t\tarray[ i ] = ( ( a ) );\r\n\
+\t\tCallback( (void*)this, [ ], { } );\r\n\
+\t\tbool flag = !( a >= b ) || ( a <= b );\r\n\
+\t}\r\n\
+}\n\
+unix_line( a, b );\n\
+\r\n\
+\r\n\
+trailing_line_without_end( x )");
+
+	static const TCHAR s_adjustedTabsCode[] = _T("\
+#include \"pch.h\"\r\n\
+\r\n\
+namespace code\r\n\
+{\r\n\
+\tint Func( int a,int b )\r\n\
+\t{\r\n\
+\t\tif(a<b&&b!=0)\r\n\
+\t\t\treturn(int)( a*b ) ;\t\t// multiply  them\r\n\
+\t\tfor(int i=0;i!=10;++i){ total+=i; }\r\n\
+\t\tstd::pair<int,int> range=std::make_pair( a ,b );\r\n\
+\t\tconst TCHAR* pText=_T(\"quoted   (  text  )\" );\r\n\
+\t\tdouble value = ( double )a/b ;    /*  block  comment  */\r\n\
+\t\tarray[ i ]=( ( a ) );\r\n\
+\t\tCallback( ( void* )this, [ ], { } );\r\n\
+\t\tbool flag = !( a>=b )||( a<=b );\r\n\
+\t}\r\n\
+}\n\
+unix_line( a,b );\n\
+\r\n\
+\r\n\
+trailing_line_without_end( x )");
+
+	static const TCHAR* s_expectedCode[ 2 ][ 2 ] =		// indexed by [ useTabs ][ justAdjustWhiteSpace ]
+	{
+		{ s_formattedSpacesCode, s_adjustedSpacesCode },
+		{ s_formattedTabsCode, s_adjustedTabsCode }
+	};
+
+
+	std::tstring FormatCodeByLines( code::CFormatter& rFormatter, const std::tstring& codeText, bool justAdjustWhiteSpace )
+	{	// reference: split into lines, format each line, then join with the original line ends
+		static const std::tstring s_lineEnd = _T("\r\n");
+		std::tstring outCodeText;
+
+		if ( codeText.empty() )
+			return outCodeText;
+
+		for ( size_t pos = 0; ; )
+		{
+			size_t lineEndPos = codeText.find( s_lineEnd, pos );
+			std::tstring line = codeText.substr( pos, lineEndPos != std::tstring::npos ? lineEndPos - pos : std::tstring::npos );
+
+			outCodeText += rFormatter.formatLineOfCode( line.c_str(), true, justAdjustWhiteSpace ).GetString();
+
+			if ( std::tstring::npos == lineEndPos )
+				break;
+
+			outCodeText += s_lineEnd;
+			pos = lineEndPos + s_lineEnd.length();
+		}
+
+		return outCodeText;
+	}
+
+	std::tstring MakeLargeCode( size_t corpusCount )
+	{
+		std::tstring codeText;
+
+		for ( size_t i = 0; i != corpusCount; ++i )
+		{
+			codeText += s_corpusCode;
+			codeText += _T("\r\n");
+		}
+		return codeText;
+	}
+}
+
+
+CFormatterTests::CFormatterTests( void )
+{
+	ut::CTestSuite::Instance().RegisterTestCase( this );		// self-registration
+}
+
+CFormatterTests& CFormatterTests::Instance( void )
+{
+	static CFormatterTests s_testCase;
+	return s_testCase;
+}
+
+void CFormatterTests::TestFormatCodeCorpus( void )
+{
+	code::CFormatterOptions options( true );		// test with default options, not customized by user
+	code::CFormatter formatter( options );
+	formatter.setDocLanguage( DocLang_Cpp );
+
+	ASSERT_EQUAL( _T(""), formatter.formatCode( _T("") ).GetString() );
+	ASSERT_EQUAL( _T("\r\n\r\n"), formatter.formatCode( _T("\r\n\r\n") ).GetString() );
+
+	// the single-pass formatCode() must produce the golden output, same as formatting line by line
+	std::tstring corpusCode = ut::s_corpusCode;
+
+	for ( int useTabs = 0; useTabs != 2; ++useTabs )
+	{
+		formatter.setUseTabs( useTabs != 0 );
+
+		ASSERT_EQUAL( ut::s_expectedCode[ useTabs ][ false ], formatter.formatCode( corpusCode.c_str() ).GetString() );
+		ASSERT_EQUAL( ut::s_expectedCode[ useTabs ][ true ], formatter.formatCode( corpusCode.c_str(), true, true ).GetString() );
+
+		ASSERT_EQUAL( ut::FormatCodeByLines( formatter, corpusCode, false ), formatter.formatCode( corpusCode.c_str() ).GetString() );
+		ASSERT_EQUAL( ut::FormatCodeByLines( formatter, corpusCode, true ), formatter.formatCode( corpusCode.c_str(), true, true ).GetString() );
+	}
+
+	// each line is formatted independently of its neighbours
+	std::tstring largeCode = ut::MakeLargeCode( 10 );
+	ASSERT_EQUAL( ut::FormatCodeByLines( formatter, largeCode, false ), formatter.formatCode( largeCode.c_str() ).GetString() );
+}
+
+void CFormatterTests::TestFormatCodeThroughput( void )
+{
+	code::CFormatterOptions options( true );
+	code::CFormatter formatter( options );
+	formatter.setDocLanguage( DocLang_Cpp );
+
+	std::tstring largeCode = ut::MakeLargeCode( 250 );		// ~5000 lines
+
+	CTimer timer;
+	std::tstring byLinesCode = ut::FormatCodeByLines( formatter, largeCode, false );
+	double byLinesElapsed = timer.ElapsedSeconds();
+
+	timer.Restart();
+	CString formattedCode = formatter.formatCode( largeCode.c_str() );
+	double singlePassElapsed = timer.ElapsedSeconds();
+
+	ASSERT_EQUAL( byLinesCode, formattedCode.GetString() );
+	UT_TRACE( str::Format( _T("(format %d KB: by lines %.3f sec, single-pass %.3f sec)  "), static_cast<int>( largeCode.length() / 1024 ), byLinesElapsed, singlePassElapsed ).c_str() );
+}
+
+
+void CFormatterTests::Run( void )
+{
+	RUN_TEST( TestFormatCodeCorpus );
+	RUN_TEST( TestFormatCodeThroughput );
+}
+
+
+#endif //USE_UT
@@ -0,0 +1,28 @@
+#ifndef FormatterTests_h
+#define FormatterTests_h
+#pragma once
+
+
+#ifdef USE_UT		// no UT code in release builds
+
+#include "utl/test/UnitTest.h"
+
+
+class CFormatterTests : public ut::CConsoleTestCase
+{
+	CFormatterTests( void );
+public:
+	static CFormatterTests& Instance( void );
+
+	// ut::ITestCase interface
+	virtual void Run( void );
+private:
+	void TestFormatCodeCorpus( void );
+	void TestFormatCodeThroughput( void );
+};
+
+
+#endif //USE_UT
+
+
+#endif // FormatterTests_h
@@ -13,6 +13,7 @@
 
 CAppCmdService::CAppCmdService( void )
 	: CCommandService()
+	, m_pPersist( new CCommandModelPersist( m_pCommandModel.get() ) )
 {
 }
 
@@ -20,7 +21,7 @@ CAppCmdService::~CAppCmdService()
 {
 }
 
-bool CAppCmdService::SaveCommandModel( void )
+bool CAppCmdService::SaveCommandModel( bool atExit /*= false*/ )
 {
 	if ( !CGeneralOptions::Instance().m_undoLogPersist )
 		return false;
@@ -29,7 +30,7 @@ bool CAppCmdService::SaveCommandModel( void )
 	m_pCommandModel->RemoveExpiredCommands( MaxCommands );
 	RemoveCommandsThat( pred::IsZombieCmd() );		// zombie command: it has no effect on files (in most cases empty macros due to non-existing files)
 
-	if ( !CCommandModelPersist::SaveUndoLog( m_pCommandModel.get() ) )
+	if ( !m_pPersist->SaveUndoLog( CGeneralOptions::Instance().m_undoLogFormat, atExit ) )
 		return false;
 
 	SetDirty( false );
@@ -41,7 +42,7 @@ bool CAppCmdService::LoadCommandModel( void )
 	ASSERT( m_pCommandModel->IsUndoEmpty() && m_pCommandModel->IsRedoEmpty() );		// load once
 
 	if ( CGeneralOptions::Instance().m_undoLogPersist )
-		if ( CCommandModelPersist::LoadUndoLog( m_pCommandModel.get() ) )			// load the most recently modified log file (regardless of CGeneralOptions::m_undoLogFormat)
+		if ( m_pPersist->LoadUndoLog() )			// load the most recently modified log file (regardless of CGeneralOptions::m_undoLogFormat)
 		{
 			SetDirty( false );
 			return true;
@@ -59,6 +60,31 @@ bool CAppCmdService::SafeExecuteCmd( utl::ICommand* pCmd, bool execInline /*= fa
 	return CCommandService::SafeExecuteCmd( pCmd, execInline );
 }
 
+bool CAppCmdService::UndoRedo( svc::StackType stackType )
+{
+	bool succeeded = CCommandService::UndoRedo( stackType );
+
+	AppendJournal();
+	return succeeded;
+}
+
+bool CAppCmdService::Execute( utl::ICommand* pCmd )
+{
+	if ( !CCommandService::Execute( pCmd ) )
+		return false;
+
+	AppendJournal();
+	return true;
+}
+
+void CAppCmdService::AppendJournal( void )
+{
+	const CGeneralOptions& options = CGeneralOptions::Instance();
+
+	if ( options.m_undoLogPersist && cmd::JournalFormat == options.m_undoLogFormat )
+		m_pPersist->SaveUndoLog( cmd::JournalFormat );		// remains dirty: expired and zombie commands are cleaned up by the final save
+}
+
 bool CAppCmdService::UndoAt( size_t topPos )
 {
 	std::deque<utl::ICommand*>& rUndoStack = RefUndoStack();
@@ -134,5 +160,9 @@ bool CAppCmdService::RedoAt( size_t topPos )
 bool CAppCmdService::UndoRedoAt( svc::StackType stackType, size_t topPos )
 {
 	SetDirty( true );
-	return svc::Undo == stackType ? UndoAt( topPos ) : RedoAt( topPos );
+
+	bool succeeded = svc::Undo == stackType ? UndoAt( topPos ) : RedoAt( topPos );
+
+	AppendJournal();
+	return succeeded;
 }
@@ -6,23 +6,32 @@
 #include "Application_fwd.h"
 
 
+class CCommandModelPersist;
+
+
 class CAppCmdService : public CCommandService
 {
 public:
 	CAppCmdService( void );
 	~CAppCmdService();
 
-	bool SaveCommandModel( void );
+	bool SaveCommandModel( bool atExit = false );		// at exit: no thread pool work is submitted under the loader lock
 	bool LoadCommandModel( void );
 
 	// base overrides
 	virtual bool SafeExecuteCmd( utl::ICommand* pCmd, bool execInline = false );
+	virtual bool UndoRedo( svc::StackType stackType );
+	virtual bool Execute( utl::ICommand* pCmd );
 
 	bool UndoRedoAt( svc::StackType stackType, size_t topPos );
 private:
 	bool UndoAt( size_t topPos );
 	bool RedoAt( size_t topPos );
+
+	void AppendJournal( void );			// journals the executed command right away, so that it is not lost if the host process crashes
 private:
+	std::auto_ptr<CCommandModelPersist> m_pPersist;		// keeps the undo journal state between saves
+
 	enum { MaxCommands = 60 };
 };
 
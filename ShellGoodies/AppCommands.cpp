@@ -33,6 +33,7 @@ namespace cmd
 			s_tags.AddTagPair( _T("Paste Create Deep Folders"), _T("PASTE_CREATE_DEEP_FOLDERS") );
 			s_tags.AddTagPair( _T("Copy and Paste Files as Backup"), _T("COPY_PASTE_FILES_AS_BACKUP") );
 			s_tags.AddTagPair( _T("Cut and Paste Files as Backup"), _T("CUT_PASTE_FILES_AS_BACKUP") );
+			s_tags.AddTagPair( _T("Replace Duplicates with Hard Links"), _T("LINK_DUPLICATE_FILES") );
 
 			// transient commands
 			s_tags.AddTagPair( _T("Change Destination Paths"), _T("CHANGE_DEST_PATHS") );
@@ -42,6 +43,7 @@ namespace cmd
 			s_tags.AddTagPair( _T("SortRenameList") );
 			s_tags.AddTagPair( _T("OnRenameListSelChanged") );
 			s_tags.AddTagPair( _T("Undelete Files"), _T("UNDELETE_FILES") );
+			s_tags.AddTagPair( _T("Unlink Files"), _T("UNLINK_FILES") );
 		}
 		return s_tags;
 	}
@@ -17,13 +17,14 @@ namespace cmd
 		RenameFile = 100, TouchFile, FindDuplicates,
 		DeleteFiles, CopyFiles, PasteCopyFiles, MoveFiles, PasteMoveFiles, CreateFolders, PasteCreateFolders, PasteCreateDeepFolders,
 		CopyPasteFilesAsBackup, CutPasteFilesAsBackup,
+		LinkDuplicateFiles,
 
 		// transient commands (not persistent)
 		ChangeDestPaths, ChangeDestFileStates, ResetDestinations,
 		EditOptions,
 		SortRenameList, OnRenameListSelChanged,
 
-		Priv_UndeleteFiles
+		Priv_UndeleteFiles, Priv_UnlinkFiles
 	};
 
 	const CEnumTags& GetTags_CommandType( void );
@@ -33,7 +34,7 @@ namespace cmd
 	std::tstring FormatResetItemsTag( size_t selItemsSize, size_t allItemsSize );
 
 
-	enum FileFormat { BinaryFormat };
+	enum FileFormat { BinaryFormat, JournalFormat };
 
 
 	interface IFileDetailsCmd
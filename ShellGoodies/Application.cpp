@@ -4,6 +4,7 @@
 #include "AppCmdService.h"
 #include "GeneralOptions.h"
 #include "IFileEditor.h"
+#include "test/CommandModelPersistTests.h"
 #include "test/TextAlgorithmsTests.h"
 #include "test/RenameFilesTests.h"
 #include "utl/EnumTags.h"
@@ -35,6 +36,7 @@ namespace ut
 	#ifdef USE_UT
 		CTextAlgorithmsTests::Instance();
 		CRenameFilesTests::Instance();
+		CCommandModelPersistTests::Instance();
 	#endif
 	}
 }
@@ -122,7 +124,7 @@ int CApplication::ExitInstance( void ) override
 	if ( IsInitAppResources() )
 	{
 		if ( m_pCmdSvc->IsDirty() )
-			m_pCmdSvc->SaveCommandModel();
+			m_pCmdSvc->SaveCommandModel( true );
 
 		m_pCmdSvc.reset();
 		m_pSystemTray.reset();
@@ -4,6 +4,7 @@
 #include "utl/AppTools.h"
 #include "utl/Command.h"
 #include "utl/CommandModel.h"
+#include "utl/CRC32.h"
 #include "utl/EnumTags.h"
 #include "utl/FileSystem.h"
 #include "utl/Guards.h"
@@ -21,28 +22,55 @@
 
 // CCommandModelPersist class
 
-bool CCommandModelPersist::SaveUndoLog( CCommandModel* pCommandModel )
+CCommandModelPersist::CCommandModelPersist( CCommandModel* pCommandModel )
+	: m_pCommandModel( pCommandModel )
+	, m_pJournal( new cmd::CJournalLogSerializer( pCommandModel ) )
+{
+	ASSERT_PTR( m_pCommandModel );
+}
+
+CCommandModelPersist::~CCommandModelPersist()
+{
+}
+
+bool CCommandModelPersist::SaveUndoLog( cmd::FileFormat fileFormat, bool atExit /*= false*/ )
 {
 	//utl::CSlowSectionGuard slow( _T("CCommandModelPersist::SaveUndoLog"), 0.01 );
 
-	cmd::CBinaryLogSerializer serializer( pCommandModel );
-	return serializer.Save( GetUndoLogPath() );
+	if ( cmd::JournalFormat == fileFormat )
+	{
+		m_pJournal->SetAsyncCompaction( !atExit );
+		return m_pJournal->Save( GetUndoLogPath( cmd::JournalFormat ) );
+	}
+
+	cmd::CBinaryLogSerializer serializer( m_pCommandModel );
+	return serializer.Save( GetUndoLogPath( cmd::BinaryFormat ) );
 }
 
-bool CCommandModelPersist::LoadUndoLog( CCommandModel* pOutCommandModel )
+bool CCommandModelPersist::LoadUndoLog( void )
 {
 	//utl::CSlowSectionGuard slow( _T("CCommandModelPersist::LoadUndoLog()"), 0.01 );
-	cmd::CBinaryLogSerializer serializer( pOutCommandModel );
-	return serializer.Load( GetUndoLogPath() );
+	const fs::CPath journalPath = GetUndoLogPath( cmd::JournalFormat );
+	const fs::CPath binaryPath = GetUndoLogPath( cmd::BinaryFormat );
+
+	if ( fs::IsValidFile( journalPath.GetPtr() ) )
+		if ( !fs::IsValidFile( binaryPath.GetPtr() ) || fs::ReadLastModifyTime( journalPath ) >= fs::ReadLastModifyTime( binaryPath ) )
+			return m_pJournal->Load( journalPath );
+
+	if ( !fs::IsValidFile( binaryPath.GetPtr() ) )
+		return false;
+
+	cmd::CBinaryLogSerializer serializer( m_pCommandModel );
+	return serializer.Load( binaryPath );				// legacy log: the next journal save writes a snapshot
 }
 
-fs::CPath CCommandModelPersist::GetUndoLogPath( void )
+fs::CPath CCommandModelPersist::GetUndoLogPath( cmd::FileFormat fileFormat )
 {
-	static const CEnumTags s_logExtTags( _T(".dat") );
+	static const CEnumTags s_logExtTags( _T(".dat|.jrn") );
 	fs::CPathParts parts( app::GetModulePath().Get() );
 
 	parts.m_fname += _T("_undo");
-	parts.m_ext = s_logExtTags.FormatUi( cmd::BinaryFormat );
+	parts.m_ext = s_logExtTags.FormatUi( fileFormat );
 	return fs::CPath( parts.MakePath() );
 }
 
@@ -104,3 +132,572 @@ namespace cmd
 	}
 
 } //namespace cmd
+
+
+namespace cmd
+{
+	namespace impl
+	{
+		struct CJournalHeader
+		{
+			char m_tag[ 4 ];
+			UINT m_version;
+		};
+
+		struct CRecordHeader		// followed by m_dataSize bytes: the UINT argument, then the record data
+		{
+			BYTE m_type;
+			BYTE m_reserved[ 3 ];
+			UINT m_dataSize;
+			UINT m_checksum;		// CRC32 of the preceding header fields and the data
+		};
+
+		enum { JournalVersion = 1 };
+
+
+		UINT ComputeRecordChecksum( const CRecordHeader& header, const BYTE* pData )
+		{
+			utl::TCrc32Checksum checksum;
+			checksum.ProcessBytes( &header, offsetof( CRecordHeader, m_checksum ) );
+			checksum.ProcessBytes( pData, header.m_dataSize );
+			return checksum.GetResult();
+		}
+
+		UINT ReadUInt( const BYTE* pData ) { UINT value; memcpy( &value, pData, sizeof( UINT ) ); return value; }
+
+		bool WriteFileBytes( HANDLE hFile, const std::vector<BYTE>& bytes )
+		{
+			DWORD writtenSize = 0;
+			return bytes.empty() ||
+				( ::WriteFile( hFile, &bytes.front(), static_cast<DWORD>( bytes.size() ), &writtenSize, nullptr ) && writtenSize == bytes.size() );
+		}
+
+		bool AppendToJournal( const fs::CPath& journalPath, UINT64 validSize, const std::vector<BYTE>& records )
+		{	// overwrites any dropped tail after validSize; no flush: a torn tail is dropped on load
+			fs::CHandle file( ::CreateFile( journalPath.GetPtr(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr ) );
+			if ( !file.IsValid() )
+				return false;
+
+			LARGE_INTEGER offset;
+			offset.QuadPart = static_cast<LONGLONG>( validSize );
+
+			return
+				::SetFilePointerEx( file.Get(), offset, nullptr, FILE_BEGIN ) &&
+				WriteFileBytes( file.Get(), records ) &&
+				::SetEndOfFile( file.Get() );
+		}
+
+		bool ReplaceJournal( const fs::CPath& journalPath, const std::vector<BYTE>& snapshot )
+		{	// write to a temporary file, then replace: the journal is never left half-written
+			fs::CPath tempPath( journalPath.Get() + _T(".tmp") );
+
+			{
+				fs::CHandle file( ::CreateFile( tempPath.GetPtr(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr ) );
+				if ( !file.IsValid() )
+					return false;
+
+				if ( !WriteFileBytes( file.Get(), snapshot ) || !::FlushFileBuffers( file.Get() ) )
+				{
+					file.Close();
+					::DeleteFile( tempPath.GetPtr() );
+					return false;
+				}
+			}
+
+			return ::MoveFileEx( tempPath.GetPtr(), journalPath.GetPtr(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH ) != FALSE;
+		}
+	}
+
+
+	// CJournalLogSerializer implementation
+
+	const char CJournalLogSerializer::s_fileTag[ 4 ] = { 'S', 'G', 'U', 'J' };
+
+	CJournalLogSerializer::CJournalLogSerializer( CCommandModel* pCommandModel )
+		: CLogSerializer( pCommandModel )
+		, m_nextCmdId( 1 )
+		, m_journalSize( 0 )
+		, m_liveSize( sizeof( impl::CJournalHeader ) )
+		, m_asyncCompaction( true )
+		, m_pCompactWork( nullptr )
+		, m_compactSucceeded( false )
+	{
+	}
+
+	CJournalLogSerializer::~CJournalLogSerializer()
+	{
+		WaitCompaction( true );			// destroyed at DLL unload: don't wait for a pool thread that is not started yet
+	}
+
+	bool CJournalLogSerializer::Save( const fs::CPath& journalPath ) override
+	{
+		WaitCompaction( !m_asyncCompaction );
+
+		std::vector<BYTE> records;
+		CImage newImage;
+
+		try
+		{
+			BuildDelta( records, newImage );
+		}
+		catch ( CException* pExc )
+		{
+			app::TraceException( pExc );
+			pExc->Delete();
+			return false;
+		}
+
+		bool inSync = IsJournalInSync( journalPath );
+
+		if ( inSync && records.empty() )
+		{
+			m_image.m_cmdIds.swap( newImage.m_cmdIds );		// same persisted state
+			return true;
+		}
+
+		if ( inSync )
+		{
+			if ( !impl::AppendToJournal( journalPath, m_journalSize, records ) )
+				return false;
+
+			m_journalSize += records.size();
+			ApplyDelta( newImage );
+		}
+		else
+		{	// new journal, or overwritten by another process: start over with a snapshot
+			ApplyDelta( newImage );
+
+			std::vector<BYTE> snapshot;
+			BuildSnapshot( snapshot, m_image );
+
+			if ( !impl::ReplaceJournal( journalPath, snapshot ) )
+			{
+				m_journalSize = 0;			// the next save writes a snapshot again
+				return false;
+			}
+
+			m_journalSize = snapshot.size();
+		}
+
+		StoreSyncState( journalPath );
+
+		if ( NeedsCompaction() )
+		{
+			std::vector<BYTE> snapshot;
+			BuildSnapshot( snapshot, m_image );
+			StartCompaction( journalPath, snapshot );
+		}
+		return true;
+	}
+
+	bool CJournalLogSerializer::Load( const fs::CPath& journalPath ) override
+	{
+		WaitCompaction();
+
+		fs::CHandle file( ::CreateFile( journalPath.GetPtr(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr ) );
+		LARGE_INTEGER fileSize;
+
+		if ( !file.IsValid() || !::GetFileSizeEx( file.Get(), &fileSize ) || fileSize.HighPart != 0 || fileSize.QuadPart < static_cast<LONGLONG>( sizeof( impl::CJournalHeader ) ) )
+			return false;
+
+		fs::CHandle mapping;
+		if ( HANDLE hMapping = ::CreateFileMapping( file.Get(), nullptr, PAGE_READONLY, 0, 0, nullptr ) )
+			mapping.Reset( hMapping );
+		else
+			return false;
+
+		const BYTE* pView = static_cast<const BYTE*>( ::MapViewOfFile( mapping.Get(), FILE_MAP_READ, 0, 0, 0 ) );
+		if ( nullptr == pView )
+			return false;
+
+		const size_t viewSize = static_cast<size_t>( fileSize.QuadPart );
+		const impl::CJournalHeader* pHeader = reinterpret_cast<const impl::CJournalHeader*>( pView );
+		bool succeeded = 0 == memcmp( pHeader->m_tag, s_fileTag, sizeof( s_fileTag ) ) && impl::JournalVersion == pHeader->m_version;
+
+		// pass 1: replay the records on the stacks of ids; the commands are not deserialized yet
+		typedef std::pair<const BYTE*, size_t> TPayload;
+		std::map<UINT, TPayload> cmdPayloads;
+		std::vector<UINT> idStacks[ 2 ];
+		size_t pos = sizeof( impl::CJournalHeader );
+
+		UINT nextCmdId = 1;
+
+		while ( succeeded )
+		{
+			if ( viewSize - pos < sizeof( impl::CRecordHeader ) )
+				break;
+
+			const impl::CRecordHeader* pRecord = reinterpret_cast<const impl::CRecordHeader*>( pView + pos );
+			const BYTE* pData = pView + pos + sizeof( impl::CRecordHeader );
+
+			if ( pRecord->m_dataSize < sizeof( UINT ) || viewSize - pos - sizeof( impl::CRecordHeader ) < pRecord->m_dataSize ||
+				 pRecord->m_checksum != impl::ComputeRecordChecksum( *pRecord, pData ) )
+				break;				// torn or corrupted tail: drop it
+
+			UINT arg = impl::ReadUInt( pData );
+			UINT value = pRecord->m_dataSize >= 2 * sizeof( UINT ) ? impl::ReadUInt( pData + sizeof( UINT ) ) : 0;
+			std::vector<UINT>* pStack = arg < COUNT_OF( idStacks ) ? &idStacks[ arg ] : nullptr;
+			bool validRecord = true;
+
+			switch ( pRecord->m_type )
+			{
+				case AddCmd:
+					cmdPayloads[ arg ] = TPayload( pData + sizeof( UINT ), pRecord->m_dataSize - sizeof( UINT ) );
+					nextCmdId = std::max( nextCmdId, arg + 1 );
+					break;
+				case PushCmd:
+					validRecord = pStack != nullptr && cmdPayloads.find( value ) != cmdPayloads.end();
+					if ( validRecord )
+						pStack->push_back( value );
+					break;
+				case TruncateStack:
+					validRecord = pStack != nullptr && value <= pStack->size();
+					if ( validRecord )
+						pStack->resize( value );
+					break;
+				case RemoveCmd:
+					validRecord = pStack != nullptr && value < pStack->size();
+					if ( validRecord )
+						pStack->erase( pStack->begin() + value );
+					break;
+				default:
+					validRecord = false;
+			}
+
+			if ( !validRecord )
+				break;
+
+			pos += sizeof( impl::CRecordHeader ) + pRecord->m_dataSize;
+		}
+
+		// pass 2: deserialize only the live commands
+		CImage image;
+		std::deque<utl::ICommand*> cmdStacks[ 2 ];
+
+		try
+		{
+			for ( size_t stackType = 0; succeeded && stackType != COUNT_OF( idStacks ); ++stackType )
+				for ( std::vector<UINT>::const_iterator itCmdId = idStacks[ stackType ].begin(); itCmdId != idStacks[ stackType ].end(); ++itCmdId )
+				{
+					const TPayload& payload = cmdPayloads[ *itCmdId ];
+
+					if ( utl::ICommand* pCmd = DeserializeCmd( payload.first, payload.second ) )
+					{
+						cmdStacks[ stackType ].push_back( pCmd );
+						image.m_stacks[ stackType ].push_back( *itCmdId );
+						image.m_payloads[ *itCmdId ].assign( payload.first, payload.first + payload.second );
+						image.m_cmdIds[ pCmd ] = *itCmdId;
+					}
+				}
+		}
+		catch ( CException* pExc )
+		{
+			app::TraceException( pExc );
+			pExc->Delete();
+			succeeded = false;
+		}
+
+		::UnmapViewOfFile( pView );
+		mapping.Close();
+		file.Close();
+
+		if ( !succeeded )
+		{
+			utl::ClearOwningContainer( cmdStacks[ svc::Undo ] );
+			utl::ClearOwningContainer( cmdStacks[ svc::Redo ] );
+			return false;
+		}
+
+		m_pCommandModel->SwapUndoStack( cmdStacks[ svc::Undo ] );
+		m_pCommandModel->SwapRedoStack( cmdStacks[ svc::Redo ] );
+		utl::ClearOwningContainer( cmdStacks[ svc::Undo ] );		// delete previous commands, if any
+		utl::ClearOwningContainer( cmdStacks[ svc::Redo ] );
+
+		std::swap( m_image, image );
+		m_nextCmdId = nextCmdId;
+		m_journalSize = pos;
+		m_liveSize = ComputeLiveSize( m_image );
+		StoreSyncState( journalPath );
+
+		if ( NeedsCompaction() || m_journalSize != viewSize )		// also drop the corrupted tail, if any
+		{
+			std::vector<BYTE> snapshot;
+			BuildSnapshot( snapshot, m_image );
+			StartCompaction( journalPath, snapshot );
+		}
+		return true;
+	}
+
+	void CJournalLogSerializer::BuildDelta( OUT std::vector<BYTE>& rRecords, OUT CImage& rNewImage ) throws_( CException* )
+	{
+		const std::deque<utl::ICommand*>* pCmdStacks[ 2 ] = { &m_pCommandModel->GetUndoStack(), &m_pCommandModel->GetRedoStack() };
+		std::vector<utl::ICommand*> cmdStacks[ 2 ];
+		std::set<UINT> keptCmdIds;
+
+		// persisted commands by address (0 if new): not serialized yet
+		for ( size_t stackType = 0; stackType != COUNT_OF( pCmdStacks ); ++stackType )
+			for ( std::deque<utl::ICommand*>::const_iterator itCmd = pCmdStacks[ stackType ]->begin(); itCmd != pCmdStacks[ stackType ]->end(); ++itCmd )
+				if ( is_a<CObject>( *itCmd ) )			// skip non-persistent commands
+				{
+					std::map<const utl::ICommand*, UINT>::const_iterator itFound = m_image.m_cmdIds.find( *itCmd );
+					UINT cmdId = itFound != m_image.m_cmdIds.end() ? itFound->second : 0;
+
+					cmdStacks[ stackType ].push_back( *itCmd );
+					rNewImage.m_stacks[ stackType ].push_back( cmdId );
+					if ( cmdId != 0 )
+						keptCmdIds.insert( cmdId );
+				}
+
+		std::vector<UINT> idStacks[ 2 ] = { m_image.m_stacks[ svc::Undo ], m_image.m_stacks[ svc::Redo ] };
+
+		// deleted commands (expired, zombies, discarded redo)
+		for ( size_t stackType = 0; stackType != COUNT_OF( idStacks ); ++stackType )
+			for ( size_t pos = idStacks[ stackType ].size(); pos-- != 0; )
+				if ( 0 == keptCmdIds.count( idStacks[ stackType ][ pos ] ) )
+				{
+					AppendRecord( rRecords, RemoveCmd, static_cast<svc::StackType>( stackType ), static_cast<UINT>( pos ) );
+					idStacks[ stackType ].erase( idStacks[ stackType ].begin() + pos );
+				}
+
+		// moved and new commands (undo, redo, execute): truncate each stack to the common prefix, then push the rest
+		size_t prefixLengths[ 2 ];
+
+		for ( size_t stackType = 0; stackType != COUNT_OF( idStacks ); ++stackType )
+		{
+			const std::vector<UINT>& oldStack = idStacks[ stackType ];
+			std::vector<UINT>& rNewStack = rNewImage.m_stacks[ stackType ];
+			size_t& rPrefixLength = prefixLengths[ stackType ];
+
+			for ( rPrefixLength = 0; rPrefixLength != oldStack.size() && rPrefixLength != rNewStack.size() && oldStack[ rPrefixLength ] == rNewStack[ rPrefixLength ]; )
+				++rPrefixLength;
+
+			for ( size_t pos = rPrefixLength; pos != rNewStack.size(); ++pos )
+			{	// serialize only past the prefix: a moved command may have changed (e.g. a macro drops its failed commands)
+				std::vector<BYTE> payload;
+				SerializeCmd( payload, cmdStacks[ stackType ][ pos ] );
+
+				if ( 0 == rNewStack[ pos ] || !IsSamePayload( rNewStack[ pos ], payload ) )
+				{
+					rNewStack[ pos ] = m_nextCmdId++;
+					AppendRecord( rRecords, AddCmd, rNewStack[ pos ], payload.empty() ? nullptr : &payload.front(), payload.size() );
+					rNewImage.m_payloads[ rNewStack[ pos ] ].swap( payload );
+				}
+			}
+
+			if ( rPrefixLength != oldStack.size() )
+				AppendRecord( rRecords, TruncateStack, static_cast<svc::StackType>( stackType ), static_cast<UINT>( rPrefixLength ) );
+		}
+
+		for ( size_t stackType = 0; stackType != COUNT_OF( idStacks ); ++stackType )
+		{
+			for ( size_t pos = prefixLengths[ stackType ]; pos != rNewImage.m_stacks[ stackType ].size(); ++pos )
+				AppendRecord( rRecords, PushCmd, static_cast<svc::StackType>( stackType ), rNewImage.m_stacks[ stackType ][ pos ] );
+
+			for ( size_t pos = 0; pos != cmdStacks[ stackType ].size(); ++pos )
+				rNewImage.m_cmdIds[ cmdStacks[ stackType ][ pos ] ] = rNewImage.m_stacks[ stackType ][ pos ];
+		}
+	}
+
+	void CJournalLogSerializer::ApplyDelta( CImage& rNewImage )
+	{
+		std::set<UINT> liveCmdIds;
+
+		for ( size_t stackType = 0; stackType != COUNT_OF( rNewImage.m_stacks ); ++stackType )
+		{
+			liveCmdIds.insert( rNewImage.m_stacks[ stackType ].begin(), rNewImage.m_stacks[ stackType ].end() );
+
+			m_liveSize -= m_image.m_stacks[ stackType ].size() * GetRecordSize( sizeof( UINT ) );
+			m_liveSize += rNewImage.m_stacks[ stackType ].size() * GetRecordSize( sizeof( UINT ) );
+			m_image.m_stacks[ stackType ].swap( rNewImage.m_stacks[ stackType ] );
+		}
+
+		for ( std::map<UINT, std::vector<BYTE> >::iterator itPayload = m_image.m_payloads.begin(); itPayload != m_image.m_payloads.end(); )
+			if ( 0 == liveCmdIds.count( itPayload->first ) )
+			{
+				m_liveSize -= GetRecordSize( itPayload->second.size() );
+				m_image.m_payloads.erase( itPayload++ );
+			}
+			else
+				++itPayload;
+
+		for ( std::map<UINT, std::vector<BYTE> >::iterator itPayload = rNewImage.m_payloads.begin(); itPayload != rNewImage.m_payloads.end(); ++itPayload )
+		{
+			m_liveSize += GetRecordSize( itPayload->second.size() );
+			m_image.m_payloads[ itPayload->first ].swap( itPayload->second );
+		}
+
+		m_image.m_cmdIds.swap( rNewImage.m_cmdIds );
+	}
+
+	void CJournalLogSerializer::BuildSnapshot( OUT std::vector<BYTE>& rSnapshot, const CImage& image ) const
+	{
+		impl::CJournalHeader header;
+		memcpy( header.m_tag, s_fileTag, sizeof( s_fileTag ) );
+		header.m_version = impl::JournalVersion;
+
+		rSnapshot.clear();
+		rSnapshot.reserve( static_cast<size_t>( ComputeLiveSize( image ) ) );
+		rSnapshot.assign( reinterpret_cast<const BYTE*>( &header ), reinterpret_cast<const BYTE*>( &header + 1 ) );
+
+		for ( std::map<UINT, std::vector<BYTE> >::const_iterator itPayload = image.m_payloads.begin(); itPayload != image.m_payloads.end(); ++itPayload )
+			AppendRecord( rSnapshot, AddCmd, itPayload->first, itPayload->second.empty() ? nullptr : &itPayload->second.front(), itPayload->second.size() );
+
+		for ( size_t stackType = 0; stackType != COUNT_OF( image.m_stacks ); ++stackType )
+			for ( std::vector<UINT>::const_iterator itCmdId = image.m_stacks[ stackType ].begin(); itCmdId != image.m_stacks[ stackType ].end(); ++itCmdId )
+				AppendRecord( rSnapshot, PushCmd, static_cast<svc::StackType>( stackType ), *itCmdId );
+	}
+
+	bool CJournalLogSerializer::IsSamePayload( UINT cmdId, const std::vector<BYTE>& payload ) const
+	{
+		std::map<UINT, std::vector<BYTE> >::const_iterator itPayload = m_image.m_payloads.find( cmdId );
+		return itPayload != m_image.m_payloads.end() && itPayload->second == payload;
+	}
+
+	bool CJournalLogSerializer::IsJournalInSync( const fs::CPath& journalPath ) const
+	{
+		return
+			m_journalSize != 0 &&
+			fs::IsValidFile( journalPath.GetPtr() ) &&
+			fs::GetFileSize( journalPath.GetPtr() ) == m_journalSize &&
+			fs::ReadLastModifyTime( journalPath ) == m_syncModifyTime;
+	}
+
+	void CJournalLogSerializer::StoreSyncState( const fs::CPath& journalPath )
+	{
+		m_syncModifyTime = fs::ReadLastModifyTime( journalPath );
+	}
+
+	bool CJournalLogSerializer::NeedsCompaction( void ) const
+	{
+		return m_journalSize > MinCompactSize && m_journalSize > 2 * m_liveSize;
+	}
+
+	void CJournalLogSerializer::StartCompaction( const fs::CPath& journalPath, std::vector<BYTE>& rSnapshot )
+	{
+		ASSERT( nullptr == m_pCompactWork );
+
+		m_compactPath = journalPath;
+		m_compactSnapshot.swap( rSnapshot );
+		m_compactSucceeded = false;
+
+		if ( m_asyncCompaction )
+			m_pCompactWork = ::CreateThreadpoolWork( &CompactWorkProc, this, nullptr );
+
+		if ( m_pCompactWork != nullptr )
+			::SubmitThreadpoolWork( m_pCompactWork );
+		else
+		{	// synchronous, or no thread pool: compact inline
+			m_compactSucceeded = impl::ReplaceJournal( m_compactPath, m_compactSnapshot );
+			EndCompaction();
+		}
+	}
+
+	VOID CALLBACK CJournalLogSerializer::CompactWorkProc( PTP_CALLBACK_INSTANCE pInstance, void* pContext, PTP_WORK pWork )
+	{	// background: only file I/O on the snapshot built by the main thread
+		pInstance, pWork;
+		CJournalLogSerializer* pJournal = reinterpret_cast<CJournalLogSerializer*>( pContext );
+
+		pJournal->m_compactSucceeded = impl::ReplaceJournal( pJournal->m_compactPath, pJournal->m_compactSnapshot );
+	}
+
+	void CJournalLogSerializer::WaitCompaction( bool cancelPending /*= false*/ )
+	{
+		if ( m_compactSnapshot.empty() )
+			return;				// no compaction started
+
+		if ( m_pCompactWork != nullptr )
+		{
+			::WaitForThreadpoolWorkCallbacks( m_pCompactWork, cancelPending );
+			::CloseThreadpoolWork( m_pCompactWork );
+			m_pCompactWork = nullptr;
+		}
+
+		EndCompaction();
+	}
+
+	void CJournalLogSerializer::EndCompaction( void )
+	{
+		if ( m_compactSucceeded )
+		{
+			m_journalSize = m_compactSnapshot.size();
+			StoreSyncState( m_compactPath );
+		}
+
+		std::vector<BYTE>().swap( m_compactSnapshot );
+	}
+
+	void CJournalLogSerializer::AppendRecord( IN OUT std::vector<BYTE>& rRecords, RecordType type, UINT arg, const void* pData /*= nullptr*/, size_t dataSize /*= 0*/ )
+	{
+		impl::CRecordHeader header;
+		header.m_type = static_cast<BYTE>( type );
+		memset( header.m_reserved, 0, sizeof( header.m_reserved ) );
+		header.m_dataSize = static_cast<UINT>( sizeof( UINT ) + dataSize );
+
+		size_t headerPos = rRecords.size();
+		rRecords.resize( headerPos + sizeof( impl::CRecordHeader ) + header.m_dataSize );
+
+		BYTE* pRecordData = &rRecords[ headerPos + sizeof( impl::CRecordHeader ) ];
+		memcpy( pRecordData, &arg, sizeof( UINT ) );
+		if ( dataSize != 0 )
+			memcpy( pRecordData + sizeof( UINT ), pData, dataSize );
+
+		header.m_checksum = impl::ComputeRecordChecksum( header, pRecordData );
+		memcpy( &rRecords[ headerPos ], &header, sizeof( impl::CRecordHeader ) );
+	}
+
+	void CJournalLogSerializer::AppendRecord( IN OUT std::vector<BYTE>& rRecords, RecordType type, svc::StackType stackType, UINT value )
+	{
+		AppendRecord( rRecords, type, static_cast<UINT>( stackType ), &value, sizeof( UINT ) );
+	}
+
+	UINT64 CJournalLogSerializer::GetRecordSize( size_t dataSize )
+	{
+		return sizeof( impl::CRecordHeader ) + sizeof( UINT ) + dataSize;
+	}
+
+	UINT64 CJournalLogSerializer::ComputeLiveSize( const CImage& image )
+	{	// the size of the snapshot
+		UINT64 liveSize = sizeof( impl::CJournalHeader );
+
+		for ( std::map<UINT, std::vector<BYTE> >::const_iterator itPayload = image.m_payloads.begin(); itPayload != image.m_payloads.end(); ++itPayload )
+			liveSize += GetRecordSize( itPayload->second.size() );
+
+		for ( size_t stackType = 0; stackType != COUNT_OF( image.m_stacks ); ++stackType )
+			liveSize += image.m_stacks[ stackType ].size() * GetRecordSize( sizeof( UINT ) );
+
+		return liveSize;
+	}
+
+	void CJournalLogSerializer::SerializeCmd( OUT std::vector<BYTE>& rPayload, utl::ICommand* pCmd ) throws_( CException* )
+	{
+		CObject* pSerialObject = dynamic_cast<CObject*>( pCmd );
+		ASSERT_PTR( pSerialObject );
+
+		CMemFile file;
+
+		{
+			CArchive archive( &file, CArchive::store );
+			archive << pSerialObject;
+			archive.Close();
+		}
+
+		size_t bufferSize;
+		const BYTE* pBuffer = mfc::GetFileBuffer( &file, &bufferSize );
+		rPayload.assign( pBuffer, pBuffer + bufferSize );
+	}
+
+	utl::ICommand* CJournalLogSerializer::DeserializeCmd( const BYTE* pPayload, size_t payloadSize ) throws_( CException* )
+	{
+		CMemFile file( const_cast<BYTE*>( pPayload ), static_cast<UINT>( payloadSize ) );
+		CArchive archive( &file, CArchive::load );
+		CObject* pSerialObject = nullptr;
+
+		archive >> pSerialObject;
+
+		utl::ICommand* pCmd = dynamic_cast<utl::ICommand*>( pSerialObject );
+		if ( nullptr == pCmd )
+			delete pSerialObject;
+		return pCmd;
+	}
+
+} //namespace cmd
@@ -3,20 +3,32 @@
 #pragma once
 
 #include <deque>
+#include <map>
+#include <set>
 #include "utl/ICommand.h"
 #include "AppCommands_fwd.h"
 
 
 class CCommandModel;
+namespace cmd { class CJournalLogSerializer; }
 
 
-class CCommandModelPersist
+// Persists the undo log of the command model: as an append-only journal, or as a binary document (legacy).
+// Keeps the journal state between saves, so that each save appends only the changes.
+//
+class CCommandModelPersist : private utl::noncopyable
 {
 public:
-	static bool SaveUndoLog( CCommandModel* pCommandModel );
-	static bool LoadUndoLog( CCommandModel* pOutCommandModel );
+	CCommandModelPersist( CCommandModel* pCommandModel );
+	~CCommandModelPersist();
 
-	static fs::CPath GetUndoLogPath( void );
+	bool SaveUndoLog( cmd::FileFormat fileFormat, bool atExit = false );		// at exit: compacts inline
+	bool LoadUndoLog( void );				// loads the most recently modified log file
+
+	static fs::CPath GetUndoLogPath( cmd::FileFormat fileFormat );
+private:
+	CCommandModel* m_pCommandModel;
+	std::auto_ptr<cmd::CJournalLogSerializer> m_pJournal;
 };
 
 
@@ -58,6 +70,76 @@ namespace cmd
 		static void SaveStack( CArchive& archive, svc::StackType section, const std::deque<utl::ICommand*>& cmdStack );
 		static void LoadStack( CArchive& archive, std::deque<utl::ICommand*>& rCmdStack );
 	};
+
+
+	// Append-only journal of the undo/redo stacks: each save appends only the delta since the previous save.
+	//	records: AddCmd (a serialized command, by id), PushCmd (on top of a stack), TruncateStack (undo, redo, or cleared redo), RemoveCmd (expired or zombie).
+	// Each record is checksummed: a torn or corrupted tail is dropped on load, and overwritten by the next append.
+	// When dead commands dominate the journal, it is compacted to a snapshot of the live commands in a background thread.
+	// Only the commands past the unchanged bottom of each stack are serialized: Save() must follow each change of the stacks,
+	// so that a deleted command's address is never reused by a new command unseen.
+	//
+	class CJournalLogSerializer : public CLogSerializer
+	{
+	public:
+		CJournalLogSerializer( CCommandModel* pCommandModel );
+		virtual ~CJournalLogSerializer();		// waits for a running background compaction
+
+		// base overrides
+		virtual bool Save( const fs::CPath& journalPath ) override;
+		virtual bool Load( const fs::CPath& journalPath ) override;		// replays the memory-mapped journal
+
+		UINT64 GetJournalSize( void ) const { return m_journalSize; }
+		void SetAsyncCompaction( bool asyncCompaction ) { m_asyncCompaction = asyncCompaction; }
+		void WaitCompaction( bool cancelPending = false );		// cancel pending: a not yet started compaction is dropped (the journal remains valid)
+	private:
+		enum RecordType { AddCmd = 1, PushCmd, TruncateStack, RemoveCmd };
+
+		struct CImage			// the persisted state of the stacks
+		{
+			std::vector<UINT> m_stacks[ 2 ];							// command ids by svc::StackType, stack top at end
+			std::map<UINT, std::vector<BYTE> > m_payloads;				// serialized live commands by id
+			std::map<const utl::ICommand*, UINT> m_cmdIds;				// model commands to ids
+		};
+
+		void BuildDelta( OUT std::vector<BYTE>& rRecords, OUT CImage& rNewImage ) throws_( CException* );		// new image: only the payloads of the added commands
+		void ApplyDelta( CImage& rNewImage );		// drops the dead payloads, and keeps m_liveSize up to date
+		void BuildSnapshot( OUT std::vector<BYTE>& rSnapshot, const CImage& image ) const;
+		bool IsSamePayload( UINT cmdId, const std::vector<BYTE>& payload ) const;
+
+		bool IsJournalInSync( const fs::CPath& journalPath ) const;		// not modified by another process since our last write?
+		void StoreSyncState( const fs::CPath& journalPath );
+		bool NeedsCompaction( void ) const;
+		void StartCompaction( const fs::CPath& journalPath, std::vector<BYTE>& rSnapshot );		// swaps the snapshot
+		void EndCompaction( void );
+
+		static VOID CALLBACK CompactWorkProc( PTP_CALLBACK_INSTANCE pInstance, void* pContext, PTP_WORK pWork );		// thread pool: at DLL unload only a running callback is waited for
+
+		static void AppendRecord( IN OUT std::vector<BYTE>& rRecords, RecordType type, UINT arg, const void* pData = nullptr, size_t dataSize = 0 );
+		static void AppendRecord( IN OUT std::vector<BYTE>& rRecords, RecordType type, svc::StackType stackType, UINT value );
+		static UINT64 GetRecordSize( size_t dataSize );			// the record header, the UINT argument and the data
+		static UINT64 ComputeLiveSize( const CImage& image );
+
+		static void SerializeCmd( OUT std::vector<BYTE>& rPayload, utl::ICommand* pCmd ) throws_( CException* );
+		static utl::ICommand* DeserializeCmd( const BYTE* pPayload, size_t payloadSize ) throws_( CException* );
+	private:
+		CImage m_image;
+		UINT m_nextCmdId;
+		UINT64 m_journalSize;							// valid size: excludes a dropped tail
+		UINT64 m_liveSize;								// size of the snapshot of live commands
+		CTime m_syncModifyTime;
+
+		// background compaction: the work owns these until waited for
+		bool m_asyncCompaction;							// false at DLL unload: a new pool thread would block on the loader lock
+		PTP_WORK m_pCompactWork;
+		fs::CPath m_compactPath;
+		std::vector<BYTE> m_compactSnapshot;
+		bool m_compactSucceeded;
+
+		enum { MinCompactSize = 64 * KiloByte };
+
+		static const char s_fileTag[ 4 ];
+	};
 }
 
 
@@ -8,6 +8,7 @@
 #include "utl/EnumTags.h"
 #include "utl/FmtUtils.h"
 #include "utl/FileContent.h"
+#include "utl/FileLinks.h"
 #include "utl/FileSystem.h"
 #include "utl/Logger.h"
 #include "utl/RuntimeException.h"
@@ -424,6 +425,101 @@ bool CDeleteFilesCmd::CUndeleteFilesCmd::Execute( void ) override
 }
 
 
+// CLinkDuplicatesCmd implementation
+
+IMPLEMENT_SERIAL( CLinkDuplicatesCmd, CBaseSerialCmd, VERSIONABLE_SCHEMA | 1 )
+
+CLinkDuplicatesCmd::CLinkDuplicatesCmd( const std::vector<fs::CPath>& dupFilePaths, const std::vector<fs::CPath>& originalFilePaths )
+	: cmd::CBaseFileGroupCmd( cmd::LinkDuplicateFiles, dupFilePaths )
+	, m_originalFilePaths( originalFilePaths )
+{
+	REQUIRE( dupFilePaths.size() == originalFilePaths.size() );
+	m_fileAccessMode = fs::Write;
+}
+
+CLinkDuplicatesCmd::~CLinkDuplicatesCmd()
+{
+}
+
+void CLinkDuplicatesCmd::Serialize( CArchive& archive ) override
+{
+	__super::Serialize( archive );
+
+	serial::SerializeValues( archive, m_originalFilePaths );
+	serial::SerializeValues( archive, m_linkedFilePaths );
+}
+
+void CLinkDuplicatesCmd::QueryDetailLines( std::vector<std::tstring>& rLines ) const override
+{
+	AddActualCmdDetail( rLines );
+
+	for ( size_t i = 0; i != m_originalFilePaths.size(); ++i )
+		rLines.push_back( fmt::FormatRenameEntry( GetDupFilePaths()[ i ], m_originalFilePaths[ i ] ) );
+}
+
+bool CLinkDuplicatesCmd::Execute( void ) override
+{
+	CWorkingSet workingSet( GetDupFilePaths(), m_originalFilePaths, m_fileAccessMode );
+
+	m_linkedFilePaths.clear();
+
+	if ( workingSet.IsValid() )
+	{
+		CWaitCursor wait;
+		std::vector<fs::CPath> failedPaths;		// on a different volume, with different attributes, modified since the search, or locked
+
+		size_t linkedCount = fs::ReplaceWithHardLinks( m_linkedFilePaths, failedPaths, workingSet.m_currFilePaths, workingSet.m_currDestFilePaths );		// verifies the contents, on multiple threads
+
+		if ( !failedPaths.empty() )
+		{
+			workingSet.m_badFilePaths.insert( workingSet.m_badFilePaths.end(), failedPaths.begin(), failedPaths.end() );
+			workingSet.m_existStatus = linkedCount != 0 ? app::Warning : app::Error;
+		}
+
+		workingSet.m_succeeded = linkedCount != 0;
+	}
+
+	return HandleExecuteResult( workingSet );
+}
+
+bool CLinkDuplicatesCmd::Unexecute( void ) override
+{
+	if ( m_linkedFilePaths.empty() )
+		return false;				// all duplicates were already linked: nothing of ours to break
+
+	CUnlinkFilesCmd undoCmd( m_linkedFilePaths );
+	undoCmd.SetOriginCmd( this );
+
+	return undoCmd.Execute();
+}
+
+
+// CLinkDuplicatesCmd::CUnlinkFilesCmd implementation
+
+bool CLinkDuplicatesCmd::CUnlinkFilesCmd::Execute( void ) override
+{
+	CWorkingSet workingSet( this, m_fileAccessMode );
+
+	if ( workingSet.IsValid() )
+	{
+		CWaitCursor wait;
+		std::vector<fs::CPath> failedPaths;
+
+		size_t unlinkedCount = fs::BreakHardLinks( failedPaths, workingSet.m_currFilePaths );		// restore independent copies, on multiple threads
+
+		if ( !failedPaths.empty() )
+		{
+			workingSet.m_badFilePaths.insert( workingSet.m_badFilePaths.end(), failedPaths.begin(), failedPaths.end() );
+			workingSet.m_existStatus = unlinkedCount != 0 ? app::Warning : app::Error;
+		}
+
+		workingSet.m_succeeded = unlinkedCount != 0;
+	}
+
+	return HandleExecuteResult( workingSet );
+}
+
+
 // CCopyFilesCmd implementation
 
 IMPLEMENT_SERIAL( CCopyFilesCmd, CBaseSerialCmd, VERSIONABLE_SCHEMA | 1 )
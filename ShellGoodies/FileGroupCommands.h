@@ -200,6 +200,49 @@ private:
 };
 
 
+// Used for replacing duplicate files with hard links to their original file, reclaiming their storage without deleting any path.
+// Can be undone by breaking the hard links created by Execute (not the ones that existed before), which restores the duplicates as independent copies.
+// Note: a linked duplicate takes the original's attributes, timestamps and ACL - undo doesn't restore the duplicate's own.
+//
+class CLinkDuplicatesCmd : public cmd::CBaseFileGroupCmd
+{
+	DECLARE_SERIAL( CLinkDuplicatesCmd )
+
+	CLinkDuplicatesCmd( void ) {}
+public:
+	CLinkDuplicatesCmd( const std::vector<fs::CPath>& dupFilePaths, const std::vector<fs::CPath>& originalFilePaths );
+	virtual ~CLinkDuplicatesCmd();
+
+	const std::vector<fs::CPath>& GetDupFilePaths( void ) const { return GetFilePaths(); }
+	const std::vector<fs::CPath>& GetOriginalFilePaths( void ) const { return m_originalFilePaths; }
+	const std::vector<fs::CPath>& GetLinkedFilePaths( void ) const { return m_linkedFilePaths; }
+
+	// base overrides
+	virtual void Serialize( CArchive& archive ) override;
+	virtual void QueryDetailLines( std::vector<std::tstring>& rLines ) const override;
+
+	// ICommand interface
+	virtual bool Execute( void ) override;
+	virtual bool Unexecute( void ) override;
+private:
+	persist std::vector<fs::CPath> m_originalFilePaths;		// the link target of each duplicate
+	persist std::vector<fs::CPath> m_linkedFilePaths;		// the duplicates actually replaced by the last Execute: the only ones to unlink on undo
+
+	struct CUnlinkFilesCmd : public cmd::CBaseFileGroupCmd
+	{
+		CUnlinkFilesCmd( const std::vector<fs::CPath>& linkedFilePaths )
+			: cmd::CBaseFileGroupCmd( cmd::Priv_UnlinkFiles, linkedFilePaths )
+		{
+			m_fileAccessMode = fs::Write;
+		}
+
+		// ICommand interface
+		virtual bool Execute( void ) override;
+		virtual bool IsUndoable( void ) const override { return false; }
+	};
+};
+
+
 // Used for copying files, using a deep destination directory structure.
 //
 class CCopyFilesCmd : public cmd::CBaseDeepTransferFilesCmd
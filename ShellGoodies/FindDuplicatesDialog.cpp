@@ -15,6 +15,7 @@
 #include "utl/LongestCommonSubsequence.h"
 #include "utl/RuntimeException.h"
 #include "utl/StringUtilities.h"
+#include "utl/SubjectPredicates.h"
 #include "utl/Unique.h"
 #include "utl/TimeUtils.h"
 #include "utl/UI/Clipboard.h"
@@ -115,6 +116,54 @@ namespace hlp
 	}
 
 
+	template< typename CompareGroupProc >
+	struct LessGroupId
+	{
+		LessGroupId( CompareGroupProc compareGroupProc, const CFindDuplicatesDialog* pDialog ) : m_compareGroupProc( compareGroupProc ), m_pDialog( pDialog ) {}
+
+		bool operator()( int leftGroupId, int rightGroupId ) const { return pred::Less == m_compareGroupProc( leftGroupId, rightGroupId, m_pDialog ); }
+	private:
+		CompareGroupProc m_compareGroupProc;
+		const CFindDuplicatesDialog* m_pDialog;
+	};
+
+
+	// orders the duplicate items by the rank of their group, then by the item comparator within each group
+	//
+	class LessDupItemByGroup
+	{
+	public:
+		typedef std::unordered_map<const CDuplicateFilesGroup*, size_t> TGroupRanks;
+
+		LessDupItemByGroup( const TGroupRanks& groupRanks, const pred::IComparator* pItemComparator, bool ascending )
+			: m_groupRanks( groupRanks ), m_pItemComparator( pItemComparator ), m_ascending( ascending ) {}
+
+		bool operator()( const utl::ISubject* pLeft, const utl::ISubject* pRight ) const
+		{
+			size_t leftRank = GetGroupRank( pLeft ), rightRank = GetGroupRank( pRight );
+
+			if ( leftRank != rightRank )
+				return leftRank < rightRank;
+
+			if ( m_pItemComparator != nullptr )
+				return pred::Less == pred::GetResultInOrder( m_pItemComparator->CompareObjects( pLeft, pRight ), m_ascending );
+
+			return false;			// keep the items in group order
+		}
+	private:
+		size_t GetGroupRank( const utl::ISubject* pObject ) const
+		{
+			TGroupRanks::const_iterator itFound = m_groupRanks.find( checked_static_cast<const CDuplicateFileItem*>( pObject )->GetParentGroup() );
+			ASSERT( itFound != m_groupRanks.end() );
+			return itFound->second;
+		}
+	private:
+		const TGroupRanks& m_groupRanks;
+		const pred::IComparator* m_pItemComparator;
+		bool m_ascending;
+	};
+
+
 	class CCheckedStateDupItems
 	{
 	public:
@@ -167,6 +216,9 @@ namespace reg
 	static const TCHAR entry_fileType[] = _T("fileType");
 	static const TCHAR entry_fileTypeSpecs[] = _T("fileTypeSpecs");
 	static const TCHAR entry_highlightDuplicates[] = _T("HighlightDuplicates");
+	static const TCHAR entry_hashAlgorithm[] = _T("HashAlgorithm");
+	static const TCHAR entry_byteCompare[] = _T("ByteCompare");
+	static const TCHAR entry_spillFileCount[] = _T("SpillFileCount");
 }
 
 namespace layout
@@ -186,6 +238,11 @@ namespace layout
 		{ IDC_MIN_FILE_SIZE_COMBO, pctMoveY( TopPct ) },
 		{ IDC_FILE_SPEC_STATIC, pctMoveY( TopPct ) },
 		{ IDC_FILE_SPEC_EDIT, SizeX | pctMoveY( TopPct ) },
+		{ IDC_VERIFY_STATIC, pctMoveY( TopPct ) },
+		{ IDC_HASH_ALGORITHM_COMBO, pctMoveY( TopPct ) },
+		{ IDC_BYTE_COMPARE_CHECK, pctMoveY( TopPct ) },
+		{ IDC_SPILL_FILE_COUNT_STATIC, pctMoveY( TopPct ) },
+		{ IDC_SPILL_FILE_COUNT_EDIT, pctMoveY( TopPct ) },
 
 		{ IDC_DUPLICATE_FILES_STATIC, pctMoveY( TopPct ) },
 		{ IDC_DUPLICATE_FILES_LIST, SizeX | pctMoveY( TopPct ) | pctSizeY( BottomPct ) },
@@ -194,6 +251,7 @@ namespace layout
 		{ IDC_GROUP_BOX_2, SizeX | MoveY },
 		{ ID_DELETE_DUPLICATES, MoveY },
 		{ ID_MOVE_DUPLICATES, MoveY },
+		{ ID_LINK_DUPLICATES, MoveY },
 		{ IDC_COMMIT_INFO_STATUS, SizeX | MoveY },
 
 		{ IDOK, MoveX },
@@ -207,14 +265,23 @@ const ui::CItemContent CFindDuplicatesDialog::s_pathItemsContent( ui::MixedPath,
 
 CFindDuplicatesDialog::CFindDuplicatesDialog( CFileModel* pFileModel, CWnd* pParent )
 	: CFileEditorBaseDialog( pFileModel, cmd::FindDuplicates, IDD_FIND_DUPLICATES_DIALOG, pParent )
+	, m_pDupsSession( new CDuplicateFilesSession() )
 	, m_searchPathsListCtrl( ui::ListHost_TileMateOnTopRight )	// IDC_SEARCH_PATHS_LIST
 	, m_ignorePathsListCtrl( ui::ListHost_TileMateOnTopRight )	// IDC_IGNORE_PATHS_LIST
 	, m_fileTypeCombo( &GetTags_FileType() )
+	, m_hashAlgorithmCombo( &fs::GetTags_HashAlgorithm() )
 	, m_dupsListCtrl( ui::ListHost_TileMateOnTopRight )			// IDC_DUPLICATE_FILES_LIST
+	, m_dupsListModel( this )
 	, m_commitInfoStatic( CRegularStatic::Bold )
 	, m_accel( IDC_DUPLICATE_FILES_LIST )
 	, m_highlightDuplicates( AfxGetApp()->GetProfileInt( reg::section_dialog, reg::entry_highlightDuplicates, true ) != FALSE )
+	, m_hashAlgorithm( static_cast<fs::HashAlgorithm>( AfxGetApp()->GetProfileInt( reg::section_dialog, reg::entry_hashAlgorithm, fs::Crc32Only ) ) )
+	, m_byteCompare( AfxGetApp()->GetProfileInt( reg::section_dialog, reg::entry_byteCompare, false ) != FALSE )
+	, m_spillFileCount( AfxGetApp()->GetProfileInt( reg::section_dialog, reg::entry_spillFileCount, 2000000 ) )
 {
+	if ( m_hashAlgorithm < fs::Crc32Only || m_hashAlgorithm >= fs::_HashAlgorithmCount )
+		m_hashAlgorithm = fs::Crc32Only;		// invalid registry value
+
 	CPathItem::MakePathItems( m_searchPathItems, m_pFileModel->GetSourcePaths() );
 
 	m_nativeCmdTypes.push_back( cmd::ResetDestinations );
@@ -244,6 +311,7 @@ CFindDuplicatesDialog::CFindDuplicatesDialog( CFileModel* pFileModel, CWnd* pPar
 	m_dupsListCtrl.SetTextEffectCallback( this );
 	m_dupsListCtrl.SetCheckStatePolicy( CheckDup::Instance() );
 	m_dupsListCtrl.SetToggleCheckSelItems();
+	m_dupsListCtrl.SetListModel( &m_dupsListModel );
 
 	m_dupsListCtrl.SetPopupMenu( CReportListControl::Nowhere, &GetDupListPopupMenu( CReportListControl::Nowhere ) );
 	m_dupsListCtrl.SetPopupMenu( CReportListControl::OnSelection, &GetDupListPopupMenu( CReportListControl::OnSelection ) );
@@ -251,6 +319,7 @@ CFindDuplicatesDialog::CFindDuplicatesDialog( CFileModel* pFileModel, CWnd* pPar
 	CGeneralOptions::Instance().ApplyToListCtrl( &m_dupsListCtrl );
 
 	m_dupsListCtrl.AddColumnCompare( FileName, pred::NewPropertyComparator<CDuplicateFileItem, pred::TCompareNameExt>( CDuplicateFileItem::ToNameExt() ) );
+	m_dupsListCtrl.AddColumnCompare( FolderPath, pred::NewPropertyComparator<CDuplicateFileItem, pred::CompareNaturalPath>( CDuplicateFileItem::ToParentFolderPath() ) );
 	m_dupsListCtrl.AddColumnCompare( DateModified, pred::NewPropertyComparator<CDuplicateFileItem>( func::AsModifyTime() ), false );		// order date-time descending by default
 	m_dupsListCtrl.AddColumnCompare( DuplicateCount, nullptr, false );		// order by duplicate count descending by default; NULL comparator since uses only group ordering
 
@@ -308,7 +377,8 @@ CMenu& CFindDuplicatesDialog::GetDupListPopupMenu( CReportListControl::ListPopup
 
 void CFindDuplicatesDialog::ClearDuplicates( void )
 {
-	utl::ClearOwningContainer( m_duplicateGroups );
+	m_duplicateGroups.clear();
+	m_pDupsSession->Reset();
 }
 
 bool CFindDuplicatesDialog::SearchForDuplicateFiles( void )
@@ -325,6 +395,9 @@ bool CFindDuplicatesDialog::SearchForDuplicateFiles( void )
 		CWaitCursor wait;			// could take a long time for directories with many subdirectories and files
 		CDuplicateFilesEnumerator enumer( fs::EF_Recurse, progress.GetProgressEnumerator(), progress.GetService() );
 
+		enumer.SetSession( m_pDupsSession.get() );		// re-hash only new or modified files, patch the existing groups
+		enumer.SetVerification( m_hashAlgorithm, m_byteCompare );
+		enumer.SetSpillThreshold( m_spillFileCount );
 		enumer.RefOptions().m_fileSizeRange.m_start = minFileSize;
 		enumer.RefOptions().m_ignorePathMatches.Reset( cvt::CQueryPaths( m_ignorePathItems ).m_paths );
 
@@ -332,11 +405,15 @@ bool CFindDuplicatesDialog::SearchForDuplicateFiles( void )
 		utl::for_each( searchPaths.m_paths, func::AppendToDirPath( m_fileSpecEdit.GetText() ) );
 
 		enumer.SearchDuplicates( searchPaths.m_paths );
-		m_duplicateGroups.swap( enumer.m_dupGroupItems );		// exchange ownership
+		m_duplicateGroups = m_pDupsSession->GetDuplicateGroups();
 
 		m_outcomeStatic.SetWindowText( FormatReport( enumer.GetOutcome() ) );
 		SetupDuplicateFileList();
 		ClearFileErrors();
+
+		if ( enumer.GetOutcome().m_spillLostCount != 0 )
+			ui::ReportError( str::Format( _T("Could not read back the temporary files of the search.\n\n%d found files were not searched for duplicates."),
+										  enumer.GetOutcome().m_spillLostCount ), MB_OK | MB_ICONWARNING );
 		return true;
 	}
 	catch ( CUserAbortedException& exc )
@@ -380,6 +457,35 @@ bool CFindDuplicatesDialog::MoveDuplicateFiles( void )
 	return false;
 }
 
+bool CFindDuplicatesDialog::LinkDuplicateFiles( void )
+{
+	std::vector<CDuplicateFileItem*> checkedDupItems;
+	if ( !m_dupsListCtrl.QueryObjectsWithCheckedState( checkedDupItems, CheckDup::CheckedItem ) )
+		return false;
+
+	std::vector<fs::CPath> dupFilePaths, originalFilePaths;		// each duplicate is linked to the original item of its group
+
+	for ( std::vector<CDuplicateFileItem*>::const_iterator itDupItem = checkedDupItems.begin(); itDupItem != checkedDupItems.end(); ++itDupItem )
+	{
+		if ( !( *itDupItem )->IsOriginalItem() )
+		{
+			dupFilePaths.push_back( ( *itDupItem )->GetFilePath() );
+			originalFilePaths.push_back( ( *itDupItem )->GetParentGroup()->GetItems().front()->GetFilePath() );
+		}
+	}
+
+	if ( dupFilePaths.empty() )
+		return false;
+
+	if ( ui::MessageBox( str::Format( _T("Replace %d duplicate files with hard links to their original file?\n\n")
+									  _T("Each linked duplicate will take the attributes, timestamps and security permissions (ACL) of its original file; ")
+									  _T("duplicates with different read-only, hidden or system attributes are skipped."), dupFilePaths.size() ),
+						 MB_OKCANCEL | MB_ICONQUESTION ) != IDOK )
+		return false;
+
+	return ExecuteDuplicatesCmd( new CLinkDuplicatesCmd( dupFilePaths, originalFilePaths ) );
+}
+
 bool CFindDuplicatesDialog::ExecuteDuplicatesCmd( utl::ICommand* pDupsCmd )
 {
 	ClearFileErrors();
@@ -407,7 +513,7 @@ void CFindDuplicatesDialog::SwitchMode( Mode mode )
 	{
 		IDC_GROUP_BOX_1, IDC_SEARCH_PATHS_LIST, IDC_IGNORE_PATHS_LIST,
 		IDC_FILE_TYPE_STATIC, IDC_FILE_TYPE_COMBO, IDC_MINIMUM_SIZE_STATIC, IDC_MIN_FILE_SIZE_COMBO, IDC_FILE_SPEC_STATIC, IDC_FILE_SPEC_EDIT,
-		ID_DELETE_DUPLICATES, ID_MOVE_DUPLICATES
+		ID_DELETE_DUPLICATES, ID_MOVE_DUPLICATES, ID_LINK_DUPLICATES
 	};
 	ui::EnableControls( *this, ctrlIds, COUNT_OF( ctrlIds ), !IsRollMode() );
 	ui::EnableControl( *this, IDC_DUPLICATE_FILES_STATIC, mode != EditMode );
@@ -538,45 +644,47 @@ void CFindDuplicatesDialog::SetupDuplicateFileList( void )
 	lv::TScopedStatus_ByText sel( &m_dupsListCtrl );
 	CScopedLockRedraw freeze( &m_dupsListCtrl );
 
-	m_dupsListCtrl.DeleteAllItems();
-	m_dupsListCtrl.RemoveAllGroups();
-
-	m_dupsListCtrl.EnableGroupView( !m_duplicateGroups.empty() );
+	std::vector<CDuplicateFileItem*> dupItems;		// in group order, original item first
 
-	unsigned int index = 0;			// strictly item index
-	for ( unsigned int groupId = 0; groupId != m_duplicateGroups.size(); ++groupId )
+	for ( std::vector<CDuplicateFilesGroup*>::const_iterator itGroup = m_duplicateGroups.begin(); itGroup != m_duplicateGroups.end(); ++itGroup )
 	{
-		const CDuplicateFilesGroup* pGroup = m_duplicateGroups[ groupId ];
-		ASSERT( pGroup->HasDuplicates() );
-
-		std::tstring header = str::Format( _T("Group %d"), groupId + 1 );
-		if ( pGroup->GetItems().size() > 2 )
-			header += str::Format( _T(" (%d duplicates)"), pGroup->GetItems().size() - 1 );
+		ASSERT( ( *itGroup )->HasDuplicates() );
+		dupItems.insert( dupItems.end(), ( *itGroup )->GetItems().begin(), ( *itGroup )->GetItems().end() );
+	}
 
-		m_dupsListCtrl.InsertGroupHeader( groupId, groupId, header, LVGS_NORMAL | LVGS_COLLAPSIBLE );
-		m_dupsListCtrl.SetGroupTask( groupId, _T("Toggle Duplicates") );
+	m_dupsListModel.SetObjects( dupItems );		// resets the check-states
 
-		for ( size_t pos = 0; pos != pGroup->GetItems().size(); ++pos, ++index )
-		{
-			CDuplicateFileItem* pDupItem = pGroup->GetItems()[ pos ];
-			ASSERT( pGroup == pDupItem->GetParentGroup() );
+	for ( int row = 0, rowCount = m_dupsListModel.GetRowCount(); row != rowCount; ++row )
+		if ( checked_static_cast<const CDuplicateFileItem*>( m_dupsListModel.GetRowObject( row ) )->IsOriginalItem() )
+			m_dupsListModel.SetRowCheckState( row, CheckDup::OriginalItem );
 
-			m_dupsListCtrl.InsertObjectItem( index, pDupItem );
-			m_dupsListCtrl.SetSubItemText( index, FolderPath, pDupItem->GetFilePath().GetParentPath().GetPtr() );
-			m_dupsListCtrl.SetSubItemText( index, Size, num::FormatFileSize( pGroup->GetContentKey().m_fileSize ) );
-			m_dupsListCtrl.SetSubItemText( index, Crc32, num::FormatHexNumber( pGroup->GetContentKey().m_crc32, _T("%X") ) );
-			m_dupsListCtrl.SetSubItemText( index, DateModified, time_utl::FormatTimestamp( pDupItem->GetState().m_modifTime ) );
+	m_dupsListCtrl.UpdateListModelRows();		// sort by current criteria, keeping the groups contiguous
+}
 
-			if ( pDupItem->IsOriginalItem() )
-				m_dupsListCtrl.ModifyCheckState( index, CheckDup::OriginalItem );
-			else
-				m_dupsListCtrl.SetSubItemText( index, DuplicateCount, num::FormatNumber( pos ) );
+std::tstring CFindDuplicatesDialog::FormatCellText( const utl::ISubject* pObject, int column ) const
+{
+	const CDuplicateFileItem* pDupItem = checked_static_cast<const CDuplicateFileItem*>( pObject );
+	const CDuplicateFilesGroup* pGroup = pDupItem->GetParentGroup();
 
-			VERIFY( m_dupsListCtrl.SetItemGroupId( index, groupId ) );
-		}
+	switch ( column )
+	{
+		case FileName:		return m_dupsListCtrl.FormatCode( pDupItem );
+		case FolderPath:	return pDupItem->GetFilePath().GetParentPath().Get();
+		case Size:			return num::FormatFileSize( pGroup->GetContentKey().m_fileSize );
+		case Crc32:			return num::FormatHexNumber( pGroup->GetContentKey().m_crc32, _T("%X") );
+		case DateModified:	return time_utl::FormatTimestamp( pDupItem->GetState().m_modifTime );
+		case DuplicateCount:
+			if ( !pDupItem->IsOriginalItem() )
+				return num::FormatNumber( utl::FindPos( pGroup->GetItems(), pDupItem ) );
+			break;
 	}
+	return std::tstring();
+}
 
-	m_dupsListCtrl.InitialSortList();		// store original order and sort by current criteria
+int CFindDuplicatesDialog::GetCellImageIndex( const utl::ISubject* pObject, int column ) const
+{
+	pObject, column;
+	return ui::No_Image;
 }
 
 std::tstring CFindDuplicatesDialog::FormatReport( const CDupsOutcome& outcome ) const
@@ -590,11 +698,44 @@ std::tstring CFindDuplicatesDialog::FormatReport( const CDupsOutcome& outcome )
 	if ( outcome.m_ignoredCount != 0 )
 		reportMessage += str::Format( _T(" (%d ignored)"), outcome.m_ignoredCount );
 
+	if ( outcome.m_hardLinkCount != 0 )
+		reportMessage += str::Format( _T(", skipped %d hard links"), outcome.m_hardLinkCount );
+
+	if ( outcome.m_spillLostCount != 0 )
+		reportMessage += str::Format( _T(", %d files NOT searched (temporary file read error)"), outcome.m_spillLostCount );
+
+	if ( outcome.IsIncremental() )
+		reportMessage += str::Format( _T(", %d changed since last search"), outcome.m_changedFileCount );
+
 	reportMessage += str::Format( _T(".  Elapsed %s."), outcome.m_timer.FormatElapsedDuration( 2 ).c_str() );
 
+	if ( outcome.m_hashAlgorithm != fs::Crc32Only || outcome.m_byteCompare )
+	{
+		reportMessage += _T("  Verified by ");
+		if ( outcome.m_hashAlgorithm != fs::Crc32Only )
+			reportMessage += fs::GetTags_HashAlgorithm().FormatUi( outcome.m_hashAlgorithm );
+		if ( outcome.m_byteCompare )
+			stream::Tag( reportMessage, _T("byte comparison"), _T(" and ") );
+		reportMessage += _T(".");
+	}
+
 	if ( CLogger* pLogger = app::GetLogger() )
+	{
 		pLogger->LogString( str::Format( _T("Search for duplicates in {%s}  -  %s"), utl::MakeDisplayCodeList( m_searchPathItems, _T(", ") ).c_str(), reportMessage.c_str() ) );
 
+		// throughput of the content verification stages
+		const CContentVerifyStats& stats = outcome.m_verifyStats;
+
+		if ( !stats.m_crc32.IsEmpty() )
+			pLogger->LogString( stats.m_crc32.Format( fs::GetTags_HashAlgorithm().FormatUi( fs::Crc32Only ) ) );
+		if ( !stats.m_digest.IsEmpty() )
+			pLogger->LogString( stats.m_digest.Format( fs::GetTags_HashAlgorithm().FormatUi( outcome.m_hashAlgorithm ) ) );
+		if ( !stats.m_byteCompare.IsEmpty() )
+			pLogger->LogString( stats.m_byteCompare.Format( _T("Byte compare") ) );
+
+		pLogger->LogString( _T("Search metrics:\n") + outcome.FormatMetrics() );		// machine-readable, for benchmarking runs
+	}
+
 	return reportMessage;
 }
 
@@ -627,7 +768,7 @@ void CFindDuplicatesDialog::DisplayCheckedGroupsInfo( void )
 
 	m_commitInfoStatic.SetWindowText( text );
 
-	static const UINT s_ctrlIds[] = { ID_DELETE_DUPLICATES, ID_MOVE_DUPLICATES };
+	static const UINT s_ctrlIds[] = { ID_DELETE_DUPLICATES, ID_MOVE_DUPLICATES, ID_LINK_DUPLICATES };
 	bool canCommit = !checkedDupItems.empty() && !IsRollMode();
 	ui::EnableControls( *this, s_ctrlIds, COUNT_OF( s_ctrlIds ), canCommit );
 	ui::EnableControl( *this, IDOK, m_mode != CommitFilesMode || canCommit );
@@ -746,11 +887,10 @@ bool CFindDuplicatesDialog::IsGroupFullyChecked( const CDuplicateFilesGroup* pGr
 	return pGroup->GetDuplicatesCount() == checkedDupsCount;
 }
 
-void CFindDuplicatesDialog::ToggleCheckGroupDuplicates( unsigned int groupId )
+void CFindDuplicatesDialog::ToggleCheckGroupDuplicates( const CDuplicateFilesGroup* pCurrGroup )
 {
-	ASSERT( groupId < m_duplicateGroups.size() );
+	ASSERT_PTR( pCurrGroup );
 
-	const CDuplicateFilesGroup* pCurrGroup = m_duplicateGroups[ groupId ];
 	CheckDup::CheckState checkState = IsGroupFullyChecked( pCurrGroup ) ? CheckDup::UncheckedItem : CheckDup::CheckedItem;		// toggle checked duplicates
 
 	CScopedInternalChange change( &m_dupsListCtrl );		// prevent selection block check-state changes
@@ -775,6 +915,41 @@ pred::CompareResult CFindDuplicatesDialog::CompareGroupsByItemField( int leftGro
 	return compare( m_duplicateGroups[ leftGroupId ]->GetSortingItem( compare ), m_duplicateGroups[ rightGroupId ]->GetSortingItem( compare ) );
 }
 
+void CFindDuplicatesDialog::SortDuplicateGroups( void )
+{
+	typedef pred::CompareResult ( CALLBACK* TCompareGroupProc )( int leftGroupId, int rightGroupId, const CFindDuplicatesDialog* pThis );
+
+	std::pair<int, bool> currSort = m_dupsListCtrl.GetSortByColumn();	// <sortByColumn, sortAscending>
+	TCompareGroupProc compareGroupProc = nullptr;
+	const pred::IComparator* pItemComparator = nullptr;					// sort items within the group, otherwise keep the original item first
+
+	switch ( currSort.first )
+	{
+		case FileName:		compareGroupProc = &CompareGroupFileName; pItemComparator = m_dupsListCtrl.FindCompare( FileName ); break;
+		case FolderPath:	compareGroupProc = &CompareGroupFolderPath; pItemComparator = m_dupsListCtrl.FindCompare( FolderPath ); break;
+		case Size:			compareGroupProc = &CompareGroupFileSize; break;
+		case Crc32:			compareGroupProc = &CompareGroupFileCrc32; break;
+		case DateModified:	compareGroupProc = &CompareGroupDateModified; pItemComparator = m_dupsListCtrl.FindCompare( DateModified ); break;
+		case DuplicateCount:	compareGroupProc = &CompareGroupDuplicateCount; break;
+	}
+
+	std::vector<int> groupIds( m_duplicateGroups.size() );
+	for ( size_t groupId = 0; groupId != groupIds.size(); ++groupId )
+		groupIds[ groupId ] = static_cast<int>( groupId );
+
+	if ( compareGroupProc != nullptr )
+		std::stable_sort( groupIds.begin(), groupIds.end(), hlp::LessGroupId<TCompareGroupProc>( compareGroupProc, this ) );
+
+	hlp::LessDupItemByGroup::TGroupRanks groupRanks;
+	groupRanks.reserve( groupIds.size() );
+
+	for ( size_t rank = 0; rank != groupIds.size(); ++rank )
+		groupRanks[ m_duplicateGroups[ groupIds[ rank ] ] ] = rank;
+
+	m_dupsListModel.ResetRows();				// initial group order: stable sorting keeps the original items first
+	m_dupsListModel.SortRowsBy( hlp::LessDupItemByGroup( groupRanks, pItemComparator, currSort.second ) );
+}
+
 pred::CompareResult CALLBACK CFindDuplicatesDialog::CompareGroupFileName( int leftGroupId, int rightGroupId, const CFindDuplicatesDialog* pThis )
 {
 	return pThis->CompareGroupsByItemField( leftGroupId, rightGroupId, pred::CompareAdapterPtr<pred::CompareNaturalPath, CDuplicateFileItem::ToNameExt>() );
@@ -831,6 +1006,7 @@ void CFindDuplicatesDialog::DoDataExchange( CDataExchange* pDX )
 	DDX_Control( pDX, IDC_FILE_TYPE_COMBO, m_fileTypeCombo );
 	DDX_Control( pDX, IDC_FILE_SPEC_EDIT, m_fileSpecEdit );
 	DDX_Control( pDX, IDC_MIN_FILE_SIZE_COMBO, m_minFileSizeCombo );
+	DDX_Control( pDX, IDC_HASH_ALGORITHM_COMBO, m_hashAlgorithmCombo );
 	DDX_Control( pDX, IDC_OUTCOME_INFO_STATUS, m_outcomeStatic );
 	DDX_Control( pDX, IDC_COMMIT_INFO_STATUS, m_commitInfoStatic );
 	ui::DDX_ButtonIcon( pDX, ID_DELETE_DUPLICATES );
@@ -841,6 +1017,10 @@ void CFindDuplicatesDialog::DoDataExchange( CDataExchange* pDX )
 		m_fileTypeCombo.SetValue( AfxGetApp()->GetProfileInt( reg::section_dialog, reg::entry_fileType, All ) );
 		m_fileSpecEdit.SetText( m_fileTypeSpecs[ m_fileTypeCombo.GetValue() ] );
 		m_minFileSizeCombo.LoadHistory( m_regSection.c_str(), reg::entry_minFileSize, _T("0|1|10|50|100|500|1000") );
+		m_hashAlgorithmCombo.SetValue( m_hashAlgorithm );
+		CheckDlgButton( IDC_BYTE_COMPARE_CHECK, m_byteCompare );
+		ui::EnableControl( m_hWnd, IDC_BYTE_COMPARE_CHECK, !fs::IsCryptographicHash( m_hashAlgorithm ) );
+		ui::SetDlgItemText( this, IDC_SPILL_FILE_COUNT_EDIT, num::FormatNumber( m_spillFileCount ) );
 
 		m_dupsListCtrl.GetStateImageList()->Add( ui::GetImageStoresSvc()->RetrieveIcon( ID_ORIGINAL_FILE )->GetHandle() );		// OriginalItem
 
@@ -864,6 +1044,9 @@ BEGIN_MESSAGE_MAP( CFindDuplicatesDialog, CFileEditorBaseDialog )
 	ON_EN_CHANGE( IDC_FILE_SPEC_EDIT, OnEnChange_FileSpec )
 	ON_CBN_EDITCHANGE( IDC_MIN_FILE_SIZE_COMBO, OnCbnChanged_MinFileSize )
 	ON_CBN_SELCHANGE( IDC_MIN_FILE_SIZE_COMBO, OnCbnChanged_MinFileSize )
+	ON_CBN_SELCHANGE( IDC_HASH_ALGORITHM_COMBO, OnCbnSelChange_HashAlgorithm )
+	ON_BN_CLICKED( IDC_BYTE_COMPARE_CHECK, OnToggle_ByteCompare )
+	ON_EN_CHANGE( IDC_SPILL_FILE_COUNT_EDIT, OnEnChange_SpillFileCount )
 
 	ON_COMMAND_RANGE( ID_CHECK_ALL_DUPLICATES, ID_UNCHECK_ALL_DUPLICATES, On_CheckAllDuplicates )
 	ON_UPDATE_COMMAND_UI_RANGE( ID_CHECK_ALL_DUPLICATES, ID_UNCHECK_ALL_DUPLICATES, OnUpdate_CheckAllDuplicates )
@@ -888,12 +1071,12 @@ BEGIN_MESSAGE_MAP( CFindDuplicatesDialog, CFileEditorBaseDialog )
 
 	ON_BN_CLICKED( ID_DELETE_DUPLICATES, OnBnClicked_DeleteDuplicates )
 	ON_BN_CLICKED( ID_MOVE_DUPLICATES, OnBnClicked_MoveDuplicates )
+	ON_BN_CLICKED( ID_LINK_DUPLICATES, OnBnClicked_LinkDuplicates )
 
 	ON_NOTIFY( lv::LVN_DropFiles, IDC_SEARCH_PATHS_LIST, OnLvnDropFiles_PathsList )
 	ON_NOTIFY( lv::LVN_DropFiles, IDC_IGNORE_PATHS_LIST, OnLvnDropFiles_PathsList )
 	ON_NOTIFY( LVN_ENDLABELEDIT, IDC_SEARCH_PATHS_LIST, OnLvnEndLabelEdit_PathsList )
 	ON_NOTIFY( LVN_ENDLABELEDIT, IDC_IGNORE_PATHS_LIST, OnLvnEndLabelEdit_PathsList )
-	ON_NOTIFY( LVN_LINKCLICK, IDC_DUPLICATE_FILES_LIST, OnLvnLinkClick_DuplicateList )
 	ON_NOTIFY( lv::LVN_CheckStatesChanged, IDC_DUPLICATE_FILES_LIST, OnLvnCheckStatesChanged_DuplicateList )
 	ON_NOTIFY( lv::LVN_CustomSortList, IDC_DUPLICATE_FILES_LIST, OnLvnCustomSortList_DuplicateList )
 END_MESSAGE_MAP()
@@ -932,6 +1115,9 @@ void CFindDuplicatesDialog::OnDestroy( void )
 	AfxGetApp()->WriteProfileInt( reg::section_dialog, reg::entry_fileType, m_fileTypeCombo.GetValue() );
 	AfxGetApp()->WriteProfileString( reg::section_dialog, reg::entry_fileTypeSpecs, str::Join( m_fileTypeSpecs, _T("|") ).c_str() );
 	AfxGetApp()->WriteProfileInt( reg::section_dialog, reg::entry_highlightDuplicates, m_highlightDuplicates );
+	AfxGetApp()->WriteProfileInt( reg::section_dialog, reg::entry_hashAlgorithm, m_hashAlgorithm );
+	AfxGetApp()->WriteProfileInt( reg::section_dialog, reg::entry_byteCompare, m_byteCompare );
+	AfxGetApp()->WriteProfileInt( reg::section_dialog, reg::entry_spillFileCount, static_cast<int>( m_spillFileCount ) );
 	m_minFileSizeCombo.SaveHistory( m_regSection.c_str(), reg::entry_minFileSize );
 
 	__super::OnDestroy();
@@ -998,17 +1184,39 @@ void CFindDuplicatesDialog::OnCbnChanged_MinFileSize( void )
 	OnFieldChanged();
 }
 
+void CFindDuplicatesDialog::OnCbnSelChange_HashAlgorithm( void )
+{
+	m_hashAlgorithm = m_hashAlgorithmCombo.GetEnum<fs::HashAlgorithm>();
+	ui::EnableControl( m_hWnd, IDC_BYTE_COMPARE_CHECK, !fs::IsCryptographicHash( m_hashAlgorithm ) );		// a cryptographic digest makes byte comparison redundant
+	OnFieldChanged();
+}
+
+void CFindDuplicatesDialog::OnToggle_ByteCompare( void )
+{
+	m_byteCompare = IsDlgButtonChecked( IDC_BYTE_COMPARE_CHECK ) != FALSE;
+	OnFieldChanged();
+}
+
+void CFindDuplicatesDialog::OnEnChange_SpillFileCount( void )
+{
+	if ( !num::ParseNumber( m_spillFileCount, ui::GetDlgItemText( this, IDC_SPILL_FILE_COUNT_EDIT ) ) )
+		m_spillFileCount = 0;			// empty: never spill
+
+	OnFieldChanged();
+}
+
 void CFindDuplicatesDialog::On_CheckAllDuplicates( UINT cmdId )
 {
 	CheckDup::CheckState toCheckState = ID_CHECK_ALL_DUPLICATES == cmdId ? CheckDup::CheckedItem : CheckDup::UncheckedItem;
-	CScopedInternalChange changeDups( &m_dupsListCtrl );
 
-	for ( UINT i = 0, count = m_dupsListCtrl.GetItemCount(); i != count; ++i )
+	for ( int row = 0, rowCount = m_dupsListModel.GetRowCount(); row != rowCount; ++row )
 	{
-		const CDuplicateFileItem* pItem = m_dupsListCtrl.GetPtrAt<CDuplicateFileItem>( i );
+		const CDuplicateFileItem* pItem = checked_static_cast<const CDuplicateFileItem*>( m_dupsListModel.GetRowObject( row ) );
 
-		m_dupsListCtrl.ModifyCheckState( i, pItem->IsOriginalItem() ? CheckDup::OriginalItem : toCheckState );
+		m_dupsListModel.SetRowCheckState( row, pItem->IsOriginalItem() ? CheckDup::OriginalItem : toCheckState );
 	}
+
+	m_dupsListCtrl.Invalidate();			// owner-data: check-states are drawn from the model
 }
 
 void CFindDuplicatesDialog::OnUpdate_CheckAllDuplicates( CCmdUI* pCmdUI )
@@ -1019,7 +1227,7 @@ void CFindDuplicatesDialog::OnUpdate_CheckAllDuplicates( CCmdUI* pCmdUI )
 void CFindDuplicatesDialog::On_ToggleCheckGroupDups( void )
 {
 	int itemIndex = m_dupsListCtrl.GetCaretIndex();
-	ToggleCheckGroupDuplicates( m_dupsListCtrl.GetItemGroupId( itemIndex ) );
+	ToggleCheckGroupDuplicates( m_dupsListCtrl.GetPtrAt<CDuplicateFileItem>( itemIndex )->GetParentGroup() );
 }
 
 void CFindDuplicatesDialog::OnUpdate_ToggleCheckGroupDups( CCmdUI* pCmdUI )
@@ -1182,14 +1390,21 @@ void CFindDuplicatesDialog::OnBnClicked_MoveDuplicates( void )
 		SwitchMode( EditMode );
 }
 
+void CFindDuplicatesDialog::OnBnClicked_LinkDuplicates( void )
+{
+	if ( LinkDuplicateFiles() )
+		SwitchMode( EditMode );
+}
+
 void CFindDuplicatesDialog::On_ClearCrc32Cache( void )
 {
 	fs::CCrc32FileCache::Instance().Clear();
+	m_pDupsSession->ClearFileIndex();			// also forget the checksums of the previous search
 }
 
 void CFindDuplicatesDialog::OnUpdate_ClearCrc32Cache( CCmdUI* pCmdUI )
 {
-	pCmdUI->Enable( !fs::CCrc32FileCache::Instance().IsEmpty() );
+	pCmdUI->Enable( !fs::CCrc32FileCache::Instance().IsEmpty() || m_pDupsSession->GetIndexedFileCount() != 0 );
 }
 
 void CFindDuplicatesDialog::On_ToggleHighlightDuplicates( void )
@@ -1249,14 +1464,6 @@ void CFindDuplicatesDialog::OnLvnEndLabelEdit_PathsList( NMHDR* pNmHdr, LRESULT*
 	}
 }
 
-void CFindDuplicatesDialog::OnLvnLinkClick_DuplicateList( NMHDR* pNmHdr, LRESULT* pResult )
-{
-	NMLVLINK* pLinkInfo = (NMLVLINK*)pNmHdr;
-
-	ToggleCheckGroupDuplicates( pLinkInfo->iSubItem );
-	*pResult = 0;
-}
-
 void CFindDuplicatesDialog::OnLvnCheckStatesChanged_DuplicateList( NMHDR* pNmHdr, LRESULT* pResult )
 {
 	lv::CNmCheckStatesChanged* pInfo = (lv::CNmCheckStatesChanged*)pNmHdr;
@@ -1267,31 +1474,6 @@ void CFindDuplicatesDialog::OnLvnCheckStatesChanged_DuplicateList( NMHDR* pNmHdr
 void CFindDuplicatesDialog::OnLvnCustomSortList_DuplicateList( NMHDR* pNmHdr, LRESULT* pResult )
 {
 	pNmHdr;
-	*pResult = FALSE;
-	std::pair<int, bool> currSort = m_dupsListCtrl.GetSortByColumn();	// <sortByColumn, sortAscending>
-
-	switch ( currSort.first )
-	{
-		case FileName:				// sort groups AND items
-			m_dupsListCtrl.SortGroups( (PFNLVGROUPCOMPARE)&CompareGroupFileName, this );
-			break;					// sorted the groups, but keep on sorting the items
-		case FolderPath:			// sort groups AND items
-			m_dupsListCtrl.SortGroups( (PFNLVGROUPCOMPARE)&CompareGroupFolderPath, this );
-			break;					// sorted the groups, but keep on sorting the items
-		case Size:
-			m_dupsListCtrl.SortGroups( (PFNLVGROUPCOMPARE)&CompareGroupFileSize, this );
-			*pResult = TRUE;		// done, prevent list item internal sorting
-			break;
-		case Crc32:
-			m_dupsListCtrl.SortGroups( (PFNLVGROUPCOMPARE)&CompareGroupFileCrc32, this );
-			*pResult = TRUE;		// done, prevent list item internal sorting
-			break;
-		case DateModified:			// sort groups AND items
-			m_dupsListCtrl.SortGroups( (PFNLVGROUPCOMPARE)&CompareGroupDateModified, this );
-			break;					// sorted the groups, but keep on sorting the items
-		case DuplicateCount:
-			m_dupsListCtrl.SortGroups( (PFNLVGROUPCOMPARE)&CompareGroupDuplicateCount, this );
-			*pResult = TRUE;		// done, prevent list item internal sorting
-			break;
-	}
+	SortDuplicateGroups();		// sort the groups, and the items within each group
+	*pResult = TRUE;			// done, prevent the default sorting of the model rows
 }
@@ -3,10 +3,12 @@
 #pragma once
 
 #include "utl/ISubject.h"
+#include "utl/FileDigest.h"
 #include "utl/FileSystem_fwd.h"
 #include "utl/UI/EnumComboBox.h"
 #include "utl/UI/HistoryComboBox.h"
 #include "utl/UI/PathItemListCtrl.h"
+#include "utl/UI/ReportListModel.h"
 #include "utl/UI/TandemControls.h"
 #include "utl/UI/TextEdit.h"
 #include "utl/UI/ThemeStatic.h"
@@ -16,6 +18,7 @@
 class CPathItem;
 class CDuplicateFileItem;
 class CDuplicateFilesGroup;
+class CDuplicateFilesSession;
 class CDuplicateGroupStore;
 class CEnumTags;
 struct CDupsOutcome;
@@ -25,6 +28,7 @@ namespace fs { interface IEnumerator; }
 
 class CFindDuplicatesDialog : public CFileEditorBaseDialog
 							, private ui::ITextEffectCallback
+							, private lv::ICellSource
 {
 public:
 	CFindDuplicatesDialog( CFileModel* pFileModel, CWnd* pParent );
@@ -45,12 +49,17 @@ protected:
 	// ui::ITextEffectCallback interface
 	virtual void CombineTextEffectAt( ui::CTextEffect& rTextEffect, LPARAM rowKey, int subItem, CListLikeCtrlBase* pCtrl ) const;
 
+	// lv::ICellSource interface
+	virtual std::tstring FormatCellText( const utl::ISubject* pObject, int column ) const;
+	virtual int GetCellImageIndex( const utl::ISubject* pObject, int column ) const;
+
 	virtual void SwitchMode( Mode mode );
 private:
 	static const CEnumTags& GetTags_Mode( void );
 
 	bool DeleteDuplicateFiles( void );
 	bool MoveDuplicateFiles( void );
+	bool LinkDuplicateFiles( void );
 	bool ExecuteDuplicatesCmd( utl::ICommand* pCmd );
 	void SetupDialog( void );
 
@@ -82,7 +91,8 @@ private:
 	// duplicates
 	static CMenu& GetDupListPopupMenu( CReportListControl::ListPopup popupType );
 	bool IsGroupFullyChecked( const CDuplicateFilesGroup* pGroup ) const;
-	void ToggleCheckGroupDuplicates( unsigned int groupId );
+	void ToggleCheckGroupDuplicates( const CDuplicateFilesGroup* pGroup );
+	void SortDuplicateGroups( void );
 
 	static pred::CompareResult CALLBACK CompareGroupFileName( int leftGroupId, int rightGroupId, const CFindDuplicatesDialog* pThis );
 	static pred::CompareResult CALLBACK CompareGroupFolderPath( int leftGroupId, int rightGroupId, const CFindDuplicatesDialog* pThis );
@@ -99,7 +109,8 @@ private:
 private:
 	std::vector<CPathItem*> m_searchPathItems;
 	std::vector<CPathItem*> m_ignorePathItems;
-	std::vector<CDuplicateFilesGroup*> m_duplicateGroups;
+	std::auto_ptr<CDuplicateFilesSession> m_pDupsSession;	// keeps the previous results, so that re-searching is incremental
+	std::vector<CDuplicateFilesGroup*> m_duplicateGroups;		// owned by m_pDupsSession
 	persist std::vector<std::tstring> m_fileTypeSpecs;
 private:
 	// enum { IDD = IDD_FIND_DUPLICATES_DIALOG };
@@ -111,13 +122,18 @@ private:
 	persist CEnumComboBox m_fileTypeCombo;
 	persist CTextEdit m_fileSpecEdit;
 	persist CHistoryComboBox m_minFileSizeCombo;
+	CEnumComboBox m_hashAlgorithmCombo;
 
-	CHostToolbarCtrl<CPathItemListCtrl> m_dupsListCtrl;
+	CHostToolbarCtrl<CPathItemListCtrl> m_dupsListCtrl;			// owner-data list of m_dupsListModel
+	CReportListModel m_dupsListModel;							// duplicate items in group order, each group contiguous
 	CStatusStatic m_outcomeStatic;
 	CRegularStatic m_commitInfoStatic;
 	CAccelTable m_accel;
 
 	persist bool m_highlightDuplicates;
+	persist fs::HashAlgorithm m_hashAlgorithm;		// verify the CRC32 duplicates by a strong hash
+	persist bool m_byteCompare;						// final byte-by-byte verification (when not using a cryptographic hash)
+	persist UINT m_spillFileCount;					// for enormous scans: found files kept in memory before spilling to temporary files (0 for never)
 	static const ui::CItemContent s_pathItemsContent;
 
 	// generated stuff
@@ -140,6 +156,9 @@ protected:
 	afx_msg void OnCbnSelChange_FileType( void );
 	afx_msg void OnEnChange_FileSpec( void );
 	afx_msg void OnCbnChanged_MinFileSize( void );
+	afx_msg void OnCbnSelChange_HashAlgorithm( void );
+	afx_msg void OnToggle_ByteCompare( void );
+	afx_msg void OnEnChange_SpillFileCount( void );
 
 	afx_msg void On_CheckAllDuplicates( UINT cmdId );
 	afx_msg void OnUpdate_CheckAllDuplicates( CCmdUI* pCmdUI );
@@ -162,10 +181,10 @@ protected:
 
 	afx_msg void OnBnClicked_DeleteDuplicates( void );
 	afx_msg void OnBnClicked_MoveDuplicates( void );
+	afx_msg void OnBnClicked_LinkDuplicates( void );
 	afx_msg void OnUpdate_SelListItem( CCmdUI* pCmdUI );
 	afx_msg void OnLvnDropFiles_PathsList( NMHDR* pNmHdr, LRESULT* pResult );
 	afx_msg void OnLvnEndLabelEdit_PathsList( NMHDR* pNmHdr, LRESULT* pResult );
-	afx_msg void OnLvnLinkClick_DuplicateList( NMHDR* pNmHdr, LRESULT* pResult );
 	afx_msg void OnLvnCheckStatesChanged_DuplicateList( NMHDR* pNmHdr, LRESULT* pResult );
 	afx_msg void OnLvnCustomSortList_DuplicateList( NMHDR* pNmHdr, LRESULT* pResult );
 
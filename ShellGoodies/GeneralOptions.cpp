@@ -20,7 +20,7 @@ namespace reg
 	static const TCHAR entry_useListThumbs[] = _T("UseListThumbs");
 	static const TCHAR entry_useListDoubleBuffer[] = _T("UseListDoubleBuffer");
 	static const TCHAR entry_highlightTextDiffsFrame[] = _T("HighlightTextDiffsFrame");
-	//static const TCHAR entry_undoLogFormat[] = _T("UndoLogFormat");
+	static const TCHAR entry_undoLogFormat[] = _T("UndoLogFormat");
 	static const TCHAR entry_undoLogPersist[] = _T("UndoLogPersist");
 	static const TCHAR entry_undoEditingCmds[] = _T("UndoEditingCmds");
 	static const TCHAR entry_trimFname[] = _T("TrimFname");
@@ -34,7 +34,7 @@ CGeneralOptions::CGeneralOptions( void )
 	, m_useListThumbs( true )
 	, m_useListDoubleBuffer( true )
 	, m_highlightTextDiffsFrame( true )
-	, m_undoLogFormat( cmd::BinaryFormat )
+	, m_undoLogFormat( cmd::JournalFormat )
 	, m_undoLogPersist( true )
 	, m_undoEditingCmds( true )
 	, m_trimFname( true )
@@ -67,7 +67,9 @@ void CGeneralOptions::LoadFromRegistry( void )
 	m_useListThumbs = pApp->GetProfileInt( reg::section, reg::entry_useListThumbs, m_useListThumbs ) != FALSE;
 	m_useListDoubleBuffer = pApp->GetProfileInt( reg::section, reg::entry_useListDoubleBuffer, m_useListDoubleBuffer ) != FALSE;
 	m_highlightTextDiffsFrame = pApp->GetProfileInt( reg::section, reg::entry_highlightTextDiffsFrame, m_highlightTextDiffsFrame ) != FALSE;
-	//m_undoLogFormat = static_cast<cmd::FileFormat>( pApp->GetProfileInt( reg::section, reg::entry_undoLogFormat, m_undoLogFormat ) );
+	m_undoLogFormat = static_cast<cmd::FileFormat>( pApp->GetProfileInt( reg::section, reg::entry_undoLogFormat, m_undoLogFormat ) );
+	if ( m_undoLogFormat != cmd::BinaryFormat && m_undoLogFormat != cmd::JournalFormat )
+		m_undoLogFormat = cmd::JournalFormat;			// stale value of the removed cmd::TextFormat
 	m_undoLogPersist = pApp->GetProfileInt( reg::section, reg::entry_undoLogPersist, m_undoLogPersist ) != FALSE;
 	m_undoEditingCmds = pApp->GetProfileInt( reg::section, reg::entry_undoEditingCmds, m_undoEditingCmds ) != FALSE;
 	m_trimFname = pApp->GetProfileInt( reg::section, reg::entry_trimFname, m_trimFname ) != FALSE;
@@ -85,7 +87,7 @@ void CGeneralOptions::SaveToRegistry( void ) const
 	pApp->WriteProfileInt( reg::section, reg::entry_useListThumbs, m_useListThumbs );
 	pApp->WriteProfileInt( reg::section, reg::entry_useListDoubleBuffer, m_useListDoubleBuffer );
 	pApp->WriteProfileInt( reg::section, reg::entry_highlightTextDiffsFrame, m_highlightTextDiffsFrame );
-	//pApp->WriteProfileInt( reg::section, reg::entry_undoLogFormat, m_undoLogFormat );
+	pApp->WriteProfileInt( reg::section, reg::entry_undoLogFormat, m_undoLogFormat );
 	pApp->WriteProfileInt( reg::section, reg::entry_undoLogPersist, m_undoLogPersist );
 	pApp->WriteProfileInt( reg::section, reg::entry_undoEditingCmds, m_undoEditingCmds );
 	pApp->WriteProfileInt( reg::section, reg::entry_trimFname, m_trimFname );
@@ -37,7 +37,7 @@ public:
 	persist bool m_highlightTextDiffsFrame;
 
 	// Undo/Redo
-	cmd::FileFormat m_undoLogFormat;			// disabled persistence since removed cmd::TextFormat
+	persist cmd::FileFormat m_undoLogFormat;
 	persist bool m_undoLogPersist;
 	persist bool m_undoEditingCmds;
 
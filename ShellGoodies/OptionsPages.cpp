@@ -114,21 +114,17 @@ void CGeneralOptionsPage::DoDataExchange( CDataExchange* pDX )
 		ui::ShowControl( m_hWnd, ID_OPEN_CMD_DASHBOARD, enableProperties );
 	}
 
-	switch ( pDX->m_bSaveAndValidate )
+	if ( DialogSaveChanges == pDX->m_bSaveAndValidate )
 	{
-		case DialogOutput:
-			CheckDlgButton( IDC_UNDO_LOG_BINARY_FMT_RADIO, cmd::BinaryFormat == m_options.m_undoLogFormat );
-			break;
-		case DialogSaveChanges:
-			m_options.m_smallIconDim = ui::GetIconDimension( smallStdSize );
-			m_options.m_largeIconDim = ui::GetIconDimension( largeStdSize );
+		m_options.m_smallIconDim = ui::GetIconDimension( smallStdSize );
+		m_options.m_largeIconDim = ui::GetIconDimension( largeStdSize );
 	}
 
 	ui::DDX_Bool( pDX, IDC_USE_LIST_THUMBS_CHECK, m_options.m_useListThumbs );
 	ui::DDX_Bool( pDX, IDC_USE_LIST_DOUBLE_BUFFER_CHECK, m_options.m_useListDoubleBuffer );
 	ui::DDX_Bool( pDX, IDC_HIGHLIGHT_TEXT_DIFFS_FRAME_CHECK, m_options.m_highlightTextDiffsFrame );
 	ui::DDX_Bool( pDX, IDC_UNDO_LOG_PERSIST_CHECK, m_options.m_undoLogPersist );
-	//ui::DDX_RadioEnum( pDX, IDC_UNDO_LOG_TEXT_FMT_RADIO, m_options.m_undoLogFormat );
+	ui::DDX_RadioEnum( pDX, IDC_UNDO_LOG_BINARY_FMT_RADIO, m_options.m_undoLogFormat );		// matches cmd::FileFormat
 	ui::DDX_Bool( pDX, IDC_UNDO_EDITING_CMDS_CHECK, m_options.m_undoEditingCmds );
 	ui::DDX_Bool( pDX, IDC_TRIM_FNAME_CHECK, m_options.m_trimFname );
 	ui::DDX_Bool( pDX, IDC_NORMALIZE_WHITESPACE_CHECK, m_options.m_normalizeWhitespace );
@@ -144,8 +140,8 @@ BEGIN_MESSAGE_MAP( CGeneralOptionsPage, CLayoutPropertyPage )
 	ON_BN_CLICKED( IDC_USE_LIST_DOUBLE_BUFFER_CHECK, OnFieldModified )
 	ON_BN_CLICKED( IDC_HIGHLIGHT_TEXT_DIFFS_FRAME_CHECK, OnFieldModified )
 	ON_BN_CLICKED( IDC_UNDO_LOG_PERSIST_CHECK, OnFieldModified )
-	ON_BN_CLICKED( IDC_UNDO_LOG_TEXT_FMT_RADIO, OnFieldModified )
 	ON_BN_CLICKED( IDC_UNDO_LOG_BINARY_FMT_RADIO, OnFieldModified )
+	ON_BN_CLICKED( IDC_UNDO_LOG_JOURNAL_FMT_RADIO, OnFieldModified )
 	ON_BN_CLICKED( IDC_UNDO_EDITING_CMDS_CHECK, OnFieldModified )
 	ON_BN_CLICKED( IDC_TRIM_FNAME_CHECK, OnFieldModified )
 	ON_BN_CLICKED( IDC_NORMALIZE_WHITESPACE_CHECK, OnFieldModified )
@@ -113,6 +113,12 @@
 #define IDC_CURR_FOLDER_STATIC          1097
 #define IDC_FILES_STATIC                1098
 #define IDC_TARGET_SEL_ITEMS_CHECK      1099
+#define IDC_VERIFY_STATIC               1100
+#define IDC_HASH_ALGORITHM_COMBO        1101
+#define IDC_BYTE_COMPARE_CHECK          1102
+#define IDC_SPILL_FILE_COUNT_STATIC     1103
+#define IDC_SPILL_FILE_COUNT_EDIT       1104
+#define IDC_UNDO_LOG_JOURNAL_FMT_RADIO  1105
 #define IDS_INVALID_FORMAT              5000
 #define IDS_NO_DELIMITER_SET            5001
 #define IDS_REPLACE_FILES_TIP_FORMAT    5005
@@ -201,14 +207,15 @@
 #define ID_EDIT_INGORE_PATHS_LIST       32858
 #define ID_PASTE_AS_BACKUP              32859
 #define ID_COPY_SEL_ITEMS               32860
+#define ID_LINK_DUPLICATES              32861
 
 // Next default values for new objects
 //
 #ifdef APSTUDIO_INVOKED
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NEXT_RESOURCE_VALUE        119
-#define _APS_NEXT_COMMAND_VALUE         32861
-#define _APS_NEXT_CONTROL_VALUE         1100
+#define _APS_NEXT_COMMAND_VALUE         32862
+#define _APS_NEXT_CONTROL_VALUE         1106
 #define _APS_NEXT_SYMED_VALUE           5004
 #endif
 #endif
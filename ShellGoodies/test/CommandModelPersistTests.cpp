@@ -0,0 +1,170 @@
+
+#include "pch.h"
+
+#ifdef USE_UT		// no UT code in release builds
+#include "CommandModelPersistTests.h"
+#include "CommandModelPersist.h"
+#include "FileMacroCommands.h"
+#include "utl/CommandModel.h"
+#include "utl/FileSystem.h"
+#include "utl/StringUtilities.h"
+
+#define new DEBUG_NEW
+
+
+namespace ut
+{
+	enum { PushRecordSize = 12 + 2 * sizeof( UINT ) };		// record header + stack type + command id
+
+	void PushRenameCmds( CCommandModel* pModel, size_t count, const std::tstring& destPrefix = _T("dest") )
+	{
+		std::deque<utl::ICommand*> undoStack = pModel->GetUndoStack();
+
+		for ( size_t i = 0; i != count; ++i )
+			undoStack.push_back( new CRenameFileCmd( fs::CPath( _T("C:\\src.txt") ), fs::CPath( str::Format( _T("C:\\%s_%d.txt"), destPrefix.c_str(), static_cast<int>( undoStack.size() ) ) ) ) );
+
+		pModel->SwapUndoStack( undoStack );
+	}
+
+	void ReadFileBytes( std::vector<BYTE>& rBytes, const fs::CPath& filePath )
+	{
+		CFile file( filePath.GetPtr(), CFile::modeRead | CFile::typeBinary );
+		rBytes.resize( static_cast<size_t>( file.GetLength() ) );
+		if ( !rBytes.empty() )
+			file.Read( &rBytes.front(), static_cast<UINT>( rBytes.size() ) );
+	}
+
+	void WriteFileBytes( const fs::CPath& filePath, const std::vector<BYTE>& bytes )
+	{
+		CFile file( filePath.GetPtr(), CFile::modeCreate | CFile::modeWrite | CFile::typeBinary );
+		if ( !bytes.empty() )
+			file.Write( &bytes.front(), static_cast<UINT>( bytes.size() ) );
+	}
+}
+
+
+CCommandModelPersistTests::CCommandModelPersistTests( void )
+{
+	ut::CTestSuite::Instance().RegisterTestCase( this );		// self-registration
+}
+
+CCommandModelPersistTests& CCommandModelPersistTests::Instance( void )
+{
+	static CCommandModelPersistTests s_testCase;
+	return s_testCase;
+}
+
+void CCommandModelPersistTests::TestRecordChecksum( void )
+{
+	ut::CTempFilePool pool;
+	const fs::CPath journalPath = pool.QualifyPath( _T("undo.jrn") );
+
+	{
+		CCommandModel model;
+		ut::PushRenameCmds( &model, 3 );
+
+		cmd::CJournalLogSerializer journal( &model );
+		ASSERT( journal.Save( journalPath ) );
+	}
+
+	std::vector<BYTE> bytes;
+	ut::ReadFileBytes( bytes, journalPath );
+	bytes.back() ^= 0xFF;			// corrupt the command id of the last PushCmd record
+	ut::WriteFileBytes( journalPath, bytes );
+
+	CCommandModel model;
+	cmd::CJournalLogSerializer journal( &model );
+
+	ASSERT( journal.Load( journalPath ) );
+	ASSERT_EQUAL( 2, model.GetUndoStack().size() );					// the corrupted record was dropped
+	ASSERT_EQUAL( bytes.size() - ut::PushRecordSize, journal.GetJournalSize() );
+
+	journal.WaitCompaction();
+	ASSERT_EQUAL( journal.GetJournalSize(), fs::GetFileSize( journalPath.GetPtr() ) );		// the corrupted tail was compacted away
+}
+
+void CCommandModelPersistTests::TestTornTail( void )
+{
+	ut::CTempFilePool pool;
+	const fs::CPath journalPath = pool.QualifyPath( _T("undo.jrn") );
+
+	{
+		CCommandModel model;
+		ut::PushRenameCmds( &model, 3 );
+
+		cmd::CJournalLogSerializer journal( &model );
+		ASSERT( journal.Save( journalPath ) );
+	}
+
+	std::vector<BYTE> bytes;
+	ut::ReadFileBytes( bytes, journalPath );
+	bytes.resize( bytes.size() - 7 );			// torn write in the middle of the last record
+	ut::WriteFileBytes( journalPath, bytes );
+
+	{
+		CCommandModel model;
+		cmd::CJournalLogSerializer journal( &model );
+
+		ASSERT( journal.Load( journalPath ) );
+		ASSERT_EQUAL( 2, model.GetUndoStack().size() );
+		ASSERT_EQUAL( bytes.size() + 7 - ut::PushRecordSize, journal.GetJournalSize() );
+
+		ut::PushRenameCmds( &model, 1, _T("next") );
+		ASSERT( journal.Save( journalPath ) );			// appends after the valid records
+		ASSERT_EQUAL( journal.GetJournalSize(), fs::GetFileSize( journalPath.GetPtr() ) );
+	}
+
+	CCommandModel model;
+	cmd::CJournalLogSerializer journal( &model );
+
+	ASSERT( journal.Load( journalPath ) );
+	ASSERT_EQUAL( 3, model.GetUndoStack().size() );
+	ASSERT_EQUAL( journal.GetJournalSize(), fs::GetFileSize( journalPath.GetPtr() ) );		// no dropped tail
+}
+
+void CCommandModelPersistTests::TestSnapshotCompaction( void )
+{
+	ut::CTempFilePool pool;
+	const fs::CPath journalPath = pool.QualifyPath( _T("undo.jrn") );
+	const std::tstring longPrefix( 2000, _T('x') );		// large payloads: reach the compaction threshold quickly
+
+	CCommandModel model;
+	cmd::CJournalLogSerializer journal( &model );
+	journal.SetAsyncCompaction( false );
+
+	UINT64 maxJournalSize = 0;
+	bool compacted = false;
+
+	for ( int i = 0; i != 60 && !compacted; ++i )
+	{
+		ut::PushRenameCmds( &model, 1, longPrefix + num::FormatNumber( i ) );		// a new live command each time
+		model.RemoveExpiredCommands( 2 );			// the oldest one is dead
+
+		ASSERT( journal.Save( journalPath ) );
+		ASSERT_EQUAL( journal.GetJournalSize(), fs::GetFileSize( journalPath.GetPtr() ) );
+
+		compacted = journal.GetJournalSize() < maxJournalSize;
+		maxJournalSize = std::max( maxJournalSize, journal.GetJournalSize() );
+	}
+
+	ASSERT( compacted );		// replaced by a snapshot of the live commands
+
+	CCommandModel loadedModel;
+	cmd::CJournalLogSerializer loadedJournal( &loadedModel );
+
+	ASSERT( loadedJournal.Load( journalPath ) );
+	ASSERT_EQUAL( 2, loadedModel.GetUndoStack().size() );
+	ASSERT_EQUAL( model.GetUndoStack().front()->Format( utl::Detailed ), loadedModel.GetUndoStack().front()->Format( utl::Detailed ) );
+	ASSERT_EQUAL( model.GetUndoStack().back()->Format( utl::Detailed ), loadedModel.GetUndoStack().back()->Format( utl::Detailed ) );
+}
+
+
+void CCommandModelPersistTests::Run( void )
+{
+	RUN_TEST( TestRecordChecksum );
+	RUN_TEST( TestTornTail );
+	RUN_TEST( TestSnapshotCompaction );
+}
+
+
+#endif //USE_UT
@@ -0,0 +1,29 @@
+#ifndef CommandModelPersistTests_h
+#define CommandModelPersistTests_h
+#pragma once
+
+
+#ifdef USE_UT		// no UT code in release builds
+
+#include "utl/test/UnitTest.h"
+
+
+class CCommandModelPersistTests : public ut::CConsoleTestCase
+{
+	CCommandModelPersistTests( void );
+public:
+	static CCommandModelPersistTests& Instance( void );
+
+	// ut::ITestCase interface
+	virtual void Run( void );
+private:
+	void TestRecordChecksum( void );
+	void TestTornTail( void );
+	void TestSnapshotCompaction( void );
+};
+
+
+#endif //USE_UT
+
+
+#endif // CommandModelPersistTests_h
@@ -15,6 +15,7 @@
 #include "Application.h"
 #include "resource.h"
 #include "utl/Algorithms.h"
+#include "utl/ContainerOwnership.h"
 #include "utl/MemLeakCheck.h"
 #include "utl/Serialization.h"
 #include "utl/TextClipboard.h"
@@ -26,6 +27,7 @@
 #include "utl/UI/ShellDialogs.h"
 #include "utl/UI/ShellUtilities.h"
 #include "utl/UI/Thumbnailer.h"
+#include "utl/UI/ThumbPack.h"
 #include "utl/UI/WicImageCache.h"
 
 #ifdef _DEBUG
@@ -62,6 +64,7 @@ CAlbumDoc::CAlbumDoc( void )
 CAlbumDoc::~CAlbumDoc()
 {
 	m_model.CloseAllStorages();		// redundant, it happens anyway since the model manages open storages
+	CloseThumbPacks();
 }
 
 void CAlbumDoc::DeleteContents( void )
@@ -69,6 +72,7 @@ void CAlbumDoc::DeleteContents( void )
 	__super::DeleteContents();		// does nothing
 
 	m_model.Clear();
+	CloseThumbPacks();
 }
 
 void CAlbumDoc::CopyAlbumState( const CAlbumDoc* pSrcDoc )
@@ -266,6 +270,39 @@ ICatalogStorage* CAlbumDoc::GetCatalogStorage( void )
 	return nullptr;
 }
 
+void CAlbumDoc::CloseThumbPacks( void )
+{
+	for ( POSITION pos = GetFirstViewPosition(); pos != nullptr; )
+		if ( CAlbumThumbListView* pThumbView = dynamic_cast<CAlbumThumbListView*>( GetNextView( pos ) ) )
+			pThumbView->ReleaseThumbLoader();			// join the worker thread: it may be using a pack
+
+	utl::ClearOwningMapValues( m_thumbPacks );
+}
+
+CThumbPack* CAlbumDoc::GetThumbPack( void )
+{
+	const CSize& boundsSize = app::GetThumbnailer()->GetBoundsSize();
+	CThumbPack*& rpThumbPack = m_thumbPacks[ std::make_pair( boundsSize.cx, boundsSize.cy ) ];
+
+	if ( nullptr == rpThumbPack )			// open once per bounds size, even if it fails (e.g. pack used by another instance)
+	{
+		static bool s_pruned = false;
+		if ( !s_pruned )
+		{	// once per session: delete the packs of albums not opened for a month, and the least recently used past the disk budget
+			s_pruned = true;
+			CThumbPack::PruneStalePacks( CTimeSpan( 30, 0, 0, 0 ), 2 * CThumbPack::MaxPackFileSize );
+		}
+
+		rpThumbPack = new CThumbPack();		// packs are kept open until closing: the background thumb loaders refer to them
+
+		fs::CPath docPath = GetDocFilePath();
+		if ( !docPath.IsEmpty() )
+			rpThumbPack->Open( CThumbPack::MakePackFilePath( docPath, boundsSize ), boundsSize, CThumbPack::GetSlotCountFor( GetImageCount() ) );
+	}
+
+	return rpThumbPack->IsOpen() ? rpThumbPack : nullptr;
+}
+
 std::auto_ptr<CAlbumDoc> CAlbumDoc::LoadAlbumDocument( const fs::CPath& docPath )
 {
 	std::auto_ptr<CAlbumDoc> pNewAlbumDoc( new CAlbumDoc() );
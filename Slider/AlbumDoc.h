@@ -13,6 +13,7 @@
 class CAlbumImageView;
 class CImageState;
 class CProgressService;
+class CThumbPack;
 interface ICatalogStorage;
 
 
@@ -49,6 +50,7 @@ public:
 
 	bool IsStorageAlbum( void ) const;
 	ICatalogStorage* GetCatalogStorage( void );				// opened storage if album based on a catalog storage (compound document)
+	CThumbPack* GetThumbPack( void );						// persistent thumbs for the current thumbnailer bounds size; NULL for unsaved albums
 
 	static std::auto_ptr<CAlbumDoc> LoadAlbumDocument( const fs::CPath& docPath );			// load a new image album (slide or catalog storage)
 
@@ -91,6 +93,7 @@ private:
 private:
 	CAlbumImageView* GetAlbumImageView( void ) const;
 	CSlideData* GetActiveSlideData( void );
+	void CloseThumbPacks( void );						// after stopping the background thumb loaders that use them
 public:
 	persist CSlideData m_slideData;						// always altered by CAlbumImageView::OnActivateView()
 private:
@@ -114,6 +117,8 @@ public:
 	// transient
 	std::tstring m_password;							// allow password edititng of any document (including .sld), in preparation for SaveAs .ias
 	auto_drop::CContext m_autoDropContext;				// contains the dropped files, used during an auto-drop operation
+private:
+	std::map<std::pair<int, int>, CThumbPack*> m_thumbPacks;	// owning: opened on demand per thumb bounds size, for faster album reopening
 
 	// generated stuff
 public:
@@ -5,6 +5,7 @@
 #include "FileAttr.h"
 #include "FileAttrAlgorithms.h"
 #include "ImageFileEnumerator.h"
+#include "ImageMetadata.h"
 #include "Workspace.h"
 #include "Application_fwd.h"
 #include "resource.h"
@@ -130,6 +131,14 @@ void CAlbumModel::SearchForFiles( CWnd* pParentWnd ) throws_( CException* )
 	}
 
 	utl::IProgressService* pProgressSvc = progress.GetService();
+	pProgressSvc->GetHeader()->SetOperationLabel( _T("Read Image Dimensions") );
+	pProgressSvc->GetHeader()->SetStageLabel( str::GetEmpty() );
+	pProgressSvc->SetMarqueeProgress();
+
+	// batch evaluation of image dimensions: only new or modified files get their headers parsed (on worker threads), the rest are cache hits
+	if ( CImageMetadataCache::Instance().AcquireMetadata( foundImagesModel.GetFileAttrs() ) != 0 )
+		CImageMetadataCache::Instance().SaveIfDirty();
+
 	pProgressSvc->GetHeader()->SetOperationLabel( _T("Order Images") );
 	pProgressSvc->GetHeader()->SetStageLabel( str::GetEmpty() );
 	pProgressSvc->SetMarqueeProgress();
@@ -17,6 +17,7 @@
 #include "utl/UI/Thumbnailer.h"
 #include <memory>
 #include <algorithm>
+#include <unordered_set>
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -70,6 +71,7 @@ CAlbumThumbListView::CAlbumThumbListView( void )
 	, m_pSplitterWnd( nullptr )
 	, m_selBkThemeItem( L"LISTVIEW", LVP_GROUPHEADER, LVGH_CLOSESELECTED )
 	, m_beginDragTimer( this, ID_BEGIN_DRAG_TIMER, 350 )
+	, m_prefetchTimer( this, ID_PREFETCH_TIMER, 50 )
 	, m_userChangeSel( 0 )
 	, m_startDragRect( 0, 0, 0, 0 )
 	, m_scrollTimerCounter( 0, 0 )
@@ -137,6 +139,7 @@ void CAlbumThumbListView::SetupAlbumModel( const CAlbumModel* pAlbumModel, bool
 	bool doSmartUpdate = ( pAlbumModel == m_pAlbumModel && countOld > 0 && countNew > 0 );
 
 	m_pAlbumModel = pAlbumModel;
+	CancelPrefetch();				// display indexes have changed
 
 	SetRedraw( FALSE );
 
@@ -516,6 +519,8 @@ void CAlbumThumbListView::DrawItem( DRAWITEMSTRUCT* pDIS )
 			if ( ODA_DRAWENTIRE == pDIS->itemAction )
 				if ( pThumbDib != nullptr )
 					pThumbDib->DrawAtPos( &dc, thumbRect.TopLeft() );
+				else if ( validFile )
+					DrawThumbPlaceholder( &dc, thumbZoneRect );		// thumb still loading
 
 			const TCHAR* pFileName = pFilePath->GetFilenamePtr();
 			CRect rectText( pDIS->rcItem );
@@ -744,13 +749,130 @@ void CAlbumThumbListView::EnsureCaptionFontCreated( void )
 	}
 }
 
-CWicDibSection* CAlbumThumbListView::GetItemThumb( int displayIndex ) const throws_()
+CWicDibSection* CAlbumThumbListView::GetItemThumb( int displayIndex ) throws_()
 {
+	SchedulePrefetch();				// request the thumbs around the visible range, if scrolled
+
 	if ( const fs::CFlexPath* pItemPath = GetItemPath( displayIndex ) )
 		if ( !pItemPath->IsEmpty() )
-			return app::GetThumbnailer()->AcquireThumbnailNoThrow( *pItemPath );
+		{
+			CThumbnailer* pThumbnailer = app::GetThumbnailer();
 
-	return nullptr;
+			if ( CCachedThumbBitmap* pThumb = pThumbnailer->FindThumbnail( *pItemPath ) )
+				return pThumb;
+
+			if ( pThumbnailer->IsExternallyProduced( *pItemPath ) )
+			{	// catalog storage thumbs are fast to extract, but storages are not thread-safe
+				thumb::CPushThumbPack scopedPack( pThumbnailer, GetAlbumDoc()->GetThumbPack() );		// load/store persistent thumbs of this album
+				return pThumbnailer->AcquireThumbnailNoThrow( *pItemPath );
+			}
+		}
+
+	return nullptr;					// never block drawing: the thumb is produced in background
+}
+
+CThumbLoader* CAlbumThumbListView::GetThumbLoader( void )
+{
+	if ( nullptr == m_pThumbLoader.get() )
+		m_pThumbLoader.reset( new CThumbLoader( app::GetThumbnailer(), GetAlbumDoc()->GetThumbPack() ) );
+
+	return m_pThumbLoader.get();
+}
+
+void CAlbumThumbListView::SchedulePrefetch( void )
+{
+	CListBox* pListBox = AsListBox();
+	if ( 0 == pListBox->GetCount() )
+		return;
+
+	CSize pageItemCounts = GetPageItemCounts();
+	int pageCount = HasFlag( GetStyle(), LBS_MULTICOLUMN )
+		? ( pageItemCounts.cx + 1 ) * pageItemCounts.cy		// including the partially visible column
+		: pageItemCounts.cy + 1;								// including the partially visible row
+
+	if ( !m_prefetchRange.Update( pListBox->GetTopIndex(), pageCount ) )
+		return;						// already requested for the visible range
+
+	std::vector<int> displayIndexes;
+	m_prefetchRange.QueryIndexes( displayIndexes, pListBox->GetCount() );
+
+	const CThumbnailer* pThumbnailer = app::GetThumbnailer();
+	std::vector<fs::CFlexPath> srcImagePaths;
+
+	for ( std::vector<int>::const_iterator itIndex = displayIndexes.begin(); itIndex != displayIndexes.end(); ++itIndex )
+		if ( const fs::CFlexPath* pItemPath = GetItemPath( *itIndex ) )
+			if ( !pItemPath->IsEmpty() && !pThumbnailer->IsExternallyProduced( *pItemPath ) && !pThumbnailer->ContainsThumbnail( *pItemPath ) )
+				if ( nullptr == m_pThumbLoader.get() || !m_pThumbLoader->IsFailed( *pItemPath ) )		// skip the images that can't be decoded
+					srcImagePaths.push_back( *pItemPath );
+
+	if ( srcImagePaths.empty() && nullptr == m_pThumbLoader.get() )
+		return;
+
+	GetThumbLoader()->Request( srcImagePaths );			// cancels the pending requests that scrolled out of view
+
+	if ( !srcImagePaths.empty() && !m_prefetchTimer.IsStarted() )
+		m_prefetchTimer.Start();
+}
+
+void CAlbumThumbListView::InsertProducedThumbs( void )
+{
+	ASSERT_PTR( m_pThumbLoader.get() );
+
+	std::vector<CCachedThumbBitmap*> producedThumbs;
+	if ( m_pThumbLoader->FetchProduced( producedThumbs ) != 0 )
+	{
+		CThumbnailer* pThumbnailer = app::GetThumbnailer();
+		std::unordered_set<fs::CFlexPath> producedPaths;
+
+		for ( std::vector<CCachedThumbBitmap*>::const_iterator itThumb = producedThumbs.begin(); itThumb != producedThumbs.end(); ++itThumb )
+		{
+			producedPaths.insert( ( *itThumb )->GetSrcImagePath() );
+			pThumbnailer->InsertThumbnail( *itThumb );
+		}
+
+		// redraw the visible items with placeholders
+		CListBox* pListBox = AsListBox();
+		for ( int index = pListBox->GetTopIndex(), endIndex = std::min( index + m_prefetchRange.GetPageCount(), pListBox->GetCount() ); index < endIndex; ++index )
+			if ( const fs::CFlexPath* pItemPath = GetItemPath( index ) )
+				if ( producedPaths.find( *pItemPath ) != producedPaths.end() )
+				{
+					CRect itemRect = GetItemRectAt( index );
+					InvalidateRect( &itemRect, FALSE );
+				}
+	}
+
+	if ( !m_pThumbLoader->IsBusy() )
+	{
+		m_prefetchTimer.Stop();
+		m_prefetchRange.Reset();		// allow rescheduling on next draw (e.g. after thumbs got evicted from the cache)
+	}
+}
+
+void CAlbumThumbListView::ReleaseThumbLoader( void )
+{
+	m_prefetchTimer.Stop();
+	m_pThumbLoader.reset();			// joins the worker thread; the thumbs produced and not fetched are discarded
+	m_prefetchRange.Reset();
+}
+
+void CAlbumThumbListView::CancelPrefetch( void )
+{
+	if ( m_pThumbLoader.get() != nullptr )
+		m_pThumbLoader->CancelAll();
+
+	m_prefetchRange.Reset();
+}
+
+void CAlbumThumbListView::DrawThumbPlaceholder( CDC* pDC, const CRect& thumbZoneRect ) const
+{
+	CRect placeholderRect( CPoint( 0, 0 ), app::GetThumbnailer()->GetBoundsSize() );
+
+	ui::CenterRect( placeholderRect, thumbZoneRect, true, true, false, CSize( 0, 1 ) );
+	placeholderRect &= thumbZoneRect;
+	placeholderRect.DeflateRect( 4, 4 );
+
+	if ( !placeholderRect.IsRectEmpty() )
+		pDC->DrawEdge( &placeholderRect, EDGE_ETCHED, BF_RECT );
 }
 
 const fs::CFlexPath* CAlbumThumbListView::GetItemPath( int displayIndex ) const
@@ -1005,6 +1127,8 @@ void CAlbumThumbListView::OnUpdate( CView* pSender, LPARAM lHint, CObject* pHint
 	switch ( hint )
 	{
 		case Hint_ViewUpdate:
+			if ( m_pThumbLoader.get() != nullptr )
+				m_pThumbLoader->SyncSettings( app::GetThumbnailer() );		// e.g. thumbnailer flags or scaling method changed in options
 			break;
 		case Hint_ThumbBoundsResized:
 			GetParentFrame()->DestroyWindow();
@@ -1207,6 +1331,8 @@ void CAlbumThumbListView::OnTimer( UINT_PTR eventId )
 {
 	if ( m_beginDragTimer.IsHit( eventId ) )
 		DoDragDrop();
+	else if ( m_prefetchTimer.IsHit( eventId ) )
+		InsertProducedThumbs();
 	else
 		__super::OnTimer( eventId );
 }
@@ -9,6 +9,7 @@
 #include "utl/UI/OleDragDrop_fwd.h"
 #include "utl/UI/OleDropTarget.h"
 #include "utl/UI/ThemeItem.h"
+#include "utl/UI/ThumbLoader.h"
 #include "utl/UI/WindowTimer.h"
 
 
@@ -58,6 +59,8 @@ public:
 	void RestoreSelection( void );
 	bool SelectionOverlapsWith( const std::vector<int>& displayIndexes ) const;
 
+	void ReleaseThumbLoader( void );			// stops the background thumb production (joins the thread), e.g. before closing the thumb packs
+
 	// splitter width quantification
 	int QuantifyListWidth( int listWidth );
 	int GetListClientWidth( int listWidth );
@@ -71,9 +74,16 @@ public:
 
 	const std::vector<int>& GetDragSelIndexes( void ) const { return m_dragSelIndexes; }
 private:
-	CWicDibSection* GetItemThumb( int displayIndex ) const throws_();
+	CWicDibSection* GetItemThumb( int displayIndex ) throws_();
 	const fs::CFlexPath* GetItemPath( int displayIndex ) const;
 
+	// background thumbs prefetch
+	CThumbLoader* GetThumbLoader( void );
+	void SchedulePrefetch( void );
+	void InsertProducedThumbs( void );
+	void CancelPrefetch( void );
+	void DrawThumbPlaceholder( CDC* pDC, const CRect& thumbZoneRect ) const;
+
 	bool DoDragDrop( void );
 	void CancelDragCapture( void );
 
@@ -90,7 +100,7 @@ private:
 	static void EnsureCaptionFontCreated( void );
 	static DWORD GetListCreationStyle( int columnCount ) { return 1 == columnCount ? ( WS_VSCROLL | LBS_DISABLENOSCROLL ) : ( LBS_MULTICOLUMN | WS_HSCROLL ); }
 public:
-	enum Metrics { cxSide = 2, cyTop = 2, cyTextSpace = 2, ID_BEGIN_DRAG_TIMER = 1000 };
+	enum Metrics { cxSide = 2, cyTop = 2, cyTextSpace = 2, ID_BEGIN_DRAG_TIMER = 1000, ID_PREFETCH_TIMER };
 private:
 	bool m_autoDelete;
 	const CAlbumModel* m_pAlbumModel;
@@ -99,6 +109,9 @@ private:
 	CSplitterWindow* m_pSplitterWnd;
 	CThemeItem m_selBkThemeItem;
 	CWindowTimer m_beginDragTimer;
+	CWindowTimer m_prefetchTimer;					// polls the thumbs produced in background
+	std::auto_ptr<CThumbLoader> m_pThumbLoader;
+	thumb::CPrefetchRange m_prefetchRange;
 	int m_userChangeSel;							// true during user selection operation
 	CRect m_startDragRect;
 
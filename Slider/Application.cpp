@@ -7,6 +7,7 @@
 #include "AlbumDoc.h"
 #include "IImageView.h"
 #include "ICatalogStorage.h"
+#include "ImageMetadata.h"
 #include "MoveFileDialog.h"
 #include "OleImagesDataSource.h"
 #include "test/CatalogStorageTests.h"
@@ -211,6 +212,7 @@ namespace reg
 	const TCHAR section_Settings[] = _T("Settings");
 	const TCHAR entry_CustomColors[] = _T("CustomColors");
 	const TCHAR entry_WorkDir[] = _T("LastWorkingDir");
+	const TCHAR entry_ThumbScalingMethod[] = _T("ThumbScalingMethod");
 }
 
 CApplication theApp;
@@ -344,6 +346,7 @@ int CApplication::ExitInstance( void )
 	std::vector<COLORREF> customColors( CColorDialog::GetSavedCustomColors(), CColorDialog::GetSavedCustomColors() + 16 );
 	app::WriteProfileVector( customColors, reg::section_Settings, reg::entry_CustomColors );
 
+	CImageMetadataCache::Instance().SaveIfDirty();
 	m_pEventLogger.reset();
 
 	return __super::ExitInstance();
@@ -371,6 +374,9 @@ void CApplication::InitGlobals( void )
 	m_pThumbnailer->SetExternalProducer( CCatalogStorageFactory::Instance() );		// add as producer of storage-based thumbnails
 	//m_pThumbnailer->SetThumbExtractFlags( SIIGBF_THUMBNAILONLY | SIIGBF_BIGGERSIZEOK );		// doesn't work satisfactory (blank icons instead of default app registered icon)
 
+	int scalingMethod = GetProfileInt( reg::section_Settings, reg::entry_ThumbScalingMethod, thumb::BoxScaling );		// parallel resampler by default
+	m_pThumbnailer->SetScalingMethod( scalingMethod >= thumb::WicFantScaling && scalingMethod <= thumb::LanczosScaling ? static_cast<thumb::ScalingMethod>( scalingMethod ) : thumb::BoxScaling );
+
 	CAboutBox::s_appIconId = IDR_MAINFRAME;
 	m_sharedAccel.Load( IDR_COMMAND_BAR_ACCEL );
 
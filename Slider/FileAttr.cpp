@@ -1,6 +1,7 @@
 
 #include "pch.h"
 #include "FileAttr.h"
+#include "ImageMetadata.h"
 #include "ModelSchema.h"
 #include "ICatalogStorage.h"			// for CCatalogStorageFactory::IsVintageCatalog()
 #include "CatalogStorageService.h"		// for ToAlbumModel()
@@ -198,7 +199,7 @@ app::ModelSchema CFileAttr::EvalLoadingSchema( CArchive& rLoadArchive )
 const CSize& CFileAttr::GetSavingImageDim( void ) const
 {
 	// OPTIMIZATION for documents with many images: speed up saving by saving unevaluated dimensions.
-	// note: GetImageDim() uses WIC to load each image, an expensive operation.
+	// note: GetImageDim() reads the image header (or uses WIC to load embedded images), an expensive operation.
 	if ( serial::CStreamingGuard* pTimeGuard = serial::CStreamingGuard::GetTop() )
 		if ( pTimeGuard->HasStreamingFlag( Saving_SkipImageDimEvaluation ) )
 			return m_imageDim;
@@ -239,7 +240,8 @@ bool CFileAttr::ReadFileStatus( void )
 const CSize& CFileAttr::GetImageDim( void ) const
 {
 	if ( 0 == m_imageDim.cx && 0 == m_imageDim.cy )
-		m_imageDim = CWicImageCache::Instance().LookupImageDim( m_pathKey );
+		if ( !CImageMetadataCache::Instance().LookupImageDim( m_imageDim, *this ) )		// fast: parse the image header only (cached)
+			m_imageDim = CWicImageCache::Instance().LookupImageDim( m_pathKey );		// embedded or multi-frame image: load via WIC
 
 	return m_imageDim;
 }
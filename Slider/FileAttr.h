@@ -43,6 +43,7 @@ public:
 	const FILETIME& GetLastModifTime( void ) const { return m_lastModifTime; }
 	UINT GetFileSize( void ) const { return m_fileSize; }
 	const CSize& GetImageDim( void ) const;
+	void SetImageDim( const CSize& imageDim ) { m_imageDim = imageDim; }
 
 	size_t GetBaselinePos( void ) const { ASSERT( m_baselinePos != utl::npos ); return m_baselinePos; }
 	void StoreBaselinePos( size_t baselinePos ) { m_baselinePos = baselinePos; }		// store it only once (unless this is from an embedded image archive)
@@ -100,11 +100,14 @@ void CImageFileEnumerator::SwapFoundImages( CImagesModel& rImagesModel )
 	m_foundImages.Swap( rImagesModel );
 }
 
-bool CImageFileEnumerator::PassFilter( const CFileAttr& fileAttr ) const
+bool CImageFileEnumerator::PassFilter( const CFileAttr& fileAttr, const fs::CFileState* pFileState ) const
 {
-	fs::CFileState fileState = fs::CFileState::ReadFromFile( fileAttr.GetPath() );
-
-	if ( !PassFileFilter( fileState ) )
+	if ( nullptr == pFileState )
+	{
+		if ( !PassFileFilter( fs::CFileState::ReadFromFile( fileAttr.GetPath() ) ) )
+			return false;
+	}
+	else if ( !PassFileFilter( *pFileState ) )		// use the enumerated file state, no additional file access
 		return false;
 
 	if ( m_pCurrPattern != nullptr )
@@ -115,9 +118,9 @@ bool CImageFileEnumerator::PassFilter( const CFileAttr& fileAttr ) const
 	return true;
 }
 
-bool CImageFileEnumerator::Push( CFileAttr* pFileAttr )
+bool CImageFileEnumerator::Push( CFileAttr* pFileAttr, const fs::CFileState* pFileState /*= nullptr*/ )
 {
-	if ( !PassFilter( *pFileAttr ) )
+	if ( !PassFilter( *pFileAttr, pFileState ) )
 	{
 		delete pFileAttr;
 		return false;
@@ -148,7 +151,7 @@ void CImageFileEnumerator::OnAddFileInfo( const fs::CFileState& fileState ) over
 			AddFoundFile( fileState.m_fullPath );
 	}
 	else
-		Push( new CFileAttr( fileState ) );
+		Push( new CFileAttr( fileState ), &fileState );
 }
 
 void CImageFileEnumerator::AddFoundFile( const fs::CPath& filePath ) override
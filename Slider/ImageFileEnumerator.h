@@ -35,8 +35,8 @@ private:
 	virtual void OnAddFileInfo( const fs::CFileState& fileState ) override;
 	virtual void AddFoundFile( const fs::CPath& filePath ) override;
 
-	bool PassFilter( const CFileAttr& fileAttr ) const;
-	bool Push( CFileAttr* pFileAttr );
+	bool PassFilter( const CFileAttr& fileAttr, const fs::CFileState* pFileState ) const;
+	bool Push( CFileAttr* pFileAttr, const fs::CFileState* pFileState = nullptr );
 	void PushMany( const std::vector<CFileAttr*>& fileAttrs );		// transfer ownership
 private:
 	ui::CIssueStore m_issueStore;
@@ -0,0 +1,466 @@
+
+#include "pch.h"
+#include "ImageMetadata.h"
+#include "FileAttr.h"
+#include "utl/AppTools.h"
+#include "utl/FileSystem.h"
+#include "utl/ParallelFor.h"
+#include "utl/SerializeStdTypes.h"
+#include "utl/UI/MfcUtilities.h"
+#include <fstream>
+#include <shlobj.h>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+
+namespace img
+{
+	namespace hdr
+	{
+		inline UINT GetBE16( const BYTE* pBytes ) { return ( pBytes[ 0 ] << 8 ) | pBytes[ 1 ]; }
+		inline UINT GetLE16( const BYTE* pBytes ) { return pBytes[ 0 ] | ( pBytes[ 1 ] << 8 ); }
+		inline UINT GetBE32( const BYTE* pBytes ) { return ( GetBE16( pBytes ) << 16 ) | GetBE16( pBytes + 2 ); }
+		inline UINT GetLE32( const BYTE* pBytes ) { return GetLE16( pBytes ) | ( GetLE16( pBytes + 2 ) << 16 ); }
+
+
+		// random access reads in the image stream
+
+		class CReader
+		{
+		public:
+			CReader( std::istream& is ) : m_is( is ) {}
+
+			bool ReadAt( std::streamoff offset, BYTE* pBuffer, size_t size )
+			{
+				m_is.clear();
+				m_is.seekg( offset, std::ios_base::beg );
+				return m_is.read( reinterpret_cast<char*>( pBuffer ), size ) && static_cast<size_t>( m_is.gcount() ) == size;
+			}
+		private:
+			std::istream& m_is;
+		};
+
+
+		enum { PrefixSize = 32, MaxJpegSegments = 512, MaxTiffEntries = 1024 };
+
+		bool ParseJpeg( CSize& rImageDim, CReader& reader )
+		{
+			std::streamoff offset = 2;		// skip SOI marker: FF D8
+			BYTE segment[ 5 ];
+
+			for ( UINT segmentCount = 0; segmentCount != MaxJpegSegments; ++segmentCount )
+			{
+				if ( !reader.ReadAt( offset, segment, 2 ) )
+					return false;
+
+				if ( segment[ 0 ] != 0xFF )
+					return false;			// corrupt marker
+
+				BYTE marker = segment[ 1 ];
+
+				if ( 0xFF == marker )
+				{
+					++offset;				// fill byte
+					continue;
+				}
+
+				if ( 0x01 == marker || ( marker >= 0xD0 && marker <= 0xD7 ) )
+				{
+					offset += 2;			// stand-alone markers: TEM, RSTn
+					continue;
+				}
+
+				if ( 0xD9 == marker || 0xDA == marker )
+					return false;			// EOI or SOS reached before any SOFn
+
+				if ( !reader.ReadAt( offset + 2, segment, 2 ) )
+					return false;
+
+				UINT segmentLength = GetBE16( segment );
+				if ( segmentLength < 2 )
+					return false;
+
+				bool isStartOfFrame = marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;	// exclude DHT, JPG, DAC
+
+				if ( isStartOfFrame )
+				{	// SOFn: length(2), precision(1), height(2), width(2)
+					if ( !reader.ReadAt( offset + 4, segment, 5 ) )
+						return false;
+
+					rImageDim.cy = GetBE16( segment + 1 );
+					rImageDim.cx = GetBE16( segment + 3 );
+					return true;
+				}
+
+				offset += 2 + segmentLength;
+			}
+
+			return false;
+		}
+
+		bool ParseTiff( CSize& rImageDim, CReader& reader, const BYTE prefix[] )
+		{
+			bool bigEndian = 'M' == prefix[ 0 ];
+			UINT (*pGet16)( const BYTE* ) = bigEndian ? &GetBE16 : &GetLE16;
+			UINT (*pGet32)( const BYTE* ) = bigEndian ? &GetBE32 : &GetLE32;
+
+			std::streamoff ifdOffset = pGet32( prefix + 4 );
+			BYTE entry[ 12 ];
+
+			if ( !reader.ReadAt( ifdOffset, entry, 2 ) )
+				return false;
+
+			UINT entryCount = std::min<UINT>( pGet16( entry ), MaxTiffEntries );
+			int width = 0, height = 0;
+
+			for ( UINT i = 0; i != entryCount && ( 0 == width || 0 == height ); ++i )
+			{
+				if ( !reader.ReadAt( ifdOffset + 2 + i * COUNT_OF( entry ), entry, COUNT_OF( entry ) ) )
+					return false;
+
+				UINT tag = pGet16( entry ), type = pGet16( entry + 2 );
+				int value;
+
+				if ( 3 == type )			// SHORT: value is left-justified in the value field
+					value = pGet16( entry + 8 );
+				else if ( 4 == type )		// LONG
+					value = pGet32( entry + 8 );
+				else
+					continue;
+
+				if ( 256 == tag )			// ImageWidth
+					width = value;
+				else if ( 257 == tag )		// ImageLength
+					height = value;
+			}
+
+			rImageDim.SetSize( width, height );
+			return width != 0 && height != 0;
+		}
+	}
+
+
+	bool ReadHeaderInfo( CHeaderInfo& rInfo, std::istream& is )
+	{
+		hdr::CReader reader( is );
+		BYTE prefix[ hdr::PrefixSize ];
+
+		rInfo = CHeaderInfo();
+
+		if ( !reader.ReadAt( 0, prefix, 12 ) )
+			return false;
+
+		bool hasFullPrefix = reader.ReadAt( 0, prefix, COUNT_OF( prefix ) );
+
+		if ( 0xFF == prefix[ 0 ] && 0xD8 == prefix[ 1 ] )
+		{
+			rInfo.m_imageFormat = wic::JpegFormat;
+			hdr::ParseJpeg( rInfo.m_imageDim, reader );
+		}
+		else if ( hasFullPrefix && 0 == memcmp( prefix, "\x89PNG\r\n\x1A\n", 8 ) && 0 == memcmp( prefix + 12, "IHDR", 4 ) )
+		{
+			rInfo.m_imageFormat = wic::PngFormat;
+			rInfo.m_imageDim.SetSize( hdr::GetBE32( prefix + 16 ), hdr::GetBE32( prefix + 20 ) );
+		}
+		else if ( 0 == memcmp( prefix, "GIF87a", 6 ) || 0 == memcmp( prefix, "GIF89a", 6 ) )
+		{
+			rInfo.m_imageFormat = wic::GifFormat;
+			rInfo.m_imageDim.SetSize( hdr::GetLE16( prefix + 6 ), hdr::GetLE16( prefix + 8 ) );
+		}
+		else if ( hasFullPrefix && 'B' == prefix[ 0 ] && 'M' == prefix[ 1 ] )
+		{
+			rInfo.m_imageFormat = wic::BmpFormat;
+
+			if ( 12 == hdr::GetLE32( prefix + 14 ) )		// BITMAPCOREHEADER
+				rInfo.m_imageDim.SetSize( hdr::GetLE16( prefix + 18 ), hdr::GetLE16( prefix + 20 ) );
+			else											// BITMAPINFOHEADER and later: negative height for top-down DIBs
+				rInfo.m_imageDim.SetSize( abs( static_cast<int>( hdr::GetLE32( prefix + 18 ) ) ), abs( static_cast<int>( hdr::GetLE32( prefix + 22 ) ) ) );
+		}
+		else if ( 0 == memcmp( prefix, "II*\0", 4 ) || 0 == memcmp( prefix, "MM\0*", 4 ) )
+		{
+			rInfo.m_imageFormat = wic::TiffFormat;
+			hdr::ParseTiff( rInfo.m_imageDim, reader, prefix );
+		}
+		else if ( 0 == memcmp( prefix, "\0\0\1\0", 4 ) && hdr::GetLE16( prefix + 4 ) != 0 )
+		{	// ICONDIR followed by the first ICONDIRENTRY: 0 means 256 pixels
+			rInfo.m_imageFormat = wic::IcoFormat;
+			rInfo.m_imageDim.SetSize( prefix[ 6 ] != 0 ? prefix[ 6 ] : 256, prefix[ 7 ] != 0 ? prefix[ 7 ] : 256 );
+		}
+
+		return rInfo.IsValid();
+	}
+
+	bool ReadHeaderInfo( CHeaderInfo& rInfo, const fs::CPath& imageFilePath )
+	{
+		std::ifstream ifs( imageFilePath.GetPtr(), std::ios_base::in | std::ios_base::binary );
+
+		if ( !ifs.is_open() )
+		{
+			rInfo = CHeaderInfo();
+			return false;
+		}
+
+		return ReadHeaderInfo( rInfo, ifs );
+	}
+}
+
+
+// CImageMetadataCache::CEntry implementation
+
+CImageMetadataCache::CEntry::CEntry( const CFileAttr& fileAttr, const img::CHeaderInfo& headerInfo )
+	: m_fileSize( fileAttr.GetFileSize() )
+	, m_modifTime( reinterpret_cast<const ULARGE_INTEGER&>( fileAttr.GetLastModifTime() ).QuadPart )
+	, m_imageFormat( headerInfo.m_imageFormat )
+	, m_imageDim( headerInfo.m_imageDim )
+{
+}
+
+bool CImageMetadataCache::CEntry::IsUpToDate( const CFileAttr& fileAttr ) const
+{
+	return
+		m_fileSize == fileAttr.GetFileSize() &&
+		m_modifTime == reinterpret_cast<const ULARGE_INTEGER&>( fileAttr.GetLastModifTime() ).QuadPart;
+}
+
+void CImageMetadataCache::CEntry::Stream( CArchive& archive )
+{
+	if ( archive.IsStoring() )
+	{
+		archive << m_fileSize << m_modifTime;
+		archive << (int)m_imageFormat;
+		archive << m_imageDim;
+	}
+	else
+	{
+		archive >> m_fileSize >> m_modifTime;
+		archive >> (int&)m_imageFormat;
+		archive >> m_imageDim;
+	}
+}
+
+
+// CImageMetadataCache implementation
+
+const UINT CImageMetadataCache::s_fileVersion = 1;
+
+CImageMetadataCache::CImageMetadataCache( const fs::CPath& filePath )
+	: m_filePath( filePath )
+	, m_loaded( false )
+	, m_dirty( false )
+{
+}
+
+CImageMetadataCache::~CImageMetadataCache()
+{
+}
+
+CImageMetadataCache& CImageMetadataCache::Instance( void )
+{
+	static CImageMetadataCache s_cache( GetDefaultFilePath() );
+	return s_cache;
+}
+
+fs::CPath CImageMetadataCache::GetDefaultFilePath( void )
+{	// per user and writable: the executable directory may be read-only (e.g. "Program Files"), and shared by users
+	std::tstring appName = app::GetModulePath().GetFname();
+	fs::TDirPath dirPath;
+	TCHAR localAppDataPath[ MAX_PATH ];
+
+	if ( HR_OK( ::SHGetFolderPath( nullptr, CSIDL_LOCAL_APPDATA | CSIDL_FLAG_CREATE, nullptr, SHGFP_TYPE_CURRENT, localAppDataPath ) ) )
+		dirPath = fs::TDirPath( localAppDataPath ) / appName.c_str();
+	else
+		dirPath = fs::GetTempDirPath() / appName.c_str();
+
+	return dirPath / ( appName + _T(".imd") ).c_str();
+}
+
+size_t CImageMetadataCache::GetCount( void ) const
+{
+	mt::CAutoLock lock( &m_cs );
+	return m_entries.size();
+}
+
+void CImageMetadataCache::Clear( void )
+{
+	mt::CAutoLock lock( &m_cs );
+	m_dirty = !m_entries.empty();
+	m_entries.clear();
+}
+
+bool CImageMetadataCache::IsCacheable( const CFileAttr& fileAttr )
+{
+	const FILETIME& modifTime = fileAttr.GetLastModifTime();
+
+	return
+		!fileAttr.GetPath().IsEmpty() &&
+		!fileAttr.GetPath().IsComplexPath() &&					// WIC will read embedded images from their storage
+		0 == fileAttr.GetPathKey().second &&					// header parsing is for the first frame only
+		( modifTime.dwLowDateTime != 0 || modifTime.dwHighDateTime != 0 );
+}
+
+const CImageMetadataCache::CEntry* CImageMetadataCache::FindEntry( const CFileAttr& fileAttr )
+{	// not synchronized
+	std::unordered_map<fs::CPath, CEntry>::const_iterator itFound = m_entries.find( fileAttr.GetPath() );
+
+	if ( itFound != m_entries.end() && itFound->second.IsUpToDate( fileAttr ) )
+		return &itFound->second;
+
+	return nullptr;
+}
+
+bool CImageMetadataCache::LookupImageDim( CSize& rImageDim, const CFileAttr& fileAttr )
+{
+	if ( !IsCacheable( fileAttr ) )
+		return false;
+
+	mt::CAutoLock lock( &m_cs );
+	LoadOnce();
+
+	if ( const CEntry* pEntry = FindEntry( fileAttr ) )
+	{
+		rImageDim = pEntry->m_imageDim;
+		return true;
+	}
+
+	img::CHeaderInfo headerInfo;
+	if ( !img::ReadHeaderInfo( headerInfo, fileAttr.GetPath() ) )
+		return false;
+
+	m_entries[ fileAttr.GetPath() ] = CEntry( fileAttr, headerInfo );
+	m_dirty = true;
+
+	rImageDim = headerInfo.m_imageDim;
+	return true;
+}
+
+size_t CImageMetadataCache::AcquireMetadata( const std::vector<CFileAttr*>& fileAttrs )
+{
+	std::vector<CFileAttr*> missingAttrs;
+
+	{
+		mt::CAutoLock lock( &m_cs );
+		LoadOnce();
+
+		for ( std::vector<CFileAttr*>::const_iterator itFileAttr = fileAttrs.begin(); itFileAttr != fileAttrs.end(); ++itFileAttr )
+			if ( IsCacheable( **itFileAttr ) )
+				if ( const CEntry* pEntry = FindEntry( **itFileAttr ) )
+					( *itFileAttr )->SetImageDim( pEntry->m_imageDim );		// cache hit: no file access
+				else
+					missingAttrs.push_back( *itFileAttr );
+	}
+
+	if ( missingAttrs.empty() )
+		return 0;
+
+	// parse the headers of new or modified files on worker threads (I/O bound, small reads)
+	std::vector<img::CHeaderInfo> headerInfos( missingAttrs.size() );
+
+	mt::ParallelFor( missingAttrs.size(),
+		[&]( size_t pos )
+		{
+			img::ReadHeaderInfo( headerInfos[ pos ], missingAttrs[ pos ]->GetPath() );
+		},
+		std::max<size_t>( mt::GetHardwareThreadCount(), 4 ) );
+
+	size_t parsedCount = 0;
+	mt::CAutoLock lock( &m_cs );
+
+	for ( size_t pos = 0; pos != missingAttrs.size(); ++pos )
+		if ( headerInfos[ pos ].IsValid() )
+		{
+			missingAttrs[ pos ]->SetImageDim( headerInfos[ pos ].m_imageDim );
+			m_entries[ missingAttrs[ pos ]->GetPath() ] = CEntry( *missingAttrs[ pos ], headerInfos[ pos ] );
+			++parsedCount;
+		}
+
+	if ( parsedCount != 0 )
+		m_dirty = true;
+
+	return parsedCount;
+}
+
+void CImageMetadataCache::LoadOnce( void )
+{	// not synchronized
+	if ( m_loaded )
+		return;
+
+	m_loaded = true;
+
+	ui::CAdapterDocument doc( this, m_filePath );
+	if ( !doc.Load() )
+		m_entries.clear();			// missing or incompatible cache file: start with an empty cache
+}
+
+bool CImageMetadataCache::SaveIfDirty( void )
+{
+	mt::CAutoLock lock( &m_cs );
+
+	if ( !m_dirty )
+		return false;
+
+	RemoveMissingFiles();
+
+	if ( !fs::CreateDirPath( m_filePath.GetParentPath().GetPtr() ) )
+		return false;
+
+	ui::CAdapterDocument doc( this, m_filePath );
+	if ( !doc.Save() )
+		return false;
+
+	m_dirty = false;
+	return true;
+}
+
+size_t CImageMetadataCache::RemoveMissingFiles( void )
+{	// not synchronized: the cache outlives the albums, so drop the images deleted since
+	size_t removedCount = 0;
+
+	for ( std::unordered_map<fs::CPath, CEntry>::iterator itEntry = m_entries.begin(); itEntry != m_entries.end(); )
+		if ( !fs::IsValidFile( itEntry->first.GetPtr() ) )
+		{
+			itEntry = m_entries.erase( itEntry );
+			++removedCount;
+		}
+		else
+			++itEntry;
+
+	return removedCount;
+}
+
+void CImageMetadataCache::Save( CArchive& archive ) throws_( CException* )
+{
+	archive << s_fileVersion;
+	archive << static_cast<UINT>( m_entries.size() );
+
+	for ( std::unordered_map<fs::CPath, CEntry>::iterator itEntry = m_entries.begin(); itEntry != m_entries.end(); ++itEntry )
+	{
+		archive << itEntry->first;
+		itEntry->second.Stream( archive );
+	}
+}
+
+void CImageMetadataCache::Load( CArchive& archive ) throws_( CException* )
+{
+	UINT fileVersion, count;
+	archive >> fileVersion;
+
+	if ( fileVersion != s_fileVersion )
+		return;						// ignore cache saved in a different format
+
+	archive >> count;
+
+	m_entries.clear();
+	m_entries.reserve( count );
+
+	for ( UINT i = 0; i != count; ++i )
+	{
+		fs::CPath filePath;
+		CEntry entry;
+
+		archive >> filePath;
+		entry.Stream( archive );
+		m_entries[ filePath ] = entry;
+	}
+}
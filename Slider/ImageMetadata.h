@@ -0,0 +1,97 @@
+#ifndef ImageMetadata_h
+#define ImageMetadata_h
+#pragma once
+
+#include <unordered_map>
+#include <iosfwd>
+#include <afxmt.h>
+#include "utl/Path.h"
+#include "utl/Serialization_fwd.h"
+#include "utl/UI/ImagingWic.h"
+
+
+class CFileAttr;
+
+
+namespace img
+{
+	// image format and dimensions evaluated by parsing only the image file header (no decoding, no WIC)
+
+	struct CHeaderInfo
+	{
+		CHeaderInfo( void ) : m_imageFormat( wic::UnknownImageFormat ), m_imageDim( 0, 0 ) {}
+
+		bool IsValid( void ) const { return m_imageFormat != wic::UnknownImageFormat && m_imageDim.cx > 0 && m_imageDim.cy > 0; }
+	public:
+		wic::ImageFormat m_imageFormat;
+		CSize m_imageDim;					// dimensions of the first frame
+	};
+
+
+	// Supported: JPEG (SOFn marker), PNG (IHDR chunk), GIF (logical screen), BMP (DIB header), TIFF (first IFD), ICO (first entry).
+	// Only small reads are performed: for JPEG and TIFF it seeks through the markers/IFD without reading the image data.
+	bool ReadHeaderInfo( CHeaderInfo& rInfo, std::istream& is );
+	bool ReadHeaderInfo( CHeaderInfo& rInfo, const fs::CPath& imageFilePath );
+}
+
+
+// Persistent cache of image metadata (format and dimensions) keyed by the file path, validated by file size + last modify time.
+// Evaluates the metadata of new or modified files by parsing image headers, in batch on a pool of worker threads.
+// Persisted per user in the local application data directory; the entries of deleted files are dropped when saving.
+// Thread safe: access to the cache is serialized internally through a critical section.
+//
+class CImageMetadataCache : public serial::IStreamable
+						  , private utl::noncopyable
+{
+public:
+	explicit CImageMetadataCache( const fs::CPath& filePath );		// public for testing: the application uses Instance()
+	~CImageMetadataCache();
+
+	static CImageMetadataCache& Instance( void );
+	static fs::CPath GetDefaultFilePath( void );					// e.g. "%LOCALAPPDATA%\Slider\Slider.imd"
+
+	const fs::CPath& GetFilePath( void ) const { return m_filePath; }
+
+	size_t GetCount( void ) const;
+	void Clear( void );
+
+	bool LookupImageDim( CSize& rImageDim, const CFileAttr& fileAttr );		// cache hit or header read; false for embedded or multi-frame images
+	size_t AcquireMetadata( const std::vector<CFileAttr*>& fileAttrs );		// batch evaluation of missing dimensions; returns the count of parsed image headers
+
+	bool SaveIfDirty( void );
+
+	// serial::IStreamable interface
+	virtual void Save( CArchive& archive ) throws_( CException* );
+	virtual void Load( CArchive& archive ) throws_( CException* );
+private:
+	struct CEntry
+	{
+		CEntry( void ) : m_fileSize( 0 ), m_modifTime( 0 ), m_imageFormat( wic::UnknownImageFormat ), m_imageDim( 0, 0 ) {}
+		CEntry( const CFileAttr& fileAttr, const img::CHeaderInfo& headerInfo );
+
+		bool IsUpToDate( const CFileAttr& fileAttr ) const;
+
+		void Stream( CArchive& archive );
+	public:
+		UINT64 m_fileSize;
+		UINT64 m_modifTime;					// FILETIME as 64-bit integer
+		wic::ImageFormat m_imageFormat;
+		CSize m_imageDim;
+	};
+
+	static bool IsCacheable( const CFileAttr& fileAttr );
+	const CEntry* FindEntry( const CFileAttr& fileAttr );
+	void LoadOnce( void );
+	size_t RemoveMissingFiles( void );
+private:
+	fs::CPath m_filePath;
+	bool m_loaded;
+	bool m_dirty;
+	std::unordered_map<fs::CPath, CEntry> m_entries;
+	mutable CCriticalSection m_cs;			// serialize cache access for thread safety
+
+	static const UINT s_fileVersion;
+};
+
+
+#endif // ImageMetadata_h
@@ -4,10 +4,18 @@
 #ifdef USE_UT		// no UT code in release builds
 #include "ThumbnailTests.h"
 #include "Application.h"
+#include "FileAttr.h"
+#include "ImageMetadata.h"
+#include "utl/AppTools.h"
 #include "utl/ContainerOwnership.h"
 #include "utl/FileEnumerator.h"
+#include "utl/FileSystem.h"
 #include "utl/StructuredStorage.h"
+#include "utl/UI/GdiCoords.h"
 #include "utl/UI/Thumbnailer.h"
+#include "utl/UI/ThumbLoader.h"
+#include "utl/UI/ThumbPack.h"
+#include "utl/UI/WicImageCache.h"
 #include "utl/UI/test/TestToolWnd.h"
 
 #ifdef _DEBUG
@@ -113,6 +121,96 @@ void CThumbnailTests::DrawThumbs( ut::CTestDevice& rTestDev, const std::vector<T
 	}
 }
 
+void CThumbnailTests::TestImageHeaderInfo( void )
+{
+	const fs::TDirPath& imageSrcPath = ut::GetStdImageDirPath();
+	if ( imageSrcPath.IsEmpty() )
+		return;
+
+	fs::CPathEnumerator imageEnum( fs::EF_Recurse );
+	fs::EnumFiles( &imageEnum, imageSrcPath, _T("*.*") );
+
+	fs::CPath srcImagePath;
+	CSize srcImageDim;
+
+	for ( std::vector<fs::CPath>::const_iterator itFilePath = imageEnum.m_filePaths.begin(); itFilePath != imageEnum.m_filePaths.end(); ++itFilePath )
+	{
+		img::CHeaderInfo headerInfo;
+		if ( img::ReadHeaderInfo( headerInfo, *itFilePath ) )
+		{	// header parsing must match the dimensions of the WIC decoded first frame
+			CSize wicImageDim = CWicImageCache::Instance().LookupImageDim( fs::TImagePathKey( fs::ToFlexPath( *itFilePath ), 0 ) );
+
+			ASSERT( wicImageDim == headerInfo.m_imageDim );
+			ASSERT_EQUAL( wic::FindFileImageFormat( itFilePath->GetPtr() ), headerInfo.m_imageFormat );
+
+			if ( srcImagePath.IsEmpty() )
+			{
+				srcImagePath = *itFilePath;
+				srcImageDim = headerInfo.m_imageDim;
+			}
+		}
+	}
+
+	if ( srcImagePath.IsEmpty() )
+		return;
+
+	// metadata cache: entries validated by file size and modify time, persisted without the deleted files
+	const TCHAR* pExt = srcImagePath.GetExt();
+	ut::CTempFilePool pool( str::Format( _T("Kept%s|Deleted%s|Resized%s|Touched%s"), pExt, pExt, pExt, pExt ).c_str() );
+	ASSERT( pool.IsValidPool() );
+
+	const std::vector<fs::CPath>& imagePaths = pool.GetFilePaths();
+	const fs::CPath& keptPath = imagePaths[ 0 ], & deletedPath = imagePaths[ 1 ], & resizedPath = imagePaths[ 2 ], & touchedPath = imagePaths[ 3 ];
+	const fs::CPath cacheFilePath = pool.QualifyPath( _T("Metadata.imd") );
+	CSize imageDim;
+
+	for ( std::vector<fs::CPath>::const_iterator itImagePath = imagePaths.begin(); itImagePath != imagePaths.end(); ++itImagePath )
+		ASSERT( ::CopyFile( srcImagePath.GetPtr(), itImagePath->GetPtr(), FALSE ) );
+	{
+		CImageMetadataCache cache( cacheFilePath );
+
+		for ( std::vector<fs::CPath>::const_iterator itImagePath = imagePaths.begin(); itImagePath != imagePaths.end(); ++itImagePath )
+		{
+			ASSERT( cache.LookupImageDim( imageDim, CFileAttr( *itImagePath ) ) );
+			ASSERT_EQUAL( srcImageDim, imageDim );
+		}
+		ASSERT_EQUAL( 4, cache.GetCount() );
+
+		// size changed, same modify time: not an image anymore
+		CTime modifTime = fs::ReadLastModifyTime( resizedPath );
+		ut::SetFileText( resizedPath, _T("not an image") );
+		fs::thr::TouchFile( resizedPath, modifTime );
+		ASSERT( !cache.LookupImageDim( imageDim, CFileAttr( resizedPath ) ) );
+
+		// modify time changed, same size: header overwritten
+		{
+			CFile imageFile( touchedPath.GetPtr(), CFile::modeWrite | CFile::typeBinary );
+			const BYTE zeros[ 16 ] = { 0 };
+			imageFile.Write( zeros, sizeof( zeros ) );
+		}
+		fs::thr::TouchFileBy( touchedPath, CTimeSpan( 0, 0, 0, 2 ) );
+		ASSERT_EQUAL( fs::GetFileSize( keptPath.GetPtr() ), fs::GetFileSize( touchedPath.GetPtr() ) );
+		ASSERT( !cache.LookupImageDim( imageDim, CFileAttr( touchedPath ) ) );
+
+		fs::DeleteFile( deletedPath.GetPtr() );
+		ASSERT( cache.SaveIfDirty() );
+		ASSERT_EQUAL( 3, cache.GetCount() );			// deleted file dropped
+		ASSERT( !cache.SaveIfDirty() );
+	}
+
+	{	// round trip: the loaded entry is used without reading the image
+		CFileAttr keptAttr( keptPath );
+		fs::DeleteFile( keptPath.GetPtr() );
+
+		CImageMetadataCache cache( cacheFilePath );
+		ASSERT( cache.LookupImageDim( imageDim, keptAttr ) );
+		ASSERT_EQUAL( srcImageDim, imageDim );
+		ASSERT_EQUAL( 3, cache.GetCount() );
+	}
+
+	ASSERT( CImageMetadataCache::GetDefaultFilePath().GetParentPath() != app::GetModulePath().GetParentPath() );		// not next to the executable
+}
+
 void CThumbnailTests::TestThumbConversion( void )
 {
 	fs::CFlexPath imagePath = MakeTestImageFilePath( Flamingos_jpg );
@@ -191,13 +289,196 @@ void CThumbnailTests::TestThumbnailCache( ut::CTestDevice& rTestDev )
 	// thumbs are owned by the cache, don't delete them
 }
 
+void CThumbnailTests::TestThumbPack( void )
+{
+	const fs::TDirPath& imageSrcPath = ut::GetStdImageDirPath();
+	if ( imageSrcPath.IsEmpty() )
+		return;
+
+	fs::CPathEnumerator imageEnum( fs::EF_Recurse );
+	fs::EnumFiles( &imageEnum, imageSrcPath, _T("*.*") );
+	fs::SortPaths( imageEnum.m_filePaths );
+
+	if ( imageEnum.m_filePaths.size() > MaxImageFiles )
+		imageEnum.m_filePaths.resize( MaxImageFiles );
+
+	CThumbnailer* pThumbnailer = ut::GetThumbnailer();
+	const CSize& boundsSize = pThumbnailer->GetBoundsSize();
+	fs::CPath packFilePath = CThumbPack::MakePackFilePath( fs::GetTempDirPath() / _T("ThumbPackTest.sld"), boundsSize );
+
+	fs::DeleteFile( packFilePath.GetPtr() );			// start with a new pack
+	UINT slotCount = 0;
+	{
+		CThumbPack thumbPack;
+		ASSERT( thumbPack.Open( packFilePath, boundsSize, 16 ) );
+		ASSERT_EQUAL( 16, thumbPack.GetSlotCount() );
+		ASSERT_EQUAL( 0, thumbPack.GetUsedCount() );
+
+		thumb::CPushThumbPack scopedPack( pThumbnailer, &thumbPack );
+		size_t storeCount = 0;
+
+		pThumbnailer->Clear();
+		for ( std::vector<fs::CPath>::const_iterator itFilePath = imageEnum.m_filePaths.begin(); itFilePath != imageEnum.m_filePaths.end(); ++itFilePath )
+			if ( pThumbnailer->AcquireThumbnail( fs::ToFlexPath( *itFilePath ) ) != nullptr )
+				++storeCount;
+
+		ASSERT_EQUAL( storeCount, thumbPack.GetStats().m_storeCount );
+		ASSERT( thumbPack.GetUsedCount() <= thumbPack.GetSlotCount() );
+		ASSERT_EQUAL( 0, thumbPack.GetStats().m_hitCount );
+
+		slotCount = thumbPack.GetSlotCount();
+		if ( storeCount > 12 )
+			ASSERT( slotCount > 16 );					// grown past 3/4 load
+	}
+
+	{	// reopen the pack: thumbs evicted from the memory cache are loaded from the pack
+		CThumbPack thumbPack;
+		ASSERT( thumbPack.Open( packFilePath, boundsSize, 16 ) );
+		ASSERT_EQUAL( slotCount, thumbPack.GetSlotCount() );		// existing layout is kept
+
+		thumb::CPushThumbPack scopedPack( pThumbnailer, &thumbPack );
+
+		pThumbnailer->Clear();
+		for ( std::vector<fs::CPath>::const_iterator itFilePath = imageEnum.m_filePaths.begin(); itFilePath != imageEnum.m_filePaths.end(); ++itFilePath )
+		{
+			int cacheStatus = 0;
+			if ( CCachedThumbBitmap* pThumb = pThumbnailer->AcquireThumbnail( fs::ToFlexPath( *itFilePath ), &cacheStatus ) )
+				if ( HasFlag( cacheStatus, CThumbnailer::PackHit ) )
+				{
+					ASSERT( ui::FitsInside( boundsSize, pThumb->GetBmpFmt().m_size ) );
+					ASSERT_EQUAL( fs::FileNotExpired, pThumb->CheckExpired() );
+				}
+		}
+
+		ASSERT( thumbPack.GetStats().m_hitCount != 0 );
+		ASSERT( thumbPack.GetStats().m_hitCount <= thumbPack.GetUsedCount() );
+
+		// a modified source image is not loaded from the pack
+		const fs::CFlexPath firstImagePath = fs::ToFlexPath( imageEnum.m_filePaths.front() );
+		if ( thumbPack.Load( firstImagePath, fs::ReadLastModifyTime( firstImagePath ) ) != nullptr )
+			ASSERT( nullptr == thumbPack.Load( firstImagePath, fs::ReadLastModifyTime( firstImagePath ) + CTimeSpan( 0, 0, 0, 1 ) ) );
+
+		UT_TRACE( str::Format( _T("ThumbPack: %s"), thumbPack.GetStats().Format().c_str() ).c_str() );
+	}
+
+	{	// reopen for a larger album: the pack grows, keeping the stored thumbs
+		CThumbPack thumbPack;
+		ASSERT( thumbPack.Open( packFilePath, boundsSize, slotCount * 2 ) );
+		ASSERT_EQUAL( slotCount * 2, thumbPack.GetSlotCount() );
+		ASSERT( thumbPack.GetUsedCount() != 0 );		// thumbs rehashed into the new slots
+	}
+
+	{	// corrupt the slots: a pack with slots out of bounds is rejected and recreated
+		enum { PackHeaderSize = 4096 };			// page-sized pack header, followed by the slots
+
+		CFile packFile( packFilePath.GetPtr(), CFile::modeReadWrite | CFile::typeBinary );
+		std::vector<BYTE> garbage( static_cast<size_t>( packFile.GetLength() ) - PackHeaderSize, 0xFF );
+
+		packFile.Seek( PackHeaderSize, CFile::begin );
+		packFile.Write( &garbage.front(), static_cast<UINT>( garbage.size() ) );
+		packFile.Close();
+
+		CThumbPack thumbPack;
+		ASSERT( thumbPack.Open( packFilePath, boundsSize ) );
+		ASSERT_EQUAL( static_cast<UINT>( CThumbPack::MinSlotCount ), thumbPack.GetSlotCount() );		// new layout
+		ASSERT_EQUAL( 0, thumbPack.GetUsedCount() );
+	}
+
+	pThumbnailer->Clear();
+	fs::DeleteFile( packFilePath.GetPtr() );
+
+	{	// packs not used for longer than max age are pruned
+		fs::CPath stalePackPath = CThumbPack::GetPackDirPath() / _T("ThumbPackTest_Stale.tpk");
+		{
+			CFile staleFile( stalePackPath.GetPtr(), CFile::modeCreate | CFile::modeWrite | CFile::typeBinary );
+		}
+		fs::thr::TouchFile( stalePackPath, CTime::GetCurrentTime() - CTimeSpan( 60, 0, 0, 0 ) );
+
+		ASSERT( CThumbPack::PruneStalePacks( CTimeSpan( 30, 0, 0, 0 ), CThumbPack::MaxPackFileSize ) >= 1 );
+		ASSERT( !fs::IsValidFile( stalePackPath.GetPtr() ) );
+	}
+}
+
+void CThumbnailTests::TestPrefetchRange( void )
+{
+	thumb::CPrefetchRange range;
+	std::vector<int> indexes;
+
+	range.QueryIndexes( indexes, 100 );
+	ASSERT( indexes.empty() );						// no visible range yet
+
+	// idle: visible page, one page ahead, one page behind (nearest first)
+	ASSERT( range.Update( 10, 5, 1000 ) );
+	ASSERT( !range.Update( 10, 5, 1010 ) );			// same visible range
+	ASSERT_EQUAL( 0.0, range.GetVelocity() );
+
+	range.QueryIndexes( indexes, 100 );
+	ASSERT_EQUAL( _T("10,11,12,13,14,15,16,17,18,19,9,8,7,6,5"), str::FormatSet( indexes, _T(",") ) );
+
+	range.QueryIndexes( indexes, 12 );				// clamped to item count
+	ASSERT_EQUAL( _T("10,11,9,8,7,6,5"), str::FormatSet( indexes, _T(",") ) );
+
+	// scrolling forward fast: more pages ahead, half page behind
+	ASSERT( range.Update( 20, 5, 1100 ) );			// 100 items/sec, smoothed to 50
+	ASSERT( range.GetVelocity() > 0.0 );
+	ASSERT( range.Update( 30, 5, 1200 ) );			// smoothed to 75
+	ASSERT_EQUAL( 75.0, range.GetVelocity() );
+	ASSERT_EQUAL( 5 * 4, range.GetAheadCount() );	// max ahead pages
+	ASSERT_EQUAL( 2, range.GetBehindCount() );
+
+	range.QueryIndexes( indexes, 100 );
+	ASSERT_EQUAL( 5 + 20 + 2, indexes.size() );
+	ASSERT_EQUAL( 30, indexes.front() );
+	ASSERT_EQUAL( 54, indexes[ 24 ] );				// last ahead
+	ASSERT_EQUAL( 29, indexes[ 25 ] );				// first behind
+
+	// scrolling backwards: ahead goes towards the start
+	ASSERT( range.Update( 25, 5, 1300 ) );
+	ASSERT( range.Update( 15, 5, 1400 ) );
+	ASSERT( range.GetVelocity() < 0.0 );
+
+	range.QueryIndexes( indexes, 100 );
+	ASSERT_EQUAL( 15, indexes.front() );
+	ASSERT_EQUAL( 14, indexes[ 5 ] );				// first ahead
+	ASSERT_EQUAL( 21, indexes.back() );				// last behind: half page
+
+	// resuming after idle: velocity restarts from 0
+	ASSERT( range.Update( 16, 5, 1400 + thumb::CPrefetchRange::IdleMs + 1 ) );
+	ASSERT_EQUAL( 0.0, range.GetVelocity() );
+}
+
+void CThumbnailTests::TestThumbLoaderFailures( void )
+{
+	ut::CTempFilePool pool( _T("Corrupt.jpg") );		// text content: not decodable
+	ASSERT( pool.IsValidPool() );
+
+	const fs::CFlexPath corruptPath = fs::ToFlexPath( pool.GetFilePaths().front() );
+	CThumbLoader loader( ut::GetThumbnailer() );
+	ASSERT( !loader.IsFailed( corruptPath ) );
+
+	loader.Request( std::vector<fs::CFlexPath>( 1, corruptPath ) );
+	for ( int waitMs = 0; loader.IsBusy() && waitMs < 5000; waitMs += 10 )
+		::Sleep( 10 );
+
+	std::vector<CCachedThumbBitmap*> producedThumbs;
+	ASSERT_EQUAL( 0, loader.FetchProduced( producedThumbs ) );
+	ASSERT( loader.IsFailed( corruptPath ) );			// not requested again on repaint
+
+	fs::thr::TouchFileBy( pool.GetFilePaths().front(), CTimeSpan( 0, 0, 0, 2 ) );
+	ASSERT( !loader.IsFailed( corruptPath ) );			// modified: gets another chance
+}
+
 void CThumbnailTests::Run( void )
 {
 	ut::CTestDevice testDev( ut::CTestToolWnd::AcquireWnd() );
 
+	RUN_TEST( TestImageHeaderInfo );
 	RUN_TEST( TestThumbConversion );
 	RUN_TESTDEV_1( TestImageThumbs, testDev ); testDev.ResetOrigin();
 	RUN_TESTDEV_1( TestThumbnailCache, testDev );
+	RUN_TEST( TestThumbPack );
+	RUN_TEST( TestPrefetchRange );
+	RUN_TEST( TestThumbLoaderFailures );
 }
 
 
@@ -28,9 +28,13 @@ private:
 
 	static void DrawThumbs( ut::CTestDevice& rTestDev, const std::vector<TBitmapPathPair>& thumbs );
 private:
+	void TestImageHeaderInfo( void );
 	void TestThumbConversion( void );
 	void TestImageThumbs( ut::CTestDevice& rTestDev );
 	void TestThumbnailCache( ut::CTestDevice& rTestDev );
+	void TestThumbPack( void );
+	void TestPrefetchRange( void );
+	void TestThumbLoaderFailures( void );
 };
 
 
@@ -4,6 +4,7 @@
 #include "AppService.h"
 #include "MainDialog.h"
 #include "resource.h"
+#include "test/FlagStoreTests.h"
 #include "utl/UI/CmdTagStore.h"
 #include "utl/UI/MenuUtilities.h"
 #include "utl/UI/ProcessUtils.h"
@@ -28,6 +29,17 @@ static const ui::CCmdAlias s_cmdAliases[] =
 };
 
 
+namespace ut
+{
+	void RegisterAppUnitTests( void )
+	{
+	#ifdef USE_UT
+		CFlagStoreTests::Instance();
+	#endif
+	}
+}
+
+
 namespace app
 {
 	void DrillDownDetail( DetailPage detailPage )
@@ -67,6 +79,8 @@ BOOL CApplication::InitInstance( void )
 	GetSharedImageStore()->RegisterToolbarImages( IDR_IMAGE_STRIP );
 	GetSharedImageStore()->RegisterAliases( ARRAY_SPAN( s_cmdAliases ) );
 
+	ut::RegisterAppUnitTests();
+
 	CBaseMainDialog::ParseCommandLine( __argc, __targv );
 
 	CMainDialog mainDialog;
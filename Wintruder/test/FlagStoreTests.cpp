@@ -0,0 +1,127 @@
+
+#include "pch.h"
+
+#ifdef USE_UT		// no UT code in release builds
+#include "FlagStoreTests.h"
+#include "wnd/FlagStore.h"
+
+#define new DEBUG_NEW
+
+
+namespace ut
+{
+	CFlagInfo s_testFlags[] =
+	{
+		{ 0x0001, 0, CFlagInfo::Editable, _T("TS_BIT0") },
+		{ 0x0002, 0, CFlagInfo::Editable, _T("TS_BIT1/TS_ALIAS1") },
+		{ 0x0010, 0, CFlagInfo::ReadOnly, _T("TS_BIT4") },
+		{ 0, 0, CFlagInfo::Separator, _T("Alignment") },
+		{ 0x0000, 0x0300, CFlagInfo::Editable, _T("TS_LEFT") },			// enum values of mask 0x0300
+		{ 0x0100, 0x0300, CFlagInfo::Editable, _T("TS_CENTER") },
+		{ 0x0200, 0x0300, CFlagInfo::Editable, _T("TS_RIGHT") },
+		{ 0x0300, 0x0300, CFlagInfo::Editable, _T("TS_JUSTIFY") },
+		{ 0x0400, 0x0C00, CFlagInfo::Editable, _T("TS_SMALL") },			// masked values with no zero value
+		{ 0x0800, 0x0C00, CFlagInfo::Editable, _T("TS_LARGE") },
+		{ 0x1000, 0, CFlagInfo::Editable, _T("TS_BIT12") }				// another run of bit flags
+	};
+
+	std::tstring DecodeFlags( const CFlagDecoder& decoder, DWORD flags, bool withZeroFlags = false )
+	{
+		std::tstring text;
+		decoder.StreamFlags( text, flags, stream::flagSep, withZeroFlags );
+		return text;
+	}
+
+	std::tstring DecodeFlagsByInfo( const CFlagInfo flagInfos[], unsigned int count, DWORD flags, bool withZeroFlags )
+	{	// reference: test each flag on its own
+		std::tstring text;
+
+		for ( unsigned int i = 0; i != count; ++i )
+			if ( !flagInfos[ i ].IsSeparator() && flagInfos[ i ].IsOn( flags ) )
+				if ( flagInfos[ i ].m_value != 0 || withZeroFlags )
+					stream::Tag( text, flagInfos[ i ].m_pRawTag, stream::flagSep );
+
+		return text;
+	}
+}
+
+
+CFlagStoreTests::CFlagStoreTests( void )
+{
+	ut::CTestSuite::Instance().RegisterTestCase( this );		// self-registration
+}
+
+CFlagStoreTests& CFlagStoreTests::Instance( void )
+{
+	static CFlagStoreTests s_testCase;
+	return s_testCase;
+}
+
+void CFlagStoreTests::TestDecodeBitFlags( void )
+{
+	CFlagDecoder decoder;
+	decoder.Build( ARRAY_SPAN( ut::s_testFlags ) );
+
+	ASSERT_EQUAL( _T(""), ut::DecodeFlags( decoder, 0 ) );
+	ASSERT_EQUAL( _T("TS_BIT0"), ut::DecodeFlags( decoder, 0x0001 ) );
+	ASSERT_EQUAL( _T("TS_BIT0+TS_BIT1/TS_ALIAS1+TS_BIT4"), ut::DecodeFlags( decoder, 0x0013 ) );		// declaration order, with aliases
+	ASSERT_EQUAL( _T("TS_BIT4+TS_BIT12"), ut::DecodeFlags( decoder, 0x1010 ) );
+
+	std::tstring text = _T("WS_CHILD");
+	decoder.StreamFlags( text, 0x0002, stream::flagSep, false );
+	ASSERT_EQUAL( _T("WS_CHILD+TS_BIT1/TS_ALIAS1"), text );			// appends to the existing output
+}
+
+void CFlagStoreTests::TestDecodeValues( void )
+{
+	CFlagDecoder decoder;
+	decoder.Build( ARRAY_SPAN( ut::s_testFlags ) );
+
+	ASSERT_EQUAL( _T("TS_CENTER"), ut::DecodeFlags( decoder, 0x0100 ) );
+	ASSERT_EQUAL( _T("TS_RIGHT"), ut::DecodeFlags( decoder, 0x0200 ) );
+	ASSERT_EQUAL( _T("TS_JUSTIFY"), ut::DecodeFlags( decoder, 0x0300 ) );					// a value, not the overlapping bits of CENTER and RIGHT
+	ASSERT_EQUAL( _T("TS_BIT0+TS_JUSTIFY+TS_LARGE"), ut::DecodeFlags( decoder, 0x0B01 ) );	// each value masked out of the other flags
+	ASSERT_EQUAL( _T(""), ut::DecodeFlags( decoder, 0x0C00 ) );								// no value defined for 0x0C00
+
+	// zero values
+	ASSERT_EQUAL( _T("TS_BIT0"), ut::DecodeFlags( decoder, 0x0001 ) );
+	ASSERT_EQUAL( _T("TS_BIT0+TS_LEFT"), ut::DecodeFlags( decoder, 0x0001, true ) );		// mask 0x0C00 has no zero value
+	ASSERT_EQUAL( _T("TS_LEFT"), ut::DecodeFlags( decoder, 0, true ) );
+}
+
+void CFlagStoreTests::TestDecodeUnknownBits( void )
+{
+	CFlagDecoder decoder;
+	decoder.Build( ARRAY_SPAN( ut::s_testFlags ) );
+
+	ASSERT_EQUAL( _T(""), ut::DecodeFlags( decoder, 0x80000020 ) );
+	ASSERT_EQUAL( _T("TS_BIT1/TS_ALIAS1"), ut::DecodeFlags( decoder, 0xFFFF0002 ) );
+	ASSERT_EQUAL( _T("TS_LEFT+TS_BIT12"), ut::DecodeFlags( decoder, 0x000FE000 | 0x1000, true ) );
+	ASSERT_EQUAL( _T("TS_BIT0+TS_BIT1/TS_ALIAS1+TS_BIT4+TS_JUSTIFY+TS_BIT12"), ut::DecodeFlags( decoder, 0xFFFFFFFF ) );	// 0x0C00 is not a value
+}
+
+void CFlagStoreTests::TestDecodeMatchesFlagInfo( void )
+{
+	CFlagDecoder decoder;
+	decoder.Build( ARRAY_SPAN( ut::s_testFlags ) );
+
+	for ( DWORD flags = 0; flags != 0x2000; ++flags )
+		for ( int withZeroFlags = 0; withZeroFlags != 2; ++withZeroFlags )
+		{
+			DWORD flagsAndUnknown = flags | ( flags << 19 );		// mix in some unknown high bits
+
+			ASSERT_EQUAL( ut::DecodeFlagsByInfo( ARRAY_SPAN( ut::s_testFlags ), flagsAndUnknown, withZeroFlags != 0 ), ut::DecodeFlags( decoder, flagsAndUnknown, withZeroFlags != 0 ) );
+		}
+}
+
+
+void CFlagStoreTests::Run( void )
+{
+	RUN_TEST( TestDecodeBitFlags );
+	RUN_TEST( TestDecodeValues );
+	RUN_TEST( TestDecodeUnknownBits );
+	RUN_TEST( TestDecodeMatchesFlagInfo );
+}
+
+
+#endif //USE_UT
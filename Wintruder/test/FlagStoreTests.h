@@ -0,0 +1,30 @@
+#ifndef FlagStoreTests_h
+#define FlagStoreTests_h
+#pragma once
+
+
+#ifdef USE_UT		// no UT code in release builds
+
+#include "utl/test/UnitTest.h"
+
+
+class CFlagStoreTests : public ut::CConsoleTestCase
+{
+	CFlagStoreTests( void );
+public:
+	static CFlagStoreTests& Instance( void );
+
+	// ut::ITestCase interface
+	virtual void Run( void );
+private:
+	void TestDecodeBitFlags( void );
+	void TestDecodeValues( void );
+	void TestDecodeUnknownBits( void );
+	void TestDecodeMatchesFlagInfo( void );
+};
+
+
+#endif //USE_UT
+
+
+#endif // FlagStoreTests_h
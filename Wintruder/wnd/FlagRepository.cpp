@@ -2,7 +2,6 @@
 #include "pch.h"
 #include "FlagRepository.h"
 #include "utl/ContainerOwnership.h"
-#include <unordered_map>
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -672,6 +671,8 @@ CStyleRepository::CStyleRepository( void )
 	AddFlagStore( _T("ToolbarWindow32|ToolbarWindow"), ARRAY_SPAN( specific::s_toolBarFlags ) );
 	AddFlagStore( _T("ReBarWindow32|ReBarWindow"), ARRAY_SPAN( specific::s_reBarFlags ) );
 	AddFlagStore( _T("msctls_statusbar32|msctls_statusbar"), ARRAY_SPAN( specific::s_statusBarFlags ) );
+
+	m_specificIndex.Build( m_specificStores );
 }
 
 CStyleRepository::~CStyleRepository()
@@ -692,15 +693,7 @@ void CStyleRepository::AddFlagStore( const TCHAR* pWndClassAliases, CFlagInfo pF
 
 const CFlagStore* CStyleRepository::FindSpecificStore( const std::tstring& wndClass ) const
 {
-	static std::unordered_map<std::tstring, CFlagStore*> classToStoreMap;
-	if ( classToStoreMap.empty() )		// init map once
-		for ( std::vector<CFlagStore*>::const_iterator itStore = m_specificStores.begin(); itStore != m_specificStores.end(); ++itStore )
-			for ( std::vector<std::tstring>::const_iterator itWndClass = ( *itStore )->m_wndClasses.begin(); itWndClass != ( *itStore )->m_wndClasses.end(); ++itWndClass )
-				classToStoreMap[ str::MakeUpper( *itWndClass ) ] = *itStore;		// class name key in upper case
-
-	std::unordered_map<std::tstring, CFlagStore*>::const_iterator itFound = classToStoreMap.find( str::MakeUpper( wndClass ) );
-
-	return itFound != classToStoreMap.end() ? itFound->second : nullptr;
+	return m_specificIndex.Find( wndClass.c_str() );
 }
 
 std::tstring& CStyleRepository::StreamStyle( std::tstring& rOutput, DWORD style, const std::tstring& wndClass, const TCHAR* pSep /*= stream::flagSep*/ ) const
@@ -735,6 +728,8 @@ CStyleExRepository::CStyleExRepository( void )
 	m_stores.push_back( new CFlagStore( _T("SysTabControl|SysTabControl32"), ARRAY_SPAN( style_ex::s_tabCtrlExFlags ), &GetTabCtrlStyleEx, &SetTabCtrlStyleEx ) );
 	m_stores.push_back( new CFlagStore( _T("ComboBoxEx32"), ARRAY_SPAN( style_ex::s_comboBoxExFlags ), &GetComboExStyleEx, &SetComboExStyleEx ) );
 	m_stores.push_back( new CFlagStore( _T("ToolbarWindow|ToolbarWindow32"), ARRAY_SPAN( style_ex::s_toolbarExFlags ), &GetToolbarStyleEx, &SetToolbarStyleEx ) );
+
+	m_storeIndex.Build( m_stores );
 }
 
 CStyleExRepository::~CStyleExRepository()
@@ -750,15 +745,7 @@ CStyleExRepository& CStyleExRepository::Instance( void )
 
 const CFlagStore* CStyleExRepository::FindStore( const std::tstring& wndClass /*= std::tstring()*/ ) const
 {
-	static std::unordered_map<std::tstring, CFlagStore*> classToStoreMap;
-	if ( classToStoreMap.empty() )		// init map once
-		for ( std::vector<CFlagStore*>::const_iterator itStore = m_stores.begin(); itStore != m_stores.end(); ++itStore )
-			for ( std::vector<std::tstring>::const_iterator itWndClass = ( *itStore )->m_wndClasses.begin(); itWndClass != ( *itStore )->m_wndClasses.end(); ++itWndClass )
-				classToStoreMap[ str::MakeUpper( *itWndClass ) ] = *itStore;		// class name key in upper case
-
-	std::unordered_map<std::tstring, CFlagStore*>::const_iterator itFound = classToStoreMap.find( str::MakeUpper( wndClass ) );
-
-	return itFound != classToStoreMap.end() ? itFound->second : nullptr;
+	return m_storeIndex.Find( wndClass.c_str() );
 }
 
 std::tstring& CStyleExRepository::StreamStyleEx( std::tstring& rOutput, DWORD styleEx, const std::tstring& wndClass /*= std::tstring()*/, const TCHAR* pSep /*= stream::flagSep*/ ) const
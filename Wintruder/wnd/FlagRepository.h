@@ -28,6 +28,7 @@ private:
 	CFlagStore m_generalTopLevelStore;
 	CFlagStore m_generalChildStore;
 	std::vector<CFlagStore*> m_specificStores;
+	CFlagStoreIndex m_specificIndex;			// window class -> specific store
 };
 
 
@@ -58,6 +59,7 @@ private:
 	static DWORD SetToolbarStyleEx( HWND hDest, DWORD styleExClass );
 private:
 	std::vector<CFlagStore*> m_stores;
+	CFlagStoreIndex m_storeIndex;				// window class -> store
 };
 
 
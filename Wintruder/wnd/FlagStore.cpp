@@ -117,6 +117,72 @@ bool CFlagGroup::IsReadOnlyGroup( void ) const
 }
 
 
+// CFlagDecoder implementation
+
+void CFlagDecoder::Build( const CFlagInfo flagInfos[], unsigned int count )
+{
+	m_entries.clear();
+	m_groups.clear();
+	m_entries.reserve( count );
+
+	for ( unsigned int i = 0; i != count; ++i )
+	{
+		const CFlagInfo* pFlagInfo = &flagInfos[ i ];
+		if ( pFlagInfo->IsSeparator() )
+			continue;
+
+		bool isBitFlag = pFlagInfo->IsBitFlag();
+
+		if ( m_groups.empty() || m_groups.back().m_bitFlags != isBitFlag || ( !isBitFlag && m_groups.back().m_mask != pFlagInfo->m_mask ) )
+		{	// start a new run of bit flags, or a new group of values by mask
+			CMaskGroup group = { isBitFlag, isBitFlag ? 0 : pFlagInfo->m_mask, m_entries.size(), m_entries.size() };
+			m_groups.push_back( group );
+		}
+
+		CEntry entry = { pFlagInfo->m_value, pFlagInfo->m_pRawTag, str::GetLength( pFlagInfo->m_pRawTag ) };
+		m_entries.push_back( entry );
+
+		CMaskGroup& rGroup = m_groups.back();
+		if ( isBitFlag )
+			rGroup.m_mask |= pFlagInfo->m_value;
+		++rGroup.m_end;
+	}
+}
+
+void CFlagDecoder::StreamFlags( IN OUT std::tstring& rOutput, DWORD flags, const TCHAR* pSep, bool withZeroFlags ) const
+{
+	const size_t sepLength = str::GetLength( pSep );
+
+	for ( std::vector<CMaskGroup>::const_iterator itGroup = m_groups.begin(); itGroup != m_groups.end(); ++itGroup )
+	{
+		DWORD maskedFlags = flags & itGroup->m_mask;
+
+		if ( itGroup->m_bitFlags )
+		{
+			if ( maskedFlags != 0 )			// skip the entire run if no bits are on
+				for ( size_t pos = itGroup->m_first; pos != itGroup->m_end; ++pos )
+					if ( HasFlag( maskedFlags, m_entries[ pos ].m_value ) )
+						StreamTag( rOutput, m_entries[ pos ], pSep, sepLength );
+		}
+		else if ( maskedFlags != 0 || withZeroFlags )
+			for ( size_t pos = itGroup->m_first; pos != itGroup->m_end; ++pos )
+				if ( m_entries[ pos ].m_value == maskedFlags )
+					StreamTag( rOutput, m_entries[ pos ], pSep, sepLength );
+	}
+}
+
+void CFlagDecoder::StreamTag( IN OUT std::tstring& rOutput, const CEntry& entry, const TCHAR* pSep, size_t sepLength )
+{
+	if ( 0 == entry.m_tagLength )
+		return;
+
+	if ( !rOutput.empty() )
+		rOutput.append( pSep, sepLength );
+
+	rOutput.append( entry.m_pTag, entry.m_tagLength );
+}
+
+
 // CFlagStore implementation
 
 CFlagStore::CFlagStore( const TCHAR* pWndClassAliases, CFlagInfo flagInfos[], unsigned int count, TGetWindowFieldFunc pGetFunc, TSetWindowFieldFunc pSetFunc )
@@ -131,6 +197,7 @@ CFlagStore::CFlagStore( const TCHAR* pWndClassAliases, CFlagInfo flagInfos[], un
 		m_wndClasses.push_back( std::tstring() );
 
 	m_flagInfos.reserve( count );
+	m_decoder.Build( flagInfos, count );
 
 	// go through all flags to detect if it needs any groups
 	bool needsGroups = NeedsGroups( flagInfos, count );
@@ -187,8 +254,7 @@ bool CFlagStore::NeedsGroups( const CFlagInfo flagInfos[], unsigned int count )
 
 void CFlagStore::StreamFormatFlags( std::tstring& rOutput, DWORD flags, const TCHAR* pSep /*= stream::flagSep*/ ) const
 {
-	for ( std::vector<CFlagInfo*>::const_iterator itFlag = m_flagInfos.begin(); itFlag != m_flagInfos.end(); ++itFlag )
-		( *itFlag )->StreamFlagName( rOutput, flags, pSep );		// conditional if flags are on
+	m_decoder.StreamFlags( rOutput, flags, pSep, app::GetOptions()->m_displayZeroFlags );		// conditional if flags are on
 }
 
 void CFlagStore::StreamFormatMask( std::tstring& rOutput, const TCHAR* pSep /*= stream::maskSep*/ ) const
@@ -251,3 +317,72 @@ int CFlagStore::CheckFlagsTransition( DWORD newFlags, DWORD oldFlags ) const
 
 	return -1;
 }
+
+
+// CFlagStoreIndex implementation
+
+void CFlagStoreIndex::Build( const std::vector<CFlagStore*>& stores )
+{
+	std::vector<TSlot> entries;
+
+	for ( std::vector<CFlagStore*>::const_iterator itStore = stores.begin(); itStore != stores.end(); ++itStore )
+		for ( std::vector<std::tstring>::const_iterator itWndClass = ( *itStore )->m_wndClasses.begin(); itWndClass != ( *itStore )->m_wndClasses.end(); ++itWndClass )
+			entries.push_back( TSlot( itWndClass->c_str(), *itStore ) );
+
+	enum { MaxPerfectSize = 16 * 1024 };		// beyond this, collisions are resolved by linear probing
+	size_t tableSize = 2;
+
+	while ( tableSize < entries.size() * 2 )
+		tableSize *= 2;
+
+	for ( ; ; tableSize *= 2 )
+	{
+		m_slots.assign( tableSize, TSlot( nullptr, nullptr ) );
+		m_hashMask = tableSize - 1;
+
+		bool perfect = true;
+
+		for ( std::vector<TSlot>::const_iterator itEntry = entries.begin(); itEntry != entries.end(); ++itEntry )
+		{
+			size_t homePos = HashClassName( itEntry->first ) & m_hashMask;
+			size_t pos = FindSlot( itEntry->first );
+
+			m_slots[ pos ] = *itEntry;			// a duplicate class name is reassigned to the last store
+			if ( pos != homePos )
+				perfect = false;
+		}
+
+		if ( perfect || tableSize >= MaxPerfectSize )
+			break;
+	}
+}
+
+const CFlagStore* CFlagStoreIndex::Find( const TCHAR* pWndClass ) const
+{
+	if ( m_slots.empty() )
+		return nullptr;
+
+	return m_slots[ FindSlot( pWndClass ) ].second;		// nullptr for an empty slot
+}
+
+size_t CFlagStoreIndex::FindSlot( const TCHAR* pWndClass ) const
+{	// returns the matching slot, or the empty slot where it would be inserted
+	ASSERT( !m_slots.empty() );
+
+	for ( size_t pos = HashClassName( pWndClass ) & m_hashMask; ; pos = ( pos + 1 ) & m_hashMask )
+		if ( nullptr == m_slots[ pos ].first || 0 == _tcsicmp( m_slots[ pos ].first, pWndClass ) )
+			return pos;
+}
+
+size_t CFlagStoreIndex::HashClassName( const TCHAR* pWndClass )
+{	// FNV-1a on upper case characters
+	ASSERT_PTR( pWndClass );
+	size_t hash = 2166136261u;
+
+	for ( ; *pWndClass != _T('\0'); ++pWndClass )
+	{
+		hash ^= static_cast<size_t>( _totupper( *pWndClass ) );
+		hash *= 16777619u;
+	}
+	return hash;
+}
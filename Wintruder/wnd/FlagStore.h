@@ -82,6 +82,40 @@ private:
 };
 
 
+// Decoding table of a flag store, built once: contiguous entries in declaration order with pre-measured tags.
+// Bit flags are tested in runs against the run's combined mask; values are grouped by mask, so each group masks the flags only once.
+// Decoding needs no window and doesn't allocate temporaries: it only appends to the caller's string.
+//
+class CFlagDecoder
+{
+public:
+	CFlagDecoder( void ) {}
+
+	void Build( const CFlagInfo flagInfos[], unsigned int count );
+
+	void StreamFlags( IN OUT std::tstring& rOutput, DWORD flags, const TCHAR* pSep, bool withZeroFlags ) const;		// values with no bits on are streamed only if withZeroFlags
+private:
+	struct CEntry
+	{
+		DWORD m_value;
+		const TCHAR* m_pTag;
+		size_t m_tagLength;
+	};
+
+	static void StreamTag( IN OUT std::tstring& rOutput, const CEntry& entry, const TCHAR* pSep, size_t sepLength );
+
+	struct CMaskGroup
+	{
+		bool m_bitFlags;			// run of bit flags, or values of the same mask
+		DWORD m_mask;				// combined bits of the run, or the value mask
+		size_t m_first, m_end;		// range of entries
+	};
+private:
+	std::vector<CEntry> m_entries;
+	std::vector<CMaskGroup> m_groups;
+};
+
+
 typedef	DWORD (*TGetWindowFieldFunc)( HWND hSrc );
 typedef	DWORD (*TSetWindowFieldFunc)( HWND hDest, DWORD flags );
 
@@ -98,6 +132,8 @@ struct CFlagStore
 
 	bool SameFieldWith( const CFlagStore& right ) const { return m_pGetFunc == right.m_pGetFunc; }
 
+	const CFlagDecoder& GetDecoder( void ) const { return m_decoder; }
+
 	void StreamFormatFlags( std::tstring& rOutput, DWORD flags, const TCHAR* pSep = stream::flagSep ) const;
 	void StreamFormatMask( std::tstring& rOutput, const TCHAR* pSep = stream::maskSep ) const;
 	static void StreamMask( std::tstring& rOutput, DWORD mask, const TCHAR* pSep = stream::maskSep );
@@ -126,6 +162,28 @@ private:
 	DWORD m_editableMask;
 	TGetWindowFieldFunc m_pGetFunc;
 	TSetWindowFieldFunc m_pSetFunc;
+	CFlagDecoder m_decoder;
+};
+
+
+// Case-insensitive lookup of flag stores by window class (and its aliases), built once.
+// The table grows until the class names hash without collisions (perfect hash): a lookup is one hash, one probe and one compare, without allocations.
+//
+class CFlagStoreIndex
+{
+public:
+	CFlagStoreIndex( void ) : m_hashMask( 0 ) {}
+
+	void Build( const std::vector<CFlagStore*>& stores );
+	const CFlagStore* Find( const TCHAR* pWndClass ) const;
+private:
+	static size_t HashClassName( const TCHAR* pWndClass );		// case-insensitive
+	size_t FindSlot( const TCHAR* pWndClass ) const;
+private:
+	typedef std::pair<const TCHAR*, const CFlagStore*> TSlot;	// <class name, store>
+
+	std::vector<TSlot> m_slots;
+	size_t m_hashMask;
 };
 
 
@@ -2,8 +2,10 @@
 
 #include "pch.h"
 #include "Application.h"
+#include "BatchStamper.h"
 #include "CmdLineOptions.h"
 #include "ResourceFile.h"
+#include "utl/AppTools.h"
 #include "utl/ConsoleApplication.h"
 #include "utl/StringUtilities.h"
 #include "utl/TimeUtils.h"
@@ -40,12 +42,19 @@ static const char s_helpMessage[] =
 	"\n"
 	"Written by Paul Cocoveanu, 2021.\n"
 	"\n"
-	"StampBuildVersion rc_file_path [timestamp] [-a] [-t]\n"
+	"StampBuildVersion rc_file_path|dir_path|@list_file [timestamp] [-a] [-t] [-p]\n"
+	"                  [-w[=state_file]] [-j=thread_count]\n"
 	"\n"
 	"  rc_file_path\n"
 	"      Path to the destination resource file in a Visual C++ project.\n"
 	"      example:\n"
 	"        'C:\\dev\\DevTools\\Wintruder\\Wintruder.rc'\n"
+	"  dir_path\n"
+	"      Batch mode: stamp all the .rc files found in the directory tree,\n"
+	"      concurrently, reporting the time spent on each file.\n"
+	"  @list_file\n"
+	"      Batch mode: stamp the .rc files listed in the text file, one per line\n"
+	"      (relative to the list file directory).\n"
 	"  timestamp\n"
 	"      Optional, the timestamp to be stamped to the .rc file,\n"
 	"      in 'DD-MM-YYYY H:mm:ss' format.\n"
@@ -56,6 +65,16 @@ static const char s_helpMessage[] =
 	"  -t\n"
 	"      Touch the target file: update the modification time on the target file\n"
 	"      to force a project rebuild.\n"
+	"  -p\n"
+	"      Patch in place: rewrite only the bytes of the timestamp value, not the\n"
+	"      whole file (for ANSI and UTF8 files).\n"
+	"  -w[=state_file]\n"
+	"      Watch mode: stamp only the .rc files with project source files changed\n"
+	"      since the last run, as recorded in the state file (by default\n"
+	"      'StampBuildVersion.state' in dir_path, or the target path + '.state').\n"
+	"  -j=thread_count\n"
+	"      Batch mode: the count of concurrent threads (by default the count of\n"
+	"      processors).\n"
 	"  -? or -h\n"
 	"      Display this help screen.\n"
 #ifdef USE_UT
@@ -71,6 +90,12 @@ namespace app
 {
 	void RunMain( const CCmdLineOptions& options ) throws_( std::exception, CException* )
 	{
+		if ( HasFlag( options.m_optionFlags, app::BatchMode ) )
+		{
+			RunBatch( options );
+			return;
+		}
+
 		CResourceFile rcFile( options.m_targetRcPath, options.m_optionFlags );
 
 		if ( rcFile.HasBuildTimestamp() )
@@ -81,6 +106,18 @@ namespace app
 			rcFile.Report( std::cout );
 		}
 	}
+
+	void RunBatch( const CCmdLineOptions& options ) throws_( std::exception, CException* )
+	{
+		CBatchStamper batchStamper( options );
+
+		batchStamper.SearchRcFiles();
+		batchStamper.Run();
+		batchStamper.Report( std::cout );
+
+		for ( size_t errorCount = batchStamper.GetErrorCount(); errorCount-- != 0; )
+			CAppTools::AddMainResultError();
+	}
 };
 
 
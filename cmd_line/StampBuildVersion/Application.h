@@ -9,6 +9,7 @@ struct CCmdLineOptions;
 namespace app
 {
 	void RunMain( const CCmdLineOptions& options ) throws_( std::exception, CException* );
+	void RunBatch( const CCmdLineOptions& options ) throws_( std::exception, CException* );		// batch and watch modes
 };
 
 
@@ -0,0 +1,292 @@
+
+#include "pch.h"
+#include "BatchStamper.h"
+#include "CmdLineOptions.h"
+#include "ResourceFile.h"
+#include "utl/FileEnumerator.h"
+#include "utl/FileSystem.h"
+#include "utl/ParallelFor.h"
+#include "utl/RuntimeException.h"
+#include "utl/StringUtilities.h"
+#include "utl/TextFileIo.h"
+#include "utl/Timer.h"
+#include "utl/TimeUtils.h"
+#include <sstream>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+#include "utl/TextFileIo.hxx"
+
+
+namespace app
+{
+	// CInputsStamp implementation
+
+	const TCHAR CInputsStamp::s_inputsWildSpec[] = _T("*.h;*.hpp;*.hxx;*.inl;*.c;*.cpp;*.cxx;*.rc2;*.ico;*.cur;*.bmp;*.png;*.manifest");	// .rc files excluded: stamping must not invalidate sibling projects
+
+	void CInputsStamp::Compute( const fs::CPath& rcFilePath )
+	{
+		std::vector<fs::CPath> inputPaths;
+		fs::EnumFilePaths( inputPaths, rcFilePath.GetParentPath(), s_inputsWildSpec, fs::EF_Recurse );
+
+		m_newestModifyTime = 0;
+		m_fileCount = inputPaths.size();
+
+		for ( std::vector<fs::CPath>::const_iterator itInputPath = inputPaths.begin(); itInputPath != inputPaths.end(); ++itInputPath )
+		{
+			CTime modifyTime = fs::ReadLastModifyTime( *itInputPath );
+
+			if ( time_utl::IsValid( modifyTime ) )
+				m_newestModifyTime = std::max( m_newestModifyTime, modifyTime.GetTime() );
+		}
+	}
+
+
+	// CStampState implementation
+
+	void CStampState::Load( const fs::CPath& stateFilePath ) throws_( CRuntimeException )
+	{
+		// line format: "newestModifyTime|fileCount|rcFilePath"
+		m_stamps.clear();
+
+		if ( !fs::IsValidFile( stateFilePath.GetPtr() ) )
+			return;
+
+		std::vector<std::tstring> lines, fields;
+		io::ReadLinesFromFile( lines, stateFilePath );
+
+		for ( std::vector<std::tstring>::const_iterator itLine = lines.begin(); itLine != lines.end(); ++itLine )
+		{
+			str::Split( fields, itLine->c_str(), _T("|") );
+
+			CInputsStamp inputsStamp;
+			unsigned int fileCount;
+
+			if ( 3 == fields.size() && !fields[ 2 ].empty() &&
+				 num::ParseNumber( inputsStamp.m_newestModifyTime, fields[ 0 ] ) && num::ParseNumber( fileCount, fields[ 1 ] ) )
+			{
+				inputsStamp.m_fileCount = fileCount;
+				m_stamps[ fs::CPath( fields[ 2 ] ) ] = inputsStamp;
+			}
+			else
+				TRACE( _T(" * CStampState::Load(): ignoring invalid line '%s' in state file '%s'\n"), itLine->c_str(), stateFilePath.GetPtr() );
+		}
+	}
+
+	void CStampState::Save( const fs::CPath& stateFilePath ) const throws_( CRuntimeException )
+	{
+		std::vector<std::tstring> lines;
+		lines.reserve( m_stamps.size() );
+
+		for ( std::map<fs::CPath, CInputsStamp>::const_iterator itStamp = m_stamps.begin(); itStamp != m_stamps.end(); ++itStamp )
+			lines.push_back( str::Format( _T("%I64d|%u|%s"), itStamp->second.m_newestModifyTime, static_cast<unsigned int>( itStamp->second.m_fileCount ), itStamp->first.GetPtr() ) );
+
+		io::WriteLinesToFile( stateFilePath, lines, fs::UTF8_bom );
+	}
+
+	const CInputsStamp* CStampState::FindStamp( const fs::CPath& rcFilePath ) const
+	{
+		std::map<fs::CPath, CInputsStamp>::const_iterator itFound = m_stamps.find( rcFilePath );
+		return itFound != m_stamps.end() ? &itFound->second : nullptr;
+	}
+
+
+	namespace impl
+	{
+		// stamps one .rc file in a worker thread: writes only to its own item, and never throws
+		//
+		struct StampItemFunc
+		{
+			StampItemFunc( std::vector<CBatchStamper::CItem>& rItems, const CCmdLineOptions& options, const CStampState* pLastState )
+				: m_rItems( rItems ), m_options( options ), m_pLastState( pLastState ) {}
+
+			void operator()( size_t index ) const
+			{
+				CBatchStamper::CItem& rItem = m_rItems[ index ];
+				CTimer timer;
+
+				try
+				{
+					Stamp( rItem );
+				}
+				catch ( const std::exception& exc )
+				{
+					rItem.m_outcome = CBatchStamper::Failed;
+					rItem.m_message = str::AsNarrow( CRuntimeException::MessageOf( exc ) );
+				}
+				catch ( CException* pExc )
+				{
+					rItem.m_outcome = CBatchStamper::Failed;
+					rItem.m_message = str::AsNarrow( mfc::CRuntimeException::MessageOf( *pExc ) );
+					pExc->Delete();
+				}
+
+				rItem.m_elapsedSeconds = timer.ElapsedSeconds();
+			}
+		private:
+			void Stamp( CBatchStamper::CItem& rItem ) const throws_( std::exception, CException* )
+			{
+				if ( m_pLastState != nullptr )
+				{
+					rItem.m_inputsStamp.Compute( rItem.m_rcFilePath );
+
+					if ( const CInputsStamp* pLastStamp = m_pLastState->FindStamp( rItem.m_rcFilePath ) )
+						if ( rItem.m_inputsStamp == *pLastStamp )
+						{
+							rItem.m_outcome = CBatchStamper::UpToDate;
+							return;
+						}
+				}
+
+				CResourceFile rcFile( rItem.m_rcFilePath, m_options.m_optionFlags );
+
+				if ( !rcFile.HasBuildTimestamp() )
+				{
+					rItem.m_outcome = CBatchStamper::NoBuildTimestamp;
+					return;
+				}
+
+				rcFile.StampBuildTime( m_options.m_buildTimestamp );
+				rcFile.Save();
+				rItem.m_outcome = rcFile.IsModified() ? CBatchStamper::Stamped : CBatchStamper::Unchanged;
+
+				std::ostringstream oss;
+				rcFile.Report( oss );
+				rItem.m_message = oss.str();
+				str::TrimRight( rItem.m_message );
+			}
+		private:
+			std::vector<CBatchStamper::CItem>& m_rItems;
+			const CCmdLineOptions& m_options;
+			const CStampState* m_pLastState;
+		};
+	}
+}
+
+
+// CBatchStamper implementation
+
+CBatchStamper::CBatchStamper( const CCmdLineOptions& options )
+	: m_options( options )
+	, m_elapsedSeconds( 0.0 )
+{
+}
+
+CBatchStamper::~CBatchStamper()
+{
+}
+
+size_t CBatchStamper::SearchRcFiles( void ) throws_( CRuntimeException )
+{
+	std::vector<fs::CPath> rcFilePaths;
+
+	if ( !m_options.m_listFilePath.IsEmpty() )
+	{	// one .rc file path per line, relative to the list file directory; skip empty lines and "#" comments
+		std::vector<std::tstring> lines;
+		io::ReadLinesFromFile( lines, m_options.m_listFilePath );
+
+		fs::TDirPath listDirPath = m_options.m_listFilePath.GetParentPath();
+
+		for ( std::vector<std::tstring>::iterator itLine = lines.begin(); itLine != lines.end(); ++itLine )
+		{
+			str::Trim( *itLine );
+
+			if ( itLine->empty() || _T('#') == itLine->at( 0 ) )
+				continue;
+
+			if ( path::IsRelative( itLine->c_str() ) )
+				rcFilePaths.push_back( listDirPath / fs::CPath( *itLine ) );
+			else
+				rcFilePaths.push_back( fs::CPath( *itLine ) );
+		}
+	}
+	else if ( fs::IsValidDirectory( m_options.m_targetRcPath.GetPtr() ) )
+		fs::EnumFilePaths( rcFilePaths, m_options.m_targetRcPath, _T("*.rc"), fs::EF_Recurse );
+	else
+		rcFilePaths.push_back( m_options.m_targetRcPath );
+
+	std::sort( rcFilePaths.begin(), rcFilePaths.end() );
+	rcFilePaths.erase( std::unique( rcFilePaths.begin(), rcFilePaths.end() ), rcFilePaths.end() );		// never stamp the same file concurrently
+
+	m_items.clear();
+	m_items.reserve( rcFilePaths.size() );
+
+	for ( std::vector<fs::CPath>::const_iterator itRcFilePath = rcFilePaths.begin(); itRcFilePath != rcFilePaths.end(); ++itRcFilePath )
+		m_items.push_back( CItem( *itRcFilePath ) );
+
+	return m_items.size();
+}
+
+void CBatchStamper::Run( void ) throws_( CRuntimeException )
+{
+	CTimer timer;
+	bool watchMode = HasFlag( m_options.m_optionFlags, app::WatchMode );
+
+	if ( watchMode )
+		m_state.Load( m_options.m_stateFilePath );
+
+	mt::ParallelFor( m_items.size(), app::impl::StampItemFunc( m_items, m_options, watchMode ? &m_state : nullptr ), m_options.m_threadCount );
+
+	if ( watchMode )
+	{
+		for ( std::vector<CItem>::const_iterator itItem = m_items.begin(); itItem != m_items.end(); ++itItem )
+			if ( itItem->m_outcome != Failed )				// failed files are retried on the next run
+				m_state.StoreStamp( itItem->m_rcFilePath, itItem->m_inputsStamp );
+
+		m_state.Save( m_options.m_stateFilePath );
+	}
+
+	m_elapsedSeconds = timer.ElapsedSeconds();
+}
+
+void CBatchStamper::Report( std::ostream& os ) const
+{
+	// c:\dev\DevTools\Slider\Slider.rc(920) : stamped build time to '17-09-2021 14:02:39'  (was '17-09-2021 13:58:03').  (0.004 seconds)
+	//
+	for ( std::vector<CItem>::const_iterator itItem = m_items.begin(); itItem != m_items.end(); ++itItem )
+	{
+		switch ( itItem->m_outcome )
+		{
+			case Stamped:
+			case Unchanged:
+				os << itItem->m_message;
+				break;
+			case NoBuildTimestamp:
+				os << itItem->m_rcFilePath << " : no \"BuildTimestamp\" entry, skipped.";
+				break;
+			case UpToDate:
+				os << itItem->m_rcFilePath << " : inputs unchanged since the last run, skipped.";
+				break;
+			case Failed:
+				os << itItem->m_rcFilePath << " : error: " << itItem->m_message;
+				break;
+			default:
+				ASSERT( false );
+		}
+
+		os << "  (" << CTimer::FormatSeconds( itItem->m_elapsedSeconds ) << ")" << std::endl;
+	}
+
+	os << "Stamped " << GetStampedCount() << " of " << m_items.size() << " resource files in " << CTimer::FormatSeconds( m_elapsedSeconds );
+
+	if ( size_t upToDateCount = GetUpToDateCount() )
+		os << ", " << upToDateCount << " up to date";
+
+	if ( size_t errorCount = GetErrorCount() )
+		os << ", " << errorCount << " errors";
+
+	os << "." << std::endl;
+}
+
+size_t CBatchStamper::CountOutcome( Outcome outcome ) const
+{
+	size_t count = 0;
+
+	for ( std::vector<CItem>::const_iterator itItem = m_items.begin(); itItem != m_items.end(); ++itItem )
+		if ( outcome == itItem->m_outcome )
+			++count;
+
+	return count;
+}
@@ -0,0 +1,95 @@
+#ifndef BatchStamper_h
+#define BatchStamper_h
+#pragma once
+
+#include <iosfwd>
+#include <map>
+#include "utl/Path.h"
+
+
+struct CCmdLineOptions;
+class CRuntimeException;
+
+
+namespace app
+{
+	// signature of the inputs of an .rc file: the project source files under the .rc file directory
+	//
+	struct CInputsStamp
+	{
+		CInputsStamp( void ) : m_newestModifyTime( 0 ), m_fileCount( 0 ) {}
+
+		void Compute( const fs::CPath& rcFilePath );
+
+		bool operator==( const CInputsStamp& right ) const { return m_newestModifyTime == right.m_newestModifyTime && m_fileCount == right.m_fileCount; }
+		bool operator!=( const CInputsStamp& right ) const { return !operator==( right ); }
+	public:
+		__time64_t m_newestModifyTime;			// of the most recently modified input file
+		size_t m_fileCount;						// detects deleted input files
+	public:
+		static const TCHAR s_inputsWildSpec[];
+	};
+
+
+	// watch mode: the inputs stamp of each .rc file as of its last stamping, persisted in a text state file
+	//
+	class CStampState
+	{
+	public:
+		CStampState( void ) {}
+
+		void Load( const fs::CPath& stateFilePath ) throws_( CRuntimeException );		// a missing file loads an empty state
+		void Save( const fs::CPath& stateFilePath ) const throws_( CRuntimeException );
+
+		const CInputsStamp* FindStamp( const fs::CPath& rcFilePath ) const;
+		void StoreStamp( const fs::CPath& rcFilePath, const CInputsStamp& inputsStamp ) { m_stamps[ rcFilePath ] = inputsStamp; }
+	private:
+		std::map<fs::CPath, CInputsStamp> m_stamps;
+	};
+}
+
+
+// stamps multiple .rc files in a single process, concurrently: the .rc files of a directory tree, or of a list file.
+// In watch mode it stamps only the .rc files with inputs changed since the last run, as recorded in the state file.
+//
+class CBatchStamper : private utl::noncopyable
+{
+public:
+	CBatchStamper( const CCmdLineOptions& options );
+	~CBatchStamper();
+
+	size_t SearchRcFiles( void ) throws_( CRuntimeException );		// from the target directory, the list file, or the target .rc file; returns the found count
+
+	void Run( void ) throws_( CRuntimeException );
+	void Report( std::ostream& os ) const;
+
+	size_t GetFileCount( void ) const { return m_items.size(); }
+	size_t GetStampedCount( void ) const { return CountOutcome( Stamped ); }
+	size_t GetUpToDateCount( void ) const { return CountOutcome( UpToDate ); }
+	size_t GetErrorCount( void ) const { return CountOutcome( Failed ); }
+public:
+	enum Outcome { Pending, Stamped, Unchanged, NoBuildTimestamp, UpToDate, Failed };
+
+	struct CItem
+	{
+		CItem( const fs::CPath& rcFilePath ) : m_rcFilePath( rcFilePath ), m_outcome( Pending ), m_elapsedSeconds( 0.0 ) {}
+	public:
+		fs::CPath m_rcFilePath;
+		app::CInputsStamp m_inputsStamp;		// watch mode only
+		Outcome m_outcome;
+		std::string m_message;					// report line, or the error message
+		double m_elapsedSeconds;
+	};
+
+	const std::vector<CItem>& GetItems( void ) const { return m_items; }
+private:
+	size_t CountOutcome( Outcome outcome ) const;
+private:
+	const CCmdLineOptions& m_options;
+	std::vector<CItem> m_items;
+	app::CStampState m_state;					// watch mode only
+	double m_elapsedSeconds;
+};
+
+
+#endif // BatchStamper_h
@@ -11,6 +11,7 @@
 CCmdLineOptions::CCmdLineOptions( void )
 	: m_pArg( nullptr )
 	, m_optionFlags( 0 )
+	, m_threadCount( 0 )
 {
 }
 
@@ -45,6 +46,17 @@ void CCmdLineOptions::ParseCommandLine( int argc, TCHAR* argv[] ) throws_( CRunt
 				SetFlag( m_optionFlags, app::Add_BuildTimestamp );
 			else if ( arg::Equals( pSwitch, _T("t") ) )
 				SetFlag( m_optionFlags, app::TouchRcFile );
+			else if ( arg::Equals( pSwitch, _T("p") ) )
+				SetFlag( m_optionFlags, app::PatchInPlace );
+			else if ( arg::Equals( pSwitch, _T("w") ) )
+				SetFlag( m_optionFlags, app::WatchMode );
+			else if ( ParseValue( value, pSwitch, _T("w") ) )
+			{
+				SetFlag( m_optionFlags, app::WatchMode );
+				m_stateFilePath.Set( value );
+			}
+			else if ( ParseValue( value, pSwitch, _T("j") ) )
+				ParseThreadCount( value );
 			else if ( arg::EqualsAnyOf( pSwitch, _T("?|h") ) )
 			{
 				SetFlag( m_optionFlags, app::HelpMode );
@@ -59,8 +71,13 @@ void CCmdLineOptions::ParseCommandLine( int argc, TCHAR* argv[] ) throws_( CRunt
 		}
 		else
 		{
-			if ( m_targetRcPath.IsEmpty() )
-				m_targetRcPath.Set( m_pArg );
+			if ( m_targetRcPath.IsEmpty() && m_listFilePath.IsEmpty() )
+			{
+				if ( '@' == m_pArg[ 0 ] )
+					m_listFilePath.Set( m_pArg + 1 );
+				else
+					m_targetRcPath.Set( m_pArg );
+			}
 			else if ( !time_utl::IsValid( m_buildTimestamp ) )
 				ParseBuildTimestamp( m_pArg );
 			else
@@ -73,11 +90,28 @@ void CCmdLineOptions::ParseCommandLine( int argc, TCHAR* argv[] ) throws_( CRunt
 
 void CCmdLineOptions::PostProcessArguments( void ) throws_( CRuntimeException )
 {
-	if ( m_targetRcPath.IsEmpty() )
+	if ( !m_listFilePath.IsEmpty() )
+	{
+		if ( !fs::IsValidFile( m_listFilePath.GetPtr() ) )
+			throw CRuntimeException( str::Format( _T("Cannot find the list file '%s'"), m_listFilePath.GetPtr() ) );
+
+		SetFlag( m_optionFlags, app::BatchMode );
+	}
+	else if ( m_targetRcPath.IsEmpty() )
 		throw CRuntimeException( _T("Missing 'rc_file_path' argument!") );
+	else if ( fs::IsValidDirectory( m_targetRcPath.GetPtr() ) )
+		SetFlag( m_optionFlags, app::BatchMode );
 	else if ( fs::IsReadOnlyFile( m_targetRcPath.GetPtr() ) )
 		throw CRuntimeException( _T("Cannot write to read-only file 'rc_file_path'!") );
 
+	if ( HasFlag( m_optionFlags, app::WatchMode ) )
+	{
+		SetFlag( m_optionFlags, app::BatchMode );			// the state is kept by the batch stamper, even for a single .rc file
+
+		if ( m_stateFilePath.IsEmpty() )
+			m_stateFilePath = MakeDefaultStateFilePath();
+	}
+
 	if ( !time_utl::IsValid( m_buildTimestamp ) )
 		m_buildTimestamp = CTime::GetCurrentTime();		// by default use current date-time for stamping build time
 }
@@ -94,6 +128,28 @@ void CCmdLineOptions::ParseBuildTimestamp( const std::tstring& value ) throws_(
 	m_buildTimestamp = buildTimestamp;
 }
 
+void CCmdLineOptions::ParseThreadCount( const std::tstring& value ) throws_( CRuntimeException )
+{
+	unsigned int threadCount;
+
+	if ( !num::ParseNumber( threadCount, value ) || 0 == threadCount )
+		throw CRuntimeException( str::Format( _T("Invalid thread count in argument '%s'"), m_pArg ) );
+
+	m_threadCount = threadCount;
+}
+
+fs::CPath CCmdLineOptions::MakeDefaultStateFilePath( void ) const
+{
+	// "<dir>\StampBuildVersion.state" for a directory target, "<file>.state" for an .rc file or a list file
+
+	if ( !m_listFilePath.IsEmpty() )
+		return fs::CPath( m_listFilePath.Get() + _T(".state") );
+	else if ( fs::IsValidDirectory( m_targetRcPath.GetPtr() ) )
+		return m_targetRcPath / _T("StampBuildVersion.state");
+
+	return fs::CPath( m_targetRcPath.Get() + _T(".state") );
+}
+
 void CCmdLineOptions::ThrowInvalidArgument( void ) throws_( CRuntimeException )
 {
 	throw CRuntimeException( str::Format( _T("invalid argument '%s'"), m_pArg ) );
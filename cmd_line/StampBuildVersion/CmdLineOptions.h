@@ -19,6 +19,8 @@ struct CCmdLineOptions
 private:
 	void PostProcessArguments( void ) throws_( CRuntimeException );
 	void ParseBuildTimestamp( const std::tstring& value ) throws_( CRuntimeException );
+	void ParseThreadCount( const std::tstring& value ) throws_( CRuntimeException );
+	fs::CPath MakeDefaultStateFilePath( void ) const;
 
 	enum CaseCvt { AsIs, UpperCase, LowerCase };
 
@@ -29,7 +31,10 @@ private:
 	const TCHAR* m_pArg;								// current argument parsed
 public:
 	app::TOption m_optionFlags;
-	fs::CPath m_targetRcPath;
+	fs::CPath m_targetRcPath;							// an .rc file, or a directory searched deep for .rc files (batch mode)
+	fs::CPath m_listFilePath;							// batch mode: text file with .rc file paths, one per line
+	fs::CPath m_stateFilePath;							// watch mode: inputs state of the last run
+	size_t m_threadCount;								// batch mode: 0 for hardware concurrency
 	CTime m_buildTimestamp;
 };
 
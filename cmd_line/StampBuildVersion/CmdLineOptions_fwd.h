@@ -10,7 +10,10 @@ namespace app
 		HelpMode			= BIT_FLAG( 0 ),
 		UnitTestMode		= BIT_FLAG( 1 ),
 		Add_BuildTimestamp	= BIT_FLAG( 2 ),
-		TouchRcFile			= BIT_FLAG( 3 )
+		TouchRcFile			= BIT_FLAG( 3 ),
+		PatchInPlace		= BIT_FLAG( 4 ),
+		BatchMode			= BIT_FLAG( 5 ),		// target is a directory or a list file: stamp multiple .rc files
+		WatchMode			= BIT_FLAG( 6 )			// stamp only the .rc files with inputs changed since the last run
 	};
 	typedef int TOption;
 }
@@ -1,6 +1,8 @@
 
 #include "pch.h"
 #include "ResourceFile.h"
+#include "utl/FileSystem.h"
+#include "utl/RuntimeException.h"
 #include "utl/StringUtilities.h"
 #include "utl/TimeUtils.h"
 
@@ -45,6 +47,60 @@ namespace rc
 	}
 
 
+	// mapped content scanning: memchr-driven search of tokens that start an uncommented line
+
+	const char* FindSequence( const char* pFirst, const char* pLast, const char* pSeq )
+	{
+		size_t seqLength = str::GetLength( pSeq );
+
+		if ( static_cast<size_t>( pLast - pFirst ) < seqLength )
+			return nullptr;
+
+		for ( const char* pEnd = pLast - seqLength + 1;
+			  pFirst != pEnd && ( pFirst = static_cast<const char*>( memchr( pFirst, pSeq[ 0 ], pEnd - pFirst ) ) ) != nullptr;
+			  ++pFirst )
+			if ( 0 == memcmp( pFirst, pSeq, seqLength ) )
+				return pFirst;
+
+		return nullptr;
+	}
+
+	const char* SkipBlanks( const char* pFirst, const char* pLast )
+	{
+		while ( pFirst != pLast && ( ' ' == *pFirst || '\t' == *pFirst ) )
+			++pFirst;
+		return pFirst;
+	}
+
+	bool IsLeadingToken( const char* pBegin, const char* pToken )
+	{	// only blanks between the start of the line and the token
+		while ( pToken != pBegin && ( ' ' == pToken[ -1 ] || '\t' == pToken[ -1 ] ) )
+			--pToken;
+
+		return pToken == pBegin || '\n' == pToken[ -1 ] || '\r' == pToken[ -1 ];
+	}
+
+	const char* FindLeadingToken( const char* pBegin, const char* pFirst, const char* pLast, const char* pToken )
+	{
+		for ( const char* pFound; ( pFound = FindSequence( pFirst, pLast, pToken ) ) != nullptr; pFirst = pFound + 1 )
+			if ( IsLeadingToken( pBegin, pFound ) )
+				return pFound;
+
+		return nullptr;
+	}
+
+	size_t CountLines( const char* pFirst, const char* pLast )
+	{
+		size_t count = 0;
+		while ( pFirst != pLast && ( pFirst = static_cast<const char*>( memchr( pFirst, '\n', pLast - pFirst ) ) ) != nullptr )
+		{
+			++count;
+			++pFirst;
+		}
+		return count;
+	}
+
+
 	class CVersionInfoParser : public io::ILineParserCallback<std::string>
 	{
 	public:
@@ -52,6 +108,7 @@ namespace rc
 
 		static bool ReplaceEntry_VALUE( std::string& rValueLine, const char* pName, const char* pValue );
 		static bool ReplaceEntry_BuildTimestamp( std::string& rValueLine, const CTime& buildTimestamp );
+		static std::string FormatBuildTimestamp( const CTime& buildTimestamp );
 	private:
 		// io::ILineParserCallback<std::string> interface
 		virtual bool OnParseLine( const std::string& line, unsigned int lineNo );
@@ -82,6 +139,19 @@ CResourceFile::CResourceFile( const fs::CPath& rcFilePath, app::TOption optionFl
 	: m_rcFilePath( rcFilePath )
 	, m_optionFlags( optionFlags )
 	, m_origFileState( fs::CFileState::ReadFromFile( m_rcFilePath ) )
+	, m_encoding( fs::ANSI_UTF8 )
+	, m_modified( false )
+{
+	if ( !HasFlag( m_optionFlags, app::PatchInPlace ) || !ParseMapped() )
+		ParseLines();
+}
+
+CResourceFile::~CResourceFile()
+{
+	CloseMapping();
+}
+
+void CResourceFile::ParseLines( void ) throws_( CRuntimeException )
 {
 	rc::CVersionInfoParser parserCallback( this );
 	io::CTextFileParser<std::string> parser( &parserCallback );
@@ -89,8 +159,106 @@ CResourceFile::CResourceFile( const fs::CPath& rcFilePath, app::TOption optionFl
 	m_encoding = parser.ParseFile( m_rcFilePath );
 }
 
-CResourceFile::~CResourceFile()
+bool CResourceFile::ParseMapped( void ) throws_( CRuntimeException )
+{
+	m_patch.m_file.Reset( ::CreateFile( m_rcFilePath.GetPtr(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr ) );
+	if ( !m_patch.m_file.IsValid() )
+		throw CRuntimeException( str::Format( _T("Cannot open resource file '%s' for patching"), m_rcFilePath.GetPtr() ) );
+
+	LARGE_INTEGER fileSize;
+	if ( !::GetFileSizeEx( m_patch.m_file.Get(), &fileSize ) || 0 == fileSize.QuadPart || fileSize.HighPart != 0 )
+	{
+		CloseMapping();
+		return false;			// empty or huge file: leave it to the lines mode
+	}
+
+	HANDLE hMapping = ::CreateFileMapping( m_patch.m_file.Get(), nullptr, PAGE_READONLY, 0, 0, nullptr );
+	if ( hMapping != nullptr )
+	{
+		m_patch.m_mapping.Reset( hMapping );
+		m_patch.m_pView = static_cast<const char*>( ::MapViewOfFile( m_patch.m_mapping.Get(), FILE_MAP_READ, 0, 0, 0 ) );
+	}
+
+	if ( nullptr == m_patch.m_pView )
+		throw CRuntimeException( str::Format( _T("Cannot map resource file '%s'"), m_rcFilePath.GetPtr() ) );
+
+	m_patch.m_viewSize = static_cast<size_t>( fileSize.QuadPart );
+
+	const char* pBegin = m_patch.m_pView;
+	const char* pEnd = pBegin + m_patch.m_viewSize;
+
+	if ( m_patch.m_viewSize >= 3 && 0 == memcmp( pBegin, "\xEF\xBB\xBF", 3 ) )
+		m_encoding = fs::UTF8_bom;
+	else if ( m_patch.m_viewSize >= 2 && ( 0 == memcmp( pBegin, "\xFF\xFE", 2 ) || 0 == memcmp( pBegin, "\xFE\xFF", 2 ) ) )
+	{
+		CloseMapping();
+		return false;			// UTF16/UTF32: patch through the lines mode
+	}
+
+	if ( memchr( pBegin, '\0', m_patch.m_viewSize ) != nullptr )
+	{	// text .rc files never contain NULs: most likely UTF16 without a BOM, which would be corrupted by a byte patch
+		CloseMapping();
+		throw CRuntimeException( str::Format( _T("Cannot patch resource file '%s': NUL bytes found (UTF16 without a BOM?)"), m_rcFilePath.GetPtr() ) );
+	}
+
+	// locate: VALUE "BuildTimestamp", "<value>"
+	const char* pValueLine = nullptr;
+	const char* pValue = nullptr;
+	const char* pValueEnd = nullptr;
+
+	if ( const char* pVersionInfo = rc::FindLeadingToken( pBegin, pBegin, pEnd, "VS_VERSION_INFO" ) )
+		for ( const char* pFirst = pVersionInfo; nullptr == pValue && ( pValueLine = rc::FindLeadingToken( pBegin, pFirst, pEnd, "VALUE" ) ) != nullptr; pFirst = pValueLine + 1 )
+		{
+			const char* pCursor = rc::SkipBlanks( pValueLine + 5, pEnd );
+			static const char s_btName[] = "\"BuildTimestamp\"";
+
+			if ( static_cast<size_t>( pEnd - pCursor ) >= COUNT_OF( s_btName ) - 1 && 0 == memcmp( pCursor, s_btName, COUNT_OF( s_btName ) - 1 ) )
+			{
+				pCursor = rc::SkipBlanks( pCursor + COUNT_OF( s_btName ) - 1, pEnd );
+				if ( pCursor != pEnd && ',' == *pCursor )
+					pCursor = rc::SkipBlanks( pCursor + 1, pEnd );
+
+				if ( pCursor == pEnd || *pCursor != '"' )
+					break;				// malformed value: leave it to the lines mode
+
+				pValue = pCursor + 1;
+				pValueEnd = pValue;
+				while ( pValueEnd != pEnd && *pValueEnd != '"' && *pValueEnd != '\n' && *pValueEnd != '\r' )
+					++pValueEnd;
+
+				if ( pValueEnd == pEnd || *pValueEnd != '"' )
+					pValue = nullptr;	// unterminated value
+				break;
+			}
+		}
+
+	if ( nullptr == pValue )
+	{
+		if ( HasFlag( m_optionFlags, app::Add_BuildTimestamp ) || pValueLine != nullptr )
+		{
+			CloseMapping();
+			return false;		// must insert the entry, or malformed value: edit through the lines mode
+		}
+		CloseMapping();
+		return true;			// no BuildTimestamp: nothing to stamp
+	}
+
+	m_patch.m_offset = static_cast<size_t>( pValue - pBegin );
+	m_patch.m_origValue.assign( pValue, pValueEnd );
+	m_pos.m_buildTimestamp = rc::CountLines( pBegin, pValueLine );
+	m_origBuildTimestamp = time_utl::ParseStdTimestamp( str::FromAnsi( m_patch.m_origValue.c_str() ) );
+	return true;
+}
+
+void CResourceFile::CloseMapping( void )
 {
+	if ( m_patch.m_pView != nullptr )
+	{
+		::UnmapViewOfFile( m_patch.m_pView );
+		m_patch.m_pView = nullptr;
+	}
+	m_patch.m_mapping.Close();
+	m_patch.m_file.Close();
 }
 
 CTime CResourceFile::StampBuildTime( const CTime& buildTimestamp )
@@ -98,18 +266,73 @@ CTime CResourceFile::StampBuildTime( const CTime& buildTimestamp )
 	REQUIRE( HasBuildTimestamp() );
 	m_newBuildTimestamp = buildTimestamp;
 
-	rc::CVersionInfoParser::ReplaceEntry_BuildTimestamp( RefLine_BuildTimestamp(), m_newBuildTimestamp );
+	if ( IsPatchMode() )
+	{
+		m_patch.m_newValue = rc::CVersionInfoParser::FormatBuildTimestamp( m_newBuildTimestamp );
+		m_modified = m_patch.m_newValue != m_patch.m_origValue;
+	}
+	else
+	{
+		std::string& rLine = RefLine_BuildTimestamp();
+		std::string origLine = rLine;
+
+		rc::CVersionInfoParser::ReplaceEntry_BuildTimestamp( rLine, m_newBuildTimestamp );
+		m_modified = m_modified || rLine != origLine;		// an added entry is already a modification
+	}
 	return m_origBuildTimestamp;
 }
 
-void CResourceFile::Save( void ) const throws_( std::exception, CException* )
+void CResourceFile::Save( void ) throws_( std::exception, CException* )
 {
-	io::WriteLinesToFile( m_rcFilePath, m_lines, m_encoding );		// save all lines
+	if ( !m_modified )
+	{	// same value: leave the file untouched, unless explicitly requested
+		CloseMapping();
+
+		if ( HasFlag( m_optionFlags, app::TouchRcFile ) )
+			fs::thr::TouchFile( m_rcFilePath );
+		return;
+	}
+
+	if ( IsPatchMode() )
+		SavePatch();
+	else
+		io::WriteLinesToFile( m_rcFilePath, m_lines, m_encoding );		// save all lines
 
 	if ( !HasFlag( m_optionFlags, app::TouchRcFile ) )
 		m_origFileState.WriteToFile();								// restore the original file access times
 }
 
+void CResourceFile::SavePatch( void ) throws_( CRuntimeException )
+{	// rewrite from the value onwards: just the value if of same length, otherwise the value and the trailing content
+	REQUIRE( IsPatchMode() && m_patch.m_pView != nullptr );
+
+	std::string patch = m_patch.m_newValue;
+	bool sameLength = m_patch.m_newValue.length() == m_patch.m_origValue.length();
+
+	if ( !sameLength )
+		patch.append( m_patch.m_pView + m_patch.m_offset + m_patch.m_origValue.length(), m_patch.m_pView + m_patch.m_viewSize );
+
+	HANDLE hFile = m_patch.m_file.Get();
+
+	::UnmapViewOfFile( m_patch.m_pView );		// unmap before writing: the file may be truncated
+	m_patch.m_pView = nullptr;
+	m_patch.m_mapping.Close();
+
+	LARGE_INTEGER offset;
+	offset.QuadPart = static_cast<LONGLONG>( m_patch.m_offset );
+	DWORD writtenSize = 0;
+
+	if ( !::SetFilePointerEx( hFile, offset, nullptr, FILE_BEGIN ) ||
+		 !::WriteFile( hFile, patch.c_str(), static_cast<DWORD>( patch.length() ), &writtenSize, nullptr ) || writtenSize != static_cast<DWORD>( patch.length() ) ||
+		 ( !sameLength && !::SetEndOfFile( hFile ) ) )
+	{
+		CloseMapping();
+		throw CRuntimeException( str::Format( _T("Error patching resource file '%s'"), m_rcFilePath.GetPtr() ) );
+	}
+
+	CloseMapping();			// close the file before restoring its original times
+}
+
 void CResourceFile::Report( std::ostream& os ) const
 {
 	REQUIRE( HasBuildTimestamp() );
@@ -121,6 +344,9 @@ void CResourceFile::Report( std::ostream& os ) const
 	if ( time_utl::IsValid( m_origBuildTimestamp ) )
 		os << "  (was '" << time_utl::FormatTimestamp( m_origBuildTimestamp ) << "')";
 
+	if ( !m_modified )
+		os << "  (unchanged, file not written)";
+
 	os << "." << std::endl;
 }
 
@@ -135,6 +361,7 @@ void CResourceFile::OnEndParsing( void )
 				rc::CVersionInfoParser::ReplaceEntry_VALUE( btValueLine, "BuildTimestamp", "..." );
 				m_lines.insert( m_lines.begin() + m_pos.m_firstValue, btValueLine );
 				m_pos.m_buildTimestamp = m_pos.m_firstValue;
+				m_modified = true;
 			}
 }
 
@@ -260,12 +487,15 @@ namespace rc
 
 	bool CVersionInfoParser::ReplaceEntry_BuildTimestamp( std::string& rValueLine, const CTime& buildTimestamp )
 	{
-		std::string tsText( "..." );
+		return ReplaceEntry_VALUE( rValueLine, nullptr, FormatBuildTimestamp( buildTimestamp ).c_str() );
+	}
 
-		if ( time_utl::IsValid( buildTimestamp ) )
-			tsText = str::AsNarrow( time_utl::FormatTimestamp( buildTimestamp ) );
+	std::string CVersionInfoParser::FormatBuildTimestamp( const CTime& buildTimestamp )
+	{
+		if ( !time_utl::IsValid( buildTimestamp ) )
+			return "...";
 
-		return ReplaceEntry_VALUE( rValueLine, nullptr, tsText.c_str() );
+		return str::AsNarrow( time_utl::FormatTimestamp( buildTimestamp ) );
 	}
 
 }	// namespace rc
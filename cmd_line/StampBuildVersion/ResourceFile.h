@@ -6,6 +6,7 @@
 #include <stack>
 #include "utl/Path.h"
 #include "utl/FileState.h"
+#include "utl/FileSystem_fwd.h"
 #include "utl/TextFileIo.h"
 #include "utl/TokenIterator.h"
 #include "CmdLineOptions_fwd.h"
@@ -20,6 +21,11 @@ namespace rc
 
 
 // parses an .rc resource file, and allows modification of VS_VERSION_INFO values in StringFileInfo block
+//	- lines mode: loads all lines, and saves all lines;
+//	- patch-in-place mode (app::PatchInPlace): maps the file, locates the BuildTimestamp value with a single scan, and rewrites only the bytes from the value onwards.
+//	  Falls back to lines mode for UTF16/UTF32 files, and for adding a missing BuildTimestamp entry.
+//	  Throws for files with NUL bytes (e.g. UTF16 without a BOM), which can't be patched as bytes.
+// Save() skips writing when the stamped value is unchanged, so that the file stays untouched for incremental builds.
 //
 class CResourceFile : private utl::noncopyable
 {
@@ -29,10 +35,12 @@ public:
 	~CResourceFile();
 
 	fs::Encoding GetEncoding( void ) { return m_encoding; }
+	bool IsPatchMode( void ) const { return m_patch.IsValid(); }
+	bool IsModified( void ) const { return m_modified; }
 
 	bool HasBuildTimestamp( void ) const { return m_pos.m_buildTimestamp != utl::npos; }
 	CTime StampBuildTime( const CTime& buildTimestamp ) throws_( CRuntimeException );
-	void Save( void ) const throws_( std::exception, CException* );
+	void Save( void ) throws_( std::exception, CException* );
 	void Report( std::ostream& os ) const;
 private:
 	bool FoundFirstValue( void ) const { return m_pos.m_firstValue != utl::npos; }
@@ -41,6 +49,11 @@ private:
 	std::string& RefLine_FirstValue( void ) { ASSERT( FoundFirstValue() ); return m_lines[ m_pos.m_firstValue ]; }
 
 	void OnEndParsing( void );
+
+	void ParseLines( void ) throws_( CRuntimeException );
+	bool ParseMapped( void ) throws_( CRuntimeException );		// false if patching in place is not possible
+	void SavePatch( void ) throws_( CRuntimeException );
+	void CloseMapping( void );
 	unsigned int GetBuildTimestampLineNum( void ) const { ASSERT( HasBuildTimestamp() ); return static_cast<unsigned int>( m_pos.m_buildTimestamp ) + 1; }
 private:
 	struct CParsePos		// stores key positions found in VersionInfo section during parsing
@@ -50,13 +63,31 @@ private:
 		size_t m_buildTimestamp;				// index in m_lines where the BuildTimestamp value is located
 		size_t m_firstValue;					// index in m_lines where the first value is located (in case we must add the "BuildTimestamp" value)
 	};
+
+	struct CBytePatch		// patch-in-place mode: the BuildTimestamp value located in the mapped file
+	{
+		CBytePatch( void ) : m_offset( utl::npos ), m_pView( nullptr ), m_viewSize( 0 ) {}
+
+		bool IsValid( void ) const { return m_offset != utl::npos; }
+	public:
+		size_t m_offset;						// byte offset of the value text, inside the quotes
+		std::string m_origValue;
+		std::string m_newValue;
+
+		fs::CHandle m_file;
+		fs::CHandle m_mapping;
+		const char* m_pView;			// mapped file content
+		size_t m_viewSize;
+	};
 private:
 	fs::CPath m_rcFilePath;
 	app::TOption m_optionFlags;
 	fs::CFileState m_origFileState;
 
 	fs::Encoding m_encoding;
-	std::vector<std::string> m_lines;
+	std::vector<std::string> m_lines;			// lines mode only
+	CBytePatch m_patch;							// patch-in-place mode only
+	bool m_modified;
 	CParsePos m_pos;							// index in m_lines where the BuildTimestamp value is located
 	CTime m_origBuildTimestamp;					// IN
 	CTime m_newBuildTimestamp;					// OUT
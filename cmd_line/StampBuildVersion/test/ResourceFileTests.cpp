@@ -4,6 +4,7 @@
 #ifdef USE_UT		// no UT code in release builds
 #include "ResourceFileTests.h"
 #include "Application.h"
+#include "BatchStamper.h"
 #include "CmdLineOptions.h"
 #include "ResourceFile.h"
 #include "utl/AppTools.h"
@@ -46,6 +47,7 @@ namespace ut
 
 	// impl
 	void testEach_StampRcFile( const TCHAR* pRcFilePath );
+	void testEach_PatchRcFile( const TCHAR* pRcFilePath, bool canPatch );
 	void testRcFile_CurrentTimestamp( const std::string& newText, const CTime& baselineTimestamp );
 	void testRcFile_RefTimestamp( const std::string& newText );
 }
@@ -70,6 +72,103 @@ void CResourceFileTests::TestStampRcFile( void )
 	ut::testEach_StampRcFile( ut::s_rcFiles[ ut::RC_UTF16_be_bom ] );
 }
 
+void CResourceFileTests::TestPatchInPlace( void )
+{
+	ut::testEach_PatchRcFile( ut::s_rcFiles[ ut::RC_ANSI ], true );
+	ut::testEach_PatchRcFile( ut::s_rcFiles[ ut::RC_UTF8_bom ], true );
+	ut::testEach_PatchRcFile( ut::s_rcFiles[ ut::RC_UTF16_LE_bom ], false );		// lines mode fallback
+	ut::testEach_PatchRcFile( ut::s_rcFiles[ ut::RC_UTF16_be_bom ], false );
+}
+
+void CResourceFileTests::TestPatchUtf16NoBom( void )
+{
+	ut::CTempFilePool pool( ut::s_rcFiles[ ut::RC_UTF16_LE_bom ] );
+	const fs::CPath& targetRcFilePath = pool.GetFilePaths()[ 0 ];
+
+	std::vector<BYTE> bytes;
+	{
+		CFile srcFile( (ut::GetStdTestFilesDirPath() / ut::s_rcFiles[ ut::RC_UTF16_LE_bom ]).GetPtr(), CFile::modeRead | CFile::typeBinary );
+		bytes.resize( static_cast<size_t>( srcFile.GetLength() ) );
+		srcFile.Read( &bytes.front(), static_cast<UINT>( bytes.size() ) );
+	}
+	ASSERT( bytes.size() > 2 && 0xFF == bytes[ 0 ] && 0xFE == bytes[ 1 ] );
+	{
+		CFile targetFile( targetRcFilePath.GetPtr(), CFile::modeCreate | CFile::modeWrite | CFile::typeBinary );
+		targetFile.Write( &bytes[ 2 ], static_cast<UINT>( bytes.size() - 2 ) );		// strip the BOM
+	}
+
+	ASSERT_THROWS( CRuntimeException, CResourceFile( targetRcFilePath, app::PatchInPlace ) );		// refuse to patch bytes of unknown encoding
+}
+
+void CResourceFileTests::TestBatchWatchStamp( void )
+{
+	ut::CTempFilePool pool( str::Format( _T("%s|%s"), ut::s_rcFiles[ ut::RC_ANSI ], ut::s_rcFiles[ ut::RC_UTF16_LE_bom ] ).c_str() );
+	ASSERT_EQUAL( 2, pool.GetFilePaths().size() );
+
+	for ( std::vector<fs::CPath>::const_iterator itRcFilePath = pool.GetFilePaths().begin(); itRcFilePath != pool.GetFilePaths().end(); ++itRcFilePath )
+		fs::thr::CopyFile( (ut::GetStdTestFilesDirPath() / itRcFilePath->GetFilenamePtr()).GetPtr(), itRcFilePath->GetPtr(), false );
+
+	const std::vector<fs::CPath> rcFilePaths = pool.GetFilePaths();
+	std::string newText;
+
+	// equivalent command line: "StampBuildVersion.exe <poolDirPath> "10-11-2022 10:11:22" -a -w"
+	CCmdLineOptions options;
+	options.m_targetRcPath = pool.GetPoolDirPath();
+	options.m_stateFilePath = pool.QualifyPath( _T("StampBuildVersion.state") );
+	options.m_optionFlags = app::BatchMode | app::WatchMode | app::Add_BuildTimestamp;
+	options.m_buildTimestamp = time_utl::ParseStdTimestamp( str::FromUtf8( ut::s_refTimestamp.c_str() ) );
+
+	{	// first run: no state, stamp all
+		CBatchStamper batchStamper( options );
+		ASSERT_EQUAL( 2, batchStamper.SearchRcFiles() );
+
+		batchStamper.Run();
+		ASSERT_EQUAL( 2, batchStamper.GetStampedCount() );
+		ASSERT_EQUAL( 0, batchStamper.GetErrorCount() );
+		ASSERT( fs::IsValidFile( options.m_stateFilePath.GetPtr() ) );
+	}
+
+	for ( std::vector<fs::CPath>::const_iterator itRcFilePath = rcFilePaths.begin(); itRcFilePath != rcFilePaths.end(); ++itRcFilePath )
+	{
+		io::ReadStringFromFile( newText, *itRcFilePath );
+		ut::testRcFile_RefTimestamp( newText );
+	}
+
+	options.m_buildTimestamp += CTimeSpan( 0, 1, 0, 0 );
+
+	{	// inputs not changed: skip all
+		CBatchStamper batchStamper( options );
+		ASSERT_EQUAL( 2, batchStamper.SearchRcFiles() );
+
+		batchStamper.Run();
+		ASSERT_EQUAL( 0, batchStamper.GetStampedCount() );
+		ASSERT_EQUAL( 2, batchStamper.GetUpToDateCount() );
+	}
+
+	for ( std::vector<fs::CPath>::const_iterator itRcFilePath = rcFilePaths.begin(); itRcFilePath != rcFilePaths.end(); ++itRcFilePath )
+	{
+		io::ReadStringFromFile( newText, *itRcFilePath );
+		ut::testRcFile_RefTimestamp( newText );
+	}
+
+	ASSERT( pool.CreateFiles( _T("resource.h") ) );		// a new project source file
+
+	{	// inputs changed: stamp all again
+		CBatchStamper batchStamper( options );
+		ASSERT_EQUAL( 2, batchStamper.SearchRcFiles() );
+
+		batchStamper.Run();
+		ASSERT_EQUAL( 2, batchStamper.GetStampedCount() );
+		ASSERT_EQUAL( 0, batchStamper.GetUpToDateCount() );
+	}
+
+	for ( std::vector<fs::CPath>::const_iterator itRcFilePath = rcFilePaths.begin(); itRcFilePath != rcFilePaths.end(); ++itRcFilePath )
+	{
+		io::ReadStringFromFile( newText, *itRcFilePath );
+		ASSERT( newText.find( ut::s_refTimestamp ) == std::string::npos );
+	}
+}
+
 void CResourceFileTests::FuncTest_StampRcFile( void )
 {
 	ut::CTempFilePool pool( ut::s_rcFiles[ ut::RC_ANSI ] );
@@ -185,6 +284,51 @@ void ut::testEach_StampRcFile( const TCHAR* pRcFilePath )
 	}
 }
 
+void ut::testEach_PatchRcFile( const TCHAR* pRcFilePath, bool canPatch )
+{
+	ut::CTempFilePool pool( pRcFilePath );
+	const fs::CPath& targetRcFilePath = pool.GetFilePaths()[ 0 ];
+
+	fs::thr::CopyFile( (ut::GetStdTestFilesDirPath() / pRcFilePath).GetPtr(), targetRcFilePath.GetPtr(), false );
+
+	std::string stampedText, newText;
+
+	// equivalent command line: "StampBuildVersion.exe <targetRcFilePath> "10-11-2022 10:11:22" -a -p"
+	CCmdLineOptions options;
+	options.m_targetRcPath = targetRcFilePath;
+	options.m_optionFlags = app::Add_BuildTimestamp | app::PatchInPlace;		// adding the entry falls back to lines mode
+	options.m_buildTimestamp = time_utl::ParseStdTimestamp( str::FromUtf8( ut::s_refTimestamp.c_str() ) );
+
+	app::RunMain( options );
+	{
+		io::ReadStringFromFile( stampedText, targetRcFilePath );
+		testRcFile_RefTimestamp( stampedText );
+	}
+
+	{	// stamping the same timestamp: nothing to write
+		CResourceFile rcFile( targetRcFilePath, app::PatchInPlace );
+		ASSERT_EQUAL( canPatch, rcFile.IsPatchMode() );
+		ASSERT( rcFile.HasBuildTimestamp() );
+		ASSERT( options.m_buildTimestamp == rcFile.StampBuildTime( options.m_buildTimestamp ) );
+		ASSERT( !rcFile.IsModified() );
+	}
+
+	{	// stamping a new timestamp: only the value changes
+		CTime newTimestamp = options.m_buildTimestamp + CTimeSpan( 0, 1, 0, 0 );
+		CResourceFile rcFile( targetRcFilePath, app::PatchInPlace );
+
+		rcFile.StampBuildTime( newTimestamp );
+		ASSERT( rcFile.IsModified() );
+		rcFile.Save();
+
+		std::string expectedText = stampedText;
+		str::Replace( expectedText, ut::s_refTimestamp.c_str(), str::AsNarrow( time_utl::FormatTimestamp( newTimestamp ) ).c_str() );
+
+		io::ReadStringFromFile( newText, targetRcFilePath );
+		ASSERT_EQUAL( expectedText, newText );
+	}
+}
+
 void ut::testRcFile_CurrentTimestamp( const std::string& newText, const CTime& baselineTimestamp )
 {
 	rc::TTokenIterator it( newText );
@@ -214,6 +358,9 @@ void ut::testRcFile_RefTimestamp( const std::string& newText )
 void CResourceFileTests::Run( void )
 {
 	RUN_TEST( TestStampRcFile );
+	RUN_TEST( TestPatchInPlace );
+	RUN_TEST( TestPatchUtf16NoBom );
+	RUN_TEST( TestBatchWatchStamp );
 	RUN_TEST( FuncTest_StampRcFile );
 }
 
@@ -21,6 +21,9 @@ public:
 private:
 	// unit tests
 	void TestStampRcFile( void );
+	void TestPatchInPlace( void );
+	void TestPatchUtf16NoBom( void );
+	void TestBatchWatchStamp( void );
 
 	// functional unit tests (executes the command line process)
 	void FuncTest_StampRcFile( void );